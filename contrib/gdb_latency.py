@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+
+# Measure the round trip time of GDB 'g' (read all registers) and 'm'
+# (read memory) packets against a running OpenOCD GDB server, the way
+# a debugger front end sees it, and print the result as JSON in the
+# same shape as benchmark_json from tcl/tools/benchmark.tcl.
+#
+# The target should be halted, otherwise OpenOCD answers with errors.
+#
+# usage: gdb_latency.py [-p port] [-n iterations] address [length]
+
+import json
+import socket
+import sys
+import time
+
+
+class Remote:
+	def __init__(self, port):
+		self.sock = socket.create_connection(("localhost", port))
+		self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+		self.buf = b""
+
+	def read_byte(self):
+		while not self.buf:
+			data = self.sock.recv(4096)
+			if not data:
+				sys.exit("connection closed")
+			self.buf += data
+		b, self.buf = self.buf[:1], self.buf[1:]
+		return b
+
+	def command(self, payload):
+		data = payload.encode()
+		self.sock.sendall(b"$%s#%02x" % (data, sum(data) & 0xff))
+		# skip the ack and anything else up to the reply
+		while self.read_byte() != b"$":
+			pass
+		reply = b""
+		while True:
+			b = self.read_byte()
+			if b == b"#":
+				break
+			reply += b
+		self.read_byte()
+		self.read_byte()
+		self.sock.sendall(b"+")
+		return reply.decode(errors="replace")
+
+
+def measure(remote, payload, iterations):
+	times = []
+	for _ in range(iterations):
+		start = time.perf_counter()
+		reply = remote.command(payload)
+		times.append((time.perf_counter() - start) * 1e6)
+		if reply.startswith("E"):
+			sys.exit("%s failed: %s" % (payload, reply))
+	times.sort()
+	return times
+
+
+def main(argv):
+	port = 3333
+	iterations = 100
+	args = argv[1:]
+	while len(args) > 1 and args[0] in ("-p", "-n"):
+		if args[0] == "-p":
+			port = int(args[1])
+		else:
+			iterations = int(args[1])
+		args = args[2:]
+	if len(args) not in (1, 2):
+		sys.exit("usage: %s [-p port] [-n iterations] address [length]" % argv[0])
+	address = int(args[0], 0)
+	length = int(args[1], 0) if len(args) == 2 else 4
+
+	remote = Remote(port)
+	results = {}
+	for name, payload in (("gdb.g", "g"), ("gdb.m", "m%x,%x" % (address, length))):
+		times = measure(remote, payload, iterations)
+		results[name + "_avg_us"] = {"value": round(sum(times) / len(times), 3), "unit": "us"}
+		results[name + "_median_us"] = {"value": round(times[len(times) // 2], 3), "unit": "us"}
+		results[name + "_max_us"] = {"value": round(times[-1], 3), "unit": "us"}
+
+	remote.command("D")
+	print(json.dumps({"results": results}, indent=None))
+
+
+if __name__ == "__main__":
+	main(sys.argv)
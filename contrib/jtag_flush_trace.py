@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+
+# Summarise a trace written by the OpenOCD "jtag trace_flushes" command.
+#
+# The file starts with the 8 byte magic "OCDFLTR1" followed by 32 byte
+# little-endian records, one per JTAG queue execution or SWD run:
+#
+#   0  u8  kind, 1 = JTAG, 2 = SWD
+#   1  u8  reserved
+#   2  u16 WAIT responses reported since the previous record
+#   4  i32 result of the flush (ERROR_OK, ERROR_WAIT, ...)
+#   8  u32 commands (JTAG) or DP/AP transactions (SWD)
+#  12  u32 bits shifted (SWD: 32 data bits per transaction)
+#  16  u64 start, us since the trace was opened
+#  24  u32 duration, us
+#  28  u32 reserved
+#
+# usage: jtag_flush_trace.py [-n slowest] tracefile
+
+import struct
+import sys
+
+MAGIC = b"OCDFLTR1"
+RECORD = struct.Struct("<BBHiIIQII")
+KINDS = {1: "JTAG", 2: "SWD"}
+RESULTS = {0: "ERROR_OK", -4: "ERROR_FAIL", -5: "ERROR_WAIT",
+	-104: "ERROR_JTAG_QUEUE_FAILED"}
+
+
+def read_trace(path):
+	with open(path, "rb") as f:
+		data = f.read()
+	if data[:len(MAGIC)] != MAGIC:
+		sys.exit("%s: not a flush trace" % path)
+	records = []
+	for off in range(len(MAGIC), len(data) - RECORD.size + 1, RECORD.size):
+		kind, _, waits, result, count, bits, start, duration, _ = \
+			RECORD.unpack_from(data, off)
+		records.append((kind, waits, result, count, bits, start, duration))
+	return records
+
+
+def summarise(records, slowest):
+	if not records:
+		print("empty trace")
+		return
+
+	span = records[-1][5] + records[-1][6] - records[0][5]
+	print("%d flushes over %.3f s" % (len(records), span / 1e6))
+
+	for kind, name in sorted(KINDS.items()):
+		sel = [r for r in records if r[0] == kind]
+		if not sel:
+			continue
+		busy = sum(r[6] for r in sel)
+		count = sum(r[3] for r in sel)
+		bits = sum(r[4] for r in sel)
+		waits = sum(r[1] for r in sel)
+		unit = "commands" if kind == 1 else "transactions"
+		print()
+		print("%s: %d flushes, %.3f s in flushes (%.1f%% of the trace)" %
+			(name, len(sel), busy / 1e6, 100.0 * busy / span if span else 0))
+		print("  time per flush: avg %.1f us, max %d us" %
+			(busy / len(sel), max(r[6] for r in sel)))
+		print("  %s per flush: avg %.1f, max %d" %
+			(unit, count / len(sel), max(r[3] for r in sel)))
+		if count:
+			print("  bytes per %s: %.1f" % (unit[:-1], bits / 8.0 / count))
+		if busy:
+			print("  throughput: %.1f kbit/s" % (bits * 1000.0 / busy))
+		print("  WAIT responses: %d, in %d flushes" %
+			(waits, sum(1 for r in sel if r[1])))
+
+		results = {}
+		for r in sel:
+			results[r[2]] = results.get(r[2], 0) + 1
+		for result, n in sorted(results.items(), reverse=True):
+			print("  %-24s %d" % (RESULTS.get(result, str(result)), n))
+
+	if slowest:
+		print()
+		print("slowest flushes:")
+		print("  %12s %5s %10s %8s %10s %5s  result" %
+			("start/us", "kind", "time/us", "count", "bits", "waits"))
+		for r in sorted(records, key=lambda r: r[6], reverse=True)[:slowest]:
+			print("  %12d %5s %10d %8d %10d %5d  %s" %
+				(r[5], KINDS.get(r[0], "?"), r[6], r[3], r[4], r[1],
+				RESULTS.get(r[2], str(r[2]))))
+
+
+def main(argv):
+	slowest = 10
+	args = argv[1:]
+	if len(args) == 3 and args[0] == "-n":
+		slowest = int(args[1])
+		args = args[2:]
+	if len(args) != 1:
+		sys.exit("usage: %s [-n slowest] tracefile" % argv[0])
+	summarise(read_trace(args[0]), slowest)
+
+
+if __name__ == "__main__":
+	main(sys.argv)
@@ -28,6 +28,7 @@
 #define TARGET_REQ_DEBUGMSG_ASCII			0x01
 #define TARGET_REQ_DEBUGMSG_HEXMSG(size)	(0x01 | ((size & 0xff) << 8))
 #define TARGET_REQ_DEBUGCHAR				0x02
+#define TARGET_REQ_BINMSG					0x04
 
 #if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_6SM__)
 
@@ -155,3 +156,23 @@ void dbg_write_char(char msg)
 {
 	dbg_write(TARGET_REQ_DEBUGCHAR | ((msg & 0xff) << 16));
 }
+
+void dbg_write_bin(const void *data, long len)
+{
+	const unsigned char *val = data;
+	unsigned long dcc_data;
+
+	dbg_write(TARGET_REQ_BINMSG | ((len & 0xffff) << 16));
+
+	while (len > 0)
+	{
+		dcc_data = val[0]
+			| ((len > 1) ? val[1] << 8 : 0x00)
+			| ((len > 2) ? val[2] << 16 : 0x00)
+			| ((len > 3) ? val[3] << 24 : 0x00);
+		dbg_write(dcc_data);
+
+		val += 4;
+		len -= 4;
+	}
+}
@@ -32,4 +32,7 @@ void dbg_write_u8(const unsigned char *val, long len);
 void dbg_write_str(const char *msg);
 void dbg_write_char(char msg);
 
+/* raw bytes (up to 65535) for "target_request binary" TCP clients */
+void dbg_write_bin(const void *data, long len);
+
 #endif	/* DCC_STDIO_H */
@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/*
+	parameters:
+	r0 - pointer to an array of struct { uint32_t size_in_result_out,
+	     uint32_t address }, terminated by an entry with size 0
+	r1 - erased byte value
+
+	Each size is replaced by 1 if the block is erased, 0 otherwise.
+*/
+
+	.text
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+	.thumb_func
+
+	.align	2
+
+BLOCK_SIZE_RESULT	= 0
+BLOCK_ADDRESS		= 4
+SIZEOF_BLOCK		= 8
+
+block_loop:
+	ldr		r2, [r0, #BLOCK_SIZE_RESULT]
+	cmp		r2, #0
+	beq		done
+	ldr		r3, [r0, #BLOCK_ADDRESS]
+	movs	r4, #0
+byte_loop:
+	ldrb	r5, [r3]
+	adds	r3, #1
+	eors	r5, r1
+	orrs	r4, r5
+	subs	r2, #1
+	bne		byte_loop
+	movs	r2, #1
+	cmp		r4, #0
+	beq		store
+	movs	r2, #0
+store:
+	str		r2, [r0, #BLOCK_SIZE_RESULT]
+	adds	r0, #SIZEOF_BLOCK
+	b		block_loop
+done:
+	bkpt	#0
+
+	.end
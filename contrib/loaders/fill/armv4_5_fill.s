@@ -0,0 +1,45 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/*
+	parameters:
+	r0 - word aligned address
+	r1 - byte count, a multiple of 4
+	r2 - 32-bit pattern
+*/
+
+	.text
+	.arm
+
+_start:
+	mov		r3, r2
+	mov		r4, r2
+	mov		r5, r2
+blocks:
+	cmp		r1, #16
+	blo		words
+	stmia	r0!, {r2, r3, r4, r5}
+	sub		r1, r1, #16
+	b		blocks
+words:
+	cmp		r1, #0
+	beq		end
+	str		r2, [r0], #4
+	sub		r1, r1, #4
+	b		words
+end:
+	bkpt	#0
+
+	.end
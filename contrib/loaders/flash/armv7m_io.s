@@ -56,5 +56,43 @@ write:
 done_write:
 	bkpt #0
 
+	.align 4
+
+/* Inputs:
+ *  r0	NAND data address (byte wide), status on return
+ *  r1	NAND command address
+ *  r2	NAND address latch
+ *  r3	address cycles
+ *  r4	number of address cycles
+ *  r5	page data followed by OOB
+ *  r6	page data plus OOB length
+ */
+write_page:
+	movs	r7, #0x80	/* SEQIN */
+	strb	r7, [r1]
+write_page_addr:
+	ldrb	r7, [r3], #1
+	strb	r7, [r2]
+	subs	r4, r4, #1
+	bne		write_page_addr
+write_page_data:
+	ldrb	r7, [r5], #1
+	strb	r7, [r0]
+	subs	r6, r6, #1
+	bne		write_page_data
+	movs	r7, #0x10	/* PAGEPROG */
+	strb	r7, [r1]
+	movs	r7, #0x70	/* STATUS */
+	strb	r7, [r1]
+write_page_wait:
+	ldrb	r7, [r0]
+	tst		r7, #0x40	/* ready? */
+	beq		write_page_wait
+	mov		r0, r7
+
+done_write_page:
+	bkpt #0
+	nop
+
 	.end
 
@@ -0,0 +1,92 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/* Bus width dependent helpers shared by the CFI buffered write loaders.
+ * BUS_WIDTH (1, 2 or 4) is passed on the command line. */
+
+#if BUS_WIDTH == 1
+#define LDRW	ldrb
+#define STRW	strb
+#define SHIFT	0
+#elif BUS_WIDTH == 2
+#define LDRW	ldrh
+#define STRW	strh
+#define SHIFT	1
+#elif BUS_WIDTH == 4
+#define LDRW	ldr
+#define STRW	str
+#define SHIFT	2
+#else
+#error "BUS_WIDTH must be 1, 2 or 4"
+#endif
+
+	.text
+	.syntax unified
+	.arch armv7-m
+	.thumb
+	.thumb_func
+
+	.align 2
+
+/* Compute in \n the number of bus words from \dst up to the end of its
+ * write buffer (\bufsz words, a power of two), limited to \cnt. */
+	.macro buffer_words, n, dst, cnt, bufsz, tmp
+#if SHIFT
+	lsr	\n, \dst, #SHIFT
+#else
+	mov	\n, \dst
+#endif
+	sub	\tmp, \bufsz, #1
+	and	\n, \n, \tmp
+	sub	\n, \bufsz, \n
+	cmp	\n, \cnt
+	it	hi
+	movhi	\n, \cnt
+	.endm
+
+/* Wait until the host has queued at least \n bus words in the fifo.
+ * Branches to \abort if the host cleared the write pointer. */
+	.macro wait_fifo, n, rp, start, end, tmp, abort
+1001:
+	ldr	\tmp, [\start, #0]
+	cmp	\tmp, #0
+	beq	\abort
+	subs	\tmp, \tmp, \rp
+	ittt	lo
+	addlo	\tmp, \tmp, \end
+	sublo	\tmp, \tmp, \start
+	sublo	\tmp, \tmp, #8
+#if SHIFT
+	cmp	\tmp, \n, lsl #SHIFT
+#else
+	cmp	\tmp, \n
+#endif
+	blo	1001b
+	.endm
+
+/* Move \n bus words from the fifo to \dst, post-incrementing both. */
+	.macro copy_words, n, rp, dst, cnt, start, end, tmp
+1002:
+	LDRW	\tmp, [\rp], #BUS_WIDTH
+	cmp	\rp, \end
+	it	hs
+	addhs	\rp, \start, #8
+	STRW	\tmp, [\dst], #BUS_WIDTH
+	subs	\cnt, \cnt, #1
+	subs	\n, \n, #1
+	bne	1002b
+	.endm
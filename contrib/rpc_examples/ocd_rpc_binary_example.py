@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""
+OpenOCD binary framed RPC example, covered by GNU GPLv3 or later
+
+Switches a Tcl server connection to binary framing, then pipelines
+commands: all requests are sent before the first response is read, and
+responses are matched to requests by their id. Memory is moved as raw
+bytes with read_memory_bin/write_memory_bin.
+
+Example output:
+./ocd_rpc_binary_example.py
+version: Open On-Chip Debugger 0.10.0-dev
+read 65536 bytes in 0.052 s
+"""
+
+import socket
+import struct
+import time
+
+
+class OpenOcdBinary:
+    def __init__(self, host="127.0.0.1", port=6666):
+        self.sock = socket.create_connection((host, port))
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.next_id = 1
+        self.buf = b""
+        self.done = {}
+
+        # the reply to the switch still uses the text protocol
+        self.sock.sendall(b"tcl_binary_framing\x1a")
+        while not self.buf.endswith(b"\x1a"):
+            self.buf += self.sock.recv(4096)
+        self.buf = b""
+
+    def send(self, script, data=b""):
+        """Queue a command, return its id. data is available as $tcl_rpc_data"""
+        rid = self.next_id
+        self.next_id += 1
+        script = script.encode()
+        self.sock.sendall(struct.pack("<III", 8 + len(script) + len(data),
+                                      rid, len(script)) + script + data)
+        return rid
+
+    def _read_frame(self):
+        while True:
+            if len(self.buf) >= 4:
+                size, = struct.unpack_from("<I", self.buf)
+                if len(self.buf) >= 4 + size:
+                    rid, status = struct.unpack_from("<Ii", self.buf, 4)
+                    result = self.buf[12:4 + size]
+                    self.buf = self.buf[4 + size:]
+                    return rid, status, result
+            chunk = self.sock.recv(1 << 16)
+            if not chunk:
+                raise EOFError("connection closed")
+            self.buf += chunk
+
+    def result(self, rid):
+        """Wait for the response to request rid, raise on errors"""
+        while rid not in self.done:
+            frame_id, status, result = self._read_frame()
+            if frame_id != 0:  # id 0 carries notifications
+                self.done[frame_id] = (status, result)
+        status, result = self.done.pop(rid)
+        if status != 0:
+            raise RuntimeError(result.decode(errors="replace"))
+        return result
+
+    def call(self, script, data=b""):
+        return self.result(self.send(script, data))
+
+
+if __name__ == "__main__":
+    ocd = OpenOcdBinary()
+    print("version:", ocd.call("version").decode())
+
+    # Put the address of some RAM in 'addr'
+    addr = 0x20000000
+    chunk = 4096
+    n = 16
+
+    ocd.call("halt")
+    start = time.time()
+    ids = [ocd.send("read_memory_bin 0x%x %d" % (addr, chunk)) for _ in range(n)]
+    data = b"".join(ocd.result(i) for i in ids)
+    print("read %d bytes in %.3f s" % (len(data), time.time() - start))
+
+    ocd.call("write_memory_bin 0x%x $tcl_rpc_data" % addr, data[:chunk])
@@ -0,0 +1,277 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "benchmark.h"
+#include <helper/binarybuffer.h>
+#include <helper/command.h>
+#include <helper/log.h>
+#include <helper/perf.h>
+#include <jtag/jtag.h>
+#include <jtag/commands.h>
+#include <target/image.h>
+
+/* each helper runs at least this long, so timer resolution doesn't matter */
+#define HOST_BENCH_MIN_US		200000
+#define HOST_BENCH_FIELDS		4
+#define HOST_BENCH_IHEX			"host_benchmark.hex"
+#define HOST_BENCH_SREC			"host_benchmark.s19"
+
+struct host_bench {
+	uint32_t size;
+	uint8_t *src;
+	uint8_t *dst;
+	char *hex;
+	uint8_t *scan_buffer;
+	struct scan_field fields[HOST_BENCH_FIELDS];
+	struct scan_command scan;
+	int retval;
+};
+
+static void host_bench_buf_set_buf(struct host_bench *b)
+{
+	buf_set_buf(b->src, 0, b->dst, 0, b->size * 8);
+}
+
+static void host_bench_bit_copy(struct host_bench *b)
+{
+	/* unaligned on both sides, the common case for scan fields */
+	bit_copy(b->dst, 5, b->src, 3, b->size * 8 - 8);
+}
+
+static void host_bench_hexify(struct host_bench *b)
+{
+	hexify(b->hex, (const char *)b->src, b->size, b->size * 2 + 1);
+}
+
+static void host_bench_unhexify(struct host_bench *b)
+{
+	unhexify((char *)b->dst, b->hex, b->size);
+}
+
+static void host_bench_checksum(struct host_bench *b)
+{
+	uint32_t checksum;
+
+	b->retval = image_calculate_checksum(b->src, b->size, &checksum);
+}
+
+static void host_bench_image(struct host_bench *b, const char *file, const char *type)
+{
+	struct image image;
+	size_t done;
+
+	memset(&image, 0, sizeof(image));
+	b->retval = image_open(&image, file, type);
+	if (b->retval != ERROR_OK)
+		return;
+
+	for (int i = 0; i < image.num_sections && b->retval == ERROR_OK; i++)
+		b->retval = image_read_section(&image, i, 0, MIN(image.sections[i].size, b->size),
+				b->dst, &done);
+
+	image_close(&image);
+}
+
+static void host_bench_ihex(struct host_bench *b)
+{
+	host_bench_image(b, HOST_BENCH_IHEX, "ihex");
+}
+
+static void host_bench_srec(struct host_bench *b)
+{
+	host_bench_image(b, HOST_BENCH_SREC, "s19");
+}
+
+static void host_bench_jtag_build(struct host_bench *b)
+{
+	uint8_t *buffer;
+
+	jtag_build_buffer(&b->scan, &buffer);
+	free(buffer);
+}
+
+static void host_bench_jtag_read(struct host_bench *b)
+{
+	b->retval = jtag_read_buffer(b->scan_buffer, &b->scan);
+}
+
+static int host_bench_write_ihex(struct host_bench *b)
+{
+	FILE *f = fopen(HOST_BENCH_IHEX, "w");
+	if (!f)
+		return ERROR_FAIL;
+
+	for (uint32_t address = 0; address < b->size; address += 16) {
+		uint8_t len = MIN(16, b->size - address);
+		uint8_t sum;
+
+		if ((address & 0xffff) == 0) {
+			sum = 2 + 4 + (address >> 24) + (address >> 16);
+			fprintf(f, ":02000004%04X%02X\n", address >> 16, (uint8_t)-sum);
+		}
+
+		sum = len + (address >> 8) + address;
+		fprintf(f, ":%02X%04X00", len, address & 0xffff);
+		for (unsigned i = 0; i < len; i++) {
+			fprintf(f, "%02X", b->src[address + i]);
+			sum += b->src[address + i];
+		}
+		fprintf(f, "%02X\n", (uint8_t)-sum);
+	}
+	fprintf(f, ":00000001FF\n");
+
+	return fclose(f) == 0 ? ERROR_OK : ERROR_FAIL;
+}
+
+static int host_bench_write_srec(struct host_bench *b)
+{
+	FILE *f = fopen(HOST_BENCH_SREC, "w");
+	if (!f)
+		return ERROR_FAIL;
+
+	for (uint32_t address = 0; address < b->size; address += 16) {
+		uint8_t len = MIN(16, b->size - address);
+		uint8_t sum = len + 5 + (address >> 24) + (address >> 16) + (address >> 8) + address;
+
+		fprintf(f, "S3%02X%08X", len + 5, address);
+		for (unsigned i = 0; i < len; i++) {
+			fprintf(f, "%02X", b->src[address + i]);
+			sum += b->src[address + i];
+		}
+		fprintf(f, "%02X\n", (uint8_t)~sum);
+	}
+	fprintf(f, "S70500000000FA\n");
+
+	return fclose(f) == 0 ? ERROR_OK : ERROR_FAIL;
+}
+
+static const struct {
+	const char *name;
+	void (*run)(struct host_bench *b);
+} host_benches[] = {
+	{ "host.buf_set_buf", host_bench_buf_set_buf },
+	{ "host.bit_copy_unaligned", host_bench_bit_copy },
+	{ "host.hexify", host_bench_hexify },
+	{ "host.unhexify", host_bench_unhexify },
+	{ "host.image_checksum", host_bench_checksum },
+	{ "host.ihex_parse", host_bench_ihex },
+	{ "host.srec_parse", host_bench_srec },
+	{ "host.jtag_build_buffer", host_bench_jtag_build },
+	{ "host.jtag_read_buffer", host_bench_jtag_read },
+};
+
+COMMAND_HANDLER(handle_host_benchmark_command)
+{
+	struct host_bench b;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	memset(&b, 0, sizeof(b));
+	b.size = 64 * 1024;
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], b.size);
+	if (b.size < 16 || b.size % HOST_BENCH_FIELDS) {
+		command_print(CMD_CTX, "size must be a multiple of %d, at least 16",
+				HOST_BENCH_FIELDS);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	b.src = malloc(b.size);
+	b.dst = malloc(b.size);
+	b.hex = malloc(b.size * 2 + 1);
+	b.scan_buffer = malloc(b.size);
+	if (!b.src || !b.dst || !b.hex || !b.scan_buffer) {
+		b.retval = ERROR_FAIL;
+		goto out;
+	}
+
+	for (uint32_t i = 0; i < b.size; i++)
+		b.src[i] = b.scan_buffer[i] = (i * 0x9e3779b1) >> 24;
+	hexify(b.hex, (const char *)b.src, b.size, b.size * 2 + 1);
+
+	/* one scan of a few wide fields, like a block of DAP or bitbang traffic */
+	unsigned field_bits = b.size * 8 / HOST_BENCH_FIELDS;
+	for (unsigned i = 0; i < HOST_BENCH_FIELDS; i++) {
+		b.fields[i].num_bits = field_bits;
+		b.fields[i].out_value = b.src + i * field_bits / 8;
+		b.fields[i].in_value = b.dst + i * field_bits / 8;
+	}
+	b.scan.num_fields = HOST_BENCH_FIELDS;
+	b.scan.fields = b.fields;
+
+	b.retval = host_bench_write_ihex(&b);
+	if (b.retval == ERROR_OK)
+		b.retval = host_bench_write_srec(&b);
+	if (b.retval != ERROR_OK) {
+		LOG_ERROR("can't write the image files to the current directory");
+		goto out;
+	}
+
+	/* one "name value unit" line per helper, tools/benchmark.tcl parses these */
+	for (unsigned i = 0; i < ARRAY_SIZE(host_benches); i++) {
+		unsigned runs = 0;
+		int64_t start, elapsed;
+
+		/* warm up caches and the allocator */
+		host_benches[i].run(&b);
+
+		start = perf_time_us();
+		do {
+			host_benches[i].run(&b);
+			runs++;
+			elapsed = perf_time_us() - start;
+		} while (elapsed < HOST_BENCH_MIN_US && b.retval == ERROR_OK);
+
+		if (b.retval != ERROR_OK) {
+			LOG_ERROR("%s failed", host_benches[i].name);
+			break;
+		}
+
+		command_print(CMD_CTX, "%s %.3f ns/byte", host_benches[i].name,
+				elapsed * 1000.0 / ((double)runs * b.size));
+	}
+
+out:
+	remove(HOST_BENCH_IHEX);
+	remove(HOST_BENCH_SREC);
+	free(b.scan_buffer);
+	free(b.hex);
+	free(b.dst);
+	free(b.src);
+	return b.retval;
+}
+
+static const struct command_registration benchmark_command_handlers[] = {
+	{
+		.name = "host_benchmark",
+		.handler = handle_host_benchmark_command,
+		.mode = COMMAND_ANY,
+		.help = "Time the host side data path helpers (bit copies, hex "
+			"codecs, image parsing, JTAG scan buffers) on size bytes "
+			"(default 64 KiB), without using any hardware.",
+		.usage = "[size]",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int benchmark_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, benchmark_command_handlers);
+}
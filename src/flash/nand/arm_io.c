@@ -49,10 +49,11 @@ static int arm_code_to_working_area(struct target *target,
 	int retval;
 	unsigned size = code_size + additional;
 
-	/* REVISIT this assumes size doesn't ever change.
-	 * That's usually correct; but there are boards with
-	 * both large and small page chips, where it won't be...
-	 */
+	/* the page program loader needs more room than the copy loops */
+	if (*area && (*area)->size < size) {
+		target_free_working_area(target, *area);
+		*area = NULL;
+	}
 
 	/* make sure we have a working area */
 	if (NULL == *area) {
@@ -297,3 +298,174 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 
 	return retval;
 }
+
+/**
+ * Programs one page with an on-chip algorithm: it issues SEQIN, the address
+ * cycles, the page data and OOB, PAGEPROG, then polls READ STATUS until the
+ * chip is ready.  This costs one algorithm run per page instead of a debug
+ * access for every command and address cycle and for every ready poll.
+ * 8-bit wide NAND only.
+ *
+ * @param nand Pointer to the arm_nand_data struct that defines the I/O,
+ *             with the cmd and addr latches set
+ * @param cycles Address cycles selecting the page
+ * @param num_cycles Number of address cycles, at most 8
+ * @param data Page data
+ * @param data_size Size of the page data
+ * @param oob OOB data, or NULL
+ * @param oob_size Size of the OOB data
+ * @param status Receives the final NAND status byte
+ * @return Success or failure of the operation
+ */
+int arm_nand_write_page(struct arm_nand_data *nand,
+		const uint8_t *cycles, int num_cycles,
+		uint8_t *data, uint32_t data_size,
+		uint8_t *oob, uint32_t oob_size, uint8_t *status)
+{
+	struct target *target = nand->target;
+	struct arm_algorithm armv4_5_algo;
+	struct armv7m_algorithm armv7m_algo;
+	void *arm_algo;
+	struct arm *arm = target->arch_info;
+	struct reg_param reg_params[7];
+	uint8_t cycle_buf[8];
+	uint32_t target_buf;
+	uint32_t exit_var = 0;
+	int retval;
+
+	/* Inputs:
+	 *  r0	NAND data address (byte wide), status on return
+	 *  r1	NAND command address
+	 *  r2	NAND address latch
+	 *  r3	address cycles
+	 *  r4	number of address cycles
+	 *  r5	page data followed by OOB
+	 *  r6	page data plus OOB length
+	 */
+	static const uint32_t code_armv4_5[] = {
+		0xe3a07080,	/*    mov   r7, #0x80    */
+		0xe5c17000,	/*    strb  r7, [r1]     */
+		0xe4d37001,	/* a: ldrb  r7, [r3], #1 */
+		0xe5c27000,	/*    strb  r7, [r2]     */
+		0xe2544001,	/*    subs  r4, r4, #1   */
+		0x1afffffb,	/*    bne   a            */
+		0xe4d57001,	/* d: ldrb  r7, [r5], #1 */
+		0xe5c07000,	/*    strb  r7, [r0]     */
+		0xe2566001,	/*    subs  r6, r6, #1   */
+		0x1afffffb,	/*    bne   d            */
+		0xe3a07010,	/*    mov   r7, #0x10    */
+		0xe5c17000,	/*    strb  r7, [r1]     */
+		0xe3a07070,	/*    mov   r7, #0x70    */
+		0xe5c17000,	/*    strb  r7, [r1]     */
+		0xe5d07000,	/* w: ldrb  r7, [r0]     */
+		0xe3170040,	/*    tst   r7, #0x40    */
+		0x0afffffc,	/*    beq   w            */
+		0xe1a00007,	/*    mov   r0, r7       */
+
+		/* exit: ARMv4 needs hardware breakpoint */
+		0xe1200070,	/* e: bkpt  #0           */
+	};
+
+	/* Inputs as above
+	 *
+	 * see contrib/loaders/flash/armv7m_io.s for src
+	 */
+	static const uint32_t code_armv7m[] = {
+		0x700f2780,
+		0x7b01f813,
+		0x1e647017,
+		0xf815d1fa,
+		0x70077b01,
+		0xd1fa1e76,
+		0x700f2710,
+		0x700f2770,
+		0xf0177807,
+		0xd0fb0f40,
+		0xbe004638,
+		0xbf00bf00,
+	};
+
+	int target_code_size = 0;
+	const uint32_t *target_code_src = NULL;
+
+	if (!nand->cmd || !nand->addr || num_cycles < 1 || num_cycles > 8 || !data_size)
+		return ERROR_NAND_NO_BUFFER;
+
+	/* set up algorithm */
+	if (is_armv7m(target_to_armv7m(target))) {  /* armv7m target */
+		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
+		armv7m_algo.core_mode = ARM_MODE_THREAD;
+		arm_algo = &armv7m_algo;
+		target_code_size = sizeof(code_armv7m);
+		target_code_src = code_armv7m;
+	} else {
+		armv4_5_algo.common_magic = ARM_COMMON_MAGIC;
+		armv4_5_algo.core_mode = ARM_MODE_SVC;
+		armv4_5_algo.core_state = ARM_STATE_ARM;
+		arm_algo = &armv4_5_algo;
+		target_code_size = sizeof(code_armv4_5);
+		target_code_src = code_armv4_5;
+	}
+
+	if (!oob)
+		oob_size = 0;
+
+	if (nand->op != ARM_NAND_WRITE_PAGE || !nand->copy_area
+			|| nand->copy_area->size < target_code_size + sizeof(cycle_buf)
+				+ data_size + oob_size) {
+		retval = arm_code_to_working_area(target, target_code_src, target_code_size,
+				sizeof(cycle_buf) + data_size + oob_size, &nand->copy_area);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	nand->op = ARM_NAND_WRITE_PAGE;
+
+	/* copy address cycles, data and OOB to work area */
+	target_buf = nand->copy_area->address + target_code_size;
+	memset(cycle_buf, 0, sizeof(cycle_buf));
+	memcpy(cycle_buf, cycles, num_cycles);
+	retval = target_write_buffer(target, target_buf, sizeof(cycle_buf), cycle_buf);
+	if (retval == ERROR_OK)
+		retval = target_write_buffer(target, target_buf + sizeof(cycle_buf),
+				data_size, data);
+	if (retval == ERROR_OK && oob_size)
+		retval = target_write_buffer(target, target_buf + sizeof(cycle_buf) + data_size,
+				oob_size, oob);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* set up parameters */
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);
+	init_reg_param(&reg_params[6], "r6", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, nand->data);
+	buf_set_u32(reg_params[1].value, 0, 32, nand->cmd);
+	buf_set_u32(reg_params[2].value, 0, 32, nand->addr);
+	buf_set_u32(reg_params[3].value, 0, 32, target_buf);
+	buf_set_u32(reg_params[4].value, 0, 32, num_cycles);
+	buf_set_u32(reg_params[5].value, 0, 32, target_buf + sizeof(cycle_buf));
+	buf_set_u32(reg_params[6].value, 0, 32, data_size + oob_size);
+
+	/* armv4 must exit using a hardware breakpoint */
+	if (arm->is_armv4)
+		exit_var = nand->copy_area->address + target_code_size - 4;
+
+	/* use alg to program the page and wait for the chip */
+	retval = target_run_algorithm(target, 0, NULL, 7, reg_params,
+			nand->copy_area->address, exit_var, 1000, arm_algo);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error executing hosted NAND page program");
+	else
+		*status = buf_get_u32(reg_params[0].value, 0, 32);
+
+	for (int i = 0; i < 7; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return retval;
+}
@@ -24,6 +24,7 @@ enum arm_nand_op {
 	ARM_NAND_NONE,	/**< No operation performed. */
 	ARM_NAND_READ,	/**< Read operation performed. */
 	ARM_NAND_WRITE,	/**< Write operation performed. */
+	ARM_NAND_WRITE_PAGE,	/**< Page program operation performed. */
 };
 
 /**
@@ -43,6 +44,10 @@ struct arm_nand_data {
 	/** Where data is read from or written to. */
 	uint32_t data;
 
+	/** Byte wide command and address latches, for arm_nand_write_page(). */
+	uint32_t cmd;
+	uint32_t addr;
+
 	/** Last operation executed using this struct. */
 	enum arm_nand_op op;
 
@@ -51,5 +56,9 @@ struct arm_nand_data {
 
 int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size);
 int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size);
+int arm_nand_write_page(struct arm_nand_data *nand,
+		const uint8_t *cycles, int num_cycles,
+		uint8_t *data, uint32_t data_size,
+		uint8_t *oob, uint32_t oob_size, uint8_t *status);
 
 #endif /* OPENOCD_FLASH_NAND_ARM_IO_H */
@@ -24,6 +24,7 @@
 #endif
 
 #include "imp.h"
+#include <helper/fileio.h>
 
 /* configured NAND devices and NAND Flash command handler */
 struct nand_device *nand_devices;
@@ -257,6 +258,89 @@ int nand_build_bbt(struct nand_device *nand, int first, int last)
 	return ERROR_OK;
 }
 
+/*
+ * The saved table is a text file: a header line with the IDs and geometry
+ * it was built for, then one "<block> good|bad" line per checked block.
+ */
+#define NAND_BBT_HEADER "nand_bbt %04" PRIx16 " %i %i\n"
+
+int nand_bbt_save(struct nand_device *nand, const char *filename)
+{
+	struct fileio *fileio;
+	char line[64];
+	size_t written;
+	int retval;
+	int i;
+
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+
+	retval = fileio_open(&fileio, filename, FILEIO_WRITE, FILEIO_TEXT);
+	if (retval != ERROR_OK)
+		return retval;
+
+	snprintf(line, sizeof(line), NAND_BBT_HEADER,
+		nand->blocks_id, nand->num_blocks, nand->erase_size);
+	retval = fileio_write(fileio, strlen(line), line, &written);
+
+	for (i = 0; i < nand->num_blocks && retval == ERROR_OK; i++) {
+		if (nand->blocks[i].is_bad == -1)
+			continue;
+		snprintf(line, sizeof(line), "%i %s\n", i,
+			nand->blocks[i].is_bad ? "bad" : "good");
+		retval = fileio_write(fileio, strlen(line), line, &written);
+	}
+
+	fileio_close(fileio);
+	return retval;
+}
+
+int nand_bbt_load(struct nand_device *nand, const char *filename)
+{
+	struct fileio *fileio;
+	char line[64];
+	char state[8];
+	unsigned id;
+	int num_blocks, erase_size, block;
+	int retval;
+
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+
+	retval = fileio_open(&fileio, filename, FILEIO_READ, FILEIO_TEXT);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (fileio_fgets(fileio, sizeof(line), line) != ERROR_OK
+			|| sscanf(line, "nand_bbt %x %i %i", &id, &num_blocks, &erase_size) != 3) {
+		LOG_ERROR("%s is not a NAND bad block table", filename);
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	if (id != nand->blocks_id || num_blocks != nand->num_blocks
+			|| erase_size != nand->erase_size) {
+		LOG_ERROR("%s was saved for a different NAND device", filename);
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	while (fileio_fgets(fileio, sizeof(line), line) == ERROR_OK) {
+		if (sscanf(line, "%i %7s", &block, state) != 2
+				|| block < 0 || block >= nand->num_blocks
+				|| (strcmp(state, "bad") && strcmp(state, "good"))) {
+			LOG_ERROR("malformed line in %s: %s", filename, line);
+			retval = ERROR_FAIL;
+			goto done;
+		}
+		nand->blocks[block].is_bad = !strcmp(state, "bad");
+	}
+
+done:
+	fileio_close(fileio);
+	return retval;
+}
+
 int nand_read_status(struct nand_device *nand, uint8_t *status)
 {
 	if (!nand->device)
@@ -480,8 +564,22 @@ int nand_probe(struct nand_device *nand)
 		}
 	}
 
-	nand->num_blocks = (nand->device->chip_size * 1024) / (nand->erase_size / 1024);
+	int num_blocks = (nand->device->chip_size * 1024) / (nand->erase_size / 1024);
+	uint16_t id = manufacturer_id << 8 | device_id;
+
+	/* Probing the same chip again keeps the bad block table already built,
+	 * only the erased state may have changed behind our back */
+	if (nand->blocks && nand->blocks_id == id && nand->num_blocks == num_blocks
+			&& nand->blocks[0].size == (uint32_t)nand->erase_size) {
+		for (i = 0; i < nand->num_blocks; i++)
+			nand->blocks[i].is_erased = -1;
+		return ERROR_OK;
+	}
+
+	free(nand->blocks);
+	nand->num_blocks = num_blocks;
 	nand->blocks = malloc(sizeof(struct nand_block) * nand->num_blocks);
+	nand->blocks_id = id;
 
 	for (i = 0; i < nand->num_blocks; i++) {
 		nand->blocks[i].size = nand->erase_size;
@@ -684,59 +782,80 @@ int nand_read_page(struct nand_device *nand, uint32_t page,
 		return nand->controller->read_page(nand, page, data, data_size, oob, oob_size);
 }
 
-int nand_page_command(struct nand_device *nand, uint32_t page,
-	uint8_t cmd, bool oob_only)
+/**
+ * Builds the address cycles selecting @a page for a page command.
+ *
+ * @param nand The probed NAND device
+ * @param page The page to address
+ * @param oob_only Start at the OOB area rather than the page data
+ * @param cycles Receives the address bytes, at least 6 of them
+ * @return The number of address cycles
+ */
+int nand_page_address(struct nand_device *nand, uint32_t page,
+	bool oob_only, uint8_t *cycles)
 {
-	if (!nand->device)
-		return ERROR_NAND_DEVICE_NOT_PROBED;
-
-	if (oob_only && NAND_CMD_READ0 == cmd && nand->page_size <= 512)
-		cmd = NAND_CMD_READOOB;
-
-	nand->controller->command(nand, cmd);
+	int n = 0;
 
 	if (nand->page_size <= 512) {
 		/* small page device */
 
 		/* column (always 0, we start at the beginning of a page/OOB area) */
-		nand->controller->address(nand, 0x0);
+		cycles[n++] = 0x0;
 
 		/* row */
-		nand->controller->address(nand, page & 0xff);
-		nand->controller->address(nand, (page >> 8) & 0xff);
+		cycles[n++] = page & 0xff;
+		cycles[n++] = (page >> 8) & 0xff;
 
 		/* 4th cycle only on devices with more than 32 MiB */
 		if (nand->address_cycles >= 4)
-			nand->controller->address(nand, (page >> 16) & 0xff);
+			cycles[n++] = (page >> 16) & 0xff;
 
 		/* 5th cycle only on devices with more than 8 GiB */
 		if (nand->address_cycles >= 5)
-			nand->controller->address(nand, (page >> 24) & 0xff);
+			cycles[n++] = (page >> 24) & 0xff;
 	} else {
 		/* large page device */
 
 		/* column (0 when we start at the beginning of a page,
 		 * or 2048 for the beginning of OOB area)
 		 */
-		nand->controller->address(nand, 0x0);
-		if (oob_only)
-			nand->controller->address(nand, 0x8);
-		else
-			nand->controller->address(nand, 0x0);
+		cycles[n++] = 0x0;
+		cycles[n++] = oob_only ? 0x8 : 0x0;
 
 		/* row */
-		nand->controller->address(nand, page & 0xff);
-		nand->controller->address(nand, (page >> 8) & 0xff);
+		cycles[n++] = page & 0xff;
+		cycles[n++] = (page >> 8) & 0xff;
 
 		/* 5th cycle only on devices with more than 128 MiB */
 		if (nand->address_cycles >= 5)
-			nand->controller->address(nand, (page >> 16) & 0xff);
-
-		/* large page devices need a start command if reading */
-		if (NAND_CMD_READ0 == cmd)
-			nand->controller->command(nand, NAND_CMD_READSTART);
+			cycles[n++] = (page >> 16) & 0xff;
 	}
 
+	return n;
+}
+
+int nand_page_command(struct nand_device *nand, uint32_t page,
+	uint8_t cmd, bool oob_only)
+{
+	uint8_t cycles[6];
+	int i, n;
+
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+
+	if (oob_only && NAND_CMD_READ0 == cmd && nand->page_size <= 512)
+		cmd = NAND_CMD_READOOB;
+
+	nand->controller->command(nand, cmd);
+
+	n = nand_page_address(nand, page, oob_only, cycles);
+	for (i = 0; i < n; i++)
+		nand->controller->address(nand, cycles[i]);
+
+	/* large page devices need a start command if reading */
+	if (nand->page_size > 512 && NAND_CMD_READ0 == cmd)
+		nand->controller->command(nand, NAND_CMD_READSTART);
+
 	if (nand->controller->nand_ready) {
 		if (!nand->controller->nand_ready(nand, 100))
 			return ERROR_NAND_OPERATION_TIMEOUT;
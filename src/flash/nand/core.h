@@ -69,6 +69,8 @@ struct nand_device {
 	bool use_raw;
 	int num_blocks;
 	struct nand_block *blocks;
+	/** Manufacturer and device ID the block table was built for. */
+	uint16_t blocks_id;
 	struct nand_device *next;
 };
 
@@ -193,6 +195,8 @@ enum oob_formats {
 
 struct nand_device *get_nand_device_by_num(int num);
 
+int nand_page_address(struct nand_device *nand, uint32_t page,
+		      bool oob_only, uint8_t *cycles);
 int nand_page_command(struct nand_device *nand, uint32_t page,
 		      uint8_t cmd, bool oob_only);
 
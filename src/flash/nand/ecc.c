@@ -64,29 +64,66 @@ static const uint8_t nand_ecc_precalc_table[] = {
 	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00
 };
 
+/* Parity of a byte, bit 6 of its table entry */
+#define PARITY8(b)	((nand_ecc_precalc_table[(b)] >> 6) & 1)
+
+static inline unsigned parity64(uint64_t v)
+{
+	v ^= v >> 32;
+	v ^= v >> 16;
+	v ^= v >> 8;
+	return PARITY8(v & 0xff);
+}
+
 /*
  * nand_calculate_ecc - Calculate 3-byte ECC for 256-byte block
+ *
+ * The column parity is linear in the data, so it is looked up once for the
+ * XOR of all bytes.  Line parity bit k is the parity of all bytes whose
+ * index has bit k set: the block is read as 32 64-bit words, the three low
+ * index bits select a byte within the XOR of all words and the upper five
+ * select which words are folded into each of five accumulators.
  */
 int nand_calculate_ecc(struct nand_device *nand, const uint8_t *dat, uint8_t *ecc_code)
 {
 	uint8_t idx, reg1, reg2, reg3, tmp1, tmp2;
+	uint64_t word, all = 0, line[5] = { 0 };
+	uint8_t col[8], x = 0;
 	int i;
 
-	/* Initialize variables */
-	reg1 = reg2 = reg3 = 0;
+	for (i = 0; i < 32; i++) {
+		memcpy(&word, dat + i * 8, sizeof(word));
+		all ^= word;
+		if (i & 0x01)
+			line[0] ^= word;
+		if (i & 0x02)
+			line[1] ^= word;
+		if (i & 0x04)
+			line[2] ^= word;
+		if (i & 0x08)
+			line[3] ^= word;
+		if (i & 0x10)
+			line[4] ^= word;
+	}
 
-	/* Build up column parity */
-	for (i = 0; i < 256; i++) {
-		/* Get CP0 - CP5 from table */
-		idx = nand_ecc_precalc_table[*dat++];
-		reg1 ^= (idx & 0x3f);
+	/* Byte lanes of the XOR keep memory order whatever the host endianness */
+	memcpy(col, &all, sizeof(col));
 
-		/* All bit XOR = 1 ? */
-		if (idx & 0x40) {
-			reg3 ^= (uint8_t) i;
-			reg2 ^= ~((uint8_t) i);
-		}
+	reg3 = 0;
+	for (i = 0; i < 8; i++) {
+		x ^= col[i];
+		if (PARITY8(col[i]))
+			reg3 ^= i;
 	}
+	for (i = 0; i < 5; i++)
+		reg3 |= parity64(line[i]) << (i + 3);
+
+	/* Get CP0 - CP5 from table */
+	idx = nand_ecc_precalc_table[x];
+	reg1 = idx & 0x3f;
+
+	/* reg2 collects the inverted indexes, once per odd parity byte */
+	reg2 = (idx & 0x40) ? ~reg3 : reg3;
 
 	/* Create non-inverted ECC code from line parity */
 	tmp1  = (reg3 & 0x80) >> 0; /* B7 -> B7 */
@@ -34,5 +34,7 @@ int nand_read_page(struct nand_device *nand, uint32_t page,
 int nand_probe(struct nand_device *nand);
 int nand_erase(struct nand_device *nand, int first_block, int last_block);
 int nand_build_bbt(struct nand_device *nand, int first, int last);
+int nand_bbt_save(struct nand_device *nand, const char *filename);
+int nand_bbt_load(struct nand_device *nand, const char *filename);
 
 #endif /* OPENOCD_FLASH_NAND_IMP_H */
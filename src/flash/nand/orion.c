@@ -105,6 +105,39 @@ static int orion_nand_fast_block_write(struct nand_device *nand, uint8_t *data,
 	return retval;
 }
 
+static int orion_nand_write_page(struct nand_device *nand, uint32_t page,
+	uint8_t *data, uint32_t data_size, uint8_t *oob, uint32_t oob_size)
+{
+	struct orion_nand_controller *hw = nand->controller_priv;
+	struct target *target = nand->target;
+	uint8_t cycles[6];
+	uint8_t status;
+	int num_cycles;
+	int retval;
+
+	/* OOB only writes start at a different column, keep those simple */
+	if (!data)
+		return nand_write_page_raw(nand, page, data, data_size, oob, oob_size);
+
+	CHECK_HALTED;
+	hw->io.chunk_size = nand->page_size;
+	num_cycles = nand_page_address(nand, page, false, cycles);
+
+	retval = arm_nand_write_page(&hw->io, cycles, num_cycles,
+			data, data_size, oob, oob_size, &status);
+	if (retval == ERROR_NAND_NO_BUFFER)
+		return nand_write_page_raw(nand, page, data, data_size, oob, oob_size);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (status & NAND_STATUS_FAIL) {
+		LOG_ERROR("write operation didn't pass, status: 0x%2.2x", status);
+		return ERROR_NAND_OPERATION_FAILED;
+	}
+
+	return ERROR_OK;
+}
+
 static int orion_nand_reset(struct nand_device *nand)
 {
 	return orion_nand_command(nand, NAND_CMD_RESET);
@@ -137,6 +170,8 @@ NAND_DEVICE_COMMAND_HANDLER(orion_nand_device_command)
 
 	hw->io.target = nand->target;
 	hw->io.data = hw->data;
+	hw->io.cmd = hw->cmd;
+	hw->io.addr = hw->addr;
 	hw->io.op = ARM_NAND_NONE;
 
 	return ERROR_OK;
@@ -155,6 +190,7 @@ struct nand_flash_controller orion_nand_controller = {
 	.read_data = orion_nand_read,
 	.write_data = orion_nand_write,
 	.write_block_data = orion_nand_fast_block_write,
+	.write_page = orion_nand_write_page,
 	.reset = orion_nand_reset,
 	.nand_device_command = orion_nand_device_command,
 	.init = orion_nand_init,
@@ -240,6 +240,29 @@ COMMAND_HANDLER(handle_nand_check_bad_blocks_command)
 	return retval;
 }
 
+COMMAND_HANDLER(handle_nand_bbt_command)
+{
+	if (CMD_ARGC != 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct nand_device *p;
+	int retval = CALL_COMMAND_HANDLER(nand_command_get_device, 0, &p);
+	if (ERROR_OK != retval)
+		return retval;
+
+	if (strcmp(CMD_ARGV[1], "save") == 0)
+		retval = nand_bbt_save(p, CMD_ARGV[2]);
+	else if (strcmp(CMD_ARGV[1], "load") == 0)
+		retval = nand_bbt_load(p, CMD_ARGV[2]);
+	else
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (retval == ERROR_NAND_DEVICE_NOT_PROBED)
+		command_print(CMD_CTX, "probe the NAND flash device first");
+
+	return retval;
+}
+
 COMMAND_HANDLER(handle_nand_write_command)
 {
 	struct nand_device *nand = NULL;
@@ -431,6 +454,13 @@ static const struct command_registration nand_exec_command_handlers[] = {
 		.usage = "bank_id [offset length]",
 		.help = "check all or part of NAND flash device for bad blocks",
 	},
+	{
+		.name = "bbt",
+		.handler = handle_nand_bbt_command,
+		.mode = COMMAND_EXEC,
+		.usage = "bank_id ('save'|'load') filename",
+		.help = "save the bad block table to a file or restore it",
+	},
 	{
 		.name = "erase",
 		.handler = handle_nand_erase_command,
@@ -546,6 +576,8 @@ static COMMAND_HELPER(create_nand_device, const char *bank_name,
 	c->address_cycles = 0;
 	c->page_size = 0;
 	c->use_raw = false;
+	c->num_blocks = 0;
+	c->blocks = NULL;
 	c->next = NULL;
 
 	retval = CALL_COMMAND_HANDLER(controller->nand_device_command, c);
@@ -23,6 +23,7 @@
 #include "imp.h"
 #include "helper/binarybuffer.h"
 
+#include <target/algorithm.h>
 #include <target/cortex_m.h>
 
 #define SAMD_NUM_SECTORS	16
@@ -677,11 +678,109 @@ static int samd_erase(struct flash_bank *bank, int first, int last)
 				return res;
 			}
 		}
+		bank->sectors[s].is_erased = 1;
 	}
 
 	return ERROR_OK;
 }
 
+static const uint8_t samd_flash_write_code[] = {
+	/* See contrib/loaders/flash/at91samd/write.S */
+#include "../../../contrib/loaders/flash/at91samd/write.inc"
+};
+
+/* Program whole pages from a page aligned address with the loader, which
+ * fills the page buffer, issues WP and polls READY on the target.  With
+ * erase set the loader also erases each row it enters.  Without a working
+ * area ERROR_TARGET_RESOURCE_NOT_AVAILABLE is returned. */
+static int samd_write_block(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t address, uint32_t pages, bool erase)
+{
+	struct target *target = bank->target;
+	struct samd_info *chip = bank->driver_priv;
+	uint32_t buffer_pages = 16;
+	uint32_t nvm_ctrlb;
+	struct working_area *write_algorithm;
+	struct working_area *source;
+	struct reg_param reg_params[7];
+	struct armv7m_algorithm armv7m_info;
+	int retval, retval2;
+
+	retval = target_alloc_working_area_code(target, samd_flash_write_code,
+			sizeof(samd_flash_write_code), &write_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* the FIFO holds whole pages, the first two words are wp and rp */
+	while (target_alloc_working_area_try(target, 8 + buffer_pages * chip->page_size,
+			&source) != ERROR_OK) {
+		buffer_pages /= 2;
+		if (buffer_pages < 2) {
+			target_free_working_area(target, write_algorithm);
+			LOG_WARNING("no large enough working area available, can't do block memory writes");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	/* The loader always issues WP, so the page buffer must not be
+	 * written automatically when its last word is filled */
+	retval = target_read_u32(target, SAMD_NVMCTRL + SAMD_NVMCTRL_CTRLB, &nvm_ctrlb);
+	if (retval == ERROR_OK && !(nvm_ctrlb & SAMD_NVM_CTRLB_MANW))
+		retval = target_write_u32(target, SAMD_NVMCTRL + SAMD_NVMCTRL_CTRLB,
+				nvm_ctrlb | SAMD_NVM_CTRLB_MANW);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, source);
+		target_free_working_area(target, write_algorithm);
+		return retval;
+	}
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* NVMCTRL base (in), status (out) */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* page count */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* buffer start */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_IN_OUT);	/* target address */
+	init_reg_param(&reg_params[5], "r8", 32, PARAM_OUT);	/* page size */
+	init_reg_param(&reg_params[6], "r9", 32, PARAM_OUT);	/* row mask or 0 */
+
+	buf_set_u32(reg_params[0].value, 0, 32, SAMD_NVMCTRL);
+	buf_set_u32(reg_params[1].value, 0, 32, pages);
+	buf_set_u32(reg_params[2].value, 0, 32, source->address);
+	buf_set_u32(reg_params[3].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[4].value, 0, 32, address);
+	buf_set_u32(reg_params[5].value, 0, 32, chip->page_size);
+	buf_set_u32(reg_params[6].value, 0, 32, erase ? chip->page_size * 4 - 1 : 0);
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	retval = target_run_flash_async_algorithm(target, buffer, pages, chip->page_size,
+			0, NULL,
+			7, reg_params,
+			source->address, source->size,
+			write_algorithm->address, 0,
+			&armv7m_info);
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED) {
+		LOG_ERROR("%s: write failed at address 0x%08" PRIx32, __func__,
+				buf_get_u32(reg_params[4].value, 0, 32));
+		/* reports and clears the error bits */
+		samd_check_error(target);
+	}
+
+	if (!(nvm_ctrlb & SAMD_NVM_CTRLB_MANW)) {
+		retval2 = target_write_u32(target, SAMD_NVMCTRL + SAMD_NVMCTRL_CTRLB, nvm_ctrlb);
+		if (retval == ERROR_OK)
+			retval = retval2;
+	}
+
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
+
+	for (int i = 0; i < 7; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return retval;
+}
 
 static int samd_write(struct flash_bank *bank, const uint8_t *buffer,
 		uint32_t offset, uint32_t count)
@@ -695,6 +794,9 @@ static int samd_write(struct flash_bank *bank, const uint8_t *buffer,
 	struct samd_info *chip = (struct samd_info *)bank->driver_priv;
 	uint8_t *pb = NULL;
 	bool manual_wp;
+	uint32_t first, end, row_size;
+	bool erase;
+	int s;
 
 	if (bank->target->state != TARGET_HALTED) {
 		LOG_ERROR("Target not halted");
@@ -723,6 +825,37 @@ static int samd_write(struct flash_bank *bank, const uint8_t *buffer,
 		return res;
 	}
 
+	/* The loader takes whole pages.  Padding the first and last page with
+	 * 0xff leaves the flash outside the range unchanged, just like the
+	 * page by page path below. */
+	first = offset - offset % chip->page_size;
+	end = DIV_ROUND_UP(offset + count, chip->page_size) * chip->page_size;
+
+	/* Rows the data covers completely may be erased by the loader as it
+	 * goes, unless one of their sectors is already known to be blank */
+	row_size = chip->page_size * 4;
+	erase = offset % row_size == 0 && (offset + count) % row_size == 0;
+	for (s = offset / chip->sector_size;
+			s <= (int)((end - 1) / chip->sector_size) && s < bank->num_sectors; s++) {
+		if (bank->sectors[s].is_erased == 1)
+			erase = false;
+	}
+
+	pb = malloc(end - first);
+	if (!pb)
+		return ERROR_FAIL;
+	memset(pb, 0xff, end - first);
+	memcpy(pb + offset - first, buffer, count);
+
+	res = samd_write_block(bank, pb, bank->base + first,
+			(end - first) / chip->page_size, erase);
+	free(pb);
+	pb = NULL;
+	if (res != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		goto free_pb;
+
+	LOG_WARNING("no working area available, falling back to slow memory writes");
+
 	while (count) {
 		nb = chip->page_size - offset % chip->page_size;
 		if (count < nb)
@@ -799,6 +932,12 @@ free_pb:
 	if (pb)
 		free(pb);
 
+	if (res == ERROR_OK) {
+		for (s = first / chip->sector_size;
+				s <= (int)((end - 1) / chip->sector_size) && s < bank->num_sectors; s++)
+			bank->sectors[s].is_erased = 0;
+	}
+
 	return res;
 }
 
@@ -32,6 +32,7 @@
 #include <target/armv7m.h>
 #include <target/mips32.h>
 #include <helper/binarybuffer.h>
+#include <helper/time_support.h>
 #include <target/algorithm.h>
 
 #define CFI_MAX_BUS_WIDTH       4
@@ -977,6 +978,130 @@ static int cfi_erase(struct flash_bank *bank, int first, int last)
 	return ERROR_OK;
 }
 
+/* Issue the erase of one sector without waiting for it to complete */
+static int cfi_erase_issue(struct flash_bank *bank, int sector)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	int retval;
+
+	if (cfi_info->pri_id == 2) {
+		struct cfi_spansion_pri_ext *pri_ext = cfi_info->pri_ext;
+
+		retval = cfi_send_command(bank, 0xaa, flash_address(bank, 0, pri_ext->_unlock1));
+		if (retval == ERROR_OK)
+			retval = cfi_send_command(bank, 0x55, flash_address(bank, 0, pri_ext->_unlock2));
+		if (retval == ERROR_OK)
+			retval = cfi_send_command(bank, 0x80, flash_address(bank, 0, pri_ext->_unlock1));
+		if (retval == ERROR_OK)
+			retval = cfi_send_command(bank, 0xaa, flash_address(bank, 0, pri_ext->_unlock1));
+		if (retval == ERROR_OK)
+			retval = cfi_send_command(bank, 0x55, flash_address(bank, 0, pri_ext->_unlock2));
+		if (retval == ERROR_OK)
+			retval = cfi_send_command(bank, 0x30, flash_address(bank, sector, 0x0));
+	} else {
+		cfi_intel_clear_status_register(bank);
+		retval = cfi_send_command(bank, 0x20, flash_address(bank, sector, 0x0));
+		if (retval == ERROR_OK)
+			retval = cfi_send_command(bank, 0xd0, flash_address(bank, sector, 0x0));
+	}
+
+	cfi_info->erase_deadline = timeval_ms() + cfi_info->block_erase_timeout;
+	return retval;
+}
+
+/* Background erase for erase-ahead scheduling: start on the first sector
+ * and let cfi_erase_poll() walk through the rest. Each chip has its own
+ * state machine, so banks proceed independently of each other. */
+static int cfi_erase_start(struct flash_bank *bank, int first, int last)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+
+	if (bank->target->state != TARGET_HALTED) {
+		LOG_ERROR("Target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	if ((first < 0) || (last < first) || (last >= bank->num_sectors))
+		return ERROR_FLASH_SECTOR_INVALID;
+
+	if (cfi_info->qry[0] != 'Q')
+		return ERROR_FLASH_BANK_NOT_PROBED;
+
+	if (cfi_info->pri_id != 1 && cfi_info->pri_id != 2 && cfi_info->pri_id != 3)
+		return ERROR_FLASH_OPER_UNSUPPORTED;
+
+	cfi_info->erase_next = first;
+	cfi_info->erase_last = last;
+
+	return cfi_erase_issue(bank, first);
+}
+
+static int cfi_erase_poll(struct flash_bank *bank)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	uint8_t status, oldstatus;
+	bool busy;
+	bool failed = false;
+	int retval;
+
+	if (cfi_info->erase_next > cfi_info->erase_last)
+		return ERROR_OK;
+
+	if (cfi_info->pri_id == 2) {
+		/* DQ6 toggles while busy, DQ5 flags an internal timeout */
+		retval = cfi_get_u8(bank, 0, 0x0, &oldstatus);
+		if (retval == ERROR_OK)
+			retval = cfi_get_u8(bank, 0, 0x0, &status);
+		if (retval != ERROR_OK)
+			return retval;
+		busy = (status ^ oldstatus) & 0x40;
+		if (busy && (status & cfi_info->status_poll_mask & 0x20)) {
+			retval = cfi_get_u8(bank, 0, 0x0, &oldstatus);
+			if (retval == ERROR_OK)
+				retval = cfi_get_u8(bank, 0, 0x0, &status);
+			if (retval != ERROR_OK)
+				return retval;
+			busy = false;
+			failed = (status ^ oldstatus) & 0x40;
+		}
+	} else {
+		retval = cfi_get_u8(bank, 0, 0x0, &status);
+		if (retval != ERROR_OK)
+			return retval;
+		busy = !(status & 0x80);
+		failed = !busy && (status & 0xfe) != 0x80;
+	}
+
+	if (busy && timeval_ms() > cfi_info->erase_deadline) {
+		LOG_ERROR("timeout, status: 0x%x", status);
+		failed = true;
+	} else if (busy) {
+		return ERROR_FLASH_BUSY;
+	}
+
+	if (failed) {
+		LOG_ERROR("couldn't erase block %i of flash bank at base 0x%" PRIx32,
+			cfi_info->erase_next, bank->base);
+		if (cfi_info->pri_id != 2)
+			cfi_intel_clear_status_register(bank);
+		cfi_info->erase_next = cfi_info->erase_last + 1;
+		cfi_reset(bank);
+		return ERROR_FLASH_OPERATION_FAILED;
+	}
+
+	bank->sectors[cfi_info->erase_next++].is_erased = 1;
+	if (cfi_info->erase_next <= cfi_info->erase_last) {
+		retval = cfi_erase_issue(bank, cfi_info->erase_next);
+		if (retval != ERROR_OK) {
+			cfi_info->erase_next = cfi_info->erase_last + 1;
+			return retval;
+		}
+		return ERROR_FLASH_BUSY;
+	}
+
+	return cfi_reset(bank);
+}
+
 static int cfi_intel_protect(struct flash_bank *bank, int set, int first, int last)
 {
 	int retval;
@@ -1982,6 +2107,203 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 	return retval;
 }
 
+/* Buffered programming driven by a resident loader that is fed from an
+ * async fifo, so the host keeps streaming data while the target loads
+ * write buffers and polls for completion. Cortex-M only for now, the
+ * other cores lack async algorithm support. */
+static int cfi_write_block_async(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t address, uint32_t count)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	struct target *target = bank->target;
+	struct reg_param reg_params[10];
+	struct armv7m_algorithm armv7m_info;
+	struct working_area *write_algorithm;
+	struct working_area *source;
+	uint32_t buffer_size = 32768;
+	int num_params;
+	int retval;
+
+	/* see contrib/loaders/flash/cfi for src */
+	static const uint8_t span_buffer_write_8_code[] = {
+#include "../../../contrib/loaders/flash/cfi/span_buffer_write_8.inc"
+	};
+	static const uint8_t span_buffer_write_16_code[] = {
+#include "../../../contrib/loaders/flash/cfi/span_buffer_write_16.inc"
+	};
+	static const uint8_t span_buffer_write_32_code[] = {
+#include "../../../contrib/loaders/flash/cfi/span_buffer_write_32.inc"
+	};
+	static const uint8_t intel_buffer_write_8_code[] = {
+#include "../../../contrib/loaders/flash/cfi/intel_buffer_write_8.inc"
+	};
+	static const uint8_t intel_buffer_write_16_code[] = {
+#include "../../../contrib/loaders/flash/cfi/intel_buffer_write_16.inc"
+	};
+	static const uint8_t intel_buffer_write_32_code[] = {
+#include "../../../contrib/loaders/flash/cfi/intel_buffer_write_32.inc"
+	};
+
+	if (!is_arm(target_to_arm(target)) || !is_armv7m(target_to_armv7m(target)))
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (cfi_info->buf_write_timeout_typ == 0 || cfi_info->max_buf_write_size == 0)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (count == 0)
+		return ERROR_OK;
+
+	/* buffersize is (buffer size per chip) * (number of chips) */
+	uint32_t buffersize =
+		(1UL << cfi_info->max_buf_write_size) * (bank->bus_width / bank->chip_width);
+	uint32_t bufferwsize = buffersize / bank->bus_width;
+
+	const uint8_t *code;
+	size_t code_size;
+
+	switch (cfi_info->pri_id) {
+		case 1:
+		case 3:
+			switch (bank->bus_width) {
+				case 1:
+					code = intel_buffer_write_8_code;
+					code_size = sizeof(intel_buffer_write_8_code);
+					break;
+				case 2:
+					code = intel_buffer_write_16_code;
+					code_size = sizeof(intel_buffer_write_16_code);
+					break;
+				case 4:
+					code = intel_buffer_write_32_code;
+					code_size = sizeof(intel_buffer_write_32_code);
+					break;
+				default:
+					return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			}
+			break;
+		case 2:
+			switch (bank->bus_width) {
+				case 1:
+					code = span_buffer_write_8_code;
+					code_size = sizeof(span_buffer_write_8_code);
+					break;
+				case 2:
+					code = span_buffer_write_16_code;
+					code_size = sizeof(span_buffer_write_16_code);
+					break;
+				case 4:
+					code = span_buffer_write_32_code;
+					code_size = sizeof(span_buffer_write_32_code);
+					break;
+				default:
+					return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			}
+			break;
+		default:
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	if (target_alloc_working_area(target, code_size, &write_algorithm) != ERROR_OK) {
+		LOG_DEBUG("no working area for buffered write loader");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	retval = target_write_buffer(target, write_algorithm->address, code_size, code);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return retval;
+	}
+
+	/* the loader waits for a whole write buffer to be queued, so the
+	 * fifo must comfortably hold a couple of them */
+	while (target_alloc_working_area_try(target, buffer_size, &source) != ERROR_OK) {
+		buffer_size /= 2;
+		if (buffer_size < 4 * buffersize + 8) {
+			target_free_working_area(target, write_algorithm);
+			LOG_DEBUG("no large enough working area for buffered write fifo");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);	/* fifo start */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* fifo end */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN_OUT);	/* flash address */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_IN_OUT);	/* bus words */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);	/* write buffer words */
+
+	buf_set_u32(reg_params[0].value, 0, 32, source->address);
+	buf_set_u32(reg_params[1].value, 0, 32, source->address + buffer_size);
+	buf_set_u32(reg_params[2].value, 0, 32, address);
+	buf_set_u32(reg_params[3].value, 0, 32, count / bank->bus_width);
+	buf_set_u32(reg_params[4].value, 0, 32, bufferwsize);
+
+	if (cfi_info->pri_id == 2) {
+		struct cfi_spansion_pri_ext *pri_ext = cfi_info->pri_ext;
+
+		init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);	/* DQ7 mask */
+		init_reg_param(&reg_params[6], "r6", 32, PARAM_OUT);	/* DQ5 mask */
+		init_reg_param(&reg_params[7], "r7", 32, PARAM_OUT);	/* unlock1 */
+		init_reg_param(&reg_params[8], "r8", 32, PARAM_OUT);	/* unlock2 */
+		init_reg_param(&reg_params[9], "r9", 32, PARAM_OUT);	/* command multiplier */
+		num_params = 10;
+
+		buf_set_u32(reg_params[5].value, 0, 32, cfi_command_val(bank, 0x80));
+		buf_set_u32(reg_params[6].value, 0, 32,
+			(cfi_info->status_poll_mask & (1 << 5)) ? cfi_command_val(bank, 0x20) : 0);
+		buf_set_u32(reg_params[7].value, 0, 32, flash_address(bank, 0, pri_ext->_unlock1));
+		buf_set_u32(reg_params[8].value, 0, 32, flash_address(bank, 0, pri_ext->_unlock2));
+		buf_set_u32(reg_params[9].value, 0, 32, cfi_command_val(bank, 0x01));
+	} else {
+		init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);	/* ready pattern */
+		init_reg_param(&reg_params[6], "r6", 32, PARAM_OUT);	/* error pattern */
+		init_reg_param(&reg_params[7], "r7", 32, PARAM_OUT);	/* command multiplier */
+		num_params = 8;
+
+		buf_set_u32(reg_params[5].value, 0, 32, cfi_command_val(bank, 0x80));
+		buf_set_u32(reg_params[6].value, 0, 32, cfi_command_val(bank, 0x7e));
+		buf_set_u32(reg_params[7].value, 0, 32, cfi_command_val(bank, 0x01));
+
+		cfi_intel_clear_status_register(bank);
+	}
+
+	LOG_DEBUG("buffered write of 0x%" PRIx32 " bytes at 0x%08" PRIx32
+		" using fifo at 0x%08" PRIx32 " size 0x%" PRIx32,
+		count, address, source->address, buffer_size);
+
+	retval = target_run_flash_async_algorithm(target, buffer, count / bank->bus_width,
+			bank->bus_width,
+			0, NULL,
+			num_params, reg_params,
+			source->address, buffer_size,
+			write_algorithm->address, 0,
+			&armv7m_info);
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED) {
+		LOG_ERROR("buffered write failed around 0x%08" PRIx32 " (%" PRIu32 " words left)",
+			(uint32_t)buf_get_u32(reg_params[2].value, 0, 32),
+			(uint32_t)buf_get_u32(reg_params[3].value, 0, 32));
+
+		if (cfi_info->pri_id == 2) {
+			cfi_send_command(bank, 0xf0, flash_address(bank, 0, 0x0));
+		} else {
+			uint8_t status;
+			cfi_intel_wait_status_busy(bank, 100, &status);
+			cfi_intel_clear_status_register(bank);
+		}
+	}
+
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
+
+	for (int i = 0; i < num_params; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return retval;
+}
+
 static int cfi_intel_write_word(struct flash_bank *bank, uint8_t *word, uint32_t address)
 {
 	int retval;
@@ -2395,19 +2717,23 @@ static int cfi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t of
 
 	/* handle blocks of bus_size aligned bytes */
 	blk_count = count & ~(bank->bus_width - 1);	/* round down, leave tail bytes */
-	switch (cfi_info->pri_id) {
-		/* try block writes (fails without working area) */
-		case 1:
-		case 3:
-			retval = cfi_intel_write_block(bank, buffer, write_p, blk_count);
-			break;
-		case 2:
-			retval = cfi_spansion_write_block(bank, buffer, write_p, blk_count);
-			break;
-		default:
-			LOG_ERROR("cfi primary command set %i unsupported", cfi_info->pri_id);
-			retval = ERROR_FLASH_OPERATION_FAILED;
-			break;
+	/* try streaming buffered writes first, then block writes (both fail
+	 * without working area) */
+	retval = cfi_write_block_async(bank, buffer, write_p, blk_count);
+	if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+		switch (cfi_info->pri_id) {
+			case 1:
+			case 3:
+				retval = cfi_intel_write_block(bank, buffer, write_p, blk_count);
+				break;
+			case 2:
+				retval = cfi_spansion_write_block(bank, buffer, write_p, blk_count);
+				break;
+			default:
+				LOG_ERROR("cfi primary command set %i unsupported", cfi_info->pri_id);
+				retval = ERROR_FLASH_OPERATION_FAILED;
+				break;
+		}
 	}
 	if (retval == ERROR_OK) {
 		/* Increment pointers and decrease count on succesful block write */
@@ -3118,7 +3444,10 @@ static void cfi_fixup_0002_write_buffer(struct flash_bank *bank, const void *par
 struct flash_driver cfi_flash = {
 	.name = "cfi",
 	.flash_bank_command = cfi_flash_bank_command,
+	.flags = FLASH_DRIVER_INDEPENDENT_BANKS,
 	.erase = cfi_erase,
+	.erase_start = cfi_erase_start,
+	.erase_poll = cfi_erase_poll,
 	.protect = cfi_protect,
 	.write = cfi_write,
 	.read = cfi_read,
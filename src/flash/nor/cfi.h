@@ -73,6 +73,11 @@ struct cfi_flash_bank {
 	unsigned buf_write_timeout;
 	unsigned block_erase_timeout;
 	unsigned chip_erase_timeout;
+
+	/* background erase state, see cfi_erase_start() */
+	int erase_next;
+	int erase_last;
+	int64_t erase_deadline;
 };
 
 /* Intel primary extended query table
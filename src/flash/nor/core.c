@@ -26,6 +26,7 @@
 #include <flash/nor/core.h>
 #include <flash/nor/imp.h>
 #include <target/image.h>
+#include <target/algorithm.h>
 
 /**
  * @file
@@ -36,6 +37,21 @@
 
 static struct flash_bank *flash_banks;
 
+/* largest run of image data buffered on the host at once */
+#define FLASH_WRITE_WINDOW	(1024 * 1024)
+
+/* while another bank erases in the background, program in pieces of at
+ * least this size so its erase can be advanced between them */
+#define FLASH_ERASE_AHEAD_CHUNK	(64 * 1024)
+
+/* a range of a bank that is being (or has been) erased in the background */
+struct flash_erase_ahead {
+	struct flash_bank *bank;
+	uint32_t start;
+	uint32_t end;
+	bool busy;
+};
+
 int flash_driver_erase(struct flash_bank *bank, int first, int last)
 {
 	int retval;
@@ -83,6 +99,7 @@ int flash_driver_write(struct flash_bank *bank,
 {
 	int retval;
 
+	bank->write_verified = false;
 	retval = bank->driver->write(bank, buffer, offset, count);
 	if (retval != ERROR_OK) {
 		LOG_ERROR(
@@ -112,6 +129,54 @@ int flash_driver_read(struct flash_bank *bank,
 	return retval;
 }
 
+/**
+ * Reads back a bank range to be compared with @a expected.  Sectors of a
+ * memory mapped bank are first checked with one target CRC each; where it
+ * matches, @a expected is copied instead of reading the sector back over
+ * the debug link, so only differing sectors are transferred.
+ */
+int flash_driver_read_verify(struct flash_bank *bank, uint8_t *buffer,
+	const uint8_t *expected, uint32_t offset, uint32_t count)
+{
+	uint32_t end = offset + count;
+	int retval;
+	int i;
+
+	if (bank->driver->read != default_flash_read || bank->num_sectors == 0)
+		return flash_driver_read(bank, buffer, offset, count);
+
+	for (i = 0; i < bank->num_sectors && offset < end; i++) {
+		uint32_t sector_end = bank->sectors[i].offset + bank->sectors[i].size;
+		uint32_t start = offset;
+		uint32_t stop = MIN(sector_end, end);
+		uint32_t image_crc, flash_crc;
+
+		if (sector_end <= offset)
+			continue;
+
+		retval = image_calculate_checksum(expected, stop - start, &image_crc);
+		if (retval == ERROR_OK)
+			retval = target_checksum_memory(bank->target, bank->base + start,
+					stop - start, &flash_crc);
+		if (retval != ERROR_OK || image_crc != flash_crc) {
+			retval = flash_driver_read(bank, buffer, start, stop - start);
+			if (retval != ERROR_OK)
+				return retval;
+		} else
+			memcpy(buffer, expected, stop - start);
+
+		buffer += stop - start;
+		expected += stop - start;
+		offset = stop;
+	}
+
+	/* anything past the last sector */
+	if (offset < end)
+		return flash_driver_read(bank, buffer, offset, end - offset);
+
+	return ERROR_OK;
+}
+
 int default_flash_read(struct flash_bank *bank,
 	uint8_t *buffer, uint32_t offset, uint32_t count)
 {
@@ -276,8 +341,8 @@ static int default_flash_mem_blank_check(struct flash_bank *bank)
 		for (j = 0; j < bank->sectors[i].size; j += buffer_size) {
 			uint32_t chunk;
 			chunk = buffer_size;
-			if (chunk > (j - bank->sectors[i].size))
-				chunk = (j - bank->sectors[i].size);
+			if (chunk > (bank->sectors[i].size - j))
+				chunk = (bank->sectors[i].size - j);
 
 			retval = target_read_memory(target,
 					bank->base + bank->sectors[i].offset + j,
@@ -302,6 +367,40 @@ done:
 	return retval;
 }
 
+/* check all sectors with as few algorithm runs as the target allows */
+static int flash_blank_check_blocks(struct flash_bank *bank)
+{
+	struct target_memory_check_block *blocks;
+	int i;
+	int retval = ERROR_OK;
+
+	blocks = malloc(sizeof(*blocks) * bank->num_sectors);
+	if (blocks == NULL)
+		return ERROR_FAIL;
+
+	for (i = 0; i < bank->num_sectors; i++) {
+		blocks[i].address = bank->base + bank->sectors[i].offset;
+		blocks[i].size = bank->sectors[i].size;
+	}
+
+	for (i = 0; i < bank->num_sectors; ) {
+		retval = target_blank_check_memory_blocks(bank->target,
+				blocks + i, bank->num_sectors - i, 0xff);
+		if (retval < 1)
+			break;
+		i += retval;
+		retval = ERROR_OK;
+	}
+
+	if (retval == ERROR_OK)
+		for (i = 0; i < bank->num_sectors; i++)
+			bank->sectors[i].is_erased = blocks[i].result ? 1 : 0;
+
+	free(blocks);
+
+	return retval;
+}
+
 int default_flash_blank_check(struct flash_bank *bank)
 {
 	struct target *target = bank->target;
@@ -315,6 +414,9 @@ int default_flash_blank_check(struct flash_bank *bank)
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
+	if (bank->num_sectors > 0 && flash_blank_check_blocks(bank) == ERROR_OK)
+		return ERROR_OK;
+
 	for (i = 0; i < bank->num_sectors; i++) {
 		uint32_t address = bank->base + bank->sectors[i].offset;
 		uint32_t size = bank->sectors[i].size;
@@ -339,6 +441,94 @@ int default_flash_blank_check(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
+int flash_write_block_pingpong(struct flash_bank *bank,
+		const uint8_t *buffer, uint32_t address, uint32_t count,
+		uint32_t block_size, uint32_t align,
+		int num_reg_params, struct reg_param *reg_params,
+		flash_pingpong_setup_t setup,
+		uint32_t entry_point, uint32_t exit_point, int timeout_ms,
+		void *arch_info)
+{
+	struct target *target = bank->target;
+	struct working_area *source[2] = { NULL, NULL };
+	bool running = false;
+	int current = 0;
+	int retval = ERROR_OK;
+
+	if (align == 0)
+		align = 1;
+
+	/* two staging buffers, shrunk together until both fit; smaller
+	 * ones would be dominated by the per-run algorithm overhead */
+	block_size -= block_size % align;
+	while (block_size >= MAX(align, 256u)) {
+		if (target_alloc_working_area_try(target, block_size, &source[0]) == ERROR_OK) {
+			if (target_alloc_working_area_try(target, block_size, &source[1]) == ERROR_OK)
+				break;
+			target_free_working_area(target, source[0]);
+			source[0] = NULL;
+		}
+		block_size /= 2;
+		block_size -= block_size % align;
+	}
+	if (source[1] == NULL) {
+		LOG_WARNING("no working area for flash staging buffers");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	while (count > 0 || running) {
+		uint32_t thisrun = MIN(count, block_size);
+
+		/* stage the next block while the previous one is programmed */
+		if (thisrun > 0) {
+			retval = target_write_buffer(target, source[current]->address,
+					thisrun, buffer);
+			if (retval != ERROR_OK)
+				break;
+		}
+
+		if (running) {
+			running = false;
+			retval = target_wait_algorithm(target, 0, NULL,
+					num_reg_params, reg_params, exit_point,
+					timeout_ms, arch_info);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("error executing flash programming algorithm");
+				retval = ERROR_FLASH_OPERATION_FAILED;
+				break;
+			}
+		}
+
+		if (thisrun == 0)
+			break;
+
+		setup(bank, reg_params, source[current]->address, address, thisrun);
+		retval = target_start_algorithm(target, 0, NULL,
+				num_reg_params, reg_params, entry_point, exit_point,
+				arch_info);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error starting flash programming algorithm");
+			break;
+		}
+		running = true;
+
+		buffer += thisrun;
+		address += thisrun;
+		count -= thisrun;
+		current ^= 1;
+	}
+
+	/* don't leave the algorithm running after an error */
+	if (running)
+		target_wait_algorithm(target, 0, NULL, num_reg_params, reg_params,
+				exit_point, timeout_ms, arch_info);
+
+	target_free_working_area(target, source[1]);
+	target_free_working_area(target, source[0]);
+
+	return retval;
+}
+
 /* Manipulate given flash region, selecting the bank according to target
  * and address.  Maps an address range to a set of sectors, and issues
  * the callback() on that set ... e.g. to erase or unprotect its members.
@@ -538,15 +728,296 @@ static int compare_section(const void *a, const void *b)
 		return -1;
 }
 
+static bool flash_bank_erases_independently(struct flash_bank *bank)
+{
+	return (bank->driver->flags & FLASH_DRIVER_INDEPENDENT_BANKS) &&
+		bank->driver->erase_start && bank->driver->erase_poll;
+}
+
+/* advance a background erase once; clears ahead->busy when it is over */
+static int flash_erase_ahead_poll(struct flash_erase_ahead *ahead)
+{
+	if (!ahead->busy)
+		return ERROR_OK;
+
+	int retval = ahead->bank->driver->erase_poll(ahead->bank);
+	if (retval == ERROR_FLASH_BUSY)
+		return ERROR_OK;
+
+	ahead->busy = false;
+	if (retval != ERROR_OK)
+		LOG_ERROR("background erase of 0x%8.8" PRIx32 "..0x%8.8" PRIx32 " failed",
+			ahead->start, ahead->end - 1);
+	return retval;
+}
+
+static int flash_erase_ahead_wait(struct flash_erase_ahead *ahead)
+{
+	int retval = ERROR_OK;
+
+	while (ahead->busy) {
+		retval = flash_erase_ahead_poll(ahead);
+		if (retval != ERROR_OK)
+			break;
+		if (ahead->busy)
+			alive_sleep(1);
+	}
+
+	return retval;
+}
+
+/* Look for the first image section from @a section on that lands in a
+ * bank other than @a c which can erase in the background, and start
+ * erasing the sectors covering it and the sections following it in the
+ * same bank. */
+static int flash_erase_ahead_start(struct target *target,
+	struct imagesection **sections, int num_sections, int section,
+	uint32_t section_offset, struct flash_bank *c, bool unlock,
+	struct flash_erase_ahead *ahead, struct flash_erase_ahead *erased)
+{
+	struct flash_bank *b = NULL;
+	uint32_t start = 0, end;
+	int first = -1, last = -1;
+	int retval;
+	int i;
+
+	for (; section < num_sections; section++, section_offset = 0) {
+		if (sections[section]->size == 0)
+			continue;
+		start = sections[section]->base_address + section_offset;
+		retval = get_flash_bank_by_addr(target, start, false, &b);
+		if (retval != ERROR_OK)
+			return retval;
+		if (b != NULL && b != c)
+			break;
+	}
+	if (section >= num_sections || b == ahead->bank || b == erased->bank ||
+			!flash_bank_erases_independently(b) || b->num_sectors == 0)
+		return ERROR_OK;
+
+	end = sections[section]->base_address + sections[section]->size;
+	while (section + 1 < num_sections &&
+			sections[section + 1]->base_address < b->base + b->size) {
+		section++;
+		end = MAX(end, sections[section]->base_address + sections[section]->size);
+	}
+	if (end > b->base + b->size)
+		end = b->base + b->size;
+
+	for (i = 0; i < b->num_sectors; i++) {
+		uint32_t sector_start = b->base + b->sectors[i].offset;
+		uint32_t sector_end = sector_start + b->sectors[i].size;
+		if (first < 0 && start < sector_end)
+			first = i;
+		if (first >= 0 && sector_start < end)
+			last = i;
+	}
+	if (first < 0 || last < first)
+		return ERROR_OK;
+
+	start = b->base + b->sectors[first].offset;
+	end = b->base + b->sectors[last].offset + b->sectors[last].size;
+
+	if (unlock) {
+		retval = flash_unlock_address_range(target, start, end - start);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	retval = b->driver->erase_start(b, first, last);
+	if (retval == ERROR_FLASH_OPER_UNSUPPORTED)
+		return ERROR_OK;
+	if (retval != ERROR_OK) {
+		LOG_ERROR("failed starting erase of sectors %d to %d", first, last);
+		return retval;
+	}
+
+	LOG_DEBUG("erasing 0x%8.8" PRIx32 "..0x%8.8" PRIx32 " in the background",
+		start, end - 1);
+
+	ahead->bank = b;
+	ahead->start = start;
+	ahead->end = end;
+	ahead->busy = true;
+
+	return ERROR_OK;
+}
+
+/* unlock, erase and program one contiguous run as requested; while
+ * @a ahead erases another bank, program in pieces and advance it */
+/* Compare the CRC of a run just written against the flash contents */
+static int flash_verify_run(struct target *target, const uint8_t *buffer,
+	uint32_t run_address, uint32_t run_size)
+{
+	uint32_t image_crc, flash_crc;
+
+	int retval = image_calculate_checksum(buffer, run_size, &image_crc);
+	if (retval == ERROR_OK)
+		retval = target_checksum_memory(target, run_address, run_size, &flash_crc);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (image_crc != flash_crc) {
+		LOG_ERROR("verify failed, flash at 0x%8.8" PRIx32 "..0x%8.8" PRIx32
+				" differs from the image", run_address, run_address + run_size - 1);
+		return ERROR_FLASH_OPERATION_FAILED;
+	}
+
+	return ERROR_OK;
+}
+
+static int flash_write_run(struct target *target, struct flash_bank *c,
+	uint8_t *buffer, uint32_t run_address, uint32_t run_size,
+	int erase, bool unlock, bool verify, struct flash_erase_ahead *ahead)
+{
+	int retval = ERROR_OK;
+
+	if (unlock)
+		retval = flash_unlock_address_range(target, run_address, run_size);
+	if (retval == ERROR_OK) {
+		if (erase) {
+			/* calculate and erase sectors */
+			retval = flash_erase_address_range(target,
+					true, run_address, run_size);
+		}
+	}
+
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (ahead == NULL || !ahead->busy) {
+		/* write flash sectors */
+		retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
+		if (retval == ERROR_OK && verify && !c->write_verified)
+			retval = flash_verify_run(target, buffer, run_address, run_size);
+		return retval;
+	}
+
+	uint8_t *run_buffer = buffer;
+	uint32_t offset = run_address - c->base;
+	uint32_t end = offset + run_size;
+	bool verified = true;
+
+	while (offset < end) {
+		uint32_t chunk_end = end;
+		int i;
+
+		/* stop each piece on a sector boundary */
+		for (i = 0; i < c->num_sectors; i++) {
+			uint32_t sector_end = c->sectors[i].offset + c->sectors[i].size;
+			if (sector_end >= offset + FLASH_ERASE_AHEAD_CHUNK) {
+				chunk_end = MIN(end, sector_end);
+				break;
+			}
+		}
+
+		retval = flash_driver_write(c, buffer, offset, chunk_end - offset);
+		if (retval != ERROR_OK)
+			return retval;
+		verified = verified && c->write_verified;
+
+		retval = flash_erase_ahead_poll(ahead);
+		if (retval != ERROR_OK)
+			return retval;
+
+		buffer += chunk_end - offset;
+		offset = chunk_end;
+	}
+
+	if (verify && !verified)
+		return flash_verify_run(target, run_buffer, run_address, run_size);
+
+	return ERROR_OK;
+}
+
+/* Compare the CRC of every sector a run touches against the flash
+ * contents, and only write the groups of sectors that differ. */
+static int flash_write_run_incremental(struct target *target,
+	struct flash_bank *c, uint8_t *buffer, uint32_t run_address,
+	uint32_t run_size, int erase, bool unlock, bool verify, uint32_t *written,
+	int *sectors_skipped, int *sectors_written)
+{
+	uint32_t run_end = run_address + run_size;
+	uint32_t dirty_start = 0;
+	uint32_t dirty_end = 0;
+	int retval = ERROR_OK;
+	int i;
+
+	for (i = 0; i <= c->num_sectors; i++) {
+		uint32_t start = run_end;
+		uint32_t end = run_end;
+		bool differs = false;
+
+		if (i < c->num_sectors) {
+			start = c->base + c->sectors[i].offset;
+			end = start + c->sectors[i].size;
+			if (end <= run_address)
+				continue;
+			if (start >= run_end)
+				start = end = run_end;
+		}
+		if (start < run_address)
+			start = run_address;
+		if (end > run_end)
+			end = run_end;
+
+		if (start < end) {
+			uint32_t image_crc, flash_crc;
+
+			retval = image_calculate_checksum(buffer + (start - run_address),
+					end - start, &image_crc);
+			if (retval == ERROR_OK)
+				retval = target_checksum_memory(target, start,
+						end - start, &flash_crc);
+			if (retval != ERROR_OK)
+				return retval;
+
+			differs = image_crc != flash_crc;
+			if (differs)
+				(*sectors_written)++;
+			else
+				(*sectors_skipped)++;
+		}
+
+		if (differs) {
+			if (dirty_start == dirty_end)
+				dirty_start = start;
+			dirty_end = end;
+			continue;
+		}
+
+		/* an unchanged sector or the end of the run closes a dirty group */
+		if (dirty_start != dirty_end) {
+			retval = flash_write_run(target, c,
+					buffer + (dirty_start - run_address), dirty_start,
+					dirty_end - dirty_start, erase, unlock, verify, NULL);
+			if (retval != ERROR_OK)
+				return retval;
+			if (written != NULL)
+				*written += dirty_end - dirty_start;
+			dirty_start = dirty_end;
+		}
+
+		if (start >= run_end)
+			break;
+	}
+
+	return retval;
+}
+
 int flash_write_unlock(struct target *target, struct image *image,
-	uint32_t *written, int erase, bool unlock)
+	uint32_t *written, int erase, bool unlock, bool incremental, bool verify)
 {
 	int retval = ERROR_OK;
+	int sectors_skipped = 0;
+	int sectors_written = 0;
 
 	int section;
 	uint32_t section_offset;
 	struct flash_bank *c;
 	int *padding;
+	struct flash_erase_ahead ahead = { .bank = NULL };
+	struct flash_erase_ahead erased = { .bank = NULL };
 
 	section = 0;
 	section_offset = 0;
@@ -635,6 +1106,7 @@ int flash_write_unlock(struct target *target, struct image *image,
 			padding[section_last] = pad_bytes;
 			run_size += sections[++section_last]->size;
 			run_size += pad_bytes;
+			padding[section_last] = 0;
 
 			if (pad_bytes > 0)
 				LOG_INFO("Padding image section %d with %d bytes",
@@ -655,7 +1127,7 @@ int flash_write_unlock(struct target *target, struct image *image,
 		/* If we're applying any sector automagic, then pad this
 		 * (maybe-combined) segment to the end of its last sector.
 		 */
-		if (unlock || erase) {
+		if (unlock || erase || incremental) {
 			int sector;
 			uint32_t offset_start = run_address - c->base;
 			uint32_t offset_end = offset_start + run_size;
@@ -673,6 +1145,28 @@ int flash_write_unlock(struct target *target, struct image *image,
 			run_size += delta;
 		}
 
+		/* Bound the host buffer for large images: stop long runs at the
+		 * last sector boundary within FLASH_WRITE_WINDOW bytes. The rest
+		 * of the image data is picked up as the next run. */
+		if (run_size > FLASH_WRITE_WINDOW) {
+			int sector;
+			uint32_t offset_start = run_address - c->base;
+			uint32_t cut = 0;
+
+			for (sector = 0; sector < c->num_sectors; sector++) {
+				uint32_t end = c->sectors[sector].offset
+					+ c->sectors[sector].size;
+				if (end <= offset_start)
+					continue;
+				if (end > offset_start + FLASH_WRITE_WINDOW)
+					break;
+				cut = end;
+			}
+
+			if (cut > offset_start)
+				run_size = cut - offset_start;
+		}
+
 		/* allocate buffer */
 		buffer = malloc(run_size);
 		if (buffer == NULL) {
@@ -709,9 +1203,17 @@ int flash_write_unlock(struct target *target, struct image *image,
 				goto done;
 			}
 
-			/* see if we need to pad the section */
-			while (padding[section]--)
-				(buffer + buffer_size)[size_read++] = c->default_padded_value;
+			/* see if we need to pad the section; a gap cut short by the
+			 * end of the run is skipped since the next run starts at the
+			 * following section */
+			if (section_offset + size_read >= sections[section]->size &&
+					padding[section] > 0) {
+				uint32_t pad = MIN((uint32_t)padding[section],
+						run_size - buffer_size - size_read);
+				memset(buffer + buffer_size + size_read,
+						c->default_padded_value, pad);
+				size_read += pad;
+			}
 
 			buffer_size += size_read;
 			section_offset += size_read;
@@ -722,23 +1224,50 @@ int flash_write_unlock(struct target *target, struct image *image,
 			}
 		}
 
-		retval = ERROR_OK;
+		if (incremental && c->num_sectors > 0) {
+			retval = flash_write_run_incremental(target, c, buffer,
+					run_address, run_size, erase, unlock, verify, written,
+					&sectors_skipped, &sectors_written);
+			free(buffer);
+			if (retval != ERROR_OK)
+				goto done;
+			continue;
+		}
 
-		if (unlock)
-			retval = flash_unlock_address_range(target, run_address, run_size);
-		if (retval == ERROR_OK) {
-			if (erase) {
-				/* calculate and erase sectors */
-				retval = flash_erase_address_range(target,
-						true, run_address, run_size);
+		/* Erase-ahead: this run may already have been erased in the
+		 * background while the previous bank was being programmed. */
+		int run_erase = erase;
+		bool run_unlock = unlock;
+
+		if (ahead.bank == c) {
+			retval = flash_erase_ahead_wait(&ahead);
+			erased = ahead;
+			ahead.bank = NULL;
+			if (retval != ERROR_OK) {
+				free(buffer);
+				goto done;
 			}
 		}
+		if (erased.bank == c && run_address >= erased.start &&
+				run_address + run_size <= erased.end) {
+			run_erase = 0;
+			run_unlock = false;
+		}
 
-		if (retval == ERROR_OK) {
-			/* write flash sectors */
-			retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
+		/* ... and start on the next bank while this one is programmed */
+		if (erase && !ahead.busy) {
+			retval = flash_erase_ahead_start(target, sections,
+					image->num_sections, section, section_offset, c,
+					unlock, &ahead, &erased);
+			if (retval != ERROR_OK) {
+				free(buffer);
+				goto done;
+			}
 		}
 
+		retval = flash_write_run(target, c, buffer, run_address, run_size,
+				run_erase, run_unlock, verify, &ahead);
+
 		free(buffer);
 
 		if (retval != ERROR_OK) {
@@ -750,7 +1279,18 @@ int flash_write_unlock(struct target *target, struct image *image,
 			*written += run_size;	/* add run size to total written counter */
 	}
 
+	if (incremental)
+		LOG_INFO("incremental write: %d sector(s) unchanged, %d sector(s) written",
+			sectors_skipped, sectors_written);
+
 done:
+	/* never leave a bank erasing in the background */
+	if (ahead.busy) {
+		int retval2 = flash_erase_ahead_wait(&ahead);
+		if (retval == ERROR_OK)
+			retval = retval2;
+	}
+
 	free(sections);
 	free(padding);
 
@@ -760,5 +1300,5 @@ done:
 int flash_write(struct target *target, struct image *image,
 	uint32_t *written, int erase)
 {
-	return flash_write_unlock(target, image, written, erase, false);
+	return flash_write_unlock(target, image, written, erase, false, false, false);
 }
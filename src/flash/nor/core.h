@@ -98,6 +98,13 @@ struct flash_bank {
 	/** Array of sectors, allocated and initilized by the flash driver */
 	struct flash_sector *sectors;
 
+	/**
+	 * Set by a driver's write() when its algorithm has read back and
+	 * compared all the data it wrote, so "flash write_image verify" does
+	 * not need to check it again.  Cleared by the core before each write.
+	 */
+	bool write_verified;
+
 	struct flash_bank *next; /**< The next flash bank on this chip */
 };
 
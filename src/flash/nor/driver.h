@@ -24,6 +24,14 @@
 
 struct flash_bank;
 
+/**
+ * Capability flag for flash_driver_s::flags: every bank of this driver has
+ * its own erase/program engine (e.g. a separate external chip), so it can
+ * be erased in the background through flash_driver_s::erase_start and
+ * flash_driver_s::erase_poll while another bank is being programmed.
+ */
+#define FLASH_DRIVER_INDEPENDENT_BANKS	(1 << 0)
+
 #define __FLASH_BANK_COMMAND(name) \
 		COMMAND_HELPER(name, struct flash_bank *bank)
 
@@ -66,6 +74,11 @@ struct flash_driver {
 	 */
 	const struct command_registration *commands;
 
+	/**
+	 * Capability flags, a combination of FLASH_DRIVER_* values.
+	 */
+	unsigned flags;
+
 	/**
 	 * Finish the "flash bank" command for @a bank.  The
 	 * @a bank parameter will have been filled in by the core flash
@@ -106,6 +119,32 @@ struct flash_driver {
 	 */
 	int (*erase)(struct flash_bank *bank, int first, int last);
 
+	/**
+	 * Start erasing the specified sectors without waiting for the
+	 * erase to complete.  Optional; only used for drivers that set
+	 * FLASH_DRIVER_INDEPENDENT_BANKS.  Until erase_poll reports
+	 * completion the core will not access @a bank.
+	 *
+	 * @param bank The bank of flash to be erased.
+	 * @param first The number of the first sector to erase.
+	 * @param last The number of the last sector to erase.
+	 * @returns ERROR_OK if the erase was started; otherwise, an error
+	 * code.  ERROR_FLASH_OPER_UNSUPPORTED makes the core fall back to
+	 * a plain erase.
+	 */
+	int (*erase_start)(struct flash_bank *bank, int first, int last);
+
+	/**
+	 * Advance an erase started by erase_start without blocking: check
+	 * the current sector and start the next one once it is done.
+	 *
+	 * @param bank The bank being erased.
+	 * @returns ERROR_FLASH_BUSY while sectors remain, ERROR_OK once
+	 * all of them are erased; otherwise, an error code (the erase is
+	 * then abandoned).
+	 */
+	int (*erase_poll)(struct flash_bank *bank);
+
 	/**
 	 * Bank/sector protection routine (target-specific).
 	 *
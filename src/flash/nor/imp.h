@@ -41,9 +41,41 @@ int flash_driver_write(struct flash_bank *bank,
 		uint8_t *buffer, uint32_t offset, uint32_t count);
 int flash_driver_read(struct flash_bank *bank,
 		uint8_t *buffer, uint32_t offset, uint32_t count);
+int flash_driver_read_verify(struct flash_bank *bank, uint8_t *buffer,
+		const uint8_t *expected, uint32_t offset, uint32_t count);
+
+struct reg_param;
+
+/**
+ * Sets up the register parameters of one run of a ping-pong flash
+ * loader: program @a count bytes from working area address @a source
+ * to flash address @a address.
+ */
+typedef void (*flash_pingpong_setup_t)(struct flash_bank *bank,
+		struct reg_param *reg_params, uint32_t source,
+		uint32_t address, uint32_t count);
+
+/**
+ * Program @a count bytes to flash with an algorithm that handles one
+ * block per run and stops at a breakpoint. Two staging buffers of up
+ * to @a block_size bytes are used in turn, so the next block is
+ * written while the target programs the current one. Only targets
+ * whose memory can be accessed while running support this.
+ *
+ * @param align Every run but the last is a multiple of this many bytes.
+ * @returns ERROR_TARGET_RESOURCE_NOT_AVAILABLE if the staging buffers
+ * cannot be allocated, so drivers can fall back to slower paths.
+ */
+int flash_write_block_pingpong(struct flash_bank *bank,
+		const uint8_t *buffer, uint32_t address, uint32_t count,
+		uint32_t block_size, uint32_t align,
+		int num_reg_params, struct reg_param *reg_params,
+		flash_pingpong_setup_t setup,
+		uint32_t entry_point, uint32_t exit_point, int timeout_ms,
+		void *arch_info);
 
 /* write (optional verify) an image to flash memory of the given target */
 int flash_write_unlock(struct target *target, struct image *image,
-		uint32_t *written, int erase, bool unlock);
+		uint32_t *written, int erase, bool unlock, bool incremental, bool verify);
 
 #endif /* OPENOCD_FLASH_NOR_IMP_H */
@@ -25,6 +25,12 @@
 #include <helper/time_support.h>
 
 #define JTAGSPI_MAX_TIMEOUT 3000
+/* status reads queued per flush while waiting for the flash */
+#define JTAGSPI_STATUS_POLLS 32
+/* waits longer than this are assumed to be erases, sleep between polls */
+#define JTAGSPI_POLL_SLEEP_MS 10
+/* pages queued per flush in burst mode */
+#define JTAGSPI_BURST_PAGES 64
 
 
 struct jtagspi_flash_bank {
@@ -33,15 +39,24 @@ struct jtagspi_flash_bank {
 	int probed;
 	uint32_t ir;
 	uint32_t dr_len;
+	bool burst;
 };
 
 FLASH_BANK_COMMAND_HANDLER(jtagspi_flash_bank_command)
 {
 	struct jtagspi_flash_bank *info;
+	bool burst = false;
 
 	if (CMD_ARGC < 8)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
+	for (unsigned i = 8; i < CMD_ARGC; i++) {
+		if (strcmp(CMD_ARGV[i], "burst") == 0)
+			burst = true;
+		else
+			return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
 	info = malloc(sizeof(struct jtagspi_flash_bank));
 	if (info == NULL) {
 		LOG_ERROR("no memory for flash bank info");
@@ -51,6 +66,7 @@ FLASH_BANK_COMMAND_HANDLER(jtagspi_flash_bank_command)
 
 	info->tap = NULL;
 	info->probed = 0;
+	info->burst = burst;
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[6], info->ir);
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[7], info->dr_len);
 
@@ -80,13 +96,15 @@ static void flip_u8(uint8_t *in, uint8_t *out, int len)
 		out[i] = flip_u32(in[i], 8);
 }
 
-static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
+/* Queues an SPI command without executing it. For reads (len < 0), data
+ * receives the bit reversed response once the queue has been executed. */
+static int jtagspi_queue_cmd(struct flash_bank *bank, uint8_t cmd,
 		uint32_t *addr, uint8_t *data, int len)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
 	struct scan_field fields[3];
 	uint8_t cmd_buf[4];
-	uint8_t *data_buf;
+	uint8_t *data_buf = NULL;
 	int is_read, lenb, n;
 
 	/* LOG_DEBUG("cmd=0x%02x len=%i", cmd, len); */
@@ -107,20 +125,20 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	if (is_read)
 		len = -len;
 	lenb = DIV_ROUND_UP(len, 8);
-	data_buf = malloc(lenb);
 	if (lenb > 0) {
-		if (data_buf == NULL) {
-			LOG_ERROR("no memory for spi buffer");
-			return ERROR_FAIL;
-		}
 		if (is_read) {
 			fields[n].num_bits = info->dr_len;
 			fields[n].out_value = NULL;
 			fields[n].in_value = NULL;
 			n++;
 			fields[n].out_value = NULL;
-			fields[n].in_value = data_buf;
+			fields[n].in_value = data;
 		} else {
+			data_buf = malloc(lenb);
+			if (data_buf == NULL) {
+				LOG_ERROR("no memory for spi buffer");
+				return ERROR_FAIL;
+			}
 			flip_u8(data, data_buf, lenb);
 			fields[n].out_value = data_buf;
 			fields[n].in_value = NULL;
@@ -130,15 +148,29 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	}
 
 	jtagspi_set_ir(bank);
+	/* out values are copied into the queue */
 	jtag_add_dr_scan(info->tap, n, fields, TAP_IDLE);
-	jtag_execute_queue();
-
-	if (is_read)
-		flip_u8(data_buf, data, lenb);
 	free(data_buf);
 	return ERROR_OK;
 }
 
+static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
+		uint32_t *addr, uint8_t *data, int len)
+{
+	int retval;
+
+	retval = jtagspi_queue_cmd(bank, cmd, addr, data, len);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (len < 0)
+		flip_u8(data, data, DIV_ROUND_UP(-len, 8));
+	return ERROR_OK;
+}
+
 static int jtagspi_probe(struct flash_bank *bank)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
@@ -199,40 +231,61 @@ static int jtagspi_probe(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
-static void jtagspi_read_status(struct flash_bank *bank, uint32_t *status)
+/* Queues JTAGSPI_STATUS_POLLS status register reads into the raw status array */
+static int jtagspi_queue_status_polls(struct flash_bank *bank, uint8_t *status)
+{
+	int retval;
+
+	for (int i = 0; i < JTAGSPI_STATUS_POLLS; i++) {
+		retval = jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, &status[i], -8);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	return ERROR_OK;
+}
+
+/* Returns the index of the first executed status poll that saw the flash ready, or -1 */
+static int jtagspi_first_ready(const uint8_t *status)
 {
-	uint8_t buf;
-	jtagspi_cmd(bank, SPIFLASH_READ_STATUS, NULL, &buf, -8);
-	*status = buf;
-	/* LOG_DEBUG("status=0x%08" PRIx32, *status); */
+	for (int i = 0; i < JTAGSPI_STATUS_POLLS; i++)
+		if ((flip_u32(status[i], 8) & SPIFLASH_BSY_BIT) == 0)
+			return i;
+	return -1;
 }
 
 static int jtagspi_wait(struct flash_bank *bank, int timeout_ms)
 {
-	uint32_t status;
+	uint8_t status[JTAGSPI_STATUS_POLLS];
 	int64_t t0 = timeval_ms();
 	int64_t dt;
+	int retval;
 
 	do {
 		dt = timeval_ms() - t0;
-		jtagspi_read_status(bank, &status);
-		if ((status & SPIFLASH_BSY_BIT) == 0) {
+		retval = jtagspi_queue_status_polls(bank, status);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			return retval;
+		if (jtagspi_first_ready(status) >= 0) {
 			LOG_DEBUG("waited %" PRId64 " ms", dt);
 			return ERROR_OK;
 		}
-		alive_sleep(1);
+		if (dt >= JTAGSPI_POLL_SLEEP_MS)
+			alive_sleep(1);
+		else
+			keep_alive();
 	} while (dt <= timeout_ms);
 
 	LOG_ERROR("timeout, device still busy");
 	return ERROR_FAIL;
 }
 
-static int jtagspi_write_enable(struct flash_bank *bank)
+static int jtagspi_check_write_enable(uint8_t raw_status)
 {
-	uint32_t status;
+	uint32_t status = flip_u32(raw_status, 8);
 
-	jtagspi_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, NULL, 0);
-	jtagspi_read_status(bank, &status);
 	if ((status & SPIFLASH_WE_BIT) == 0) {
 		LOG_ERROR("Cannot enable write to flash. Status=0x%08" PRIx32, status);
 		return ERROR_FAIL;
@@ -240,6 +293,23 @@ static int jtagspi_write_enable(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
+static int jtagspi_write_enable(struct flash_bank *bank)
+{
+	uint8_t status;
+	int retval;
+
+	retval = jtagspi_queue_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, NULL, 0);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, &status, -8);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+	return jtagspi_check_write_enable(status);
+}
+
 static int jtagspi_bulk_erase(struct flash_bank *bank)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
@@ -348,14 +418,68 @@ static int jtagspi_read(struct flash_bank *bank, uint8_t *buffer, uint32_t offse
 	return ERROR_OK;
 }
 
+/* Write enable, its check, the page program and the first status polls
+ * all go out in one flush. Only if the page is still busy after that
+ * does it fall back to jtagspi_wait(). */
 static int jtagspi_page_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
+	uint8_t we_status;
+	uint8_t status[JTAGSPI_STATUS_POLLS];
 	int retval;
 
-	retval = jtagspi_write_enable(bank);
+	retval = jtagspi_queue_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, NULL, 0);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, &we_status, -8);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtagspi_queue_cmd(bank, SPIFLASH_PAGE_PROGRAM, &offset, (uint8_t *) buffer, count*8);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtagspi_queue_status_polls(bank, status);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = jtagspi_check_write_enable(we_status);
+	if (retval != ERROR_OK)
+		return retval;
+	if (jtagspi_first_ready(status) >= 0)
+		return ERROR_OK;
+	return jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
+}
+
+/* For proxy bitstreams that hold off new commands while the flash is busy,
+ * pages are queued back to back and the status is only checked at the end. */
+static int jtagspi_burst_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	struct jtagspi_flash_bank *info = bank->driver_priv;
+	unsigned pages = 0;
+	uint32_t addr;
+	int retval;
+
+	for (uint32_t n = 0; n < count; n += info->dev->pagesize) {
+		addr = offset + n;
+		retval = jtagspi_queue_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, NULL, 0);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = jtagspi_queue_cmd(bank, SPIFLASH_PAGE_PROGRAM, &addr, (uint8_t *) buffer + n,
+				MIN(count - n, info->dev->pagesize) * 8);
+		if (retval != ERROR_OK)
+			return retval;
+		if (++pages % JTAGSPI_BURST_PAGES == 0) {
+			retval = jtag_execute_queue();
+			if (retval != ERROR_OK)
+				return retval;
+			LOG_DEBUG("wrote burst up to 0x%08" PRIx32, addr);
+		}
+	}
+
+	retval = jtag_execute_queue();
 	if (retval != ERROR_OK)
 		return retval;
-	jtagspi_cmd(bank, SPIFLASH_PAGE_PROGRAM, &offset, (uint8_t *) buffer, count*8);
 	return jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
 }
 
@@ -370,6 +494,13 @@ static int jtagspi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_
 		return ERROR_FLASH_BANK_NOT_PROBED;
 	}
 
+	if (info->burst) {
+		retval = jtagspi_burst_write(bank, buffer, offset, count);
+		if (retval != ERROR_OK)
+			LOG_ERROR("burst write error");
+		return retval;
+	}
+
 	for (n = 0; n < count; n += info->dev->pagesize) {
 		retval = jtagspi_page_write(bank, buffer + n, offset + n,
 				MIN(count - n, info->dev->pagesize));
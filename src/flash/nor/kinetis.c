@@ -35,6 +35,7 @@
 #include "jtag/interface.h"
 #include "imp.h"
 #include <helper/binarybuffer.h>
+#include <helper/time_support.h>
 #include <target/target_type.h>
 #include <target/algorithm.h>
 #include <target/armv7m.h>
@@ -85,6 +86,7 @@
 #define FTFx_FSTAT	0x40020000
 #define FTFx_FCNFG	0x40020001
 #define FTFx_FCCOB3	0x40020004
+#define FTFx_FCCOB7	0x40020008
 #define FTFx_FPROT3	0x40020010
 #define FTFx_FDPROT	0x40020017
 #define SIM_SDID	0x40048024
@@ -693,13 +695,21 @@ static const uint8_t kinetis_flash_write_code[] = {
 };
 
 /* Program LongWord Block Write */
+static void kinetis_write_block_setup(struct flash_bank *bank,
+		struct reg_param *reg_params, uint32_t source,
+		uint32_t address, uint32_t count)
+{
+	buf_set_u32(reg_params[0].value, 0, 32, source);
+	buf_set_u32(reg_params[1].value, 0, 32, address);
+	buf_set_u32(reg_params[2].value, 0, 32, count / 4);
+}
+
 static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 		uint32_t offset, uint32_t wcount)
 {
 	struct target *target = bank->target;
 	uint32_t buffer_size = 2048;		/* Default minimum value */
 	struct working_area *write_algorithm;
-	struct working_area *source;
 	struct kinetis_flash_bank *kinfo = bank->driver_priv;
 	uint32_t address = kinfo->prog_base + offset;
 	struct reg_param reg_params[3];
@@ -741,18 +751,6 @@ static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* memory buffer */
-	while (target_alloc_working_area(target, buffer_size, &source) != ERROR_OK) {
-		buffer_size /= 4;
-		if (buffer_size <= 256) {
-			/* free working area, write algorithm already allocated */
-			target_free_working_area(target, write_algorithm);
-
-			LOG_WARNING("No large enough working area available, can't do block memory writes");
-			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-		}
-	}
-
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
 
@@ -760,33 +758,14 @@ static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT); /* faddr */
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT); /* number of words to program */
 
-	/* write code buffer and use Flash programming code within kinetis       */
-	/* Set breakpoint to 0 with time-out of 1000 ms                          */
-	while (wcount > 0) {
-		uint32_t thisrun_count = (wcount > (buffer_size / 4)) ? (buffer_size / 4) : wcount;
-
-		retval = target_write_buffer(target, source->address, thisrun_count * 4, buffer);
-		if (retval != ERROR_OK)
-			break;
-
-		buf_set_u32(reg_params[0].value, 0, 32, source->address);
-		buf_set_u32(reg_params[1].value, 0, 32, address);
-		buf_set_u32(reg_params[2].value, 0, 32, thisrun_count);
-
-		retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
-				write_algorithm->address, 0, 100000, &armv7m_info);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error executing kinetis Flash programming algorithm");
-			retval = ERROR_FLASH_OPERATION_FAILED;
-			break;
-		}
-
-		buffer += thisrun_count * 4;
-		address += thisrun_count * 4;
-		wcount -= thisrun_count;
-	}
+	/* write the next block while the Flash programming code within
+	 * kinetis handles the current one; time-out of 100s per block */
+	retval = flash_write_block_pingpong(bank, buffer, address, wcount * 4,
+			buffer_size, 4, 3, reg_params, kinetis_write_block_setup,
+			write_algorithm->address, 0, 100000, &armv7m_info);
+	if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		LOG_WARNING("No large enough working area available, can't do block memory writes");
 
-	target_free_working_area(target, source);
 	target_free_working_area(target, write_algorithm);
 
 	destroy_reg_param(&reg_params[0]);
@@ -936,6 +915,60 @@ static int kinetis_ftfx_command(struct target *target, uint8_t fcmd, uint32_t fa
 	return ERROR_OK;
 }
 
+/* FSTAT reads queued behind each launched section program */
+#define FTFx_QUEUED_POLLS	16
+
+/*
+ * Program Section with the FCCOB load, the launch and a batch of FSTAT
+ * polls sent as one DAP transaction instead of a round trip each.  The
+ * FSTAT/FCNFG pair is written as a word, so @a fcnfg must hold the
+ * current FCNFG value to write it back unchanged.  The previous command
+ * must have completed (CCIF set) and its error flags been cleared.
+ */
+static int kinetis_ftfx_sectwrite_queued(struct adiv5_ap *ap, uint32_t faddr,
+		uint32_t section_count, uint8_t fcnfg, uint8_t *ftfx_fstat)
+{
+	uint32_t fstat[FTFx_QUEUED_POLLS];
+	int64_t timeout = timeval_ms() + 1000;
+	int retval, i;
+
+	retval = mem_ap_write_u32(ap, FTFx_FCCOB3,
+			(FTFx_CMD_SECTWRITE << 24) | (faddr & 0xffffff));
+	if (retval == ERROR_OK)
+		retval = mem_ap_write_u32(ap, FTFx_FCCOB7,
+				(section_count & 0xffff) << 16);
+	if (retval == ERROR_OK)
+		retval = mem_ap_write_u32(ap, FTFx_FSTAT, 0x80 | (fcnfg << 8));
+
+	while (retval == ERROR_OK) {
+		for (i = 0; i < FTFx_QUEUED_POLLS && retval == ERROR_OK; i++)
+			retval = mem_ap_read_u32(ap, FTFx_FSTAT, &fstat[i]);
+		if (retval == ERROR_OK)
+			retval = dap_run(ap->dap);
+		if (retval != ERROR_OK)
+			break;
+
+		for (i = 0; i < FTFx_QUEUED_POLLS; i++) {
+			if (fstat[i] & 0x80) {
+				*ftfx_fstat = fstat[i];
+				if ((*ftfx_fstat & 0xf0) != 0x80) {
+					LOG_ERROR("ftfx section write at 0x%06" PRIx32 " failed FSTAT: %02X",
+						faddr, *ftfx_fstat);
+					return ERROR_FLASH_OPERATION_FAILED;
+				}
+				return ERROR_OK;
+			}
+		}
+
+		if (timeval_ms() > timeout) {
+			LOG_ERROR("ftfx section write at 0x%06" PRIx32 " timed out", faddr);
+			return ERROR_FLASH_OPERATION_FAILED;
+		}
+	}
+
+	return retval;
+}
+
 
 static int kinetis_check_run_mode(struct target *target)
 {
@@ -1067,7 +1100,6 @@ static int kinetis_write(struct flash_bank *bank, const uint8_t *buffer,
 			 uint32_t offset, uint32_t count)
 {
 	unsigned int i, result, fallback = 0;
-	uint32_t wc;
 	struct kinetis_flash_bank *kinfo = bank->driver_priv;
 	uint8_t *new_buffer = NULL;
 
@@ -1100,72 +1132,76 @@ static int kinetis_write(struct flash_bank *bank, const uint8_t *buffer,
 		 */
 		unsigned prog_section_chunk_bytes = kinfo->sector_size >> 8;
 		unsigned prog_size_bytes = kinfo->max_flash_prog_size;
+		struct armv7m_common *armv7m = target_to_armv7m(bank->target);
+		struct adiv5_ap *ap = NULL;
+		uint8_t ftfx_fcnfg = 0;
+
+		/* on a DAP, launch and poll each section with queued accesses;
+		 * that needs an idle FTFx with its error flags cleared */
+		if (is_armv7m(armv7m) && armv7m->debug_ap) {
+			uint8_t ftfx_fstat;
+
+			result = target_read_u8(bank->target, FTFx_FSTAT, &ftfx_fstat);
+			if (result == ERROR_OK && (ftfx_fstat & 0x70))
+				result = target_write_u8(bank->target, FTFx_FSTAT, 0x70);
+			if (result == ERROR_OK)
+				result = target_read_u8(bank->target, FTFx_FCNFG, &ftfx_fcnfg);
+			if (result != ERROR_OK)
+				return result;
+			if (ftfx_fstat & 0x80)
+				ap = armv7m->debug_ap;
+		}
+
 		for (i = 0; i < count; i += prog_size_bytes) {
-			uint8_t residual_buffer[16];
 			uint8_t ftfx_fstat;
 			uint32_t section_count = prog_size_bytes / prog_section_chunk_bytes;
-			uint32_t residual_wc = 0;
+			uint32_t wc = prog_size_bytes / 4;
+			const uint8_t *section_buffer = buffer + i;
 
 			/*
-			 * Assume the word count covers an entire
-			 * sector.
-			 */
-			wc = prog_size_bytes / 4;
-
-			/*
-			 * If bytes to be programmed are less than the
-			 * full sector, then determine the number of
-			 * full-words to program, and put together the
-			 * residual buffer so that a full "section"
-			 * may always be programmed.
+			 * If bytes to be programmed are less than the full
+			 * sector, pad the tail to a whole number of chunks
+			 * so that a full "section" may always be programmed.
 			 */
 			if ((count - i) < prog_size_bytes) {
-				/* number of bytes to program beyond full section */
-				unsigned residual_bc = (count-i) % prog_section_chunk_bytes;
-
-				/* number of complete words to copy directly from buffer */
-				wc = (count - i - residual_bc) / 4;
+				section_count = DIV_ROUND_UP((count - i), prog_section_chunk_bytes);
+				wc = section_count * prog_section_chunk_bytes / 4;
 
-				/* number of total sections to write, including residual */
-				section_count = DIV_ROUND_UP((count-i), prog_section_chunk_bytes);
-
-				/* any residual bytes delivers a whole residual section */
-				residual_wc = (residual_bc ? prog_section_chunk_bytes : 0)/4;
-
-				/* clear residual buffer then populate residual bytes */
-				(void) memset(residual_buffer, 0xff, prog_section_chunk_bytes);
-				(void) memcpy(residual_buffer, &buffer[i+4*wc], residual_bc);
+				new_buffer = malloc(wc * 4);
+				if (new_buffer == NULL) {
+					LOG_ERROR("no memory for padding buffer");
+					return ERROR_FAIL;
+				}
+				memset(new_buffer, 0xff, wc * 4);
+				memcpy(new_buffer, buffer + i, count - i);
+				section_buffer = new_buffer;
 			}
 
 			LOG_DEBUG("write section @ %08" PRIX32 " with length %" PRIu32 " bytes",
 				  offset + i, (uint32_t)wc*4);
 
-			/* write data to flexram as whole-words */
+			/* load the whole section to flexram in one bulk write */
 			result = target_write_memory(bank->target, FLEXRAM, 4, wc,
-					buffer + i);
+					section_buffer);
 
 			if (result != ERROR_OK) {
 				LOG_ERROR("target_write_memory failed");
+				free(new_buffer);
 				return result;
 			}
 
-			/* write the residual words to the flexram */
-			if (residual_wc) {
-				result = target_write_memory(bank->target,
-						FLEXRAM+4*wc,
-						4, residual_wc,
-						residual_buffer);
-
-				if (result != ERROR_OK) {
-					LOG_ERROR("target_write_memory failed");
-					return result;
-				}
-			}
-
 			/* execute section-write command */
-			result = kinetis_ftfx_command(bank->target, FTFx_CMD_SECTWRITE, kinfo->prog_base + offset + i,
-					section_count>>8, section_count, 0, 0,
-					0, 0, 0, 0,  &ftfx_fstat);
+			if (ap)
+				result = kinetis_ftfx_sectwrite_queued(ap, kinfo->prog_base + offset + i,
+						section_count, ftfx_fcnfg, &ftfx_fstat);
+			else
+				result = kinetis_ftfx_command(bank->target, FTFx_CMD_SECTWRITE,
+						kinfo->prog_base + offset + i,
+						section_count>>8, section_count, 0, 0,
+						0, 0, 0, 0,  &ftfx_fstat);
+
+			free(new_buffer);
+			new_buffer = NULL;
 
 			if (result != ERROR_OK)
 				return ERROR_FLASH_OPERATION_FAILED;
@@ -687,6 +687,38 @@ static int lpc2000_iap_working_area_init(struct flash_bank *bank, struct working
 	return retval;
 }
 
+static uint32_t lpc2000_iap_entry_point(struct flash_bank *bank)
+{
+	struct lpc2000_flash_bank *lpc2000_info = bank->driver_priv;
+	uint32_t iap_entry_point = 0;
+
+	switch (lpc2000_info->variant) {
+		case lpc800:
+		case lpc1100:
+		case lpc1700:
+		case lpc_auto:
+			iap_entry_point = 0x1fff1ff1;
+			break;
+		case lpc1500:
+		case lpc54100:
+			iap_entry_point = 0x03000205;
+			break;
+		case lpc2000_v1:
+		case lpc2000_v2:
+			iap_entry_point = 0x7ffffff1;
+			break;
+		case lpc4300:
+			/* read out IAP entry point from ROM driver table at 0x10400100 */
+			target_read_u32(bank->target, 0x10400100, &iap_entry_point);
+			break;
+		default:
+			LOG_ERROR("BUG: unknown lpc2000->variant encountered");
+			exit(-1);
+	}
+
+	return iap_entry_point;
+}
+
 /* call LPC8xx/LPC1xxx/LPC4xxx/LPC5410x/LPC2000 IAP function */
 
 static int lpc2000_iap_call(struct flash_bank *bank, struct working_area *iap_working_area, int code,
@@ -697,35 +729,24 @@ static int lpc2000_iap_call(struct flash_bank *bank, struct working_area *iap_wo
 
 	struct arm_algorithm arm_algo;	/* for LPC2000 */
 	struct armv7m_algorithm armv7m_info;	/* for LPC8xx/LPC1xxx/LPC4xxx/LPC5410x */
-	uint32_t iap_entry_point = 0;	/* to make compiler happier */
+	uint32_t iap_entry_point = lpc2000_iap_entry_point(bank);
 
 	switch (lpc2000_info->variant) {
 		case lpc800:
 		case lpc1100:
 		case lpc1700:
 		case lpc_auto:
-			armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
-			armv7m_info.core_mode = ARM_MODE_THREAD;
-			iap_entry_point = 0x1fff1ff1;
-			break;
 		case lpc1500:
 		case lpc54100:
+		case lpc4300:
 			armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 			armv7m_info.core_mode = ARM_MODE_THREAD;
-			iap_entry_point = 0x03000205;
 			break;
 		case lpc2000_v1:
 		case lpc2000_v2:
 			arm_algo.common_magic = ARM_COMMON_MAGIC;
 			arm_algo.core_mode = ARM_MODE_SVC;
 			arm_algo.core_state = ARM_STATE_ARM;
-			iap_entry_point = 0x7ffffff1;
-			break;
-		case lpc4300:
-			armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
-			armv7m_info.core_mode = ARM_MODE_THREAD;
-			/* read out IAP entry point from ROM driver table at 0x10400100 */
-			target_read_u32(target, 0x10400100, &iap_entry_point);
 			break;
 		default:
 			LOG_ERROR("BUG: unknown lpc2000->variant encountered");
@@ -1015,6 +1036,122 @@ static int lpc2000_protect(struct flash_bank *bank, int set, int first, int last
 	return ERROR_OK;
 }
 
+static const uint8_t lpc2000_flash_write_code[] = {
+	/* See contrib/loaders/flash/lpc2000/write.S */
+#include "../../../contrib/loaders/flash/lpc2000/write.inc"
+};
+
+/* Program whole cmd51_max_buffer sized blocks with the loader, which makes
+ * the prepare and copy IAP calls for each block on the target.  Only for
+ * the Cortex-M parts; ERROR_TARGET_RESOURCE_NOT_AVAILABLE is returned for
+ * the others and without a working area. */
+static int lpc2000_write_block(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t address, uint32_t blocks, int first_sector, int last_sector)
+{
+	struct lpc2000_flash_bank *lpc2000_info = bank->driver_priv;
+	struct target *target = bank->target;
+	uint32_t block_size = lpc2000_info->cmd51_max_buffer;
+	uint32_t buffer_blocks = 4;
+	uint32_t code_size = DIV_ROUND_UP(sizeof(lpc2000_flash_write_code), 8) * 8;
+	struct working_area *write_algorithm;
+	struct working_area *iap_tables;
+	struct working_area *source;
+	struct reg_param reg_params[8];
+	struct armv7m_algorithm armv7m_info;
+	uint8_t tables[0x30];
+	int retval;
+
+	if (lpc2000_info->variant == lpc2000_v1 || lpc2000_info->variant == lpc2000_v2)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* the loader, with the IAP stack behind it */
+	if (target_alloc_working_area(target, code_size + lpc2000_info->iap_max_stack,
+			&write_algorithm) != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = target_write_buffer(target, write_algorithm->address,
+			sizeof(lpc2000_flash_write_code), lpc2000_flash_write_code);
+	if (retval != ERROR_OK)
+		goto cleanup_algo;
+
+	/* prepare and copy command tables, followed by the result table */
+	if (target_alloc_working_area(target, sizeof(tables) + 5 * 4, &iap_tables) != ERROR_OK) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup_algo;
+	}
+
+	memset(tables, 0, sizeof(tables));
+	target_buffer_set_u32(target, tables + 0x00, 50);
+	target_buffer_set_u32(target, tables + 0x04, first_sector);
+	target_buffer_set_u32(target, tables + 0x08, last_sector);
+	if (lpc2000_info->variant == lpc4300)
+		target_buffer_set_u32(target, tables + 0x0c, lpc2000_info->lpc4300_bank);
+	else
+		target_buffer_set_u32(target, tables + 0x0c, lpc2000_info->cclk);
+	target_buffer_set_u32(target, tables + 0x18, 51);
+	target_buffer_set_u32(target, tables + 0x24, block_size);
+	target_buffer_set_u32(target, tables + 0x28, lpc2000_info->cclk);
+	retval = target_write_buffer(target, iap_tables->address, sizeof(tables), tables);
+	if (retval != ERROR_OK)
+		goto cleanup_tables;
+
+	while (target_alloc_working_area_try(target, 8 + buffer_blocks * block_size,
+			&source) != ERROR_OK) {
+		buffer_blocks /= 2;
+		if (buffer_blocks < 1) {
+			LOG_WARNING("no large enough working area available, can't do block memory writes");
+			retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			goto cleanup_tables;
+		}
+	}
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN);	/* IAP status */
+	init_reg_param(&reg_params[1], "r4", 32, PARAM_IN_OUT);	/* target address */
+	init_reg_param(&reg_params[2], "r5", 32, PARAM_OUT);	/* buffer start */
+	init_reg_param(&reg_params[3], "r6", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[4], "r7", 32, PARAM_OUT);	/* block count */
+	init_reg_param(&reg_params[5], "r8", 32, PARAM_OUT);	/* IAP entry point */
+	init_reg_param(&reg_params[6], "r9", 32, PARAM_OUT);	/* IAP tables */
+	init_reg_param(&reg_params[7], "sp", 32, PARAM_OUT);	/* IAP stack */
+
+	buf_set_u32(reg_params[1].value, 0, 32, address);
+	buf_set_u32(reg_params[2].value, 0, 32, source->address);
+	buf_set_u32(reg_params[3].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[4].value, 0, 32, blocks);
+	buf_set_u32(reg_params[5].value, 0, 32, lpc2000_iap_entry_point(bank));
+	buf_set_u32(reg_params[6].value, 0, 32, iap_tables->address);
+	buf_set_u32(reg_params[7].value, 0, 32, write_algorithm->address + write_algorithm->size);
+
+	retval = target_run_flash_async_algorithm(target, buffer, blocks, block_size,
+			0, NULL,
+			ARRAY_SIZE(reg_params), reg_params,
+			source->address, source->size,
+			write_algorithm->address, 0,
+			&armv7m_info);
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED) {
+		uint32_t status_code = buf_get_u32(reg_params[0].value, 0, 32);
+		LOG_WARNING("lpc2000 returned %" PRIu32 " at address 0x%8.8" PRIx32, status_code,
+				buf_get_u32(reg_params[1].value, 0, 32));
+		if (status_code == LPC2000_INVALID_SECTOR)
+			retval = ERROR_FLASH_SECTOR_INVALID;
+	}
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	target_free_working_area(target, source);
+cleanup_tables:
+	target_free_working_area(target, iap_tables);
+cleanup_algo:
+	target_free_working_area(target, write_algorithm);
+
+	return retval;
+}
+
 static int lpc2000_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	struct target *target = bank->target;
@@ -1097,6 +1234,21 @@ static int lpc2000_write(struct flash_bank *bank, const uint8_t *buffer, uint32_
 		/* Init IAP Anyway */
 		lpc2000_iap_call(bank, iap_working_area, 49, param_table, result_table);
 
+	/* Stream the whole blocks through the loader, the rest is done below */
+	uint32_t blocks = bytes_remaining / lpc2000_info->cmd51_max_buffer;
+	if (blocks > 0) {
+		retval = lpc2000_write_block(bank, buffer, bank->base + offset, blocks,
+				first_sector, last_sector);
+		if (retval == ERROR_OK) {
+			bytes_written = blocks * lpc2000_info->cmd51_max_buffer;
+			bytes_remaining -= bytes_written;
+		} else if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+			retval = ERROR_OK;
+		} else {
+			bytes_remaining = 0;
+		}
+	}
+
 	while (bytes_remaining > 0) {
 		uint32_t thisrun_bytes;
 		if (bytes_remaining >= lpc2000_info->cmd51_max_buffer)
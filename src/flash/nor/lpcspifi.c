@@ -319,94 +319,54 @@ static int read_status_reg(struct flash_bank *bank, uint32_t *status)
 	return retval;
 }
 
-/* check for BSY bit in flash status register */
-/* timeout in ms */
-static int wait_till_ready(struct flash_bank *bank, int timeout)
-{
-	uint32_t status;
-	int retval;
-	int64_t endtime;
-
-	endtime = timeval_ms() + timeout;
-	do {
-		/* read flash status register */
-		retval = read_status_reg(bank, &status);
-		if (retval != ERROR_OK)
-			return retval;
-
-		if ((status & SPIFLASH_BSY_BIT) == 0)
-			return ERROR_OK;
-		alive_sleep(1);
-	} while (timeval_ms() < endtime);
-
-	LOG_ERROR("timeout waiting for flash to finish write/erase operation");
-	return ERROR_FAIL;
-}
-
-/* Send "write enable" command to SPI flash chip. */
-static int lpcspifi_write_enable(struct flash_bank *bank)
+/* Send a command byte and an optional 24 bit address to the SPI flash chip. */
+static int lpcspifi_command(struct flash_bank *bank, uint8_t cmd, const uint32_t *addr)
 {
 	struct target *target = bank->target;
 	struct lpcspifi_flash_bank *lpcspifi_info = bank->driver_priv;
 	uint32_t ssp_base = lpcspifi_info->ssp_base;
 	uint32_t io_base = lpcspifi_info->io_base;
-	uint32_t status, value;
+	uint8_t out[4];
+	int len = 1;
+	uint32_t value;
 	int retval = ERROR_OK;
 
+	out[0] = cmd;
+	if (addr) {
+		h_u24_to_be(out + 1, *addr);
+		len += 3;
+	}
+
 	retval = ssp_setcs(target, io_base, 0);
-	if (retval == ERROR_OK)
-		retval = ssp_write_reg(target, ssp_base, SSP_DATA, SPIFLASH_WRITE_ENABLE);
-	if (retval == ERROR_OK)
-		retval = poll_ssp_busy(target, ssp_base, SSP_CMD_TIMEOUT);
-	if (retval == ERROR_OK)
-		retval = ssp_read_reg(target, ssp_base, SSP_DATA, &value);
+	for (int i = 0; i < len && retval == ERROR_OK; i++) {
+		retval = ssp_write_reg(target, ssp_base, SSP_DATA, out[i]);
+		if (retval == ERROR_OK)
+			retval = poll_ssp_busy(target, ssp_base, SSP_CMD_TIMEOUT);
+		if (retval == ERROR_OK)
+			retval = ssp_read_reg(target, ssp_base, SSP_DATA, &value);
+	}
 	if (retval == ERROR_OK)
 		retval = ssp_setcs(target, io_base, 1);
 
-	/* read flash status register */
-	if (retval == ERROR_OK)
-		retval = read_status_reg(bank, &status);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Check write enabled */
-	if ((status & SPIFLASH_WE_BIT) == 0) {
-		LOG_ERROR("Cannot enable write to flash. Status=0x%08" PRIx32, status);
-		return ERROR_FAIL;
-	}
-
 	return retval;
 }
 
+static const struct spi_nor_ops lpcspifi_spi_ops = {
+	.read_status = read_status_reg,
+	.command = lpcspifi_command,
+};
+
 static int lpcspifi_bulk_erase(struct flash_bank *bank)
 {
-	struct target *target = bank->target;
 	struct lpcspifi_flash_bank *lpcspifi_info = bank->driver_priv;
-	uint32_t ssp_base = lpcspifi_info->ssp_base;
-	uint32_t io_base = lpcspifi_info->io_base;
-	uint32_t value;
 	int retval = ERROR_OK;
 
 	retval = lpcspifi_set_sw_mode(bank);
 
-	if (retval == ERROR_OK)
-		retval = lpcspifi_write_enable(bank);
-
-	/* send SPI command "bulk erase" */
-	if (retval == ERROR_OK)
-		ssp_setcs(target, io_base, 0);
-	if (retval == ERROR_OK)
-		retval = ssp_write_reg(target, ssp_base, SSP_DATA, lpcspifi_info->dev->chip_erase_cmd);
-	if (retval == ERROR_OK)
-		retval = poll_ssp_busy(target, ssp_base, SSP_CMD_TIMEOUT);
-	if (retval == ERROR_OK)
-		retval = ssp_read_reg(target, ssp_base, SSP_DATA, &value);
-	if (retval == ERROR_OK)
-		retval = ssp_setcs(target, io_base, 1);
-
 	/* poll flash BSY for self-timed bulk erase */
 	if (retval == ERROR_OK)
-		retval = wait_till_ready(bank, bank->num_sectors*SSP_MAX_TIMEOUT);
+		retval = spi_nor_bulk_erase(bank, &lpcspifi_spi_ops, lpcspifi_info->dev,
+				bank->num_sectors*SSP_MAX_TIMEOUT);
 
 	return retval;
 }
@@ -415,9 +375,8 @@ static int lpcspifi_erase(struct flash_bank *bank, int first, int last)
 {
 	struct target *target = bank->target;
 	struct lpcspifi_flash_bank *lpcspifi_info = bank->driver_priv;
-	struct reg_param reg_params[4];
+	struct spi_nor_loader loader = { 0 };
 	struct armv7m_algorithm armv7m_info;
-	struct working_area *erase_algorithm;
 	int retval = ERROR_OK;
 	int sector;
 
@@ -514,52 +473,17 @@ static int lpcspifi_erase(struct flash_bank *bank, int first, int last)
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
 
+	loader.code = lpcspifi_flash_erase_code;
+	loader.code_size = sizeof(lpcspifi_flash_erase_code);
+	loader.arch_info = &armv7m_info;
 
-	/* Get memory for spifi initialization algorithm */
-	retval = target_alloc_working_area(target, sizeof(lpcspifi_flash_erase_code),
-		&erase_algorithm);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("Insufficient working area. You must configure a working"\
-			" area of at least %zdB in order to erase SPIFI flash.",
-			sizeof(lpcspifi_flash_erase_code));
-		return retval;
-	}
-
-	/* Write algorithm to working area */
-	retval = target_write_buffer(target, erase_algorithm->address,
-		sizeof(lpcspifi_flash_erase_code), lpcspifi_flash_erase_code);
-	if (retval != ERROR_OK) {
-		target_free_working_area(target, erase_algorithm);
-		return retval;
-	}
-
-	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* Start address */
-	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* Sector count */
-	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* Erase command */
-	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);	/* Sector size */
-
-	buf_set_u32(reg_params[0].value, 0, 32, bank->sectors[first].offset);
-	buf_set_u32(reg_params[1].value, 0, 32, last - first + 1);
-	buf_set_u32(reg_params[2].value, 0, 32, lpcspifi_info->dev->erase_cmd);
-	buf_set_u32(reg_params[3].value, 0, 32, bank->sectors[first].size);
-
-	/* Run the algorithm */
-	retval = target_run_algorithm(target, 0 , NULL, 4, reg_params,
-		erase_algorithm->address,
-		erase_algorithm->address + sizeof(lpcspifi_flash_erase_code) - 4,
-		3000*(last - first + 1), &armv7m_info);
-
-	if (retval != ERROR_OK)
-		LOG_ERROR("Error executing flash erase algorithm");
-
-	target_free_working_area(target, erase_algorithm);
+	retval = spi_nor_loader_erase(bank, &loader, lpcspifi_info->dev,
+			first, last, SSP_MAX_TIMEOUT);
 
-	destroy_reg_param(&reg_params[0]);
-	destroy_reg_param(&reg_params[1]);
-	destroy_reg_param(&reg_params[2]);
-	destroy_reg_param(&reg_params[3]);
-
-	retval = lpcspifi_set_hw_mode(bank);
+	if (retval == ERROR_OK)
+		retval = lpcspifi_set_hw_mode(bank);
+	else
+		lpcspifi_set_hw_mode(bank);
 
 	return retval;
 }
@@ -579,12 +503,8 @@ static int lpcspifi_write(struct flash_bank *bank, const uint8_t *buffer,
 {
 	struct target *target = bank->target;
 	struct lpcspifi_flash_bank *lpcspifi_info = bank->driver_priv;
-	uint32_t page_size, fifo_size;
-	struct working_area *fifo;
-	struct reg_param reg_params[5];
+	struct spi_nor_loader loader = { 0 };
 	struct armv7m_algorithm armv7m_info;
-	struct working_area *write_algorithm;
-	int sector;
 	int retval = ERROR_OK;
 
 	LOG_DEBUG("offset=0x%08" PRIx32 " count=0x%08" PRIx32,
@@ -600,20 +520,9 @@ static int lpcspifi_write(struct flash_bank *bank, const uint8_t *buffer,
 		count = lpcspifi_info->dev->size_in_bytes - offset;
 	}
 
-	/* Check sector protection */
-	for (sector = 0; sector < bank->num_sectors; sector++) {
-		/* Start offset in or before this sector? */
-		/* End offset in or behind this sector? */
-		if ((offset <
-				(bank->sectors[sector].offset + bank->sectors[sector].size))
-			&& ((offset + count - 1) >= bank->sectors[sector].offset)
-			&& bank->sectors[sector].is_protected) {
-			LOG_ERROR("Flash sector %d protected", sector);
-			return ERROR_FAIL;
-		}
-	}
-
-	page_size = lpcspifi_info->dev->pagesize;
+	retval = spi_nor_check_protection(bank, offset, count);
+	if (retval != ERROR_OK)
+		return retval;
 
 	retval = lpcspifi_set_hw_mode(bank);
 	if (retval != ERROR_OK)
@@ -675,87 +584,23 @@ static int lpcspifi_write(struct flash_bank *bank, const uint8_t *buffer,
 		0x00, 0xbe, 0xff, 0xff
 	};
 
-	if (target_alloc_working_area(target, sizeof(lpcspifi_flash_write_code),
-			&write_algorithm) != ERROR_OK) {
-		LOG_ERROR("Insufficient working area. You must configure"\
-			" a working area > %zdB in order to write to SPIFI flash.",
-			sizeof(lpcspifi_flash_write_code));
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	}
-
-	retval = target_write_buffer(target, write_algorithm->address,
-			sizeof(lpcspifi_flash_write_code),
-			lpcspifi_flash_write_code);
-	if (retval != ERROR_OK) {
-		target_free_working_area(target, write_algorithm);
-		return retval;
-	}
-
-	/* FIFO allocation */
-	fifo_size = target_get_working_area_avail(target);
-
-	if (fifo_size == 0) {
-		/* if we already allocated the writing code but failed to get fifo
-		 * space, free the algorithm */
-		target_free_working_area(target, write_algorithm);
-
-		LOG_ERROR("Insufficient working area. Please allocate at least"\
-			" %zdB of working area to enable flash writes.",
-			sizeof(lpcspifi_flash_write_code) + 1
-		);
-
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	} else if (fifo_size < page_size)
-		LOG_WARNING("Working area size is limited; flash writes may be"\
-			" slow. Increase working area size to at least %zdB"\
-			" to reduce write times.",
-			(size_t)(sizeof(lpcspifi_flash_write_code) + page_size)
-		);
-	else if (fifo_size > 0x2000) /* Beyond this point, we start to get diminishing returns */
-		fifo_size = 0x2000;
-
-	if (target_alloc_working_area(target, fifo_size, &fifo) != ERROR_OK) {
-		target_free_working_area(target, write_algorithm);
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	}
-
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
 
-	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);		/* buffer start, status (out) */
-	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);		/* buffer end */
-	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);		/* target address */
-	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);		/* count (halfword-16bit) */
-	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);		/* page size */
-
-	buf_set_u32(reg_params[0].value, 0, 32, fifo->address);
-	buf_set_u32(reg_params[1].value, 0, 32, fifo->address + fifo->size);
-	buf_set_u32(reg_params[2].value, 0, 32, offset);
-	buf_set_u32(reg_params[3].value, 0, 32, count);
-	buf_set_u32(reg_params[4].value, 0, 32, page_size);
-
-	retval = target_run_flash_async_algorithm(target, buffer, count, 1,
-			0, NULL,
-			5, reg_params,
-			fifo->address, fifo->size,
-			write_algorithm->address, 0,
-			&armv7m_info
-	);
-
-	if (retval != ERROR_OK)
-		LOG_ERROR("Error executing flash write algorithm");
-
-	target_free_working_area(target, fifo);
-	target_free_working_area(target, write_algorithm);
+	loader.code = lpcspifi_flash_write_code;
+	loader.code_size = sizeof(lpcspifi_flash_write_code);
+	/* Beyond this point, we start to get diminishing returns */
+	loader.fifo_max = 0x2000;
+	loader.arch_info = &armv7m_info;
 
-	destroy_reg_param(&reg_params[0]);
-	destroy_reg_param(&reg_params[1]);
-	destroy_reg_param(&reg_params[2]);
-	destroy_reg_param(&reg_params[3]);
-	destroy_reg_param(&reg_params[4]);
+	retval = spi_nor_loader_write(bank, &loader, lpcspifi_info->dev,
+			buffer, offset, count);
 
 	/* Switch to HW mode before return to prompt */
-	retval = lpcspifi_set_hw_mode(bank);
+	if (retval == ERROR_OK)
+		retval = lpcspifi_set_hw_mode(bank);
+	else
+		lpcspifi_set_hw_mode(bank);
 	return retval;
 }
 
@@ -783,7 +628,7 @@ static int lpcspifi_read_flash_id(struct flash_bank *bank, uint32_t *id)
 
 	/* poll WIP */
 	if (retval == ERROR_OK)
-		retval = wait_till_ready(bank, SSP_PROBE_TIMEOUT);
+		retval = spi_nor_wait_till_ready(bank, &lpcspifi_spi_ops, SSP_PROBE_TIMEOUT);
 
 	/* Send SPI command "read ID" */
 	if (retval == ERROR_OK)
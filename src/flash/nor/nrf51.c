@@ -26,6 +26,7 @@
 #include <target/algorithm.h>
 #include <target/armv7m.h>
 #include <helper/types.h>
+#include <helper/time_support.h>
 
 enum {
 	NRF51_FLASH_BASE = 0x00000000,
@@ -106,6 +107,11 @@ enum nrf51_nvmc_config_bits {
 
 };
 
+/* NVMC_READY timeouts in ms: CONFIG changes and single word writes, and
+ * erases (ERASEALL takes tens of ms, give it plenty of margin). */
+#define NRF51_NVMC_TIMEOUT		100
+#define NRF51_NVMC_ERASE_TIMEOUT	2000
+
 struct nrf51_info {
 	uint32_t code_page_size;
 	uint32_t code_memory_size;
@@ -400,13 +406,17 @@ static int nrf51_get_probed_chip_if_halted(struct flash_bank *bank, struct nrf51
 		return ERROR_OK;
 }
 
-static int nrf51_wait_for_nvmc(struct nrf51_info *chip)
+/* Poll NVMC READY right away, then back off up to 10ms between reads so
+ * long erases don't flood the adapter while short operations still return
+ * on the first read. */
+static int nrf51_wait_for_nvmc(struct nrf51_info *chip, int timeout_ms)
 {
 	uint32_t ready;
 	int res;
-	int timeout = 100;
+	int poll_delay = 0;
+	int64_t then = timeval_ms();
 
-	do {
+	for (;;) {
 		res = target_read_u32(chip->target, NRF51_NVMC_READY, &ready);
 		if (res != ERROR_OK) {
 			LOG_ERROR("Couldn't read NVMC_READY register");
@@ -416,8 +426,13 @@ static int nrf51_wait_for_nvmc(struct nrf51_info *chip)
 		if (ready == 0x00000001)
 			return ERROR_OK;
 
-		alive_sleep(1);
-	} while (timeout--);
+		if (timeval_ms() - then > timeout_ms)
+			break;
+
+		if (poll_delay)
+			alive_sleep(poll_delay);
+		poll_delay = poll_delay ? MIN(poll_delay * 2, 10) : 1;
+	}
 
 	LOG_DEBUG("Timed out waiting for NVMC_READY");
 	return ERROR_FLASH_BUSY;
@@ -439,7 +454,7 @@ static int nrf51_nvmc_erase_enable(struct nrf51_info *chip)
 	  According to NVMC examples in Nordic SDK busy status must be
 	  checked after writing to NVMC_CONFIG
 	 */
-	res = nrf51_wait_for_nvmc(chip);
+	res = nrf51_wait_for_nvmc(chip, NRF51_NVMC_TIMEOUT);
 	if (res != ERROR_OK)
 		LOG_ERROR("Erase enable did not complete");
 
@@ -462,7 +477,7 @@ static int nrf51_nvmc_write_enable(struct nrf51_info *chip)
 	  According to NVMC examples in Nordic SDK busy status must be
 	  checked after writing to NVMC_CONFIG
 	 */
-	res = nrf51_wait_for_nvmc(chip);
+	res = nrf51_wait_for_nvmc(chip, NRF51_NVMC_TIMEOUT);
 	if (res != ERROR_OK)
 		LOG_ERROR("Write enable did not complete");
 
@@ -484,7 +499,7 @@ static int nrf51_nvmc_read_only(struct nrf51_info *chip)
 	  According to NVMC examples in Nordic SDK busy status must be
 	  checked after writing to NVMC_CONFIG
 	 */
-	res = nrf51_wait_for_nvmc(chip);
+	res = nrf51_wait_for_nvmc(chip, NRF51_NVMC_TIMEOUT);
 	if (res != ERROR_OK)
 		LOG_ERROR("Read only enable did not complete");
 
@@ -506,7 +521,7 @@ static int nrf51_nvmc_generic_erase(struct nrf51_info *chip,
 	if (res != ERROR_OK)
 		goto set_read_only;
 
-	res = nrf51_wait_for_nvmc(chip);
+	res = nrf51_wait_for_nvmc(chip, NRF51_NVMC_ERASE_TIMEOUT);
 	if (res != ERROR_OK)
 		goto set_read_only;
 
@@ -785,38 +800,23 @@ static int nrf51_erase_page(struct flash_bank *bank,
 }
 
 static const uint8_t nrf51_flash_write_code[] = {
-	/* See contrib/loaders/flash/cortex-m0.S */
-/* <wait_fifo>: */
-	0x0d, 0x68,		/* ldr	r5,	[r1,	#0] */
-	0x00, 0x2d,		/* cmp	r5,	#0 */
-	0x0b, 0xd0,		/* beq.n	1e <exit> */
-	0x4c, 0x68,		/* ldr	r4,	[r1,	#4] */
-	0xac, 0x42,		/* cmp	r4,	r5 */
-	0xf9, 0xd0,		/* beq.n	0 <wait_fifo> */
-	0x20, 0xcc,		/* ldmia	r4!,	{r5} */
-	0x20, 0xc3,		/* stmia	r3!,	{r5} */
-	0x94, 0x42,		/* cmp	r4,	r2 */
-	0x01, 0xd3,		/* bcc.n	18 <no_wrap> */
-	0x0c, 0x46,		/* mov	r4,	r1 */
-	0x08, 0x34,		/* adds	r4,	#8 */
-/* <no_wrap>: */
-	0x4c, 0x60,		/* str	r4, [r1,	#4] */
-	0x04, 0x38,		/* subs	r0, #4 */
-	0xf0, 0xd1,		/* bne.n	0 <wait_fifo> */
-/* <exit>: */
-	0x00, 0xbe		/* bkpt	0x0000 */
+	/* See contrib/loaders/flash/nrf5/write.S */
+#include "../../../contrib/loaders/flash/nrf5/write.inc"
 };
 
 
-/* Start a low level flash write for the specified region */
-static int nrf51_ll_flash_write(struct nrf51_info *chip, uint32_t offset, const uint8_t *buffer, uint32_t bytes)
+/* Start a low level flash write for the specified region.  With erase set
+ * the loader erases each page before programming it; that needs a working
+ * area, ERROR_TARGET_RESOURCE_NOT_AVAILABLE is returned without one. */
+static int nrf51_ll_flash_write(struct nrf51_info *chip, uint32_t offset, const uint8_t *buffer, uint32_t bytes,
+		bool erase)
 {
 	struct target *target = chip->target;
 	uint32_t buffer_size = 8192;
 	struct working_area *write_algorithm;
 	struct working_area *source;
 	uint32_t address = NRF51_FLASH_BASE + offset;
-	struct reg_param reg_params[4];
+	struct reg_param reg_params[6];
 	struct armv7m_algorithm armv7m_info;
 	int retval = ERROR_OK;
 
@@ -827,6 +827,9 @@ static int nrf51_ll_flash_write(struct nrf51_info *chip, uint32_t offset, const
 	/* allocate working area with flash programming code */
 	if (target_alloc_working_area(target, sizeof(nrf51_flash_write_code),
 			&write_algorithm) != ERROR_OK) {
+		if (erase)
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
 		LOG_WARNING("no working area available, falling back to slow memory writes");
 
 		for (; bytes > 0; bytes -= 4) {
@@ -834,7 +837,7 @@ static int nrf51_ll_flash_write(struct nrf51_info *chip, uint32_t offset, const
 			if (retval != ERROR_OK)
 				return retval;
 
-			retval = nrf51_wait_for_nvmc(chip);
+			retval = nrf51_wait_for_nvmc(chip, NRF51_NVMC_TIMEOUT);
 			if (retval != ERROR_OK)
 				return retval;
 
@@ -875,15 +878,19 @@ static int nrf51_ll_flash_write(struct nrf51_info *chip, uint32_t offset, const
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer start */
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* buffer end */
 	init_reg_param(&reg_params[3], "r3", 32, PARAM_IN_OUT);	/* target address */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);	/* NVMC_READY */
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);	/* page mask or 0 */
 
 	buf_set_u32(reg_params[0].value, 0, 32, bytes);
 	buf_set_u32(reg_params[1].value, 0, 32, source->address);
 	buf_set_u32(reg_params[2].value, 0, 32, source->address + source->size);
 	buf_set_u32(reg_params[3].value, 0, 32, address);
+	buf_set_u32(reg_params[4].value, 0, 32, NRF51_NVMC_READY);
+	buf_set_u32(reg_params[5].value, 0, 32, erase ? chip->code_page_size - 1 : 0);
 
 	retval = target_run_flash_async_algorithm(target, buffer, bytes/4, 4,
 			0, NULL,
-			4, reg_params,
+			6, reg_params,
 			source->address, source->size,
 			write_algorithm->address, 0,
 			&armv7m_info);
@@ -895,12 +902,16 @@ static int nrf51_ll_flash_write(struct nrf51_info *chip, uint32_t offset, const
 	destroy_reg_param(&reg_params[1]);
 	destroy_reg_param(&reg_params[2]);
 	destroy_reg_param(&reg_params[3]);
+	destroy_reg_param(&reg_params[4]);
+	destroy_reg_param(&reg_params[5]);
 
 	return retval;
 }
 
 /* Check and erase flash sectors in specified range then start a low level page write.
-   start/end must be sector aligned.
+   start/end must be sector aligned.  If none of the sectors is known to be
+   blank the loader erases them as it goes instead of the host erasing and
+   polling each page first.
 */
 static int nrf51_write_pages(struct flash_bank *bank, uint32_t start, uint32_t end, const uint8_t *buffer)
 {
@@ -908,11 +919,12 @@ static int nrf51_write_pages(struct flash_bank *bank, uint32_t start, uint32_t e
 	struct nrf51_info *chip = bank->driver_priv;
 	struct flash_sector *sector;
 	uint32_t offset;
+	bool erase_all = true;
 
 	assert(start % chip->code_page_size == 0);
 	assert(end % chip->code_page_size == 0);
 
-	/* Erase all sectors */
+	/* Check all sectors */
 	for (offset = start; offset < end; offset += chip->code_page_size) {
 		sector = nrf51_find_sector_by_address(bank, offset);
 		if (!sector) {
@@ -925,7 +937,26 @@ static int nrf51_write_pages(struct flash_bank *bank, uint32_t start, uint32_t e
 			goto error;
 		}
 
-		if (sector->is_erased != 1) {	/* 1 = erased, 0= not erased, -1 = unknown */
+		if (sector->is_erased == 1)	/* 1 = erased, 0= not erased, -1 = unknown */
+			erase_all = false;
+	}
+
+	if (erase_all) {
+		res = nrf51_nvmc_write_enable(chip);
+		if (res != ERROR_OK)
+			goto error;
+
+		res = nrf51_ll_flash_write(chip, start, buffer, (end - start), true);
+		if (res == ERROR_OK)
+			goto written;
+		if (res != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			goto set_read_only;
+	}
+
+	/* Erase all sectors */
+	for (offset = start; offset < end; offset += chip->code_page_size) {
+		sector = nrf51_find_sector_by_address(bank, offset);
+		if (sector->is_erased != 1) {
 			res = nrf51_erase_page(bank, chip, sector);
 			if (res != ERROR_OK) {
 				LOG_ERROR("Failed to erase sector @ 0x%08"PRIx32, sector->offset);
@@ -939,10 +970,11 @@ static int nrf51_write_pages(struct flash_bank *bank, uint32_t start, uint32_t e
 	if (res != ERROR_OK)
 		goto error;
 
-	res = nrf51_ll_flash_write(chip, start, buffer, (end - start));
+	res = nrf51_ll_flash_write(chip, start, buffer, (end - start), false);
 	if (res != ERROR_OK)
 		goto set_read_only;
 
+written:
 	return nrf51_nvmc_read_only(chip);
 
 set_read_only:
@@ -1051,7 +1083,7 @@ static int nrf51_uicr_flash_write(struct flash_bank *bank,
 
 	memcpy(&uicr[offset], buffer, count);
 
-	res = nrf51_ll_flash_write(chip, NRF51_UICR_BASE, uicr, NRF51_UICR_SIZE);
+	res = nrf51_ll_flash_write(chip, NRF51_UICR_BASE, uicr, NRF51_UICR_SIZE, false);
 	if (res != ERROR_OK) {
 		nrf51_nvmc_read_only(chip);
 		return res;
@@ -28,6 +28,7 @@
 #include <target/algorithm.h>
 #include <target/armv7m.h>
 #include <helper/types.h>
+#include <helper/time_support.h>
 
 /* nRF52 Register addresses used by openOCD. */
 #define NRF52_FLASH_BASE_ADDR        (0x0)
@@ -57,6 +58,11 @@ enum nrf52_nvmc_ready_bits {
 	NRF52_NVMC_READY = 0x01
 };
 
+/* NVMC_READY timeouts in ms: CONFIG changes and single word writes, and
+ * erases (ERASEALL takes a few hundred ms on the larger parts). */
+#define NRF52_NVMC_TIMEOUT           100
+#define NRF52_NVMC_ERASE_TIMEOUT     2000
+
 /* nRF52 state information. */
 struct nrf52_info {
 	uint32_t code_page_size; /* Size of FLASH page in bytes. */
@@ -154,13 +160,17 @@ static int nrf52_auto_probe(struct flash_bank *bank)
 		return ERROR_OK;
 }
 
-static int nrf52_wait_for_nvmc(struct nrf52_info *chip)
+/* Poll NVMC READY right away, then back off up to 10ms between reads so
+ * long erases don't flood the adapter while short operations still return
+ * on the first read. */
+static int nrf52_wait_for_nvmc(struct nrf52_info *chip, int timeout_ms)
 {
-	int res;
 	uint32_t ready;
-	int timeout = 100;
+	int res;
+	int poll_delay = 0;
+	int64_t then = timeval_ms();
 
-	do {
+	for (;;) {
 		res = target_read_u32(chip->target, NRF52_NVMC_READY_ADDR, &ready);
 		if (res != ERROR_OK) {
 			LOG_ERROR("Couldn't read NVMC_READY register");
@@ -170,10 +180,15 @@ static int nrf52_wait_for_nvmc(struct nrf52_info *chip)
 		if (ready == NRF52_NVMC_READY)
 			return ERROR_OK;
 
-		alive_sleep(1);
-	} while (timeout--);
+		if (timeval_ms() - then > timeout_ms)
+			break;
+
+		if (poll_delay)
+			alive_sleep(poll_delay);
+		poll_delay = poll_delay ? MIN(poll_delay * 2, 10) : 1;
+	}
 
-	LOG_DEBUG("Timed out waiting for the NVMC to be ready");
+	LOG_DEBUG("Timed out waiting for NVMC_READY");
 	return ERROR_FLASH_BUSY;
 }
 
@@ -181,7 +196,7 @@ static int nrf52_nvmc_erase_enable(struct nrf52_info *chip)
 {
 	int res;
 
-	res = nrf52_wait_for_nvmc(chip);
+	res = nrf52_wait_for_nvmc(chip, NRF52_NVMC_TIMEOUT);
 	if (res != ERROR_OK)
 		return res;
 
@@ -200,7 +215,7 @@ static int nrf52_nvmc_write_enable(struct nrf52_info *chip)
 {
 	int res;
 
-	res = nrf52_wait_for_nvmc(chip);
+	res = nrf52_wait_for_nvmc(chip, NRF52_NVMC_TIMEOUT);
 	if (res != ERROR_OK)
 		return res;
 
@@ -219,7 +234,7 @@ static int nrf52_nvmc_read_only(struct nrf52_info *chip)
 {
 	int res;
 
-	res = nrf52_wait_for_nvmc(chip);
+	res = nrf52_wait_for_nvmc(chip, NRF52_NVMC_TIMEOUT);
 	if (res != ERROR_OK)
 		return res;
 
@@ -247,8 +262,18 @@ static int nrf52_nvmc_generic_erase(struct nrf52_info *chip,
 	res = target_write_u32(chip->target,
 						erase_register,
 						erase_value);
-	if (res != ERROR_OK)
+	if (res != ERROR_OK) {
 		LOG_ERROR("Failed to write NVMC erase register");
+		nrf52_nvmc_read_only(chip);
+		return res;
+	}
+
+	res = nrf52_wait_for_nvmc(chip, NRF52_NVMC_ERASE_TIMEOUT);
+	if (res != ERROR_OK) {
+		LOG_ERROR("Erase did not complete");
+		nrf52_nvmc_read_only(chip);
+		return res;
+	}
 
 	return nrf52_nvmc_read_only(chip);
 }
@@ -315,38 +340,23 @@ static int nrf52_erase_page(struct flash_bank *bank,
 }
 
 static const uint8_t nrf52_flash_write_code[] = {
-	/* See contrib/loaders/flash/cortex-m0.S */
-	/* <wait_fifo>: */
-	0x0d, 0x68,		/* ldr	r5,	[r1,	#0] */
-	0x00, 0x2d,		/* cmp	r5,	#0 */
-	0x0b, 0xd0,		/* beq.n	1e <exit> */
-	0x4c, 0x68,		/* ldr	r4,	[r1,	#4] */
-	0xac, 0x42,		/* cmp	r4,	r5 */
-	0xf9, 0xd0,		/* beq.n	0 <wait_fifo> */
-	0x20, 0xcc,		/* ldmia	r4!,	{r5} */
-	0x20, 0xc3,		/* stmia	r3!,	{r5} */
-	0x94, 0x42,		/* cmp	r4,	r2 */
-	0x01, 0xd3,		/* bcc.n	18 <no_wrap> */
-	0x0c, 0x46,		/* mov	r4,	r1 */
-	0x08, 0x34,		/* adds	r4,	#8 */
-	/* <no_wrap>: */
-	0x4c, 0x60,		/* str	r4, [r1,	#4] */
-	0x04, 0x38,		/* subs	r0, #4 */
-	0xf0, 0xd1,		/* bne.n	0 <wait_fifo> */
-	/* <exit>: */
-	0x00, 0xbe		/* bkpt	0x0000 */
+	/* See contrib/loaders/flash/nrf5/write.S */
+#include "../../../contrib/loaders/flash/nrf5/write.inc"
 };
 
 
-/* Start a low level flash write for the specified region */
-static int nrf52_ll_flash_write(struct nrf52_info *chip, uint32_t offset, const uint8_t *buffer, uint32_t bytes)
+/* Start a low level flash write for the specified region.  With erase set
+ * the loader erases each page before programming it; that needs a working
+ * area, ERROR_TARGET_RESOURCE_NOT_AVAILABLE is returned without one. */
+static int nrf52_ll_flash_write(struct nrf52_info *chip, uint32_t offset, const uint8_t *buffer, uint32_t bytes,
+		bool erase)
 {
 	struct target *target = chip->target;
 	uint32_t buffer_size = 8192;
 	struct working_area *write_algorithm;
 	struct working_area *source;
 	uint32_t address = NRF52_FLASH_BASE_ADDR + offset;
-	struct reg_param reg_params[4];
+	struct reg_param reg_params[6];
 	struct armv7m_algorithm armv7m_info;
 	int retval = ERROR_OK;
 
@@ -356,6 +366,9 @@ static int nrf52_ll_flash_write(struct nrf52_info *chip, uint32_t offset, const
 	/* allocate working area with flash programming code */
 	if (target_alloc_working_area(target, sizeof(nrf52_flash_write_code),
 			&write_algorithm) != ERROR_OK) {
+		if (erase)
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
 		LOG_WARNING("no working area available, falling back to slow memory writes");
 
 		for (; bytes > 0; bytes -= 4) {
@@ -364,7 +377,7 @@ static int nrf52_ll_flash_write(struct nrf52_info *chip, uint32_t offset, const
 			if (retval != ERROR_OK)
 				return retval;
 
-			retval = nrf52_wait_for_nvmc(chip);
+			retval = nrf52_wait_for_nvmc(chip, NRF52_NVMC_TIMEOUT);
 			if (retval != ERROR_OK)
 				return retval;
 
@@ -405,15 +418,19 @@ static int nrf52_ll_flash_write(struct nrf52_info *chip, uint32_t offset, const
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer start */
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* buffer end */
 	init_reg_param(&reg_params[3], "r3", 32, PARAM_IN_OUT);	/* target address */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);	/* NVMC_READY */
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);	/* page mask or 0 */
 
 	buf_set_u32(reg_params[0].value, 0, 32, bytes);
 	buf_set_u32(reg_params[1].value, 0, 32, source->address);
 	buf_set_u32(reg_params[2].value, 0, 32, source->address + source->size);
 	buf_set_u32(reg_params[3].value, 0, 32, address);
+	buf_set_u32(reg_params[4].value, 0, 32, NRF52_NVMC_READY_ADDR);
+	buf_set_u32(reg_params[5].value, 0, 32, erase ? chip->code_page_size - 1 : 0);
 
 	retval = target_run_flash_async_algorithm(target, buffer, bytes/4, 4,
 			0, NULL,
-			4, reg_params,
+			6, reg_params,
 			source->address, source->size,
 			write_algorithm->address, 0,
 			&armv7m_info);
@@ -425,12 +442,16 @@ static int nrf52_ll_flash_write(struct nrf52_info *chip, uint32_t offset, const
 	destroy_reg_param(&reg_params[1]);
 	destroy_reg_param(&reg_params[2]);
 	destroy_reg_param(&reg_params[3]);
+	destroy_reg_param(&reg_params[4]);
+	destroy_reg_param(&reg_params[5]);
 
 	return retval;
 }
 
 /* Check and erase flash sectors in specified range, then start a low level page write.
-   start/end must be sector aligned.
+   start/end must be sector aligned.  If none of the sectors is known to be
+   blank the loader erases them as it goes instead of the host erasing and
+   polling each page first.
 */
 static int nrf52_write_pages(struct flash_bank *bank, uint32_t start, uint32_t end, const uint8_t *buffer)
 {
@@ -438,12 +459,13 @@ static int nrf52_write_pages(struct flash_bank *bank, uint32_t start, uint32_t e
 	uint32_t offset;
 	struct flash_sector *sector;
 	struct nrf52_info *chip = bank->driver_priv;
+	bool erase_all = true;
 	assert(chip != NULL);
 
 	assert(start % chip->code_page_size == 0);
 	assert(end % chip->code_page_size == 0);
 
-	/* Erase all sectors */
+	/* Check all sectors */
 	for (offset = start; offset < end; offset += chip->code_page_size) {
 		sector = nrf52_find_sector_by_address(bank, offset);
 
@@ -457,6 +479,29 @@ static int nrf52_write_pages(struct flash_bank *bank, uint32_t start, uint32_t e
 			return ERROR_FAIL;
 		}
 
+		if (sector->is_erased == 1)	/* 1 = erased, 0= not erased, -1 = unknown */
+			erase_all = false;
+	}
+
+	if (erase_all) {
+		res = nrf52_nvmc_write_enable(chip);
+		if (res != ERROR_OK)
+			return res;
+
+		res = nrf52_ll_flash_write(chip, start, buffer, (end - start), true);
+		if (res == ERROR_OK)
+			return nrf52_nvmc_read_only(chip);
+		if (res != ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+			LOG_ERROR("Failed to write FLASH");
+			nrf52_nvmc_read_only(chip);
+			return res;
+		}
+	}
+
+	/* Erase all sectors */
+	for (offset = start; offset < end; offset += chip->code_page_size) {
+		sector = nrf52_find_sector_by_address(bank, offset);
+
 		if (sector->is_erased != 1) {	/* 1 = erased, 0= not erased, -1 = unknown */
 			res = nrf52_erase_page(bank, chip, sector);
 			if (res != ERROR_OK) {
@@ -464,14 +509,14 @@ static int nrf52_write_pages(struct flash_bank *bank, uint32_t start, uint32_t e
 				return res;
 			}
 		}
-		sector->is_erased = 1;
+		sector->is_erased = 0;
 	}
 
 	res = nrf52_nvmc_write_enable(chip);
 	if (res != ERROR_OK)
 		return res;
 
-	res = nrf52_ll_flash_write(chip, start, buffer, (end - start));
+	res = nrf52_ll_flash_write(chip, start, buffer, (end - start), false);
 	if (res != ERROR_OK) {
 		LOG_ERROR("Failed to write FLASH");
 		nrf52_nvmc_read_only(chip);
@@ -565,7 +610,7 @@ static int nrf52_uicr_flash_write(struct flash_bank *bank,
 	if (res != ERROR_OK)
 		return res;
 
-	res = nrf52_ll_flash_write(chip, NRF52_UICR_BASE_ADDR, uicr, nrf52_uicr_size);
+	res = nrf52_ll_flash_write(chip, NRF52_UICR_BASE_ADDR, uicr, nrf52_uicr_size, false);
 	if (res != ERROR_OK) {
 		nrf52_nvmc_read_only(chip);
 		return res;
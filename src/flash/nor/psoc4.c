@@ -513,6 +513,134 @@ COMMAND_HANDLER(psoc4_handle_flash_autoerase_command)
 }
 
 
+static const uint8_t psoc4_flash_write_code[] = {
+	/* See contrib/loaders/flash/psoc4/write.S */
+#include "../../../contrib/loaders/flash/psoc4/write.inc"
+};
+
+/* Program whole rows with the loader, which makes the SROM calls for each
+ * row on the target.  The sum of the SROM row checksums it returns is
+ * compared against the data.  Without a working area
+ * ERROR_TARGET_RESOURCE_NOT_AVAILABLE is returned. */
+static int psoc4_write_block(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t row_num, uint32_t rows)
+{
+	struct psoc4_flash_bank *psoc4_info = bank->driver_priv;
+	struct target *target = bank->target;
+	uint32_t row_size = psoc4_info->row_size;
+	uint32_t buffer_rows = 16;
+	/* the SROM runs in an NMI on this stack, see psoc4_sysreq() */
+	const int stack_size = 256;
+	struct working_area *write_algorithm;
+	struct working_area *latch;
+	struct working_area *source;
+	struct reg_param reg_params[11];
+	struct armv7m_algorithm armv7m_info;
+	uint32_t checksum = 0;
+	uint8_t latch_params[8];
+	int retval;
+
+	retval = target_alloc_working_area(target,
+			DIV_ROUND_UP(sizeof(psoc4_flash_write_code), 8) * 8 + stack_size, &write_algorithm);
+	if (retval != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = target_write_buffer(target, write_algorithm->address,
+			sizeof(psoc4_flash_write_code), psoc4_flash_write_code);
+	if (retval != ERROR_OK)
+		goto cleanup_algo;
+
+	retval = target_alloc_working_area(target, 8 + row_size, &latch);
+	if (retval != ERROR_OK) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup_algo;
+	}
+
+	/* Load Latch from byte 0 of the latch, the whole row */
+	target_buffer_set_u32(target, latch_params, PSOC4_SROM_KEY1
+			| ((PSOC4_SROM_KEY2 + PSOC4_CMD_LOAD_LATCH) << 8));
+	target_buffer_set_u32(target, latch_params + 4, row_size - 1);
+	retval = target_write_buffer(target, latch->address, sizeof(latch_params), latch_params);
+	if (retval != ERROR_OK)
+		goto cleanup_latch;
+
+	while (target_alloc_working_area_try(target, 8 + buffer_rows * row_size,
+			&source) != ERROR_OK) {
+		buffer_rows /= 2;
+		if (buffer_rows < 2) {
+			LOG_WARNING("no large enough working area available, can't do block memory writes");
+			retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			goto cleanup_latch;
+		}
+	}
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* CPUSS_SYSREQ, status (out) */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer start */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[3], "r4", 32, PARAM_IN_OUT);	/* row number */
+	init_reg_param(&reg_params[4], "r5", 32, PARAM_OUT);	/* latch parameters */
+	init_reg_param(&reg_params[5], "r8", 32, PARAM_OUT);	/* row size */
+	init_reg_param(&reg_params[6], "r9", 32, PARAM_OUT);	/* program row key */
+	init_reg_param(&reg_params[7], "r10", 32, PARAM_OUT);	/* program row request */
+	init_reg_param(&reg_params[8], "r11", 32, PARAM_IN_OUT);	/* checksum sum */
+	init_reg_param(&reg_params[9], "r12", 32, PARAM_OUT);	/* row count */
+	init_reg_param(&reg_params[10], "sp", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, PSOC4_CPUSS_SYSREQ);
+	buf_set_u32(reg_params[1].value, 0, 32, source->address);
+	buf_set_u32(reg_params[2].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[3].value, 0, 32, row_num);
+	buf_set_u32(reg_params[4].value, 0, 32, latch->address);
+	buf_set_u32(reg_params[5].value, 0, 32, row_size);
+	buf_set_u32(reg_params[6].value, 0, 32, PSOC4_SROM_KEY1
+			| ((PSOC4_SROM_KEY2 + psoc4_info->cmd_program_row) << 8));
+	buf_set_u32(reg_params[7].value, 0, 32,
+			PSOC4_SROM_SYSREQ_BIT | psoc4_info->cmd_program_row);
+	buf_set_u32(reg_params[8].value, 0, 32, 0);
+	buf_set_u32(reg_params[9].value, 0, 32, rows);
+	buf_set_u32(reg_params[10].value, 0, 32,
+			write_algorithm->address + write_algorithm->size);
+
+	retval = target_run_flash_async_algorithm(target, buffer, rows, row_size,
+			0, NULL,
+			ARRAY_SIZE(reg_params), reg_params,
+			source->address, source->size,
+			write_algorithm->address, 0,
+			&armv7m_info);
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED) {
+		LOG_ERROR("SROM call failed with status 0x%08" PRIx32 " at row %" PRIu32,
+				buf_get_u32(reg_params[0].value, 0, 32),
+				buf_get_u32(reg_params[3].value, 0, 32));
+	} else if (retval == ERROR_OK) {
+		/* the SROM checksum of a row is the sum of its bytes */
+		for (uint32_t i = 0; i < rows * row_size; i++)
+			checksum += buffer[i];
+		checksum &= 0x0fffffff;
+
+		if (buf_get_u32(reg_params[8].value, 0, 32) != checksum) {
+			LOG_ERROR("checksum mismatch, flash 0x%07" PRIx32 ", data 0x%07" PRIx32,
+					buf_get_u32(reg_params[8].value, 0, 32), checksum);
+			retval = ERROR_FLASH_OPERATION_FAILED;
+		}
+	}
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	target_free_working_area(target, source);
+cleanup_latch:
+	target_free_working_area(target, latch);
+cleanup_algo:
+	target_free_working_area(target, write_algorithm);
+
+	return retval;
+}
+
+
 static int psoc4_write(struct flash_bank *bank, const uint8_t *buffer,
 		uint32_t offset, uint32_t count)
 {
@@ -547,6 +675,23 @@ static int psoc4_write(struct flash_bank *bank, const uint8_t *buffer,
 	bool save_poll = jtag_poll_get_enabled();
 	jtag_poll_set_enabled(false);
 
+	/* Rows are padded with zeros, as below */
+	uint32_t rows = DIV_ROUND_UP(row_offset + count, psoc4_info->row_size);
+	uint8_t *rows_buffer = calloc(rows, psoc4_info->row_size);
+	if (rows_buffer == NULL) {
+		LOG_ERROR("no memory for row buffer");
+		retval = ERROR_FAIL;
+		goto cleanup;
+	}
+	memcpy(rows_buffer + row_offset, buffer, count);
+	retval = psoc4_write_block(bank, rows_buffer, row_num, rows);
+	free(rows_buffer);
+	if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		goto cleanup;
+
+	LOG_WARNING("no working area for the write loader, calling the SROM row by row");
+	retval = ERROR_OK;
+
 	while (count) {
 		uint32_t chunk_size = psoc4_info->row_size - row_offset;
 		if (chunk_size > count) {
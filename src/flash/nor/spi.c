@@ -26,6 +26,8 @@
 #include "imp.h"
 #include "spi.h"
 #include <jtag/jtag.h>
+#include <helper/time_support.h>
+#include <target/algorithm.h>
 
  /* Shared table of known SPI flash devices for SPI-based flash drivers. Taken
   * from device datasheets and Linux SPI flash drivers. */
@@ -80,3 +82,256 @@ const struct flash_device flash_devices[] = {
 	FLASH_ID("gd gd25q128c",   0xd8, 0xc7, 0x001840c8, 0x100, 0x10000, 0x1000000),
 	FLASH_ID(NULL,             0,    0,	   0,          0,     0,       0)
 };
+
+/* register names for the loader parameters */
+static char *spi_nor_loader_regs[] = {
+	"r0", "r1", "r2", "r3", "r4", "r5", "r6"
+};
+
+/* Fail if any sector overlapping [offset, offset + count) is protected */
+int spi_nor_check_protection(struct flash_bank *bank, uint32_t offset, uint32_t count)
+{
+	for (int sector = 0; sector < bank->num_sectors; sector++) {
+		/* Start offset in or before this sector? */
+		/* End offset in or behind this sector? */
+		if ((offset <
+				(bank->sectors[sector].offset + bank->sectors[sector].size))
+			&& ((offset + count - 1) >= bank->sectors[sector].offset)
+			&& bank->sectors[sector].is_protected) {
+			LOG_ERROR("Flash sector %d protected", sector);
+			return ERROR_FAIL;
+		}
+	}
+	return ERROR_OK;
+}
+
+/* check for BSY bit in flash status register */
+/* timeout in ms */
+int spi_nor_wait_till_ready(struct flash_bank *bank, const struct spi_nor_ops *ops, int timeout)
+{
+	uint32_t status;
+	int retval;
+	int64_t endtime;
+
+	endtime = timeval_ms() + timeout;
+	do {
+		retval = ops->read_status(bank, &status);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if ((status & SPIFLASH_BSY_BIT) == 0)
+			return ERROR_OK;
+		alive_sleep(1);
+	} while (timeval_ms() < endtime);
+
+	LOG_ERROR("timeout waiting for flash to finish write/erase operation");
+	return ERROR_FAIL;
+}
+
+/* Send "write enable" command to SPI flash chip and check WEL */
+int spi_nor_write_enable(struct flash_bank *bank, const struct spi_nor_ops *ops)
+{
+	uint32_t status;
+	int retval;
+
+	retval = ops->command(bank, SPIFLASH_WRITE_ENABLE, NULL);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = ops->read_status(bank, &status);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if ((status & SPIFLASH_WE_BIT) == 0) {
+		LOG_ERROR("Cannot enable write to flash. Status=0x%08" PRIx32, status);
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+int spi_nor_bulk_erase(struct flash_bank *bank, const struct spi_nor_ops *ops,
+		const struct flash_device *dev, int timeout)
+{
+	int retval;
+
+	retval = spi_nor_write_enable(bank, ops);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = ops->command(bank, dev->chip_erase_cmd, NULL);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return spi_nor_wait_till_ready(bank, ops, timeout);
+}
+
+/* Host driven sector erase, timeout in ms per sector */
+int spi_nor_erase_sectors(struct flash_bank *bank, const struct spi_nor_ops *ops,
+		const struct flash_device *dev, int first, int last, int timeout)
+{
+	int retval;
+
+	for (int sector = first; sector <= last; sector++) {
+		retval = spi_nor_write_enable(bank, ops);
+		if (retval != ERROR_OK)
+			return retval;
+
+		retval = ops->command(bank, dev->erase_cmd, &bank->sectors[sector].offset);
+		if (retval != ERROR_OK)
+			return retval;
+
+		/* poll WIP for end of self timed Sector Erase cycle */
+		retval = spi_nor_wait_till_ready(bank, ops, timeout);
+		if (retval != ERROR_OK)
+			return retval;
+		keep_alive();
+	}
+	return ERROR_OK;
+}
+
+/* Program @count bytes at @offset with an async write loader */
+int spi_nor_loader_write(struct flash_bank *bank, const struct spi_nor_loader *loader,
+		const struct flash_device *dev, const uint8_t *buffer,
+		uint32_t offset, uint32_t count)
+{
+	struct target *target = bank->target;
+	struct reg_param reg_params[5 + SPI_NOR_LOADER_MAX_PARAMS];
+	struct working_area *write_algorithm;
+	struct working_area *fifo;
+	uint32_t fifo_size;
+	unsigned num_regs = 5 + loader->num_params;
+	int retval;
+
+	if (target_alloc_working_area(target, loader->code_size,
+			&write_algorithm) != ERROR_OK) {
+		LOG_ERROR("Insufficient working area. You must configure"
+			" a working area > %zdB in order to write to SPI flash.",
+			loader->code_size);
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	retval = target_write_buffer(target, write_algorithm->address,
+			loader->code_size, loader->code);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return retval;
+	}
+
+	/* FIFO allocation */
+	fifo_size = target_get_working_area_avail(target);
+
+	if (fifo_size == 0) {
+		/* if we already allocated the writing code but failed to get fifo
+		 * space, free the algorithm */
+		target_free_working_area(target, write_algorithm);
+
+		LOG_ERROR("Insufficient working area. Please allocate at least"
+			" %zdB of working area to enable flash writes.",
+			loader->code_size + 1);
+
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	} else if (fifo_size < dev->pagesize)
+		LOG_WARNING("Working area size is limited; flash writes may be"
+			" slow. Increase working area size to at least %zdB"
+			" to reduce write times.",
+			(size_t)(loader->code_size + dev->pagesize));
+	else if (loader->fifo_max && fifo_size > loader->fifo_max)
+		fifo_size = loader->fifo_max;
+
+	if (target_alloc_working_area(target, fifo_size, &fifo) != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* buffer start, status (out) */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* target address */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);	/* count */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);	/* page size */
+
+	buf_set_u32(reg_params[0].value, 0, 32, fifo->address);
+	buf_set_u32(reg_params[1].value, 0, 32, fifo->address + fifo->size);
+	buf_set_u32(reg_params[2].value, 0, 32, offset);
+	buf_set_u32(reg_params[3].value, 0, 32, count);
+	buf_set_u32(reg_params[4].value, 0, 32, dev->pagesize);
+
+	for (unsigned i = 5; i < num_regs; i++) {
+		init_reg_param(&reg_params[i], spi_nor_loader_regs[i], 32, PARAM_OUT);
+		buf_set_u32(reg_params[i].value, 0, 32, loader->params[i - 5]);
+	}
+
+	retval = target_run_flash_async_algorithm(target, buffer, count, 1,
+			0, NULL,
+			num_regs, reg_params,
+			fifo->address, fifo->size,
+			write_algorithm->address, 0,
+			loader->arch_info);
+
+	if (retval != ERROR_OK)
+		LOG_ERROR("Error executing flash write algorithm");
+
+	target_free_working_area(target, fifo);
+	target_free_working_area(target, write_algorithm);
+
+	for (unsigned i = 0; i < num_regs; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return retval;
+}
+
+/* Erase sectors @first to @last with an erase loader, timeout in ms per sector */
+int spi_nor_loader_erase(struct flash_bank *bank, const struct spi_nor_loader *loader,
+		const struct flash_device *dev, int first, int last, int timeout)
+{
+	struct target *target = bank->target;
+	struct reg_param reg_params[4 + SPI_NOR_LOADER_MAX_PARAMS];
+	struct working_area *erase_algorithm;
+	unsigned num_regs = 4 + loader->num_params;
+	int retval;
+
+	retval = target_alloc_working_area(target, loader->code_size,
+		&erase_algorithm);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Insufficient working area. You must configure a working"
+			" area of at least %zdB in order to erase SPI flash.",
+			loader->code_size);
+		return retval;
+	}
+
+	retval = target_write_buffer(target, erase_algorithm->address,
+		loader->code_size, loader->code);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, erase_algorithm);
+		return retval;
+	}
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* Start address */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* Sector count */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* Erase command */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);	/* Sector size */
+
+	buf_set_u32(reg_params[0].value, 0, 32, bank->sectors[first].offset);
+	buf_set_u32(reg_params[1].value, 0, 32, last - first + 1);
+	buf_set_u32(reg_params[2].value, 0, 32, dev->erase_cmd);
+	buf_set_u32(reg_params[3].value, 0, 32, bank->sectors[first].size);
+
+	for (unsigned i = 4; i < num_regs; i++) {
+		init_reg_param(&reg_params[i], spi_nor_loader_regs[i], 32, PARAM_OUT);
+		buf_set_u32(reg_params[i].value, 0, 32, loader->params[i - 4]);
+	}
+
+	retval = target_run_algorithm(target, 0, NULL, num_regs, reg_params,
+		erase_algorithm->address,
+		erase_algorithm->address + loader->code_size - 4,
+		timeout * (last - first + 1), loader->arch_info);
+
+	if (retval != ERROR_OK)
+		LOG_ERROR("Error executing flash erase algorithm");
+
+	target_free_working_area(target, erase_algorithm);
+
+	for (unsigned i = 0; i < num_regs; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return retval;
+}
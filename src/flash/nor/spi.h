@@ -58,4 +58,61 @@ extern const struct flash_device flash_devices[];
 #define SPIFLASH_FAST_READ		0x0B /* Fast Read */
 #define SPIFLASH_READ			0x03 /* Normal Read */
 
+/* Shared SPI NOR routines, see spi.c.
+ *
+ * A controller driver provides the low level primitives below. The
+ * write enable, status polling and erase sequences are then common.
+ * Where the target can run code, the page programming and sector erase
+ * loops run on the target instead, see struct spi_nor_loader. */
+
+struct flash_bank;
+
+struct spi_nor_ops {
+	/* read the flash status register */
+	int (*read_status)(struct flash_bank *bank, uint32_t *status);
+	/* send a command byte, followed by a 24 bit address if addr is not NULL */
+	int (*command)(struct flash_bank *bank, uint8_t cmd, const uint32_t *addr);
+};
+
+#define SPI_NOR_LOADER_MAX_PARAMS 2
+
+/* On-target loader, entered at the start of the code.
+ *
+ * Write loaders run as async algorithms and stream the data from a fifo:
+ *   r0: fifo start, status on return
+ *   r1: fifo end
+ *   r2: flash offset
+ *   r3: byte count
+ *   r4: page size
+ * Erase loaders erase a range of sectors and stop at the breakpoint in
+ * their last word:
+ *   r0: offset of the first sector, status on return
+ *   r1: sector count
+ *   r2: erase command
+ *   r3: sector size
+ * Both poll the flash status on the target. Controller specific
+ * parameters follow in r5 (write) or r4 (erase) onwards. */
+struct spi_nor_loader {
+	const uint8_t *code;
+	size_t code_size;
+	/* upper limit of the write fifo size, 0 for none */
+	uint32_t fifo_max;
+	void *arch_info;
+	unsigned num_params;
+	uint32_t params[SPI_NOR_LOADER_MAX_PARAMS];
+};
+
+int spi_nor_check_protection(struct flash_bank *bank, uint32_t offset, uint32_t count);
+int spi_nor_wait_till_ready(struct flash_bank *bank, const struct spi_nor_ops *ops, int timeout);
+int spi_nor_write_enable(struct flash_bank *bank, const struct spi_nor_ops *ops);
+int spi_nor_bulk_erase(struct flash_bank *bank, const struct spi_nor_ops *ops,
+		const struct flash_device *dev, int timeout);
+int spi_nor_erase_sectors(struct flash_bank *bank, const struct spi_nor_ops *ops,
+		const struct flash_device *dev, int first, int last, int timeout);
+int spi_nor_loader_write(struct flash_bank *bank, const struct spi_nor_loader *loader,
+		const struct flash_device *dev, const uint8_t *buffer,
+		uint32_t offset, uint32_t count);
+int spi_nor_loader_erase(struct flash_bank *bank, const struct spi_nor_loader *loader,
+		const struct flash_device *dev, int first, int last, int timeout);
+
 #endif /* OPENOCD_FLASH_NOR_SPI_H */
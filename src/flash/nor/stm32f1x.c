@@ -86,6 +86,9 @@
 #define FLASH_WRPRTERR	(1 << 4)
 #define FLASH_EOP		(1 << 5)
 
+/* status of the write algorithm if a halfword did not read back as written */
+#define STM32_FLASH_MISMATCH	(1u << 31)
+
 /* STM32_FLASH_OBR bit definitions (reading) */
 
 #define OPT_ERROR		0
@@ -579,14 +582,12 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 		/* wait_fifo: */
 			0x16, 0x68,   /* ldr   r6, [r2, #0] */
 			0x00, 0x2e,   /* cmp   r6, #0 */
-			0x18, 0xd0,   /* beq   exit */
+			0x1e, 0xd0,   /* beq   exit */
 			0x55, 0x68,   /* ldr   r5, [r2, #4] */
 			0xb5, 0x42,   /* cmp   r5, r6 */
 			0xf9, 0xd0,   /* beq   wait_fifo */
 			0x2e, 0x88,   /* ldrh  r6, [r5, #0] */
 			0x26, 0x80,   /* strh  r6, [r4, #0] */
-			0x02, 0x35,   /* adds  r5, #2 */
-			0x02, 0x34,   /* adds  r4, #2 */
 		/* busy: */
 			0xc6, 0x68,   /* ldr   r6, [r0, #STM32_FLASH_SR_OFFSET] */
 			0x01, 0x27,   /* movs  r7, #1 */
@@ -594,7 +595,13 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 			0xfb, 0xd1,   /* bne   busy */
 			0x14, 0x27,   /* movs  r7, #0x14 */
 			0x3e, 0x42,   /* tst   r6, r7 */
-			0x08, 0xd1,   /* bne   error */
+			0x10, 0xd1,   /* bne   error */
+			0x26, 0x88,   /* ldrh  r6, [r4, #0] */
+			0x2f, 0x88,   /* ldrh  r7, [r5, #0] */
+			0xbe, 0x42,   /* cmp   r6, r7 */
+			0x0a, 0xd1,   /* bne   mismatch */
+			0x02, 0x35,   /* adds  r5, #2 */
+			0x02, 0x34,   /* adds  r4, #2 */
 			0x9d, 0x42,   /* cmp   r5, r3 */
 			0x01, 0xd3,   /* bcc   no_wrap */
 			0x15, 0x46,   /* mov   r5, r2 */
@@ -603,8 +610,11 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 			0x55, 0x60,   /* str   r5, [r2, #4] */
 			0x01, 0x39,   /* subs  r1, r1, #1 */
 			0x00, 0x29,   /* cmp   r1, #0 */
-			0x02, 0xd0,   /* beq   exit */
-			0xe5, 0xe7,   /* b     wait_fifo */
+			0x04, 0xd0,   /* beq   exit */
+			0xe1, 0xe7,   /* b     wait_fifo */
+		/* mismatch: */
+			0x01, 0x26,   /* movs  r6, #1 */
+			0xf6, 0x07,   /* lsls  r6, r6, #STM32_FLASH_MISMATCH_BIT */
 		/* error: */
 			0x00, 0x20,   /* movs  r0, #0 */
 			0x50, 0x60,   /* str   r0, [r2, #4] */
@@ -614,14 +624,10 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	};
 
 	/* flash write code */
-	if (target_alloc_working_area(target, sizeof(stm32x_flash_write_code),
-			&write_algorithm) != ERROR_OK) {
+	retval = target_alloc_working_area_code(target, stm32x_flash_write_code,
+			sizeof(stm32x_flash_write_code), &write_algorithm);
+	if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
 		LOG_WARNING("no working area available, can't do block memory writes");
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	}
-
-	retval = target_write_buffer(target, write_algorithm->address,
-			sizeof(stm32x_flash_write_code), stm32x_flash_write_code);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -665,6 +671,9 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 		LOG_ERROR("flash write failed at address 0x%"PRIx32,
 				buf_get_u32(reg_params[4].value, 0, 32));
 
+		if (buf_get_u32(reg_params[0].value, 0, 32) & STM32_FLASH_MISMATCH)
+			LOG_ERROR("flash memory reads back different data than written");
+
 		if (buf_get_u32(reg_params[0].value, 0, 32) & FLASH_PGERR) {
 			LOG_ERROR("flash memory not erased before writing");
 			/* Clear but report errors */
@@ -738,6 +747,8 @@ static int stm32x_write(struct flash_bank *bank, const uint8_t *buffer,
 
 	/* try using a block write */
 	retval = stm32x_write_block(bank, buffer, offset, words_remaining);
+	if (retval == ERROR_OK)
+		bank->write_verified = true;	/* the loader compares every halfword */
 
 	if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
 		/* if block write failed (no sufficient working area),
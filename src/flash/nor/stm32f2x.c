@@ -121,6 +121,9 @@
 #define FLASH_PSIZE_16 (1 << 8)
 #define FLASH_PSIZE_32 (2 << 8)
 #define FLASH_PSIZE_64 (3 << 8)
+#define FLASH_PSIZE_AUTO (-1)
+/* bytes programmed at once with the given PSIZE */
+#define FLASH_PSIZE_BYTES(p) (1 << ((p) >> 8))
 /* The sector number encoding is not straight binary for dual bank flash.
  * Warning: evaluates the argument multiple times */
 #define FLASH_SNB(a)   ((((a) >= 12) ? 0x10 | ((a) - 12) : (a)) << 3)
@@ -152,6 +155,9 @@
 #define OPT_BFB2       5	/* dual flash bank only */
 #define OPT_DB1M       14	/* 1 MiB devices dual flash bank option */
 
+/* STM32_FLASH_OPTCR brown out reset level, 3 (off) tells nothing about the supply */
+#define OPT_BOR_LEV(optcr)	(((optcr) >> 2) & 3)
+
 /* register unlock keys */
 
 #define KEY1           0x45670123
@@ -172,6 +178,8 @@ struct stm32x_flash_bank {
 	int probed;
 	bool has_large_mem;		/* stm32f42x/stm32f43x family */
 	uint32_t user_bank_size;
+	int psize;			/* FLASH_PSIZE_x, or FLASH_PSIZE_AUTO */
+	unsigned int vdd_mv;		/* configured supply, 0 if unknown */
 };
 
 /* flash bank stm32x <base> <size> 0 0 <target#>
@@ -188,6 +196,8 @@ FLASH_BANK_COMMAND_HANDLER(stm32x_flash_bank_command)
 
 	stm32x_info->probed = 0;
 	stm32x_info->user_bank_size = bank->size;
+	stm32x_info->psize = FLASH_PSIZE_AUTO;
+	stm32x_info->vdd_mv = 0;
 
 	return ERROR_OK;
 }
@@ -411,9 +421,37 @@ static int stm32x_protect_check(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
+/* The widest program parallelism the supply allows: x32 needs at least
+ * 2.7 V, x16 2.1 V and x8 works down to 1.8 V.  x64 also needs an external
+ * VPP, so it is only used when selected with "stm32f2x psize". */
+static int stm32x_get_psize(struct flash_bank *bank)
+{
+	struct stm32x_flash_bank *stm32x_info = bank->driver_priv;
+	static const unsigned int bor_min_mv[] = { 2700, 2400, 2100, 0 };
+	unsigned int vdd_mv = stm32x_info->vdd_mv;
+	uint32_t optiondata;
+
+	if (stm32x_info->psize != FLASH_PSIZE_AUTO)
+		return stm32x_info->psize;
+
+	/* an enabled brown out reset guarantees the minimum supply */
+	if (vdd_mv == 0 &&
+			target_read_u32(bank->target, STM32_FLASH_OPTCR, &optiondata) == ERROR_OK)
+		vdd_mv = bor_min_mv[OPT_BOR_LEV(optiondata)];
+
+	if (vdd_mv == 0)
+		return FLASH_PSIZE_16;	/* unknown supply, what was always used */
+	if (vdd_mv >= 2700)
+		return FLASH_PSIZE_32;
+	if (vdd_mv >= 2100)
+		return FLASH_PSIZE_16;
+	return FLASH_PSIZE_8;
+}
+
 static int stm32x_erase(struct flash_bank *bank, int first, int last)
 {
 	struct target *target = bank->target;
+	struct stm32x_flash_bank *stm32x_info = bank->driver_priv;
 	int i;
 
 	assert(first < bank->num_sectors);
@@ -440,6 +478,44 @@ static int stm32x_erase(struct flash_bank *bank, int first, int last)
 	4. Wait for the BSY bit to be cleared
 	 */
 
+	/* On dual bank devices a bank erased as a whole is one MER or MER1
+	 * operation instead of one per sector, and with both bits set the two
+	 * banks are erased in parallel. */
+	if (stm32x_info->has_large_mem && bank->num_sectors > 12) {
+		uint32_t flash_mer = 0;
+
+		if (first == 0 && last >= 11)
+			flash_mer |= FLASH_MER;
+		if (first <= 12 && last == bank->num_sectors - 1)
+			flash_mer |= FLASH_MER1;
+
+		if (flash_mer) {
+			retval = target_write_u32(target,
+					stm32x_get_flash_reg(bank, STM32_FLASH_CR), flash_mer);
+			if (retval != ERROR_OK)
+				return retval;
+			retval = target_write_u32(target,
+					stm32x_get_flash_reg(bank, STM32_FLASH_CR), flash_mer | FLASH_STRT);
+			if (retval != ERROR_OK)
+				return retval;
+
+			retval = stm32x_wait_status_busy(bank, 30000);
+			if (retval != ERROR_OK)
+				return retval;
+
+			if (flash_mer & FLASH_MER) {
+				for (i = 0; i < 12; i++)
+					bank->sectors[i].is_erased = 1;
+				first = 12;
+			}
+			if (flash_mer & FLASH_MER1) {
+				for (i = 12; i < bank->num_sectors; i++)
+					bank->sectors[i].is_erased = 1;
+				last = 11;
+			}
+		}
+	}
+
 	for (i = first; i <= last; i++) {
 		retval = target_write_u32(target,
 				stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_SER | FLASH_SNB(i) | FLASH_STRT);
@@ -492,16 +568,18 @@ static int stm32x_protect(struct flash_bank *bank, int set, int first, int last)
 	return ERROR_OK;
 }
 
+/* count is in units of the PSIZE */
 static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
-		uint32_t offset, uint32_t count)
+		uint32_t offset, uint32_t count, int psize)
 {
 	struct target *target = bank->target;
 	uint32_t buffer_size = 16384;
 	struct working_area *write_algorithm;
 	struct working_area *source;
 	uint32_t address = bank->base + offset;
-	struct reg_param reg_params[5];
+	struct reg_param reg_params[6];
 	struct armv7m_algorithm armv7m_info;
+	int block_size = FLASH_PSIZE_BYTES(psize);
 	int retval = ERROR_OK;
 
 	/* see contrib/loaders/flash/stm32f2x.S for src */
@@ -510,50 +588,86 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 									/* wait_fifo: */
 		0xD0, 0xF8, 0x00, 0x80,		/* ldr		r8, [r0, #0] */
 		0xB8, 0xF1, 0x00, 0x0F,		/* cmp		r8, #0 */
-		0x1A, 0xD0,					/* beq		exit */
+		0x50, 0xD0,					/* beq		exit */
 		0x47, 0x68,					/* ldr		r7, [r0, #4] */
 		0x47, 0x45,					/* cmp		r7, r8 */
 		0xF7, 0xD0,					/* beq		wait_fifo */
-
-		0xDF, 0xF8, 0x34, 0x60,		/* ldr		r6, STM32_PROG16 */
-		0x26, 0x61,					/* str		r6, [r4, #STM32_FLASH_CR_OFFSET] */
-		0x37, 0xF8, 0x02, 0x6B,		/* ldrh		r6, [r7], #0x02 */
-		0x22, 0xF8, 0x02, 0x6B,		/* strh		r6, [r2], #0x02 */
+		0x88, 0xBF,					/* it		hi */
+		0x88, 0x46,					/* movhi	r8, r1 */
+		0x07, 0xF5, 0x80, 0x79,		/* add		r9, r7, #BATCH */
+		0xC1, 0x45,					/* cmp		r9, r8 */
+		0x38, 0xBF,					/* it		lo */
+		0xC8, 0x46,					/* movlo	r8, r9 */
+		0x25, 0x61,					/* str		r5, [r4, #STM32_FLASH_CR_OFFSET] */
+		0x15, 0xF4, 0x00, 0x7F,		/* tst		r5, #0x200 */
+		0x26, 0xD1,					/* bne		word */
+		0x15, 0xF4, 0x80, 0x7F,		/* tst		r5, #0x100 */
+		0x11, 0xD1,					/* bne		half */
+									/* byte: */
+		0x17, 0xF8, 0x01, 0x6B,		/* ldrb	r6, [r7], #1 */
+		0x02, 0xF8, 0x01, 0x6B,		/* strb	r6, [r2], #1 */
 		0xBF, 0xF3, 0x4F, 0x8F,		/* dsb		sy */
-									/* busy: */
+									/* busy_byte: */
 		0xE6, 0x68,					/* ldr		r6, [r4, #STM32_FLASH_SR_OFFSET] */
 		0x16, 0xF4, 0x80, 0x3F,		/* tst		r6, #0x10000 */
-		0xFB, 0xD1,					/* bne		busy */
+		0xFB, 0xD1,					/* bne		busy_byte */
 		0x16, 0xF0, 0xF0, 0x0F,		/* tst		r6, #0xf0 */
-		0x07, 0xD1,					/* bne		error */
-
+		0x30, 0xD1,					/* bne		error */
+		0x5B, 0x1E,					/* subs	r3, r3, #1 */
+		0x26, 0xD0,					/* beq		batch_done */
+		0x47, 0x45,					/* cmp		r7, r8 */
+		0xEE, 0xD3,					/* blo		byte */
+		0x23, 0xE0,					/* b		batch_done */
+									/* half: */
+		0x37, 0xF8, 0x02, 0x6B,		/* ldrh	r6, [r7], #2 */
+		0x22, 0xF8, 0x02, 0x6B,		/* strh	r6, [r2], #2 */
+		0xBF, 0xF3, 0x4F, 0x8F,		/* dsb		sy */
+									/* busy_half: */
+		0xE6, 0x68,					/* ldr		r6, [r4, #STM32_FLASH_SR_OFFSET] */
+		0x16, 0xF4, 0x80, 0x3F,		/* tst		r6, #0x10000 */
+		0xFB, 0xD1,					/* bne		busy_half */
+		0x16, 0xF0, 0xF0, 0x0F,		/* tst		r6, #0xf0 */
+		0x1E, 0xD1,					/* bne		error */
+		0x5B, 0x1E,					/* subs	r3, r3, #1 */
+		0x14, 0xD0,					/* beq		batch_done */
+		0x47, 0x45,					/* cmp		r7, r8 */
+		0xEE, 0xD3,					/* blo		half */
+		0x11, 0xE0,					/* b		batch_done */
+									/* word: */
+		0x57, 0xF8, 0x04, 0x6B,		/* ldr		r6, [r7], #4 */
+		0x42, 0xF8, 0x04, 0x6B,		/* str		r6, [r2], #4 */
+		0xBF, 0xF3, 0x4F, 0x8F,		/* dsb		sy */
+									/* busy_word: */
+		0xE6, 0x68,					/* ldr		r6, [r4, #STM32_FLASH_SR_OFFSET] */
+		0x16, 0xF4, 0x80, 0x3F,		/* tst		r6, #0x10000 */
+		0xFB, 0xD1,					/* bne		busy_word */
+		0x16, 0xF0, 0xF0, 0x0F,		/* tst		r6, #0xf0 */
+		0x0C, 0xD1,					/* bne		error */
+		0x5B, 0x1E,					/* subs	r3, r3, #1 */
+		0x02, 0xD0,					/* beq		batch_done */
+		0x47, 0x45,					/* cmp		r7, r8 */
+		0xEE, 0xD3,					/* blo		word */
+		0xFF, 0xE7,					/* b		batch_done */
+									/* batch_done: */
 		0x8F, 0x42,					/* cmp		r7, r1 */
-		0x28, 0xBF,					/* it		cs */
-		0x00, 0xF1, 0x08, 0x07,		/* addcs	r7, r0, #8 */
+		0x28, 0xBF,					/* it		hs */
+		0x00, 0xF1, 0x08, 0x07,		/* addhs	r7, r0, #8 */
 		0x47, 0x60,					/* str		r7, [r0, #4] */
-		0x01, 0x3B,					/* subs		r3, r3, #1 */
-		0x13, 0xB1,					/* cbz		r3, exit */
-		0xDF, 0xE7,					/* b		wait_fifo */
+		0x00, 0x2B,					/* cmp		r3, #0 */
+		0xAC, 0xD1,					/* bne		wait_fifo */
+		0x01, 0xE0,					/* b		exit */
 									/* error: */
-		0x00, 0x21,					/* movs		r1, #0 */
+		0x00, 0x21,					/* movs	r1, #0 */
 		0x41, 0x60,					/* str		r1, [r0, #4] */
 									/* exit: */
 		0x30, 0x46,					/* mov		r0, r6 */
-		0x00, 0xBE,					/* bkpt		#0x00 */
-
-		/* <STM32_PROG16>: */
-		0x01, 0x01, 0x00, 0x00,		/* .word	0x00000101 */
+		0x00, 0xBE,					/* bkpt	#0 */
 	};
 
-	if (target_alloc_working_area(target, sizeof(stm32x_flash_write_code),
-			&write_algorithm) != ERROR_OK) {
+	retval = target_alloc_working_area_code(target, stm32x_flash_write_code,
+			sizeof(stm32x_flash_write_code), &write_algorithm);
+	if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
 		LOG_WARNING("no working area available, can't do block memory writes");
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	}
-
-	retval = target_write_buffer(target, write_algorithm->address,
-			sizeof(stm32x_flash_write_code),
-			stm32x_flash_write_code);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -576,18 +690,21 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);		/* buffer start, status (out) */
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);		/* buffer end */
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);		/* target address */
-	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);		/* count (halfword-16bit) */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);		/* count (accesses) */
 	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);		/* flash base */
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);		/* FLASH_CR, PG | PSIZE */
 
 	buf_set_u32(reg_params[0].value, 0, 32, source->address);
 	buf_set_u32(reg_params[1].value, 0, 32, source->address + source->size);
 	buf_set_u32(reg_params[2].value, 0, 32, address);
-	buf_set_u32(reg_params[3].value, 0, 32, count);
+	/* x64 is fed to the flash interface as pairs of words */
+	buf_set_u32(reg_params[3].value, 0, 32, psize == FLASH_PSIZE_64 ? count * 2 : count);
 	buf_set_u32(reg_params[4].value, 0, 32, STM32_FLASH_BASE);
+	buf_set_u32(reg_params[5].value, 0, 32, FLASH_PG | psize);
 
-	retval = target_run_flash_async_algorithm(target, buffer, count, 2,
+	retval = target_run_flash_async_algorithm(target, buffer, count, block_size,
 			0, NULL,
-			5, reg_params,
+			6, reg_params,
 			source->address, source->size,
 			write_algorithm->address, 0,
 			&armv7m_info);
@@ -616,80 +733,49 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	destroy_reg_param(&reg_params[2]);
 	destroy_reg_param(&reg_params[3]);
 	destroy_reg_param(&reg_params[4]);
+	destroy_reg_param(&reg_params[5]);
 
 	return retval;
 }
 
-static int stm32x_write(struct flash_bank *bank, const uint8_t *buffer,
-		uint32_t offset, uint32_t count)
+/*
+Standard programming
+The Flash memory programming sequence is as follows:
+1. Check that no main Flash memory operation is ongoing by checking the BSY bit in the
+  FLASH_SR register.
+2. Set the PG bit in the FLASH_CR register
+3. Perform the data write operation(s) to the desired memory address (inside main
+  memory block or OTP area):
+  - Half-word access in case of x16 parallelism
+  - Word access in case of x32 parallelism
+  - Byte access in case of x8 parallelism
+  - Double word access in case of x64 parallelism
+4. Wait for the BSY bit to be cleared
+
+Each access is as wide as the PSIZE allows, but no wider than the
+alignment of the address and the bytes left; narrower accesses are
+always allowed.  x64 is done with word accesses.
+*/
+static int stm32x_write_single(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t address, uint32_t count, int psize)
 {
 	struct target *target = bank->target;
-	uint32_t words_remaining = (count / 2);
-	uint32_t bytes_remaining = (count & 0x00000001);
-	uint32_t address = bank->base + offset;
-	uint32_t bytes_written = 0;
+	uint32_t max_size = MIN(FLASH_PSIZE_BYTES(psize), 4);
 	int retval;
 
-	if (bank->target->state != TARGET_HALTED) {
-		LOG_ERROR("Target not halted");
-		return ERROR_TARGET_NOT_HALTED;
-	}
-
-	if (offset & 0x1) {
-		LOG_WARNING("offset 0x%" PRIx32 " breaks required 2-byte alignment", offset);
-		return ERROR_FLASH_DST_BREAKS_ALIGNMENT;
-	}
-
-	retval = stm32x_unlock_reg(target);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* multiple half words (2-byte) to be programmed? */
-	if (words_remaining > 0) {
-		/* try using a block write */
-		retval = stm32x_write_block(bank, buffer, offset, words_remaining);
-		if (retval != ERROR_OK) {
-			if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
-				/* if block write failed (no sufficient working area),
-				 * we use normal (slow) single dword accesses */
-				LOG_WARNING("couldn't use block writes, falling back to single memory accesses");
-			}
-		} else {
-			buffer += words_remaining * 2;
-			address += words_remaining * 2;
-			words_remaining = 0;
-		}
-	}
-
-	if ((retval != ERROR_OK) && (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE))
-		return retval;
+	while (count > 0) {
+		uint32_t size = max_size;
 
-	/*
-	Standard programming
-	The Flash memory programming sequence is as follows:
-	1. Check that no main Flash memory operation is ongoing by checking the BSY bit in the
-	  FLASH_SR register.
-	2. Set the PG bit in the FLASH_CR register
-	3. Perform the data write operation(s) to the desired memory address (inside main
-	  memory block or OTP area):
-	– – Half-word access in case of x16 parallelism
-	– Word access in case of x32 parallelism
-	–
-	4.
-	Byte access in case of x8 parallelism
-	Double word access in case of x64 parallelism
-	Wait for the BSY bit to be cleared
-	*/
-	while (words_remaining > 0) {
-		uint16_t value;
-		memcpy(&value, buffer + bytes_written, sizeof(uint16_t));
+		while (size > 1 && (address % size || count < size))
+			size /= 2;
 
 		retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_CR),
-				FLASH_PG | FLASH_PSIZE_16);
+				FLASH_PG | (size == 4 ? FLASH_PSIZE_32 :
+					size == 2 ? FLASH_PSIZE_16 : FLASH_PSIZE_8));
 		if (retval != ERROR_OK)
 			return retval;
 
-		retval = target_write_u16(target, address, value);
+		retval = target_write_memory(target, address, size, 1, buffer);
 		if (retval != ERROR_OK)
 			return retval;
 
@@ -697,24 +783,62 @@ static int stm32x_write(struct flash_bank *bank, const uint8_t *buffer,
 		if (retval != ERROR_OK)
 			return retval;
 
-		bytes_written += 2;
-		words_remaining--;
-		address += 2;
+		buffer += size;
+		address += size;
+		count -= size;
 	}
 
-	if (bytes_remaining) {
-		retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_CR),
-				FLASH_PG | FLASH_PSIZE_8);
-		if (retval != ERROR_OK)
-			return retval;
-		retval = target_write_u8(target, address, buffer[bytes_written]);
-		if (retval != ERROR_OK)
-			return retval;
+	return ERROR_OK;
+}
 
-		retval = stm32x_wait_status_busy(bank, FLASH_WRITE_TIMEOUT);
-		if (retval != ERROR_OK)
-			return retval;
+static int stm32x_write(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t count)
+{
+	struct target *target = bank->target;
+	uint32_t address = bank->base + offset;
+	uint32_t unit, head, units, done;
+	int psize;
+	int retval;
+
+	if (bank->target->state != TARGET_HALTED) {
+		LOG_ERROR("Target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	retval = stm32x_unlock_reg(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	psize = stm32x_get_psize(bank);
+	unit = FLASH_PSIZE_BYTES(psize);
+	LOG_DEBUG("programming with x%" PRIu32 " parallelism", unit * 8);
+
+	/* The loader takes whole PSIZE units from an aligned address, the
+	 * bytes before and after them are programmed one by one below */
+	head = MIN((unit - offset % unit) % unit, count);
+	units = (count - head) / unit;
+
+	retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	if (units > 0) {
+		retval = stm32x_write_block(bank, buffer + head, offset + head, units, psize);
+		if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+			/* if block write failed (no sufficient working area),
+			 * we use normal (slow) single accesses */
+			LOG_WARNING("couldn't use block writes, falling back to single memory accesses");
+		}
+	}
+
+	if (retval == ERROR_OK) {
+		done = head + units * unit;
+		retval = stm32x_write_single(bank, buffer, address, head, psize);
+		if (retval == ERROR_OK)
+			retval = stm32x_write_single(bank, buffer + done, address + done,
+					count - done, psize);
+	} else if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+		retval = stm32x_write_single(bank, buffer, address, count, psize);
 	}
+	if (retval != ERROR_OK)
+		return retval;
 
 	return target_write_u32(target, STM32_FLASH_CR, FLASH_LOCK);
 }
@@ -1193,6 +1317,71 @@ COMMAND_HANDLER(stm32x_handle_mass_erase_command)
 	return retval;
 }
 
+COMMAND_HANDLER(stm32x_handle_psize_command)
+{
+	struct stm32x_flash_bank *stm32x_info;
+	int psize;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct flash_bank *bank;
+	int retval = CALL_COMMAND_HANDLER(flash_command_get_bank, 0, &bank);
+	if (ERROR_OK != retval)
+		return retval;
+
+	stm32x_info = bank->driver_priv;
+
+	if (CMD_ARGC == 2) {
+		if (strcmp(CMD_ARGV[1], "auto") == 0)
+			psize = FLASH_PSIZE_AUTO;
+		else if (strcmp(CMD_ARGV[1], "x8") == 0)
+			psize = FLASH_PSIZE_8;
+		else if (strcmp(CMD_ARGV[1], "x16") == 0)
+			psize = FLASH_PSIZE_16;
+		else if (strcmp(CMD_ARGV[1], "x32") == 0)
+			psize = FLASH_PSIZE_32;
+		else if (strcmp(CMD_ARGV[1], "x64") == 0)
+			psize = FLASH_PSIZE_64;
+		else
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		stm32x_info->psize = psize;
+	}
+
+	if (stm32x_info->psize == FLASH_PSIZE_AUTO)
+		command_print(CMD_CTX, "program size auto");
+	else
+		command_print(CMD_CTX, "program size x%d",
+				FLASH_PSIZE_BYTES(stm32x_info->psize) * 8);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(stm32x_handle_vdd_command)
+{
+	struct stm32x_flash_bank *stm32x_info;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct flash_bank *bank;
+	int retval = CALL_COMMAND_HANDLER(flash_command_get_bank, 0, &bank);
+	if (ERROR_OK != retval)
+		return retval;
+
+	stm32x_info = bank->driver_priv;
+
+	if (CMD_ARGC == 2)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], stm32x_info->vdd_mv);
+
+	if (stm32x_info->vdd_mv)
+		command_print(CMD_CTX, "supply %u mV", stm32x_info->vdd_mv);
+	else
+		command_print(CMD_CTX, "supply unknown");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration stm32x_exec_command_handlers[] = {
 	{
 		.name = "lock",
@@ -1215,6 +1404,22 @@ static const struct command_registration stm32x_exec_command_handlers[] = {
 		.usage = "bank_id",
 		.help = "Erase entire flash device.",
 	},
+	{
+		.name = "psize",
+		.handler = stm32x_handle_psize_command,
+		.mode = COMMAND_ANY,
+		.usage = "bank_id ['auto'|'x8'|'x16'|'x32'|'x64']",
+		.help = "Display or set the program parallelism, "
+			"auto picks it from the supply voltage.",
+	},
+	{
+		.name = "vdd",
+		.handler = stm32x_handle_vdd_command,
+		.mode = COMMAND_ANY,
+		.usage = "bank_id [millivolts]",
+		.help = "Display or set the supply voltage used to pick "
+			"the program parallelism, 0 if unknown.",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -447,21 +447,30 @@ static int stm32lx_write_half_pages(struct flash_bank *bank, const uint8_t *buff
 
 	int retval = ERROR_OK;
 
-	/* see contib/loaders/flash/stm32lx.S for src */
-
+	/* see contrib/loaders/flash/stm32lx.S for src */
 	static const uint8_t stm32lx_flash_write_code[] = {
-		/* write_word: */
-		0x00, 0x23,             /* movs r3, #0 */
-		0x04, 0xe0,             /* b test_done */
+		/* write: */
+		0x97, 0x08,             /* lsrs r7, r2, #2 */
+		0x03, 0xd0,             /* beq tail */
+
+		/* write_quad: */
+		0x78, 0xc9,             /* ldmia r1!, {r3, r4, r5, r6} */
+		0x78, 0xc0,             /* stmia r0!, {r3, r4, r5, r6} */
+		0x01, 0x3f,             /* subs r7, #1 */
+		0xfb, 0xd1,             /* bne write_quad */
+
+		/* tail: */
+		0x03, 0x27,             /* movs r7, #3 */
+		0x17, 0x40,             /* ands r7, r2 */
+		0x03, 0xd0,             /* beq exit */
 
 		/* write_word: */
-		0x51, 0xf8, 0x04, 0xcb, /* ldr ip, [r1], #4 */
-		0x40, 0xf8, 0x04, 0xcb, /* str ip, [r0], #4 */
-		0x01, 0x33,             /* adds r3, #1 */
+		0x08, 0xc9,             /* ldmia r1!, {r3} */
+		0x08, 0xc0,             /* stmia r0!, {r3} */
+		0x01, 0x3f,             /* subs r7, #1 */
+		0xfb, 0xd1,             /* bne write_word */
 
-		/* test_done: */
-		0x93, 0x42,             /* cmp r3, r2 */
-		0xf8, 0xd3,             /* bcc write_word */
+		/* exit: */
 		0x00, 0xbe,             /* bkpt 0 */
 	};
 
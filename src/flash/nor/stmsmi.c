@@ -205,76 +205,15 @@ static int read_status_reg(struct flash_bank *bank, uint32_t *status)
 	return ERROR_OK;
 }
 
-/* check for WIP (write in progress) bit in status register */
-/* timeout in ms */
-static int wait_till_ready(struct flash_bank *bank, int timeout)
-{
-	uint32_t status;
-	int retval;
-	int64_t endtime;
-
-	endtime = timeval_ms() + timeout;
-	do {
-		/* read flash status register */
-		retval = read_status_reg(bank, &status);
-		if (retval != ERROR_OK)
-			return retval;
-
-		if ((status & SPIFLASH_BSY_BIT) == 0)
-			return ERROR_OK;
-		alive_sleep(1);
-	} while (timeval_ms() < endtime);
-
-	LOG_ERROR("timeout");
-	return ERROR_FAIL;
-}
-
-/* Send "write enable" command to SPI flash chip.
- * The operation is triggered by setting SMI_WE bit, and SMI sends
- * the proper SPI command (0x06) */
-static int smi_write_enable(struct flash_bank *bank)
-{
-	struct target *target = bank->target;
-	struct stmsmi_flash_bank *stmsmi_info = bank->driver_priv;
-	uint32_t io_base = stmsmi_info->io_base;
-	uint32_t status;
-	int retval;
-
-	/* Enter in HW mode */
-	SMI_SET_HW_MODE(); /* AB: is this correct ?*/
-
-	/* clear transmit finished flag */
-	SMI_CLEAR_TFF();
-
-	/* Send write enable command */
-	SMI_WRITE_REG(SMI_CR2, stmsmi_info->bank_num | SMI_WE);
-
-	/* Poll transmit finished flag */
-	SMI_POLL_TFF(SMI_CMD_TIMEOUT);
-
-	/* read flash status register */
-	retval = read_status_reg(bank, &status);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Check write enabled */
-	if ((status & SPIFLASH_WE_BIT) == 0) {
-		LOG_ERROR("Cannot enable write to flash. Status=0x%08" PRIx32, status);
-		return ERROR_FAIL;
-	}
-
-	return ERROR_OK;
-}
-
-static uint32_t erase_command(struct stmsmi_flash_bank *stmsmi_info,
-	uint32_t offset)
+/* SMI_TR value for a command byte followed by a 24 bit address */
+static uint32_t addr_command(uint8_t command, uint32_t offset)
 {
 	union {
 		uint32_t command;
 		uint8_t x[4];
 	} cmd;
 
-	cmd.x[0] = stmsmi_info->dev->erase_cmd;
+	cmd.x[0] = command;
 	cmd.x[1] = offset >> 16;
 	cmd.x[2] = offset >> 8;
 	cmd.x[3] = offset;
@@ -282,40 +221,55 @@ static uint32_t erase_command(struct stmsmi_flash_bank *stmsmi_info,
 	return cmd.command;
 }
 
-static int smi_erase_sector(struct flash_bank *bank, int sector)
+/* Send a command to the SPI flash chip.
+ * "Write enable" is triggered by setting SMI_WE bit, and SMI sends
+ * the proper SPI command (0x06). Other commands are sent in SW mode. */
+static int smi_command(struct flash_bank *bank, uint8_t cmd, const uint32_t *addr)
 {
 	struct target *target = bank->target;
 	struct stmsmi_flash_bank *stmsmi_info = bank->driver_priv;
 	uint32_t io_base = stmsmi_info->io_base;
-	uint32_t cmd;
-	int retval;
 
-	retval = smi_write_enable(bank);
-	if (retval != ERROR_OK)
-		return retval;
+	if (cmd == SPIFLASH_WRITE_ENABLE) {
+		/* Enter in HW mode */
+		SMI_SET_HW_MODE(); /* AB: is this correct ?*/
+
+		/* clear transmit finished flag */
+		SMI_CLEAR_TFF();
+
+		/* Send write enable command */
+		SMI_WRITE_REG(SMI_CR2, stmsmi_info->bank_num | SMI_WE);
+
+		/* Poll transmit finished flag */
+		SMI_POLL_TFF(SMI_CMD_TIMEOUT);
+		return ERROR_OK;
+	}
 
-	/* Switch to SW mode to send sector erase command */
+	/* Switch to SW mode to send the command */
 	SMI_SET_SW_MODE();
 
 	/* clear transmit finished flag */
 	SMI_CLEAR_TFF();
 
-	/* send SPI command "block erase" */
-	cmd = erase_command(stmsmi_info, bank->sectors[sector].offset);
-	SMI_WRITE_REG(SMI_TR, cmd);
-	SMI_WRITE_REG(SMI_CR2, stmsmi_info->bank_num | SMI_SEND | SMI_TX_LEN_4);
+	if (addr) {
+		SMI_WRITE_REG(SMI_TR, addr_command(cmd, *addr));
+		SMI_WRITE_REG(SMI_CR2, stmsmi_info->bank_num | SMI_SEND | SMI_TX_LEN_4);
+	} else {
+		SMI_WRITE_REG(SMI_TR, cmd);
+		SMI_WRITE_REG(SMI_CR2, stmsmi_info->bank_num | SMI_SEND | SMI_TX_LEN_1);
+	}
 
 	/* Poll transmit finished flag */
 	SMI_POLL_TFF(SMI_CMD_TIMEOUT);
 
-	/* poll WIP for end of self timed Sector Erase cycle */
-	retval = wait_till_ready(bank, SMI_MAX_TIMEOUT);
-	if (retval != ERROR_OK)
-		return retval;
-
 	return ERROR_OK;
 }
 
+static const struct spi_nor_ops stmsmi_spi_ops = {
+	.read_status = read_status_reg,
+	.command = smi_command,
+};
+
 static int stmsmi_erase(struct flash_bank *bank, int first, int last)
 {
 	struct target *target = bank->target;
@@ -348,12 +302,8 @@ static int stmsmi_erase(struct flash_bank *bank, int first, int last)
 		}
 	}
 
-	for (sector = first; sector <= last; sector++) {
-		retval = smi_erase_sector(bank, sector);
-		if (retval != ERROR_OK)
-			break;
-		keep_alive();
-	}
+	retval = spi_nor_erase_sectors(bank, &stmsmi_spi_ops, stmsmi_info->dev,
+			first, last, SMI_MAX_TIMEOUT);
 
 	/* Switch to HW mode before return to prompt */
 	SMI_SET_HW_MODE();
@@ -381,7 +331,7 @@ static int smi_write_buffer(struct flash_bank *bank, const uint8_t *buffer,
 	LOG_DEBUG("%s: address=0x%08" PRIx32 " len=0x%08" PRIx32,
 			__func__, address, len);
 
-	retval = smi_write_enable(bank);
+	retval = spi_nor_write_enable(bank, &stmsmi_spi_ops);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -402,7 +352,6 @@ static int stmsmi_write(struct flash_bank *bank, const uint8_t *buffer,
 	struct stmsmi_flash_bank *stmsmi_info = bank->driver_priv;
 	uint32_t io_base = stmsmi_info->io_base;
 	uint32_t cur_count, page_size, page_offset;
-	int sector;
 	int retval = ERROR_OK;
 
 	LOG_DEBUG("%s: offset=0x%08" PRIx32 " count=0x%08" PRIx32,
@@ -418,18 +367,9 @@ static int stmsmi_write(struct flash_bank *bank, const uint8_t *buffer,
 		count = stmsmi_info->dev->size_in_bytes - offset;
 	}
 
-	/* Check sector protection */
-	for (sector = 0; sector < bank->num_sectors; sector++) {
-		/* Start offset in or before this sector? */
-		/* End offset in or behind this sector? */
-		if ((offset <
-				(bank->sectors[sector].offset + bank->sectors[sector].size))
-			&& ((offset + count - 1) >= bank->sectors[sector].offset)
-			&& bank->sectors[sector].is_protected) {
-			LOG_ERROR("Flash sector %d protected", sector);
-			return ERROR_FAIL;
-		}
-	}
+	retval = spi_nor_check_protection(bank, offset, count);
+	if (retval != ERROR_OK)
+		return retval;
 
 	page_size = stmsmi_info->dev->pagesize;
 
@@ -494,7 +434,7 @@ static int read_flash_id(struct flash_bank *bank, uint32_t *id)
 	}
 
 	/* poll WIP */
-	retval = wait_till_ready(bank, SMI_PROBE_TIMEOUT);
+	retval = spi_nor_wait_till_ready(bank, &stmsmi_spi_ops, SMI_PROBE_TIMEOUT);
 	if (retval != ERROR_OK)
 		return retval;
 
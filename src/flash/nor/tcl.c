@@ -358,30 +358,30 @@ COMMAND_HANDLER(handle_flash_protect_command)
 	return retval;
 }
 
-COMMAND_HANDLER(handle_flash_write_image_command)
+static COMMAND_HELPER(flash_write_image_options, int *auto_erase,
+	bool *auto_unlock, bool *incremental, bool *verify)
 {
-	struct target *target = get_current_target(CMD_CTX);
-
-	struct image image;
-	uint32_t written;
-
-	int retval;
-
-	/* flash auto-erase is disabled by default*/
-	int auto_erase = 0;
-	bool auto_unlock = false;
-
 	while (CMD_ARGC) {
 		if (strcmp(CMD_ARGV[0], "erase") == 0) {
-			auto_erase = 1;
+			*auto_erase = 1;
 			CMD_ARGV++;
 			CMD_ARGC--;
 			command_print(CMD_CTX, "auto erase enabled");
 		} else if (strcmp(CMD_ARGV[0], "unlock") == 0) {
-			auto_unlock = true;
+			*auto_unlock = true;
 			CMD_ARGV++;
 			CMD_ARGC--;
 			command_print(CMD_CTX, "auto unlock enabled");
+		} else if (strcmp(CMD_ARGV[0], "incremental") == 0) {
+			*incremental = true;
+			CMD_ARGV++;
+			CMD_ARGC--;
+			command_print(CMD_CTX, "incremental write enabled");
+		} else if (strcmp(CMD_ARGV[0], "verify") == 0) {
+			*verify = true;
+			CMD_ARGV++;
+			CMD_ARGC--;
+			command_print(CMD_CTX, "verify while writing enabled");
 		} else
 			break;
 	}
@@ -389,6 +389,45 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	if (CMD_ARGC < 1)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
+	return ERROR_OK;
+}
+
+/* open the image named by the remaining "filename [offset [file_type]]" */
+static COMMAND_HELPER(flash_write_image_open, struct image *image)
+{
+	if (CMD_ARGC >= 2) {
+		image->base_address_set = 1;
+		COMMAND_PARSE_NUMBER(llong, CMD_ARGV[1], image->base_address);
+	} else {
+		image->base_address_set = 0;
+		image->base_address = 0x0;
+	}
+
+	image->start_address_set = 0;
+
+	return image_open(image, CMD_ARGV[0], (CMD_ARGC == 3) ? CMD_ARGV[2] : NULL);
+}
+
+COMMAND_HANDLER(handle_flash_write_image_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	struct image image;
+	uint32_t written;
+
+	int retval;
+
+	/* flash auto-erase is disabled by default*/
+	int auto_erase = 0;
+	bool auto_unlock = false;
+	bool incremental = false;
+	bool verify = false;
+
+	retval = CALL_COMMAND_HANDLER(flash_write_image_options,
+			&auto_erase, &auto_unlock, &incremental, &verify);
+	if (retval != ERROR_OK)
+		return retval;
+
 	if (!target) {
 		LOG_ERROR("no target selected");
 		return ERROR_FAIL;
@@ -397,21 +436,12 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	struct duration bench;
 	duration_start(&bench);
 
-	if (CMD_ARGC >= 2) {
-		image.base_address_set = 1;
-		COMMAND_PARSE_NUMBER(llong, CMD_ARGV[1], image.base_address);
-	} else {
-		image.base_address_set = 0;
-		image.base_address = 0x0;
-	}
-
-	image.start_address_set = 0;
-
-	retval = image_open(&image, CMD_ARGV[0], (CMD_ARGC == 3) ? CMD_ARGV[2] : NULL);
+	retval = CALL_COMMAND_HANDLER(flash_write_image_open, &image);
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = flash_write_unlock(target, &image, &written, auto_erase, auto_unlock);
+	retval = flash_write_unlock(target, &image, &written, auto_erase,
+			auto_unlock, incremental, verify);
 	if (retval != ERROR_OK) {
 		image_close(&image);
 		return retval;
@@ -428,6 +458,70 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	return retval;
 }
 
+COMMAND_HANDLER(handle_flash_gang_write_image_command)
+{
+	struct image image;
+	int auto_erase = 0;
+	bool auto_unlock = false;
+	bool incremental = false;
+	bool verify = false;
+	int failed = 0;
+	int total = 0;
+	int retval;
+
+	if (CMD_ARGC < 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	char *targets = strdup(CMD_ARGV[0]);
+	if (targets == NULL)
+		return ERROR_FAIL;
+	CMD_ARGV++;
+	CMD_ARGC--;
+
+	retval = CALL_COMMAND_HANDLER(flash_write_image_options,
+			&auto_erase, &auto_unlock, &incremental, &verify);
+	if (retval == ERROR_OK)
+		retval = CALL_COMMAND_HANDLER(flash_write_image_open, &image);
+	if (retval != ERROR_OK) {
+		free(targets);
+		return retval;
+	}
+
+	/* the image is parsed once and shared by all targets */
+	for (char *name = strtok(targets, " \t"); name != NULL;
+			name = strtok(NULL, " \t")) {
+		struct target *target = get_target(name);
+		struct duration bench;
+		uint32_t written = 0;
+
+		total++;
+		if (target == NULL) {
+			command_print(CMD_CTX, "%s: no such target", name);
+			failed++;
+			continue;
+		}
+
+		duration_start(&bench);
+		retval = flash_write_unlock(target, &image, &written, auto_erase,
+				auto_unlock, incremental, verify);
+		if (retval != ERROR_OK) {
+			command_print(CMD_CTX, "%s: write failed (%d)", name, retval);
+			failed++;
+		} else if (duration_measure(&bench) == ERROR_OK) {
+			command_print(CMD_CTX, "%s: wrote %" PRIu32 " bytes from file %s "
+				"in %fs (%0.3f KiB/s)", name, written, CMD_ARGV[0],
+				duration_elapsed(&bench), duration_kbps(&bench, written));
+		}
+	}
+
+	image_close(&image);
+	free(targets);
+
+	command_print(CMD_CTX, "%d of %d target(s) programmed", total - failed, total);
+
+	return failed ? ERROR_FAIL : ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_flash_fill_command)
 {
 	int err = ERROR_OK;
@@ -730,7 +824,7 @@ COMMAND_HANDLER(handle_flash_verify_bank_command)
 		return ERROR_FAIL;
 	}
 
-	retval = flash_driver_read(p, buffer_flash, offset, read_cnt);
+	retval = flash_driver_read_verify(p, buffer_flash, buffer_file, offset, read_cnt);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("Flash read error");
 		free(buffer_flash);
@@ -878,11 +972,23 @@ static const struct command_registration flash_exec_command_handlers[] = {
 		.name = "write_image",
 		.handler = handle_flash_write_image_command,
 		.mode = COMMAND_EXEC,
-		.usage = "[erase] [unlock] filename [offset [file_type]]",
+		.usage = "[erase] [unlock] [incremental] [verify] filename "
+			"[offset [file_type]]",
 		.help = "Write an image to flash.  Optionally first unprotect "
-			"and/or erase the region to be used.  Allow optional "
+			"and/or erase the region to be used, or only touch "
+			"sectors whose contents differ, and verify what is "
+			"written.  Allow optional "
 			"offset from beginning of bank (defaults to zero)",
 	},
+	{
+		.name = "gang_write_image",
+		.handler = handle_flash_gang_write_image_command,
+		.mode = COMMAND_EXEC,
+		.usage = "target_list [erase] [unlock] [incremental] [verify] filename "
+			"[offset [file_type]]",
+		.help = "Write one image to the flash of each listed target "
+			"in turn, reporting the result for each.",
+	},
 	{
 		.name = "read_bank",
 		.handler = handle_flash_read_bank_command,
@@ -48,16 +48,18 @@ proc program {filename args} {
 		set flash_args "$filename"
 	}
 
-	if {[catch {eval flash write_image erase $flash_args}] == 0} {
+	# verification is done as each run is written, either by the flash
+	# loader itself or with a checksum of the run
+	if {[info exists verify]} {
+		set write_args "erase verify"
+	} else {
+		set write_args "erase"
+	}
+
+	if {[catch {eval flash write_image $write_args $flash_args}] == 0} {
 		echo "** Programming Finished **"
 		if {[info exists verify]} {
-			# verify phase
-			echo "** Verify Started **"
-			if {[catch {eval verify_image $flash_args}] == 0} {
-				echo "** Verified OK **"
-			} else {
-				program_error "** Verify Failed **" $exit
-			}
+			echo "** Verified OK **"
 		}
 
 		if {[info exists reset]} {
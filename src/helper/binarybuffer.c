@@ -123,47 +123,58 @@ void *buf_set_ones(void *_buf, unsigned size)
 	return buf;
 }
 
+/* copy len (< 8 when used below) single bits, advancing both cursors */
+static inline void buf_copy_bits(const uint8_t **src, unsigned *sq,
+	uint8_t **dst, unsigned *dq, unsigned len)
+{
+	for (unsigned i = 0; i < len; i++) {
+		if (((**src >> *sq) & 1) == 1)
+			**dst |= 1 << *dq;
+		else
+			**dst &= ~(1 << *dq);
+		if ((*sq)++ == 7) {
+			*sq = 0;
+			(*src)++;
+		}
+		if ((*dq)++ == 7) {
+			*dq = 0;
+			(*dst)++;
+		}
+	}
+}
+
 void *buf_set_buf(const void *_src, unsigned src_start,
 	void *_dst, unsigned dst_start, unsigned len)
 {
 	const uint8_t *src = _src;
 	uint8_t *dst = _dst;
-	unsigned i, sb, db, sq, dq, lb, lq;
+	unsigned i, sq, dq, lb;
 
-	sb = src_start / 8;
-	db = dst_start / 8;
+	src += src_start / 8;
+	dst += dst_start / 8;
 	sq = src_start % 8;
 	dq = dst_start % 8;
-	lb = len / 8;
-	lq = len % 8;
 
-	src += sb;
-	dst += db;
+	/* bring the destination to a byte boundary */
+	if (dq != 0) {
+		unsigned head = MIN(8 - dq, len);
+		buf_copy_bits(&src, &sq, &dst, &dq, head);
+		len -= head;
+	}
 
-	/* check if both buffers are on byte boundary and
-	 * len is a multiple of 8bit so we can simple copy
-	 * the buffer */
-	if ((sq == 0) && (dq == 0) &&  (lq == 0)) {
+	lb = len / 8;
+	if (sq == 0) {
+		/* both on byte boundary, copy whole bytes */
+		memmove(dst, src, lb);
+	} else {
+		/* each destination byte straddles two source bytes */
 		for (i = 0; i < lb; i++)
-			*dst++ = *src++;
-		return _dst;
+			dst[i] = (src[i] >> sq) | (src[i + 1] << (8 - sq));
 	}
+	src += lb;
+	dst += lb;
 
-	/* fallback to slow bit copy */
-	for (i = 0; i < len; i++) {
-		if (((*src >> (sq&7)) & 1) == 1)
-			*dst |= 1 << (dq&7);
-		else
-			*dst &= ~(1 << (dq&7));
-		if (sq++ == 7) {
-			sq = 0;
-			src++;
-		}
-		if (dq++ == 7) {
-			dq = 0;
-			dst++;
-		}
-	}
+	buf_copy_bits(&src, &sq, &dst, &dq, len % 8);
 
 	return _dst;
 }
@@ -181,6 +192,12 @@ uint32_t flip_u32(uint32_t value, unsigned int num)
 	return c;
 }
 
+void buf_flip_bytes(uint8_t *buf, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		buf[i] = bit_reverse_table256[buf[i]];
+}
+
 static int ceil_f_to_u32(float x)
 {
 	if (x < 0)	/* return zero for negative numbers */
@@ -369,29 +386,72 @@ void bit_copy_discard(struct bit_copy_queue *q)
 	}
 }
 
-int unhexify(char *bin, const char *hex, int count)
+/* hex digit values with bit 4 set; 0 marks anything that isn't a digit */
+#define HEX_DIGIT(c, v)	[c] = 0x10 | (v)
+static const uint8_t hex_digit_table[256] = {
+	HEX_DIGIT('0', 0x0), HEX_DIGIT('1', 0x1), HEX_DIGIT('2', 0x2),
+	HEX_DIGIT('3', 0x3), HEX_DIGIT('4', 0x4), HEX_DIGIT('5', 0x5),
+	HEX_DIGIT('6', 0x6), HEX_DIGIT('7', 0x7), HEX_DIGIT('8', 0x8),
+	HEX_DIGIT('9', 0x9),
+	HEX_DIGIT('a', 0xa), HEX_DIGIT('b', 0xb), HEX_DIGIT('c', 0xc),
+	HEX_DIGIT('d', 0xd), HEX_DIGIT('e', 0xe), HEX_DIGIT('f', 0xf),
+	HEX_DIGIT('A', 0xa), HEX_DIGIT('B', 0xb), HEX_DIGIT('C', 0xc),
+	HEX_DIGIT('D', 0xd), HEX_DIGIT('E', 0xe), HEX_DIGIT('F', 0xf),
+};
+#undef HEX_DIGIT
+
+size_t unhexify_sum(uint8_t *bin, const char *hex, size_t count, uint8_t *sum)
 {
-	int i, tmp;
+	const uint8_t *in = (const uint8_t *)hex;
+	uint8_t acc = 0;
+	size_t i;
 
-	for (i = 0; i < count; i++) {
-		if (sscanf(hex + (2 * i), "%02x", &tmp) != 1)
-			return i;
-		bin[i] = tmp;
+	for (i = 0; i < count; i++, in += 2) {
+		uint8_t hi = hex_digit_table[in[0]];
+		uint8_t lo = hex_digit_table[in[1]];
+
+		/* a NUL terminator fails here too, so we never read past it */
+		if (!(hi & lo & 0x10))
+			break;
+
+		uint8_t value = (hi << 4) | (lo & 0xf);
+		if (bin)
+			bin[i] = value;
+		acc += value;
 	}
 
+	if (sum)
+		*sum += acc;
+
 	return i;
 }
 
+int unhexify(char *bin, const char *hex, int count)
+{
+	if (count <= 0)
+		return 0;
+
+	return unhexify_sum((uint8_t *)bin, hex, count, NULL);
+}
+
 int hexify(char *hex, const char *bin, int count, int out_maxlen)
 {
+	static const char hex_digits[] = "0123456789abcdef";
 	int i, cmd_len = 0;
 
 	/* May use a length, or a null-terminated string as input. */
 	if (count == 0)
 		count = strlen(bin);
 
-	for (i = 0; i < count; i++)
-		cmd_len += snprintf(hex + cmd_len, out_maxlen - cmd_len, "%02x", bin[i] & 0xff);
+	/* stop before a pair that wouldn't leave room for the terminator */
+	for (i = 0; i < count && cmd_len + 2 < out_maxlen; i++) {
+		uint8_t value = bin[i];
+		hex[cmd_len++] = hex_digits[value >> 4];
+		hex[cmd_len++] = hex_digits[value & 0xf];
+	}
+
+	if (cmd_len < out_maxlen)
+		hex[cmd_len] = '\0';
 
 	return cmd_len;
 }
@@ -173,6 +173,13 @@ static inline uint64_t buf_get_u64(const uint8_t *_buffer,
  */
 uint32_t flip_u32(uint32_t value, unsigned width);
 
+/**
+ * Inverts the ordering of bits inside each byte of a buffer, in place.
+ * @param buf The buffer to flip.
+ * @param size The number of bytes in @c buf.
+ */
+void buf_flip_bytes(uint8_t *buf, size_t size);
+
 bool buf_cmp(const void *buf1, const void *buf2, unsigned size);
 bool buf_cmp_mask(const void *buf1, const void *buf2,
 		const void *mask, unsigned size);
@@ -235,6 +242,13 @@ void bit_copy_discard(struct bit_copy_queue *q);
 /* functions to convert to/from hex encoded buffer
  * used in ti-icdi driver and gdb server */
 int unhexify(char *bin, const char *hex, int count);
+/**
+ * Decode @a count bytes written as pairs of hex digits, and add them to
+ * @a *sum (when not NULL) as it goes. @a bin may be NULL to only sum.
+ * @returns the number of bytes decoded; fewer than @a count means a
+ * character that is not a hex digit was found.
+ */
+size_t unhexify_sum(uint8_t *bin, const char *hex, size_t count, uint8_t *sum);
 int hexify(char *hex, const char *bin, int count, int out_maxlen);
 void buffer_shr(void *_buf, unsigned buf_len, unsigned count);
 
@@ -144,34 +144,6 @@ void script_debug(Jim_Interp *interp, const char *name,
 	free(dbg);
 }
 
-static void script_command_args_free(char **words, unsigned nwords)
-{
-	for (unsigned i = 0; i < nwords; i++)
-		free(words[i]);
-	free(words);
-}
-
-static char **script_command_args_alloc(
-	unsigned argc, Jim_Obj * const *argv, unsigned *nwords)
-{
-	char **words = malloc(argc * sizeof(char *));
-	if (NULL == words)
-		return NULL;
-
-	unsigned i;
-	for (i = 0; i < argc; i++) {
-		int len;
-		const char *w = Jim_GetString(argv[i], &len);
-		words[i] = strdup(w);
-		if (words[i] == NULL) {
-			script_command_args_free(words, i);
-			return NULL;
-		}
-	}
-	*nwords = i;
-	return words;
-}
-
 struct command_context *current_command_context(Jim_Interp *interp)
 {
 	/* grab the command context from the associated data */
@@ -195,21 +167,29 @@ static int script_command_run(Jim_Interp *interp,
 	target_call_timer_callbacks_now();
 	LOG_USER_N("%s", "");	/* Keep GDB connection alive*/
 
-	unsigned nwords;
-	char **words = script_command_args_alloc(argc, argv, &nwords);
-	if (NULL == words)
-		return JIM_ERR;
+	/* The words stay valid while the handler runs: the Jim objects are
+	 * held by the caller, and their string form never changes. */
+	const char *stack_words[16];
+	const char **words = stack_words;
+	if ((unsigned)argc > ARRAY_SIZE(stack_words)) {
+		words = malloc(argc * sizeof(*words));
+		if (NULL == words)
+			return JIM_ERR;
+	}
+	for (int i = 0; i < argc; i++)
+		words[i] = Jim_GetString(argv[i], NULL);
 
 	struct log_capture_state *state = NULL;
 	if (capture)
 		state = command_log_capture_start(interp);
 
 	struct command_context *cmd_ctx = current_command_context(interp);
-	int retval = run_command(cmd_ctx, c, (const char **)words, nwords);
+	int retval = run_command(cmd_ctx, c, words, argc);
 
 	command_log_capture_finish(state);
 
-	script_command_args_free(words, nwords);
+	if (words != stack_words)
+		free(words);
 	return command_retval_set(interp, retval);
 }
 
@@ -230,6 +210,46 @@ static struct command *command_root(struct command *c)
 	return c;
 }
 
+/*
+ * All commands are also hashed by parent and name, so that looking one up
+ * doesn't walk the list of its siblings, several hundred at the top level.
+ */
+#define COMMAND_HASH_SIZE	512
+
+static struct command *command_hash[COMMAND_HASH_SIZE];
+
+static unsigned command_hash_index(const struct command *parent, const char *name)
+{
+	/* FNV-1a of the name, seeded with the parent */
+	uint32_t h = 2166136261u ^ (uint32_t)(uintptr_t)parent;
+	while (*name) {
+		h ^= (uint8_t)*name++;
+		h *= 16777619u;
+	}
+	return h % COMMAND_HASH_SIZE;
+}
+
+static void command_hash_add(struct command *c)
+{
+	struct command **bucket = &command_hash[command_hash_index(c->parent, c->name)];
+
+	c->hash_next = *bucket;
+	*bucket = c;
+}
+
+static void command_hash_remove(struct command *c)
+{
+	if (NULL == c->name)
+		return;
+
+	struct command **p = &command_hash[command_hash_index(c->parent, c->name)];
+
+	while (*p && *p != c)
+		p = &(*p)->hash_next;
+	if (*p)
+		*p = c->hash_next;
+}
+
 /**
  * Find a command by name from a list of commands.
  * @returns Returns the named command if it exists in the list.
@@ -237,8 +257,14 @@ static struct command *command_root(struct command *c)
  */
 static struct command *command_find(struct command *head, const char *name)
 {
-	for (struct command *cc = head; cc; cc = cc->next) {
-		if (strcmp(cc->name, name) == 0)
+	if (NULL == head)
+		return NULL;
+
+	/* all commands of a list share the parent */
+	struct command *parent = head->parent;
+	for (struct command *cc = command_hash[command_hash_index(parent, name)];
+			cc; cc = cc->hash_next) {
+		if (cc->parent == parent && strcmp(cc->name, name) == 0)
 			return cc;
 	}
 	return NULL;
@@ -297,6 +323,7 @@ static void command_free(struct command *c)
 		command_free(tmp);
 	}
 
+	command_hash_remove(c);
 	free(c->name);
 	free(c->help);
 	free(c->usage);
@@ -343,6 +370,7 @@ static struct command *command_new(struct command_context *cmd_ctx,
 	c->mode = cr->mode;
 
 	command_add_child(command_list_for_parent(cmd_ctx, parent), c);
+	command_hash_add(c);
 
 	return c;
 
@@ -352,6 +380,12 @@ command_new_error:
 }
 
 static int command_unknown(Jim_Interp *interp, int argc, Jim_Obj *const *argv);
+static int jim_command_named(Jim_Interp *interp, int argc, Jim_Obj *const *argv);
+
+static void command_named_free(Jim_Interp *interp, void *name)
+{
+	free(name);
+}
 
 static int register_command_handler(struct command_context *cmd_ctx,
 	struct command *c)
@@ -369,17 +403,15 @@ static int register_command_handler(struct command_context *cmd_ctx,
 	if (JIM_OK != retval)
 		return retval;
 
-	/* we now need to add an overrideable proc */
-	char *override_name = alloc_printf(
-			"proc %s {args} {eval ocd_bouncer %s $args}",
-			c->name, c->name);
-	if (NULL == override_name)
+	/* we now need to add an overrideable command; it used to be a
+	 * Tcl proc calling ocd_bouncer, which cost a script parse for every
+	 * registration at startup and an extra evaluation for every call */
+	char *name = strdup(c->name);
+	if (NULL == name)
 		return JIM_ERR;
 
-	retval = Jim_Eval_Named(interp, override_name, 0, 0);
-	free(override_name);
-
-	return retval;
+	return Jim_CreateCommand(interp, name, jim_command_named, name,
+			command_named_free);
 }
 
 struct command *register_command(struct command_context *context,
@@ -696,6 +728,33 @@ int command_run_line(struct command_context *context, char *line)
 	return retval;
 }
 
+int command_run_script_obj(struct command_context *context, Jim_Obj *script)
+{
+	int retval = ERROR_FAIL;
+	int retcode;
+	Jim_Interp *interp = context->interp;
+
+	Jim_DeleteAssocData(interp, "context");
+	retcode = Jim_SetAssocData(interp, "context", NULL, context);
+	if (retcode == JIM_OK) {
+		Jim_DeleteAssocData(interp, "retval");
+		retcode = Jim_SetAssocData(interp, "retval", NULL, &retval);
+		if (retcode == JIM_OK) {
+			Jim_IncrRefCount(script);
+			retcode = Jim_EvalObj(interp, script);
+			Jim_DecrRefCount(interp, script);
+
+			Jim_DeleteAssocData(interp, "retval");
+		}
+		Jim_DeleteAssocData(interp, "context");
+	}
+
+	if (retcode != JIM_OK && retcode != JIM_EXIT)
+		Jim_MakeErrorMessage(interp);
+
+	return retcode;
+}
+
 int command_run_linef(struct command_context *context, const char *format, ...)
 {
 	int retval = ERROR_FAIL;
@@ -1077,6 +1136,77 @@ static int jim_command_type(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 	return JIM_OK;
 }
 
+/*
+ * Runs the command called name, with argv[0] the word naming it, and
+ * discards the log output that simple handlers return as their result.
+ * This is what every command name is bound to, see register_command_handler().
+ */
+static int command_bounce(Jim_Interp *interp, const char *name,
+	int argc, Jim_Obj *const *argv)
+{
+	script_debug(interp, name, argc, argv);
+
+	struct command_context *cmd_ctx = current_command_context(interp);
+	struct command *c = command_find(cmd_ctx->commands, name);
+	int remaining = argc - 1;
+	if (c)
+		remaining = command_unknown_find(argc - 1, argv + 1, c->children, &c, false);
+
+	if (c && (c->jim_handler || c->handler)) {
+		/* include the command name in the list */
+		unsigned count = remaining + 1;
+		Jim_Obj *const *start = argv + (argc - remaining - 1);
+
+		if (c->jim_handler) {
+			interp->cmdPrivData = c->jim_handler_data;
+			return (*c->jim_handler)(interp, count, start);
+		}
+
+		int retcode = script_command_run(interp, count, start, c, false);
+		/* 'classic' commands output error message as part of progress output */
+		Jim_SetEmptyResult(interp);
+		return retcode;
+	}
+
+	Jim_Obj *msg;
+	if (c && remaining == 0) {
+		Jim_Obj **usage = malloc((argc + 1) * sizeof(*usage));
+		if (NULL == usage)
+			return JIM_ERR;
+		usage[0] = Jim_NewStringObj(interp, "ocd_usage", -1);
+		usage[1] = Jim_NewStringObj(interp, name, -1);
+		memcpy(usage + 2, argv + 1, (argc - 1) * sizeof(*usage));
+		Jim_IncrRefCount(usage[1]);
+		Jim_EvalObjVector(interp, argc + 1, usage);
+		msg = Jim_ConcatObj(interp, argc, usage + 1);
+		Jim_DecrRefCount(interp, usage[1]);
+		free(usage);
+
+		Jim_AppendString(interp, msg, ": command requires more arguments", -1);
+	} else {
+		msg = Jim_NewStringObj(interp, "invalid subcommand \"", -1);
+		Jim_AppendObj(interp, msg, Jim_NewListObj(interp, argv + 1, argc - 1));
+		Jim_AppendString(interp, msg, "\"", -1);
+	}
+	Jim_SetResult(interp, msg);
+	return JIM_ERR;
+}
+
+/* the command names themselves, the private data is the name */
+static int jim_command_named(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
+{
+	return command_bounce(interp, interp->cmdPrivData, argc, argv);
+}
+
+/* "ocd_bouncer name args...", kept for scripts that call it directly */
+static int jim_command_bouncer(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
+{
+	if (argc < 2)
+		return JIM_ERR;
+
+	return command_bounce(interp, Jim_GetString(argv[1], NULL), argc - 1, argv + 1);
+}
+
 int help_add_command(struct command_context *cmd_ctx, struct command *parent,
 	const char *cmd_name, const char *help_text, const char *usage)
 {
@@ -1324,6 +1454,7 @@ struct command_context *command_init(const char *startup_tcl, Jim_Interp *interp
 
 	Jim_CreateCommand(interp, "ocd_find", jim_find, NULL, NULL);
 	Jim_CreateCommand(interp, "capture", jim_capture, NULL, NULL);
+	Jim_CreateCommand(interp, "ocd_bouncer", jim_command_bouncer, NULL, NULL);
 
 	register_commands(context, NULL, command_builtin_handlers);
 
@@ -170,6 +170,8 @@ struct command {
 	void *jim_handler_data;
 	enum command_mode mode;
 	struct command *next;
+	/* next command in the same command_find() hash bucket */
+	struct command *hash_next;
 };
 
 /**
@@ -328,6 +330,13 @@ __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 2, 3)));
 void command_print_sameline(struct command_context *context, const char *format, ...)
 __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 2, 3)));
 int command_run_line(struct command_context *context, char *line);
+/**
+ * Evaluates @a script like command_run_line(), but leaves the result, or
+ * the error message, in the interpreter instead of logging it, for
+ * callers that return it themselves (possibly binary).
+ * @returns the Jim return code.
+ */
+int command_run_script_obj(struct command_context *context, Jim_Obj *script);
 int command_run_linef(struct command_context *context, const char *format, ...)
 __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 2, 3)));
 void command_output_text(struct command_context *context, const char *data);
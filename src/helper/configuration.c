@@ -24,6 +24,7 @@
 
 #include "configuration.h"
 #include "log.h"
+#include "time_support.h"
 
 static size_t num_config_files;
 static char **config_file_names;
@@ -116,9 +117,11 @@ int parse_config_file(struct command_context *cmd_ctx)
 	cfg = config_file_names;
 
 	while (*cfg) {
+		int64_t start = timeval_ms();
 		retval = command_run_line(cmd_ctx, *cfg);
 		if (retval != ERROR_OK)
 			return retval;
+		LOG_DEBUG("'%s' took %" PRId64 " ms", *cfg, timeval_ms() - start);
 		cfg++;
 	}
 
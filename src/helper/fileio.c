@@ -30,16 +30,51 @@
 #include "configuration.h"
 #include "fileio.h"
 
+#if defined(HAVE_SYS_MMAN_H) && !defined(_WIN32)
+#include <sys/mman.h>
+#define FILEIO_HAVE_MMAP
+#endif
+
 struct fileio {
 	char *url;
 	size_t size;
 	enum fileio_type type;
 	enum fileio_access access;
 	FILE *file;
+	/* read-only mapping of the whole file, or NULL */
+	const uint8_t *map;
 };
 
+/* Map binary files opened for reading, so callers can use their
+ * contents in place; stdio stays open for fileio_read() and friends. */
+static void fileio_map_local(struct fileio *fileio)
+{
+	fileio->map = NULL;
+
+#ifdef FILEIO_HAVE_MMAP
+	if (fileio->access != FILEIO_READ || fileio->type != FILEIO_BINARY ||
+			fileio->size == 0)
+		return;
+
+	void *map = mmap(NULL, fileio->size, PROT_READ, MAP_PRIVATE,
+			fileno(fileio->file), 0);
+	if (map == MAP_FAILED) {
+		LOG_DEBUG("couldn't map %s, using stdio: %s", fileio->url,
+			strerror(errno));
+		return;
+	}
+
+	fileio->map = map;
+#endif
+}
+
 static inline int fileio_close_local(struct fileio *fileio)
 {
+#ifdef FILEIO_HAVE_MMAP
+	if (fileio->map)
+		munmap((void *)fileio->map, fileio->size);
+#endif
+
 	int retval = fclose(fileio->file);
 	if (retval != 0) {
 		if (retval == EBADF)
@@ -113,6 +148,8 @@ static inline int fileio_open_local(struct fileio *fileio)
 
 	fileio->size = file_size;
 
+	fileio_map_local(fileio);
+
 	return ERROR_OK;
 }
 
@@ -127,6 +164,7 @@ int fileio_open(struct fileio **fileio, const char *url,
 	tmp->type = type;
 	tmp->access = access_type;
 	tmp->url = strdup(url);
+	tmp->map = NULL;
 
 	retval = fileio_open_local(tmp);
 
@@ -267,3 +305,15 @@ int fileio_size(struct fileio *fileio, size_t *size)
 
 	return ERROR_OK;
 }
+
+int fileio_data(struct fileio *fileio, size_t offset, size_t size,
+		const uint8_t **data)
+{
+	if (fileio->map == NULL || offset > fileio->size ||
+			size > fileio->size - offset)
+		return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+
+	*data = fileio->map + offset;
+
+	return ERROR_OK;
+}
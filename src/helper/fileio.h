@@ -59,6 +59,16 @@ int fileio_read_u32(struct fileio *fileio, uint32_t *data);
 int fileio_write_u32(struct fileio *fileio, uint32_t data);
 int fileio_size(struct fileio *fileio, size_t *size);
 
+/**
+ * Point @a data at @a size bytes of the file contents starting at
+ * @a offset, without copying. Only available for binary files opened
+ * for reading on hosts with mmap(); otherwise, or when the range is
+ * outside the file, ERROR_FILEIO_OPERATION_NOT_SUPPORTED is returned
+ * and fileio_read() must be used.
+ */
+int fileio_data(struct fileio *fileio, size_t offset, size_t size,
+		const uint8_t **data);
+
 #define ERROR_FILEIO_LOCATION_UNKNOWN			(-1200)
 #define ERROR_FILEIO_NOT_FOUND					(-1201)
 #define ERROR_FILEIO_OPERATION_FAILED			(-1202)
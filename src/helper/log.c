@@ -45,11 +45,28 @@ int debug_level = -1;
 static FILE *log_output;
 static struct log_callback *log_callbacks;
 
-static int64_t last_time;
+/* GDB gives up on a reply after "set remotetimeout", 2000ms by default.
+ * keep_alive() must be invoked at least every KEEP_ALIVE_LIMIT, so sending
+ * once nothing went out for KEEP_ALIVE_INTERVAL still leaves some margin. */
+#define KEEP_ALIVE_LIMIT	1000	/* ms */
+#define KEEP_ALIVE_INTERVAL	900	/* ms */
+
+static int64_t last_time;	/* last keep_alive() or kept_alive() */
+static int64_t last_sent;	/* last time the clients got something */
 static int64_t current_time;
 
 static int64_t start;
 
+/* Messages below warning level are written to a buffered log file and only
+ * flushed this often, so debug logging doesn't cost a write per line. */
+#define LOG_FLUSH_INTERVAL	100	/* ms */
+
+static int64_t last_flush;
+static bool log_unflushed;
+
+/* Most messages fit here and need no allocation */
+#define LOG_LINE_SIZE		256
+
 static const char * const log_strings[5] = {
 	"User : ",
 	"Error: ",
@@ -120,6 +137,7 @@ static void log_puts(enum log_levels level,
 	const char *string)
 {
 	char *f;
+	int64_t now = 0;
 	if (level == LOG_LVL_OUTPUT) {
 		/* do not prepend any headers, just print out what we were given and return */
 		fputs(string, log_output);
@@ -134,7 +152,8 @@ static void log_puts(enum log_levels level,
 	if (strlen(string) > 0) {
 		if (debug_level >= LOG_LVL_DEBUG) {
 			/* print with count and time information */
-			int64_t t = timeval_ms() - start;
+			now = timeval_ms();
+			int64_t t = now - start;
 #ifdef _DEBUG_FREE_SPACE_
 			struct mallinfo info;
 			info = mallinfo();
@@ -159,13 +178,61 @@ static void log_puts(enum log_levels level,
 		 *nothing. */
 	}
 
-	fflush(log_output);
+	/* errors and warnings, and anything logged to the console, show up at once */
+	if (level <= LOG_LVL_WARNING || log_output == stderr)
+		fflush(log_output);
+	else {
+		if (!now)
+			now = timeval_ms();
+		if (now - last_flush >= LOG_FLUSH_INTERVAL) {
+			fflush(log_output);
+			last_flush = now;
+			log_unflushed = false;
+		} else
+			log_unflushed = true;
+	}
 
 	/* Never forward LOG_LVL_DEBUG, too verbose and they can be found in the log if need be */
 	if (level <= LOG_LVL_INFO)
 		log_forward(file, line, function, string);
 }
 
+static void log_vprintf(enum log_levels level,
+	const char *file,
+	unsigned line,
+	const char *function,
+	bool newline,
+	const char *format,
+	va_list ap)
+{
+	char buf[LOG_LINE_SIZE];
+	char *string = buf;
+	va_list ap_copy;
+	int len;
+
+	/* format into the stack buffer, only allocate for long messages */
+	va_copy(ap_copy, ap);
+	len = vsnprintf(buf, sizeof(buf), format, ap_copy);
+	va_end(ap_copy);
+
+	if (len < 0)
+		return;
+	if ((size_t)len + newline >= sizeof(buf)) {
+		/* alloc_vprintf guaranteed the buffer to be at least one char longer */
+		string = alloc_vprintf(format, ap);
+		if (string == NULL)
+			return;
+	}
+
+	if (newline)
+		strcat(string, "\n");
+
+	log_puts(level, file, line, function, string);
+
+	if (string != buf)
+		free(string);
+}
+
 void log_printf(enum log_levels level,
 	const char *file,
 	unsigned line,
@@ -173,7 +240,6 @@ void log_printf(enum log_levels level,
 	const char *format,
 	...)
 {
-	char *string;
 	va_list ap;
 
 	count++;
@@ -181,13 +247,7 @@ void log_printf(enum log_levels level,
 		return;
 
 	va_start(ap, format);
-
-	string = alloc_vprintf(format, ap);
-	if (string != NULL) {
-		log_puts(level, file, line, function, string);
-		free(string);
-	}
-
+	log_vprintf(level, file, line, function, false, format, ap);
 	va_end(ap);
 }
 
@@ -198,7 +258,6 @@ void log_printf_lf(enum log_levels level,
 	const char *format,
 	...)
 {
-	char *string;
 	va_list ap;
 
 	count++;
@@ -206,15 +265,7 @@ void log_printf_lf(enum log_levels level,
 		return;
 
 	va_start(ap, format);
-
-	string = alloc_vprintf(format, ap);
-	if (string != NULL) {
-		strcat(string, "\n");	/* alloc_vprintf guaranteed the buffer to be at least one
-					 *char longer */
-		log_puts(level, file, line, function, string);
-		free(string);
-	}
-
+	log_vprintf(level, file, line, function, true, format, ap);
 	va_end(ap);
 }
 
@@ -241,8 +292,10 @@ COMMAND_HANDLER(handle_log_output_command)
 	if (CMD_ARGC == 1) {
 		FILE *file = fopen(CMD_ARGV[0], "w");
 
-		if (file)
+		if (file) {
+			fflush(log_output);
 			log_output = file;
+		}
 	}
 
 	return ERROR_OK;
@@ -293,11 +346,13 @@ void log_init(void)
 	if (log_output == NULL)
 		log_output = stderr;
 
-	start = last_time = timeval_ms();
+	start = last_time = last_sent = timeval_ms();
 }
 
 int set_log_output(struct command_context *cmd_ctx, FILE *output)
 {
+	if (log_output)
+		fflush(log_output);
 	log_output = output;
 	return ERROR_OK;
 }
@@ -394,34 +449,42 @@ char *alloc_printf(const char *format, ...)
  * GDB protocol and it is a bug in OpenOCD not to either return to the server
  * loop or invoke keep_alive() every 1000ms.
  *
- * This function will send a keep alive packet if >500ms has passed since last time
- * it was invoked.
+ * This function will send a keep alive packet when nothing was sent to the
+ * clients for KEEP_ALIVE_INTERVAL, and only if a client takes log output:
+ * GDB needs it to stay connected, telnet sends the output it has queued.
  *
- * Note that this function can be invoked often, so it needs to be relatively
- * fast when invoked more often than every 500ms.
+ * Note that this function is invoked from deep inside loops, so apart from
+ * the occasional packet it is just a timestamp check.
  *
  */
 void keep_alive()
 {
 	current_time = timeval_ms();
-	if (current_time-last_time > 1000) {
+	if (current_time - last_time > KEEP_ALIVE_LIMIT) {
 		extern int gdb_actual_connections;
 
 		if (gdb_actual_connections)
 			LOG_WARNING("keep_alive() was not invoked in the "
-				"1000ms timelimit. GDB alive packet not "
+				"%dms timelimit. GDB alive packet not "
 				"sent! (%" PRId64 "). Workaround: increase "
 				"\"set remotetimeout\" in GDB",
-				current_time-last_time);
+				KEEP_ALIVE_LIMIT, current_time - last_time);
 		else
 			LOG_DEBUG("keep_alive() was not invoked in the "
-				"1000ms timelimit (%" PRId64 "). This may cause "
+				"%dms timelimit (%" PRId64 "). This may cause "
 				"trouble with GDB connections.",
-				current_time-last_time);
+				KEEP_ALIVE_LIMIT, current_time - last_time);
 	}
-	if (current_time-last_time > 500) {
-		/* this will keep the GDB connection alive */
-		LOG_USER_N("%s", "");
+	last_time = current_time;
+
+	if (current_time - last_sent < KEEP_ALIVE_INTERVAL)
+		return;
+	last_sent = current_time;
+
+	if (log_callbacks) {
+		/* this will keep the GDB connection alive, an empty string
+		 * reaches the log callbacks only */
+		log_forward(__FILE__, __LINE__, __func__, "");
 
 		/* DANGER!!!! do not add code to invoke e.g. target event processing,
 		 * jim timer processing, etc. it can cause infinite recursion +
@@ -430,8 +493,6 @@ void keep_alive()
 		 *
 		 * These functions should be invoked at a well defined spot in server.c
 		 */
-
-		last_time = current_time;
 	}
 }
 
@@ -440,6 +501,14 @@ void kept_alive()
 {
 	current_time = timeval_ms();
 	last_time = current_time;
+	last_sent = current_time;
+
+	/* the server loop is about to sleep, write out buffered log lines */
+	if (log_unflushed && log_output) {
+		fflush(log_output);
+		log_unflushed = false;
+	}
+	last_flush = current_time;
 }
 
 /* if we sleep for extended periods of time, we must invoke keep_alive() intermittantly */
@@ -0,0 +1,119 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "perf.h"
+#include "command.h"
+#include "log.h"
+#include "time_support.h"
+
+uint64_t perf_counters[PERF_COUNTERS];
+
+static const char * const perf_names[PERF_COUNTERS] = {
+	[PERF_JTAG_FLUSHES] = "jtag.flushes",
+	[PERF_JTAG_COMMANDS] = "jtag.commands",
+	[PERF_JTAG_BITS] = "jtag.bits",
+	[PERF_SWD_RUNS] = "swd.runs",
+	[PERF_DAP_TRANSACTIONS] = "dap.transactions",
+	[PERF_DAP_WAITS] = "dap.waits",
+	[PERF_USB_TRANSFERS] = "usb.transfers",
+	[PERF_USB_BYTES_OUT] = "usb.bytes_out",
+	[PERF_USB_BYTES_IN] = "usb.bytes_in",
+	[PERF_GDB_PACKETS] = "gdb.packets",
+	[PERF_GDB_QUERY] = "gdb.packets.query",
+	[PERF_GDB_REGISTER] = "gdb.packets.register",
+	[PERF_GDB_MEM_READ] = "gdb.packets.mem_read",
+	[PERF_GDB_MEM_WRITE] = "gdb.packets.mem_write",
+	[PERF_GDB_BREAKPOINT] = "gdb.packets.breakpoint",
+	[PERF_GDB_RUN] = "gdb.packets.run",
+	[PERF_GDB_OTHER] = "gdb.packets.other",
+	[PERF_RTOS_UPDATES] = "rtos.updates",
+	[PERF_RTOS_UPDATE_US] = "rtos.update_us",
+	[PERF_MEM_CACHE_HITS] = "memcache.hits",
+	[PERF_MEM_CACHE_MISSES] = "memcache.misses",
+	[PERF_MMU_TLB_HITS] = "mmu_tlb.hits",
+	[PERF_MMU_TLB_MISSES] = "mmu_tlb.misses",
+	[PERF_ITM_SYNCS] = "itm.syncs",
+	[PERF_ITM_OVERFLOWS] = "itm.overflows",
+	[PERF_TIMER_CALLBACKS] = "timer.callbacks",
+	[PERF_TIMER_CALLBACK_US] = "timer.callback_us",
+};
+
+int64_t perf_time_us(void)
+{
+	return monotonic_ns() / 1000;
+}
+
+COMMAND_HANDLER(handle_perf_dump_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	/* one "name value" pair per line, so the result is also a Tcl dict */
+	for (unsigned i = 0; i < PERF_COUNTERS; i++) {
+		if (CMD_ARGC == 1 && strncmp(perf_names[i], CMD_ARGV[0], strlen(CMD_ARGV[0])) != 0)
+			continue;
+		command_print(CMD_CTX, "%s %" PRIu64, perf_names[i], perf_counters[i]);
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_perf_reset_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	memset(perf_counters, 0, sizeof(perf_counters));
+	return ERROR_OK;
+}
+
+static const struct command_registration perf_subcommand_handlers[] = {
+	{
+		.name = "dump",
+		.handler = handle_perf_dump_command,
+		.mode = COMMAND_ANY,
+		.help = "Show the performance counters, optionally only those "
+			"whose name starts with prefix.",
+		.usage = "[prefix]",
+	},
+	{
+		.name = "reset",
+		.handler = handle_perf_reset_command,
+		.mode = COMMAND_ANY,
+		.help = "Clear all performance counters.",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration perf_command_handlers[] = {
+	{
+		.name = "perf",
+		.mode = COMMAND_ANY,
+		.help = "process wide performance counters",
+		.usage = "",
+		.chain = perf_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int perf_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, perf_command_handlers);
+}
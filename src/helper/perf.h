@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_HELPER_PERF_H
+#define OPENOCD_HELPER_PERF_H
+
+#include <stdint.h>
+
+struct command_context;
+
+/**
+ * @file
+ * Process wide performance counters, shown by "perf dump".
+ *
+ * Counting is a plain increment of a global, so the hot paths of the
+ * JTAG, DAP, USB and GDB layers can count unconditionally. Per object
+ * statistics ("dap perf", "memcache", "jtag queue_stats") stay where
+ * they are; these counters add the totals across all of them.
+ * To add a counter, add it to the enum and its name to perf_names[].
+ */
+enum perf_counter {
+	PERF_JTAG_FLUSHES,
+	PERF_JTAG_COMMANDS,
+	PERF_JTAG_BITS,
+	PERF_SWD_RUNS,
+	PERF_DAP_TRANSACTIONS,
+	PERF_DAP_WAITS,
+	PERF_USB_TRANSFERS,
+	PERF_USB_BYTES_OUT,
+	PERF_USB_BYTES_IN,
+	PERF_GDB_PACKETS,
+	PERF_GDB_QUERY,
+	PERF_GDB_REGISTER,
+	PERF_GDB_MEM_READ,
+	PERF_GDB_MEM_WRITE,
+	PERF_GDB_BREAKPOINT,
+	PERF_GDB_RUN,
+	PERF_GDB_OTHER,
+	PERF_RTOS_UPDATES,
+	PERF_RTOS_UPDATE_US,
+	PERF_MEM_CACHE_HITS,
+	PERF_MEM_CACHE_MISSES,
+	PERF_MMU_TLB_HITS,
+	PERF_MMU_TLB_MISSES,
+	PERF_ITM_SYNCS,
+	PERF_ITM_OVERFLOWS,
+	PERF_TIMER_CALLBACKS,
+	PERF_TIMER_CALLBACK_US,
+	PERF_COUNTERS
+};
+
+extern uint64_t perf_counters[PERF_COUNTERS];
+
+static inline void perf_add(enum perf_counter counter, uint64_t n)
+{
+	perf_counters[counter] += n;
+}
+
+/** @returns a microsecond timestamp for timing with perf_add() */
+int64_t perf_time_us(void);
+
+int perf_register_commands(struct command_context *cmd_ctx);
+
+#endif /* OPENOCD_HELPER_PERF_H */
@@ -210,6 +210,17 @@ static inline void socket_nonblock(int fd)
 #endif
 }
 
+/* after a failed read or write: true if a non-blocking socket just had
+ * nothing to transfer */
+static inline bool socket_would_block(void)
+{
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
 static inline int socket_select(int max_fd,
 	fd_set *rfds,
 	fd_set *wfds,
@@ -11,31 +11,9 @@ proc exit {} {
 }
 
 # All commands are registered with an 'ocd_' prefix, while the "real"
-# command is a wrapper that calls this function.  Its primary purpose is
-# to discard 'handler' command output,
-proc ocd_bouncer {name args} {
-	set cmd [format "ocd_%s" $name]
-	set type [eval ocd_command type $cmd $args]
-	set errcode error
-	if {$type == "native"} {
-		return [eval $cmd $args]
-	} else {if {$type == "simple"} {
-		set errcode [catch {eval $cmd $args}]
-		if {$errcode == 0} {
-			return ""
-		} else {
-			# 'classic' commands output error message as part of progress output
-			set errmsg ""
-		}
-	} else {if {$type == "group"} {
-		catch {eval ocd_usage $name $args}
-		set errmsg [format "%s: command requires more arguments" \
-			[concat $name " " $args]]
-	} else {
-		set errmsg [format "invalid subcommand \"%s\"" $args]
-	}}}
-	return -code $errcode $errmsg
-}
+# command is bound to a C wrapper (see command_bounce() in command.c) that
+# can be overridden by a proc of the same name. Its primary purpose is to
+# discard 'handler' command output.
 
 # Try flipping / and \ to find file if the filename does not
 # match the precise spelling
@@ -64,23 +64,19 @@ int timeval_add_time(struct timeval *result, long sec, long usec)
 
 int duration_start(struct duration *duration)
 {
-	return gettimeofday(&duration->start, NULL);
+	duration->start_ns = monotonic_ns();
+	return 0;
 }
 
 int duration_measure(struct duration *duration)
 {
-	struct timeval end;
-	int retval = gettimeofday(&end, NULL);
-	if (0 == retval)
-		timeval_subtract(&duration->elapsed, &end, &duration->start);
-	return retval;
+	duration->elapsed_ns = monotonic_ns() - duration->start_ns;
+	return 0;
 }
 
 float duration_elapsed(const struct duration *duration)
 {
-	float t = duration->elapsed.tv_sec;
-	t += (float)duration->elapsed.tv_usec / 1000000.0;
-	return t;
+	return duration->elapsed_ns / 1000000000.0;
 }
 
 float duration_kbps(const struct duration *duration, size_t count)
@@ -39,12 +39,17 @@
 int timeval_subtract(struct timeval *result, struct timeval *x, struct timeval *y);
 int timeval_add_time(struct timeval *result, long sec, long usec);
 
-/** @returns gettimeofday() timeval as 64-bit in ms */
+/**
+ * @returns Nanoseconds of a monotonic clock, with the best resolution the
+ * host offers. Only differences between two values are meaningful.
+ */
+int64_t monotonic_ns(void);
+/** @returns monotonic_ns() in ms */
 int64_t timeval_ms(void);
 
 struct duration {
-	struct timeval start;
-	struct timeval elapsed;
+	int64_t start_ns;
+	int64_t elapsed_ns;
 };
 
 /** Update the duration->start field to start the @a duration measurement. */
@@ -28,14 +28,42 @@
 
 #include "time_support.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/* a clock that only moves forward, so setting the system time, e.g. by
+ * NTP, doesn't fire or stretch timeouts */
+int64_t monotonic_ns(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER count;
+
+	if (freq.QuadPart == 0)
+		QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+
+	/* whole seconds first, the product would overflow after a few days */
+	return (count.QuadPart / freq.QuadPart) * 1000000000
+		+ (count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#elif defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#else
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (int64_t)now.tv_sec * 1000000000 + (int64_t)now.tv_usec * 1000;
+#endif
+}
+
 /* simple and low overhead fetching of ms counter. Use only
  * the difference between ms counters returned from this fn.
  */
 int64_t timeval_ms(void)
 {
-	struct timeval now;
-	int retval = gettimeofday(&now, NULL);
-	if (retval < 0)
-		return retval;
-	return (int64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+	return monotonic_ns() / 1000000;
 }
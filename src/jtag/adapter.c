@@ -430,11 +430,30 @@ COMMAND_HANDLER(handle_adapter_nsrst_assert_width_command)
 
 COMMAND_HANDLER(handle_adapter_khz_command)
 {
-	if (CMD_ARGC > 1)
-		return ERROR_COMMAND_SYNTAX_ERROR;
-
 	int retval = ERROR_OK;
-	if (CMD_ARGC == 1) {
+	if (CMD_ARGC >= 1 && !strcmp(CMD_ARGV[0], "auto")) {
+		unsigned max_khz = 100000;
+		unsigned margin = 20;
+
+		if (CMD_ARGC > 3)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		if (CMD_CTX->mode != COMMAND_EXEC) {
+			LOG_ERROR("adapter_khz auto needs the adapter and targets initialized");
+			return ERROR_FAIL;
+		}
+		if (CMD_ARGC > 1)
+			COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], max_khz);
+		if (CMD_ARGC > 2)
+			COMMAND_PARSE_NUMBER(uint, CMD_ARGV[2], margin);
+		if (margin >= 100)
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+
+		retval = adapter_speed_auto(max_khz, margin);
+		if (ERROR_OK != retval)
+			return retval;
+	} else if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	else if (CMD_ARGC == 1) {
 		unsigned khz = 0;
 		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], khz);
 
@@ -456,6 +475,22 @@ COMMAND_HANDLER(handle_adapter_khz_command)
 	return retval;
 }
 
+COMMAND_HANDLER(handle_adapter_khz_monitor_command)
+{
+	unsigned min_khz = 0;
+	bool enable;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ON_OFF(CMD_ARGV[0], enable);
+	if (CMD_ARGC == 2)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], min_khz);
+
+	adapter_speed_monitor_config(enable, min_khz ? min_khz : 100);
+	return ERROR_OK;
+}
+
 static const struct command_registration interface_command_handlers[] = {
 	{
 		.name = "adapter_khz",
@@ -464,8 +499,17 @@ static const struct command_registration interface_command_handlers[] = {
 		.help = "With an argument, change to the specified maximum "
 			"jtag speed.  For JTAG, 0 KHz signifies adaptive "
 			" clocking. "
-			"With or without argument, display current setting.",
-		.usage = "[khz]",
+			"With or without argument, display current setting. "
+			"'auto' searches the highest reliable speed.",
+		.usage = "[khz | 'auto' [max_khz [margin_percent]]]",
+	},
+	{
+		.name = "adapter_khz_monitor",
+		.handler = handle_adapter_khz_monitor_command,
+		.mode = COMMAND_ANY,
+		.help = "Lower the adapter speed when the driver reports "
+			"parity errors on the link",
+		.usage = "('on'|'off') [min_khz]",
 	},
 	{
 		.name = "adapter_name",
@@ -1872,8 +1872,199 @@ static int aice_check_dbger(uint32_t coreid, uint32_t expect_status)
 	return ERROR_FAIL;
 }
 
+/***************************************************************************/
+/* AICE command pipeline
+ *
+ * In normal command mode every command costs one USB round trip. The
+ * pipeline packs a sequence of commands into a single bulk write, reads
+ * all the responses back with one bulk read, and then checks each
+ * acknowledge and stores the data words of the read commands.
+ */
+#define AICE_PIPE_MAX_CMDS		16
+
+struct aice_pipe_cmd {
+	uint8_t cmd_code;
+	uint32_t in_offset;
+	uint32_t *data;
+};
+
+static uint8_t aice_pipe_out[AICE_OUT_PACK_COMMAND_SIZE];
+static uint8_t aice_pipe_in[AICE_IN_PACK_COMMAND_SIZE];
+static uint32_t aice_pipe_out_length;
+static uint32_t aice_pipe_in_length;
+static struct aice_pipe_cmd aice_pipe_cmds[AICE_PIPE_MAX_CMDS];
+static unsigned int aice_pipe_num_cmds;
+
+static int aice_pipe_run(void)
+{
+	if (aice_pipe_num_cmds == 0)
+		return ERROR_OK;
+
+	unsigned int num_cmds = aice_pipe_num_cmds;
+	uint32_t out_length = aice_pipe_out_length;
+	uint32_t in_length = aice_pipe_in_length;
+	int32_t result;
+
+	aice_pipe_num_cmds = 0;
+	aice_pipe_out_length = 0;
+	aice_pipe_in_length = 0;
+
+	LOG_DEBUG("run %u pipelined commands", num_cmds);
+
+	if (aice_usb_write(aice_pipe_out, out_length) < 0)
+		return ERROR_FAIL;
+
+	result = aice_usb_read(aice_pipe_in, in_length);
+	if (result != (int32_t)in_length) {
+		LOG_ERROR("aice_usb_read failed (requested=%" PRIu32 ", result=%" PRId32 ")",
+				in_length, result);
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = 0; i < num_cmds; i++) {
+		struct aice_pipe_cmd *cmd = &aice_pipe_cmds[i];
+		const uint8_t *in = aice_pipe_in + cmd->in_offset;
+
+		if (in[0] != cmd->cmd_code) {
+			LOG_ERROR("aice command error (command=0x%" PRIx8 ", response=0x%" PRIx8 ")",
+					cmd->cmd_code, in[0]);
+			aice_reset_box();
+			return ERROR_FAIL;
+		}
+
+		/* DTHMA, data word in bytes 4..7 */
+		if (cmd->data)
+			*cmd->data = (in[4] << 24) | (in[5] << 16) | (in[6] << 8) | in[7];
+	}
+
+	return ERROR_OK;
+}
+
+/* the command has been packed in usb_out_buffer */
+static int aice_pipe_add(uint8_t cmd_code, uint32_t out_length, uint32_t in_length,
+		uint32_t *data)
+{
+	if ((aice_pipe_num_cmds == AICE_PIPE_MAX_CMDS) ||
+			(aice_pipe_out_length + out_length > sizeof(aice_pipe_out)) ||
+			(aice_pipe_in_length + in_length > sizeof(aice_pipe_in))) {
+		int retval = aice_pipe_run();
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	struct aice_pipe_cmd *cmd = &aice_pipe_cmds[aice_pipe_num_cmds++];
+	cmd->cmd_code = cmd_code;
+	cmd->in_offset = aice_pipe_in_length;
+	cmd->data = data;
+
+	memcpy(aice_pipe_out + aice_pipe_out_length, usb_out_buffer, out_length);
+	aice_pipe_out_length += out_length;
+	aice_pipe_in_length += in_length;
+
+	return ERROR_OK;
+}
+
+static int aice_pipe_write_dim(uint8_t target_id, uint32_t *word, uint8_t num_of_words)
+{
+	uint32_t big_endian_word[4];
+
+	/** instruction is big-endian */
+	memcpy(big_endian_word, word, sizeof(big_endian_word));
+	aice_switch_to_big_endian(big_endian_word, num_of_words);
+
+	aice_pack_htdmc_multiple_data(AICE_CMD_T_WRITE_DIM, target_id, num_of_words - 1, 0,
+			big_endian_word, num_of_words, AICE_LITTLE_ENDIAN);
+	return aice_pipe_add(AICE_CMD_T_WRITE_DIM, AICE_FORMAT_HTDMC + (num_of_words - 1) * 4,
+			AICE_FORMAT_DTHMB, NULL);
+}
+
+static int aice_pipe_write_misc(uint8_t target_id, uint32_t address, uint32_t data)
+{
+	aice_pack_htdmc(AICE_CMD_T_WRITE_MISC, target_id, 0, address, data, AICE_LITTLE_ENDIAN);
+	return aice_pipe_add(AICE_CMD_T_WRITE_MISC, AICE_FORMAT_HTDMC, AICE_FORMAT_DTHMB, NULL);
+}
+
+static int aice_pipe_write_dtr(uint8_t target_id, uint32_t data)
+{
+	aice_pack_htdmc(AICE_CMD_T_WRITE_DTR, target_id, 0, 0, data, AICE_LITTLE_ENDIAN);
+	return aice_pipe_add(AICE_CMD_T_WRITE_DTR, AICE_FORMAT_HTDMC, AICE_FORMAT_DTHMB, NULL);
+}
+
+static int aice_pipe_execute(uint8_t target_id)
+{
+	aice_pack_htdmc(AICE_CMD_T_EXECUTE, target_id, 0, 0, 0, AICE_LITTLE_ENDIAN);
+	return aice_pipe_add(AICE_CMD_T_EXECUTE, AICE_FORMAT_HTDMC, AICE_FORMAT_DTHMB, NULL);
+}
+
+static int aice_pipe_read_misc(uint8_t target_id, uint32_t address, uint32_t *data)
+{
+	aice_pack_htdma(AICE_CMD_T_READ_MISC, target_id, 0, address);
+	return aice_pipe_add(AICE_CMD_T_READ_MISC, AICE_FORMAT_HTDMA, AICE_FORMAT_DTHMA, data);
+}
+
+static int aice_pipe_read_edmsr(uint8_t target_id, uint32_t address, uint32_t *data)
+{
+	aice_pack_htdma(AICE_CMD_T_READ_EDMSR, target_id, 0, address);
+	return aice_pipe_add(AICE_CMD_T_READ_EDMSR, AICE_FORMAT_HTDMA, AICE_FORMAT_DTHMA, data);
+}
+
+static int aice_pipe_read_dtr(uint8_t target_id, uint32_t *data)
+{
+	aice_pack_htdma(AICE_CMD_T_READ_DTR, target_id, 0, 0);
+	return aice_pipe_add(AICE_CMD_T_READ_DTR, AICE_FORMAT_HTDMA, AICE_FORMAT_DTHMA, data);
+}
+
+/* fill DIM, clear DBGER.DPED, execute and sample DBGER, all without a round trip */
+static int aice_pipe_execute_dim(uint32_t coreid, uint32_t *insts, uint8_t n_inst,
+		uint32_t *value_dbger)
+{
+	if (aice_pipe_write_dim(coreid, insts, n_inst) != ERROR_OK)
+		return ERROR_FAIL;
+	if (aice_pipe_write_misc(coreid, NDS_EDM_MISC_DBGER, NDS_DBGER_DPED) != ERROR_OK)
+		return ERROR_FAIL;
+	if (aice_pipe_execute(coreid) != ERROR_OK)
+		return ERROR_FAIL;
+	return aice_pipe_read_misc(coreid, NDS_EDM_MISC_DBGER, value_dbger);
+}
+
+/* DBGER as sampled right after EXECUTE; poll only if DIM was not done yet */
+static int aice_finish_dim(uint32_t coreid, uint32_t *insts, uint32_t value_dbger)
+{
+	int retval;
+
+	if (value_dbger & NDS_DBGER_DPED) {
+		retval = check_suppressed_exception(coreid, value_dbger);
+		if (retval == ERROR_OK)
+			retval = check_privilege(coreid, value_dbger);
+	} else
+		retval = aice_check_dbger(coreid, NDS_DBGER_DPED);
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("<-- TARGET ERROR! Debug operations do not finish properly: "
+				"0x%08" PRIx32 "0x%08" PRIx32 "0x%08" PRIx32 "0x%08" PRIx32 ". -->",
+				insts[0],
+				insts[1],
+				insts[2],
+				insts[3]);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
 static int aice_execute_dim(uint32_t coreid, uint32_t *insts, uint8_t n_inst)
 {
+	if (AICE_COMMAND_MODE_NORMAL == aice_command_mode) {
+		uint32_t value_dbger;
+
+		if (aice_pipe_execute_dim(coreid, insts, n_inst, &value_dbger) != ERROR_OK)
+			return ERROR_FAIL;
+		if (aice_pipe_run() != ERROR_OK)
+			return ERROR_FAIL;
+
+		return aice_finish_dim(coreid, insts, value_dbger);
+	}
+
 	/** fill DIM */
 	if (aice_write_dim(coreid, insts, n_inst) != ERROR_OK)
 		return ERROR_FAIL;
@@ -1959,9 +2150,35 @@ static int aice_read_reg(uint32_t coreid, uint32_t num, uint32_t *val)
 		instructions[3] = BEQ_MINUS_12;
 	}
 
-	aice_execute_dim(coreid, instructions, 4);
-
 	uint32_t value_edmsw;
+
+	if (AICE_COMMAND_MODE_NORMAL == aice_command_mode) {
+		/* one round trip: run DIM, then read EDMSW and DTR right behind it */
+		uint32_t value_dbger;
+		uint32_t value_dtr;
+
+		if (aice_pipe_execute_dim(coreid, instructions, 4, &value_dbger) != ERROR_OK)
+			return ERROR_FAIL;
+		if (aice_pipe_read_edmsr(coreid, NDS_EDM_SR_EDMSW, &value_edmsw) != ERROR_OK)
+			return ERROR_FAIL;
+		if (aice_pipe_read_dtr(coreid, &value_dtr) != ERROR_OK)
+			return ERROR_FAIL;
+		if (aice_pipe_run() != ERROR_OK)
+			return ERROR_FAIL;
+
+		if ((value_dbger & NDS_DBGER_DPED) && (value_edmsw & NDS_EDMSW_WDV)) {
+			if (aice_finish_dim(coreid, instructions, value_dbger) != ERROR_OK)
+				return ERROR_FAIL;
+			*val = value_dtr;
+			return ERROR_OK;
+		}
+
+		/* DIM was still running when sampled, wait and read DTR again */
+		if (aice_finish_dim(coreid, instructions, value_dbger) != ERROR_OK)
+			return ERROR_FAIL;
+	} else
+		aice_execute_dim(coreid, instructions, 4);
+
 	aice_read_edmsr(coreid, NDS_EDM_SR_EDMSW, &value_edmsw);
 	if (value_edmsw & NDS_EDMSW_WDV)
 		aice_read_dtr(coreid, val);
@@ -2008,8 +2225,17 @@ static int aice_write_reg(uint32_t coreid, uint32_t num, uint32_t val)
 	uint32_t instructions[4]; /** execute instructions in DIM */
 	uint32_t value_edmsw;
 
-	aice_write_dtr(coreid, val);
-	aice_read_edmsr(coreid, NDS_EDM_SR_EDMSW, &value_edmsw);
+	if (AICE_COMMAND_MODE_NORMAL == aice_command_mode) {
+		if (aice_pipe_write_dtr(coreid, val) != ERROR_OK)
+			return ERROR_FAIL;
+		if (aice_pipe_read_edmsr(coreid, NDS_EDM_SR_EDMSW, &value_edmsw) != ERROR_OK)
+			return ERROR_FAIL;
+		if (aice_pipe_run() != ERROR_OK)
+			return ERROR_FAIL;
+	} else {
+		aice_write_dtr(coreid, val);
+		aice_read_edmsr(coreid, NDS_EDM_SR_EDMSW, &value_edmsw);
+	}
 	if (0 == (value_edmsw & NDS_EDMSW_RDV)) {
 		LOG_ERROR("<-- TARGET ERROR! AICE failed to write to the DTR register. -->");
 		return ERROR_FAIL;
@@ -3097,6 +3323,11 @@ static int aice_usb_set_address_dim(uint32_t coreid, uint32_t address)
 	return aice_execute_dim(coreid, instructions, 4);
 }
 
+static int aice_bulk_read_mem(uint32_t coreid, uint32_t addr, uint32_t count,
+		uint8_t *buffer);
+static int aice_bulk_write_mem(uint32_t coreid, uint32_t addr, uint32_t count,
+		const uint8_t *buffer);
+
 static int aice_usb_read_memory_unit(uint32_t coreid, uint32_t addr, uint32_t size,
 		uint32_t count, uint8_t *buffer)
 {
@@ -3104,6 +3335,11 @@ static int aice_usb_read_memory_unit(uint32_t coreid, uint32_t addr, uint32_t si
 			", size: %" PRIu32 ", count: %" PRIu32 "",
 			addr, size, count);
 
+	/* words over the bus are burst with FASTREAD_MEM instead of one by one */
+	if ((NDS_MEMORY_ACC_BUS == core_info[coreid].access_channel) &&
+			(size == 4) && (count > 1))
+		return aice_bulk_read_mem(coreid, addr, count, buffer);
+
 	if (NDS_MEMORY_ACC_CPU == core_info[coreid].access_channel)
 		aice_usb_set_address_dim(coreid, addr);
 
@@ -3223,6 +3459,11 @@ static int aice_usb_write_memory_unit(uint32_t coreid, uint32_t addr, uint32_t s
 			", size: %" PRIu32 ", count: %" PRIu32 "",
 			addr, size, count);
 
+	/* words over the bus are burst with FASTWRITE_MEM instead of one by one */
+	if ((NDS_MEMORY_ACC_BUS == core_info[coreid].access_channel) &&
+			(size == 4) && (count > 1))
+		return aice_bulk_write_mem(coreid, addr, count, buffer);
+
 	if (NDS_MEMORY_ACC_CPU == core_info[coreid].access_channel)
 		aice_usb_set_address_dim(coreid, addr);
 
@@ -37,12 +37,23 @@ struct cmd_queue_page {
 	struct cmd_queue_page *next;
 	void *address;
 	size_t used;
+	size_t size;
 };
 
 #define CMD_QUEUE_PAGE_SIZE (1024 * 1024)
 static struct cmd_queue_page *cmd_queue_pages;
 static struct cmd_queue_page *cmd_queue_pages_tail;
 
+/* Standard-size pages are kept across queue resets, up to this many,
+ * so sustained traffic doesn't malloc and free a page per flush.
+ * Oversized pages for single huge allocations are always freed. */
+#define CMD_QUEUE_KEEP_PAGES 8
+static struct cmd_queue_page *cmd_queue_free_pages;
+static unsigned cmd_queue_free_count;
+
+static struct cmd_queue_stats cmd_queue_stats;
+static size_t cmd_queue_bytes;
+
 struct jtag_command *jtag_command_queue;
 static struct jtag_command **next_command_pointer = &jtag_command_queue;
 
@@ -105,17 +116,27 @@ void *cmd_queue_alloc(size_t size)
 	}
 
 	if (!*p_page) {
-		*p_page = malloc(sizeof(struct cmd_queue_page));
+		if (size <= CMD_QUEUE_PAGE_SIZE && cmd_queue_free_pages) {
+			*p_page = cmd_queue_free_pages;
+			cmd_queue_free_pages = (*p_page)->next;
+			cmd_queue_free_count--;
+			cmd_queue_stats.pages_reused++;
+		} else {
+			*p_page = malloc(sizeof(struct cmd_queue_page));
+			size_t alloc_size = (size < CMD_QUEUE_PAGE_SIZE) ?
+						CMD_QUEUE_PAGE_SIZE : size;
+			(*p_page)->address = malloc(alloc_size);
+			(*p_page)->size = alloc_size;
+			cmd_queue_stats.pages_allocated++;
+		}
 		(*p_page)->used = 0;
-		size_t alloc_size = (size < CMD_QUEUE_PAGE_SIZE) ?
-					CMD_QUEUE_PAGE_SIZE : size;
-		(*p_page)->address = malloc(alloc_size);
 		(*p_page)->next = NULL;
 		cmd_queue_pages_tail = *p_page;
 	}
 
 	offset = (*p_page)->used;
 	(*p_page)->used += size;
+	cmd_queue_bytes += size;
 
 	t = (*p_page)->address;
 	return t + offset;
@@ -127,13 +148,37 @@ static void cmd_queue_free(void)
 
 	while (page) {
 		struct cmd_queue_page *last = page;
-		free(page->address);
 		page = page->next;
-		free(last);
+		if (last->size == CMD_QUEUE_PAGE_SIZE &&
+				cmd_queue_free_count < CMD_QUEUE_KEEP_PAGES) {
+			last->next = cmd_queue_free_pages;
+			cmd_queue_free_pages = last;
+			cmd_queue_free_count++;
+		} else {
+			free(last->address);
+			free(last);
+		}
 	}
 
 	cmd_queue_pages = NULL;
 	cmd_queue_pages_tail = NULL;
+
+	if (cmd_queue_bytes) {
+		cmd_queue_stats.flushes++;
+		cmd_queue_stats.bytes += cmd_queue_bytes;
+		if (cmd_queue_bytes > cmd_queue_stats.peak_bytes)
+			cmd_queue_stats.peak_bytes = cmd_queue_bytes;
+		cmd_queue_bytes = 0;
+	}
+}
+
+void jtag_command_queue_stats(struct cmd_queue_stats *stats, bool reset)
+{
+	*stats = cmd_queue_stats;
+	stats->pages_cached = cmd_queue_free_count;
+
+	if (reset)
+		memset(&cmd_queue_stats, 0, sizeof(cmd_queue_stats));
 }
 
 void jtag_command_queue_reset(void)
@@ -144,6 +189,144 @@ void jtag_command_queue_reset(void)
 	next_command_pointer = &jtag_command_queue;
 }
 
+/* the state a command leaves the TAPs in, TAP_INVALID if it doesn't say */
+static tap_state_t jtag_command_end_state(const struct jtag_command *cmd)
+{
+	switch (cmd->type) {
+		case JTAG_SCAN:
+			return cmd->cmd.scan->end_state;
+		case JTAG_RUNTEST:
+			return cmd->cmd.runtest->end_state;
+		case JTAG_TLR_RESET:
+			return cmd->cmd.statemove->end_state;
+		case JTAG_PATHMOVE:
+			if (cmd->cmd.pathmove->num_states > 0)
+				return cmd->cmd.pathmove->path[cmd->cmd.pathmove->num_states - 1];
+			return TAP_INVALID;
+		default:
+			return TAP_INVALID;
+	}
+}
+
+/* true when @a cmd has no effect after @a prev */
+static bool jtag_command_is_noop(const struct jtag_command *prev,
+		const struct jtag_command *cmd)
+{
+	switch (cmd->type) {
+		case JTAG_PATHMOVE:
+			return cmd->cmd.pathmove->num_states == 0;
+		case JTAG_SLEEP:
+			return cmd->cmd.sleep->us == 0;
+		case JTAG_STABLECLOCKS:
+			return cmd->cmd.stableclocks->num_cycles == 0;
+		case JTAG_TMS:
+			return cmd->cmd.tms->num_bits == 0;
+		case JTAG_RUNTEST:
+			/* zero cycles in IDLE, when already there, doesn't clock TMS */
+			return cmd->cmd.runtest->num_cycles == 0
+				&& cmd->cmd.runtest->end_state == TAP_IDLE
+				&& prev != NULL && jtag_command_end_state(prev) == TAP_IDLE;
+		default:
+			return false;
+	}
+}
+
+/* folds @a cmd into @a prev when the pair can be sent as one command */
+static bool jtag_command_merge(struct jtag_command *prev,
+		const struct jtag_command *cmd)
+{
+	if (prev->type != cmd->type)
+		return false;
+
+	switch (cmd->type) {
+		case JTAG_RUNTEST:
+		{
+			/* the first one returns to IDLE, where the second one runs */
+			struct runtest_command *first = prev->cmd.runtest;
+			const struct runtest_command *second = cmd->cmd.runtest;
+
+			if (first->end_state != TAP_IDLE
+					|| second->num_cycles > INT_MAX - first->num_cycles)
+				return false;
+			first->num_cycles += second->num_cycles;
+			first->end_state = second->end_state;
+			return true;
+		}
+		case JTAG_PATHMOVE:
+		{
+			/* the second path starts where the first one ends */
+			struct pathmove_command *first = prev->cmd.pathmove;
+			const struct pathmove_command *second = cmd->cmd.pathmove;
+			tap_state_t *path = cmd_queue_alloc((first->num_states + second->num_states)
+					* sizeof(tap_state_t));
+
+			if (path == NULL)
+				return false;
+			memcpy(path, first->path, first->num_states * sizeof(tap_state_t));
+			memcpy(path + first->num_states, second->path,
+					second->num_states * sizeof(tap_state_t));
+			first->path = path;
+			first->num_states += second->num_states;
+			return true;
+		}
+		case JTAG_SLEEP:
+			if (cmd->cmd.sleep->us > UINT32_MAX - prev->cmd.sleep->us)
+				return false;
+			prev->cmd.sleep->us += cmd->cmd.sleep->us;
+			return true;
+		case JTAG_STABLECLOCKS:
+			if (cmd->cmd.stableclocks->num_cycles >
+					INT_MAX - prev->cmd.stableclocks->num_cycles)
+				return false;
+			prev->cmd.stableclocks->num_cycles += cmd->cmd.stableclocks->num_cycles;
+			return true;
+		case JTAG_TMS:
+		{
+			struct tms_command *first = prev->cmd.tms;
+			const struct tms_command *second = cmd->cmd.tms;
+			unsigned num_bits = first->num_bits + second->num_bits;
+			uint8_t *bits = cmd_queue_alloc(DIV_ROUND_UP(num_bits, 8));
+
+			if (bits == NULL)
+				return false;
+			buf_set_buf(first->bits, 0, bits, 0, first->num_bits);
+			buf_set_buf(second->bits, 0, bits, first->num_bits, second->num_bits);
+			first->bits = bits;
+			first->num_bits = num_bits;
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+unsigned jtag_command_queue_optimize(void)
+{
+	struct jtag_command **link = &jtag_command_queue;
+	struct jtag_command *prev = NULL;
+	unsigned removed = 0;
+
+	while (*link != NULL) {
+		struct jtag_command *cmd = *link;
+
+		if (jtag_command_is_noop(prev, cmd)
+				|| (prev != NULL && jtag_command_merge(prev, cmd))) {
+			/* the memory goes away with the rest of the queue */
+			*link = cmd->next;
+			removed++;
+			continue;
+		}
+
+		prev = cmd;
+		link = &cmd->next;
+	}
+
+	next_command_pointer = link;
+	cmd_queue_stats.commands_removed += removed;
+
+	return removed;
+}
+
 enum scan_type jtag_scan_type(const struct scan_command *cmd)
 {
 	int i;
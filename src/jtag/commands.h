@@ -165,9 +165,34 @@ extern struct jtag_command *jtag_command_queue;
 
 void *cmd_queue_alloc(size_t size);
 
+/** Usage counters of the memory behind cmd_queue_alloc(). */
+struct cmd_queue_stats {
+	/** queue resets that released at least one allocation */
+	unsigned long flushes;
+	/** bytes handed out in total, and the most within one flush */
+	unsigned long long bytes;
+	size_t peak_bytes;
+	/** pages taken from malloc and from the kept-page cache */
+	unsigned long pages_allocated;
+	unsigned long pages_reused;
+	/** pages currently cached for reuse */
+	unsigned pages_cached;
+	/** commands merged into their predecessor or dropped as no-ops */
+	unsigned long commands_removed;
+};
+
+void jtag_command_queue_stats(struct cmd_queue_stats *stats, bool reset);
+
 void jtag_queue_command(struct jtag_command *cmd);
 void jtag_command_queue_reset(void);
 
+/**
+ * Peephole pass over the queue, run right before it is executed: merges
+ * adjacent RUNTEST, PATHMOVE, SLEEP, STABLECLOCKS and TMS commands, and
+ * drops those which do nothing.  Returns how many commands went away.
+ */
+unsigned jtag_command_queue_optimize(void);
+
 enum scan_type jtag_scan_type(const struct scan_command *cmd);
 int jtag_scan_size(const struct scan_command *cmd);
 int jtag_read_buffer(uint8_t *buffer, const struct scan_command *cmd);
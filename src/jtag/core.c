@@ -35,6 +35,8 @@
 #include "interface.h"
 #include <transport/transport.h>
 #include <helper/jep106.h>
+#include <helper/time_support.h>
+#include <helper/perf.h>
 
 #ifdef HAVE_STRINGS_H
 #include <strings.h>
@@ -50,6 +52,11 @@ static int jtag_flush_queue_count;
 /* Sleep this # of ms after flushing the queue */
 static int jtag_flush_queue_sleep;
 
+/* Binary flush trace, see jtag_trace_open() */
+static FILE *jtag_trace_file;
+static int64_t jtag_trace_start;
+static unsigned jtag_trace_waits;
+
 static void jtag_add_scan_check(struct jtag_tap *active,
 		void (*jtag_add_scan)(struct jtag_tap *active,
 		int in_num_fields,
@@ -90,6 +97,9 @@ static int jtag_srst = -1;
  */
 static struct jtag_tap *__jtag_all_taps;
 
+/* see jtag_tap_chain_generation() */
+static unsigned jtag_chain_generation;
+
 static enum reset_types jtag_reset_config = RESET_NONE;
 tap_state_t cmd_queue_cur_state = TAP_RESET;
 
@@ -208,11 +218,18 @@ unsigned jtag_tap_count_enabled(void)
 	return n;
 }
 
+unsigned jtag_tap_chain_generation(void)
+{
+	return jtag_chain_generation;
+}
+
 /** Append a new TAP to the chain of all taps. */
 void jtag_tap_add(struct jtag_tap *t)
 {
 	unsigned jtag_num_taps = 0;
 
+	jtag_chain_generation++;
+
 	struct jtag_tap **tap = &__jtag_all_taps;
 	while (*tap != NULL) {
 		jtag_num_taps++;
@@ -326,6 +343,9 @@ int jtag_call_event_callbacks(enum jtag_event event)
 
 	LOG_DEBUG("jtag event: %s", jtag_event_strings[event]);
 
+	/* TAPs get enabled or disabled around these events */
+	jtag_chain_generation++;
+
 	while (callback) {
 		struct jtag_event_callback *next;
 
@@ -415,6 +435,61 @@ static int jtag_check_value_mask_callback(jtag_callback_data_t data0,
 		(int)data3);
 }
 
+/**
+ * Checks queued by jtag_add_scan_check().  They are kept in one array,
+ * which is reused from flush to flush, and evaluated in a single pass
+ * once the queue has been executed.
+ */
+struct jtag_scan_check {
+	uint8_t *captured;
+	uint8_t *value;
+	uint8_t *mask;
+	int num_bits;
+};
+
+static struct jtag_scan_check *jtag_scan_checks;
+static unsigned jtag_scan_checks_num;
+static unsigned jtag_scan_checks_size;
+
+static bool jtag_queue_scan_check(struct scan_field *field)
+{
+	if (jtag_scan_checks_num == jtag_scan_checks_size) {
+		unsigned new_size = jtag_scan_checks_size ? 2 * jtag_scan_checks_size : 64;
+		struct jtag_scan_check *new_checks = realloc(jtag_scan_checks,
+				new_size * sizeof(*new_checks));
+		if (new_checks == NULL)
+			return false;
+		jtag_scan_checks = new_checks;
+		jtag_scan_checks_size = new_size;
+	}
+
+	struct jtag_scan_check *check = &jtag_scan_checks[jtag_scan_checks_num++];
+	check->captured = field->in_value;
+	check->value = field->check_value;
+	check->mask = field->check_mask;
+	check->num_bits = field->num_bits;
+
+	return true;
+}
+
+/* evaluates and drops the queued checks, reporting the first failure */
+static int jtag_run_scan_checks(bool executed)
+{
+	int retval = ERROR_OK;
+
+	for (unsigned i = 0; executed && i < jtag_scan_checks_num; i++) {
+		struct jtag_scan_check *check = &jtag_scan_checks[i];
+
+		retval = jtag_check_value_inner(check->captured, check->value,
+				check->mask, check->num_bits);
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	jtag_scan_checks_num = 0;
+	return retval;
+}
+
 static void jtag_add_scan_check(struct jtag_tap *active, void (*jtag_add_scan)(
 		struct jtag_tap *active,
 		int in_num_fields,
@@ -426,7 +501,11 @@ static void jtag_add_scan_check(struct jtag_tap *active, void (*jtag_add_scan)(
 
 	for (int i = 0; i < in_num_fields; i++) {
 		if ((in_fields[i].check_value != NULL) && (in_fields[i].in_value != NULL)) {
-			/* this is synchronous for a minidriver */
+			if (jtag_queue_scan_check(&in_fields[i]))
+				continue;
+
+			/* out of memory for the check list, fall back to a
+			 * callback; this is synchronous for a minidriver */
 			jtag_add_callback4(jtag_check_value_mask_callback,
 				(jtag_callback_data_t)in_fields[i].in_value,
 				(jtag_callback_data_t)in_fields[i].check_value,
@@ -768,7 +847,9 @@ void jtag_add_reset(int req_tlr_or_trst, int req_srst)
 void jtag_add_sleep(uint32_t us)
 {
 	/** @todo Here, keep_alive() appears to be a layering violation!!! */
-	keep_alive();
+	if (!(jtag->supported & DEBUG_CAP_QUEUED_SLEEP) ||
+			us >= ADAPTER_QUEUED_SLEEP_MAX_US)
+		keep_alive();
 	jtag_set_error(interface_jtag_add_sleep(us));
 }
 
@@ -842,7 +923,14 @@ int default_interface_jtag_execute_queue(void)
 void jtag_execute_queue_noclear(void)
 {
 	jtag_flush_queue_count++;
-	jtag_set_error(interface_jtag_execute_queue());
+	perf_add(PERF_JTAG_FLUSHES, 1);
+
+	int retval = interface_jtag_execute_queue();
+	jtag_set_error(retval);
+	jtag_set_error(jtag_run_scan_checks(retval == ERROR_OK));
+
+	/* long operations are made of many flushes, let GDB know we are alive */
+	keep_alive();
 
 	if (jtag_flush_queue_sleep > 0) {
 		/* For debug purposes it can be useful to test performance
@@ -858,6 +946,76 @@ int jtag_get_flush_queue_count(void)
 	return jtag_flush_queue_count;
 }
 
+#define JTAG_TRACE_MAGIC	"OCDFLTR1"
+#define JTAG_TRACE_RECORD	32
+
+int jtag_trace_open(const char *filename)
+{
+	if (jtag_trace_file) {
+		fclose(jtag_trace_file);
+		jtag_trace_file = NULL;
+	}
+
+	if (!filename)
+		return ERROR_OK;
+
+	jtag_trace_file = fopen(filename, "wb");
+	if (!jtag_trace_file) {
+		LOG_ERROR("can't open %s for writing", filename);
+		return ERROR_FAIL;
+	}
+
+	fwrite(JTAG_TRACE_MAGIC, 1, strlen(JTAG_TRACE_MAGIC), jtag_trace_file);
+	jtag_trace_start = perf_time_us();
+	jtag_trace_waits = 0;
+
+	return ERROR_OK;
+}
+
+int64_t jtag_trace_begin(void)
+{
+	return jtag_trace_file ? perf_time_us() : 0;
+}
+
+/*
+ * Record layout, all little-endian:
+ *   0  u8  kind (enum jtag_trace_kind)
+ *   1  u8  reserved
+ *   2  u16 WAIT responses reported since the previous record
+ *   4  i32 result of the flush
+ *   8  u32 commands (JTAG) or transactions (SWD)
+ *  12  u32 bits
+ *  16  u64 start, us since the trace was opened
+ *  24  u32 duration, us
+ *  28  u32 reserved
+ */
+void jtag_trace_record(enum jtag_trace_kind kind, int64_t begin,
+		unsigned transactions, unsigned bits, int retval)
+{
+	uint8_t record[JTAG_TRACE_RECORD];
+
+	if (!jtag_trace_file || !begin)
+		return;
+
+	memset(record, 0, sizeof(record));
+	record[0] = kind;
+	h_u16_to_le(record + 2, MIN(jtag_trace_waits, 0xffff));
+	h_u32_to_le(record + 4, retval);
+	h_u32_to_le(record + 8, transactions);
+	h_u32_to_le(record + 12, bits);
+	h_u64_to_le(record + 16, begin - jtag_trace_start);
+	h_u32_to_le(record + 24, perf_time_us() - begin);
+
+	fwrite(record, 1, sizeof(record), jtag_trace_file);
+	jtag_trace_waits = 0;
+}
+
+void jtag_trace_wait(void)
+{
+	jtag_trace_waits++;
+	perf_add(PERF_DAP_WAITS, 1);
+}
+
 int jtag_execute_queue(void)
 {
 	jtag_execute_queue_noclear();
@@ -907,7 +1065,16 @@ void jtag_sleep(uint32_t us)
 /* a larger IR length than we ever expect to autoprobe */
 #define JTAG_IRLEN_MAX          60
 
-static int jtag_examine_chain_execute(uint8_t *idcode_buffer, unsigned num_idcode)
+/* The IR capture validation scan, see jtag_validate_ircapture() */
+struct jtag_ircapture_scan {
+	uint8_t *ir_test;
+	int total_ir_length;
+};
+
+static int jtag_ircapture_queue(struct jtag_ircapture_scan *scan);
+
+static int jtag_examine_chain_execute(uint8_t *idcode_buffer, unsigned num_idcode,
+		struct jtag_ircapture_scan *ir_scan)
 {
 	struct scan_field field = {
 		.num_bits = num_idcode * 32,
@@ -921,6 +1088,14 @@ static int jtag_examine_chain_execute(uint8_t *idcode_buffer, unsigned num_idcod
 
 	jtag_add_plain_dr_scan(field.num_bits, field.out_value, field.in_value, TAP_DRPAUSE);
 	jtag_add_tlr();
+
+	/* the IR capture scan can share the flush */
+	if (ir_scan) {
+		int retval = jtag_ircapture_queue(ir_scan);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
 	return jtag_execute_queue();
 }
 
@@ -1037,8 +1212,10 @@ static bool jtag_examine_chain_match_tap(const struct jtag_tap *tap)
 
 /* Try to examine chain layout according to IEEE 1149.1 §12
  * This is called a "blind interrogation" of the scan chain.
+ * With @a ir_scan, the IR capture scan is queued behind it and
+ * executed in the same flush.
  */
-static int jtag_examine_chain(void)
+static int jtag_examine_chain(struct jtag_ircapture_scan *ir_scan)
 {
 	int retval;
 	unsigned max_taps = jtag_tap_count();
@@ -1058,7 +1235,7 @@ static int jtag_examine_chain(void)
 	 * Then make sure the scan data has both ones and zeroes.
 	 */
 	LOG_DEBUG("DR scan interrogation for IDCODE/BYPASS");
-	retval = jtag_examine_chain_execute(idcode_buffer, max_taps);
+	retval = jtag_examine_chain_execute(idcode_buffer, max_taps, ir_scan);
 	if (retval != ERROR_OK)
 		goto out;
 	if (!jtag_examine_chain_check(idcode_buffer, max_taps)) {
@@ -1153,15 +1330,12 @@ out:
  * Entry state can be anything.  On non-error exit, all TAPs are in
  * bypass mode.  On error exits, the scan chain is reset.
  */
-static int jtag_validate_ircapture(void)
+static int jtag_ircapture_queue(struct jtag_ircapture_scan *scan)
 {
 	struct jtag_tap *tap;
 	int total_ir_length = 0;
 	uint8_t *ir_test = NULL;
 	struct scan_field field;
-	uint64_t val;
-	int chain_pos = 0;
-	int retval;
 
 	/* when autoprobing, accomodate huge IR lengths */
 	for (tap = NULL, total_ir_length = 0;
@@ -1187,13 +1361,22 @@ static int jtag_validate_ircapture(void)
 
 	jtag_add_plain_ir_scan(field.num_bits, field.out_value, field.in_value, TAP_IDLE);
 
-	LOG_DEBUG("IR capture validation scan");
-	retval = jtag_execute_queue();
-	if (retval != ERROR_OK)
-		goto done;
+	scan->ir_test = ir_test;
+	scan->total_ir_length = total_ir_length;
+	return ERROR_OK;
+}
 
-	tap = NULL;
-	chain_pos = 0;
+/* Check the result of a scan queued by jtag_ircapture_queue(), and free it */
+static int jtag_ircapture_check(struct jtag_ircapture_scan *scan)
+{
+	struct jtag_tap *tap = NULL;
+	uint8_t *ir_test = scan->ir_test;
+	int total_ir_length = scan->total_ir_length;
+	uint64_t val;
+	int chain_pos = 0;
+	int retval = ERROR_OK;
+
+	scan->ir_test = NULL;
 
 	for (;; ) {
 		tap = jtag_tap_next_enabled(tap);
@@ -1222,6 +1405,7 @@ static int jtag_validate_ircapture(void)
 					&& tap->ir_length < JTAG_IRLEN_MAX) {
 				tap->ir_length++;
 			}
+			jtag_chain_generation++;
 			LOG_WARNING("AUTO %s - use \"jtag newtap " "%s %s -irlen %d "
 					"-expected-id 0x%08" PRIx32 "\"",
 					tap->dotted_name, tap->chip, tap->tapname, tap->ir_length, tap->idcode);
@@ -1269,6 +1453,42 @@ done:
 	return retval;
 }
 
+static int jtag_validate_ircapture(void)
+{
+	struct jtag_ircapture_scan scan;
+
+	int retval = jtag_ircapture_queue(&scan);
+	if (retval != ERROR_OK)
+		return retval;
+
+	LOG_DEBUG("IR capture validation scan");
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK) {
+		free(scan.ir_test);
+		jtag_add_tlr();
+		jtag_execute_queue();
+		return retval;
+	}
+
+	return jtag_ircapture_check(&scan);
+}
+
+/* True if all enabled TAPs have a known IR length, so the IR capture
+ * scan doesn't depend on the IDCODE scan */
+static bool jtag_ircapture_is_known(void)
+{
+	struct jtag_tap *tap = jtag_tap_next_enabled(NULL);
+
+	if (tap == NULL)
+		return false;
+	for (; tap; tap = jtag_tap_next_enabled(tap)) {
+		if (tap->ir_length == 0)
+			return false;
+	}
+	return true;
+}
+
+
 void jtag_tap_init(struct jtag_tap *tap)
 {
 	unsigned ir_len_bits;
@@ -1307,6 +1527,7 @@ void jtag_tap_init(struct jtag_tap *tap)
 void jtag_tap_free(struct jtag_tap *tap)
 {
 	jtag_unregister_event_callback(&jtag_reset_callback, tap);
+	jtag_chain_generation++;
 
 	free(tap->expected);
 	free(tap->expected_mask);
@@ -1422,11 +1643,19 @@ int jtag_init_inner(struct command_context *cmd_ctx)
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* When every IR length is already known, from the configuration or
+	 * an earlier autoprobe, the IR capture scan is queued right behind
+	 * the IDCODE scan and the chain is checked with a single flush.
+	 */
+	struct jtag_ircapture_scan ir_scan = { .ir_test = NULL };
+	bool ir_scan_queued = jtag_ircapture_is_known();
+	unsigned num_taps = jtag_tap_count();
+
 	/* Examine DR values first.  This discovers problems which will
 	 * prevent communication ... hardware issues like TDO stuck, or
 	 * configuring the wrong number of (enabled) TAPs.
 	 */
-	retval = jtag_examine_chain();
+	retval = jtag_examine_chain(ir_scan_queued ? &ir_scan : NULL);
 	switch (retval) {
 		case ERROR_OK:
 			/* complete success */
@@ -1452,7 +1681,14 @@ int jtag_init_inner(struct command_context *cmd_ctx)
 	 * latter is uncommon, but easily worked around:  provide
 	 * ircapture/irmask values during TAP setup.)
 	 */
-	retval = jtag_validate_ircapture();
+	if (ir_scan.ir_test && (retval == ERROR_OK || retval == ERROR_JTAG_INIT_SOFT_FAIL)
+			&& jtag_tap_count() == num_taps)
+		retval = jtag_ircapture_check(&ir_scan);
+	else {
+		/* the chain didn't match what the shared scan assumed */
+		free(ir_scan.ir_test);
+		retval = jtag_validate_ircapture();
+	}
 	if (retval != ERROR_OK) {
 		/* The target might be powered down. The user
 		 * can power it up and reset it after firing
@@ -1645,6 +1881,221 @@ int jtag_config_rclk(unsigned fallback_speed_khz)
 	return (ERROR_OK != retval) ? retval : jtag_set_speed(speed);
 }
 
+/* adapter_khz auto: each speed is checked this many times */
+#define ADAPTER_PROBE_ROUNDS	8
+/* DPIDR reads per SWD check */
+#define ADAPTER_PROBE_READS	32
+/* bits shifted through the BYPASS registers per JTAG check */
+#define ADAPTER_PROBE_BITS	256
+
+/* DPIDR read at the starting speed of adapter_khz auto */
+static uint32_t probe_dpidr;
+
+/* link errors reported by adapter drivers since the last check of the
+ * speed monitor, and its configuration */
+static unsigned int link_errors;
+static bool speed_monitor;
+static unsigned int speed_monitor_min_khz;
+
+static int adapter_probe_jtag(void)
+{
+	struct jtag_tap *tap;
+	unsigned int num_taps = 0, ir_bits = 0, id_bits = 0;
+	int retval;
+
+	for (tap = jtag_tap_next_enabled(NULL); tap; tap = jtag_tap_next_enabled(tap)) {
+		num_taps++;
+		ir_bits += tap->ir_length;
+		id_bits += tap->hasidcode ? 32 : 1;
+	}
+	if (num_taps == 0)
+		return ERROR_JTAG_INIT_FAILED;
+
+	unsigned int dr_bits = MAX(id_bits, ADAPTER_PROBE_BITS + num_taps);
+	uint8_t *ones = malloc(DIV_ROUND_UP(MAX(ir_bits, dr_bits), 8));
+	uint8_t *pattern = calloc(1, DIV_ROUND_UP(dr_bits, 8));
+	uint8_t *ids = malloc(DIV_ROUND_UP(id_bits, 8));
+	uint8_t *in = malloc(DIV_ROUND_UP(dr_bits, 8));
+	if (ones == NULL || pattern == NULL || ids == NULL || in == NULL) {
+		retval = ERROR_FAIL;
+		goto out;
+	}
+	memset(ones, 0xff, DIV_ROUND_UP(MAX(ir_bits, dr_bits), 8));
+	for (unsigned int i = 0; i < ADAPTER_PROBE_BITS / 8; i++)
+		pattern[i] = (i & 1 ? 0xa5 : 0x3c) ^ (i * 0x1d);
+
+	/* after TLR each TAP holds its IDCODE, or a one bit BYPASS */
+	jtag_add_tlr();
+	jtag_add_plain_dr_scan(id_bits, ones, ids, TAP_IDLE);
+	/* then all TAPs in BYPASS delay the pattern by one bit each */
+	jtag_add_plain_ir_scan(ir_bits, ones, NULL, TAP_IDLE);
+	jtag_add_plain_dr_scan(ADAPTER_PROBE_BITS + num_taps, pattern, in, TAP_IDLE);
+	/* leave the TAPs in a state the targets know about */
+	jtag_add_tlr();
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		goto out;
+
+	unsigned int offset = 0;
+	for (tap = jtag_tap_next_enabled(NULL); tap; tap = jtag_tap_next_enabled(tap)) {
+		if (!tap->hasidcode) {
+			offset++;
+			continue;
+		}
+		if (tap->idcode && buf_get_u32(ids, offset, 32) != tap->idcode) {
+			LOG_DEBUG("%s: IDCODE 0x%08" PRIx32 " instead of 0x%08" PRIx32,
+					tap->dotted_name, buf_get_u32(ids, offset, 32), tap->idcode);
+			retval = ERROR_JTAG_QUEUE_FAILED;
+			goto out;
+		}
+		offset += 32;
+	}
+
+	for (unsigned int i = 0; i < ADAPTER_PROBE_BITS; i++) {
+		if (buf_get_u32(in, num_taps + i, 1) != buf_get_u32(pattern, i, 1)) {
+			LOG_DEBUG("BYPASS loopback mismatch at bit %u", i);
+			retval = ERROR_JTAG_QUEUE_FAILED;
+			goto out;
+		}
+	}
+
+out:
+	free(ones);
+	free(pattern);
+	free(ids);
+	free(in);
+	return retval;
+}
+
+static int adapter_probe_swd(bool reference)
+{
+	const struct swd_driver *swd = jtag->swd;
+	uint32_t dpidr[ADAPTER_PROBE_READS];
+	int retval;
+
+	/* a line reset recovers from errors at a previous speed, the DP then
+	 * expects a DPIDR read (DP register 0) */
+	retval = swd->switch_seq(LINE_RESET);
+	if (retval != ERROR_OK)
+		return retval;
+	for (unsigned int i = 0; i < ADAPTER_PROBE_READS; i++)
+		swd->read_reg(swd_cmd(true, false, 0), &dpidr[i], 0);
+	retval = swd->run();
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (reference)
+		probe_dpidr = dpidr[0];
+	for (unsigned int i = 0; i < ADAPTER_PROBE_READS; i++) {
+		if (dpidr[i] != probe_dpidr) {
+			LOG_DEBUG("DPIDR 0x%08" PRIx32 " instead of 0x%08" PRIx32,
+					dpidr[i], probe_dpidr);
+			return ERROR_FAIL;
+		}
+	}
+	return ERROR_OK;
+}
+
+/* sets khz and checks the link there ADAPTER_PROBE_ROUNDS times */
+static int adapter_probe_speed(unsigned int khz, bool reference)
+{
+	int retval = jtag_config_khz(khz);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned int i = 0; i < ADAPTER_PROBE_ROUNDS; i++) {
+		if (transport_is_swd())
+			retval = adapter_probe_swd(reference && i == 0);
+		else
+			retval = adapter_probe_jtag();
+		if (retval != ERROR_OK) {
+			LOG_DEBUG("link check failed at %u kHz", khz);
+			return retval;
+		}
+	}
+	LOG_DEBUG("link check passed at %u kHz", khz);
+	return ERROR_OK;
+}
+
+int adapter_speed_auto(unsigned int max_khz, unsigned int margin_percent)
+{
+	unsigned int start_khz = speed_khz;
+	unsigned int lo, hi, khz;
+	int retval;
+
+	if (!transport_is_jtag() && !(transport_is_swd() && jtag->swd)) {
+		LOG_ERROR("automatic adapter speed needs a JTAG or SWD transport");
+		return ERROR_FAIL;
+	}
+	if (clock_mode != CLOCK_MODE_KHZ || !start_khz) {
+		LOG_ERROR("automatic adapter speed starts from a fixed speed set with adapter_khz");
+		return ERROR_FAIL;
+	}
+
+	retval = adapter_probe_speed(start_khz, true);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("the link is not reliable at %u kHz already", start_khz);
+		return retval;
+	}
+
+	/* lo passed, hi failed or is the limit and still untested */
+	lo = start_khz;
+	hi = max_khz;
+	if (hi > lo && adapter_probe_speed(hi, false) == ERROR_OK)
+		lo = hi;
+	while (hi > lo + lo / 32 && hi > lo + 1) {
+		khz = lo + (hi - lo) / 2;
+		if (adapter_probe_speed(khz, false) == ERROR_OK)
+			lo = khz;
+		else
+			hi = khz;
+	}
+
+	khz = MAX((uint64_t)lo * (100 - margin_percent) / 100, start_khz);
+	retval = adapter_probe_speed(khz, false);
+	if (retval != ERROR_OK) {
+		LOG_WARNING("the link is not reliable at %u kHz, going back to %u kHz",
+				khz, start_khz);
+		khz = start_khz;
+		retval = jtag_config_khz(khz);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	LOG_INFO("highest reliable adapter speed %u kHz, using %u kHz", lo, khz);
+	return ERROR_OK;
+}
+
+void adapter_report_link_error(void)
+{
+	link_errors++;
+}
+
+void adapter_speed_monitor_config(bool enable, unsigned int min_khz)
+{
+	speed_monitor = enable;
+	speed_monitor_min_khz = min_khz;
+	link_errors = 0;
+}
+
+void adapter_speed_monitor(void)
+{
+	unsigned int khz;
+
+	if (!speed_monitor || !link_errors || clock_mode != CLOCK_MODE_KHZ)
+		return;
+
+	khz = speed_khz - speed_khz / 8;
+	if (khz < speed_monitor_min_khz)
+		khz = speed_monitor_min_khz;
+	if (khz < (unsigned int)speed_khz) {
+		LOG_WARNING("%u link errors at %u kHz, lowering the adapter speed to %u kHz",
+				link_errors, speed_khz, khz);
+		jtag_config_khz(khz);
+	}
+	link_errors = 0;
+}
+
 int jtag_get_speed(int *speed)
 {
 	switch (clock_mode) {
@@ -1843,6 +2294,17 @@ int adapter_config_trace(bool enabled, enum tpio_pin_protocol pin_protocol,
 	return ERROR_OK;
 }
 
+/* fails quietly if the adapter can't tell, callers fall back to
+ * config_trace() then */
+int adapter_check_trace_freq(enum tpio_pin_protocol pin_protocol,
+		unsigned int trace_freq, bool *supported)
+{
+	if (jtag->check_trace_freq)
+		return jtag->check_trace_freq(pin_protocol, trace_freq, supported);
+
+	return ERROR_FAIL;
+}
+
 int adapter_poll_trace(uint8_t *buf, size_t *size)
 {
 	if (jtag->poll_trace)
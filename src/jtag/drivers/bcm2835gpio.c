@@ -24,6 +24,7 @@
 #endif
 
 #include <jtag/interface.h>
+#include <helper/time_support.h>
 #include "bitbang.h"
 
 #include <sys/mman.h>
@@ -51,6 +52,8 @@ static volatile uint32_t *pio_base;
 
 static int bcm2835gpio_read(void);
 static void bcm2835gpio_write(int tck, int tms, int tdi);
+static void bcm2835gpio_write_block(const uint8_t *tms, const uint8_t *tdi,
+		uint8_t *tdo, unsigned len);
 static void bcm2835gpio_reset(int trst, int srst);
 
 static int bcm2835_swdio_read(void);
@@ -62,6 +65,7 @@ static int bcm2835gpio_quit(void);
 static struct bitbang_interface bcm2835gpio_bitbang = {
 	.read = bcm2835gpio_read,
 	.write = bcm2835gpio_write,
+	.write_block = bcm2835gpio_write_block,
 	.reset = bcm2835gpio_reset,
 	.swdio_read = bcm2835_swdio_read,
 	.swdio_drive = bcm2835_swdio_drive,
@@ -89,6 +93,7 @@ static int swdio_gpio_mode;
 /* Transition delay coefficients */
 static int speed_coeff = 113714;
 static int speed_offset = 28;
+static bool speed_coeffs_set;
 static unsigned int jtag_delay;
 
 static int bcm2835gpio_read(void)
@@ -108,6 +113,95 @@ static void bcm2835gpio_write(int tck, int tms, int tdi)
 		asm volatile ("");
 }
 
+/*
+ * Shift len bits with one store to clear TCK and update TMS/TDI, one load
+ * for TDO and one store to raise TCK per bit. With all masks zero the stores
+ * change nothing, which is what bcm2835gpio_calibrate() relies on.
+ */
+static inline void bcm2835gpio_shift(uint32_t tck_mask, uint32_t tms_mask,
+		uint32_t tdi_mask, uint32_t tdo_mask, const uint8_t *tms,
+		const uint8_t *tdi, uint8_t *tdo, unsigned len)
+{
+	for (unsigned i = 0; i < len; i += 8) {
+		unsigned n = MIN(8u, len - i);
+		uint8_t tms_byte = tms ? tms[i / 8] : 0;
+		uint8_t tdi_byte = tdi ? tdi[i / 8] : 0;
+		uint8_t tdo_byte = 0;
+
+		for (unsigned b = 0; b < n; b++) {
+			uint32_t set = (tms_byte & 1 << b ? tms_mask : 0) |
+				(tdi_byte & 1 << b ? tdi_mask : 0);
+
+			GPIO_SET = set;
+			GPIO_CLR = tck_mask | ((tms_mask | tdi_mask) & ~set);
+
+			for (unsigned int j = 0; j < jtag_delay; j++)
+				asm volatile ("");
+
+			if (GPIO_LEV & tdo_mask)
+				tdo_byte |= 1 << b;
+
+			GPIO_SET = tck_mask;
+
+			for (unsigned int j = 0; j < jtag_delay; j++)
+				asm volatile ("");
+		}
+
+		if (tdo) {
+			uint8_t keep = n == 8 ? 0 : 0xff << n;
+			tdo[i / 8] = (tdo[i / 8] & keep) | tdo_byte;
+		}
+	}
+}
+
+static void bcm2835gpio_write_block(const uint8_t *tms, const uint8_t *tdi,
+		uint8_t *tdo, unsigned len)
+{
+	bcm2835gpio_shift(1 << tck_gpio, 1 << tms_gpio, 1 << tdi_gpio,
+			tdo ? 1 << tdo_gpio : 0, tms, tdi, tdo, len);
+}
+
+/*
+ * Derive the speed coefficients by timing bcm2835gpio_shift() with all pin
+ * masks cleared, at two delay settings. This costs the same bus accesses as
+ * a real shift without touching any pin.
+ */
+static int bcm2835gpio_calibrate(void)
+{
+	const unsigned bits = 1 << 16;
+	const unsigned delays[2] = { 0, 64 };
+	float seconds[2];
+	uint8_t scratch[bits / 8];
+	unsigned int saved_delay = jtag_delay;
+
+	for (int i = 0; i < 2; i++) {
+		struct duration d;
+
+		jtag_delay = delays[i];
+		duration_start(&d);
+		bcm2835gpio_shift(0, 0, 0, 0, NULL, NULL, scratch, bits);
+		duration_measure(&d);
+		seconds[i] = duration_elapsed(&d);
+	}
+	jtag_delay = saved_delay;
+
+	/* kHz = 1 / ((a + b * delay) * 1000) = coeff / (delay + offset) */
+	float a = seconds[0] / bits;
+	float b = (seconds[1] - seconds[0]) / bits / delays[1];
+	if (a <= 0 || b <= 0) {
+		LOG_WARNING("bcm2835gpio: speed calibration failed, keeping coefficients %d %d",
+			speed_coeff, speed_offset);
+		return ERROR_FAIL;
+	}
+
+	speed_coeff = (int)(1 / (b * 1000));
+	speed_offset = (int)(a / b);
+	LOG_INFO("bcm2835gpio: calibrated speed coefficients %d %d",
+		speed_coeff, speed_offset);
+
+	return ERROR_OK;
+}
+
 static void bcm2835gpio_swd_write(int tck, int tms, int tdi)
 {
 	uint32_t set = tck<<swclk_gpio | tdi<<swdio_gpio;
@@ -293,10 +387,21 @@ COMMAND_HANDLER(bcm2835gpio_handle_speed_coeffs)
 	if (CMD_ARGC == 2) {
 		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], speed_coeff);
 		COMMAND_PARSE_NUMBER(int, CMD_ARGV[1], speed_offset);
+		speed_coeffs_set = true;
 	}
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(bcm2835gpio_handle_calibrate)
+{
+	int retval = bcm2835gpio_calibrate();
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* apply the new coefficients to the current adapter speed */
+	return jtag_config_khz(jtag_get_speed_khz());
+}
+
 COMMAND_HANDLER(bcm2835gpio_handle_peripheral_base)
 {
 	if (CMD_ARGC == 1)
@@ -373,6 +478,13 @@ static const struct command_registration bcm2835gpio_command_handlers[] = {
 		.mode = COMMAND_CONFIG,
 		.help = "SPEED_COEFF and SPEED_OFFSET for delay calculations.",
 	},
+	{
+		.name = "bcm2835gpio_calibrate",
+		.handler = &bcm2835gpio_handle_calibrate,
+		.mode = COMMAND_EXEC,
+		.help = "measure SPEED_COEFF and SPEED_OFFSET on this board.",
+		.usage = "",
+	},
 	{
 		.name = "bcm2835gpio_peripheral_base",
 		.handler = &bcm2835gpio_handle_peripheral_base,
@@ -508,9 +620,13 @@ static int bcm2835gpio_init(void)
 
 	if (swd_mode) {
 		bcm2835gpio_bitbang.write = bcm2835gpio_swd_write;
+		bcm2835gpio_bitbang.write_block = NULL;
 		bitbang_switch_to_swd();
 	}
 
+	if (!speed_coeffs_set)
+		bcm2835gpio_calibrate();
+
 	return ERROR_OK;
 }
 
@@ -106,10 +106,15 @@ static int bitbang_execute_tms(struct jtag_command *cmd)
 	DEBUG_JTAG_IO("TMS: %d bits", num_bits);
 
 	int tms = 0;
-	for (unsigned i = 0; i < num_bits; i++) {
-		tms = ((bits[i/8] >> (i % 8)) & 1);
-		bitbang_interface->write(0, tms, 0);
-		bitbang_interface->write(1, tms, 0);
+	if (bitbang_interface->write_block && num_bits) {
+		bitbang_interface->write_block(bits, NULL, NULL, num_bits);
+		tms = (bits[(num_bits - 1) / 8] >> ((num_bits - 1) % 8)) & 1;
+	} else {
+		for (unsigned i = 0; i < num_bits; i++) {
+			tms = ((bits[i/8] >> (i % 8)) & 1);
+			bitbang_interface->write(0, tms, 0);
+			bitbang_interface->write(1, tms, 0);
+		}
 	}
 	bitbang_interface->write(CLOCK_IDLE(), tms, 0);
 
@@ -161,9 +166,13 @@ static void bitbang_runtest(int num_cycles)
 	}
 
 	/* execute num_cycles */
-	for (i = 0; i < num_cycles; i++) {
-		bitbang_interface->write(0, 0, 0);
-		bitbang_interface->write(1, 0, 0);
+	if (bitbang_interface->write_block && num_cycles > 0)
+		bitbang_interface->write_block(NULL, NULL, NULL, num_cycles);
+	else {
+		for (i = 0; i < num_cycles; i++) {
+			bitbang_interface->write(0, 0, 0);
+			bitbang_interface->write(1, 0, 0);
+		}
 	}
 	bitbang_interface->write(CLOCK_IDLE(), 0, 0);
 
@@ -189,6 +198,7 @@ static void bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer, int
 {
 	tap_state_t saved_end_state = tap_get_end_state();
 	int bit_cnt;
+	unsigned buffered = 0;
 
 	if (!((!ir_scan &&
 			(tap_get_state() == TAP_DRSHIFT)) ||
@@ -202,7 +212,17 @@ static void bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer, int
 		bitbang_end_state(saved_end_state);
 	}
 
-	for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
+	bit_cnt = 0;
+	if (bitbang_interface->write_block && scan_size > 1) {
+		/* all bits but the last one, which leaves the shift state */
+		bitbang_interface->write_block(NULL,
+				type != SCAN_IN ? buffer : NULL,
+				type != SCAN_OUT ? buffer : NULL,
+				scan_size - 1);
+		bit_cnt = scan_size - 1;
+	}
+
+	for (; bit_cnt < scan_size; bit_cnt++) {
 		int val = 0;
 		int tms = (bit_cnt == scan_size-1) ? 1 : 0;
 		int tdi;
@@ -219,17 +239,35 @@ static void bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer, int
 
 		bitbang_interface->write(0, tms, tdi);
 
-		if (type != SCAN_OUT)
-			val = bitbang_interface->read();
+		if (type != SCAN_OUT) {
+			if (bitbang_interface->buf_size) {
+				bitbang_interface->sample();
+				buffered++;
+			} else
+				val = bitbang_interface->read();
+		}
 
 		bitbang_interface->write(1, tms, tdi);
 
-		if (type != SCAN_OUT) {
+		if (type != SCAN_OUT && !bitbang_interface->buf_size) {
 			if (val)
 				buffer[bytec] |= bcval;
 			else
 				buffer[bytec] &= ~bcval;
 		}
+
+		/* collect the outstanding samples when the window is full
+		 * or the scan is done */
+		if (buffered && (buffered == bitbang_interface->buf_size ||
+				bit_cnt == scan_size - 1)) {
+			for (int i = bit_cnt + 1 - buffered; i <= bit_cnt; i++) {
+				if (bitbang_interface->read_sample())
+					buffer[i / 8] |= 1 << (i % 8);
+				else
+					buffer[i / 8] &= ~(1 << (i % 8));
+			}
+			buffered = 0;
+		}
 	}
 
 	if (tap_get_state() != tap_get_end_state()) {
@@ -450,6 +488,7 @@ static void bitbang_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay
 		 case SWD_ACK_OK:
 			if (parity != parity_u32(data)) {
 				LOG_DEBUG("Wrong parity detected");
+				adapter_report_link_error();
 				queued_retval = ERROR_FAIL;
 				return;
 			}
@@ -460,6 +499,7 @@ static void bitbang_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay
 			return;
 		 case SWD_ACK_WAIT:
 			LOG_DEBUG("SWD_ACK_WAIT");
+			jtag_trace_wait();
 			swd_clear_sticky_errors();
 			break;
 		 case SWD_ACK_FAULT:
@@ -505,6 +545,9 @@ static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay
 			  (cmd & SWD_CMD_A32) >> 1,
 			  buf_get_u32(trn_ack_data_parity_trn, 1 + 3 + 1, 32));
 
+		if (!swd_cmd_returns_ack(cmd))
+			return;
+
 		switch (ack) {
 		 case SWD_ACK_OK:
 			if (cmd & SWD_CMD_APnDP)
@@ -512,6 +555,7 @@ static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay
 			return;
 		 case SWD_ACK_WAIT:
 			LOG_DEBUG("SWD_ACK_WAIT");
+			jtag_trace_wait();
 			swd_clear_sticky_errors();
 			break;
 		 case SWD_ACK_FAULT:
@@ -28,7 +28,21 @@ struct bitbang_interface {
 	/* low level callbacks (for bitbang)
 	 */
 	int (*read)(void);
+	/* optional split read: sample() requests TDO without waiting for it,
+	 * read_sample() returns the results in order. Up to buf_size samples
+	 * may be outstanding; buf_size 0 means only read() is used.
+	 */
+	void (*sample)(void);
+	int (*read_sample)(void);
+	unsigned buf_size;
 	void (*write)(int tck, int tms, int tdi);
+	/* optional block shift of len bits, LSB first. For each bit it does what
+	 * write(0, tms, tdi), sampling TDO and write(1, tms, tdi) would do.
+	 * tms and tdi may be NULL to shift zeros, tdo may be NULL if TDO is not
+	 * needed and may alias tdi.
+	 */
+	void (*write_block)(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+			unsigned len);
 	void (*reset)(int trst, int srst);
 	void (*blink)(int on);
 	int (*swdio_read)(void);
@@ -26,6 +26,7 @@
 
 #include <termios.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 
 #undef DEBUG_SERIAL
@@ -78,7 +79,8 @@ enum {
 
 enum {
 	SERIAL_NORMAL = 0,
-	SERIAL_FAST = 1
+	SERIAL_FAST = 1,
+	SERIAL_AUTO = 2		/* fast if the serial port can do it */
 };
 
 static const cc_t SHORT_TIMEOUT  = 1; /* Must be at least 1. */
@@ -118,6 +120,9 @@ static int buspirate_serial_open(char *port);
 static int buspirate_serial_setspeed(int fd, char speed, cc_t timeout);
 static int buspirate_serial_write(int fd, char *buf, int size);
 static int buspirate_serial_read(int fd, char *buf, int size);
+static int buspirate_serial_transfer(int fd, char *out, int out_size,
+		char *in, int in_size);
+static bool buspirate_serial_can_do_fast(int fd);
 static void buspirate_serial_close(int fd);
 static void buspirate_print_buffer(char *buf, int size);
 
@@ -297,6 +302,10 @@ static int buspirate_init(void)
 
 	buspirate_jtag_enable(buspirate_fd);
 
+	if (buspirate_baudrate == SERIAL_AUTO && !buspirate_serial_can_do_fast(buspirate_fd)) {
+		LOG_INFO("Serial port can't do 1 Mbaud, staying in normal mode");
+		buspirate_baudrate = SERIAL_NORMAL;
+	}
 	if (buspirate_baudrate != SERIAL_NORMAL)
 		buspirate_jtag_set_speed(buspirate_fd, SERIAL_FAST);
 
@@ -421,8 +430,10 @@ COMMAND_HANDLER(buspirate_handle_speed_command)
 		buspirate_baudrate = SERIAL_NORMAL;
 	else if (CMD_ARGV[0][0] == 'f')
 		buspirate_baudrate = SERIAL_FAST;
+	else if (CMD_ARGV[0][0] == 'a')
+		buspirate_baudrate = SERIAL_AUTO;
 	else
-		LOG_ERROR("usage: buspirate_speed <normal|fast>");
+		LOG_ERROR("usage: buspirate_speed <normal|fast|auto>");
 
 	return ERROR_OK;
 
@@ -470,10 +481,11 @@ static const struct command_registration buspirate_command_handlers[] = {
 	},
 	{
 		.name = "buspirate_speed",
-		.usage = "<normal|fast>",
+		.usage = "<normal|fast|auto>",
 		.handler = &buspirate_handle_speed_command,
 		.mode = COMMAND_CONFIG,
-		.help = "speed of the interface",
+		.help = "speed of the interface, auto uses fast if the "
+			"serial port supports it",
 	},
 	{
 		.name = "buspirate_mode",
@@ -660,6 +672,7 @@ static int buspirate_tap_execute(void)
 	static const int CMD_TAP_SHIFT_HEADER_LEN = 3;
 
 	char tmp[4096];
+	char reply[BUSPIRATE_BUFFER_SIZE + 3];
 	uint8_t *in_buf;
 	int i;
 	int fill_index = 0;
@@ -694,18 +707,14 @@ static int buspirate_tap_execute(void)
 												  tap_chain_index, last_tap_state);
 	}
 
-	ret = buspirate_serial_write(buspirate_fd, tmp, CMD_TAP_SHIFT_HEADER_LEN + bytes_to_send*2);
-	if (ret != bytes_to_send*2+CMD_TAP_SHIFT_HEADER_LEN) {
-		LOG_ERROR("error writing :(");
-		return ERROR_JTAG_DEVICE_ERROR;
-	}
-
-	ret = buspirate_serial_read(buspirate_fd, tmp, bytes_to_send + CMD_TAP_SHIFT_HEADER_LEN);
-	if (ret != bytes_to_send + CMD_TAP_SHIFT_HEADER_LEN) {
-		LOG_ERROR("error reading");
-		return ERROR_FAIL;
-	}
-	in_buf = (uint8_t *)(&tmp[CMD_TAP_SHIFT_HEADER_LEN]);
+	/* The Bus Pirate echoes the header and returns TDO while it still
+	   receives TDI/TMS, so read the reply while the command goes out. */
+	ret = buspirate_serial_transfer(buspirate_fd, tmp,
+			CMD_TAP_SHIFT_HEADER_LEN + bytes_to_send*2,
+			reply, bytes_to_send + CMD_TAP_SHIFT_HEADER_LEN);
+	if (ret != ERROR_OK)
+		return ret;
+	in_buf = (uint8_t *)(&reply[CMD_TAP_SHIFT_HEADER_LEN]);
 
 	/* parse the scans */
 	for (i = 0; i < tap_pending_scans_num; i++) {
@@ -785,16 +794,36 @@ static void buspirate_tap_append(int tms, int tdi)
 static void buspirate_tap_append_scan(int length, uint8_t *buffer,
 		struct scan_command *command)
 {
-	int i;
+	int first = tap_chain_index;
+	int end = first + length;
+
 	tap_pending_scans[tap_pending_scans_num].length = length;
 	tap_pending_scans[tap_pending_scans_num].buffer = buffer;
 	tap_pending_scans[tap_pending_scans_num].command = command;
-	tap_pending_scans[tap_pending_scans_num].first = tap_chain_index;
-
-	for (i = 0; i < length; i++) {
-		int tms = (i < length-1 ? 0 : 1);
-		int tdi = (buffer[i/8] >> (i%8)) & 1;
-		buspirate_tap_append(tms, tdi);
+	tap_pending_scans[tap_pending_scans_num].first = first;
+
+	if (length > 0 && end <= BUSPIRATE_BUFFER_SIZE * 8) {
+		/* Whole bytes at once: the caller made space for the scan. TMS is
+		   zero up to the last bit, and the bits after the scan in its last
+		   byte are cleared, see buspirate_tap_append(). */
+		if (first % 8 == 0) {
+			tms_chain[first / 8] = 0;
+			tdi_chain[first / 8] = 0;
+		}
+		buf_set_buf(buffer, 0, tdi_chain, first, length);
+		if (first % 8)
+			tms_chain[first / 8] &= (1 << (first % 8)) - 1;
+		memset(&tms_chain[first / 8 + 1], 0, DIV_ROUND_UP(end, 8) - (first / 8 + 1));
+		if (end % 8)
+			tdi_chain[end / 8] &= (1 << (end % 8)) - 1;
+		tms_chain[(end - 1) / 8] |= 1 << ((end - 1) % 8);
+		tap_chain_index = end;
+	} else {
+		for (int i = 0; i < length; i++) {
+			int tms = (i < length-1 ? 0 : 1);
+			int tdi = (buffer[i/8] >> (i%8)) & 1;
+			buspirate_tap_append(tms, tdi);
+		}
 	}
 	tap_pending_scans_num++;
 }
@@ -1095,6 +1124,91 @@ static int buspirate_serial_read(int fd, char *buf, int size)
 	return len;
 }
 
+/* Write out while reading the reply to it. Returns ERROR_OK once all of
+   in_size bytes are there. */
+static int buspirate_serial_transfer(int fd, char *out, int out_size,
+		char *in, int in_size)
+{
+	int written = 0, len = 0, idle = 0;
+	int flags = fcntl(fd, F_GETFL);
+	int retval = ERROR_OK;
+
+	buspirate_print_buffer(out, out_size);
+
+	fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+	while (len < in_size) {
+		struct pollfd pfd = {
+			.fd = fd,
+			.events = POLLIN | (written < out_size ? POLLOUT : 0),
+		};
+		int ret = poll(&pfd, 1, NORMAL_TIMEOUT * 100);
+
+		if (ret < 0 && errno != EINTR) {
+			retval = ERROR_JTAG_DEVICE_ERROR;
+			break;
+		}
+		if (ret <= 0) {
+			/* same limit as buspirate_serial_read() */
+			if (++idle >= 10)
+				break;
+			continue;
+		}
+		idle = 0;
+
+		if (pfd.revents & POLLOUT) {
+			ret = write(fd, out + written, out_size - written);
+			if (ret < 0 && errno != EAGAIN && errno != EINTR) {
+				LOG_ERROR("Error sending data");
+				retval = ERROR_JTAG_DEVICE_ERROR;
+				break;
+			}
+			if (ret > 0)
+				written += ret;
+		}
+		if (pfd.revents & POLLIN) {
+			ret = read(fd, in + len, in_size - len);
+			if (ret < 0 && errno != EAGAIN && errno != EINTR) {
+				retval = ERROR_FAIL;
+				break;
+			}
+			if (ret > 0)
+				len += ret;
+		}
+		if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+			retval = ERROR_JTAG_DEVICE_ERROR;
+			break;
+		}
+	}
+	fcntl(fd, F_SETFL, flags);
+
+	LOG_DEBUG("sent %d of %d, read %d of %d", written, out_size, len, in_size);
+	buspirate_print_buffer(in, len);
+
+	if (retval == ERROR_OK && len != in_size) {
+		LOG_ERROR("Error reading data");
+		retval = ERROR_FAIL;
+	}
+	return retval;
+}
+
+/* Whether the serial port driver takes the baud rate of the fast mode,
+   checked before asking the Bus Pirate to switch. */
+static bool buspirate_serial_can_do_fast(int fd)
+{
+	struct termios t_opt;
+	bool ok;
+
+	ok = buspirate_serial_setspeed(fd, SERIAL_FAST, NORMAL_TIMEOUT) == 0
+		&& tcgetattr(fd, &t_opt) == 0
+		&& cfgetospeed(&t_opt) == B1000000;
+
+	if (-1 == buspirate_serial_setspeed(fd, SERIAL_NORMAL, NORMAL_TIMEOUT)) {
+		LOG_ERROR("Error configuring the serial port.");
+		return false;
+	}
+	return ok;
+}
+
 static void buspirate_serial_close(int fd)
 {
 	close(fd);
@@ -34,6 +34,10 @@
 
 #include <hidapi.h>
 
+#ifdef HAVE_LIBUSB1
+#include <libusb.h>
+#endif
+
 /*
  * See CMSIS-DAP documentation:
  * Version 0.01 - Beta.
@@ -58,6 +62,14 @@ static uint16_t cmsis_dap_pid[MAX_USB_IDS + 1] = { 0 };
 static wchar_t *cmsis_dap_serial;
 static bool swd_mode;
 
+enum cmsis_dap_backend {
+	CMSIS_DAP_BACKEND_AUTO,
+	CMSIS_DAP_BACKEND_HID,
+	CMSIS_DAP_BACKEND_USB_BULK,
+};
+
+static enum cmsis_dap_backend cmsis_dap_backend;
+
 #define PACKET_SIZE       (64 + 1)	/* 64 bytes plus report id */
 #define USB_TIMEOUT       1000
 
@@ -126,6 +138,9 @@ static bool swd_mode;
 #define CMD_DAP_TFER_BLOCK        0x06
 #define CMD_DAP_TFER_ABORT        0x07
 
+/* Runs of at least this many identical transfers go out as DAP_TransferBlock */
+#define TFER_BLOCK_MIN            8
+
 /* DAP Status Code */
 #define DAP_OK                    0
 #define DAP_ERROR                 0xFF
@@ -143,6 +158,14 @@ static const char * const info_caps_str[] = {
 
 struct cmsis_dap {
 	hid_device *dev_handle;
+#ifdef HAVE_LIBUSB1
+	/* CMSIS-DAP v2 bulk interface, used instead of HID when non-NULL */
+	libusb_context *usb_ctx;
+	libusb_device_handle *usb_handle;
+	int usb_interface;
+	uint8_t ep_out;
+	uint8_t ep_in;
+#endif
 	uint16_t packet_size;
 	uint16_t packet_count;
 	uint8_t *packet_buffer;
@@ -159,11 +182,78 @@ struct pending_transfer_result {
 static int pending_transfer_count, pending_queue_len;
 static struct pending_transfer_result *pending_transfers;
 
+/* One DAP_Transfer or DAP_TransferBlock packet sent but not yet answered */
+struct inflight_packet {
+	int first;
+	int count;
+	bool block;
+};
+
+static struct inflight_packet *inflight_packets;
+static uint32_t last_read;
+
+/* TDO bits of one DAP_JTAG_Sequence, to be copied into a scan buffer */
+struct pending_scan_result {
+	uint8_t *buffer;
+	unsigned offset;
+	unsigned length;
+};
+
+/* One DAP_JTAG_Sequence packet, being built or sent but not yet answered */
+struct jtag_packet {
+	int num_results;
+	struct pending_scan_result *results;
+};
+
+/* a response has room for at most this many captured sequences */
+#define JTAG_SEQ_MAX_RESULTS(pkt_sz)	MIN(0xff, (pkt_sz) - 2)
+
+static struct jtag_packet *jtag_packets;
+/* backs the results of all packets */
+static struct pending_scan_result *jtag_results;
+static int jtag_head, jtag_inflight;
+/* the request being built, with the report number */
+static uint8_t *jtag_request;
+static int jtag_request_len, jtag_request_seqs, jtag_response_len;
+
+/* Scans whose buffers get the captured bits, for jtag_read_buffer() */
+struct pending_scan {
+	struct scan_command *cmd;
+	uint8_t *buffer;
+};
+
+static struct pending_scan *pending_scans;
+static int pending_scan_count, pending_scan_len;
+
+/* first error while executing the JTAG queue, kept apart from the SWD one */
+static int jtag_retval;
+
 static int queued_retval;
 
 static struct cmsis_dap *cmsis_dap_handle;
 
-static int cmsis_dap_usb_open(void)
+static struct cmsis_dap *cmsis_dap_alloc(int packet_size)
+{
+	struct cmsis_dap *dap = calloc(1, sizeof(struct cmsis_dap));
+	if (dap == NULL) {
+		LOG_ERROR("unable to allocate memory");
+		return NULL;
+	}
+
+	dap->packet_buffer = malloc(packet_size);
+	if (dap->packet_buffer == NULL) {
+		LOG_ERROR("unable to allocate memory");
+		free(dap);
+		return NULL;
+	}
+
+	dap->packet_size = packet_size;
+	dap->packet_count = 1;
+
+	return dap;
+}
+
+static int cmsis_dap_hid_open(void)
 {
 	hid_device *dev = NULL;
 	int i;
@@ -251,18 +341,6 @@ static int cmsis_dap_usb_open(void)
 		return ERROR_FAIL;
 	}
 
-	struct cmsis_dap *dap = malloc(sizeof(struct cmsis_dap));
-	if (dap == NULL) {
-		LOG_ERROR("unable to allocate memory");
-		return ERROR_FAIL;
-	}
-
-	dap->dev_handle = dev;
-	dap->caps = 0;
-	dap->mode = 0;
-
-	cmsis_dap_handle = dap;
-
 	/* allocate default packet buffer, may be changed later.
 	 * currently with HIDAPI we have no way of getting the output report length
 	 * without this info we cannot communicate with the adapter.
@@ -276,21 +354,226 @@ static int cmsis_dap_usb_open(void)
 	if (target_vid == 0x03eb)
 		packet_size = 512 + 1;
 
-	cmsis_dap_handle->packet_buffer = malloc(packet_size);
-	cmsis_dap_handle->packet_size = packet_size;
+	struct cmsis_dap *dap = cmsis_dap_alloc(packet_size);
+	if (dap == NULL) {
+		hid_close(dev);
+		hid_exit();
+		return ERROR_FAIL;
+	}
 
-	if (cmsis_dap_handle->packet_buffer == NULL) {
-		LOG_ERROR("unable to allocate memory");
+	dap->dev_handle = dev;
+
+	cmsis_dap_handle = dap;
+
+	return ERROR_OK;
+}
+
+#ifdef HAVE_LIBUSB1
+static bool cmsis_dap_usb_ids_match(uint16_t vid, uint16_t pid)
+{
+	if (!cmsis_dap_vid[0] && !cmsis_dap_pid[0])
+		return true;
+
+	for (int i = 0; cmsis_dap_vid[i] || cmsis_dap_pid[i]; i++) {
+		if (cmsis_dap_vid[i] == vid && cmsis_dap_pid[i] == pid)
+			return true;
+	}
+
+	return false;
+}
+
+static bool cmsis_dap_usb_serial_matches(libusb_device_handle *handle, uint8_t index)
+{
+	char serial[256];
+	wchar_t wserial[256];
+
+	if (cmsis_dap_serial == NULL)
+		return true;
+
+	if (index == 0)
+		return false;
+
+	if (libusb_get_string_descriptor_ascii(handle, index,
+			(unsigned char *)serial, sizeof(serial)) < 0)
+		return false;
+
+	if (mbstowcs(wserial, serial, ARRAY_SIZE(wserial)) == (size_t)-1)
+		return false;
+	wserial[ARRAY_SIZE(wserial) - 1] = 0;
+
+	return wcscmp(wserial, cmsis_dap_serial) == 0;
+}
+
+/*
+ * A CMSIS-DAP v2 debug unit exposes a vendor specific interface whose
+ * interface string contains "CMSIS-DAP". Its first bulk OUT endpoint takes
+ * commands and its first bulk IN endpoint returns the responses; an optional
+ * second bulk IN endpoint carries SWO and is left alone here.
+ */
+static int cmsis_dap_usb_bulk_find_interface(libusb_device *dev, libusb_device_handle *handle,
+		int *interface, uint8_t *ep_out, uint8_t *ep_in, uint16_t *max_packet)
+{
+	struct libusb_config_descriptor *config;
+	int retval = ERROR_FAIL;
+
+	if (libusb_get_active_config_descriptor(dev, &config) != LIBUSB_SUCCESS)
 		return ERROR_FAIL;
+
+	for (int i = 0; i < config->bNumInterfaces && retval != ERROR_OK; i++) {
+		const struct libusb_interface_descriptor *desc = &config->interface[i].altsetting[0];
+		char name[256];
+
+		if (desc->bInterfaceClass != LIBUSB_CLASS_VENDOR_SPEC || desc->iInterface == 0)
+			continue;
+
+		if (libusb_get_string_descriptor_ascii(handle, desc->iInterface,
+				(unsigned char *)name, sizeof(name)) < 0)
+			continue;
+
+		if (!strstr(name, "CMSIS-DAP"))
+			continue;
+
+		*ep_out = 0;
+		*ep_in = 0;
+		for (int e = 0; e < desc->bNumEndpoints; e++) {
+			const struct libusb_endpoint_descriptor *ep = &desc->endpoint[e];
+
+			if ((ep->bmAttributes & LIBUSB_TRANSFER_TYPE_MASK) != LIBUSB_TRANSFER_TYPE_BULK)
+				continue;
+
+			if (ep->bEndpointAddress & LIBUSB_ENDPOINT_IN) {
+				if (!*ep_in)
+					*ep_in = ep->bEndpointAddress;
+			} else if (!*ep_out) {
+				*ep_out = ep->bEndpointAddress;
+				*max_packet = ep->wMaxPacketSize;
+			}
+		}
+
+		if (*ep_out && *ep_in) {
+			*interface = desc->bInterfaceNumber;
+			retval = ERROR_OK;
+		}
 	}
 
+	libusb_free_config_descriptor(config);
+
+	return retval;
+}
+
+static int cmsis_dap_usb_bulk_open(void)
+{
+	libusb_context *ctx;
+	libusb_device **devs;
+	libusb_device_handle *handle = NULL;
+	int interface = 0;
+	uint8_t ep_out = 0, ep_in = 0;
+	uint16_t max_packet = 0;
+
+	if (libusb_init(&ctx) != LIBUSB_SUCCESS)
+		return ERROR_FAIL;
+
+	ssize_t count = libusb_get_device_list(ctx, &devs);
+	for (ssize_t i = 0; i < count; i++) {
+		struct libusb_device_descriptor desc;
+
+		if (libusb_get_device_descriptor(devs[i], &desc) != LIBUSB_SUCCESS)
+			continue;
+
+		if (!cmsis_dap_usb_ids_match(desc.idVendor, desc.idProduct))
+			continue;
+
+		if (libusb_open(devs[i], &handle) != LIBUSB_SUCCESS) {
+			handle = NULL;
+			continue;
+		}
+
+		if (cmsis_dap_usb_serial_matches(handle, desc.iSerialNumber) &&
+		    cmsis_dap_usb_bulk_find_interface(devs[i], handle, &interface,
+				&ep_out, &ep_in, &max_packet) == ERROR_OK)
+			break;
+
+		libusb_close(handle);
+		handle = NULL;
+	}
+
+	if (count >= 0)
+		libusb_free_device_list(devs, 1);
+
+	if (handle == NULL) {
+		libusb_exit(ctx);
+		return ERROR_FAIL;
+	}
+
+	int retval = libusb_claim_interface(handle, interface);
+	if (retval != LIBUSB_SUCCESS) {
+		LOG_ERROR("unable to claim CMSIS-DAP interface %d: %s",
+			interface, libusb_error_name(retval));
+		libusb_close(handle);
+		libusb_exit(ctx);
+		return ERROR_FAIL;
+	}
+
+	/* The endpoint size is only a starting point, DAP_Info tells the
+	 * real packet size later. Keep the leading report id byte so that
+	 * the command builders are shared with the HID backend. */
+	struct cmsis_dap *dap = cmsis_dap_alloc(max_packet + 1);
+	if (dap == NULL) {
+		libusb_release_interface(handle, interface);
+		libusb_close(handle);
+		libusb_exit(ctx);
+		return ERROR_FAIL;
+	}
+
+	dap->usb_ctx = ctx;
+	dap->usb_handle = handle;
+	dap->usb_interface = interface;
+	dap->ep_out = ep_out;
+	dap->ep_in = ep_in;
+
+	cmsis_dap_handle = dap;
+
+	LOG_INFO("CMSIS-DAP: using the v2 bulk interface");
+
 	return ERROR_OK;
 }
+#endif
+
+static int cmsis_dap_usb_open(void)
+{
+#ifdef HAVE_LIBUSB1
+	if (cmsis_dap_backend != CMSIS_DAP_BACKEND_HID) {
+		if (cmsis_dap_usb_bulk_open() == ERROR_OK)
+			return ERROR_OK;
+
+		if (cmsis_dap_backend == CMSIS_DAP_BACKEND_USB_BULK) {
+			LOG_ERROR("unable to find CMSIS-DAP v2 bulk interface");
+			return ERROR_FAIL;
+		}
+	}
+#else
+	if (cmsis_dap_backend == CMSIS_DAP_BACKEND_USB_BULK) {
+		LOG_ERROR("CMSIS-DAP v2 bulk interface support requires libusb-1.0");
+		return ERROR_FAIL;
+	}
+#endif
+
+	return cmsis_dap_hid_open();
+}
 
 static void cmsis_dap_usb_close(struct cmsis_dap *dap)
 {
-	hid_close(dap->dev_handle);
-	hid_exit();
+#ifdef HAVE_LIBUSB1
+	if (dap->usb_handle) {
+		libusb_release_interface(dap->usb_handle, dap->usb_interface);
+		libusb_close(dap->usb_handle);
+		libusb_exit(dap->usb_ctx);
+	}
+#endif
+	if (dap->dev_handle) {
+		hid_close(dap->dev_handle);
+		hid_exit();
+	}
 
 	free(cmsis_dap_handle->packet_buffer);
 	free(cmsis_dap_handle);
@@ -299,13 +582,40 @@ static void cmsis_dap_usb_close(struct cmsis_dap *dap)
 	cmsis_dap_serial = NULL;
 	free(pending_transfers);
 	pending_transfers = NULL;
+	free(inflight_packets);
+	inflight_packets = NULL;
+	free(jtag_packets);
+	jtag_packets = NULL;
+	free(jtag_results);
+	jtag_results = NULL;
+	free(jtag_request);
+	jtag_request = NULL;
+	free(pending_scans);
+	pending_scans = NULL;
+	pending_scan_len = 0;
 
 	return;
 }
 
-/* Send a message and receive the reply */
-static int cmsis_dap_usb_xfer(struct cmsis_dap *dap, int txlen)
+/* Send a message; the first byte of the buffer is the HID report number */
+static int cmsis_dap_usb_write(struct cmsis_dap *dap, int txlen)
 {
+#ifdef HAVE_LIBUSB1
+	if (dap->usb_handle) {
+		int transferred = 0;
+
+		/* bulk packets carry no report number and need no padding */
+		int retval = libusb_bulk_transfer(dap->usb_handle, dap->ep_out,
+				dap->packet_buffer + 1, txlen - 1, &transferred, USB_TIMEOUT);
+		if (retval != LIBUSB_SUCCESS || transferred != txlen - 1) {
+			LOG_ERROR("error writing data: %s", libusb_error_name(retval));
+			return ERROR_FAIL;
+		}
+
+		return ERROR_OK;
+	}
+#endif
+
 	/* Pad the rest of the TX buffer with 0's */
 	memset(dap->packet_buffer + txlen, 0, dap->packet_size - txlen);
 
@@ -316,8 +626,28 @@ static int cmsis_dap_usb_xfer(struct cmsis_dap *dap, int txlen)
 		return ERROR_FAIL;
 	}
 
-	/* get reply */
-	retval = hid_read_timeout(dap->dev_handle, dap->packet_buffer, dap->packet_size, USB_TIMEOUT);
+	return ERROR_OK;
+}
+
+/* Receive the reply to the oldest outstanding message */
+static int cmsis_dap_usb_read(struct cmsis_dap *dap)
+{
+#ifdef HAVE_LIBUSB1
+	if (dap->usb_handle) {
+		int transferred = 0;
+
+		int retval = libusb_bulk_transfer(dap->usb_handle, dap->ep_in,
+				dap->packet_buffer, dap->packet_size - 1, &transferred, USB_TIMEOUT);
+		if (retval != LIBUSB_SUCCESS || transferred == 0) {
+			LOG_DEBUG("error reading data: %s", libusb_error_name(retval));
+			return ERROR_FAIL;
+		}
+
+		return ERROR_OK;
+	}
+#endif
+
+	int retval = hid_read_timeout(dap->dev_handle, dap->packet_buffer, dap->packet_size, USB_TIMEOUT);
 	if (retval == -1 || retval == 0) {
 		LOG_DEBUG("error reading data: %ls", hid_error(dap->dev_handle));
 		return ERROR_FAIL;
@@ -326,6 +656,16 @@ static int cmsis_dap_usb_xfer(struct cmsis_dap *dap, int txlen)
 	return ERROR_OK;
 }
 
+/* Send a message and receive the reply */
+static int cmsis_dap_usb_xfer(struct cmsis_dap *dap, int txlen)
+{
+	int retval = cmsis_dap_usb_write(dap, txlen);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return cmsis_dap_usb_read(dap);
+}
+
 static int cmsis_dap_cmd_DAP_SWJ_Pins(uint8_t pins, uint8_t mask, uint32_t delay, uint8_t *input)
 {
 	int retval;
@@ -494,7 +834,6 @@ static int cmsis_dap_cmd_DAP_SWD_Configure(uint8_t cfg)
 	return ERROR_OK;
 }
 
-#if 0
 static int cmsis_dap_cmd_DAP_Delay(uint16_t delay_us)
 {
 	int retval;
@@ -513,86 +852,126 @@ static int cmsis_dap_cmd_DAP_Delay(uint16_t delay_us)
 
 	return ERROR_OK;
 }
-#endif
 
-static int cmsis_dap_swd_run_queue(void)
+/* Number of transfers identical to the one at first, at most max */
+static int cmsis_dap_swd_run_length(int first, int max)
 {
-	uint8_t *buffer = cmsis_dap_handle->packet_buffer;
+	int n = 1;
 
-	LOG_DEBUG("Executing %d queued transactions", pending_transfer_count);
+	while (n < max && first + n < pending_transfer_count &&
+	       pending_transfers[first + n].cmd == pending_transfers[first].cmd)
+		n++;
 
-	if (queued_retval != ERROR_OK) {
-		LOG_DEBUG("Skipping due to previous errors: %d", queued_retval);
-		goto skip;
-	}
-
-	if (!pending_transfer_count)
-		goto skip;
+	return n;
+}
 
+/* Encode the transfers starting at first into one DAP_Transfer packet, or
+ * one DAP_TransferBlock packet for a long run of accesses to the same
+ * register (typically DRW during a memory burst). Returns the request
+ * length including the report number. */
+static int cmsis_dap_swd_build_packet(int first, struct inflight_packet *pkt)
+{
+	uint8_t *buffer = cmsis_dap_handle->packet_buffer;
+	/* DAP packet size, without the report number */
+	int pkt_sz = cmsis_dap_handle->packet_size - 1;
+	uint8_t cmd = pending_transfers[first].cmd;
 	size_t idx = 0;
+
+	pkt->first = first;
 	buffer[idx++] = 0;	/* report number */
+
+	/* 5 bytes of request header and 4 bytes of data per transfer,
+	 * the response header is one byte shorter */
+	int run = cmsis_dap_swd_run_length(first, MIN((pkt_sz - 5) / 4, 0xffff));
+	if (run >= TFER_BLOCK_MIN) {
+		buffer[idx++] = CMD_DAP_TFER_BLOCK;
+		buffer[idx++] = 0x00;	/* DAP Index */
+		h_u16_to_le(&buffer[idx], run);
+		idx += 2;
+		buffer[idx++] = (cmd >> 1) & 0x0f;
+		if (!(cmd & SWD_CMD_RnW)) {
+			for (int i = first; i < first + run; i++) {
+				h_u32_to_le(&buffer[idx], pending_transfers[i].data);
+				idx += 4;
+			}
+		}
+
+		pkt->count = run;
+		pkt->block = true;
+		return idx;
+	}
+
 	buffer[idx++] = CMD_DAP_TFER;
 	buffer[idx++] = 0x00;	/* DAP Index */
-	buffer[idx++] = pending_transfer_count;
-
-	for (int i = 0; i < pending_transfer_count; i++) {
-		uint8_t cmd = pending_transfers[i].cmd;
-		uint32_t data = pending_transfers[i].data;
-
-		LOG_DEBUG("%s %s reg %x %"PRIx32,
-				cmd & SWD_CMD_APnDP ? "AP" : "DP",
-				cmd & SWD_CMD_RnW ? "read" : "write",
-			  (cmd & SWD_CMD_A32) >> 1, data);
-
-		/* When proper WAIT handling is implemented in the
-		 * common SWD framework, this kludge can be
-		 * removed. However, this might lead to minor
-		 * performance degradation as the adapter wouldn't be
-		 * able to automatically retry anything (because ARM
-		 * has forgotten to implement sticky error flags
-		 * clearing). See also comments regarding
-		 * cmsis_dap_cmd_DAP_TFER_Configure() and
-		 * cmsis_dap_cmd_DAP_SWD_Configure() in
-		 * cmsis_dap_init().
-		 */
-		if (!(cmd & SWD_CMD_RnW) &&
-		    !(cmd & SWD_CMD_APnDP) &&
-		    (cmd & SWD_CMD_A32) >> 1 == DP_CTRL_STAT &&
-		    (data & CORUNDETECT)) {
-			LOG_DEBUG("refusing to enable sticky overrun detection");
-			data &= ~CORUNDETECT;
-		}
+	size_t count_idx = idx++;
+	int resp_len = 3;
+
+	int i;
+	for (i = first; i < pending_transfer_count && i - first < 0xff; i++) {
+		cmd = pending_transfers[i].cmd;
+		int req = cmd & SWD_CMD_RnW ? 1 : 5;
+		int resp = cmd & SWD_CMD_RnW ? 4 : 0;
+
+		if ((int)idx - 1 + req > pkt_sz || resp_len + resp > pkt_sz)
+			break;
+
+		/* leave long runs to DAP_TransferBlock */
+		if (i > first && cmsis_dap_swd_run_length(i, TFER_BLOCK_MIN) >= TFER_BLOCK_MIN)
+			break;
 
 		buffer[idx++] = (cmd >> 1) & 0x0f;
 		if (!(cmd & SWD_CMD_RnW)) {
-			buffer[idx++] = (data) & 0xff;
-			buffer[idx++] = (data >> 8) & 0xff;
-			buffer[idx++] = (data >> 16) & 0xff;
-			buffer[idx++] = (data >> 24) & 0xff;
+			h_u32_to_le(&buffer[idx], pending_transfers[i].data);
+			idx += 4;
 		}
+		resp_len += resp;
 	}
+	buffer[count_idx] = i - first;
 
-	queued_retval = cmsis_dap_usb_xfer(cmsis_dap_handle, idx);
-	if (queued_retval != ERROR_OK)
-		goto skip;
+	pkt->count = i - first;
+	pkt->block = false;
+	return idx;
+}
+
+static int cmsis_dap_swd_parse_response(const struct inflight_packet *pkt)
+{
+	uint8_t *buffer = cmsis_dap_handle->packet_buffer;
+	uint8_t expected = pkt->block ? CMD_DAP_TFER_BLOCK : CMD_DAP_TFER;
+	uint8_t ack_byte;
+	int count;
+	size_t idx;
+
+	if (buffer[0] != expected) {
+		LOG_ERROR("CMSIS-DAP: unexpected response 0x%02" PRIx8 " to command 0x%02" PRIx8,
+			  buffer[0], expected);
+		return ERROR_FAIL;
+	}
 
-	idx = 2;
-	uint8_t ack = buffer[idx] & 0x07;
-	if (ack != SWD_ACK_OK || (buffer[idx] & 0x08)) {
-		LOG_DEBUG("SWD ack not OK: %d %s", buffer[idx-1],
+	if (pkt->block) {
+		count = le_to_h_u16(&buffer[1]);
+		ack_byte = buffer[3];
+		idx = 4;
+	} else {
+		count = buffer[1];
+		ack_byte = buffer[2];
+		idx = 3;
+	}
+
+	uint8_t ack = ack_byte & 0x07;
+	if (ack != SWD_ACK_OK || (ack_byte & 0x08)) {
+		LOG_DEBUG("SWD ack not OK: %d %s", count,
 			  ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK");
-		queued_retval = ack == SWD_ACK_WAIT ? ERROR_WAIT : ERROR_FAIL;
-		goto skip;
+		return ack == SWD_ACK_WAIT ? ERROR_WAIT : ERROR_FAIL;
 	}
-	idx++;
 
-	if (pending_transfer_count != buffer[1])
+	if (pkt->count != count) {
 		LOG_ERROR("CMSIS-DAP transfer count mismatch: expected %d, got %d",
-			  pending_transfer_count, buffer[1]);
+			  pkt->count, count);
+		count = MIN(count, pkt->count);
+	}
 
-	for (int i = 0; i < buffer[1]; i++) {
+	for (int i = pkt->first; i < pkt->first + count; i++) {
 		if (pending_transfers[i].cmd & SWD_CMD_RnW) {
-			static uint32_t last_read;
 			uint32_t data = le_to_h_u32(&buffer[idx]);
 			uint32_t tmp = data;
 			idx += 4;
@@ -611,6 +990,58 @@ static int cmsis_dap_swd_run_queue(void)
 		}
 	}
 
+	return ERROR_OK;
+}
+
+/*
+ * The queue is split into as many packets as needed. Up to packet_count of
+ * them are handed to the adapter before the first response is collected,
+ * so the probe always has the next command buffered while it executes the
+ * current one. After an error no further packets are sent, but responses to
+ * those already in flight are still drained to keep the pipe in sync.
+ */
+static int cmsis_dap_swd_run_queue(void)
+{
+	int packet_count = cmsis_dap_handle->packet_count;
+	int head = 0, inflight = 0, next = 0;
+
+	LOG_DEBUG("Executing %d queued transactions", pending_transfer_count);
+
+	if (queued_retval != ERROR_OK) {
+		LOG_DEBUG("Skipping due to previous errors: %d", queued_retval);
+		goto skip;
+	}
+
+	while (inflight || (queued_retval == ERROR_OK && next < pending_transfer_count)) {
+		while (queued_retval == ERROR_OK && next < pending_transfer_count &&
+		       inflight < packet_count) {
+			struct inflight_packet *pkt = &inflight_packets[(head + inflight) % packet_count];
+
+			int len = cmsis_dap_swd_build_packet(next, pkt);
+			queued_retval = cmsis_dap_usb_write(cmsis_dap_handle, len);
+			if (queued_retval != ERROR_OK)
+				break;
+
+			next += pkt->count;
+			inflight++;
+		}
+
+		if (!inflight)
+			break;
+
+		int retval = cmsis_dap_usb_read(cmsis_dap_handle);
+		if (retval != ERROR_OK) {
+			queued_retval = retval;
+			break;
+		}
+
+		if (queued_retval == ERROR_OK)
+			queued_retval = cmsis_dap_swd_parse_response(&inflight_packets[head]);
+
+		head = (head + 1) % packet_count;
+		inflight--;
+	}
+
 skip:
 	pending_transfer_count = 0;
 	int retval = queued_retval;
@@ -629,6 +1060,30 @@ static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 	if (queued_retval != ERROR_OK)
 		return;
 
+	LOG_DEBUG("%s %s reg %x %"PRIx32,
+			cmd & SWD_CMD_APnDP ? "AP" : "DP",
+			cmd & SWD_CMD_RnW ? "read" : "write",
+		  (cmd & SWD_CMD_A32) >> 1, data);
+
+	/* When proper WAIT handling is implemented in the
+	 * common SWD framework, this kludge can be
+	 * removed. However, this might lead to minor
+	 * performance degradation as the adapter wouldn't be
+	 * able to automatically retry anything (because ARM
+	 * has forgotten to implement sticky error flags
+	 * clearing). See also comments regarding
+	 * cmsis_dap_cmd_DAP_TFER_Configure() and
+	 * cmsis_dap_cmd_DAP_SWD_Configure() in
+	 * cmsis_dap_init().
+	 */
+	if (!(cmd & SWD_CMD_RnW) &&
+	    !(cmd & SWD_CMD_APnDP) &&
+	    (cmd & SWD_CMD_A32) >> 1 == DP_CTRL_STAT &&
+	    (data & CORUNDETECT)) {
+		LOG_DEBUG("refusing to enable sticky overrun detection");
+		data &= ~CORUNDETECT;
+	}
+
 	pending_transfers[pending_transfer_count].data = data;
 	pending_transfers[pending_transfer_count].cmd = cmd;
 	if (cmd & SWD_CMD_RnW) {
@@ -835,16 +1290,6 @@ static int cmsis_dap_init(void)
 	if (data[0] == 2) {  /* short */
 		uint16_t pkt_sz = data[1] + (data[2] << 8);
 
-		/* 4 bytes of command header + 5 bytes per register
-		 * write. For bulk read sequences just 4 bytes are
-		 * needed per transfer, so this is suboptimal. */
-		pending_queue_len = (pkt_sz - 4) / 5;
-		pending_transfers = malloc(pending_queue_len * sizeof(*pending_transfers));
-		if (!pending_transfers) {
-			LOG_ERROR("Unable to allocate memory for CMSIS-DAP queue");
-			return ERROR_FAIL;
-		}
-
 		if (cmsis_dap_handle->packet_size != pkt_sz + 1) {
 			/* reallocate buffer */
 			cmsis_dap_handle->packet_size = pkt_sz + 1;
@@ -864,12 +1309,39 @@ static int cmsis_dap_init(void)
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (data[0] == 1) { /* byte */
+	if (data[0] == 1 && data[1] != 0) { /* byte */
 		uint16_t pkt_cnt = data[1];
 		cmsis_dap_handle->packet_count = pkt_cnt;
 		LOG_DEBUG("CMSIS-DAP: Packet Count = %" PRId16, pkt_cnt);
 	}
 
+	/* Size the queue so that a burst of reads, at 4 response bytes
+	 * per transfer, keeps every packet buffer of the adapter busy.
+	 * Writes need 5 bytes each and simply take a few more packets. */
+	pending_queue_len = (cmsis_dap_handle->packet_size - 1 - 4) / 4 *
+		cmsis_dap_handle->packet_count;
+	pending_transfers = malloc(pending_queue_len * sizeof(*pending_transfers));
+	inflight_packets = malloc(cmsis_dap_handle->packet_count * sizeof(*inflight_packets));
+	if (!pending_transfers || !inflight_packets) {
+		LOG_ERROR("Unable to allocate memory for CMSIS-DAP queue");
+		return ERROR_FAIL;
+	}
+
+	if (!swd_mode) {
+		int packet_count = cmsis_dap_handle->packet_count;
+		int max_results = JTAG_SEQ_MAX_RESULTS(cmsis_dap_handle->packet_size - 1);
+
+		jtag_request = malloc(cmsis_dap_handle->packet_size);
+		jtag_packets = calloc(packet_count, sizeof(*jtag_packets));
+		jtag_results = malloc(packet_count * max_results * sizeof(*jtag_results));
+		if (!jtag_request || !jtag_packets || !jtag_results) {
+			LOG_ERROR("Unable to allocate memory for CMSIS-DAP JTAG queue");
+			return ERROR_FAIL;
+		}
+		for (int i = 0; i < packet_count; i++)
+			jtag_packets[i].results = jtag_results + i * max_results;
+	}
+
 	retval = cmsis_dap_get_status();
 	if (retval != ERROR_OK)
 		return ERROR_FAIL;
@@ -931,21 +1403,307 @@ static int cmsis_dap_quit(void)
 	return ERROR_OK;
 }
 
+/*
+ * JTAG goes out as DAP_JTAG_Sequence packets.  Sequences of up to 64 TCK
+ * cycles with a constant TMS are packed until the request or its response
+ * fills a packet; up to packet_count packets are sent before the oldest
+ * response is collected, as for SWD transfers.  Captured TDO bits are
+ * copied straight into the scan buffers.
+ */
+
+/* Collect the response to the oldest packet in flight */
+static int cmsis_dap_jtag_read_response(void)
+{
+	uint8_t *buffer = cmsis_dap_handle->packet_buffer;
+	struct jtag_packet *pkt = &jtag_packets[jtag_head];
+
+	jtag_head = (jtag_head + 1) % cmsis_dap_handle->packet_count;
+	jtag_inflight--;
+
+	int retval = cmsis_dap_usb_read(cmsis_dap_handle);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (buffer[0] != CMD_DAP_JTAG_SEQ || buffer[1] != DAP_OK) {
+		LOG_ERROR("CMSIS-DAP command CMD_DAP_JTAG_SEQ failed.");
+		return ERROR_JTAG_DEVICE_ERROR;
+	}
+
+	size_t idx = 2;
+	for (int i = 0; i < pkt->num_results; i++) {
+		struct pending_scan_result *r = &pkt->results[i];
+
+		bit_copy(r->buffer, r->offset, &buffer[idx], 0, r->length);
+		idx += DIV_ROUND_UP(r->length, 8);
+	}
+
+	return ERROR_OK;
+}
+
+/* Send the request being built, if any */
+static void cmsis_dap_jtag_send(void)
+{
+	if (jtag_request_seqs == 0)
+		return;
+
+	jtag_request[2] = jtag_request_seqs;
+	jtag_request_seqs = 0;
+
+	if (jtag_retval != ERROR_OK)
+		return;
+
+	memcpy(cmsis_dap_handle->packet_buffer, jtag_request, jtag_request_len);
+	jtag_retval = cmsis_dap_usb_write(cmsis_dap_handle, jtag_request_len);
+	if (jtag_retval == ERROR_OK)
+		jtag_inflight++;
+}
+
+/* Send everything queued and collect all responses */
+static int cmsis_dap_jtag_flush(void)
+{
+	cmsis_dap_jtag_send();
+
+	while (jtag_inflight) {
+		int retval = cmsis_dap_jtag_read_response();
+		if (jtag_retval == ERROR_OK)
+			jtag_retval = retval;
+	}
+
+	int retval = jtag_retval;
+	jtag_retval = ERROR_OK;
+	return retval;
+}
+
+/* Queue one sequence of 1 to 64 TCK cycles with a constant TMS.  TDI is
+ * taken from tdi at tdi_offset, or low when tdi is NULL; TDO is captured
+ * into tdo at tdo_offset unless tdo is NULL. */
+static void cmsis_dap_jtag_add_seq(unsigned bits, bool tms,
+	const uint8_t *tdi, unsigned tdi_offset, uint8_t *tdo, unsigned tdo_offset)
+{
+	int pkt_sz = cmsis_dap_handle->packet_size - 1;
+	int bytes = DIV_ROUND_UP(bits, 8);
+	int resp = tdo ? bytes : 0;
+
+	assert(bits > 0 && bits <= 64);
+
+	if (jtag_request_seqs > 0 &&
+	    (jtag_request_len - 1 + 1 + bytes > pkt_sz ||
+	     jtag_response_len + resp > pkt_sz ||
+	     jtag_request_seqs == 0xff))
+		cmsis_dap_jtag_send();
+
+	if (jtag_request_seqs == 0) {
+		/* the slot of this packet must not still be in flight */
+		if (jtag_inflight == cmsis_dap_handle->packet_count) {
+			int retval = cmsis_dap_jtag_read_response();
+			if (jtag_retval == ERROR_OK)
+				jtag_retval = retval;
+		}
+
+		jtag_request[0] = 0;	/* report number */
+		jtag_request[1] = CMD_DAP_JTAG_SEQ;
+		jtag_request_len = 3;	/* sequence count follows */
+		jtag_response_len = 2;
+		jtag_packets[(jtag_head + jtag_inflight) %
+			cmsis_dap_handle->packet_count].num_results = 0;
+	}
+
+	/* TCK cycles (0 means 64), TMS value, TDO capture */
+	jtag_request[jtag_request_len++] = (bits & 0x3f) | (tms ? 0x40 : 0) |
+		(tdo ? 0x80 : 0);
+
+	memset(&jtag_request[jtag_request_len], 0, bytes);
+	if (tdi)
+		bit_copy(&jtag_request[jtag_request_len], 0, tdi, tdi_offset, bits);
+	jtag_request_len += bytes;
+
+	if (tdo) {
+		struct jtag_packet *pkt = &jtag_packets[(jtag_head + jtag_inflight) %
+			cmsis_dap_handle->packet_count];
+		struct pending_scan_result *r = &pkt->results[pkt->num_results++];
+
+		r->buffer = tdo;
+		r->offset = tdo_offset;
+		r->length = bits;
+		jtag_response_len += resp;
+	}
+
+	jtag_request_seqs++;
+}
+
+/* Queue any number of TCK cycles with a constant TMS */
+static void cmsis_dap_jtag_clock(unsigned cycles, bool tms,
+	const uint8_t *tdi, unsigned tdi_offset, uint8_t *tdo, unsigned tdo_offset)
+{
+	unsigned done = 0;
+
+	while (done < cycles) {
+		unsigned n = MIN(cycles - done, 64u);
+
+		cmsis_dap_jtag_add_seq(n, tms, tdi, tdi_offset + done,
+				tdo, tdo_offset + done);
+		done += n;
+	}
+}
+
+/* Queue TMS bits, one sequence for each run of equal bits */
+static void cmsis_dap_jtag_add_tms(const uint8_t *bits, unsigned len)
+{
+	unsigned first = 0;
+
+	while (first < len) {
+		bool tms = (bits[first / 8] >> (first % 8)) & 1;
+		unsigned n = 1;
+
+		while (first + n < len &&
+		       ((bits[(first + n) / 8] >> ((first + n) % 8)) & 1) == tms)
+			n++;
+
+		cmsis_dap_jtag_clock(n, tms, NULL, 0, NULL, 0);
+		first += n;
+	}
+}
+
+static void cmsis_dap_jtag_state_move(tap_state_t state)
+{
+	uint8_t tms = tap_get_tms_path(tap_get_state(), state);
+	int len = tap_get_tms_path_len(tap_get_state(), state);
+
+	cmsis_dap_jtag_add_tms(&tms, len);
+	tap_set_state(state);
+}
+
+static void cmsis_dap_execute_statemove(struct jtag_command *cmd)
+{
+	tap_state_t end_state = cmd->cmd.statemove->end_state;
+
+	if (tap_get_state() != end_state || end_state == TAP_RESET)
+		cmsis_dap_jtag_state_move(end_state);
+}
+
+static void cmsis_dap_execute_pathmove(struct jtag_command *cmd)
+{
+	struct pathmove_command *pathmove = cmd->cmd.pathmove;
+
+	for (int i = 0; i < pathmove->num_states; i++) {
+		tap_state_t next = pathmove->path[i];
+		bool tms;
+
+		if (tap_state_transition(tap_get_state(), false) == next)
+			tms = false;
+		else if (tap_state_transition(tap_get_state(), true) == next)
+			tms = true;
+		else {
+			LOG_ERROR("BUG: %s -> %s isn't a valid TAP transition",
+				tap_state_name(tap_get_state()), tap_state_name(next));
+			exit(-1);
+		}
+
+		cmsis_dap_jtag_clock(1, tms, NULL, 0, NULL, 0);
+		tap_set_state(next);
+	}
+}
+
+static void cmsis_dap_execute_runtest(struct jtag_command *cmd)
+{
+	if (tap_get_state() != TAP_IDLE)
+		cmsis_dap_jtag_state_move(TAP_IDLE);
+
+	cmsis_dap_jtag_clock(cmd->cmd.runtest->num_cycles, false, NULL, 0, NULL, 0);
+
+	if (cmd->cmd.runtest->end_state != TAP_IDLE)
+		cmsis_dap_jtag_state_move(cmd->cmd.runtest->end_state);
+}
+
+static void cmsis_dap_execute_stableclocks(struct jtag_command *cmd)
+{
+	/* TMS must stay high in Test-Logic-Reset, low in the other stable states */
+	cmsis_dap_jtag_clock(cmd->cmd.stableclocks->num_cycles,
+			tap_get_state() == TAP_RESET, NULL, 0, NULL, 0);
+}
+
+static void cmsis_dap_execute_tms(struct jtag_command *cmd)
+{
+	cmsis_dap_jtag_add_tms(cmd->cmd.tms->bits, cmd->cmd.tms->num_bits);
+}
+
+static void cmsis_dap_execute_scan(struct jtag_command *cmd)
+{
+	struct scan_command *scan = cmd->cmd.scan;
+	tap_state_t shift = scan->ir_scan ? TAP_IRSHIFT : TAP_DRSHIFT;
+	uint8_t *buffer;
+
+	int bits = jtag_build_buffer(scan, &buffer);
+	uint8_t *tdo = (jtag_scan_type(scan) & SCAN_IN) ? buffer : NULL;
+
+	if (pending_scan_count == pending_scan_len) {
+		int len = pending_scan_len ? 2 * pending_scan_len : 16;
+		struct pending_scan *p = realloc(pending_scans, len * sizeof(*p));
+		if (p == NULL) {
+			LOG_ERROR("Unable to allocate memory for CMSIS-DAP scans");
+			free(buffer);
+			jtag_retval = ERROR_FAIL;
+			return;
+		}
+		pending_scans = p;
+		pending_scan_len = len;
+	}
+	pending_scans[pending_scan_count].cmd = scan;
+	pending_scans[pending_scan_count].buffer = buffer;
+	pending_scan_count++;
+
+	if (tap_get_state() != shift)
+		cmsis_dap_jtag_state_move(shift);
+
+	/* the last bit leaves the shift state */
+	if (bits > 1)
+		cmsis_dap_jtag_clock(bits - 1, false, buffer, 0, tdo, 0);
+	cmsis_dap_jtag_clock(1, true, buffer, bits - 1, tdo, bits - 1);
+
+	/* then one more clock from Exit1 to Pause */
+	cmsis_dap_jtag_clock(1, false, NULL, 0, NULL, 0);
+	tap_set_state(scan->ir_scan ? TAP_IRPAUSE : TAP_DRPAUSE);
+
+	if (tap_get_state() != scan->end_state)
+		cmsis_dap_jtag_state_move(scan->end_state);
+}
+
 static void cmsis_dap_execute_reset(struct jtag_command *cmd)
 {
-	int retval = cmsis_dap_cmd_DAP_SWJ_Pins(cmd->cmd.reset->srst ? 0 : (1 << 7), \
-			(1 << 7), 0, NULL);
+	uint8_t pins = 0, mask = 0;
+
+	/* pins are driven right away, after what was queued before */
+	jtag_retval = cmsis_dap_jtag_flush();
+
+	if (cmd->cmd.reset->srst != -1) {
+		mask |= (1 << 7);
+		if (!cmd->cmd.reset->srst)
+			pins |= (1 << 7);
+	}
+	if (!swd_mode && cmd->cmd.reset->trst != -1) {
+		mask |= (1 << 5);
+		if (!cmd->cmd.reset->trst)
+			pins |= (1 << 5);
+		else
+			tap_set_state(TAP_RESET);
+	}
+
+	int retval = cmsis_dap_cmd_DAP_SWJ_Pins(pins, mask, 0, NULL);
 	if (retval != ERROR_OK)
 		LOG_ERROR("CMSIS-DAP: Interface reset failed");
 }
 
 static void cmsis_dap_execute_sleep(struct jtag_command *cmd)
 {
-#if 0
-	int retval = cmsis_dap_cmd_DAP_Delay(cmd->cmd.sleep->us);
-	if (retval != ERROR_OK)
-#endif
-		jtag_sleep(cmd->cmd.sleep->us);
+	jtag_retval = cmsis_dap_jtag_flush();
+
+	/* the probe times the delay itself, which is more exact than the
+	 * host timer; DAP_Delay takes at most 65535 us */
+	if (cmd->cmd.sleep->us <= 0xffff &&
+			cmsis_dap_cmd_DAP_Delay(cmd->cmd.sleep->us) == ERROR_OK)
+		return;
+
+	jtag_sleep(cmd->cmd.sleep->us);
 }
 
 static void cmsis_dap_execute_command(struct jtag_command *cmd)
@@ -957,6 +1715,24 @@ static void cmsis_dap_execute_command(struct jtag_command *cmd)
 		case JTAG_SLEEP:
 			cmsis_dap_execute_sleep(cmd);
 			break;
+		case JTAG_TLR_RESET:
+			cmsis_dap_execute_statemove(cmd);
+			break;
+		case JTAG_PATHMOVE:
+			cmsis_dap_execute_pathmove(cmd);
+			break;
+		case JTAG_RUNTEST:
+			cmsis_dap_execute_runtest(cmd);
+			break;
+		case JTAG_STABLECLOCKS:
+			cmsis_dap_execute_stableclocks(cmd);
+			break;
+		case JTAG_TMS:
+			cmsis_dap_execute_tms(cmd);
+			break;
+		case JTAG_SCAN:
+			cmsis_dap_execute_scan(cmd);
+			break;
 		default:
 			LOG_ERROR("BUG: unknown JTAG command type encountered");
 			exit(-1);
@@ -972,7 +1748,18 @@ static int cmsis_dap_execute_queue(void)
 		cmd = cmd->next;
 	}
 
-	return ERROR_OK;
+	int retval = cmsis_dap_jtag_flush();
+
+	/* the scan buffers hold the captured bits now */
+	for (int i = 0; i < pending_scan_count; i++) {
+		if (retval == ERROR_OK)
+			retval = jtag_read_buffer(pending_scans[i].buffer,
+					pending_scans[i].cmd);
+		free(pending_scans[i].buffer);
+	}
+	pending_scan_count = 0;
+
+	return retval;
 }
 
 static int cmsis_dap_speed(int speed)
@@ -1069,6 +1856,23 @@ COMMAND_HANDLER(cmsis_dap_handle_serial_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(cmsis_dap_handle_backend_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (strcmp(CMD_ARGV[0], "auto") == 0)
+		cmsis_dap_backend = CMSIS_DAP_BACKEND_AUTO;
+	else if (strcmp(CMD_ARGV[0], "hid") == 0)
+		cmsis_dap_backend = CMSIS_DAP_BACKEND_HID;
+	else if (strcmp(CMD_ARGV[0], "usb_bulk") == 0)
+		cmsis_dap_backend = CMSIS_DAP_BACKEND_USB_BULK;
+	else
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return ERROR_OK;
+}
+
 static const struct command_registration cmsis_dap_subcommand_handlers[] = {
 	{
 		.name = "info",
@@ -1102,6 +1906,13 @@ static const struct command_registration cmsis_dap_command_handlers[] = {
 		.help = "set the serial number of the adapter",
 		.usage = "serial_string",
 	},
+	{
+		.name = "cmsis_dap_backend",
+		.handler = &cmsis_dap_handle_backend_command,
+		.mode = COMMAND_CONFIG,
+		.help = "select the USB interface used to talk to the adapter",
+		.usage = "(auto | hid | usb_bulk)",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -1114,7 +1925,7 @@ static const struct swd_driver cmsis_dap_swd_driver = {
 	.run = cmsis_dap_swd_run_queue,
 };
 
-static const char * const cmsis_dap_transport[] = { "swd", NULL };
+static const char * const cmsis_dap_transport[] = { "swd", "jtag", NULL };
 
 struct jtag_interface cmsis_dap_interface = {
 	.name = "cmsis-dap",
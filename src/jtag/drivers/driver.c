@@ -35,6 +35,7 @@
 #include <jtag/commands.h>
 #include <jtag/minidriver.h>
 #include <helper/command.h>
+#include <helper/perf.h>
 
 struct jtag_callback_entry {
 	struct jtag_callback_entry *next;
@@ -67,6 +68,67 @@ static void cmd_queue_scan_field_clone(struct scan_field *dst, const struct scan
 	dst->in_value	= src->in_value;
 }
 
+/**
+ * The enabled TAPs in chain order, along with the IR scan fields putting
+ * each of them in BYPASS.  Scans copy these instead of walking the list
+ * of all TAPs; they are rebuilt when jtag_tap_chain_generation() changes.
+ */
+static struct jtag_tap **jtag_chain_taps;
+static struct scan_field *jtag_chain_ir_bypass;
+static size_t jtag_chain_num_taps;
+static size_t jtag_chain_size;
+static unsigned jtag_chain_generation;
+static bool jtag_chain_valid;
+
+/* out_value of the IR fields of bypassed TAPs, queued fields never write it */
+static const uint8_t jtag_bypass_ir[8] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+static int jtag_chain_update(void)
+{
+	unsigned generation = jtag_tap_chain_generation();
+
+	if (jtag_chain_valid && jtag_chain_generation == generation)
+		return ERROR_OK;
+
+	size_t num_taps = jtag_tap_count_enabled();
+	if (num_taps > jtag_chain_size) {
+		struct jtag_tap **taps = realloc(jtag_chain_taps, num_taps * sizeof(*taps));
+		if (taps == NULL)
+			return ERROR_FAIL;
+		jtag_chain_taps = taps;
+
+		struct scan_field *fields = realloc(jtag_chain_ir_bypass,
+				num_taps * sizeof(*fields));
+		if (fields == NULL)
+			return ERROR_FAIL;
+		jtag_chain_ir_bypass = fields;
+
+		jtag_chain_size = num_taps;
+	}
+
+	size_t i = 0;
+	for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap != NULL; tap = jtag_tap_next_enabled(tap)) {
+		struct scan_field *field = &jtag_chain_ir_bypass[i];
+
+		memset(field, 0, sizeof(*field));
+		field->num_bits = tap->ir_length;
+		/* longer IRs get their own buffer, see interface_jtag_add_ir_scan() */
+		if (tap->ir_length <= 8 * (int)sizeof(jtag_bypass_ir))
+			field->out_value = jtag_bypass_ir;
+
+		jtag_chain_taps[i++] = tap;
+	}
+	assert(i == num_taps);
+
+	jtag_chain_num_taps = num_taps;
+	jtag_chain_generation = generation;
+	jtag_chain_valid = true;
+
+	return ERROR_OK;
+}
+
 /**
  * see jtag_add_ir_scan()
  *
@@ -74,7 +136,12 @@ static void cmd_queue_scan_field_clone(struct scan_field *dst, const struct scan
 int interface_jtag_add_ir_scan(struct jtag_tap *active,
 		const struct scan_field *in_fields, tap_state_t state)
 {
-	size_t num_taps = jtag_tap_count_enabled();
+	if (jtag_chain_update() != ERROR_OK) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	size_t num_taps = jtag_chain_num_taps;
 
 	struct jtag_command *cmd = cmd_queue_alloc(sizeof(struct jtag_command));
 	struct scan_command *scan = cmd_queue_alloc(sizeof(struct scan_command));
@@ -90,12 +157,12 @@ int interface_jtag_add_ir_scan(struct jtag_tap *active,
 	scan->fields = out_fields;
 	scan->end_state = state;
 
-	struct scan_field *field = out_fields;	/* keep track where we insert data */
-
-	/* loop over all enabled TAPs */
+	/* start with all TAPs in BYPASS, not collecting input */
+	memcpy(out_fields, jtag_chain_ir_bypass, num_taps * sizeof(struct scan_field));
 
-	for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap != NULL; tap = jtag_tap_next_enabled(tap)) {
-		/* search the input field list for fields for the current TAP */
+	for (size_t i = 0; i < num_taps; i++) {
+		struct jtag_tap *tap = jtag_chain_taps[i];
+		struct scan_field *field = &out_fields[i];
 
 		if (tap == active) {
 			/* if TAP is listed in input fields, copy the value */
@@ -103,22 +170,15 @@ int interface_jtag_add_ir_scan(struct jtag_tap *active,
 
 			cmd_queue_scan_field_clone(field, in_fields);
 		} else {
-			/* if a TAP isn't listed in input fields, set it to BYPASS */
-
 			tap->bypass = 1;
 
-			field->num_bits = tap->ir_length;
-			field->out_value = buf_set_ones(cmd_queue_alloc(DIV_ROUND_UP(tap->ir_length, 8)), tap->ir_length);
-			field->in_value = NULL; /* do not collect input for tap's in bypass */
+			if (field->out_value == NULL)
+				field->out_value = buf_set_ones(cmd_queue_alloc(DIV_ROUND_UP(tap->ir_length, 8)), tap->ir_length);
 		}
 
 		/* update device information */
 		buf_cpy(field->out_value, tap->cur_instr, tap->ir_length);
-
-		field++;
 	}
-	/* paranoia: jtag_tap_count_enabled() and jtag_tap_next_enabled() not in sync */
-	assert(field == out_fields + num_taps);
 
 	return ERROR_OK;
 }
@@ -130,12 +190,17 @@ int interface_jtag_add_ir_scan(struct jtag_tap *active,
 int interface_jtag_add_dr_scan(struct jtag_tap *active, int in_num_fields,
 		const struct scan_field *in_fields, tap_state_t state)
 {
+	if (jtag_chain_update() != ERROR_OK) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
 	/* count devices in bypass */
 
 	size_t bypass_devices = 0;
 
-	for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap != NULL; tap = jtag_tap_next_enabled(tap)) {
-		if (tap->bypass)
+	for (size_t i = 0; i < jtag_chain_num_taps; i++) {
+		if (jtag_chain_taps[i]->bypass)
 			bypass_devices++;
 	}
 
@@ -157,7 +222,9 @@ int interface_jtag_add_dr_scan(struct jtag_tap *active, int in_num_fields,
 
 	/* loop over all enabled TAPs */
 
-	for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap != NULL; tap = jtag_tap_next_enabled(tap)) {
+	for (size_t i = 0; i < jtag_chain_num_taps; i++) {
+		struct jtag_tap *tap = jtag_chain_taps[i];
+
 		/* if TAP is not bypassed insert matching input fields */
 
 		if (!tap->bypass) {
@@ -378,7 +445,37 @@ int interface_jtag_execute_queue(void)
 	assert(reentry == 0);
 	reentry++;
 
+	jtag_command_queue_optimize();
+
+	unsigned commands = 0, bits = 0;
+	for (struct jtag_command *cmd = jtag_command_queue; cmd; cmd = cmd->next) {
+		commands++;
+		switch (cmd->type) {
+		case JTAG_SCAN:
+			bits += jtag_scan_size(cmd->cmd.scan);
+			break;
+		case JTAG_RUNTEST:
+			bits += cmd->cmd.runtest->num_cycles;
+			break;
+		case JTAG_STABLECLOCKS:
+			bits += cmd->cmd.stableclocks->num_cycles;
+			break;
+		case JTAG_TMS:
+			bits += cmd->cmd.tms->num_bits;
+			break;
+		case JTAG_PATHMOVE:
+			bits += cmd->cmd.pathmove->num_states;
+			break;
+		default:
+			break;
+		}
+	}
+	perf_add(PERF_JTAG_COMMANDS, commands);
+	perf_add(PERF_JTAG_BITS, bits);
+
+	int64_t trace_begin = jtag_trace_begin();
 	int retval = default_interface_jtag_execute_queue();
+	jtag_trace_record(JTAG_TRACE_JTAG, trace_begin, commands, bits, retval);
 	if (retval == ERROR_OK) {
 		struct jtag_callback_entry *entry;
 		for (entry = jtag_callback_queue_head; entry != NULL; entry = entry->next) {
@@ -117,8 +117,12 @@ static struct signal *signals;
 static struct swd_cmd_queue_entry {
 	uint8_t cmd;
 	uint32_t *dst;
+	uint32_t data;
+	/* raw MPSSE response, see ftdi_swd_queue_cmd() for the layout */
 	uint8_t trn_ack_data_parity_trn[DIV_ROUND_UP(4 + 3 + 32 + 1 + 4, 8)];
 } *swd_cmd_queue;
+static struct signal *swd_oe_signal;
+static struct signal *swd_led_signal;
 static size_t swd_cmd_queue_length;
 static size_t swd_cmd_queue_alloced;
 static int queued_retval;
@@ -158,7 +162,8 @@ static struct signal *create_signal(const char *name)
 	return *psig;
 }
 
-static int ftdi_set_signal(const struct signal *s, char value)
+/* Updates the pin state in output/direction for signal s at value */
+static int ftdi_update_signal(const struct signal *s, char value)
 {
 	bool data;
 	bool oe;
@@ -194,15 +199,24 @@ static int ftdi_set_signal(const struct signal *s, char value)
 		return ERROR_FAIL;
 	}
 
-	uint16_t old_output = output;
-	uint16_t old_direction = direction;
-
 	output = data ? output | s->data_mask : output & ~s->data_mask;
 	if (s->oe_mask == s->data_mask)
 		direction = oe ? direction | s->oe_mask : direction & ~s->oe_mask;
 	else
 		output = oe ? output | s->oe_mask : output & ~s->oe_mask;
 
+	return ERROR_OK;
+}
+
+static int ftdi_set_signal(const struct signal *s, char value)
+{
+	uint16_t old_output = output;
+	uint16_t old_direction = direction;
+
+	int retval = ftdi_update_signal(s, value);
+	if (retval != ERROR_OK)
+		return retval;
+
 	if ((output & 0xff) != (old_output & 0xff) || (direction & 0xff) != (old_direction & 0xff))
 		mpsse_set_data_bits_low_byte(mpsse_ctx, output & 0xff, direction & 0xff);
 	if ((output >> 8 != old_output >> 8) || (direction >> 8 != old_direction >> 8))
@@ -211,6 +225,31 @@ static int ftdi_set_signal(const struct signal *s, char value)
 	return ERROR_OK;
 }
 
+/* Like ftdi_set_signal(), but stores the MPSSE commands in buf rather
+ * than queueing them; returns their size. */
+static unsigned ftdi_encode_signal(const struct signal *s, char value, uint8_t *buf)
+{
+	uint16_t old_output = output;
+	uint16_t old_direction = direction;
+	unsigned n = 0;
+
+	if (ftdi_update_signal(s, value) != ERROR_OK)
+		return 0;
+
+	if ((output & 0xff) != (old_output & 0xff) || (direction & 0xff) != (old_direction & 0xff)) {
+		buf[n++] = 0x80;
+		buf[n++] = output & 0xff;
+		buf[n++] = direction & 0xff;
+	}
+	if ((output >> 8 != old_output >> 8) || (direction >> 8 != old_direction >> 8)) {
+		buf[n++] = 0x82;
+		buf[n++] = output >> 8;
+		buf[n++] = direction >> 8;
+	}
+
+	return n;
+}
+
 
 /**
  * Function move_to_state
@@ -257,6 +296,7 @@ static int ftdi_speed(int speed)
 		LOG_ERROR("couldn't set FTDI TCK speed");
 		return retval;
 	}
+	freq = retval;
 
 	if (!swd_mode && speed >= 10000000 && ftdi_jtag_mode != JTAG_MODE_ALT)
 		LOG_INFO("ftdi: if you experience problems at higher adapter clocks, try "
@@ -444,32 +484,12 @@ static void ftdi_execute_scan(struct jtag_command *cmd)
 		if (i == cmd->cmd.scan->num_fields - 1 && tap_get_state() != tap_get_end_state()) {
 			/* Last field, and we're leaving IRSHIFT/DRSHIFT. Clock last bit during tap
 			 * movement. This last field can't have length zero, it was checked above. */
-			mpsse_clock_data(mpsse_ctx,
+			mpsse_clock_data_exit(mpsse_ctx,
 				field->out_value,
-				0,
 				field->in_value,
-				0,
-				field->num_bits - 1,
+				field->num_bits,
 				ftdi_jtag_mode);
-			uint8_t last_bit = 0;
-			if (field->out_value)
-				bit_copy(&last_bit, 0, field->out_value, field->num_bits - 1, 1);
-			uint8_t tms_bits = 0x01;
-			mpsse_clock_tms_cs(mpsse_ctx,
-					&tms_bits,
-					0,
-					field->in_value,
-					field->num_bits - 1,
-					1,
-					last_bit,
-					ftdi_jtag_mode);
 			tap_set_state(tap_state_transition(tap_get_state(), 1));
-			mpsse_clock_tms_cs_out(mpsse_ctx,
-					&tms_bits,
-					1,
-					1,
-					last_bit,
-					ftdi_jtag_mode);
 			tap_set_state(tap_state_transition(tap_get_state(), 0));
 		} else
 			mpsse_clock_data(mpsse_ctx,
@@ -533,10 +553,21 @@ static void ftdi_execute_reset(struct jtag_command *cmd)
 
 static void ftdi_execute_sleep(struct jtag_command *cmd)
 {
-	DEBUG_JTAG_IO("sleep %" PRIi32, cmd->cmd.sleep->us);
+	uint32_t us = cmd->cmd.sleep->us;
+
+	DEBUG_JTAG_IO("sleep %" PRIi32, us);
+
+	/* short delays are TCK cycles in a stable state, at the actual
+	 * frequency; SWD and adaptive clocking need the host to wait */
+	if (!swd_mode && freq > 0 && us < ADAPTER_QUEUED_SLEEP_MAX_US &&
+			tap_is_state_stable(tap_get_state())) {
+		uint64_t cycles = ((uint64_t)us * freq + 999999) / 1000000;
+		if (mpsse_clock_idle(mpsse_ctx, cycles) == ERROR_OK)
+			return;
+	}
 
 	mpsse_flush(mpsse_ctx);
-	jtag_sleep(cmd->cmd.sleep->us);
+	jtag_sleep(us);
 	DEBUG_JTAG_IO("sleep %" PRIi32 " usec while in %s",
 		cmd->cmd.sleep->us,
 		tap_state_name(tap_get_state()));
@@ -983,17 +1014,21 @@ static int ftdi_swd_init(void)
 	if (create_signals() != ERROR_OK)
 		return ERROR_FAIL;
 
+	/* layout signals are all defined by now */
+	swd_oe_signal = find_signal_by_name("SWDIO_OE");
+	swd_led_signal = find_signal_by_name("LED");
+
 	swd_cmd_queue_alloced = 10;
 	swd_cmd_queue = malloc(swd_cmd_queue_alloced * sizeof(*swd_cmd_queue));
 
 	return swd_cmd_queue != NULL ? ERROR_OK : ERROR_FAIL;
 }
 
-static void ftdi_swd_swdio_en(bool enable)
+static unsigned ftdi_swd_encode_swdio_en(bool enable, uint8_t *buf)
 {
-	struct signal *oe = find_signal_by_name("SWDIO_OE");
-	if (oe)
-		ftdi_set_signal(oe, enable ? '1' : '0');
+	if (swd_oe_signal)
+		return ftdi_encode_signal(swd_oe_signal, enable ? '1' : '0', buf);
+	return 0;
 }
 
 /**
@@ -1005,7 +1040,7 @@ static int ftdi_swd_run_queue(void)
 {
 	LOG_DEBUG("Executing %zu queued transactions", swd_cmd_queue_length);
 	int retval;
-	struct signal *led = find_signal_by_name("LED");
+	struct signal *led = swd_led_signal;
 
 	if (queued_retval != ERROR_OK) {
 		LOG_DEBUG("Skipping due to previous errors: %d", queued_retval);
@@ -1027,26 +1062,38 @@ static int ftdi_swd_run_queue(void)
 	}
 
 	for (size_t i = 0; i < swd_cmd_queue_length; i++) {
-		int ack = buf_get_u32(swd_cmd_queue[i].trn_ack_data_parity_trn, 1, 3);
+		const uint8_t *r = swd_cmd_queue[i].trn_ack_data_parity_trn;
+		bool read = swd_cmd_queue[i].cmd & SWD_CMD_RnW;
+		uint64_t bits;
+
+		/* Undo the fixed response layout in one go: a write has
+		 * trn+ack in the top five bits of r[0], a read has the first
+		 * 32 bits in r[0..3] and the remaining six at the top of r[4] */
+		if (read)
+			bits = (uint64_t)le_to_h_u32(r) | (uint64_t)(r[4] >> 2) << 32;
+		else
+			bits = r[0] >> 3;
+
+		int ack = (bits >> 1) & 0x7;
+		uint32_t data = read ? (uint32_t)(bits >> 4) : swd_cmd_queue[i].data;
 
 		LOG_DEBUG("%s %s %s reg %X = %08"PRIx32,
 				ack == SWD_ACK_OK ? "OK" : ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK",
 				swd_cmd_queue[i].cmd & SWD_CMD_APnDP ? "AP" : "DP",
-				swd_cmd_queue[i].cmd & SWD_CMD_RnW ? "read" : "write",
+				read ? "read" : "write",
 				(swd_cmd_queue[i].cmd & SWD_CMD_A32) >> 1,
-				buf_get_u32(swd_cmd_queue[i].trn_ack_data_parity_trn,
-						1 + 3 + (swd_cmd_queue[i].cmd & SWD_CMD_RnW ? 0 : 1), 32));
+				data);
 
-		if (ack != SWD_ACK_OK) {
+		if (ack != SWD_ACK_OK && swd_cmd_returns_ack(swd_cmd_queue[i].cmd)) {
 			queued_retval = ack == SWD_ACK_WAIT ? ERROR_WAIT : ERROR_FAIL;
 			goto skip;
 
-		} else if (swd_cmd_queue[i].cmd & SWD_CMD_RnW) {
-			uint32_t data = buf_get_u32(swd_cmd_queue[i].trn_ack_data_parity_trn, 1 + 3, 32);
-			int parity = buf_get_u32(swd_cmd_queue[i].trn_ack_data_parity_trn, 1 + 3 + 32, 1);
+		} else if (read) {
+			int parity = (bits >> 36) & 1;
 
 			if (parity != parity_u32(data)) {
 				LOG_ERROR("SWD Read data parity mismatch");
+				adapter_report_link_error();
 				queued_retval = ERROR_FAIL;
 				goto skip;
 			}
@@ -1088,31 +1135,48 @@ static void ftdi_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint32
 
 	size_t i = swd_cmd_queue_length++;
 	swd_cmd_queue[i].cmd = cmd | SWD_CMD_START | SWD_CMD_PARK;
+	swd_cmd_queue[i].dst = dst;
+	swd_cmd_queue[i].data = data;
 
-	mpsse_clock_data_out(mpsse_ctx, &swd_cmd_queue[i].cmd, 0, 8, SWD_MODE);
+	/* The whole transaction is encoded at once and queued as a single
+	 * block: request byte, SWDIO released, ack (and read data) clocked
+	 * in, SWDIO driven again, then write data and parity. */
+	uint8_t buf[4 + 6 + 5 + 6 + 10];
+	unsigned n = 0;
 
-	if (swd_cmd_queue[i].cmd & SWD_CMD_RnW) {
-		/* Queue a read transaction */
-		swd_cmd_queue[i].dst = dst;
+	buf[n++] = SWD_MODE | 0x10;
+	buf[n++] = 0;
+	buf[n++] = 0;
+	buf[n++] = swd_cmd_queue[i].cmd;
+	n += ftdi_swd_encode_swdio_en(false, buf + n);
 
-		ftdi_swd_swdio_en(false);
-		mpsse_clock_data_in(mpsse_ctx, swd_cmd_queue[i].trn_ack_data_parity_trn,
-				0, 1 + 3 + 32 + 1 + 1, SWD_MODE);
-		ftdi_swd_swdio_en(true);
+	if (swd_cmd_queue[i].cmd & SWD_CMD_RnW) {
+		/* Queue a read transaction: 1 + 3 + 32 + 1 + 1 bits in, as four
+		 * bytes followed by six bits */
+		buf[n++] = SWD_MODE | 0x20;
+		buf[n++] = 3;
+		buf[n++] = 0;
+		buf[n++] = SWD_MODE | 0x22;
+		buf[n++] = 5;
+		n += ftdi_swd_encode_swdio_en(true, buf + n);
+
+		mpsse_queue_raw(mpsse_ctx, buf, n, swd_cmd_queue[i].trn_ack_data_parity_trn, 5);
 	} else {
-		/* Queue a write transaction */
-		ftdi_swd_swdio_en(false);
-
-		mpsse_clock_data_in(mpsse_ctx, swd_cmd_queue[i].trn_ack_data_parity_trn,
-				0, 1 + 3 + 1, SWD_MODE);
-
-		ftdi_swd_swdio_en(true);
-
-		buf_set_u32(swd_cmd_queue[i].trn_ack_data_parity_trn, 1 + 3 + 1, 32, data);
-		buf_set_u32(swd_cmd_queue[i].trn_ack_data_parity_trn, 1 + 3 + 1 + 32, 1, parity_u32(data));
-
-		mpsse_clock_data_out(mpsse_ctx, swd_cmd_queue[i].trn_ack_data_parity_trn,
-				1 + 3 + 1, 32 + 1, SWD_MODE);
+		/* Queue a write transaction: 1 + 3 + 1 bits in, 32 + 1 out */
+		buf[n++] = SWD_MODE | 0x22;
+		buf[n++] = 4;
+		n += ftdi_swd_encode_swdio_en(true, buf + n);
+
+		buf[n++] = SWD_MODE | 0x10;
+		buf[n++] = 3;
+		buf[n++] = 0;
+		h_u32_to_le(buf + n, data);
+		n += 4;
+		buf[n++] = SWD_MODE | 0x12;
+		buf[n++] = 0;
+		buf[n++] = parity_u32(data);
+
+		mpsse_queue_raw(mpsse_ctx, buf, n, swd_cmd_queue[i].trn_ack_data_parity_trn, 1);
 	}
 
 	/* Insert idle cycles after AP accesses to avoid WAIT */
@@ -1177,7 +1241,7 @@ static const char * const ftdi_transports[] = { "jtag", "swd", NULL };
 
 struct jtag_interface ftdi_interface = {
 	.name = "ftdi",
-	.supported = DEBUG_CAP_TMS_SEQ,
+	.supported = DEBUG_CAP_TMS_SEQ | DEBUG_CAP_QUEUED_SLEEP,
 	.commands = ftdi_command_handlers,
 	.transports = ftdi_transports,
 	.swd = &ftdi_swd,
@@ -207,11 +207,18 @@ static void gw16012_runtest(int num_cycles)
 		gw16012_state_move();
 	}
 
-	for (i = 0; i < num_cycles; i++) {
-		gw16012_control(0x0); /* single-bit mode */
-		gw16012_data(0x0); /* TMS cycle with TMS low */
+	/* seven-bit mode clocks with TMS low, like the shifts in gw16012_scan() */
+	i = 0;
+	if (num_cycles >= 7) {
+		gw16012_control(0x2); /* seven-bit mode */
+		for (; i + 7 <= num_cycles; i += 7)
+			gw16012_data(0x0);
 	}
 
+	gw16012_control(0x0); /* single-bit mode */
+	for (; i < num_cycles; i++)
+		gw16012_data(0x0); /* TMS cycle with TMS low */
+
 	gw16012_end_state(saved_end_state);
 	if (tap_get_state() != tap_get_end_state())
 		gw16012_state_move();
@@ -58,7 +58,8 @@ static bool trace_enabled;
 #define JLINK_MAX_SPEED			12000
 #define JLINK_TAP_BUFFER_SIZE	2048
 
-static unsigned int swd_buffer_size = JLINK_TAP_BUFFER_SIZE;
+/* Largest tap buffer in bytes a single transfer may use */
+static unsigned int tap_buffer_limit = JLINK_TAP_BUFFER_SIZE;
 
 /* 256 byte non-volatile memory */
 struct device_config {
@@ -94,6 +95,7 @@ static int jlink_swd_switch_seq(enum swd_special_seq seq);
 
 /* J-Link tap buffer functions */
 static void jlink_tap_init(void);
+static void jlink_tap_free(void);
 static int jlink_flush(void);
 /**
  * Queue data to go out and in, flushing the queue as many times as
@@ -257,9 +259,21 @@ static void jlink_execute_reset(struct jtag_command *cmd)
 
 static void jlink_execute_sleep(struct jtag_command *cmd)
 {
-	DEBUG_JTAG_IO("sleep %" PRIi32 "", cmd->cmd.sleep->us);
+	uint32_t us = cmd->cmd.sleep->us;
+	int khz = jtag_get_speed_khz();
+
+	DEBUG_JTAG_IO("sleep %" PRIi32 "", us);
+
+	/* short delays are idle clocks in the tap buffer; the actual TCK is
+	 * never faster than the configured one, so they don't end early */
+	if (iface == JAYLINK_TIF_JTAG && khz > 0 && us < ADAPTER_QUEUED_SLEEP_MAX_US &&
+			tap_is_state_stable(tap_get_state())) {
+		jlink_stableclocks(((uint64_t)us * khz + 999) / 1000);
+		return;
+	}
+
 	jlink_flush();
-	jtag_sleep(cmd->cmd.sleep->us);
+	jtag_sleep(us);
 }
 
 static int jlink_execute_command(struct jtag_command *cmd)
@@ -466,11 +480,12 @@ static int jlink_register(void)
 }
 
 /*
- * Adjust the SWD transaction buffer size depending on the free device internal
- * memory. This ensures that the SWD transactions sent to the device do not
- * exceed the internal memory of the device.
+ * Adjust the tap buffer limit depending on the free device internal memory.
+ * This ensures that the JTAG and SWD transactions sent to the device do not
+ * exceed the internal memory of the device, while letting a single transfer
+ * use all of it.
  */
-static bool adjust_swd_buffer_size(void)
+static bool adjust_tap_buffer_limit(void)
 {
 	int ret;
 	uint32_t tmp;
@@ -491,12 +506,12 @@ static bool adjust_swd_buffer_size(void)
 		return false;
 	}
 
-	tmp = MIN(JLINK_TAP_BUFFER_SIZE, (tmp - 16) / 2);
+	tmp = (tmp - 16) / 2;
 
-	if (tmp != swd_buffer_size) {
-		swd_buffer_size = tmp;
-		LOG_DEBUG("Adjusted SWD transaction buffer size to %u bytes.",
-			swd_buffer_size);
+	if (tmp != tap_buffer_limit) {
+		tap_buffer_limit = tmp;
+		LOG_DEBUG("Adjusted transaction buffer size to %u bytes.",
+			tap_buffer_limit);
 	}
 
 	return true;
@@ -645,18 +660,16 @@ static int jlink_init(void)
 			jtag_command_version = JAYLINK_JTAG_V3;
 	}
 
-	if (iface == JAYLINK_TIF_SWD) {
-		/*
-		 * Adjust the SWD transaction buffer size in case there is already
-		 * allocated memory on the device. This happens for example if the
-		 * memory for SWO capturing is still allocated because the software
-		 * which used the device before has not been shut down properly.
-		 */
-		if (!adjust_swd_buffer_size()) {
-			jaylink_close(devh);
-			jaylink_exit(jayctx);
-			return ERROR_JTAG_INIT_FAILED;
-		}
+	/*
+	 * Adjust the transaction buffer size to the free device memory, also in
+	 * case there is already allocated memory on the device. This happens for
+	 * example if the memory for SWO capturing is still allocated because the
+	 * software which used the device before has not been shut down properly.
+	 */
+	if (!adjust_tap_buffer_limit()) {
+		jaylink_close(devh);
+		jaylink_exit(jayctx);
+		return ERROR_JTAG_INIT_FAILED;
 	}
 
 	if (jaylink_has_cap(caps, JAYLINK_DEV_CAP_READ_CONFIG)) {
@@ -749,6 +762,8 @@ static int jlink_quit(void)
 	jaylink_close(devh);
 	jaylink_exit(jayctx);
 
+	jlink_tap_free();
+
 	return ERROR_OK;
 }
 
@@ -805,10 +820,12 @@ static void jlink_stableclocks(int num_cycles)
 {
 	int i;
 
-	uint8_t tms = tap_get_state() == TAP_RESET;
-	/* Execute num_cycles. */
-	for (i = 0; i < num_cycles; i++)
-		jlink_clock_data(NULL, 0, &tms, 0, NULL, 0, 1);
+	static const uint8_t ones[8] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	const uint8_t *tms = tap_get_state() == TAP_RESET ? ones : NULL;
+
+	/* Execute num_cycles, TMS held at the level of the stable state. */
+	for (i = 0; i < num_cycles; i += 64)
+		jlink_clock_data(NULL, 0, tms, 0, NULL, 0, MIN(num_cycles - i, 64));
 }
 
 static void jlink_runtest(int num_cycles)
@@ -1156,7 +1173,9 @@ static uint32_t calculate_trace_buffer_size(void)
 	return tmp & 0xffffff00;
 }
 
-static bool check_trace_freq(struct jaylink_swo_speed speed,
+/* smallest deviation of a divided SWO base frequency from trace_freq,
+ * stopping at the first one that is good enough */
+static double trace_freq_deviation(struct jaylink_swo_speed speed,
 		uint32_t trace_freq)
 {
 	double min;
@@ -1171,13 +1190,24 @@ static bool check_trace_freq(struct jaylink_swo_speed speed,
 		if (deviation < 0.03) {
 			LOG_DEBUG("Found suitable frequency divider %u with deviation of "
 				"%.02f %%.", divider, deviation);
-			return true;
+			return deviation;
 		}
 
 		if (deviation < min)
 			min = deviation;
 	}
 
+	return min;
+}
+
+static bool check_trace_freq(struct jaylink_swo_speed speed,
+		uint32_t trace_freq)
+{
+	double min = trace_freq_deviation(speed, trace_freq);
+
+	if (min < 0.03)
+		return true;
+
 	LOG_ERROR("Selected trace frequency is not supported by the device. "
 		"Please choose a different trace frequency.");
 	LOG_ERROR("Maximum permitted deviation is 3.00 %%, but only %.02f %% "
@@ -1186,6 +1216,28 @@ static bool check_trace_freq(struct jaylink_swo_speed speed,
 	return false;
 }
 
+static int trace_freq_supported(enum tpio_pin_protocol pin_protocol,
+		unsigned int trace_freq, bool *supported)
+{
+	int ret;
+	struct jaylink_swo_speed speed;
+
+	/* config_trace() reports these */
+	if (!jaylink_has_cap(caps, JAYLINK_DEV_CAP_SWO) || pin_protocol != ASYNC_UART)
+		return ERROR_FAIL;
+
+	ret = jaylink_swo_get_speeds(devh, JAYLINK_SWO_MODE_UART, &speed);
+
+	if (ret != JAYLINK_OK) {
+		LOG_ERROR("jaylink_swo_get_speeds() failed: %s.",
+			jaylink_strerror_name(ret));
+		return ERROR_FAIL;
+	}
+
+	*supported = trace_freq_deviation(speed, trace_freq) < 0.03;
+	return ERROR_OK;
+}
+
 static int config_trace(bool enabled, enum tpio_pin_protocol pin_protocol,
 		uint32_t port_size, unsigned int *trace_freq)
 {
@@ -1214,10 +1266,10 @@ static int config_trace(bool enabled, enum tpio_pin_protocol pin_protocol,
 
 	if (!enabled) {
 		/*
-		 * Adjust the SWD transaction buffer size as stopping SWO capturing
+		 * Adjust the transaction buffer size as stopping SWO capturing
 		 * deallocates device internal memory.
 		 */
-		if (!adjust_swd_buffer_size())
+		if (!adjust_tap_buffer_limit())
 			return ERROR_FAIL;
 
 		return ERROR_OK;
@@ -1256,10 +1308,10 @@ static int config_trace(bool enabled, enum tpio_pin_protocol pin_protocol,
 	}
 
 	/*
-	 * Adjust the SWD transaction buffer size as starting SWO capturing
+	 * Adjust the transaction buffer size as starting SWO capturing
 	 * allocates device internal memory.
 	 */
-	if (!adjust_swd_buffer_size())
+	if (!adjust_tap_buffer_limit())
 		return ERROR_FAIL;
 
 	return ERROR_OK;
@@ -1683,10 +1735,14 @@ static int_least32_t jlink_swd_frequency(int_least32_t hz)
 /* J-Link tap functions */
 
 static unsigned tap_length;
+/* Current size in bytes of each tap buffer, grown up to tap_buffer_limit */
+static unsigned tap_buffer_size;
+/* One allocation backing the three tap buffers */
+static uint8_t *tap_arena;
 /* In SWD mode use tms buffer for direction control */
-static uint8_t tms_buffer[JLINK_TAP_BUFFER_SIZE];
-static uint8_t tdi_buffer[JLINK_TAP_BUFFER_SIZE];
-static uint8_t tdo_buffer[JLINK_TAP_BUFFER_SIZE];
+static uint8_t *tms_buffer;
+static uint8_t *tdi_buffer;
+static uint8_t *tdo_buffer;
 
 struct pending_scan_result {
 	/** First bit position in tdo_buffer to read. */
@@ -1699,16 +1755,97 @@ struct pending_scan_result {
 	unsigned buffer_offset;
 };
 
-#define MAX_PENDING_SCAN_RESULTS 256
+/* Initial number of pending scan results, doubled as needed */
+#define MIN_PENDING_SCAN_RESULTS 256
 
 static int pending_scan_results_length;
-static struct pending_scan_result pending_scan_results_buffer[MAX_PENDING_SCAN_RESULTS];
+static int pending_scan_results_size;
+static struct pending_scan_result *pending_scan_results_buffer;
 
 static void jlink_tap_init(void)
 {
+	if (tms_buffer)
+		memset(tms_buffer, 0, DIV_ROUND_UP(tap_length, 8));
 	tap_length = 0;
 	pending_scan_results_length = 0;
-	memset(tms_buffer, 0, sizeof(tdi_buffer));
+}
+
+static void jlink_tap_free(void)
+{
+	free(tap_arena);
+	tap_arena = NULL;
+	tms_buffer = tdi_buffer = tdo_buffer = NULL;
+	tap_buffer_size = 0;
+	tap_length = 0;
+
+	free(pending_scan_results_buffer);
+	pending_scan_results_buffer = NULL;
+	pending_scan_results_size = 0;
+	pending_scan_results_length = 0;
+}
+
+/*
+ * Grow the tap buffers so that another bits bits fit, but never beyond
+ * tap_buffer_limit. Returns false if they still do not fit and the queue
+ * has to be flushed first.
+ */
+static bool jlink_tap_reserve(unsigned bits)
+{
+	unsigned needed = DIV_ROUND_UP(tap_length + bits, 8);
+
+	if (needed <= tap_buffer_size)
+		return true;
+
+	if (tap_buffer_size < tap_buffer_limit) {
+		unsigned size = MAX(tap_buffer_size, 256u);
+
+		while (size < needed)
+			size *= 2;
+		size = MIN(size, tap_buffer_limit);
+
+		uint8_t *arena = calloc(3, size);
+		if (!arena) {
+			LOG_ERROR("Failed to grow the tap buffers to %u bytes.", size);
+			return false;
+		}
+
+		if (tap_arena) {
+			unsigned used = DIV_ROUND_UP(tap_length, 8);
+			memcpy(arena, tms_buffer, used);
+			memcpy(arena + size, tdi_buffer, used);
+			free(tap_arena);
+		}
+
+		tap_arena = arena;
+		tms_buffer = arena;
+		tdi_buffer = arena + size;
+		tdo_buffer = arena + 2 * size;
+		tap_buffer_size = size;
+	}
+
+	return needed <= tap_buffer_size;
+}
+
+/* Make room for one more pending scan result */
+static bool jlink_pending_reserve(void)
+{
+	if (pending_scan_results_length < pending_scan_results_size)
+		return true;
+
+	int size = pending_scan_results_size ?
+		pending_scan_results_size * 2 : MIN_PENDING_SCAN_RESULTS;
+	struct pending_scan_result *p = realloc(pending_scan_results_buffer,
+		size * sizeof(*p));
+
+	if (!p) {
+		LOG_ERROR("Failed to grow the pending scan results to %d entries.", size);
+		return false;
+	}
+
+	pending_scan_results_buffer = p;
+	pending_scan_results_size = size;
+
+	return true;
 }
 
 static void jlink_clock_data(const uint8_t *out, unsigned out_offset,
@@ -1717,13 +1854,18 @@ static void jlink_clock_data(const uint8_t *out, unsigned out_offset,
 			     unsigned length)
 {
 	do {
-		unsigned available_length = JLINK_TAP_BUFFER_SIZE - tap_length / 8;
+		jlink_tap_reserve(length);
+		unsigned available_length = tap_buffer_size * 8 - tap_length;
 
-		if (!available_length ||
-		    (in && pending_scan_results_length == MAX_PENDING_SCAN_RESULTS)) {
+		if (!available_length || (in && !jlink_pending_reserve())) {
 			if (jlink_flush() != ERROR_OK)
 				return;
-			available_length = JLINK_TAP_BUFFER_SIZE;
+
+			jlink_tap_reserve(length);
+			available_length = tap_buffer_size * 8;
+
+			if (!available_length || (in && !jlink_pending_reserve()))
+				return;
 		}
 
 		struct pending_scan_result *pending_scan_result =
@@ -1848,6 +1990,17 @@ static int jlink_swd_switch_seq(enum swd_special_seq seq)
 			return ERROR_FAIL;
 	}
 
+	/* leave room for the idle cycles added by jlink_swd_run_queue() */
+	if (!jlink_tap_reserve(s_len + 8)) {
+		int retval = jlink_swd_run_queue();
+
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (!jlink_tap_reserve(s_len + 8))
+			return ERROR_FAIL;
+	}
+
 	jlink_queue_data_out(s, s_len);
 
 	return ERROR_OK;
@@ -1869,6 +2022,11 @@ static int jlink_swd_run_queue(void)
 	 * A transaction must be followed by another transaction or at least 8 idle
 	 * cycles to ensure that data is clocked through the AP.
 	 */
+	if (!jlink_tap_reserve(8)) {
+		queued_retval = ERROR_FAIL;
+		goto skip;
+	}
+
 	jlink_queue_data_out(NULL, 8);
 
 	ret = jaylink_swd_io(devh, tms_buffer, tdi_buffer, tdo_buffer, tap_length);
@@ -1912,10 +2070,16 @@ skip:
 static void jlink_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint32_t ap_delay_clk)
 {
 	uint8_t data_parity_trn[DIV_ROUND_UP(32 + 1, 8)];
-	if (tap_length + 46 + 8 + ap_delay_clk >= sizeof(tdi_buffer) * 8 ||
-	    pending_scan_results_length == MAX_PENDING_SCAN_RESULTS) {
+	/* 46 bits for the transaction and 8 idle cycles for jlink_swd_run_queue() */
+	unsigned int bits = 46 + ap_delay_clk + 8;
+
+	if (!jlink_tap_reserve(bits) || !jlink_pending_reserve()) {
 		/* Not enough room in the queue. Run the queue. */
 		queued_retval = jlink_swd_run_queue();
+
+		if (queued_retval == ERROR_OK &&
+		    (!jlink_tap_reserve(bits) || !jlink_pending_reserve()))
+			queued_retval = ERROR_FAIL;
 	}
 
 	if (queued_retval != ERROR_OK)
@@ -1944,7 +2108,9 @@ static void jlink_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint3
 		jlink_queue_data_out(data_parity_trn, 32 + 1);
 	}
 
-	pending_scan_results_length++;
+	/* TARGETSEL is not acknowledged, leave its ACK bits unchecked */
+	if (swd_cmd_returns_ack(cmd))
+		pending_scan_results_length++;
 
 	/* Insert idle cycles after AP accesses to avoid WAIT. */
 	if (cmd & SWD_CMD_APnDP)
@@ -1964,6 +2130,7 @@ static const char * const jlink_transports[] = { "jtag", "swd", NULL };
 
 struct jtag_interface jlink_interface = {
 	.name = "jlink",
+	.supported = DEBUG_CAP_QUEUED_SLEEP,
 	.commands = jlink_command_handlers,
 	.transports = jlink_transports,
 	.swd = &jlink_swd,
@@ -1974,5 +2141,6 @@ struct jtag_interface jlink_interface = {
 	.init = &jlink_init,
 	.quit = &jlink_quit,
 	.config_trace = &config_trace,
+	.check_trace_freq = &trace_freq_supported,
 	.poll_trace = &poll_trace,
 };
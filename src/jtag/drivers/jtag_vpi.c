@@ -57,6 +57,33 @@ struct vpi_cmd {
 	int nb_bits;
 };
 
+/*
+ * Scan chain commands are sent without waiting for the server, which answers
+ * them in order. Their replies are collected by jtag_vpi_flush() at the end
+ * of the queue, or once this many are outstanding. The limit keeps the
+ * unread replies (about 1 KiB each) well inside the socket buffers, so the
+ * server never blocks on a reply while we block on the next command.
+ */
+#define MAX_PENDING_XFERS	32
+
+/* Scan chain command whose reply has not been read yet */
+struct vpi_pending_xfer {
+	/* where the TDO data goes, NULL if it is not needed */
+	uint8_t *bits;
+	int nb_bytes;
+};
+
+/* Scan whose buffer is complete once the pending replies are read */
+struct vpi_pending_scan {
+	struct scan_command *cmd;
+	uint8_t *buf;
+};
+
+static struct vpi_pending_xfer pending_xfers[MAX_PENDING_XFERS];
+static int pending_xfer_count;
+static struct vpi_pending_scan pending_scans[MAX_PENDING_XFERS];
+static int pending_scan_count;
+
 static int jtag_vpi_send_cmd(struct vpi_cmd *vpi)
 {
 	int retval = write_socket(sockfd, vpi, sizeof(struct vpi_cmd));
@@ -75,6 +102,41 @@ static int jtag_vpi_receive_cmd(struct vpi_cmd *vpi)
 	return ERROR_OK;
 }
 
+/**
+ * jtag_vpi_flush - collect the replies of all outstanding scan chain commands
+ *
+ * Copies the TDO data in place and hands every completed scan to
+ * jtag_read_buffer().
+ */
+static int jtag_vpi_flush(void)
+{
+	struct vpi_cmd vpi;
+	int retval = ERROR_OK;
+
+	for (int i = 0; i < pending_xfer_count; i++) {
+		struct vpi_pending_xfer *p = &pending_xfers[i];
+
+		retval = jtag_vpi_receive_cmd(&vpi);
+		if (retval != ERROR_OK)
+			break;
+
+		if (p->bits)
+			memcpy(p->bits, vpi.buffer_in, p->nb_bytes);
+	}
+	pending_xfer_count = 0;
+
+	for (int i = 0; i < pending_scan_count; i++) {
+		struct vpi_pending_scan *p = &pending_scans[i];
+
+		if (retval == ERROR_OK)
+			retval = jtag_read_buffer(p->buf, p->cmd);
+		free(p->buf);
+	}
+	pending_scan_count = 0;
+
+	return retval;
+}
+
 /**
  * jtag_vpi_reset - ask to reset the JTAG device
  * @trst: 1 if TRST is to be asserted
@@ -182,16 +244,20 @@ static int jtag_vpi_queue_tdi_xfer(uint8_t *bits, int nb_bits, int tap_shift)
 	vpi.length = nb_bytes;
 	vpi.nb_bits = nb_bits;
 
-	int retval = jtag_vpi_send_cmd(&vpi);
-	if (retval != ERROR_OK)
-		return retval;
+	if (pending_xfer_count == MAX_PENDING_XFERS) {
+		int retval = jtag_vpi_flush();
+		if (retval != ERROR_OK)
+			return retval;
+	}
 
-	retval = jtag_vpi_receive_cmd(&vpi);
+	int retval = jtag_vpi_send_cmd(&vpi);
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (bits)
-		memcpy(bits, vpi.buffer_in, nb_bytes);
+	/* the reply is read later, by jtag_vpi_flush() */
+	pending_xfers[pending_xfer_count].bits = bits;
+	pending_xfers[pending_xfer_count].nb_bytes = nb_bytes;
+	pending_xfer_count++;
 
 	return ERROR_OK;
 }
@@ -294,12 +360,18 @@ static int jtag_vpi_scan(struct scan_command *cmd)
 			tap_set_state(TAP_DRPAUSE);
 	}
 
-	retval = jtag_read_buffer(buf, cmd);
-	if (retval != ERROR_OK)
-		return retval;
+	/* buf is filled in and checked once the replies arrive */
+	if (pending_scan_count == MAX_PENDING_XFERS) {
+		retval = jtag_vpi_flush();
+		if (retval != ERROR_OK) {
+			free(buf);
+			return retval;
+		}
+	}
 
-	if (buf)
-		free(buf);
+	pending_scans[pending_scan_count].cmd = cmd;
+	pending_scans[pending_scan_count].buf = buf;
+	pending_scan_count++;
 
 	if (cmd->end_state != TAP_DRSHIFT) {
 		retval = jtag_vpi_state_move(cmd->end_state);
@@ -358,6 +430,8 @@ static int jtag_vpi_execute_queue(void)
 			retval = jtag_vpi_tms(cmd->cmd.tms);
 			break;
 		case JTAG_SLEEP:
+			/* the sleep must follow the commands before it */
+			retval = jtag_vpi_flush();
 			jtag_sleep(cmd->cmd.sleep->us);
 			break;
 		case JTAG_SCAN:
@@ -366,6 +440,11 @@ static int jtag_vpi_execute_queue(void)
 		}
 	}
 
+	/* drain the replies even after an error to stay in sync */
+	int flush_retval = jtag_vpi_flush();
+	if (retval == ERROR_OK)
+		retval = flush_retval;
+
 	return retval;
 }
 
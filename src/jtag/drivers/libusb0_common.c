@@ -21,6 +21,7 @@
 #include "config.h"
 #endif
 #include "log.h"
+#include <helper/perf.h>
 #include "libusb0_common.h"
 
 static bool jtag_libusb_match(struct jtag_libusb_device *dev,
@@ -107,6 +108,14 @@ void jtag_libusb_close(jtag_libusb_device_handle *dev)
 	usb_close(dev);
 }
 
+/* "perf dump" totals, bit 7 of the endpoint is set for IN transfers */
+static void jtag_libusb_count(int ep, int transferred)
+{
+	perf_add(PERF_USB_TRANSFERS, 1);
+	if (transferred > 0)
+		perf_add((ep & 0x80) ? PERF_USB_BYTES_IN : PERF_USB_BYTES_OUT, transferred);
+}
+
 int jtag_libusb_control_transfer(jtag_libusb_device_handle *dev, uint8_t requestType,
 		uint8_t request, uint16_t wValue, uint16_t wIndex, char *bytes,
 		uint16_t size, unsigned int timeout)
@@ -119,19 +128,27 @@ int jtag_libusb_control_transfer(jtag_libusb_device_handle *dev, uint8_t request
 	if (transferred < 0)
 		transferred = 0;
 
+	/* the direction of the data stage is in bit 7, as for endpoints */
+	jtag_libusb_count(requestType, transferred);
 	return transferred;
 }
 
 int jtag_libusb_bulk_write(jtag_libusb_device_handle *dev, int ep, char *bytes,
 		int size, int timeout)
 {
-	return usb_bulk_write(dev, ep, bytes, size, timeout);
+	int transferred = usb_bulk_write(dev, ep, bytes, size, timeout);
+
+	jtag_libusb_count(ep, transferred);
+	return transferred;
 }
 
 int jtag_libusb_bulk_read(jtag_libusb_device_handle *dev, int ep, char *bytes,
 		int size, int timeout)
 {
-	return usb_bulk_read(dev, ep, bytes, size, timeout);
+	int transferred = usb_bulk_read(dev, ep, bytes, size, timeout);
+
+	jtag_libusb_count(ep, transferred);
+	return transferred;
 }
 
 int jtag_libusb_set_configuration(jtag_libusb_device_handle *devh,
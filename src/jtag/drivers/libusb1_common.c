@@ -21,9 +21,15 @@
 #include "config.h"
 #endif
 #include "log.h"
+#include <helper/perf.h>
 #include "libusb1_common.h"
 
 static struct libusb_context *jtag_libusb_context; /**< Libusb context **/
+
+/* Transfers for jtag_libusb_bulk_transfer_n(), kept from one batch to the
+ * next and grown to the largest batch seen; freed on close */
+static struct libusb_transfer **jtag_libusb_pool;
+static size_t jtag_libusb_pool_size;
 static libusb_device **devs; /**< The usb device list **/
 
 static bool jtag_libusb_match(struct libusb_device_descriptor *dev_desc,
@@ -115,12 +121,26 @@ int jtag_libusb_open(const uint16_t vids[], const uint16_t pids[],
 
 void jtag_libusb_close(jtag_libusb_device_handle *dev)
 {
+	for (size_t i = 0; i < jtag_libusb_pool_size; i++)
+		libusb_free_transfer(jtag_libusb_pool[i]);
+	free(jtag_libusb_pool);
+	jtag_libusb_pool = NULL;
+	jtag_libusb_pool_size = 0;
+
 	/* Close device */
 	libusb_close(dev);
 
 	libusb_exit(jtag_libusb_context);
 }
 
+/* "perf dump" totals, bit 7 of the endpoint is set for IN transfers */
+static void jtag_libusb_count(int ep, int transferred)
+{
+	perf_add(PERF_USB_TRANSFERS, 1);
+	if (transferred > 0)
+		perf_add((ep & 0x80) ? PERF_USB_BYTES_IN : PERF_USB_BYTES_OUT, transferred);
+}
+
 int jtag_libusb_control_transfer(jtag_libusb_device_handle *dev, uint8_t requestType,
 		uint8_t request, uint16_t wValue, uint16_t wIndex, char *bytes,
 		uint16_t size, unsigned int timeout)
@@ -133,6 +153,8 @@ int jtag_libusb_control_transfer(jtag_libusb_device_handle *dev, uint8_t request
 	if (transferred < 0)
 		transferred = 0;
 
+	/* the direction of the data stage is in bit 7, as for endpoints */
+	jtag_libusb_count(requestType, transferred);
 	return transferred;
 }
 
@@ -143,6 +165,7 @@ int jtag_libusb_bulk_write(jtag_libusb_device_handle *dev, int ep, char *bytes,
 
 	libusb_bulk_transfer(dev, ep, (unsigned char *)bytes, size,
 			     &transferred, timeout);
+	jtag_libusb_count(ep, transferred);
 	return transferred;
 }
 
@@ -153,9 +176,99 @@ int jtag_libusb_bulk_read(jtag_libusb_device_handle *dev, int ep, char *bytes,
 
 	libusb_bulk_transfer(dev, ep, (unsigned char *)bytes, size,
 			     &transferred, timeout);
+	jtag_libusb_count(ep, transferred);
 	return transferred;
 }
 
+static void LIBUSB_CALL jtag_libusb_xfer_cb(struct libusb_transfer *transfer)
+{
+	int *completed = transfer->user_data;
+
+	*completed = 1;
+}
+
+static int jtag_libusb_pool_grow(size_t n)
+{
+	if (n <= jtag_libusb_pool_size)
+		return ERROR_OK;
+
+	struct libusb_transfer **pool = realloc(jtag_libusb_pool, n * sizeof(*pool));
+	if (!pool)
+		return ERROR_FAIL;
+	jtag_libusb_pool = pool;
+
+	while (jtag_libusb_pool_size < n) {
+		pool[jtag_libusb_pool_size] = libusb_alloc_transfer(0);
+		if (!pool[jtag_libusb_pool_size])
+			return ERROR_FAIL;
+		jtag_libusb_pool_size++;
+	}
+	return ERROR_OK;
+}
+
+int jtag_libusb_bulk_transfer_n(jtag_libusb_device_handle *dev,
+		struct jtag_xfer *xfers, size_t n, int timeout)
+{
+	int retval = ERROR_OK;
+	size_t i, submitted;
+
+	if (jtag_libusb_pool_grow(n) != ERROR_OK) {
+		LOG_ERROR("failed to allocate usb transfers");
+		return ERROR_FAIL;
+	}
+
+	for (i = 0; i < n; i++) {
+		xfers[i].completed = 0;
+		xfers[i].transferred = 0;
+		xfers[i].transfer = jtag_libusb_pool[i];
+	}
+
+	for (submitted = 0; submitted < n; submitted++) {
+		struct jtag_xfer *x = &xfers[submitted];
+
+		libusb_fill_bulk_transfer(x->transfer, dev, x->ep, x->buf, x->size,
+				jtag_libusb_xfer_cb, &x->completed, timeout);
+
+		int ret = libusb_submit_transfer(x->transfer);
+		if (ret != LIBUSB_SUCCESS) {
+			LOG_ERROR("libusb_submit_transfer() failed: %s", libusb_error_name(ret));
+			retval = ERROR_FAIL;
+			break;
+		}
+	}
+
+	/* Nothing that was submitted may be freed before it completes */
+	if (retval != ERROR_OK) {
+		for (i = 0; i < submitted; i++)
+			libusb_cancel_transfer(xfers[i].transfer);
+	}
+
+	for (i = 0; i < submitted; i++) {
+		struct jtag_xfer *x = &xfers[i];
+
+		while (!x->completed) {
+			int ret = libusb_handle_events_completed(jtag_libusb_context, &x->completed);
+			if (ret != LIBUSB_SUCCESS && ret != LIBUSB_ERROR_INTERRUPTED)
+				LOG_DEBUG("libusb_handle_events_completed() failed: %s",
+					libusb_error_name(ret));
+		}
+
+		x->transferred = x->transfer->actual_length;
+		jtag_libusb_count(x->ep, x->transferred);
+		if (x->transfer->status != LIBUSB_TRANSFER_COMPLETED || x->transferred != x->size) {
+			/* after a timeout or error, don't wait out the timeout of
+			 * every transfer behind it as well */
+			if (retval == ERROR_OK) {
+				for (size_t j = i + 1; j < submitted; j++)
+					libusb_cancel_transfer(xfers[j].transfer);
+			}
+			retval = ERROR_FAIL;
+		}
+	}
+
+	return retval;
+}
+
 int jtag_libusb_set_configuration(jtag_libusb_device_handle *devh,
 		int configuration)
 {
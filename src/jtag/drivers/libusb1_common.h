@@ -58,6 +58,31 @@ int jtag_libusb_bulk_read(struct jtag_libusb_device_handle *dev, int ep,
 		char *bytes, int size, int timeout);
 int jtag_libusb_set_configuration(jtag_libusb_device_handle *devh,
 		int configuration);
+
+/** One bulk transfer of a batch handed to jtag_libusb_bulk_transfer_n(). */
+struct jtag_xfer {
+	/** Endpoint address, the direction bit selects read or write. */
+	int ep;
+	/** Data to send or room for the data to receive. */
+	uint8_t *buf;
+	/** Number of bytes expected to be transferred. */
+	int size;
+	/** Number of bytes actually transferred. */
+	int transferred;
+	/* internal */
+	int completed;
+	struct libusb_transfer *transfer;
+};
+
+/**
+ * Submit several bulk transfers at once and wait for all of them, so that
+ * the device is never left waiting for the host between them. Transfers
+ * to the same endpoint complete in the order given.
+ * @returns Returns ERROR_OK if every transfer moved exactly @c size bytes,
+ *	ERROR_FAIL otherwise.
+ */
+int jtag_libusb_bulk_transfer_n(jtag_libusb_device_handle *dev,
+		struct jtag_xfer *xfers, size_t n, int timeout);
 /**
  * Find the first interface optionally matching class, subclass and
  * protocol and claim it.
@@ -0,0 +1,418 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/**
+ * @file
+ * This driver implements a bitbang jtag interface using the Linux GPIO
+ * character device (/dev/gpiochipN). Unlike sysfsgpio, the lines are
+ * requested in groups through line handles, so tck, tms and tdi are
+ * updated together by a single ioctl, and tdo is sampled by another.
+ *
+ * All lines must live on the same gpiochip, selected with the
+ * linuxgpio_gpiochip command. Line numbers are offsets within that chip.
+ * One or both of srst and trst must be specified, both are driven active
+ * low.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <jtag/interface.h>
+#include "bitbang.h"
+
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+/* indices of the lines within the jtag output handle */
+#define OUT_TCK		0
+#define OUT_TMS		1
+#define OUT_TDI		2
+
+/* indices of the lines within the reset handle, when both are used */
+#define RST_TRST	0
+
+static int gpiochip = -1;
+static int tck_gpio = -1;
+static int tms_gpio = -1;
+static int tdi_gpio = -1;
+static int tdo_gpio = -1;
+static int trst_gpio = -1;
+static int srst_gpio = -1;
+
+static int chip_fd = -1;
+static int out_fd = -1;
+static int in_fd = -1;
+static int rst_fd = -1;
+
+static struct gpiohandle_data out_values;
+static struct gpiohandle_data rst_values;
+static int srst_index = -1;
+
+static int linuxgpio_set(int fd, struct gpiohandle_data *data)
+{
+	if (ioctl(fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, data) < 0) {
+		LOG_WARNING("setting gpio lines failed: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+static int linuxgpio_read(void)
+{
+	struct gpiohandle_data data;
+
+	if (ioctl(in_fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0) {
+		LOG_WARNING("reading tdo failed: %s", strerror(errno));
+		return 0;
+	}
+
+	return data.values[0] != 0;
+}
+
+static void linuxgpio_write(int tck, int tms, int tdi)
+{
+	if (out_values.values[OUT_TCK] == tck &&
+			out_values.values[OUT_TMS] == tms &&
+			out_values.values[OUT_TDI] == tdi)
+		return;
+
+	out_values.values[OUT_TCK] = tck;
+	out_values.values[OUT_TMS] = tms;
+	out_values.values[OUT_TDI] = tdi;
+	linuxgpio_set(out_fd, &out_values);
+}
+
+/*
+ * Each bit costs one ioctl for the falling edge together with the new
+ * tms/tdi values, one to sample tdo (skipped when not needed) and one for
+ * the rising edge.
+ */
+static void linuxgpio_write_block(const uint8_t *tms, const uint8_t *tdi,
+		uint8_t *tdo, unsigned len)
+{
+	struct gpiohandle_data in_values;
+
+	for (unsigned i = 0; i < len; i++) {
+		unsigned bytec = i / 8;
+		uint8_t bcval = 1 << (i % 8);
+
+		out_values.values[OUT_TCK] = 0;
+		out_values.values[OUT_TMS] = tms && (tms[bytec] & bcval);
+		out_values.values[OUT_TDI] = tdi && (tdi[bytec] & bcval);
+		if (linuxgpio_set(out_fd, &out_values) != ERROR_OK)
+			return;
+
+		if (tdo) {
+			if (ioctl(in_fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &in_values) < 0) {
+				LOG_WARNING("reading tdo failed: %s", strerror(errno));
+				return;
+			}
+			if (in_values.values[0])
+				tdo[bytec] |= bcval;
+			else
+				tdo[bytec] &= ~bcval;
+		}
+
+		out_values.values[OUT_TCK] = 1;
+		if (linuxgpio_set(out_fd, &out_values) != ERROR_OK)
+			return;
+	}
+}
+
+/*
+ * Bitbang interface to manipulate reset lines SRST and TRST
+ *
+ * (1) assert or (0) deassert reset lines
+ */
+static void linuxgpio_reset(int trst, int srst)
+{
+	LOG_DEBUG("linuxgpio_reset");
+
+	if (rst_fd < 0)
+		return;
+
+	/* the reset handle is requested active low */
+	if (trst_gpio >= 0)
+		rst_values.values[RST_TRST] = trst;
+	if (srst_index >= 0)
+		rst_values.values[srst_index] = srst;
+
+	linuxgpio_set(rst_fd, &rst_values);
+}
+
+static int linuxgpio_request(const int *lines, const uint8_t *defaults,
+		unsigned count, uint32_t flags, const char *label)
+{
+	struct gpiohandle_request req;
+
+	memset(&req, 0, sizeof(req));
+	for (unsigned i = 0; i < count; i++) {
+		req.lineoffsets[i] = lines[i];
+		req.default_values[i] = defaults ? defaults[i] : 0;
+	}
+	req.lines = count;
+	req.flags = flags;
+	snprintf(req.consumer_label, sizeof(req.consumer_label), "openocd %s", label);
+
+	if (ioctl(chip_fd, GPIO_GET_LINEHANDLE_IOCTL, &req) < 0) {
+		LOG_ERROR("requesting gpio lines for %s failed: %s", label, strerror(errno));
+		return -1;
+	}
+
+	return req.fd;
+}
+
+COMMAND_HANDLER(linuxgpio_handle_gpiochip)
+{
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], gpiochip);
+
+	command_print(CMD_CTX, "LinuxGPIO gpiochip = %d", gpiochip);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(linuxgpio_handle_jtag_gpionums)
+{
+	if (CMD_ARGC == 4) {
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], tck_gpio);
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[1], tms_gpio);
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[2], tdi_gpio);
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[3], tdo_gpio);
+	} else if (CMD_ARGC != 0) {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	command_print(CMD_CTX,
+			"LinuxGPIO nums: tck = %d, tms = %d, tdi = %d, tdo = %d",
+			tck_gpio, tms_gpio, tdi_gpio, tdo_gpio);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(linuxgpio_handle_jtag_gpionum_tck)
+{
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], tck_gpio);
+
+	command_print(CMD_CTX, "LinuxGPIO num: tck = %d", tck_gpio);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(linuxgpio_handle_jtag_gpionum_tms)
+{
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], tms_gpio);
+
+	command_print(CMD_CTX, "LinuxGPIO num: tms = %d", tms_gpio);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(linuxgpio_handle_jtag_gpionum_tdo)
+{
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], tdo_gpio);
+
+	command_print(CMD_CTX, "LinuxGPIO num: tdo = %d", tdo_gpio);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(linuxgpio_handle_jtag_gpionum_tdi)
+{
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], tdi_gpio);
+
+	command_print(CMD_CTX, "LinuxGPIO num: tdi = %d", tdi_gpio);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(linuxgpio_handle_jtag_gpionum_srst)
+{
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], srst_gpio);
+
+	command_print(CMD_CTX, "LinuxGPIO num: srst = %d", srst_gpio);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(linuxgpio_handle_jtag_gpionum_trst)
+{
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], trst_gpio);
+
+	command_print(CMD_CTX, "LinuxGPIO num: trst = %d", trst_gpio);
+	return ERROR_OK;
+}
+
+static const struct command_registration linuxgpio_command_handlers[] = {
+	{
+		.name = "linuxgpio_gpiochip",
+		.handler = &linuxgpio_handle_gpiochip,
+		.mode = COMMAND_CONFIG,
+		.help = "number of the gpiochip holding all the lines.",
+		.usage = "[chip]",
+	},
+	{
+		.name = "linuxgpio_jtag_nums",
+		.handler = &linuxgpio_handle_jtag_gpionums,
+		.mode = COMMAND_CONFIG,
+		.help = "gpio line offsets for tck, tms, tdi, tdo. (in that order)",
+		.usage = "(tck tms tdi tdo)* ",
+	},
+	{
+		.name = "linuxgpio_tck_num",
+		.handler = &linuxgpio_handle_jtag_gpionum_tck,
+		.mode = COMMAND_CONFIG,
+		.help = "gpio line offset for tck.",
+	},
+	{
+		.name = "linuxgpio_tms_num",
+		.handler = &linuxgpio_handle_jtag_gpionum_tms,
+		.mode = COMMAND_CONFIG,
+		.help = "gpio line offset for tms.",
+	},
+	{
+		.name = "linuxgpio_tdo_num",
+		.handler = &linuxgpio_handle_jtag_gpionum_tdo,
+		.mode = COMMAND_CONFIG,
+		.help = "gpio line offset for tdo.",
+	},
+	{
+		.name = "linuxgpio_tdi_num",
+		.handler = &linuxgpio_handle_jtag_gpionum_tdi,
+		.mode = COMMAND_CONFIG,
+		.help = "gpio line offset for tdi.",
+	},
+	{
+		.name = "linuxgpio_srst_num",
+		.handler = &linuxgpio_handle_jtag_gpionum_srst,
+		.mode = COMMAND_CONFIG,
+		.help = "gpio line offset for srst.",
+	},
+	{
+		.name = "linuxgpio_trst_num",
+		.handler = &linuxgpio_handle_jtag_gpionum_trst,
+		.mode = COMMAND_CONFIG,
+		.help = "gpio line offset for trst.",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static int linuxgpio_init(void);
+static int linuxgpio_quit(void);
+
+static const char * const linuxgpio_transports[] = { "jtag", NULL };
+
+struct jtag_interface linuxgpio_interface = {
+	.name = "linuxgpio",
+	.supported = DEBUG_CAP_TMS_SEQ,
+	.execute_queue = bitbang_execute_queue,
+	.transports = linuxgpio_transports,
+	.commands = linuxgpio_command_handlers,
+	.init = linuxgpio_init,
+	.quit = linuxgpio_quit,
+};
+
+static struct bitbang_interface linuxgpio_bitbang = {
+	.read = linuxgpio_read,
+	.write = linuxgpio_write,
+	.write_block = linuxgpio_write_block,
+	.reset = linuxgpio_reset,
+	.blink = 0
+};
+
+static void cleanup_all_fds(void)
+{
+	if (rst_fd >= 0)
+		close(rst_fd);
+	if (in_fd >= 0)
+		close(in_fd);
+	if (out_fd >= 0)
+		close(out_fd);
+	if (chip_fd >= 0)
+		close(chip_fd);
+	rst_fd = in_fd = out_fd = chip_fd = -1;
+}
+
+static int linuxgpio_init(void)
+{
+	char path[32];
+	int lines[2];
+	unsigned rst_count = 0;
+
+	bitbang_interface = &linuxgpio_bitbang;
+
+	LOG_INFO("LinuxGPIO JTAG bitbang driver");
+
+	if (gpiochip < 0) {
+		LOG_ERROR("Require a gpiochip to be specified");
+		return ERROR_JTAG_INIT_FAILED;
+	}
+	if (tck_gpio < 0 || tms_gpio < 0 || tdi_gpio < 0 || tdo_gpio < 0) {
+		LOG_ERROR("Require tck, tms, tdi and tdo gpios for JTAG mode");
+		return ERROR_JTAG_INIT_FAILED;
+	}
+	if (trst_gpio < 0 && srst_gpio < 0) {
+		LOG_ERROR("Require at least one of trst or srst gpios to be specified");
+		return ERROR_JTAG_INIT_FAILED;
+	}
+
+	snprintf(path, sizeof(path), "/dev/gpiochip%d", gpiochip);
+	chip_fd = open(path, O_RDWR | O_CLOEXEC);
+	if (chip_fd < 0) {
+		LOG_ERROR("Couldn't open %s: %s", path, strerror(errno));
+		return ERROR_JTAG_INIT_FAILED;
+	}
+
+	/*
+	 * Configure TDO as an input, and TDI, TCK, TMS, TRST, SRST
+	 * as outputs.  Drive TDI and TCK low, and TMS high. TRST and
+	 * SRST start deasserted.
+	 */
+	const int jtag_lines[3] = { tck_gpio, tms_gpio, tdi_gpio };
+	memset(&out_values, 0, sizeof(out_values));
+	out_values.values[OUT_TMS] = 1;
+	out_fd = linuxgpio_request(jtag_lines, out_values.values, 3,
+			GPIOHANDLE_REQUEST_OUTPUT, "jtag");
+	if (out_fd < 0)
+		goto out_error;
+
+	in_fd = linuxgpio_request(&tdo_gpio, NULL, 1, GPIOHANDLE_REQUEST_INPUT, "tdo");
+	if (in_fd < 0)
+		goto out_error;
+
+	if (trst_gpio >= 0)
+		lines[rst_count++] = trst_gpio;
+	if (srst_gpio >= 0) {
+		srst_index = rst_count;
+		lines[rst_count++] = srst_gpio;
+	}
+	memset(&rst_values, 0, sizeof(rst_values));
+	rst_fd = linuxgpio_request(lines, rst_values.values, rst_count,
+			GPIOHANDLE_REQUEST_OUTPUT | GPIOHANDLE_REQUEST_ACTIVE_LOW, "reset");
+	if (rst_fd < 0)
+		goto out_error;
+
+	return ERROR_OK;
+
+out_error:
+	cleanup_all_fds();
+	return ERROR_JTAG_INIT_FAILED;
+}
+
+static int linuxgpio_quit(void)
+{
+	cleanup_all_fds();
+	return ERROR_OK;
+}
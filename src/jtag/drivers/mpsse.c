@@ -64,6 +64,26 @@
 #define SIO_RESET_PURGE_RX 1
 #define SIO_RESET_PURGE_TX 2
 
+/* Number of flushes that may be on the wire at once while the next one
+ * is being built */
+#define MPSSE_XFERS 4
+
+struct mpsse_ctx;
+
+/* The buffers of one flush, owned by the USB engine while in flight */
+struct mpsse_xfer {
+	struct mpsse_ctx *ctx;
+	uint8_t *write_buffer;
+	unsigned write_count;
+	unsigned write_transferred;
+	bool write_done;
+	uint8_t *read_buffer;
+	unsigned read_count;
+	unsigned read_transferred;
+	struct bit_copy_queue read_queue;
+	struct libusb_transfer *write_transfer;
+};
+
 struct mpsse_ctx {
 	libusb_context *usb_ctx;
 	libusb_device_handle *usb_dev;
@@ -85,6 +105,15 @@ struct mpsse_ctx {
 	unsigned read_chunk_size;
 	struct bit_copy_queue read_queue;
 	int retval;
+	/* flushes on the wire, oldest first, in a ring */
+	struct mpsse_xfer xfers[MPSSE_XFERS];
+	unsigned xfer_first;
+	unsigned xfer_count;
+	/* a single IN transfer serves all flushes in order, as the chip
+	 * returns their data back to back */
+	struct libusb_transfer *read_transfer;
+	bool read_active;
+	bool cancelling;
 };
 
 /* Returns true if the string descriptor indexed by str_index in device matches string */
@@ -339,6 +368,20 @@ struct mpsse_ctx *mpsse_open(const uint16_t *vid, const uint16_t *pid, const cha
 	if (!ctx->read_chunk || !ctx->read_buffer || !ctx->write_buffer)
 		goto error;
 
+	for (unsigned i = 0; i < MPSSE_XFERS; i++) {
+		struct mpsse_xfer *x = &ctx->xfers[i];
+		x->ctx = ctx;
+		bit_copy_queue_init(&x->read_queue);
+		x->read_buffer = malloc(ctx->read_size);
+		x->write_buffer = malloc(ctx->write_size);
+		x->write_transfer = libusb_alloc_transfer(0);
+		if (!x->read_buffer || !x->write_buffer || !x->write_transfer)
+			goto error;
+	}
+	ctx->read_transfer = libusb_alloc_transfer(0);
+	if (!ctx->read_transfer)
+		goto error;
+
 	ctx->interface = channel;
 	ctx->index = channel + 1;
 	ctx->usb_read_timeout = 5000;
@@ -407,6 +450,17 @@ void mpsse_close(struct mpsse_ctx *ctx)
 		free(ctx->read_buffer);
 	if (ctx->read_chunk)
 		free(ctx->read_chunk);
+	for (unsigned i = 0; i < MPSSE_XFERS; i++) {
+		struct mpsse_xfer *x = &ctx->xfers[i];
+		if (x->ctx)
+			bit_copy_discard(&x->read_queue);
+		free(x->write_buffer);
+		free(x->read_buffer);
+		if (x->write_transfer)
+			libusb_free_transfer(x->write_transfer);
+	}
+	if (ctx->read_transfer)
+		libusb_free_transfer(ctx->read_transfer);
 
 	free(ctx);
 }
@@ -439,6 +493,8 @@ void mpsse_purge(struct mpsse_ctx *ctx)
 	}
 }
 
+static int mpsse_flush_async(struct mpsse_ctx *ctx);
+
 static unsigned buffer_write_space(struct mpsse_ctx *ctx)
 {
 	/* Reserve one byte for SEND_IMMEDIATE */
@@ -511,7 +567,7 @@ void mpsse_clock_data(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_of
 		/* Guarantee buffer space enough for a minimum size transfer */
 		if (buffer_write_space(ctx) + (length < 8) < (out || (!out && !in) ? 4 : 3)
 				|| (in && buffer_read_space(ctx) < 1))
-			ctx->retval = mpsse_flush(ctx);
+			ctx->retval = mpsse_flush_async(ctx);
 
 		if (length < 8) {
 			/* Transfer remaining bits in bit mode */
@@ -585,7 +641,7 @@ void mpsse_clock_tms_cs(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_
 	while (length > 0) {
 		/* Guarantee buffer space enough for a minimum size transfer */
 		if (buffer_write_space(ctx) < 3 || (in && buffer_read_space(ctx) < 1))
-			ctx->retval = mpsse_flush(ctx);
+			ctx->retval = mpsse_flush_async(ctx);
 
 		/* Byte transfer */
 		unsigned this_bits = length;
@@ -618,6 +674,145 @@ void mpsse_clock_tms_cs(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_
 	}
 }
 
+/* Shifts length bits from/to byte aligned buffers and leaves the shift
+ * state on the last one, then clocks one more TMS low cycle; i.e. what
+ * a JTAG driver does for the last field of a scan, which is short in the
+ * common case.  Space is checked once and the commands are emitted
+ * straight, using the generic encoders only when the data can not fit
+ * in one flush. */
+void mpsse_clock_data_exit(struct mpsse_ctx *ctx, const uint8_t *out, uint8_t *in,
+	unsigned length, uint8_t mode)
+{
+	DEBUG_IO("%s%s %d bits", in ? "in" : "", out ? "out" : "", length);
+	assert(length > 0);
+
+	unsigned bytes = (length - 1) / 8;
+	unsigned bits = (length - 1) % 8;
+	bool last_bit = out && (out[(length - 1) / 8] >> ((length - 1) % 8)) & 1;
+	uint8_t tms_bits = 0x01;
+
+	/* byte, bit and two TMS commands */
+	unsigned write_needed = bytes + 12;
+	unsigned read_needed = bytes + 2;
+
+	if (bytes > 65536 || write_needed + 1 > ctx->write_size || read_needed > ctx->read_size) {
+		mpsse_clock_data(ctx, out, 0, in, 0, length - 1, mode);
+		mpsse_clock_tms_cs(ctx, &tms_bits, 0, in, length - 1, 1, last_bit, mode);
+		mpsse_clock_tms_cs_out(ctx, &tms_bits, 1, 1, last_bit, mode);
+		return;
+	}
+
+	if (ctx->retval != ERROR_OK) {
+		DEBUG_IO("Ignoring command due to previous error");
+		return;
+	}
+
+	if (buffer_write_space(ctx) < write_needed || (in && buffer_read_space(ctx) < read_needed))
+		ctx->retval = mpsse_flush_async(ctx);
+
+	uint8_t data_mode = mode;
+	if (out || !in)
+		data_mode |= 0x10;
+	if (in)
+		data_mode |= 0x20;
+
+	if (bytes > 0) {
+		buffer_write_byte(ctx, data_mode);
+		buffer_write_byte(ctx, (bytes - 1) & 0xff);
+		buffer_write_byte(ctx, (bytes - 1) >> 8);
+		if (out)
+			memcpy(ctx->write_buffer + ctx->write_count, out, bytes);
+		else if (!in)
+			memset(ctx->write_buffer + ctx->write_count, 0, bytes);
+		if (out || !in)
+			ctx->write_count += bytes;
+		if (in)
+			buffer_add_read(ctx, in, 0, bytes * 8, 0);
+	}
+
+	if (bits > 0) {
+		buffer_write_byte(ctx, 0x02 | data_mode);
+		buffer_write_byte(ctx, bits - 1);
+		if (out || !in)
+			buffer_write_byte(ctx, out ? out[bytes] : 0x00);
+		if (in)
+			buffer_add_read(ctx, in, bytes * 8, bits, 8 - bits);
+	}
+
+	/* last bit with TMS high, then TMS low with TDI held */
+	buffer_write_byte(ctx, mode | 0x42 | (in ? 0x20 : 0x00));
+	buffer_write_byte(ctx, 0);
+	buffer_write_byte(ctx, tms_bits | (last_bit ? 0x80 : 0x00));
+	if (in)
+		buffer_add_read(ctx, in, length - 1, 1, 7);
+
+	buffer_write_byte(ctx, mode | 0x42);
+	buffer_write_byte(ctx, 0);
+	buffer_write_byte(ctx, last_bit ? 0x80 : 0x00);
+}
+
+/* Clocks length cycles without transferring data; TDI and TMS keep their
+ * levels.  Only the high speed chips have these commands. */
+int mpsse_clock_idle(struct mpsse_ctx *ctx, unsigned length)
+{
+	DEBUG_IO("%d cycles", length);
+
+	if (!mpsse_is_high_speed(ctx))
+		return ERROR_FAIL;
+
+	if (ctx->retval != ERROR_OK) {
+		DEBUG_IO("Ignoring command due to previous error");
+		return ERROR_OK;
+	}
+
+	while (length >= 8) {
+		unsigned bytes = MIN(length / 8, 65536);
+
+		if (buffer_write_space(ctx) < 3)
+			ctx->retval = mpsse_flush_async(ctx);
+
+		buffer_write_byte(ctx, 0x8f);
+		buffer_write_byte(ctx, (bytes - 1) & 0xff);
+		buffer_write_byte(ctx, (bytes - 1) >> 8);
+		length -= bytes * 8;
+	}
+
+	if (length) {
+		if (buffer_write_space(ctx) < 2)
+			ctx->retval = mpsse_flush_async(ctx);
+
+		buffer_write_byte(ctx, 0x8e);
+		buffer_write_byte(ctx, length - 1);
+	}
+
+	return ERROR_OK;
+}
+
+/* Appends pre-encoded MPSSE commands, which must return exactly in_len
+ * bytes; these are copied to in unchanged, i.e. the caller decodes the
+ * bit layout of partial byte reads itself.  The commands are never split
+ * across flushes. */
+void mpsse_queue_raw(struct mpsse_ctx *ctx, const uint8_t *cmds, unsigned cmd_len,
+	uint8_t *in, unsigned in_len)
+{
+	DEBUG_IO("%d bytes, %d in", cmd_len, in_len);
+	assert(cmd_len + 1 <= ctx->write_size && in_len <= ctx->read_size);
+	assert(in_len == 0 || in);
+
+	if (ctx->retval != ERROR_OK) {
+		DEBUG_IO("Ignoring command due to previous error");
+		return;
+	}
+
+	if (buffer_write_space(ctx) < cmd_len || buffer_read_space(ctx) < in_len)
+		ctx->retval = mpsse_flush_async(ctx);
+
+	memcpy(ctx->write_buffer + ctx->write_count, cmds, cmd_len);
+	ctx->write_count += cmd_len;
+	if (in_len)
+		buffer_add_read(ctx, in, 0, in_len * 8, 0);
+}
+
 void mpsse_set_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t dir)
 {
 	DEBUG_IO("-");
@@ -628,7 +823,7 @@ void mpsse_set_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t d
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_flush_async(ctx);
 
 	buffer_write_byte(ctx, 0x80);
 	buffer_write_byte(ctx, data);
@@ -645,7 +840,7 @@ void mpsse_set_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_flush_async(ctx);
 
 	buffer_write_byte(ctx, 0x82);
 	buffer_write_byte(ctx, data);
@@ -662,7 +857,7 @@ void mpsse_read_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t *data)
 	}
 
 	if (buffer_write_space(ctx) < 1 || buffer_read_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_flush_async(ctx);
 
 	buffer_write_byte(ctx, 0x81);
 	buffer_add_read(ctx, data, 0, 8, 0);
@@ -678,7 +873,7 @@ void mpsse_read_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t *data)
 	}
 
 	if (buffer_write_space(ctx) < 1 || buffer_read_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_flush_async(ctx);
 
 	buffer_write_byte(ctx, 0x83);
 	buffer_add_read(ctx, data, 0, 8, 0);
@@ -693,7 +888,7 @@ static void single_byte_boolean_helper(struct mpsse_ctx *ctx, bool var, uint8_t
 	}
 
 	if (buffer_write_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_flush_async(ctx);
 
 	buffer_write_byte(ctx, var ? val_if_true : val_if_false);
 }
@@ -714,7 +909,7 @@ void mpsse_set_divisor(struct mpsse_ctx *ctx, uint16_t divisor)
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_flush_async(ctx);
 
 	buffer_write_byte(ctx, 0x86);
 	buffer_write_byte(ctx, divisor & 0xff);
@@ -774,80 +969,164 @@ int mpsse_set_frequency(struct mpsse_ctx *ctx, int frequency)
 	return frequency;
 }
 
-/* Context needed by the callbacks */
-struct transfer_result {
-	struct mpsse_ctx *ctx;
-	bool done;
-	unsigned transferred;
-};
+static struct mpsse_xfer *mpsse_xfer_at(struct mpsse_ctx *ctx, unsigned i)
+{
+	return &ctx->xfers[(ctx->xfer_first + i) % MPSSE_XFERS];
+}
+
+/* Oldest flush on the wire still waiting for read data, if any */
+static struct mpsse_xfer *mpsse_read_pending(struct mpsse_ctx *ctx)
+{
+	for (unsigned i = 0; i < ctx->xfer_count; i++) {
+		struct mpsse_xfer *x = mpsse_xfer_at(ctx, i);
+		if (x->read_transferred < x->read_count)
+			return x;
+	}
+	return NULL;
+}
 
 static LIBUSB_CALL void read_cb(struct libusb_transfer *transfer)
 {
-	struct transfer_result *res = transfer->user_data;
-	struct mpsse_ctx *ctx = res->ctx;
+	struct mpsse_ctx *ctx = transfer->user_data;
 
 	unsigned packet_size = ctx->max_packet_size;
 
 	DEBUG_PRINT_BUF(transfer->buffer, transfer->actual_length);
 
 	/* Strip the two status bytes sent at the beginning of each USB packet
-	 * while copying the chunk buffer to the read buffer */
+	 * while copying the chunk buffer to the read buffers; data for one
+	 * flush may be directly followed by data for the next */
 	unsigned num_packets = DIV_ROUND_UP(transfer->actual_length, packet_size);
 	unsigned chunk_remains = transfer->actual_length;
 	for (unsigned i = 0; i < num_packets && chunk_remains > 2; i++) {
 		unsigned this_size = packet_size - 2;
 		if (this_size > chunk_remains - 2)
 			this_size = chunk_remains - 2;
-		if (this_size > ctx->read_count - res->transferred)
-			this_size = ctx->read_count - res->transferred;
-		memcpy(ctx->read_buffer + res->transferred,
-			ctx->read_chunk + packet_size * i + 2,
-			this_size);
-		res->transferred += this_size;
 		chunk_remains -= this_size + 2;
-		if (res->transferred == ctx->read_count) {
-			res->done = true;
-			break;
+
+		uint8_t *src = ctx->read_chunk + packet_size * i + 2;
+		while (this_size > 0) {
+			struct mpsse_xfer *x = mpsse_read_pending(ctx);
+			if (!x)
+				break;
+			unsigned n = MIN(this_size, x->read_count - x->read_transferred);
+			memcpy(x->read_buffer + x->read_transferred, src, n);
+			x->read_transferred += n;
+			src += n;
+			this_size -= n;
 		}
 	}
 
-	DEBUG_IO("raw chunk %d, transferred %d of %d", transfer->actual_length, res->transferred,
-		ctx->read_count);
+	DEBUG_IO("raw chunk %d", transfer->actual_length);
 
-	if (!res->done)
-		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS)
-			res->done = true;
+	if (!ctx->cancelling && mpsse_read_pending(ctx))
+		if (libusb_submit_transfer(transfer) == LIBUSB_SUCCESS)
+			return;
+	ctx->read_active = false;
 }
 
 static LIBUSB_CALL void write_cb(struct libusb_transfer *transfer)
 {
-	struct transfer_result *res = transfer->user_data;
-	struct mpsse_ctx *ctx = res->ctx;
+	struct mpsse_xfer *x = transfer->user_data;
 
-	res->transferred += transfer->actual_length;
+	x->write_transferred += transfer->actual_length;
 
-	DEBUG_IO("transferred %d of %d", res->transferred, ctx->write_count);
+	DEBUG_IO("transferred %d of %d", x->write_transferred, x->write_count);
 
 	DEBUG_PRINT_BUF(transfer->buffer, transfer->actual_length);
 
-	if (res->transferred == ctx->write_count)
-		res->done = true;
+	if (x->write_transferred == x->write_count || x->ctx->cancelling)
+		x->write_done = true;
 	else {
-		transfer->length = ctx->write_count - res->transferred;
-		transfer->buffer = ctx->write_buffer + res->transferred;
+		transfer->length = x->write_count - x->write_transferred;
+		transfer->buffer = x->write_buffer + x->write_transferred;
 		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS)
-			res->done = true;
+			x->write_done = true;
 	}
 }
 
-int mpsse_flush(struct mpsse_ctx *ctx)
+static bool mpsse_xfer_done(struct mpsse_xfer *x)
+{
+	/* reads stop early only when the IN transfer failed */
+	return x->write_done &&
+		(x->read_transferred == x->read_count || !x->ctx->read_active);
+}
+
+/* Cancels everything on the wire and resets the chip's FIFOs */
+static void mpsse_abort(struct mpsse_ctx *ctx)
+{
+	ctx->cancelling = true;
+	for (unsigned i = 0; i < ctx->xfer_count; i++) {
+		struct mpsse_xfer *x = mpsse_xfer_at(ctx, i);
+		if (!x->write_done)
+			libusb_cancel_transfer(x->write_transfer);
+	}
+	if (ctx->read_active)
+		libusb_cancel_transfer(ctx->read_transfer);
+
+	for (unsigned i = 0; i < ctx->xfer_count; i++) {
+		struct mpsse_xfer *x = mpsse_xfer_at(ctx, i);
+		while (!x->write_done || ctx->read_active)
+			if (libusb_handle_events(ctx->usb_ctx) != LIBUSB_SUCCESS)
+				break;
+		bit_copy_discard(&x->read_queue);
+	}
+	ctx->xfer_count = 0;
+	ctx->read_active = false;
+	ctx->cancelling = false;
+
+	mpsse_purge(ctx);
+}
+
+/* Waits for the oldest flush on the wire and delivers its read data */
+static int mpsse_complete_oldest(struct mpsse_ctx *ctx)
+{
+	struct mpsse_xfer *x = mpsse_xfer_at(ctx, 0);
+	int retval = LIBUSB_SUCCESS;
+
+	/* Polling loop, more or less taken from libftdi */
+	while (!mpsse_xfer_done(x)) {
+		retval = libusb_handle_events(ctx->usb_ctx);
+		keep_alive();
+		if (retval != LIBUSB_SUCCESS && retval != LIBUSB_ERROR_INTERRUPTED)
+			break;
+	}
+
+	if (retval != LIBUSB_SUCCESS && retval != LIBUSB_ERROR_INTERRUPTED) {
+		LOG_ERROR("libusb_handle_events() failed with %s", libusb_error_name(retval));
+	} else if (x->write_transferred < x->write_count) {
+		LOG_ERROR("ftdi device did not accept all data: %d, tried %d",
+			x->write_transferred,
+			x->write_count);
+	} else if (x->read_transferred < x->read_count) {
+		LOG_ERROR("ftdi device did not return all data: %d, expected %d",
+			x->read_transferred,
+			x->read_count);
+	} else {
+		if (x->read_count)
+			bit_copy_execute(&x->read_queue);
+		else
+			bit_copy_discard(&x->read_queue);
+		ctx->xfer_first = (ctx->xfer_first + 1) % MPSSE_XFERS;
+		ctx->xfer_count--;
+		return ERROR_OK;
+	}
+
+	mpsse_abort(ctx);
+	return ERROR_FAIL;
+}
+
+/* Puts the buffered commands on the wire and hands their buffers to the
+ * engine, blocking only while every transfer buffer is in flight. */
+static int mpsse_flush_async(struct mpsse_ctx *ctx)
 {
 	int retval = ctx->retval;
 
 	if (retval != ERROR_OK) {
 		DEBUG_IO("Ignoring flush due to previous error");
-		assert(ctx->write_count == 0 && ctx->read_count == 0);
-		ctx->retval = ERROR_OK;
+		ctx->write_count = 0;
+		ctx->read_count = 0;
+		bit_copy_discard(&ctx->read_queue);
 		return retval;
 	}
 
@@ -858,73 +1137,59 @@ int mpsse_flush(struct mpsse_ctx *ctx)
 	if (ctx->write_count == 0)
 		return retval;
 
-	struct libusb_transfer *read_transfer = 0;
-	struct transfer_result read_result = { .ctx = ctx, .done = true };
-	if (ctx->read_count) {
-		buffer_write_byte(ctx, 0x87); /* SEND_IMMEDIATE */
-		read_result.done = false;
-		/* delay read transaction to ensure the FTDI chip can support us with data
-		   immediately after processing the MPSSE commands in the write transaction */
+	if (ctx->xfer_count == MPSSE_XFERS) {
+		retval = mpsse_complete_oldest(ctx);
+		if (retval != ERROR_OK)
+			return retval;
 	}
 
-	struct transfer_result write_result = { .ctx = ctx, .done = false };
-	struct libusb_transfer *write_transfer = libusb_alloc_transfer(0);
-	libusb_fill_bulk_transfer(write_transfer, ctx->usb_dev, ctx->out_ep, ctx->write_buffer,
-		ctx->write_count, write_cb, &write_result, ctx->usb_write_timeout);
-	retval = libusb_submit_transfer(write_transfer);
+	if (ctx->read_count)
+		buffer_write_byte(ctx, 0x87); /* SEND_IMMEDIATE */
 
-	if (ctx->read_count) {
-		read_transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(read_transfer, ctx->usb_dev, ctx->in_ep, ctx->read_chunk,
-			ctx->read_chunk_size, read_cb, &read_result,
+	/* swap the filled buffers for the idle ones of the transfer slot */
+	struct mpsse_xfer *x = mpsse_xfer_at(ctx, ctx->xfer_count);
+	uint8_t *buf = x->write_buffer;
+	x->write_buffer = ctx->write_buffer;
+	ctx->write_buffer = buf;
+	buf = x->read_buffer;
+	x->read_buffer = ctx->read_buffer;
+	ctx->read_buffer = buf;
+	list_splice_tail_init(&ctx->read_queue.list, &x->read_queue.list);
+
+	x->write_count = ctx->write_count;
+	x->write_transferred = 0;
+	x->write_done = false;
+	x->read_count = ctx->read_count;
+	x->read_transferred = 0;
+	ctx->write_count = 0;
+	ctx->read_count = 0;
+	ctx->xfer_count++;
+
+	libusb_fill_bulk_transfer(x->write_transfer, ctx->usb_dev, ctx->out_ep, x->write_buffer,
+		x->write_count, write_cb, x, ctx->usb_write_timeout);
+	if (libusb_submit_transfer(x->write_transfer) != LIBUSB_SUCCESS)
+		x->write_done = true;
+
+	/* the IN transfer is (re)started once reads are expected; it was
+	 * queued after the write so the FTDI chip can answer right away */
+	if (x->read_count && !ctx->read_active) {
+		libusb_fill_bulk_transfer(ctx->read_transfer, ctx->usb_dev, ctx->in_ep,
+			ctx->read_chunk, ctx->read_chunk_size, read_cb, ctx,
 			ctx->usb_read_timeout);
-		retval = libusb_submit_transfer(read_transfer);
+		if (libusb_submit_transfer(ctx->read_transfer) == LIBUSB_SUCCESS)
+			ctx->read_active = true;
 	}
 
-	/* Polling loop, more or less taken from libftdi */
-	while (!write_result.done || !read_result.done) {
-		retval = libusb_handle_events(ctx->usb_ctx);
-		keep_alive();
-		if (retval != LIBUSB_SUCCESS && retval != LIBUSB_ERROR_INTERRUPTED) {
-			libusb_cancel_transfer(write_transfer);
-			if (read_transfer)
-				libusb_cancel_transfer(read_transfer);
-			while (!write_result.done || !read_result.done)
-				if (libusb_handle_events(ctx->usb_ctx) != LIBUSB_SUCCESS)
-					break;
-		}
-	}
-
-	if (retval != LIBUSB_SUCCESS) {
-		LOG_ERROR("libusb_handle_events() failed with %s", libusb_error_name(retval));
-		retval = ERROR_FAIL;
-	} else if (write_result.transferred < ctx->write_count) {
-		LOG_ERROR("ftdi device did not accept all data: %d, tried %d",
-			write_result.transferred,
-			ctx->write_count);
-		retval = ERROR_FAIL;
-	} else if (read_result.transferred < ctx->read_count) {
-		LOG_ERROR("ftdi device did not return all data: %d, expected %d",
-			read_result.transferred,
-			ctx->read_count);
-		retval = ERROR_FAIL;
-	} else if (ctx->read_count) {
-		ctx->write_count = 0;
-		ctx->read_count = 0;
-		bit_copy_execute(&ctx->read_queue);
-		retval = ERROR_OK;
-	} else {
-		ctx->write_count = 0;
-		bit_copy_discard(&ctx->read_queue);
-		retval = ERROR_OK;
-	}
+	return ERROR_OK;
+}
 
-	libusb_free_transfer(write_transfer);
-	if (read_transfer)
-		libusb_free_transfer(read_transfer);
+int mpsse_flush(struct mpsse_ctx *ctx)
+{
+	int retval = mpsse_flush_async(ctx);
 
-	if (retval != ERROR_OK)
-		mpsse_purge(ctx);
+	while (retval == ERROR_OK && ctx->xfer_count)
+		retval = mpsse_complete_oldest(ctx);
 
+	ctx->retval = ERROR_OK;
 	return retval;
 }
@@ -58,6 +58,11 @@ void mpsse_clock_tms_cs_out(struct mpsse_ctx *ctx, const uint8_t *out, unsigned
 			   unsigned length, bool tdi, uint8_t mode);
 void mpsse_clock_tms_cs(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_offset, uint8_t *in,
 		       unsigned in_offset, unsigned length, bool tdi, uint8_t mode);
+void mpsse_clock_data_exit(struct mpsse_ctx *ctx, const uint8_t *out, uint8_t *in,
+			   unsigned length, uint8_t mode);
+int mpsse_clock_idle(struct mpsse_ctx *ctx, unsigned length);
+void mpsse_queue_raw(struct mpsse_ctx *ctx, const uint8_t *cmds, unsigned cmd_len,
+		     uint8_t *in, unsigned in_len);
 void mpsse_set_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t dir);
 void mpsse_set_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t dir);
 void mpsse_read_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t *data);
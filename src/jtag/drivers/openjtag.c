@@ -93,7 +93,14 @@ static FT_HANDLE ftdih;
 static struct ftdi_context ftdic;
 #endif
 
+/* Commands are sent OPENJTAG_BUFFER_SIZE bytes at a time, and only the
+ * TDO bytes of scans come back.  Those are read once the queue has been
+ * sent, but no more than OPENJTAG_MAX_PENDING_RX may be outstanding: the
+ * CPLD stalls when the FT245 FIFO towards the host is full, and then
+ * doesn't take commands anymore either.
+ */
 #define OPENJTAG_BUFFER_SIZE        504
+#define OPENJTAG_MAX_PENDING_RX     256
 #define OPENJTAG_MAX_PENDING_RESULTS    256
 
 struct openjtag_scan_result {
@@ -106,7 +113,8 @@ struct openjtag_scan_result {
 static int usb_tx_buf_offs;
 static uint8_t usb_tx_buf[OPENJTAG_BUFFER_SIZE];
 static uint32_t usb_rx_buf_len;
-static uint8_t usb_rx_buf[OPENJTAG_BUFFER_SIZE];
+static uint32_t usb_rx_expected;	/* TDO bytes of the queued scans */
+static uint8_t usb_rx_buf[OPENJTAG_MAX_PENDING_RX];
 
 /* Pending readings */
 static struct openjtag_scan_result openjtag_scan_result_buffer[OPENJTAG_MAX_PENDING_RESULTS];
@@ -345,6 +353,7 @@ static int openjtag_init(void)
 
 usb_tx_buf_offs = 0;
 usb_rx_buf_len = 0;
+usb_rx_expected = 0;
 openjtag_scan_result_count = 0;
 
 #if BUILD_OPENJTAG_FTD2XX == 1
@@ -504,12 +513,13 @@ static int openjtag_quit(void)
 	return ERROR_OK;
 }
 
+/* sends the commands, their results are read by openjtag_execute_tap_queue() */
 static void openjtag_write_tap_buffer(void)
 {
-	uint32_t written;
+	uint32_t written = 0;
 
-	openjtag_buf_write(usb_tx_buf, usb_tx_buf_offs, &written);
-	openjtag_buf_read(usb_rx_buf, usb_tx_buf_offs, &usb_rx_buf_len);
+	if (usb_tx_buf_offs)
+		openjtag_buf_write(usb_tx_buf, usb_tx_buf_offs, &written);
 
 	usb_tx_buf_offs = 0;
 }
@@ -518,6 +528,20 @@ static int openjtag_execute_tap_queue(void)
 {
 	openjtag_write_tap_buffer();
 
+	/* exactly the TDO bytes, asking for more only waits for the timeout */
+	uint32_t expected = MIN(usb_rx_expected, sizeof(usb_rx_buf));
+	int retval = ERROR_OK;
+
+	usb_rx_buf_len = 0;
+	if (expected)
+		openjtag_buf_read(usb_rx_buf, expected, &usb_rx_buf_len);
+	if (usb_rx_buf_len < usb_rx_expected) {
+		LOG_ERROR("openjtag: got %" PRIu32 " of %" PRIu32 " TDO bytes",
+				usb_rx_buf_len, usb_rx_expected);
+		retval = ERROR_JTAG_DEVICE_ERROR;
+	}
+	usb_rx_expected = 0;
+
 	int res_count = 0;
 
 	if (openjtag_scan_result_count && usb_rx_buf_len) {
@@ -566,16 +590,16 @@ static int openjtag_execute_tap_queue(void)
 
 	openjtag_scan_result_count = 0;
 
-	return ERROR_OK;
+	return retval;
 }
 
 static void openjtag_add_byte(char buf)
 {
 
+	/* a full buffer is sent right away, its results stay pending */
 	if (usb_tx_buf_offs == OPENJTAG_BUFFER_SIZE) {
-		DEBUG_JTAG_IO("Forcing execute_tap_queue");
 		DEBUG_JTAG_IO("TX Buff offs=%d", usb_tx_buf_offs);
-		openjtag_execute_tap_queue();
+		openjtag_write_tap_buffer();
 	}
 
 	usb_tx_buf[usb_tx_buf_offs] = buf;
@@ -585,13 +609,16 @@ static void openjtag_add_byte(char buf)
 static void openjtag_add_scan(uint8_t *buffer, int length, struct scan_command *scan_cmd)
 {
 
-	/* Ensure space to send long chains */
-	/* We add two byte for each eight (or less) bits, one for command, one for data */
-	if (usb_tx_buf_offs + (DIV_ROUND_UP(length, 8) * 2) >= OPENJTAG_BUFFER_SIZE) {
+	/* Collect the pending results first if the device couldn't hold the
+	 * TDO bytes of this scan too.  The commands, two bytes for each eight
+	 * (or less) bits, are split across USB writes as needed. */
+	if (usb_rx_expected + DIV_ROUND_UP(length, 8) > OPENJTAG_MAX_PENDING_RX ||
+			openjtag_scan_result_count == OPENJTAG_MAX_PENDING_RESULTS) {
 		DEBUG_JTAG_IO("Forcing execute_tap_queue from scan");
-		DEBUG_JTAG_IO("TX Buff offs=%d len=%d", usb_tx_buf_offs, DIV_ROUND_UP(length, 8) * 2);
+		DEBUG_JTAG_IO("RX pending=%d len=%d", (int)usb_rx_expected, DIV_ROUND_UP(length, 8));
 		openjtag_execute_tap_queue();
 	}
+	usb_rx_expected += DIV_ROUND_UP(length, 8);
 
 	openjtag_scan_result_buffer[openjtag_scan_result_count].bits = length;
 	openjtag_scan_result_buffer[openjtag_scan_result_count].command = scan_cmd;
@@ -171,6 +171,42 @@ static void parport_write(int tck, int tms, int tdi)
 		parport_write_data();
 }
 
+/* Shift len bits without going through the write()/read() callbacks for
+ * each one. The port states are derived from a base value once, and the
+ * status port is only read when the caller wants TDO.
+ */
+static void parport_write_block(const uint8_t *tms, const uint8_t *tdi,
+		uint8_t *tdo, unsigned len)
+{
+	uint8_t base = dataport_value & ~(cable->TCK_MASK | cable->TMS_MASK | cable->TDI_MASK);
+
+	for (unsigned i = 0; i < len; i++) {
+		uint8_t mask = 1 << (i % 8);
+		uint8_t value = base;
+		int n;
+
+		if (tms && (tms[i / 8] & mask))
+			value |= cable->TMS_MASK;
+		if (tdi && (tdi[i / 8] & mask))
+			value |= cable->TDI_MASK;
+
+		dataport_value = value;
+		for (n = wait_states + 1; n > 0; n--)
+			parport_write_data();
+
+		if (tdo) {
+			if (parport_read())
+				tdo[i / 8] |= mask;
+			else
+				tdo[i / 8] &= ~mask;
+		}
+
+		dataport_value = value | cable->TCK_MASK;
+		for (n = wait_states + 1; n > 0; n--)
+			parport_write_data();
+	}
+}
+
 /* (1) assert or (0) deassert reset lines */
 static void parport_reset(int trst, int srst)
 {
@@ -254,6 +290,7 @@ static int parport_get_giveio_access(void)
 static struct bitbang_interface parport_bitbang = {
 		.read = &parport_read,
 		.write = &parport_write,
+		.write_block = &parport_write_block,
 		.reset = &parport_reset,
 		.blink = &parport_led,
 	};
@@ -135,9 +135,7 @@ static int presto_read(uint8_t *buf, uint32_t size)
 #elif BUILD_PRESTO_LIBFTDI == 1
 	uint32_t ftbytes = 0;
 
-	struct timeval timeout, now;
-	gettimeofday(&timeout, NULL);
-	timeval_add_time(&timeout, 1, 0);	/* one second timeout */
+	int64_t timeout = timeval_ms() + 1000;	/* one second timeout */
 
 	while (ftbytes < size) {
 		presto->retval = ftdi_read_data(&presto->ftdic, buf + ftbytes, size - ftbytes);
@@ -147,9 +145,7 @@ static int presto_read(uint8_t *buf, uint32_t size)
 		}
 		ftbytes += presto->retval;
 
-		gettimeofday(&now, NULL);
-		if ((now.tv_sec > timeout.tv_sec) ||
-				((now.tv_sec == timeout.tv_sec) && (now.tv_usec > timeout.tv_usec)))
+		if (timeval_ms() > timeout)
 			break;
 	}
 #endif
@@ -0,0 +1,539 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <netinet/tcp.h>
+#endif
+#include <jtag/interface.h>
+#include <jtag/commands.h>
+#include <jtag/swd.h>
+#include <jtag/remote_adapter.h>
+#include <transport/transport.h>
+
+/* Driver for the adapter of another OpenOCD, see jtag/remote_adapter.h */
+
+static char *remote_adapter_host;
+static char *remote_adapter_port;
+static int remote_adapter_fd = -1;
+
+/* the request being built, with room for its length word at the start */
+static uint8_t *request;
+static size_t request_len;
+static size_t request_size;
+static bool request_failed;
+
+/* where the values of the queued SWD reads go */
+static uint32_t **swd_reads;
+static unsigned swd_num_reads;
+static unsigned swd_reads_size;
+
+static void remote_adapter_put(const void *data, size_t len)
+{
+	if (request_len + len > request_size) {
+		size_t size = MAX(request_size * 2, request_len + len + 256);
+		uint8_t *buf = realloc(request, size);
+		if (buf == NULL) {
+			request_failed = true;
+			return;
+		}
+		request = buf;
+		request_size = size;
+	}
+	memcpy(request + request_len, data, len);
+	request_len += len;
+}
+
+static void remote_adapter_put_u8(uint8_t value)
+{
+	remote_adapter_put(&value, 1);
+}
+
+static void remote_adapter_put_u32(uint32_t value)
+{
+	uint8_t buf[4];
+
+	h_u32_to_le(buf, value);
+	remote_adapter_put(buf, sizeof(buf));
+}
+
+static void remote_adapter_start(uint8_t type)
+{
+	request_len = 0;
+	request_failed = false;
+	remote_adapter_put_u32(0);
+	remote_adapter_put_u8(type);
+}
+
+static int remote_adapter_send(const uint8_t *data, size_t len)
+{
+	while (len > 0) {
+		int n = write_socket(remote_adapter_fd, data, len);
+		if (n <= 0) {
+			LOG_ERROR("remote_adapter: write failed: %s", strerror(errno));
+			return ERROR_FAIL;
+		}
+		data += n;
+		len -= n;
+	}
+	return ERROR_OK;
+}
+
+static int remote_adapter_recv(uint8_t *data, size_t len)
+{
+	while (len > 0) {
+		int n = read_socket(remote_adapter_fd, data, len);
+		if (n <= 0) {
+			LOG_ERROR("remote_adapter: %s", n == 0 ? "server closed the connection" :
+					strerror(errno));
+			return ERROR_FAIL;
+		}
+		data += n;
+		len -= n;
+	}
+	return ERROR_OK;
+}
+
+/* Send the request and wait for the reply.  Returns the status the server
+ * replied, the reply data is in @a reply, to be freed by the caller. */
+static int remote_adapter_transact(uint8_t **reply, uint32_t *reply_len)
+{
+	uint8_t header[8];
+	int retval;
+
+	*reply = NULL;
+	*reply_len = 0;
+
+	/* the request is gone, whatever happens to it */
+	size_t len = request_len;
+	request_len = 0;
+
+	if (request_failed || len > REMOTE_ADAPTER_MAX_MESSAGE) {
+		LOG_ERROR("remote_adapter: request too large");
+		return ERROR_FAIL;
+	}
+	h_u32_to_le(request, len - 4);
+
+	retval = remote_adapter_send(request, len);
+	if (retval == ERROR_OK)
+		retval = remote_adapter_recv(header, sizeof(header));
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint32_t data_len = le_to_h_u32(header);
+	if (data_len < 4 || data_len > REMOTE_ADAPTER_MAX_MESSAGE) {
+		LOG_ERROR("remote_adapter: invalid reply length %" PRIu32, data_len);
+		return ERROR_FAIL;
+	}
+	data_len -= 4;
+
+	if (data_len > 0) {
+		*reply = malloc(data_len);
+		if (*reply == NULL)
+			return ERROR_FAIL;
+		retval = remote_adapter_recv(*reply, data_len);
+		if (retval != ERROR_OK) {
+			free(*reply);
+			*reply = NULL;
+			return retval;
+		}
+	}
+
+	*reply_len = data_len;
+	return (int32_t)le_to_h_u32(header + 4);
+}
+
+static void remote_adapter_scan(struct scan_command *scan)
+{
+	enum scan_type type = jtag_scan_type(scan);
+	uint8_t *buffer;
+	int num_bits = jtag_build_buffer(scan, &buffer);
+
+	remote_adapter_put_u8(REMOTE_ADAPTER_SCAN);
+	remote_adapter_put_u8(scan->ir_scan);
+	remote_adapter_put_u8(scan->end_state);
+	remote_adapter_put_u8((type & SCAN_IN) != 0);
+	remote_adapter_put_u8((type & SCAN_OUT) != 0);
+	remote_adapter_put_u32(num_bits);
+	if (type & SCAN_OUT)
+		remote_adapter_put(buffer, DIV_ROUND_UP(num_bits, 8));
+	free(buffer);
+
+	tap_set_state(scan->end_state);
+}
+
+static int remote_adapter_swd_run(void);
+
+static int remote_adapter_execute_queue(void)
+{
+	struct jtag_command *cmd;
+	uint8_t *reply;
+	uint32_t reply_len;
+
+	if (jtag_command_queue == NULL)
+		return ERROR_OK;
+
+	/* SWD transfers queued before go first */
+	int retval = remote_adapter_swd_run();
+	if (retval != ERROR_OK)
+		return retval;
+
+	remote_adapter_start(REMOTE_ADAPTER_JTAG);
+
+	for (cmd = jtag_command_queue; cmd != NULL; cmd = cmd->next) {
+		switch (cmd->type) {
+		case JTAG_SCAN:
+			remote_adapter_scan(cmd->cmd.scan);
+			break;
+		case JTAG_TLR_RESET:
+			remote_adapter_put_u8(REMOTE_ADAPTER_TLR);
+			tap_set_state(TAP_RESET);
+			break;
+		case JTAG_RUNTEST:
+			remote_adapter_put_u8(REMOTE_ADAPTER_RUNTEST);
+			remote_adapter_put_u32(cmd->cmd.runtest->num_cycles);
+			remote_adapter_put_u8(cmd->cmd.runtest->end_state);
+			tap_set_state(cmd->cmd.runtest->end_state);
+			break;
+		case JTAG_STABLECLOCKS:
+			remote_adapter_put_u8(REMOTE_ADAPTER_CLOCKS);
+			remote_adapter_put_u32(cmd->cmd.stableclocks->num_cycles);
+			break;
+		case JTAG_PATHMOVE:
+			remote_adapter_put_u8(REMOTE_ADAPTER_PATHMOVE);
+			remote_adapter_put_u32(cmd->cmd.pathmove->num_states);
+			for (int i = 0; i < cmd->cmd.pathmove->num_states; i++)
+				remote_adapter_put_u8(cmd->cmd.pathmove->path[i]);
+			tap_set_state(cmd->cmd.pathmove->path[cmd->cmd.pathmove->num_states - 1]);
+			break;
+		case JTAG_SLEEP:
+			/* the server sleeps in order with the rest of the queue */
+			remote_adapter_put_u8(REMOTE_ADAPTER_SLEEP);
+			remote_adapter_put_u32(cmd->cmd.sleep->us);
+			break;
+		case JTAG_RESET:
+			remote_adapter_put_u8(REMOTE_ADAPTER_RESET);
+			remote_adapter_put_u8(cmd->cmd.reset->trst);
+			remote_adapter_put_u8(cmd->cmd.reset->srst);
+			if (cmd->cmd.reset->trst == 1)
+				tap_set_state(TAP_RESET);
+			break;
+		default:
+			LOG_ERROR("remote_adapter: unsupported JTAG command %d", cmd->type);
+			request_len = 0;
+			return ERROR_FAIL;
+		}
+	}
+
+	retval = remote_adapter_transact(&reply, &reply_len);
+
+	/* hand out the captured data */
+	uint32_t pos = 0;
+	for (cmd = jtag_command_queue; retval == ERROR_OK && cmd != NULL; cmd = cmd->next) {
+		if (cmd->type != JTAG_SCAN || !(jtag_scan_type(cmd->cmd.scan) & SCAN_IN))
+			continue;
+
+		uint32_t len = DIV_ROUND_UP(jtag_scan_size(cmd->cmd.scan), 8);
+		if (reply_len - pos < len) {
+			LOG_ERROR("remote_adapter: short reply");
+			retval = ERROR_FAIL;
+			break;
+		}
+		retval = jtag_read_buffer(reply + pos, cmd->cmd.scan);
+		pos += len;
+	}
+
+	free(reply);
+	return retval;
+}
+
+static int remote_adapter_swd_init(void)
+{
+	return ERROR_OK;
+}
+
+static int remote_adapter_speed(int speed)
+{
+	uint8_t *reply;
+	uint32_t reply_len;
+
+	int retval = remote_adapter_swd_run();
+	if (retval != ERROR_OK)
+		return retval;
+
+	remote_adapter_start(REMOTE_ADAPTER_SPEED);
+	remote_adapter_put_u32(speed);
+
+	retval = remote_adapter_transact(&reply, &reply_len);
+	if (retval == ERROR_OK && reply_len >= 4)
+		LOG_INFO("remote_adapter: server clock %" PRIu32 " kHz", le_to_h_u32(reply));
+	free(reply);
+	return retval;
+}
+
+static int remote_adapter_khz(int khz, int *jtag_speed)
+{
+	*jtag_speed = khz;
+	return ERROR_OK;
+}
+
+static int remote_adapter_speed_div(int speed, int *khz)
+{
+	*khz = speed;
+	return ERROR_OK;
+}
+
+static int_least32_t remote_adapter_swd_frequency(int_least32_t hz)
+{
+	if (hz > 0)
+		remote_adapter_speed(hz / 1000);
+	return hz;
+}
+
+/* SWD operations accumulate in the request until run() */
+static void remote_adapter_swd_queue(void)
+{
+	if (request_len == 0)
+		remote_adapter_start(REMOTE_ADAPTER_SWD);
+}
+
+static int remote_adapter_swd_switch_seq(enum swd_special_seq seq)
+{
+	remote_adapter_swd_queue();
+	remote_adapter_put_u8(REMOTE_ADAPTER_SWD_SEQ);
+	remote_adapter_put_u8(seq);
+	return ERROR_OK;
+}
+
+static void remote_adapter_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_clk)
+{
+	remote_adapter_swd_queue();
+
+	if (swd_num_reads == swd_reads_size) {
+		unsigned size = MAX(swd_reads_size * 2, 64);
+		uint32_t **reads = realloc(swd_reads, size * sizeof(*reads));
+		if (reads == NULL) {
+			request_failed = true;
+			return;
+		}
+		swd_reads = reads;
+		swd_reads_size = size;
+	}
+	swd_reads[swd_num_reads++] = value;
+
+	remote_adapter_put_u8(REMOTE_ADAPTER_SWD_READ);
+	remote_adapter_put_u8(cmd);
+	remote_adapter_put_u32(ap_delay_clk);
+}
+
+static void remote_adapter_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk)
+{
+	remote_adapter_swd_queue();
+	remote_adapter_put_u8(REMOTE_ADAPTER_SWD_WRITE);
+	remote_adapter_put_u8(cmd);
+	remote_adapter_put_u32(value);
+	remote_adapter_put_u32(ap_delay_clk);
+}
+
+static int remote_adapter_swd_run(void)
+{
+	uint8_t *reply;
+	uint32_t reply_len;
+
+	if (request_len == 0)
+		return ERROR_OK;
+
+	int retval = remote_adapter_transact(&reply, &reply_len);
+	if (retval == ERROR_OK && reply_len < swd_num_reads * 4) {
+		LOG_ERROR("remote_adapter: short reply");
+		retval = ERROR_FAIL;
+	}
+	for (unsigned i = 0; retval == ERROR_OK && i < swd_num_reads; i++)
+		if (swd_reads[i])
+			*swd_reads[i] = le_to_h_u32(reply + 4 * i);
+
+	free(reply);
+	swd_num_reads = 0;
+	return retval;
+}
+
+static int remote_adapter_connect(void)
+{
+	struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+	struct addrinfo *result, *rp;
+	int fd = -1;
+
+	LOG_INFO("Connecting to %s:%s",
+			remote_adapter_host ? remote_adapter_host : "localhost",
+			remote_adapter_port);
+
+	int s = getaddrinfo(remote_adapter_host, remote_adapter_port, &hints, &result);
+	if (s != 0) {
+		LOG_ERROR("getaddrinfo: %s", gai_strerror(s));
+		return ERROR_FAIL;
+	}
+
+	for (rp = result; rp != NULL; rp = rp->ai_next) {
+		fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+		if (fd == -1)
+			continue;
+
+		if (connect(fd, rp->ai_addr, rp->ai_addrlen) != -1) {
+			/* every request is a single write followed by a read */
+			int one = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&one, sizeof(one));
+			break;
+		}
+
+		close_socket(fd);
+		fd = -1;
+	}
+
+	freeaddrinfo(result);
+
+	if (fd == -1) {
+		LOG_ERROR("Failed to connect: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
+
+	return fd;
+}
+
+static int remote_adapter_init(void)
+{
+	uint8_t *reply;
+	uint32_t reply_len;
+
+	if (remote_adapter_port == NULL) {
+		LOG_ERROR("remote_adapter_port not set");
+		return ERROR_FAIL;
+	}
+
+	int fd = remote_adapter_connect();
+	if (fd < 0)
+		return fd;
+	remote_adapter_fd = fd;
+
+	remote_adapter_start(REMOTE_ADAPTER_HELLO);
+	remote_adapter_put_u32(REMOTE_ADAPTER_VERSION);
+	remote_adapter_put_u8(transport_is_swd());
+
+	int retval = remote_adapter_transact(&reply, &reply_len);
+	free(reply);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("remote_adapter: the server refused the connection, "
+				"check that it runs the same transport");
+		close_socket(remote_adapter_fd);
+		remote_adapter_fd = -1;
+		return ERROR_FAIL;
+	}
+
+	LOG_INFO("remote_adapter driver initialized");
+	return ERROR_OK;
+}
+
+static int remote_adapter_quit(void)
+{
+	if (remote_adapter_fd >= 0)
+		close_socket(remote_adapter_fd);
+	remote_adapter_fd = -1;
+
+	free(request);
+	request = NULL;
+	request_len = 0;
+	request_size = 0;
+	free(swd_reads);
+	swd_reads = NULL;
+	swd_reads_size = 0;
+	swd_num_reads = 0;
+
+	free(remote_adapter_host);
+	free(remote_adapter_port);
+	remote_adapter_host = NULL;
+	remote_adapter_port = NULL;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(remote_adapter_handle_port_command)
+{
+	uint16_t port;
+
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(u16, CMD_ARGV[0], port);
+	free(remote_adapter_port);
+	remote_adapter_port = strdup(CMD_ARGV[0]);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(remote_adapter_handle_host_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	free(remote_adapter_host);
+	remote_adapter_host = strdup(CMD_ARGV[0]);
+	return ERROR_OK;
+}
+
+static const struct command_registration remote_adapter_command_handlers[] = {
+	{
+		.name = "remote_adapter_port",
+		.handler = remote_adapter_handle_port_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Set the TCP port of the remote adapter server.",
+		.usage = "port_number",
+	},
+	{
+		.name = "remote_adapter_host",
+		.handler = remote_adapter_handle_host_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Set the host of the remote adapter server.",
+		.usage = "host_name",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct swd_driver remote_adapter_swd = {
+	.init = remote_adapter_swd_init,
+	.frequency = remote_adapter_swd_frequency,
+	.switch_seq = remote_adapter_swd_switch_seq,
+	.read_reg = remote_adapter_swd_read_reg,
+	.write_reg = remote_adapter_swd_write_reg,
+	.run = remote_adapter_swd_run,
+};
+
+static const char * const remote_adapter_transports[] = { "jtag", "swd", NULL };
+
+struct jtag_interface remote_adapter_interface = {
+	.name = "remote_adapter",
+	.supported = DEBUG_CAP_QUEUED_SLEEP,
+	.commands = remote_adapter_command_handlers,
+	.transports = remote_adapter_transports,
+	.swd = &remote_adapter_swd,
+
+	.init = remote_adapter_init,
+	.quit = remote_adapter_quit,
+	.speed = remote_adapter_speed,
+	.khz = remote_adapter_khz,
+	.speed_div = remote_adapter_speed_div,
+	.execute_queue = remote_adapter_execute_queue,
+};
@@ -23,6 +23,7 @@
 #ifndef _WIN32
 #include <sys/un.h>
 #include <netdb.h>
+#include <netinet/tcp.h>
 #endif
 #include <jtag/interface.h>
 #include "bitbang.h"
@@ -30,6 +31,11 @@
 /* arbitrary limit on host name length: */
 #define REMOTE_BITBANG_HOST_MAX 255
 
+/* Number of 'R' requests sent before their replies are collected. The
+ * replies are single bytes, so this stays well below any socket buffer
+ * and the remote end can never block on writing them. */
+#define REMOTE_BITBANG_SAMPLE_BUF_SIZE 4096
+
 #define REMOTE_BITBANG_RAISE_ERROR(expr ...) \
 	do { \
 		LOG_ERROR(expr); \
@@ -102,6 +108,17 @@ static int remote_bitbang_read(void)
 	return remote_bitbang_rread();
 }
 
+/* Request a TDO sample; the reply is picked up by remote_bitbang_read_sample() */
+static void remote_bitbang_sample(void)
+{
+	remote_bitbang_putc('R');
+}
+
+static int remote_bitbang_read_sample(void)
+{
+	return remote_bitbang_rread();
+}
+
 static void remote_bitbang_write(int tck, int tms, int tdi)
 {
 	char c = '0' + ((tck ? 0x4 : 0x0) | (tms ? 0x2 : 0x0) | (tdi ? 0x1 : 0x0));
@@ -122,6 +139,9 @@ static void remote_bitbang_blink(int on)
 
 static struct bitbang_interface remote_bitbang_bitbang = {
 	.read = &remote_bitbang_read,
+	.sample = &remote_bitbang_sample,
+	.read_sample = &remote_bitbang_read_sample,
+	.buf_size = REMOTE_BITBANG_SAMPLE_BUF_SIZE,
 	.write = &remote_bitbang_write,
 	.reset = &remote_bitbang_reset,
 	.blink = &remote_bitbang_blink,
@@ -154,8 +174,13 @@ static int remote_bitbang_init_tcp(void)
 		if (fd == -1)
 			continue;
 
-		if (connect(fd, rp->ai_addr, rp->ai_addrlen) != -1)
+		if (connect(fd, rp->ai_addr, rp->ai_addrlen) != -1) {
+			/* requests are flushed only when a reply is needed,
+			 * don't let Nagle delay them any further */
+			int one = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&one, sizeof(one));
 			break; /* Success */
+		}
 
 		close(fd);
 	}
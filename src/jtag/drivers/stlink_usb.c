@@ -1177,14 +1177,16 @@ static int stlink_usb_step(void *handle)
 }
 
 /** */
-static int stlink_usb_read_regs(void *handle)
+static int stlink_usb_read_regs(void *handle, uint32_t *regs)
 {
 	int res;
 	struct stlink_usb_handle_s *h = handle;
+	const uint8_t *data;
 
 	assert(handle != NULL);
 
-	stlink_usb_init_buffer(handle, h->rx_ep, 84);
+	/* API v2 prefixes the 21 words of registers with a status word */
+	stlink_usb_init_buffer(handle, h->rx_ep, h->jtag_api == STLINK_JTAG_API_V1 ? 84 : 88);
 
 	h->cmdbuf[h->cmdidx++] = STLINK_DEBUG_COMMAND;
 	if (h->jtag_api == STLINK_JTAG_API_V1)
@@ -1192,11 +1194,20 @@ static int stlink_usb_read_regs(void *handle)
 	else
 		h->cmdbuf[h->cmdidx++] = STLINK_DEBUG_APIV2_READALLREGS;
 
-	res = stlink_usb_xfer(handle, h->databuf, 84);
+	if (h->jtag_api == STLINK_JTAG_API_V1) {
+		res = stlink_usb_xfer(handle, h->databuf, 84);
+		data = h->databuf;
+	} else {
+		res = stlink_cmd_allow_retry(handle, h->databuf, 88);
+		data = h->databuf + 4;
+	}
 
 	if (res != ERROR_OK)
 		return res;
 
+	for (int i = 0; i < HLA_CORE_REGS; i++)
+		regs[i] = le_to_h_u32(data + 4 * i);
+
 	return ERROR_OK;
 }
 
@@ -1421,6 +1432,103 @@ static uint32_t stlink_max_block_size(uint32_t tar_autoincr_block, uint32_t addr
 	return max_tar_block;
 }
 
+/*
+ * Pipelined 32-bit transfer of len bytes for the V2 API. The firmware only
+ * reports the outcome of its most recent command, so every chunk still needs
+ * its own GETLASTRWSTATUS. That query is sent in the same batch of USB
+ * transfers as the next chunk, though, so the probe always has the next
+ * command queued and no round trip is spent on status alone. A chunk is thus
+ * executed before the status of the previous one is known; on WAIT both are
+ * repeated, which is harmless for memory.
+ */
+static int stlink_usb_mem32_burst(void *handle, bool write, uint32_t addr,
+		uint32_t len, uint8_t *buffer)
+{
+	struct stlink_usb_handle_s *h = handle;
+	uint8_t cmd[STLINK_CMD_SIZE_V2];
+	uint8_t status_cmd[STLINK_CMD_SIZE_V2] = {
+		STLINK_DEBUG_COMMAND, STLINK_DEBUG_APIV2_GETLASTRWSTATUS
+	};
+	uint8_t status[2];
+	struct jtag_xfer xfers[4];
+	int retries = 0;
+	int retval;
+
+	/* chunk sent in the previous batch, still waiting for its status */
+	bool pending = false;
+	uint32_t pending_addr = 0;
+	uint8_t *pending_buffer = NULL;
+
+	assert(handle != NULL);
+
+	while (len || pending) {
+		uint32_t chunk = 0;
+		unsigned n = 0;
+
+		if (pending) {
+			xfers[n].ep = h->tx_ep;
+			xfers[n].buf = status_cmd;
+			xfers[n++].size = sizeof(status_cmd);
+			xfers[n].ep = h->rx_ep;
+			xfers[n].buf = status;
+			xfers[n++].size = sizeof(status);
+		}
+
+		if (len) {
+			chunk = MIN(len, stlink_max_block_size(h->max_mem_packet, addr));
+
+			memset(cmd, 0, sizeof(cmd));
+			cmd[0] = STLINK_DEBUG_COMMAND;
+			cmd[1] = write ? STLINK_DEBUG_WRITEMEM_32BIT : STLINK_DEBUG_READMEM_32BIT;
+			h_u32_to_le(cmd + 2, addr);
+			h_u16_to_le(cmd + 6, chunk);
+
+			xfers[n].ep = h->tx_ep;
+			xfers[n].buf = cmd;
+			xfers[n++].size = sizeof(cmd);
+			xfers[n].ep = write ? h->tx_ep : h->rx_ep;
+			xfers[n].buf = buffer;
+			xfers[n++].size = chunk;
+		}
+
+		retval = jtag_libusb_bulk_transfer_n(h->fd, xfers, n,
+				write ? STLINK_WRITE_TIMEOUT : STLINK_READ_TIMEOUT);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (pending) {
+			h->databuf[0] = status[0];
+			retval = stlink_usb_error_check(h);
+
+			if (retval == ERROR_WAIT && retries < MAX_WAIT_RETRIES) {
+				usleep((1<<retries++) * 1000);
+				len += addr - pending_addr;
+				addr = pending_addr;
+				buffer = pending_buffer;
+				pending = false;
+				continue;
+			}
+			if (retval != ERROR_OK)
+				return retval;
+		}
+
+		pending = chunk != 0;
+		pending_addr = addr;
+		pending_buffer = buffer;
+		addr += chunk;
+		buffer += chunk;
+		len -= chunk;
+	}
+
+	return ERROR_OK;
+}
+
+/* Whether stlink_usb_mem32_burst() may be used with this adapter */
+static bool stlink_usb_can_burst(struct stlink_usb_handle_s *h)
+{
+	return h->version.stlink != 1 && h->jtag_api == STLINK_JTAG_API_V2;
+}
+
 static int stlink_usb_read_mem(void *handle, uint32_t addr, uint32_t size,
 		uint32_t count, uint8_t *buffer)
 {
@@ -1432,6 +1540,20 @@ static int stlink_usb_read_mem(void *handle, uint32_t addr, uint32_t size,
 	/* calculate byte count */
 	count *= size;
 
+	/* aligned words spanning several chunks go through the pipeline */
+	if (size == 4 && addr % 4 == 0 && stlink_usb_can_burst(h) &&
+	    count > stlink_max_block_size(h->max_mem_packet, addr)) {
+		uint32_t burst = count & ~3;
+
+		retval = stlink_usb_mem32_burst(handle, false, addr, burst, buffer);
+		if (retval != ERROR_OK)
+			return retval;
+
+		buffer += burst;
+		addr += burst;
+		count -= burst;
+	}
+
 	while (count) {
 
 		bytes_remaining = (size == 4) ? \
@@ -1502,6 +1624,20 @@ static int stlink_usb_write_mem(void *handle, uint32_t addr, uint32_t size,
 	/* calculate byte count */
 	count *= size;
 
+	/* aligned words spanning several chunks go through the pipeline */
+	if (size == 4 && addr % 4 == 0 && stlink_usb_can_burst(h) &&
+	    count > stlink_max_block_size(h->max_mem_packet, addr)) {
+		uint32_t burst = count & ~3;
+
+		retval = stlink_usb_mem32_burst(handle, true, addr, burst, (uint8_t *)buffer);
+		if (retval != ERROR_OK)
+			return retval;
+
+		buffer += burst;
+		addr += burst;
+		count -= burst;
+	}
+
 	while (count) {
 
 		bytes_remaining = (size == 4) ? \
@@ -1561,6 +1697,115 @@ static int stlink_usb_write_mem(void *handle, uint32_t addr, uint32_t size,
 	return retval;
 }
 
+/* most accesses of one stlink_usb_run_mem_batch() */
+#define STLINK_MEM_BATCH	16
+
+/* Whether a queued access is a single 32-bit command */
+static bool stlink_usb_mem_op_fits(struct stlink_usb_handle_s *h, const struct hl_mem_op *op)
+{
+	return stlink_usb_can_burst(h) && op->size == 4 && op->addr % 4 == 0 &&
+		op->count * 4 <= stlink_max_block_size(h->max_mem_packet, op->addr);
+}
+
+/*
+ * Sends n single command accesses, each followed by its GETLASTRWSTATUS,
+ * in one batch of USB transfers. On WAIT the accesses from the one that
+ * waited on are repeated one by one, like stlink_usb_mem32_burst() does.
+ */
+static int stlink_usb_run_mem_batch(struct stlink_usb_handle_s *h,
+		struct hl_mem_op *ops, unsigned n)
+{
+	uint8_t cmd[STLINK_MEM_BATCH][STLINK_CMD_SIZE_V2];
+	uint8_t status_cmd[STLINK_CMD_SIZE_V2] = {
+		STLINK_DEBUG_COMMAND, STLINK_DEBUG_APIV2_GETLASTRWSTATUS
+	};
+	uint8_t status[STLINK_MEM_BATCH][2];
+	struct jtag_xfer xfers[4 * STLINK_MEM_BATCH];
+	unsigned x = 0;
+	int retval;
+
+	assert(n <= STLINK_MEM_BATCH);
+
+	for (unsigned i = 0; i < n; i++) {
+		uint32_t len = ops[i].count * 4;
+
+		memset(cmd[i], 0, sizeof(cmd[i]));
+		cmd[i][0] = STLINK_DEBUG_COMMAND;
+		cmd[i][1] = ops[i].write ? STLINK_DEBUG_WRITEMEM_32BIT : STLINK_DEBUG_READMEM_32BIT;
+		h_u32_to_le(cmd[i] + 2, ops[i].addr);
+		h_u16_to_le(cmd[i] + 6, len);
+
+		xfers[x].ep = h->tx_ep;
+		xfers[x].buf = cmd[i];
+		xfers[x++].size = sizeof(cmd[i]);
+		xfers[x].ep = ops[i].write ? h->tx_ep : h->rx_ep;
+		xfers[x].buf = ops[i].buffer;
+		xfers[x++].size = len;
+		xfers[x].ep = h->tx_ep;
+		xfers[x].buf = status_cmd;
+		xfers[x++].size = sizeof(status_cmd);
+		xfers[x].ep = h->rx_ep;
+		xfers[x].buf = status[i];
+		xfers[x++].size = sizeof(status[i]);
+	}
+
+	retval = jtag_libusb_bulk_transfer_n(h->fd, xfers, x, STLINK_WRITE_TIMEOUT);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned i = 0; i < n; i++) {
+		h->databuf[0] = status[i][0];
+		retval = stlink_usb_error_check(h);
+		if (retval == ERROR_OK)
+			continue;
+		if (retval != ERROR_WAIT)
+			return retval;
+
+		for (; i < n && retval == ERROR_OK; i++) {
+			if (ops[i].write)
+				retval = stlink_usb_write_mem(h, ops[i].addr, 4,
+						ops[i].count, ops[i].buffer);
+			else
+				retval = stlink_usb_read_mem(h, ops[i].addr, 4,
+						ops[i].count, ops[i].buffer);
+		}
+		return retval;
+	}
+
+	return ERROR_OK;
+}
+
+/* Pipelines runs of single command accesses, the others go one by one */
+static int stlink_usb_run_mem_queue(void *handle, struct hl_mem_op *ops, unsigned count)
+{
+	struct stlink_usb_handle_s *h = handle;
+	int retval = ERROR_OK;
+
+	assert(handle != NULL);
+
+	for (unsigned i = 0; i < count && retval == ERROR_OK; ) {
+		unsigned n = 0;
+
+		while (i + n < count && n < STLINK_MEM_BATCH && stlink_usb_mem_op_fits(h, &ops[i + n]))
+			n++;
+
+		if (n) {
+			retval = stlink_usb_run_mem_batch(h, ops + i, n);
+			i += n;
+		} else {
+			if (ops[i].write)
+				retval = stlink_usb_write_mem(h, ops[i].addr, ops[i].size,
+						ops[i].count, ops[i].buffer);
+			else
+				retval = stlink_usb_read_mem(h, ops[i].addr, ops[i].size,
+						ops[i].count, ops[i].buffer);
+			i++;
+		}
+	}
+
+	return retval;
+}
+
 /** */
 static int stlink_usb_override_target(const char *targetname)
 {
@@ -1847,6 +2092,19 @@ int stlink_config_trace(void *handle, bool enabled, enum tpio_pin_protocol pin_p
 	return stlink_usb_trace_enable(h);
 }
 
+static int stlink_check_trace_freq(void *handle, enum tpio_pin_protocol pin_protocol,
+		unsigned int trace_freq, bool *supported)
+{
+	struct stlink_usb_handle_s *h = handle;
+
+	/* stlink_config_trace() reports these */
+	if (h->jtag_api < 2 || pin_protocol != ASYNC_UART)
+		return ERROR_FAIL;
+
+	*supported = trace_freq > 0 && trace_freq <= STLINK_TRACE_MAX_HZ;
+	return ERROR_OK;
+}
+
 /** */
 struct hl_layout_api_s stlink_usb_layout_api = {
 	/** */
@@ -1878,6 +2136,8 @@ struct hl_layout_api_s stlink_usb_layout_api = {
 	/** */
 	.write_mem = stlink_usb_write_mem,
 	/** */
+	.run_mem_queue = stlink_usb_run_mem_queue,
+	/** */
 	.write_debug_reg = stlink_usb_write_debug_reg,
 	/** */
 	.override_target = stlink_usb_override_target,
@@ -1886,5 +2146,7 @@ struct hl_layout_api_s stlink_usb_layout_api = {
 	/** */
 	.config_trace = stlink_config_trace,
 	/** */
+	.check_trace_freq = stlink_check_trace_freq,
+	/** */
 	.poll_trace = stlink_usb_trace_read,
 };
@@ -51,7 +51,7 @@ struct icdi_usb_handle_s {
 	char *write_buffer;
 	int max_packet;
 	int read_count;
-	uint32_t max_rw_packet; /* max X packet (read/write memory) transfers */
+	uint32_t max_rw_packet; /* max x packet (read memory) transfers */
 };
 
 static int icdi_usb_read_mem(void *handle, uint32_t addr, uint32_t size,
@@ -59,60 +59,77 @@ static int icdi_usb_read_mem(void *handle, uint32_t addr, uint32_t size,
 static int icdi_usb_write_mem(void *handle, uint32_t addr, uint32_t size,
 		uint32_t count, const uint8_t *buffer);
 
-static int remote_escape_output(const char *buffer, int len, char *out_buf, int *out_len, int out_maxlen)
-{
-	int input_index, output_index;
+/* characters that must be escaped in binary packet data */
+static const uint8_t remote_escape_table[256] = {
+	['$'] = 1, ['#'] = 1, ['}'] = 1, ['*'] = 1,
+};
 
-	output_index = 0;
+/* Number of leading bytes of buffer whose escaped form fits in out_maxlen */
+static int remote_escape_fit(const uint8_t *buffer, int len, int out_maxlen)
+{
+	int input_index, output_len = 0;
 
 	for (input_index = 0; input_index < len; input_index++) {
+		output_len += 1 + remote_escape_table[buffer[input_index]];
+		if (output_len > out_maxlen)
+			break;
+	}
 
-		char b = buffer[input_index];
+	return input_index;
+}
 
-		if (b == '$' || b == '#' || b == '}' || b == '*') {
-			/* These must be escaped.  */
-			if (output_index + 2 > out_maxlen)
-				break;
+/* Escape len bytes of buffer into out_buf, which must have room for them,
+ * see remote_escape_fit(). Returns the escaped length. */
+static int remote_escape_output(const uint8_t *buffer, int len, char *out_buf)
+{
+	int output_index = 0;
+
+	for (int input_index = 0; input_index < len; input_index++) {
+		uint8_t b = buffer[input_index];
+
+		if (remote_escape_table[b]) {
 			out_buf[output_index++] = '}';
 			out_buf[output_index++] = b ^ 0x20;
-		} else {
-			if (output_index + 1 > out_maxlen)
-				break;
+		} else
 			out_buf[output_index++] = b;
-		}
 	}
 
-	*out_len = input_index;
 	return output_index;
 }
 
+/* Returns the unescaped length, or -1 if it exceeds out_maxlen */
 static int remote_unescape_input(const char *buffer, int len, char *out_buf, int out_maxlen)
 {
-	int input_index, output_index;
-	int escaped;
+	int input_index = 0, output_index = 0;
 
-	output_index = 0;
-	escaped = 0;
+	while (input_index < len) {
+		/* copy everything up to the next escape at once */
+		const char *escape = memchr(buffer + input_index, '}', len - input_index);
+		int run = (escape ? escape - buffer : len) - input_index;
 
-	for (input_index = 0; input_index < len; input_index++) {
+		if (output_index + run > out_maxlen) {
+			LOG_ERROR("Received too much data from the target.");
+			return -1;
+		}
+		memcpy(out_buf + output_index, buffer + input_index, run);
+		output_index += run;
+		input_index += run;
 
-		char b = buffer[input_index];
+		if (escape == NULL)
+			break;
 
-		if (output_index + 1 > out_maxlen)
+		if (input_index + 1 >= len) {
+			LOG_ERROR("Unmatched escape character in target response.");
+			break;
+		}
+		if (output_index + 1 > out_maxlen) {
 			LOG_ERROR("Received too much data from the target.");
-
-		if (escaped) {
-			out_buf[output_index++] = b ^ 0x20;
-			escaped = 0;
-		} else if (b == '}')
-			escaped = 1;
-		else
-			out_buf[output_index++] = b;
+			return -1;
+		}
+		out_buf[output_index++] = buffer[input_index + 1] ^ 0x20;
+		input_index += 2;
 	}
 
-	if (escaped)
-		LOG_ERROR("Unmatched escape character in target response.");
-
 	return output_index;
 }
 
@@ -469,12 +486,6 @@ static int icdi_usb_step(void *handle)
 	return result;
 }
 
-static int icdi_usb_read_regs(void *handle)
-{
-	/* currently unsupported */
-	return ERROR_OK;
-}
-
 static int icdi_usb_read_reg(void *handle, int num, uint32_t *val)
 {
 	int result;
@@ -556,23 +567,25 @@ static int icdi_usb_read_mem_int(void *handle, uint32_t addr, uint32_t len, uint
 	return ERROR_OK;
 }
 
-static int icdi_usb_write_mem_int(void *handle, uint32_t addr, uint32_t len, const uint8_t *buffer)
+/* Writes as many of the len bytes as fit in one packet once escaped,
+ * their number is returned in written */
+static int icdi_usb_write_mem_int(void *handle, uint32_t addr, uint32_t len,
+		const uint8_t *buffer, uint32_t *written)
 {
 	int result;
 	struct icdi_usb_handle_s *h = handle;
 
-	size_t cmd_len = snprintf(h->write_buffer, h->max_packet, PACKET_START "X%" PRIx32 ",%" PRIx32 ":", addr, len);
-
-	int out_len;
-	cmd_len += remote_escape_output((const char *)buffer, len, h->write_buffer + cmd_len,
-			&out_len, h->max_packet - cmd_len);
-
-	if (out_len < (int)len) {
-		/* for now issue a error as we have no way of allocating a larger buffer */
-		LOG_ERROR("memory buffer too small: requires 0x%x actual 0x%" PRIx32, out_len, len);
+	/* room left by the longest "$X<addr>,<len>:" header and "#xx" */
+	int room = h->max_packet - (int)strlen(PACKET_START "Xffffffff,ffffffff:") - 3;
+	len = remote_escape_fit(buffer, len, room);
+	if (len == 0) {
+		LOG_ERROR("packet buffer too small");
 		return ERROR_FAIL;
 	}
 
+	size_t cmd_len = snprintf(h->write_buffer, h->max_packet, PACKET_START "X%" PRIx32 ",%" PRIx32 ":", addr, len);
+	cmd_len += remote_escape_output(buffer, len, h->write_buffer + cmd_len);
+
 	result = icdi_send_packet(handle, cmd_len);
 	if (result != ERROR_OK)
 		return result;
@@ -584,6 +597,7 @@ static int icdi_usb_write_mem_int(void *handle, uint32_t addr, uint32_t len, con
 		return ERROR_FAIL;
 	}
 
+	*written = len;
 	return ERROR_OK;
 }
 
@@ -619,25 +633,20 @@ static int icdi_usb_write_mem(void *handle, uint32_t addr, uint32_t size,
 		uint32_t count, const uint8_t *buffer)
 {
 	int retval = ERROR_OK;
-	struct icdi_usb_handle_s *h = handle;
-	uint32_t bytes_remaining;
+	uint32_t bytes_written;
 
 	/* calculate byte count */
 	count *= size;
 
+	/* every packet is filled up, however much escaping its data needs */
 	while (count) {
-
-		bytes_remaining = h->max_rw_packet;
-		if (count < bytes_remaining)
-			bytes_remaining = count;
-
-		retval = icdi_usb_write_mem_int(handle, addr, bytes_remaining, buffer);
+		retval = icdi_usb_write_mem_int(handle, addr, count, buffer, &bytes_written);
 		if (retval != ERROR_OK)
 			return retval;
 
-		buffer += bytes_remaining;
-		addr += bytes_remaining;
-		count -= bytes_remaining;
+		buffer += bytes_written;
+		addr += bytes_written;
+		count -= bytes_written;
 	}
 
 	return retval;
@@ -747,10 +756,11 @@ static int icdi_usb_open(struct hl_interface_param_s *param, void **fd)
 
 	*fd = h;
 
-	/* set the max target read/write buffer in bytes
+	/* set the max target read buffer in bytes
 	 * as we are using gdb binary packets to transfer memory we have to
-	 * reserve half the buffer for any possible escape chars plus
-	 * at least 64 bytes for the gdb packet header */
+	 * reserve half the buffer for any possible escape chars in the reply
+	 * plus at least 64 bytes for the gdb packet header; writes escape
+	 * their data first and fill the packet instead */
 	h->max_rw_packet = (((h->max_packet - 64) / 4) * 4) / 2;
 
 	return ERROR_OK;
@@ -771,7 +781,7 @@ struct hl_layout_api_s icdi_usb_layout_api = {
 	.run = icdi_usb_run,
 	.halt = icdi_usb_halt,
 	.step = icdi_usb_step,
-	.read_regs = icdi_usb_read_regs,
+	/* no bulk register read, hla_target falls back to read_reg */
 	.read_reg = icdi_usb_read_reg,
 	.write_reg = icdi_usb_write_reg,
 	.read_mem = icdi_usb_read_mem,
@@ -705,7 +705,7 @@ int ulink_append_queue(struct ulink *device, struct ulink_cmd *ulink_cmd)
 int ulink_execute_queued_commands(struct ulink *device, int timeout)
 {
 	struct ulink_cmd *current;
-	int ret, i, index_out, index_in, count_out, count_in, transferred;
+	int ret, index_out, index_in, count_out, count_in, transferred;
 	uint8_t buffer[64];
 
 #ifdef _DEBUG_JTAG_IO_
@@ -722,8 +722,8 @@ int ulink_execute_queued_commands(struct ulink *device, int timeout)
 		index_out++;
 		count_out++;
 
-		for (i = 0; i < current->payload_out_size; i++)
-			buffer[index_out + i] = current->payload_out[i];
+		if (current->payload_out_size > 0)
+			memcpy(buffer + index_out, current->payload_out, current->payload_out_size);
 		index_out += current->payload_out_size;
 		count_in += current->payload_in_size;
 		count_out += current->payload_out_size;
@@ -749,10 +749,10 @@ int ulink_execute_queued_commands(struct ulink *device, int timeout)
 		/* Write back IN payload data */
 		index_in = 0;
 		for (current = device->queue_start; current; current = current->next) {
-			for (i = 0; i < current->payload_in_size; i++) {
-				current->payload_in[i] = buffer[index_in];
-				index_in++;
-			}
+			if (current->payload_in_size == 0)
+				continue;
+			memcpy(current->payload_in, buffer + index_in, current->payload_in_size);
+			index_in += current->payload_in_size;
 		}
 	}
 
@@ -862,6 +862,21 @@ void ulink_print_queue(struct ulink *device)
 
 #endif	/* _DEBUG_JTAG_IO_ */
 
+/**
+ * Largest payload of a single scan command, in bytes.
+ *
+ * The USB buffer can hold 64 bytes, 1 byte is command ID and 5 bytes are
+ * setup data, leaving 58 bytes for TDI data. A scan that only reads TDO
+ * sends no TDI data, its TDO data fills a whole 64 byte IN packet.
+ *
+ * @param type scan type (IN/OUT/IO)
+ * @return the maximum number of payload bytes
+ */
+static uint32_t ulink_scan_max_payload(enum scan_type type)
+{
+	return type == SCAN_IN ? 64 : 58;
+}
+
 /**
  * Perform JTAG scan
  *
@@ -904,9 +919,8 @@ int ulink_append_scan_cmd(struct ulink *device, enum scan_type scan_type,
 	if (cmd == NULL)
 		return ERROR_FAIL;
 
-	/* Check size of command. USB buffer can hold 64 bytes, 1 byte is command ID,
-	 * 5 bytes are setup data -> 58 remaining payload bytes for TDI data */
-	if (scan_size_bits > (58 * 8)) {
+	/* Check size of command, see ulink_scan_max_payload() */
+	if (scan_size_bits > (ulink_scan_max_payload(scan_type) * 8)) {
 		LOG_ERROR("BUG: Tried to create CMD_SCAN_IO OpenULINK command with too"
 			" large payload");
 		free(cmd);
@@ -1490,7 +1504,7 @@ int ulink_queue_statemove(struct ulink *device)
 int ulink_queue_scan(struct ulink *device, struct jtag_command *cmd)
 {
 	uint32_t scan_size_bits, scan_size_bytes, bits_last_scan;
-	uint32_t scans_max_payload, bytecount;
+	uint32_t scans_max_payload, max_payload, bytecount;
 	uint8_t *tdi_buffer_start = NULL, *tdi_buffer = NULL;
 	uint8_t *tdo_buffer_start = NULL, *tdo_buffer = NULL;
 
@@ -1514,10 +1528,11 @@ int ulink_queue_scan(struct ulink *device, struct jtag_command *cmd)
 	type = jtag_scan_type(cmd->cmd.scan);
 
 	/* Determine number of scan commands with maximum payload */
-	scans_max_payload = scan_size_bytes / 58;
+	max_payload = ulink_scan_max_payload(type);
+	scans_max_payload = scan_size_bytes / max_payload;
 
 	/* Determine size of last shift command */
-	bits_last_scan = scan_size_bits - (scans_max_payload * 58 * 8);
+	bits_last_scan = scan_size_bits - (scans_max_payload * max_payload * 8);
 
 	/* Allocate TDO buffer if required */
 	if ((type == SCAN_IN) || (type == SCAN_IO)) {
@@ -1581,13 +1596,13 @@ int ulink_queue_scan(struct ulink *device, struct jtag_command *cmd)
 			tms_sequence_start = tms_sequence_resume;
 		}
 
-		if (bytecount > 58) {	/* Full scan, at least one scan will follow */
+		if (bytecount > max_payload) {	/* Full scan, at least one scan will follow */
 			tms_count_end = tms_count_pause;
 			tms_sequence_end = tms_sequence_pause;
 
 			ret = ulink_append_scan_cmd(device,
 					type,
-					58 * 8,
+					max_payload * 8,
 					tdi_buffer,
 					tdo_buffer_start,
 					tdo_buffer,
@@ -1598,20 +1613,20 @@ int ulink_queue_scan(struct ulink *device, struct jtag_command *cmd)
 					cmd,
 					false);
 
-			bytecount -= 58;
+			bytecount -= max_payload;
 
 			/* Update TDI and TDO buffer pointers */
 			if (tdi_buffer_start != NULL)
-				tdi_buffer += 58;
+				tdi_buffer += max_payload;
 			if (tdo_buffer_start != NULL)
-				tdo_buffer += 58;
-		} else if (bytecount == 58) {	/* Full scan, no further scans */
+				tdo_buffer += max_payload;
+		} else if (bytecount == max_payload) {	/* Full scan, no further scans */
 			tms_count_end = last_tms_count;
 			tms_sequence_end = last_tms_sequence;
 
 			ret = ulink_append_scan_cmd(device,
 					type,
-					58 * 8,
+					max_payload * 8,
 					tdi_buffer,
 					tdo_buffer_start,
 					tdo_buffer,
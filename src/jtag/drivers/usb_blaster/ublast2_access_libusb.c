@@ -63,6 +63,46 @@ static int ublast2_libusb_write(struct ublast_lowlevel *low, uint8_t *buf,
 	return ERROR_OK;
 }
 
+#ifdef HAVE_LIBUSB1
+/*
+ * Submit the write and the reads for every reply it triggers at once, so
+ * the dongle never waits for the host between packets. Each reply is a
+ * packet of its own, hence one read transfer per reply.
+ */
+static int ublast2_libusb_write_read(struct ublast_lowlevel *low, uint8_t *out,
+				     int out_size, uint8_t *in,
+				     const int *in_sizes, int nb_in,
+				     uint32_t *bytes_read)
+{
+	struct jtag_xfer xfers[UBLAST_MAX_READ_CHUNKS + 1];
+	int i, retval;
+
+	if (nb_in > UBLAST_MAX_READ_CHUNKS)
+		return ERROR_FAIL;
+
+	xfers[0].ep = USBBLASTER_EPOUT | LIBUSB_ENDPOINT_OUT;
+	xfers[0].buf = out;
+	xfers[0].size = out_size;
+	for (i = 0; i < nb_in; i++) {
+		xfers[i + 1].ep = USBBLASTER_EPIN | LIBUSB_ENDPOINT_IN;
+		xfers[i + 1].buf = in;
+		xfers[i + 1].size = in_sizes[i];
+		in += in_sizes[i];
+	}
+
+	retval = jtag_libusb_bulk_transfer_n(low->libusb_dev, xfers, nb_in + 1, 100);
+
+	/* only the replies before the first short one landed where expected */
+	*bytes_read = 0;
+	for (i = 1; i <= nb_in; i++) {
+		*bytes_read += xfers[i].transferred;
+		if (xfers[i].transferred != xfers[i].size)
+			break;
+	}
+	return retval;
+}
+#endif
+
 static int ublast2_write_firmware_section(struct jtag_libusb_device_handle *libusb_dev,
 				   struct image *firmware_image, int section_index)
 {
@@ -244,6 +284,9 @@ static struct ublast_lowlevel low = {
 	.close = ublast2_libusb_quit,
 	.read = ublast2_libusb_read,
 	.write = ublast2_libusb_write,
+#ifdef HAVE_LIBUSB1
+	.write_read = ublast2_libusb_write_read,
+#endif
 	.flags = COPY_TDO_BUFFER,
 };
 
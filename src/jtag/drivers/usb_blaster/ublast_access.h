@@ -33,6 +33,9 @@
 /* Low level flags */
 #define COPY_TDO_BUFFER		(1 << 0)
 
+/* Most replies a single write_read() call waits for */
+#define UBLAST_MAX_READ_CHUNKS	16
+
 struct ublast_lowlevel {
 	uint16_t ublast_vid;
 	uint16_t ublast_pid;
@@ -46,6 +49,13 @@ struct ublast_lowlevel {
 		     uint32_t *bytes_written);
 	int (*read)(struct ublast_lowlevel *low, uint8_t *buf, unsigned size,
 		    uint32_t *bytes_read);
+	/*
+	 * Optional: write out, and read nb_in replies of in_sizes[] bytes to
+	 * consecutive locations of in, with all transfers in flight at once.
+	 */
+	int (*write_read)(struct ublast_lowlevel *low, uint8_t *out, int out_size,
+			  uint8_t *in, const int *in_sizes, int nb_in,
+			  uint32_t *bytes_read);
 	int (*open)(struct ublast_lowlevel *low);
 	int (*close)(struct ublast_lowlevel *low);
 	int (*speed)(struct ublast_lowlevel *low, int speed);
@@ -95,6 +95,11 @@
  * BUF_LEN must be grater than or equal MAX_PACKET_SIZE.
  */
 #define BUF_LEN 4096
+/*
+ * Most TDO bytes of byte-shift mode waiting in the dongle to be read back,
+ * below the FT245 transmit FIFO size (384 bytes) of the USB-Blaster.
+ */
+#define MAX_PENDING_TDO 256
 
 /* USB-Blaster II specific command */
 #define CMD_COPY_TDO_BUFFER	0x5F
@@ -526,26 +531,45 @@ static void ublast_state_move(tap_state_t state)
 /**
  * ublast_read_byteshifted_tdos - read TDO of byteshift writes
  * @buf: the buffer to store the bits
- * @nb_bits: the number of bits
+ * @sizes: the number of bytes of each byteshift write
+ * @nb_chunks: the number of byteshift writes
  *
- * Reads back from USB Blaster TDO bits, triggered by a 'byteshift write', ie. eight
+ * Reads back from USB Blaster TDO bits, triggered by 'byteshift writes', ie. eight
  * bits per received byte from USB interface, and store them in buffer.
  *
  * As the USB blaster stores the TDO bits in LSB (ie. first bit in (byte0,
  * bit0), second bit in (byte0, bit1), ...), which is what we want to return,
  * simply read bytes from USB interface and store them.
  *
+ * If the lowlevel driver can, the pending writes and all the reads are
+ * submitted at once instead of one after the other.
+ *
  * Returns ERROR_OK if OK, ERROR_xxx if a read error occured
  */
-static int ublast_read_byteshifted_tdos(uint8_t *buf, int nb_bytes)
+static int ublast_read_byteshifted_tdos(uint8_t *buf, const int *sizes, int nb_chunks)
 {
 	unsigned int retlen;
-	int ret = ERROR_OK;
+	int i, nb_bytes = 0, ret = ERROR_OK;
+
+	for (i = 0; i < nb_chunks; i++)
+		nb_bytes += sizes[i];
 
 	DEBUG_JTAG_IO("%s(buf=%p, num_bits=%d)", __func__, buf, nb_bytes * 8);
-	ublast_flush_buffer();
+	if (info.drv->write_read && info.bufidx > 0) {
+		ret = info.drv->write_read(info.drv, info.buf, info.bufidx,
+					   buf, sizes, nb_chunks, &retlen);
+		info.bufidx = 0;
+		if (ret != ERROR_OK)
+			return ret;
+		buf += retlen;
+		nb_bytes -= retlen;
+	} else {
+		ublast_flush_buffer();
+	}
+
 	while (ret == ERROR_OK && nb_bytes > 0) {
 		ret = ublast_buf_read(buf, nb_bytes, &retlen);
+		buf += retlen;
 		nb_bytes -= retlen;
 	}
 	return ret;
@@ -602,7 +626,7 @@ static int ublast_read_bitbang_tdos(uint8_t *buf, int nb_bits)
  * TAP state shift if input bits were non NULL.
  *
  * In order to not saturate the USB Blaster queues, this method reads back TDO
- * if the scan type requests it, and stores them back in bits.
+ * every few packets if the scan type requests it, and stores them back in bits.
  *
  * As a side note, the state of TCK when entering this function *must* be
  * low. This is because byteshift mode outputs TDI on rising TCK and reads TDO
@@ -615,6 +639,7 @@ static void ublast_queue_tdi(uint8_t *bits, int nb_bits, enum scan_type scan)
 	int nb8 = nb_bits / 8;
 	int nb1 = nb_bits % 8;
 	int nbfree_in_packet, i, trans = 0, read_tdos;
+	int sizes[UBLAST_MAX_READ_CHUNKS], nb_chunks = 0, nb_pending = 0;
 	uint8_t *tdos = calloc(1, nb_bits / 8 + 1);
 	static uint8_t byte0[BUF_LEN];
 
@@ -626,8 +651,10 @@ static void ublast_queue_tdi(uint8_t *bits, int nb_bits, enum scan_type scan)
 	 *   nb_bits
 	 * - nb1 = 8
 	 * This ensures that nb1 is never 0, and allows the TMS transition.
+	 * Idle clocks (bits == NULL) have no transition, they are shifted out
+	 * in byteshift mode entirely.
 	 */
-	if (nb8 > 0 && nb1 == 0) {
+	if (bits && nb8 > 0 && nb1 == 0) {
 		nb8--;
 		nb1 = 8;
 	}
@@ -657,7 +684,21 @@ static void ublast_queue_tdi(uint8_t *bits, int nb_bits, enum scan_type scan)
 		if (read_tdos) {
 			if (info.flags & COPY_TDO_BUFFER)
 				ublast_queue_byte(CMD_COPY_TDO_BUFFER);
-			ublast_read_byteshifted_tdos(&tdos[i], trans);
+			sizes[nb_chunks++] = trans;
+			nb_pending += trans;
+		}
+
+		/*
+		 * Collect the TDO of several packets before reading them back,
+		 * but never more than the dongle can hold.
+		 */
+		if (nb_chunks && (nb_chunks == UBLAST_MAX_READ_CHUNKS ||
+				  nb_pending + MAX_PACKET_SIZE > MAX_PENDING_TDO ||
+				  i + trans == nb8)) {
+			ublast_read_byteshifted_tdos(&tdos[i + trans - nb_pending],
+						     sizes, nb_chunks);
+			nb_chunks = 0;
+			nb_pending = 0;
 		}
 	}
 
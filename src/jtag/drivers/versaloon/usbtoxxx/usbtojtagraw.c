@@ -57,6 +57,8 @@ RESULT usbtojtagraw_execute(uint8_t interface_index, uint8_t *tdi,
 	uint8_t *tms, uint8_t *tdo, uint32_t bitlen)
 {
 	uint16_t bytelen;
+	uint8_t *buf;
+	RESULT ret;
 
 #if PARAM_CHECK
 	if (interface_index > 7) {
@@ -69,10 +71,14 @@ RESULT usbtojtagraw_execute(uint8_t interface_index, uint8_t *tdi,
 		return ERROR_FAIL;
 	bytelen = (uint16_t)((bitlen + 7) >> 3);
 
-	SET_LE_U32(&versaloon_cmd_buf[0], bitlen);
-	memcpy(versaloon_cmd_buf + 4, tdi, bytelen);
-	memcpy(versaloon_cmd_buf + 4 + bytelen, tms, bytelen);
+	ret = usbtoxxx_reserve_command(USB_TO_JTAG_RAW,
+		USB_TO_XXX_IN_OUT | interface_index, &buf, 4 + bytelen * 2,
+		bytelen, tdo, 0, bytelen, 0);
+	if (ERROR_OK != ret)
+		return ret;
 
-	return usbtoxxx_inout_command(USB_TO_JTAG_RAW, interface_index,
-		versaloon_cmd_buf, 4 + bytelen * 2, bytelen, tdo, 0, bytelen, 0);
+	SET_LE_U32(&buf[0], bitlen);
+	memcpy(buf + 4, tdi, bytelen);
+	memcpy(buf + 4 + bytelen, tms, bytelen);
+	return ERROR_OK;
 }
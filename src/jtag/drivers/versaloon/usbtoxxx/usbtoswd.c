@@ -83,6 +83,8 @@ RESULT usbtoswd_seqout(uint8_t interface_index, const uint8_t *data,
 	uint16_t bitlen)
 {
 	uint16_t bytelen = (bitlen + 7) >> 3;
+	uint8_t *buf;
+	RESULT ret;
 
 #if PARAM_CHECK
 	if (interface_index > 7) {
@@ -91,11 +93,14 @@ RESULT usbtoswd_seqout(uint8_t interface_index, const uint8_t *data,
 	}
 #endif
 
-	SET_LE_U16(&versaloon_cmd_buf[0], bitlen);
-	memcpy(versaloon_cmd_buf + 2, data, bytelen);
+	ret = usbtoxxx_reserve_command(USB_TO_SWD, USB_TO_XXX_OUT | interface_index,
+		&buf, bytelen + 2, 0, NULL, 0, 0, 0);
+	if (ERROR_OK != ret)
+		return ret;
 
-	return usbtoxxx_out_command(USB_TO_SWD, interface_index,
-		versaloon_cmd_buf, bytelen + 2, 0);
+	SET_LE_U16(&buf[0], bitlen);
+	memcpy(buf + 2, data, bytelen);
+	return ERROR_OK;
 }
 
 RESULT usbtoswd_seqin(uint8_t interface_index, uint8_t *data, uint16_t bitlen)
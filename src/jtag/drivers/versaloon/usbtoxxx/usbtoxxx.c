@@ -114,79 +114,53 @@ RESULT usbtoxxx_validate_current_command_type(void)
 	return ERROR_OK;
 }
 
-RESULT usbtoxxx_execute_command(void)
+/* process the reply in buf to the pending_num commands of pending */
+static RESULT usbtoxxx_process_reply(uint8_t *buf,
+	struct versaloon_pending_t *pending, uint16_t pending_num, uint16_t inlen)
 {
 	uint16_t i;
-	uint16_t inlen;
+	uint16_t index = 0;
 	RESULT result = ERROR_OK;
 
-	if (poll_nesting) {
-		LOG_BUG(ERRMSG_INVALID_USAGE, "USB_TO_POLL");
-		versaloon_free_want_pos();
-		return ERROR_FAIL;
-	}
-
-	if (ERROR_OK != usbtoxxx_validate_current_command_type()) {
-		LOG_BUG(ERRMSG_FAILURE_OPERATION, "validate previous commands");
-		versaloon_free_want_pos();
-		return ERRCODE_FAILURE_OPERATION;
-	}
-	if (3 == usbtoxxx_buffer_index) {
-		versaloon_free_want_pos();
-		return ERROR_OK;
-	}
-
-	versaloon_buf[0] = USB_TO_ALL;
-	SET_LE_U16(&versaloon_buf[1], usbtoxxx_buffer_index);
-
-	if (ERROR_OK != versaloon_send_command(usbtoxxx_buffer_index, &inlen)) {
-		versaloon_free_want_pos();
-		return ERROR_FAIL;
-	}
-
-	/* process return data */
-	usbtoxxx_buffer_index = 0;
-	for (i = 0; i < versaloon_pending_idx; i++) {
+	for (i = 0; i < pending_num; i++) {
 		/* check result */
-		if ((0 == i) || !((versaloon_pending[i].collect)
-				  && (versaloon_pending[i - 1].collect)
-				  && (versaloon_pending[i].cmd
-				      == versaloon_pending[i - 1].cmd))) {
-			if (USB_TO_XXX_CMD_NOT_SUPPORT
-					== versaloon_buf[usbtoxxx_buffer_index]) {
+		if ((0 == i) || !((pending[i].collect)
+				  && (pending[i - 1].collect)
+				  && (pending[i].cmd
+				      == pending[i - 1].cmd))) {
+			if (USB_TO_XXX_CMD_NOT_SUPPORT == buf[index]) {
 				LOG_ERROR(ERRMSG_NOT_SUPPORT_BY,
-					usbtoxxx_get_type_name(versaloon_pending[i].type),
+					usbtoxxx_get_type_name(pending[i].type),
 					"current dongle");
 				result = ERROR_FAIL;
 				break;
-			} else if (USB_TO_XXX_OK != versaloon_buf[usbtoxxx_buffer_index]) {
+			} else if (USB_TO_XXX_OK != buf[index]) {
 				LOG_ERROR("%s command 0x%02x failed with 0x%02x",
-					usbtoxxx_get_type_name(versaloon_pending[i].type),
-					versaloon_pending[i].cmd,
-					versaloon_buf[usbtoxxx_buffer_index]);
+					usbtoxxx_get_type_name(pending[i].type),
+					pending[i].cmd,
+					buf[index]);
 				result = ERROR_FAIL;
 				break;
 			}
-			usbtoxxx_buffer_index++;
+			index++;
 		}
 
 		/* get result data */
-		if (versaloon_pending[i].pos != NULL) {
+		if (pending[i].pos != NULL) {
 			uint8_t processed = 0;
 
-			if (versaloon_pending[i].callback != NULL) {
-				versaloon_pending[i].callback(&versaloon_pending[i],
-					versaloon_buf + usbtoxxx_buffer_index, &processed);
+			if (pending[i].callback != NULL) {
+				pending[i].callback(&pending[i],
+					buf + index, &processed);
 			}
 			if (!processed) {
 				struct versaloon_want_pos_t *tmp;
 
-				tmp = versaloon_pending[i].pos;
+				tmp = pending[i].pos;
 				while (tmp != NULL) {
 					if ((tmp->buff != NULL) && (tmp->size > 0)) {
 						memcpy(tmp->buff,
-							versaloon_buf + usbtoxxx_buffer_index
-							+ tmp->offset,
+							buf + index + tmp->offset,
 							tmp->size);
 					}
 					struct versaloon_want_pos_t *free_tmp;
@@ -194,46 +168,103 @@ RESULT usbtoxxx_execute_command(void)
 					tmp = tmp->next;
 					free(free_tmp);
 				}
-				versaloon_pending[i].pos = NULL;
+				pending[i].pos = NULL;
 			}
-		} else if ((versaloon_pending[i].want_data_size > 0)
-				&& (versaloon_pending[i].data_buffer != NULL)) {
+		} else if ((pending[i].want_data_size > 0)
+				&& (pending[i].data_buffer != NULL)) {
 			uint8_t processed = 0;
 
-			if (versaloon_pending[i].callback != NULL) {
-				versaloon_pending[i].callback(&versaloon_pending[i],
-					versaloon_buf + usbtoxxx_buffer_index, &processed);
+			if (pending[i].callback != NULL) {
+				pending[i].callback(&pending[i],
+					buf + index, &processed);
 			}
 			if (!processed) {
-				memcpy(versaloon_pending[i].data_buffer,
-					versaloon_buf + usbtoxxx_buffer_index
-					+ versaloon_pending[i].want_data_pos,
-					versaloon_pending[i].want_data_size);
+				memcpy(pending[i].data_buffer,
+					buf + index + pending[i].want_data_pos,
+					pending[i].want_data_size);
 			}
 		}
-		usbtoxxx_buffer_index += versaloon_pending[i].actual_data_size;
-		if (usbtoxxx_buffer_index > inlen) {
+		index += pending[i].actual_data_size;
+		if (index > inlen) {
 			LOG_BUG("%s command 0x%02x process error",
-				usbtoxxx_get_type_name(versaloon_pending[i].type),
-				versaloon_pending[i].cmd);
+				usbtoxxx_get_type_name(pending[i].type),
+				pending[i].cmd);
 			result = ERROR_FAIL;
 			break;
 		}
 	}
 
 	/* data is not the right size */
-	if (inlen != usbtoxxx_buffer_index) {
+	if ((ERROR_OK == result) && (inlen != index)) {
 		LOG_ERROR(ERRMSG_INVALID_TARGET, "length of return data");
 		result = ERROR_FAIL;
 	}
 
-	if (versaloon_pending_idx > 0)
-		versaloon_pending_idx = 0;
-	else {
+	versaloon_free_pending_pos(pending, pending_num);
+	return result;
+}
+
+/* number of commands in the buffer being executed by the dongle */
+static uint16_t usbtoxxx_in_flight_num;
+
+RESULT usbtoxxx_complete_command(void)
+{
+	uint8_t *buf;
+	struct versaloon_pending_t *pending;
+	uint16_t inlen;
+	RESULT result;
+
+	if (!versaloon_command_in_flight())
+		return ERROR_OK;
+
+	result = versaloon_wait_command(&buf, &pending, &inlen);
+	if (ERROR_OK == result)
+		result = usbtoxxx_process_reply(buf, pending,
+				usbtoxxx_in_flight_num, inlen);
+	else
+		versaloon_free_pending_pos(pending, usbtoxxx_in_flight_num);
+
+	if (0 == usbtoxxx_in_flight_num) {
 		/* no receive data, avoid collision */
 		sleep_ms(10);
 	}
+	usbtoxxx_in_flight_num = 0;
+	return result;
+}
+
+/*
+ * Send the commands built so far without waiting for their reply, which is
+ * processed by usbtoxxx_complete_command(). The next commands are built in
+ * the other buffer meanwhile, so the dongle is kept busy.
+ */
+static RESULT usbtoxxx_submit_command(void)
+{
+	RESULT result;
+
+	/* a single command may be in flight */
+	result = usbtoxxx_complete_command();
+
+	if (ERROR_OK != usbtoxxx_validate_current_command_type()) {
+		LOG_BUG(ERRMSG_FAILURE_OPERATION, "validate previous commands");
+		versaloon_free_want_pos();
+		return ERRCODE_FAILURE_OPERATION;
+	}
+	if (3 == usbtoxxx_buffer_index) {
+		versaloon_free_want_pos();
+		return result;
+	}
+
+	versaloon_buf[0] = USB_TO_ALL;
+	SET_LE_U16(&versaloon_buf[1], usbtoxxx_buffer_index);
+
+	if (ERROR_OK != versaloon_submit_command(usbtoxxx_buffer_index)) {
+		versaloon_free_want_pos();
+		result = ERROR_FAIL;
+	} else
+		usbtoxxx_in_flight_num = versaloon_pending_idx;
 
+	versaloon_pending_idx = 0;
+	usbtoxxx_buffer_index = 0;
 	type_pre = 0;
 	collect_cmd = 0;
 	collect_index = 0;
@@ -241,6 +272,22 @@ RESULT usbtoxxx_execute_command(void)
 	return result;
 }
 
+RESULT usbtoxxx_execute_command(void)
+{
+	RESULT result;
+
+	if (poll_nesting) {
+		LOG_BUG(ERRMSG_INVALID_USAGE, "USB_TO_POLL");
+		versaloon_free_want_pos();
+		return ERROR_FAIL;
+	}
+
+	result = usbtoxxx_submit_command();
+	if (ERROR_OK != usbtoxxx_complete_command())
+		result = ERROR_FAIL;
+	return result;
+}
+
 RESULT usbtoxxx_init(void)
 {
 	versaloon_pending_idx = 0;
@@ -257,6 +304,7 @@ RESULT usbtoxxx_init(void)
 
 RESULT usbtoxxx_fini(void)
 {
+	usbtoxxx_complete_command();
 	usbtoxxx_buffer = NULL;
 	type_pre = 0;
 	return ERROR_OK;
@@ -277,7 +325,7 @@ RESULT usbtoxxx_ensure_buffer_size(uint16_t cmdlen)
 	/* check free space, commit if not enough */
 	if (((usbtoxxx_buffer_index + usbtoxxx_current_cmd_index + cmdlen)
 			>= versaloon_buf_size)
-			|| (versaloon_pending_idx >= VERSALOON_MAX_PENDING_NUMBER)) {
+			|| (versaloon_pending_idx >= versaloon_pending_size)) {
 		struct usbtoxxx_context_t context_tmp;
 		uint8_t poll_nesting_tmp = 0;
 
@@ -294,34 +342,59 @@ RESULT usbtoxxx_ensure_buffer_size(uint16_t cmdlen)
 			poll_nesting = 0;
 		}
 
-		if (usbtoxxx_execute_command() != ERROR_OK)
-			return ERROR_FAIL;
-
 		if (poll_nesting_tmp) {
+			uint8_t *old_buf = versaloon_buf;
+			struct versaloon_pending_t *old_pending = versaloon_pending;
 			uint16_t newlen, oldlen;
+			uint8_t *poll_cmds;
 
-			newlen = context_tmp.versaloon_pending_idx
-				- poll_context.versaloon_pending_idx;
-			memcpy(&versaloon_pending[0],
-				&versaloon_pending[poll_context.versaloon_pending_idx],
-				sizeof(versaloon_pending[0]) * newlen);
-			context_tmp.versaloon_pending_idx = newlen;
+			/*
+			 * The reply lands in the submitted buffer, save the poll
+			 * commands to move them to the start of the other one.
+			 */
 			oldlen = poll_context.usbtoxxx_buffer_index
 				+ poll_context.usbtoxxx_current_cmd_index;
 			newlen = context_tmp.usbtoxxx_buffer_index
 				+ context_tmp.usbtoxxx_current_cmd_index;
-			memcpy(versaloon_buf + 3, versaloon_buf + oldlen, newlen - oldlen);
+			poll_cmds = malloc(newlen - oldlen + 1);
+			if (NULL == poll_cmds) {
+				LOG_ERROR(ERRMSG_NOT_ENOUGH_MEMORY);
+				return ERRCODE_NOT_ENOUGH_MEMORY;
+			}
+			memcpy(poll_cmds, old_buf + oldlen, newlen - oldlen);
+
+			if (usbtoxxx_submit_command() != ERROR_OK) {
+				free(poll_cmds);
+				return ERROR_FAIL;
+			}
+
+			memcpy(versaloon_buf + 3, poll_cmds, newlen - oldlen);
+			free(poll_cmds);
 			oldlen -= 3;
-			context_tmp.usbtoxxx_buffer -= oldlen;
+			context_tmp.usbtoxxx_buffer = versaloon_buf
+				+ (context_tmp.usbtoxxx_buffer - old_buf) - oldlen;
 			context_tmp.usbtoxxx_buffer_index -= oldlen;
+
+			newlen = context_tmp.versaloon_pending_idx
+				- poll_context.versaloon_pending_idx;
+			memcpy(&versaloon_pending[0],
+				&old_pending[poll_context.versaloon_pending_idx],
+				sizeof(versaloon_pending[0]) * newlen);
+			memset(&old_pending[poll_context.versaloon_pending_idx], 0,
+				sizeof(versaloon_pending[0]) * newlen);
+			context_tmp.versaloon_pending_idx = newlen;
+
 			usbtoxxx_pop_context(&context_tmp);
 			poll_nesting = poll_nesting_tmp;
+		} else if (usbtoxxx_submit_command() != ERROR_OK) {
+			/* keep building while the dongle runs the full buffer */
+			return ERROR_FAIL;
 		}
 	}
 	return ERROR_OK;
 }
 
-RESULT usbtoxxx_add_command(uint8_t type, uint8_t cmd, uint8_t *cmdbuf,
+RESULT usbtoxxx_reserve_command(uint8_t type, uint8_t cmd, uint8_t **cmdbuf,
 	uint16_t cmdlen, uint16_t retlen, uint8_t *wantbuf,
 	uint16_t wantpos, uint16_t wantlen, uint8_t collect)
 {
@@ -358,7 +431,7 @@ RESULT usbtoxxx_add_command(uint8_t type, uint8_t cmd, uint8_t *cmdbuf,
 	}
 
 	if (cmdbuf != NULL) {
-		memcpy(usbtoxxx_buffer + usbtoxxx_current_cmd_index, cmdbuf, cmdlen);
+		*cmdbuf = usbtoxxx_buffer + usbtoxxx_current_cmd_index;
 		usbtoxxx_current_cmd_index += cmdlen;
 	}
 
@@ -366,6 +439,20 @@ RESULT usbtoxxx_add_command(uint8_t type, uint8_t cmd, uint8_t *cmdbuf,
 		wantbuf, collect);
 }
 
+RESULT usbtoxxx_add_command(uint8_t type, uint8_t cmd, uint8_t *cmdbuf,
+	uint16_t cmdlen, uint16_t retlen, uint8_t *wantbuf,
+	uint16_t wantpos, uint16_t wantlen, uint8_t collect)
+{
+	uint8_t *buf;
+	RESULT ret;
+
+	ret = usbtoxxx_reserve_command(type, cmd, (cmdbuf != NULL) ? &buf : NULL,
+			cmdlen, retlen, wantbuf, wantpos, wantlen, collect);
+	if ((ERROR_OK == ret) && (cmdbuf != NULL))
+		memcpy(buf, cmdbuf, cmdlen);
+	return ret;
+}
+
 RESULT usbtoinfo_get_abilities(uint8_t abilities[USB_TO_XXX_ABILITIES_LEN])
 {
 	if (ERROR_OK != usbtoxxx_ensure_buffer_size(3))
@@ -21,6 +21,7 @@
 RESULT usbtoxxx_init(void);
 RESULT usbtoxxx_fini(void);
 RESULT usbtoxxx_execute_command(void);
+RESULT usbtoxxx_complete_command(void);
 
 #define USB_TO_XXX_ABILITIES_LEN                        12
 extern uint8_t usbtoxxx_abilities[USB_TO_XXX_ABILITIES_LEN];
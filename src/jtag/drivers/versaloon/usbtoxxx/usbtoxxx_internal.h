@@ -94,6 +94,12 @@ RESULT usbtoxxx_add_command(uint8_t type, uint8_t cmd, uint8_t *cmdbuf,
 		uint16_t cmdlen, uint16_t retlen,
 		uint8_t *wantbuf, uint16_t wantpos,
 		uint16_t wantlen, uint8_t collect);
+/* like usbtoxxx_add_command, the caller fills the cmdlen bytes at *cmdbuf
+ * itself, before adding any other command */
+RESULT usbtoxxx_reserve_command(uint8_t type, uint8_t cmd, uint8_t **cmdbuf,
+		uint16_t cmdlen, uint16_t retlen,
+		uint8_t *wantbuf, uint16_t wantpos,
+		uint16_t wantlen, uint8_t collect);
 
 #define usbtoxxx_init_command(type, port)							\
 	usbtoxxx_add_command((type), (USB_TO_XXX_INIT | (port)), \
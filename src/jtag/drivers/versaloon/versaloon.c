@@ -29,12 +29,25 @@
 #include "usbtoxxx/usbtoxxx.h"
 
 uint8_t *versaloon_buf;
-uint8_t *versaloon_cmd_buf;
 uint16_t versaloon_buf_size;
 
-struct versaloon_pending_t versaloon_pending[VERSALOON_MAX_PENDING_NUMBER];
+struct versaloon_pending_t *versaloon_pending;
 uint16_t versaloon_pending_idx;
+uint16_t versaloon_pending_size;
 
+/*
+ * Two command buffers, each with its pending array: while the dongle runs
+ * the command in one of them, the next command is built in the other.
+ */
+static uint8_t *versaloon_bufs[2];
+static struct versaloon_pending_t *versaloon_pendings[2];
+static int versaloon_buf_cur;
+
+static struct libusb_transfer *versaloon_transfers[2];
+static int versaloon_transfer_done[2];
+static bool versaloon_in_flight;
+
+libusb_context *versaloon_usb_context;
 libusb_device_handle *versaloon_usb_device_handle;
 static uint32_t versaloon_usb_to = VERSALOON_TIMEOUT;
 
@@ -110,11 +123,26 @@ void versaloon_set_extra_data(void *p)
 	versaloon_extra_data = p;
 }
 
-void versaloon_free_want_pos(void)
+void versaloon_free_pending_pos(struct versaloon_pending_t *pending, uint16_t num)
 {
 	uint16_t i;
 	struct versaloon_want_pos_t *tmp, *free_tmp;
 
+	for (i = 0; i < num; i++) {
+		tmp = pending[i].pos;
+		while (tmp != NULL) {
+			free_tmp = tmp;
+			tmp = tmp->next;
+			free(free_tmp);
+		}
+		pending[i].pos = NULL;
+	}
+}
+
+void versaloon_free_want_pos(void)
+{
+	struct versaloon_want_pos_t *tmp, *free_tmp;
+
 	tmp = versaloon_want_pos;
 	while (tmp != NULL) {
 		free_tmp = tmp;
@@ -123,15 +151,8 @@ void versaloon_free_want_pos(void)
 	}
 	versaloon_want_pos = NULL;
 
-	for (i = 0; i < dimof(versaloon_pending); i++) {
-		tmp = versaloon_pending[i].pos;
-		while (tmp != NULL) {
-			free_tmp = tmp;
-			tmp = tmp->next;
-			free(free_tmp);
-		}
-		versaloon_pending[i].pos = NULL;
-	}
+	if (versaloon_pending != NULL)
+		versaloon_free_pending_pos(versaloon_pending, versaloon_pending_size);
 }
 
 RESULT versaloon_add_want_pos(uint16_t offset, uint16_t size, uint8_t *buff)
@@ -165,7 +186,7 @@ RESULT versaloon_add_pending(uint8_t type, uint8_t cmd, uint16_t actual_szie,
 	uint16_t want_pos, uint16_t want_size, uint8_t *buffer, uint8_t collect)
 {
 #if PARAM_CHECK
-	if (versaloon_pending_idx >= VERSALOON_MAX_PENDING_NUMBER) {
+	if (versaloon_pending_idx >= versaloon_pending_size) {
 		LOG_BUG(ERRMSG_INVALID_INDEX, versaloon_pending_idx,
 			"versaloon pending data");
 		return ERROR_FAIL;
@@ -232,6 +253,103 @@ RESULT versaloon_send_command(uint16_t out_len, uint16_t *inlen)
 		return ERROR_OK;
 }
 
+static void LIBUSB_CALL versaloon_transfer_cb(struct libusb_transfer *transfer)
+{
+	int *done = transfer->user_data;
+
+	*done = 1;
+}
+
+bool versaloon_command_in_flight(void)
+{
+	return versaloon_in_flight;
+}
+
+RESULT versaloon_submit_command(uint16_t out_len)
+{
+	int i, ret;
+
+#if PARAM_CHECK
+	if (versaloon_in_flight) {
+		LOG_BUG(ERRMSG_INVALID_USAGE, "two commands in flight");
+		return ERROR_FAIL;
+	}
+	if ((0 == out_len) || (out_len > versaloon_interface.usb_setting.buf_size)) {
+		LOG_BUG(ERRMSG_INVALID_PARAMETER, __func__);
+		return ERRCODE_INVALID_PARAMETER;
+	}
+#endif
+
+	/* the reply overwrites the command, the device reads it first */
+	libusb_fill_bulk_transfer(versaloon_transfers[0], versaloon_usb_device_handle,
+		versaloon_interface.usb_setting.ep_out, versaloon_buf, out_len,
+		versaloon_transfer_cb, &versaloon_transfer_done[0], versaloon_usb_to);
+	libusb_fill_bulk_transfer(versaloon_transfers[1], versaloon_usb_device_handle,
+		versaloon_interface.usb_setting.ep_in, versaloon_buf,
+		versaloon_interface.usb_setting.buf_size,
+		versaloon_transfer_cb, &versaloon_transfer_done[1], versaloon_usb_to);
+
+	for (i = 0; i < 2; i++) {
+		versaloon_transfer_done[i] = 0;
+		ret = libusb_submit_transfer(versaloon_transfers[i]);
+		if (ret != LIBUSB_SUCCESS) {
+			LOG_ERROR(ERRMSG_FAILURE_OPERATION, "send usb data");
+			if (i > 0) {
+				libusb_cancel_transfer(versaloon_transfers[0]);
+				while (!versaloon_transfer_done[0])
+					libusb_handle_events_completed(versaloon_usb_context,
+						&versaloon_transfer_done[0]);
+			}
+			return ERRCODE_FAILURE_OPERATION;
+		}
+	}
+	versaloon_in_flight = true;
+
+	/* build the next command in the other buffer */
+	versaloon_buf_cur ^= 1;
+	versaloon_buf = versaloon_bufs[versaloon_buf_cur];
+	versaloon_pending = versaloon_pendings[versaloon_buf_cur];
+	return ERROR_OK;
+}
+
+RESULT versaloon_wait_command(uint8_t **buf, struct versaloon_pending_t **pending,
+		uint16_t *inlen)
+{
+	int i, ret;
+	RESULT result = ERROR_OK;
+
+	if (!versaloon_in_flight) {
+		LOG_BUG(ERRMSG_INVALID_USAGE, "no command in flight");
+		return ERROR_FAIL;
+	}
+
+	for (i = 0; i < 2; i++) {
+		while (!versaloon_transfer_done[i]) {
+			ret = libusb_handle_events_completed(versaloon_usb_context,
+					&versaloon_transfer_done[i]);
+			if (ret != LIBUSB_SUCCESS && ret != LIBUSB_ERROR_INTERRUPTED)
+				LOG_DEBUG("libusb_handle_events_completed() failed: %s",
+					libusb_error_name(ret));
+		}
+	}
+	versaloon_in_flight = false;
+
+	if (versaloon_transfers[0]->status != LIBUSB_TRANSFER_COMPLETED
+			|| versaloon_transfers[0]->actual_length
+				!= versaloon_transfers[0]->length) {
+		LOG_ERROR(ERRMSG_FAILURE_OPERATION, "send usb data");
+		result = ERRCODE_FAILURE_OPERATION;
+	} else if (versaloon_transfers[1]->status != LIBUSB_TRANSFER_COMPLETED) {
+		LOG_ERROR(ERRMSG_FAILURE_OPERATION, "receive usb data");
+		result = ERROR_FAIL;
+	}
+
+	*buf = versaloon_bufs[versaloon_buf_cur ^ 1];
+	*pending = versaloon_pendings[versaloon_buf_cur ^ 1];
+	*inlen = (uint16_t)versaloon_transfers[1]->actual_length;
+	return result;
+}
+
 #define VERSALOON_RETRY_CNT 10
 RESULT versaloon_init(void)
 {
@@ -272,18 +390,23 @@ RESULT versaloon_init(void)
 	free(versaloon_buf);
 	versaloon_buf = NULL;
 
-	versaloon_buf = malloc(versaloon_interface.usb_setting.buf_size);
-	if (NULL == versaloon_buf) {
-		versaloon_fini();
-		LOG_ERROR(ERRMSG_NOT_ENOUGH_MEMORY);
-		return ERRCODE_NOT_ENOUGH_MEMORY;
-	}
-	versaloon_cmd_buf = malloc(versaloon_interface.usb_setting.buf_size - 3);
-	if (NULL == versaloon_cmd_buf) {
-		versaloon_fini();
-		LOG_ERROR(ERRMSG_NOT_ENOUGH_MEMORY);
-		return ERRCODE_NOT_ENOUGH_MEMORY;
+	/* a command takes at least one byte, more pending ones never fit */
+	versaloon_pending_size = versaloon_buf_size;
+	for (int i = 0; i < 2; i++) {
+		versaloon_bufs[i] = malloc(versaloon_interface.usb_setting.buf_size);
+		versaloon_pendings[i] = calloc(versaloon_pending_size,
+				sizeof(*versaloon_pendings[i]));
+		versaloon_transfers[i] = libusb_alloc_transfer(0);
+		if ((NULL == versaloon_bufs[i]) || (NULL == versaloon_pendings[i])
+				|| (NULL == versaloon_transfers[i])) {
+			versaloon_fini();
+			LOG_ERROR(ERRMSG_NOT_ENOUGH_MEMORY);
+			return ERRCODE_NOT_ENOUGH_MEMORY;
+		}
 	}
+	versaloon_buf_cur = 0;
+	versaloon_buf = versaloon_bufs[0];
+	versaloon_pending = versaloon_pendings[0];
 	if (ERROR_OK != usbtoxxx_init()) {
 		LOG_ERROR(ERRMSG_FAILURE_OPERATION, "initialize usbtoxxx");
 		return ERROR_FAIL;
@@ -299,14 +422,22 @@ RESULT versaloon_fini(void)
 
 		versaloon_usb_device_handle = NULL;
 
-		if (versaloon_buf != NULL) {
-			free(versaloon_buf);
-			versaloon_buf = NULL;
-		}
-		if (versaloon_cmd_buf != NULL) {
-			free(versaloon_cmd_buf);
-			versaloon_cmd_buf = NULL;
+		for (int i = 0; i < 2; i++) {
+			if (versaloon_pendings[i] != NULL)
+				versaloon_free_pending_pos(versaloon_pendings[i],
+						versaloon_pending_size);
+			free(versaloon_pendings[i]);
+			versaloon_pendings[i] = NULL;
+			free(versaloon_bufs[i]);
+			versaloon_bufs[i] = NULL;
+			libusb_free_transfer(versaloon_transfers[i]);
+			versaloon_transfers[i] = NULL;
 		}
+		/* either the temporary buffer or one of the above */
+		if ((versaloon_buf != NULL) && (versaloon_pending == NULL))
+			free(versaloon_buf);
+		versaloon_buf = NULL;
+		versaloon_pending = NULL;
 	}
 
 	return ERROR_OK;
@@ -337,6 +468,10 @@ RESULT versaloon_get_target_voltage(uint16_t *voltage)
 	}
 #endif
 
+	/* the reply to a queued command would land in the buffer */
+	if (versaloon_command_in_flight())
+		usbtoxxx_complete_command();
+
 	versaloon_buf[0] = VERSALOON_GET_TVCC;
 
 	if ((ERROR_OK != versaloon_send_command(1, &inlen)) || (inlen != 2)) {
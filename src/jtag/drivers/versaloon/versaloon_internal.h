@@ -70,7 +70,6 @@
 #define MP_ISSP							0x11
 
 /* pending struct */
-#define VERSALOON_MAX_PENDING_NUMBER	4096
 typedef RESULT(*versaloon_callback_t)(void *, uint8_t *, uint8_t *);
 struct versaloon_want_pos_t {
 	uint16_t offset;
@@ -91,9 +90,9 @@ struct versaloon_pending_t {
 	void *extra_data;
 	versaloon_callback_t callback;
 };
-extern struct versaloon_pending_t \
-	versaloon_pending[VERSALOON_MAX_PENDING_NUMBER];
+extern struct versaloon_pending_t *versaloon_pending;
 extern uint16_t versaloon_pending_idx;
+extern uint16_t versaloon_pending_size;
 void versaloon_set_pending_id(uint32_t id);
 void versaloon_set_callback(versaloon_callback_t callback);
 void versaloon_set_extra_data(void *p);
@@ -101,10 +100,16 @@ RESULT versaloon_add_want_pos(uint16_t offset, uint16_t size, uint8_t *buff);
 RESULT versaloon_add_pending(uint8_t type, uint8_t cmd, uint16_t actual_szie,
 		uint16_t want_pos, uint16_t want_size, uint8_t *buffer, uint8_t collect);
 void versaloon_free_want_pos(void);
+void versaloon_free_pending_pos(struct versaloon_pending_t *pending, uint16_t num);
 
 RESULT versaloon_send_command(uint16_t out_len, uint16_t *inlen);
+/* send versaloon_buf without waiting, then switch to the other buffer */
+RESULT versaloon_submit_command(uint16_t out_len);
+/* wait for the submitted command, return its buffer holding the reply */
+RESULT versaloon_wait_command(uint8_t **buf, struct versaloon_pending_t **pending,
+		uint16_t *inlen);
+bool versaloon_command_in_flight(void);
 extern uint8_t *versaloon_buf;
-extern uint8_t *versaloon_cmd_buf;
 extern uint16_t versaloon_buf_size;
 
 #endif /* OPENOCD_JTAG_DRIVERS_VERSALOON_VERSALOON_INTERNAL_H */
@@ -317,6 +317,7 @@ static int vsllink_interface_init(void)
 	LOG_DEBUG("vsllink found on %04X:%04X",
 		versaloon_interface.usb_setting.vid,
 		versaloon_interface.usb_setting.pid);
+	versaloon_usb_context = vsllink_handle->libusb_ctx;
 	versaloon_usb_device_handle = vsllink_handle->usb_device_handle;
 
 	if (ERROR_OK != versaloon_interface.init())
@@ -613,11 +614,27 @@ static void vsllink_tap_append_step(int tms, int tdi)
 		vsllink_tap_execute();
 }
 
+static void vsllink_tap_clear_tms(int first, int num)
+{
+	while (num > 0 && (first % 8)) {
+		tms_buffer[first / 8] &= ~(1 << (first % 8));
+		first++;
+		num--;
+	}
+	memset(&tms_buffer[first / 8], 0, num / 8);
+	first += num / 8 * 8;
+	num %= 8;
+	while (num-- > 0) {
+		tms_buffer[first / 8] &= ~(1 << (first % 8));
+		first++;
+	}
+}
+
 static void vsllink_tap_append_scan(int length, uint8_t *buffer,
 	struct scan_command *command)
 {
 	struct pending_scan_result *pending_scan_result;
-	int len_tmp, len_all, i;
+	int len_tmp, len_all;
 
 	len_all = 0;
 	while (len_all < length) {
@@ -642,14 +659,17 @@ static void vsllink_tap_append_scan(int length, uint8_t *buffer,
 		pending_scan_result->buffer = buffer;
 		pending_scan_results_length++;
 
-		for (i = 0; i < len_tmp; i++) {
-			vsllink_tap_append_step(((len_all + i) < length-1
-						 ? 0 : 1),
-				(buffer[(len_all + i)/8]
-				 >> ((len_all + i)%8)) & 1);
-		}
-
+		/* TDI goes in as a whole, TMS is only set on the very last bit */
+		buf_set_buf(buffer, len_all, tdi_buffer, tap_length, len_tmp);
+		vsllink_tap_clear_tms(tap_length, len_tmp);
+		if (len_all + len_tmp == length)
+			tms_buffer[(tap_length + len_tmp - 1) / 8] |=
+				1 << ((tap_length + len_tmp - 1) % 8);
+		tap_length += len_tmp;
 		len_all += len_tmp;
+
+		if (tap_buffer_size * 8 <= tap_length)
+			vsllink_tap_execute();
 	}
 }
 
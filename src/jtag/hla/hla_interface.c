@@ -104,6 +104,70 @@ int hl_interface_init_target(struct target *t)
 	return ERROR_OK;
 }
 
+static int hl_queue_mem(struct hl_interface_s *adapter, bool write, uint32_t addr,
+		uint32_t size, uint32_t count, uint8_t *buffer)
+{
+	if (adapter->mem_queue_len == adapter->mem_queue_size) {
+		unsigned new_size = adapter->mem_queue_size ? 2 * adapter->mem_queue_size : 16;
+		struct hl_mem_op *ops = realloc(adapter->mem_queue, new_size * sizeof(*ops));
+		if (ops == NULL) {
+			adapter->mem_queue_error = ERROR_FAIL;
+			return ERROR_FAIL;
+		}
+		adapter->mem_queue = ops;
+		adapter->mem_queue_size = new_size;
+	}
+
+	struct hl_mem_op *op = &adapter->mem_queue[adapter->mem_queue_len++];
+	op->write = write;
+	op->addr = addr;
+	op->size = size;
+	op->count = count;
+	op->buffer = buffer;
+
+	return ERROR_OK;
+}
+
+int hl_queue_read_mem(struct hl_interface_s *adapter, uint32_t addr,
+		uint32_t size, uint32_t count, uint8_t *buffer)
+{
+	return hl_queue_mem(adapter, false, addr, size, count, buffer);
+}
+
+int hl_queue_write_mem(struct hl_interface_s *adapter, uint32_t addr,
+		uint32_t size, uint32_t count, const uint8_t *buffer)
+{
+	return hl_queue_mem(adapter, true, addr, size, count, (uint8_t *)buffer);
+}
+
+int hl_run_mem_queue(struct hl_interface_s *adapter)
+{
+	const struct hl_layout_api_s *api = adapter->layout->api;
+	struct hl_mem_op *ops = adapter->mem_queue;
+	unsigned count = adapter->mem_queue_len;
+	int retval = adapter->mem_queue_error;
+
+	adapter->mem_queue_len = 0;
+	adapter->mem_queue_error = ERROR_OK;
+
+	if (retval != ERROR_OK || count == 0)
+		return retval;
+
+	if (api->run_mem_queue)
+		return api->run_mem_queue(adapter->handle, ops, count);
+
+	for (unsigned i = 0; i < count && retval == ERROR_OK; i++) {
+		if (ops[i].write)
+			retval = api->write_mem(adapter->handle, ops[i].addr,
+					ops[i].size, ops[i].count, ops[i].buffer);
+		else
+			retval = api->read_mem(adapter->handle, ops[i].addr,
+					ops[i].size, ops[i].count, ops[i].buffer);
+	}
+
+	return retval;
+}
+
 static int hl_interface_init(void)
 {
 	LOG_DEBUG("hl_interface_init");
@@ -119,6 +183,10 @@ static int hl_interface_quit(void)
 	if (hl_if.layout->api->close)
 		hl_if.layout->api->close(hl_if.handle);
 
+	free(hl_if.mem_queue);
+	hl_if.mem_queue = NULL;
+	hl_if.mem_queue_len = hl_if.mem_queue_size = 0;
+
 	return ERROR_OK;
 }
 
@@ -186,6 +254,16 @@ int hl_interface_override_target(const char **targetname)
 	return ERROR_FAIL;
 }
 
+static int hl_interface_check_trace_freq(enum tpio_pin_protocol pin_protocol,
+		unsigned int trace_freq, bool *supported)
+{
+	if (hl_if.layout->api->check_trace_freq)
+		return hl_if.layout->api->check_trace_freq(hl_if.handle, pin_protocol,
+				trace_freq, supported);
+
+	return ERROR_FAIL;
+}
+
 int hl_interface_config_trace(bool enabled, enum tpio_pin_protocol pin_protocol,
 			      uint32_t port_size, unsigned int *trace_freq)
 {
@@ -343,5 +421,6 @@ struct jtag_interface hl_interface = {
 	.khz = &hl_interface_khz,
 	.speed_div = &hl_interface_speed_div,
 	.config_trace = &hl_interface_config_trace,
+	.check_trace_freq = &hl_interface_check_trace_freq,
 	.poll_trace = &hl_interface_poll_trace,
 };
@@ -55,6 +55,12 @@ struct hl_interface_s {
 	const struct hl_layout *layout;
 	/** */
 	void *handle;
+	/** memory accesses queued by hl_queue_read_mem()/hl_queue_write_mem() */
+	struct hl_mem_op *mem_queue;
+	unsigned mem_queue_len;
+	unsigned mem_queue_size;
+	/** a queued access couldn't be recorded */
+	int mem_queue_error;
 };
 
 /** */
@@ -65,4 +71,19 @@ int hl_interface_init_target(struct target *t);
 int hl_interface_init_reset(void);
 int hl_interface_override_target(const char **targetname);
 
+/**
+ * Queue a memory access, performed by the next hl_run_mem_queue().
+ * buffer must stay valid until then, the read data is only there
+ * after hl_run_mem_queue() returned ERROR_OK.
+ */
+int hl_queue_read_mem(struct hl_interface_s *adapter, uint32_t addr,
+		uint32_t size, uint32_t count, uint8_t *buffer);
+int hl_queue_write_mem(struct hl_interface_s *adapter, uint32_t addr,
+		uint32_t size, uint32_t count, const uint8_t *buffer);
+/**
+ * Perform the queued memory accesses in order, pipelined when the
+ * adapter implements hl_layout_api_s::run_mem_queue, and empty the queue.
+ */
+int hl_run_mem_queue(struct hl_interface_s *adapter);
+
 #endif /* OPENOCD_JTAG_HLA_HLA_INTERFACE_H */
@@ -32,6 +32,21 @@ struct hl_interface_param_s;
 extern struct hl_layout_api_s stlink_usb_layout_api;
 extern struct hl_layout_api_s icdi_usb_layout_api;
 
+/** registers returned by hl_layout_api_s::read_regs() */
+#define HLA_CORE_REGS 19
+
+/** One memory access of a batch, see hl_queue_read_mem() */
+struct hl_mem_op {
+	/** write buffer to the target instead of reading into it */
+	bool write;
+	uint32_t addr;
+	/** access width in bytes */
+	uint32_t size;
+	uint32_t count;
+	/** const for writes, the queue doesn't modify it then */
+	uint8_t *buffer;
+};
+
 /** */
 struct hl_layout_api_s {
 	/** */
@@ -48,8 +63,15 @@ struct hl_layout_api_s {
 	int (*halt) (void *handle);
 	/** */
 	int (*step) (void *handle);
-	/** */
-	int (*read_regs) (void *handle);
+	/**
+	 * Optional: read r0..r15, xPSR, MSP and PSP (the DCRSR selectors
+	 * 0 to 18, in that order) with a single adapter command
+	 *
+	 * @param handle A pointer to the device-specific handle
+	 * @param regs Receives the HLA_CORE_REGS register values
+	 * @returns ERROR_OK on success, or an error code on failure.
+	 */
+	int (*read_regs) (void *handle, uint32_t *regs);
 	/** */
 	int (*read_reg) (void *handle, int num, uint32_t *val);
 	/** */
@@ -60,6 +82,18 @@ struct hl_layout_api_s {
 	/** */
 	int (*write_mem) (void *handle, uint32_t addr, uint32_t size,
 			uint32_t count, const uint8_t *buffer);
+	/**
+	 * Optional: perform several memory accesses, in order, with as few
+	 * round trips as the adapter allows. Without it, hl_run_mem_queue()
+	 * calls read_mem() and write_mem() for each access.
+	 *
+	 * @param handle A pointer to the device-specific handle
+	 * @param ops The accesses
+	 * @param count Number of accesses
+	 * @returns ERROR_OK if all accesses succeeded, or the error code of
+	 * the first one that failed.
+	 */
+	int (*run_mem_queue) (void *handle, struct hl_mem_op *ops, unsigned count);
 	/** */
 	int (*write_debug_reg) (void *handle, uint32_t addr, uint32_t val);
 	/**
@@ -93,6 +127,18 @@ struct hl_layout_api_s {
 	 */
 	int (*config_trace)(void *handle, bool enabled, enum tpio_pin_protocol pin_protocol,
 			    uint32_t port_size, unsigned int *trace_freq);
+	/**
+	 * Check whether the adapter can capture trace at a given frequency
+	 *
+	 * @param handle A handle to adapter
+	 * @param pin_protocol Pin protocol to check
+	 * @param trace_freq Trace port frequency to check
+	 * @param supported Set to whether config_trace would accept
+	 * @a trace_freq
+	 * @returns ERROR_OK on success, an error code on failure.
+	 */
+	int (*check_trace_freq)(void *handle, enum tpio_pin_protocol pin_protocol,
+			unsigned int trace_freq, bool *supported);
 	/**
 	 * Poll for new trace data
 	 *
@@ -204,6 +204,11 @@ struct jtag_interface {
 	 */
 	unsigned supported;
 #define DEBUG_CAP_TMS_SEQ	(1 << 0)
+/* JTAG_SLEEP commands shorter than ADAPTER_QUEUED_SLEEP_MAX_US are
+ * executed by the adapter in order with the rest of the queue, without
+ * flushing the queue and sleeping on the host */
+#define DEBUG_CAP_QUEUED_SLEEP	(1 << 1)
+#define ADAPTER_QUEUED_SLEEP_MAX_US	1000
 
 	/** transports supported in C code (NULL terminated vector) */
 	const char * const *transports;
@@ -312,6 +317,19 @@ struct jtag_interface {
 	int (*config_trace)(bool enabled, enum tpio_pin_protocol pin_protocol,
 			    uint32_t port_size, unsigned int *trace_freq);
 
+	/**
+	 * Check whether the adapter can capture trace at a given frequency,
+	 * without changing the trace configuration
+	 *
+	 * @param pin_protocol Pin protocol to check
+	 * @param trace_freq Trace port frequency to check
+	 * @param supported Set to whether config_trace would accept
+	 * @a trace_freq
+	 * @returns ERROR_OK on success, an error code on failure.
+	 */
+	int (*check_trace_freq)(enum tpio_pin_protocol pin_protocol,
+			unsigned int trace_freq, bool *supported);
+
 	/**
 	 * Poll for new trace data
 	 *
@@ -330,6 +348,11 @@ void adapter_assert_reset(void);
 void adapter_deassert_reset(void);
 int adapter_config_trace(bool enabled, enum tpio_pin_protocol pin_protocol,
 			 uint32_t port_size, unsigned int *trace_freq);
+int adapter_check_trace_freq(enum tpio_pin_protocol pin_protocol,
+		unsigned int trace_freq, bool *supported);
 int adapter_poll_trace(uint8_t *buf, size_t *size);
+/** Drivers report parity or CRC errors on the link here, for the speed
+ * monitor (see adapter_speed_monitor_config()). */
+void adapter_report_link_error(void);
 
 #endif /* OPENOCD_JTAG_INTERFACE_H */
@@ -108,6 +108,9 @@ extern struct jtag_interface buspirate_interface;
 #if BUILD_REMOTE_BITBANG == 1
 extern struct jtag_interface remote_bitbang_interface;
 #endif
+#if BUILD_REMOTE_ADAPTER == 1
+extern struct jtag_interface remote_adapter_interface;
+#endif
 #if BUILD_HLADAPTER == 1
 extern struct jtag_interface hl_interface;
 #endif
@@ -120,6 +123,9 @@ extern struct jtag_interface opendous_interface;
 #if BUILD_SYSFSGPIO == 1
 extern struct jtag_interface sysfsgpio_interface;
 #endif
+#if BUILD_LINUXGPIO == 1
+extern struct jtag_interface linuxgpio_interface;
+#endif
 #if BUILD_AICE == 1
 extern struct jtag_interface aice_interface;
 #endif
@@ -207,6 +213,9 @@ struct jtag_interface *jtag_interfaces[] = {
 #if BUILD_REMOTE_BITBANG == 1
 		&remote_bitbang_interface,
 #endif
+#if BUILD_REMOTE_ADAPTER == 1
+		&remote_adapter_interface,
+#endif
 #if BUILD_HLADAPTER == 1
 		&hl_interface,
 #endif
@@ -219,6 +228,9 @@ struct jtag_interface *jtag_interfaces[] = {
 #if BUILD_SYSFSGPIO == 1
 		&sysfsgpio_interface,
 #endif
+#if BUILD_LINUXGPIO == 1
+		&linuxgpio_interface,
+#endif
 #if BUILD_AICE == 1
 		&aice_interface,
 #endif
@@ -170,6 +170,12 @@ struct jtag_tap *jtag_tap_by_position(unsigned abs_position);
 struct jtag_tap *jtag_tap_next_enabled(struct jtag_tap *p);
 unsigned jtag_tap_count_enabled(void);
 unsigned jtag_tap_count(void);
+/**
+ * Returns a counter which changes whenever TAPs are added or removed,
+ * may have been enabled or disabled, or had their IR length probed.
+ * Lets scan code cache the layout of the enabled chain.
+ */
+unsigned jtag_tap_chain_generation(void);
 
 /*
  * - TRST_ASSERTED triggers two sets of callbacks, after operations to
@@ -245,6 +251,22 @@ int jtag_get_speed_readable(int *speed);
 /** Attempt to configure the interface for the specified KHz. */
 int jtag_config_khz(unsigned khz);
 
+/**
+ * Searches the highest adapter speed up to @a max_khz at which the link
+ * passes repeated checks (IDCODE and BYPASS loopback on JTAG, DPIDR
+ * reads on SWD), starting from the current speed, which must pass, and
+ * sets it lowered by @a margin_percent.
+ */
+int adapter_speed_auto(unsigned int max_khz, unsigned int margin_percent);
+/**
+ * Enables or disables lowering the adapter speed, down to @a min_khz,
+ * after drivers reported link errors.
+ */
+void adapter_speed_monitor_config(bool enable, unsigned int min_khz);
+/** Lowers the adapter speed if the monitor is enabled and link errors
+ * were reported since the last call. Called from the target poll loop. */
+void adapter_speed_monitor(void);
+
 /**
  * Attempt to enable RTCK/RCLK. If that fails, fallback to the
  * specified frequency.
@@ -533,6 +555,11 @@ void jtag_add_runtest(int num_cycles, tap_state_t endstate);
  */
 void jtag_add_reset(int req_tlr_or_trst, int srst);
 
+/**
+ * Queues a delay of at least @a us microseconds. Adapters that declare
+ * DEBUG_CAP_QUEUED_SLEEP run short delays themselves, so these don't
+ * cost a round trip to the adapter.
+ */
 void jtag_add_sleep(uint32_t us);
 
 int jtag_add_tms_seq(unsigned nbits, const uint8_t *seq, enum tap_state t);
@@ -572,6 +599,26 @@ void jtag_execute_queue_noclear(void);
 /** @returns the number of times the scan queue has been flushed */
 int jtag_get_flush_queue_count(void);
 
+/**
+ * Flush trace: when enabled, every JTAG queue execution and SWD run
+ * appends a 32 byte little-endian record to a binary file, see
+ * contrib/jtag_flush_trace.py for the layout and an analysis script.
+ */
+enum jtag_trace_kind {
+	JTAG_TRACE_JTAG = 1,	/**< jtag_execute_queue(), bits are TCK cycles */
+	JTAG_TRACE_SWD = 2,	/**< SWD run, bits are data payload bits */
+};
+
+/** Starts tracing to @a filename, or stops it if NULL. */
+int jtag_trace_open(const char *filename);
+/** @returns a start timestamp for jtag_trace_record(), 0 if not tracing */
+int64_t jtag_trace_begin(void);
+/** Appends the record of a flush started at @a begin. */
+void jtag_trace_record(enum jtag_trace_kind kind, int64_t begin,
+		unsigned transactions, unsigned bits, int retval);
+/** Counts a WAIT response, for "perf dump" and the flush being traced. */
+void jtag_trace_wait(void);
+
 /** Report Tcl event to all TAPs */
 void jtag_notify_event(enum jtag_event);
 
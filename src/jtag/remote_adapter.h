@@ -0,0 +1,75 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_JTAG_REMOTE_ADAPTER_H
+#define OPENOCD_JTAG_REMOTE_ADAPTER_H
+
+/**
+ * @file
+ * Protocol between the remote_adapter driver and the remote adapter
+ * server of another OpenOCD, which runs the queues on its own adapter.
+ *
+ * Where remote_bitbang and jtag_vpi send every bit or TAP move, this sends
+ * a whole JTAG queue, or the SWD transfers up to a run(), as one request,
+ * and gets all the captured data back in one reply: one network round trip
+ * per flush.
+ *
+ * A request is a little endian word with the number of bytes that follow,
+ * the request type byte and its operations.  A reply is a word with the
+ * number of bytes that follow, the status (an OpenOCD error code) as a
+ * word and the data.  All words are little endian.
+ */
+
+#define REMOTE_ADAPTER_VERSION		1
+/* no request or reply is larger */
+#define REMOTE_ADAPTER_MAX_MESSAGE	(16 * 1024 * 1024)
+
+/* Request types */
+/* word protocol version, byte 1 for SWD or 0 for JTAG; replies the
+ * status only, an error if the server uses another transport */
+#define REMOTE_ADAPTER_HELLO		'H'
+/* word kHz, 0 for RTCK; replies the resulting kHz as a word */
+#define REMOTE_ADAPTER_SPEED		'F'
+/* JTAG operations, executed with one jtag_execute_queue(); replies the
+ * bytes captured by the scans that ask for them, in order */
+#define REMOTE_ADAPTER_JTAG			'J'
+/* SWD operations, then run(); replies a word for every read */
+#define REMOTE_ADAPTER_SWD			'S'
+
+/* JTAG operations */
+/* byte ir, byte end state, byte capture, byte out, word bits, and the out
+ * bytes unless out is 0 */
+#define REMOTE_ADAPTER_SCAN			's'
+#define REMOTE_ADAPTER_TLR			't'
+/* word cycles, byte end state */
+#define REMOTE_ADAPTER_RUNTEST		'i'
+/* word cycles */
+#define REMOTE_ADAPTER_CLOCKS		'c'
+/* word count, a byte per state */
+#define REMOTE_ADAPTER_PATHMOVE		'p'
+/* word microseconds */
+#define REMOTE_ADAPTER_SLEEP		'z'
+/* byte trst, byte srst */
+#define REMOTE_ADAPTER_RESET		'x'
+
+/* SWD operations */
+/* byte enum swd_special_seq */
+#define REMOTE_ADAPTER_SWD_SEQ		'q'
+/* byte command, word AP delay */
+#define REMOTE_ADAPTER_SWD_READ		'r'
+/* byte command, word value, word AP delay */
+#define REMOTE_ADAPTER_SWD_WRITE	'w'
+
+#endif /* OPENOCD_JTAG_REMOTE_ADAPTER_H */
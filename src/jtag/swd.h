@@ -119,6 +119,16 @@ static const uint8_t swd_seq_dormant_to_swd[] = {
 };
 static const unsigned swd_seq_dormant_to_swd_len = 199;
 
+/**
+ * Check whether the target answers a request with an ACK. A DP write to
+ * address 0xC is TARGETSEL (DPv2 multidrop), which no DP acknowledges so
+ * that all of them can listen to it: its ACK bits must be ignored.
+ */
+static inline bool swd_cmd_returns_ack(uint8_t cmd)
+{
+	return (cmd & (SWD_CMD_APnDP | SWD_CMD_RnW | SWD_CMD_A32)) != (0xc << 1);
+}
+
 enum swd_special_seq {
 	LINE_RESET,
 	JTAG_TO_SWD,
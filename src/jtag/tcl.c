@@ -36,6 +36,7 @@
 #include "interface.h"
 #include "interfaces.h"
 #include "tcl.h"
+#include "commands.h"
 
 #ifdef HAVE_STRINGS_H
 #include <strings.h>
@@ -219,6 +220,198 @@ static int Jim_Command_drscan(Jim_Interp *interp, int argc, Jim_Obj *const *args
 }
 
 
+/* Compare the captured bits of one scan with the expected ones, where
+ * the mask (if any) has them set. */
+static bool batch_scan_matches(const uint8_t *in, const uint8_t *expected,
+	const uint8_t *mask, unsigned bits)
+{
+	unsigned bytes = DIV_ROUND_UP(bits, 8);
+
+	for (unsigned i = 0; i < bytes; i++) {
+		uint8_t m = mask ? mask[i] : 0xff;
+
+		/* the padding of the last byte doesn't count */
+		if (i == bytes - 1 && (bits % 8))
+			m &= (1 << (bits % 8)) - 1;
+		if ((in[i] ^ expected[i]) & m)
+			return false;
+	}
+	return true;
+}
+
+static int jim_jtag_batch(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
+{
+	struct jtag_tap *tap;
+	tap_state_t endstate = TAP_IDLE;
+	const uint8_t *expected = NULL;
+	const uint8_t *mask = NULL;
+	int expected_len = 0, mask_len = 0;
+	int retval;
+
+	/* argv[1] = tap
+	 * argv[2] = layout, a list of {ir|dr num_bits} pairs
+	 * argv[3] = binary string with the bits to shift in, for each
+	 *	vector each scan of the layout in turn, padded to whole bytes
+	 * then optionally "-endstate" statename, "-expected" and "-mask"
+	 * followed by binary strings as long as argv[3]
+	 */
+	if (argc < 4 || (argc % 2) != 0) {
+		Jim_WrongNumArgs(interp, 1, argv, "tap_name layout tdi "
+				"['-endstate' state_name] ['-expected' tdo] ['-mask' mask]");
+		return JIM_ERR;
+	}
+
+	script_debug(interp, "jtag batch", argc, argv);
+
+	tap = jtag_tap_by_jim_obj(interp, argv[1]);
+	if (tap == NULL)
+		return JIM_ERR;
+
+	for (int i = 4; i < argc; i += 2) {
+		const char *opt = Jim_GetString(argv[i], NULL);
+
+		if (strcmp(opt, "-endstate") == 0) {
+			const char *cp = Jim_GetString(argv[i + 1], NULL);
+
+			endstate = tap_state_by_name(cp);
+			if (endstate < 0) {
+				Jim_SetResultFormatted(interp, "endstate: %s invalid", cp);
+				return JIM_ERR;
+			}
+			if (!scan_is_safe(endstate))
+				LOG_WARNING("jtag batch with unsafe endstate \"%s\"", cp);
+		} else if (strcmp(opt, "-expected") == 0) {
+			expected = (const uint8_t *)Jim_GetString(argv[i + 1], &expected_len);
+		} else if (strcmp(opt, "-mask") == 0) {
+			mask = (const uint8_t *)Jim_GetString(argv[i + 1], &mask_len);
+		} else {
+			Jim_SetResultFormatted(interp, "jtag batch: unknown option %s", opt);
+			return JIM_ERR;
+		}
+	}
+
+	/* the layout of one vector */
+	int layout_len = Jim_ListLength(interp, argv[2]);
+	if (layout_len <= 0 || (layout_len % 2) != 0) {
+		Jim_SetResultString(interp, "jtag batch: layout needs {ir|dr num_bits} pairs", -1);
+		return JIM_ERR;
+	}
+
+	unsigned num_scans = layout_len / 2;
+	bool *is_ir = malloc(num_scans * sizeof(*is_ir));
+	unsigned *bits = malloc(num_scans * sizeof(*bits));
+	struct scan_field *fields = NULL;
+	uint8_t *in = NULL;
+	unsigned vector_bytes = 0;
+	int e = JIM_ERR;
+
+	if (is_ir == NULL || bits == NULL) {
+		Jim_SetResultString(interp, "jtag batch: out of memory", -1);
+		goto done;
+	}
+
+	for (unsigned i = 0; i < num_scans; i++) {
+		Jim_Obj *kind = Jim_ListGetIndex(interp, argv[2], 2 * i);
+		const char *cp = Jim_GetString(kind, NULL);
+		long n;
+
+		if (strcmp(cp, "ir") == 0)
+			is_ir[i] = true;
+		else if (strcmp(cp, "dr") == 0)
+			is_ir[i] = false;
+		else {
+			Jim_SetResultFormatted(interp, "jtag batch: scan type %s invalid", cp);
+			goto done;
+		}
+
+		if (Jim_GetLong(interp, Jim_ListGetIndex(interp, argv[2], 2 * i + 1), &n) != JIM_OK)
+			goto done;
+		if (n <= 0 || (is_ir[i] && n != tap->ir_length)) {
+			Jim_SetResultFormatted(interp, "jtag batch: %s scan of %d bits invalid",
+					cp, (int)n);
+			goto done;
+		}
+
+		bits[i] = n;
+		vector_bytes += DIV_ROUND_UP(n, 8);
+	}
+
+	int tdi_len;
+	const uint8_t *tdi = (const uint8_t *)Jim_GetString(argv[3], &tdi_len);
+
+	if (tdi_len == 0 || (tdi_len % vector_bytes) != 0) {
+		Jim_SetResultFormatted(interp, "jtag batch: tdi must hold whole vectors "
+				"of %d bytes", (int)vector_bytes);
+		goto done;
+	}
+	if ((expected && expected_len != tdi_len) || (mask && mask_len != tdi_len)) {
+		Jim_SetResultString(interp, "jtag batch: expected and mask must be "
+				"as long as tdi", -1);
+		goto done;
+	}
+	if (mask && !expected) {
+		Jim_SetResultString(interp, "jtag batch: mask without expected", -1);
+		goto done;
+	}
+
+	unsigned num_vectors = tdi_len / vector_bytes;
+	fields = malloc(num_vectors * num_scans * sizeof(*fields));
+	in = malloc(tdi_len);
+	if (fields == NULL || in == NULL) {
+		Jim_SetResultString(interp, "jtag batch: out of memory", -1);
+		goto done;
+	}
+
+	/* queue everything, then flush once */
+	unsigned offset = 0;
+	for (unsigned v = 0; v < num_vectors; v++) {
+		for (unsigned i = 0; i < num_scans; i++) {
+			struct scan_field *field = fields + v * num_scans + i;
+
+			field->num_bits = bits[i];
+			field->out_value = tdi + offset;
+			field->in_value = in + offset;
+			offset += DIV_ROUND_UP(bits[i], 8);
+
+			if (is_ir[i])
+				jtag_add_ir_scan(tap, field, endstate);
+			else
+				jtag_add_dr_scan(tap, 1, field, endstate);
+		}
+	}
+
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK) {
+		Jim_SetResultString(interp, "jtag batch: jtag execute failed", -1);
+		goto done;
+	}
+
+	if (expected) {
+		/* indices of the scans which didn't match */
+		Jim_Obj *list = Jim_NewListObj(interp, NULL, 0);
+
+		for (unsigned j = 0; j < num_vectors * num_scans; j++) {
+			struct scan_field *field = fields + j;
+			unsigned off = field->in_value - in;
+
+			if (!batch_scan_matches(field->in_value, expected + off,
+					mask ? mask + off : NULL, field->num_bits))
+				Jim_ListAppendElement(interp, list, Jim_NewIntObj(interp, j));
+		}
+		Jim_SetResult(interp, list);
+	} else
+		Jim_SetResult(interp, Jim_NewStringObj(interp, (const char *)in, tdi_len));
+
+	e = JIM_OK;
+
+done:
+	free(in);
+	free(fields);
+	free(bits);
+	free(is_ir);
+	return e;
+}
+
 static int Jim_Command_pathmove(Jim_Interp *interp, int argc, Jim_Obj *const *args)
 {
 	tap_state_t states[8];
@@ -831,6 +1024,43 @@ COMMAND_HANDLER(handle_jtag_init_command)
 	return jtag_init(CMD_CTX);
 }
 
+COMMAND_HANDLER(handle_jtag_queue_stats_command)
+{
+	struct cmd_queue_stats stats;
+	bool reset = false;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		reset = true;
+	}
+
+	jtag_command_queue_stats(&stats, reset);
+
+	command_print(CMD_CTX, "flushes %lu, bytes %llu (%llu per flush, peak %zu)",
+		stats.flushes, stats.bytes,
+		stats.flushes ? stats.bytes / stats.flushes : 0, stats.peak_bytes);
+	command_print(CMD_CTX, "pages allocated %lu, reused %lu, cached %u",
+		stats.pages_allocated, stats.pages_reused, stats.pages_cached);
+	command_print(CMD_CTX, "commands merged or dropped %lu",
+		stats.commands_removed);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_jtag_trace_flushes_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (strcmp(CMD_ARGV[0], "off") == 0)
+		return jtag_trace_open(NULL);
+
+	return jtag_trace_open(CMD_ARGV[0]);
+}
+
 static const struct command_registration jtag_subcommand_handlers[] = {
 	{
 		.name = "init",
@@ -913,6 +1143,33 @@ static const struct command_registration jtag_subcommand_handlers[] = {
 		.jim_handler = jim_jtag_names,
 		.help = "Returns list of all JTAG tap names.",
 	},
+	{
+		.name = "queue_stats",
+		.mode = COMMAND_EXEC,
+		.handler = handle_jtag_queue_stats_command,
+		.help = "Show (and optionally reset) statistics of the memory "
+			"backing the JTAG command queue.",
+		.usage = "['reset']",
+	},
+	{
+		.name = "batch",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_jtag_batch,
+		.help = "Queue IR and DR scans of one TAP for many vectors "
+			"given as a binary string, run them with a single "
+			"queue flush and return the captured bits, or the "
+			"indices of the scans which didn't match.",
+		.usage = "tap_name layout tdi ['-endstate' state_name] "
+			"['-expected' tdo] ['-mask' mask]",
+	},
+	{
+		.name = "trace_flushes",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_trace_flushes_command,
+		.help = "Record a binary trace of JTAG and SWD queue flushes "
+			"to a file, or stop recording.",
+		.usage = "filename|'off'",
+	},
 	{
 		.chain = jtag_command_handlers_to_move,
 	},
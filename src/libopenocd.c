@@ -0,0 +1,206 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "libopenocd.h"
+#include <jtag/jtag.h>
+#include <helper/ioutil.h>
+#include <helper/util.h>
+#include <helper/configuration.h>
+#include <server/server.h>
+#include <target/target.h>
+
+struct libopenocd {
+	struct command_context *cmd_ctx;
+	libopenocd_event_fn event_fn;
+	void *event_priv;
+	/* output of libopenocd_command(), when asked for */
+	bool capture;
+	char *output;
+	size_t output_len;
+};
+
+/* there is only one OpenOCD per process */
+static struct libopenocd *libopenocd_instance;
+
+/* see src/openocd.c */
+struct command_context *setup_command_handler(Jim_Interp *interp);
+
+static int libopenocd_output_handler(struct command_context *context, const char *line)
+{
+	struct libopenocd *ocd = context->output_handler_priv;
+	size_t len = strlen(line);
+
+	if (!ocd->capture)
+		return configuration_output_handler(context, line);
+
+	char *output = realloc(ocd->output, ocd->output_len + len + 1);
+	if (output == NULL)
+		return ERROR_FAIL;
+	memcpy(output + ocd->output_len, line, len + 1);
+	ocd->output = output;
+	ocd->output_len += len;
+	return ERROR_OK;
+}
+
+static int libopenocd_event_handler(struct target *target,
+		enum target_event event, void *priv)
+{
+	struct libopenocd *ocd = priv;
+
+	if (ocd->event_fn)
+		ocd->event_fn(target_name(target), target_event_name(event), ocd->event_priv);
+	return ERROR_OK;
+}
+
+struct libopenocd *libopenocd_init(int argc, char *argv[])
+{
+	if (libopenocd_instance)
+		return NULL;
+
+	struct libopenocd *ocd = calloc(1, sizeof(*ocd));
+	if (ocd == NULL)
+		return NULL;
+
+	ocd->cmd_ctx = setup_command_handler(NULL);
+	if (ocd->cmd_ctx == NULL) {
+		free(ocd);
+		return NULL;
+	}
+	libopenocd_instance = ocd;
+
+	command_context_mode(ocd->cmd_ctx, COMMAND_CONFIG);
+	command_set_output_handler(ocd->cmd_ctx, libopenocd_output_handler, ocd);
+
+	if (util_init(ocd->cmd_ctx) != ERROR_OK
+			|| ioutil_init(ocd->cmd_ctx) != ERROR_OK
+			|| parse_cmdline_args(ocd->cmd_ctx, argc, argv) != ERROR_OK
+			|| parse_config_file(ocd->cmd_ctx) != ERROR_OK
+			|| command_run_line(ocd->cmd_ctx, "init") != ERROR_OK) {
+		libopenocd_quit(ocd);
+		return NULL;
+	}
+
+	if (target_register_event_callback(libopenocd_event_handler, ocd) != ERROR_OK) {
+		libopenocd_quit(ocd);
+		return NULL;
+	}
+
+	return ocd;
+}
+
+void libopenocd_quit(struct libopenocd *ocd)
+{
+	if (ocd == NULL)
+		return;
+
+	target_unregister_event_callback(libopenocd_event_handler, ocd);
+	server_quit();
+
+	unregister_all_commands(ocd->cmd_ctx, NULL);
+	command_done(ocd->cmd_ctx);
+
+	adapter_quit();
+
+	free(ocd->output);
+	free(ocd);
+	libopenocd_instance = NULL;
+}
+
+int libopenocd_command(struct libopenocd *ocd, const char *line, char **output)
+{
+	char *copy = strdup(line);
+	if (copy == NULL)
+		return ERROR_FAIL;
+
+	ocd->capture = output != NULL;
+	ocd->output = NULL;
+	ocd->output_len = 0;
+
+	int retval = command_run_line(ocd->cmd_ctx, copy);
+	free(copy);
+
+	ocd->capture = false;
+	if (output) {
+		*output = ocd->output ? ocd->output : strdup("");
+		ocd->output = NULL;
+	}
+	return retval;
+}
+
+static struct target *libopenocd_target(struct libopenocd *ocd, const char *name)
+{
+	struct target *target;
+
+	if (name)
+		target = get_target(name);
+	else
+		target = get_current_target(ocd->cmd_ctx);
+	if (target == NULL)
+		LOG_ERROR("no target %s", name ? name : "selected");
+	return target;
+}
+
+int libopenocd_read_memory(struct libopenocd *ocd, const char *name,
+		uint32_t address, void *buffer, size_t size)
+{
+	struct target *target = libopenocd_target(ocd, name);
+	if (target == NULL)
+		return ERROR_FAIL;
+
+	return target_read_buffer(target, address, size, buffer);
+}
+
+int libopenocd_write_memory(struct libopenocd *ocd, const char *name,
+		uint32_t address, const void *buffer, size_t size)
+{
+	struct target *target = libopenocd_target(ocd, name);
+	if (target == NULL)
+		return ERROR_FAIL;
+
+	return target_write_buffer(target, address, size, buffer);
+}
+
+int libopenocd_program(struct libopenocd *ocd, const char *filename, uint32_t offset)
+{
+	/* the steps of the "program" procedure, which only reports failure
+	 * by text unless it is asked to exit */
+	int retval = command_run_line(ocd->cmd_ctx, "reset init");
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = command_run_linef(ocd->cmd_ctx, "flash write_image erase {%s} 0x%" PRIx32,
+			filename, offset);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return command_run_linef(ocd->cmd_ctx, "verify_image {%s} 0x%" PRIx32,
+			filename, offset);
+}
+
+void libopenocd_set_event_callback(struct libopenocd *ocd,
+		libopenocd_event_fn callback, void *priv)
+{
+	ocd->event_fn = callback;
+	ocd->event_priv = priv;
+}
+
+void libopenocd_poll(struct libopenocd *ocd)
+{
+	target_call_timer_callbacks();
+}
@@ -0,0 +1,95 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_LIBOPENOCD_H
+#define OPENOCD_LIBOPENOCD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * C API to run OpenOCD inside another program.
+ *
+ * The configuration is given as on the openocd command line, then the
+ * adapter and targets stay initialized until libopenocd_quit(), so one
+ * process can run any number of operations without reopening the adapter
+ * or examining the targets again.  Memory moves through binary buffers;
+ * anything else is reachable through libopenocd_command().
+ *
+ * OpenOCD keeps global state: there can be only one instance per
+ * process, and it must only be used from one thread at a time.  The GDB
+ * server is started as by the openocd program unless the configuration
+ * says "gdb_port disabled"; the Tcl and telnet servers are not started.
+ *
+ * Functions returning int return 0 on success and a negative OpenOCD
+ * error code otherwise.
+ */
+
+struct libopenocd;
+
+/**
+ * Start OpenOCD: parse @a argv like the openocd command line (-f, -c, -s,
+ * -d, -l), run the configuration and "init".
+ * @returns The instance, or NULL if the configuration or init failed or
+ * an instance already exists.
+ */
+struct libopenocd *libopenocd_init(int argc, char *argv[]);
+
+/** Shut down the targets and close the adapter, @a ocd is freed. */
+void libopenocd_quit(struct libopenocd *ocd);
+
+/**
+ * Run a Tcl command line.
+ * @param output If not NULL, receives the text the command printed and its
+ * result; free() it after use.
+ */
+int libopenocd_command(struct libopenocd *ocd, const char *line, char **output);
+
+/**
+ * Read or write target memory.  @a target is a target name, or NULL for
+ * the current target.
+ */
+int libopenocd_read_memory(struct libopenocd *ocd, const char *target,
+		uint32_t address, void *buffer, size_t size);
+int libopenocd_write_memory(struct libopenocd *ocd, const char *target,
+		uint32_t address, const void *buffer, size_t size);
+
+/**
+ * Program an image file into flash, as the "program" command: erase,
+ * write and verify.  @a offset is added to the image addresses, as for a
+ * raw binary.
+ */
+int libopenocd_program(struct libopenocd *ocd, const char *filename, uint32_t offset);
+
+/**
+ * Called for target events ("halted", "resumed", "reset-end", ...) with
+ * the name of the target and of the event, see "Target Events" in the
+ * user guide.
+ */
+typedef void (*libopenocd_event_fn)(const char *target, const char *event, void *priv);
+
+/** Set the event callback, or remove it with NULL. */
+void libopenocd_set_event_callback(struct libopenocd *ocd,
+		libopenocd_event_fn callback, void *priv);
+
+/**
+ * Run the timer callbacks that are due, background polling among them,
+ * which is how halts are noticed.  Call this regularly while waiting for
+ * target events; the openocd program does it from its server loop.
+ */
+void libopenocd_poll(struct libopenocd *ocd);
+
+#endif /* OPENOCD_LIBOPENOCD_H */
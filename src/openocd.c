@@ -27,12 +27,15 @@
 #endif
 
 #include "openocd.h"
+#include "benchmark.h"
 #include <jtag/driver.h>
 #include <jtag/jtag.h>
 #include <transport/transport.h>
 #include <helper/ioutil.h>
 #include <helper/util.h>
 #include <helper/configuration.h>
+#include <helper/time_support.h>
+#include <helper/perf.h>
 #include <flash/nor/core.h>
 #include <flash/nand/core.h>
 #include <pld/pld.h>
@@ -122,6 +125,9 @@ COMMAND_HANDLER(handle_init_command)
 
 	initialized = 1;
 
+	/* startup timing, see the LOG_DEBUG() at the end */
+	int64_t start = timeval_ms(), adapter_ms, transport_ms, examine_ms;
+
 	retval = command_run_line(CMD_CTX, "target init");
 	if (ERROR_OK != retval)
 		return ERROR_FAIL;
@@ -133,6 +139,7 @@ COMMAND_HANDLER(handle_init_command)
 	}
 
 	LOG_DEBUG("Debug Adapter init complete");
+	adapter_ms = timeval_ms();
 
 	/* "transport init" verifies the expected devices are present;
 	 * for JTAG, it checks the list of configured TAPs against
@@ -145,9 +152,12 @@ COMMAND_HANDLER(handle_init_command)
 	if (ERROR_OK != retval)
 		return ERROR_FAIL;
 
+	transport_ms = timeval_ms();
+
 	LOG_DEBUG("Examining targets...");
 	if (target_examine() != ERROR_OK)
 		LOG_DEBUG("target examination failed");
+	examine_ms = timeval_ms();
 
 	command_context_mode(CMD_CTX, COMMAND_CONFIG);
 
@@ -169,6 +179,11 @@ COMMAND_HANDLER(handle_init_command)
 
 	target_register_event_callback(log_target_callback_event_handler, CMD_CTX);
 
+	LOG_DEBUG("init took %" PRId64 " ms: adapter %" PRId64 ", transport %" PRId64
+			", examine %" PRId64 ", flash and others %" PRId64,
+			timeval_ms() - start, adapter_ms - start, transport_ms - adapter_ms,
+			examine_ms - transport_ms, timeval_ms() - examine_ms);
+
 	return ERROR_OK;
 }
 
@@ -231,7 +246,9 @@ struct command_context *setup_command_handler(Jim_Interp *interp)
 	log_init();
 	LOG_DEBUG("log_init: complete");
 
+	int64_t start = timeval_ms();
 	struct command_context *cmd_ctx = command_init(openocd_startup_tcl, interp);
+	int64_t startup_tcl_ms = timeval_ms();
 
 	/* register subsystem commands */
 	typedef int (*command_registrant_t)(struct command_context *cmd_ctx_value);
@@ -240,6 +257,8 @@ struct command_context *setup_command_handler(Jim_Interp *interp)
 		&server_register_commands,
 		&gdb_register_commands,
 		&log_register_commands,
+		&perf_register_commands,
+		&benchmark_register_commands,
 		&transport_register_commands,
 		&interface_register_commands,
 		&target_register_commands,
@@ -256,7 +275,9 @@ struct command_context *setup_command_handler(Jim_Interp *interp)
 			return NULL;
 		}
 	}
-	LOG_DEBUG("command registration: complete");
+	LOG_DEBUG("command registration: complete, startup.tcl %" PRId64
+			" ms, registration %" PRId64 " ms", startup_tcl_ms - start,
+			timeval_ms() - startup_tcl_ms);
 
 	LOG_OUTPUT(OPENOCD_VERSION "\n"
 		"Licensed under GNU GPL v2\n");
@@ -280,11 +301,13 @@ static int openocd_thread(int argc, char *argv[], struct command_context *cmd_ct
 	if (server_preinit() != ERROR_OK)
 		return ERROR_FAIL;
 
+	int64_t start = timeval_ms();
 	ret = parse_config_file(cmd_ctx);
 	if (ret == ERROR_COMMAND_CLOSE_CONNECTION)
 		return ERROR_OK;
 	else if (ret != ERROR_OK)
 		return ERROR_FAIL;
+	LOG_DEBUG("configuration took %" PRId64 " ms", timeval_ms() - start);
 
 	ret = server_init(cmd_ctx);
 	if (ERROR_OK != ret)
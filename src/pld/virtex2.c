@@ -24,6 +24,9 @@
 #include "xilinx_bit.h"
 #include "pld.h"
 
+/* bytes of configuration data per DR scan when loading a bitstream */
+#define VIRTEX2_LOAD_CHUNK	(64 * 1024)
+
 static int virtex2_set_instr(struct jtag_tap *tap, uint32_t new_instr)
 {
 	if (tap == NULL)
@@ -130,15 +133,22 @@ static int virtex2_load(struct pld_device *pld_device, const char *filename)
 	struct virtex2_pld_device *virtex2_info = pld_device->driver_priv;
 	struct xilinx_bit_file bit_file;
 	int retval;
-	unsigned int i;
+	uint32_t left, chunk;
+	uint8_t *buffer;
 	struct scan_field field;
 
 	field.in_value = NULL;
 
-	retval = xilinx_read_bit_file(&bit_file, filename);
+	retval = xilinx_open_bit_file(&bit_file, filename);
 	if (retval != ERROR_OK)
 		return retval;
 
+	buffer = malloc(MIN(bit_file.length, VIRTEX2_LOAD_CHUNK));
+	if (!buffer) {
+		xilinx_close_bit_file(&bit_file);
+		return ERROR_FAIL;
+	}
+
 	virtex2_set_instr(virtex2_info->tap, 0xb);	/* JPROG_B */
 	jtag_execute_queue();
 	jtag_add_sleep(1000);
@@ -146,16 +156,36 @@ static int virtex2_load(struct pld_device *pld_device, const char *filename)
 	virtex2_set_instr(virtex2_info->tap, 0x5);	/* CFG_IN */
 	jtag_execute_queue();
 
-	for (i = 0; i < bit_file.length; i++)
-		bit_file.data[i] = flip_u32(bit_file.data[i], 8);
-
-	field.num_bits = bit_file.length * 8;
-	field.out_value = bit_file.data;
+	/* Stream the configuration data through one buffer, flushing the queue
+	 * per chunk so neither the file nor the queue ever holds all of it.
+	 * All chunks but the last end in DRSHIFT, so the device still sees a
+	 * single continuous shift. */
+	for (left = bit_file.length; left > 0; left -= chunk) {
+		chunk = MIN(left, VIRTEX2_LOAD_CHUNK);
+
+		retval = xilinx_read_bit_data(&bit_file, buffer, chunk);
+		if (retval != ERROR_OK)
+			break;
+		buf_flip_bytes(buffer, chunk);
+
+		field.num_bits = chunk * 8;
+		field.out_value = buffer;
+
+		jtag_add_dr_scan(virtex2_info->tap, 1, &field,
+				left > chunk ? TAP_DRSHIFT : TAP_DRPAUSE);
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			break;
+	}
 
-	jtag_add_dr_scan(virtex2_info->tap, 1, &field, TAP_DRPAUSE);
-	jtag_execute_queue();
+	free(buffer);
+	xilinx_close_bit_file(&bit_file);
 
 	jtag_add_tlr();
+	if (retval != ERROR_OK) {
+		jtag_execute_queue();
+		return retval;
+	}
 
 	if (!(virtex2_info->no_jstart))
 		virtex2_set_instr(virtex2_info->tap, 0xc);	/* JSTART */
@@ -166,9 +196,7 @@ static int virtex2_load(struct pld_device *pld_device, const char *filename)
 		virtex2_set_instr(virtex2_info->tap, 0xc);	/* JSTART */
 	jtag_add_runtest(13, TAP_IDLE);
 	virtex2_set_instr(virtex2_info->tap, 0x3f);		/* BYPASS */
-	jtag_execute_queue();
-
-	return ERROR_OK;
+	return jtag_execute_queue();
 }
 
 COMMAND_HANDLER(virtex2_handle_read_stat_command)
@@ -59,24 +59,32 @@ static int read_section(FILE *input_file, int length_size, char section,
 	if (buffer_length)
 		*buffer_length = length;
 
-	*buffer = malloc(length);
+	/* leave the payload in the file, the caller streams it */
+	if (!buffer)
+		return ERROR_OK;
+
+	*buffer = malloc(length + 1);
+	if (!*buffer)
+		return ERROR_PLD_FILE_LOAD_FAILED;
 
 	read_count = fread(*buffer, 1, length, input_file);
 	if (read_count != length)
 		return ERROR_PLD_FILE_LOAD_FAILED;
+	(*buffer)[length] = 0;
 
 	return ERROR_OK;
 }
 
-int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
+int xilinx_open_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
 {
-	FILE *input_file;
 	struct stat input_stat;
 	int read_count;
 
 	if (!filename || !bit_file)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
+	memset(bit_file, 0, sizeof(*bit_file));
+
 	if (stat(filename, &input_stat) == -1) {
 		LOG_ERROR("couldn't stat() %s: %s", filename, strerror(errno));
 		return ERROR_PLD_FILE_LOAD_FAILED;
@@ -92,37 +100,65 @@ int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
 		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
 
-	input_file = fopen(filename, "rb");
-	if (input_file == NULL) {
+	bit_file->input_file = fopen(filename, "rb");
+	if (bit_file->input_file == NULL) {
 		LOG_ERROR("couldn't open %s: %s", filename, strerror(errno));
 		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
 
-	read_count = fread(bit_file->unknown_header, 1, 13, input_file);
+	read_count = fread(bit_file->unknown_header, 1, 13, bit_file->input_file);
 	if (read_count != 13) {
 		LOG_ERROR("couldn't read unknown_header from file '%s'", filename);
-		return ERROR_PLD_FILE_LOAD_FAILED;
+		goto error;
 	}
 
-	if (read_section(input_file, 2, 'a', NULL, &bit_file->source_file) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(bit_file->input_file, 2, 'a', NULL, &bit_file->source_file) != ERROR_OK)
+		goto error;
 
-	if (read_section(input_file, 2, 'b', NULL, &bit_file->part_name) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(bit_file->input_file, 2, 'b', NULL, &bit_file->part_name) != ERROR_OK)
+		goto error;
 
-	if (read_section(input_file, 2, 'c', NULL, &bit_file->date) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(bit_file->input_file, 2, 'c', NULL, &bit_file->date) != ERROR_OK)
+		goto error;
 
-	if (read_section(input_file, 2, 'd', NULL, &bit_file->time) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(bit_file->input_file, 2, 'd', NULL, &bit_file->time) != ERROR_OK)
+		goto error;
 
-	if (read_section(input_file, 4, 'e', &bit_file->length, &bit_file->data) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(bit_file->input_file, 4, 'e', &bit_file->length, NULL) != ERROR_OK)
+		goto error;
 
 	LOG_DEBUG("bit_file: %s %s %s,%s %" PRIi32 "", bit_file->source_file, bit_file->part_name,
 		bit_file->date, bit_file->time, bit_file->length);
 
-	fclose(input_file);
+	return ERROR_OK;
+
+error:
+	xilinx_close_bit_file(bit_file);
+	return ERROR_PLD_FILE_LOAD_FAILED;
+}
+
+int xilinx_read_bit_data(struct xilinx_bit_file *bit_file, uint8_t *buffer, uint32_t size)
+{
+	if (fread(buffer, 1, size, bit_file->input_file) != size) {
+		LOG_ERROR("bit file is shorter than its header says");
+		return ERROR_PLD_FILE_LOAD_FAILED;
+	}
 
 	return ERROR_OK;
 }
+
+void xilinx_close_bit_file(struct xilinx_bit_file *bit_file)
+{
+	if (bit_file->input_file)
+		fclose(bit_file->input_file);
+	bit_file->input_file = NULL;
+
+	free(bit_file->source_file);
+	free(bit_file->part_name);
+	free(bit_file->date);
+	free(bit_file->time);
+	bit_file->source_file = NULL;
+	bit_file->part_name = NULL;
+	bit_file->date = NULL;
+	bit_file->time = NULL;
+}
@@ -19,6 +19,8 @@
 #ifndef OPENOCD_PLD_XILINX_BIT_H
 #define OPENOCD_PLD_XILINX_BIT_H
 
+#include <stdio.h>
+
 struct xilinx_bit_file {
 	uint8_t unknown_header[13];
 	uint8_t *source_file;
@@ -26,9 +28,17 @@ struct xilinx_bit_file {
 	uint8_t *date;
 	uint8_t *time;
 	uint32_t length;
-	uint8_t *data;
+	FILE *input_file;
 };
 
-int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename);
+/**
+ * Opens a .bit file and parses its header. On success the file is left
+ * positioned at the configuration data, length bytes of it, which are
+ * read with xilinx_read_bit_data() so they never have to be held in
+ * memory at once.
+ */
+int xilinx_open_bit_file(struct xilinx_bit_file *bit_file, const char *filename);
+int xilinx_read_bit_data(struct xilinx_bit_file *bit_file, uint8_t *buffer, uint32_t size);
+void xilinx_close_bit_file(struct xilinx_bit_file *bit_file);
 
 #endif /* OPENOCD_PLD_XILINX_BIT_H */
@@ -304,9 +304,6 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 	/* wipe out previous thread details if any */
 	rtos_free_threadlist(rtos);
 
-	/* ChibiOS does not save the current thread count. We have to first
-	 * parse the double linked thread list to check for errors and the number of
-	 * threads. */
 	const uint32_t rlist = rtos->symbols[ChibiOS_VAL_rlist].address ?
 		rtos->symbols[ChibiOS_VAL_rlist].address :
 		rtos->symbols[ChibiOS_VAL_ch].address + CH_RLIST_OFFSET /* ChibiOS3 */;
@@ -315,15 +312,44 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 	uint32_t previous;
 	uint32_t older;
 
-	current = rlist;
+	/* The ready list header shares the newer/older links with the thread
+	 * structure and holds the current thread where a thread has its name
+	 * pointer (by design, cf_off_name equals readylist_current_offset). */
+	unsigned rlist_size = MAX(MAX(signature->cf_off_newer, signature->cf_off_older),
+			signature->cf_off_name) + 4;
+	/* Each thread is fetched with one read covering every field used
+	 * below, the fields are then extracted on the host. */
+	unsigned thread_size = MAX(rlist_size, signature->cf_off_state + 1u);
+	uint8_t *rlist_buf = malloc(rlist_size);
+	uint8_t *thread_buf = malloc(thread_size);
+	struct {
+		uint32_t addr;
+		uint32_t name_ptr;
+		uint8_t state;
+	} *threads = NULL;
+	int threads_allocated = 0;
+
+	if (!rlist_buf || !thread_buf) {
+		LOG_ERROR("Could not allocate space for ChibiOS thread structures");
+		free(rlist_buf);
+		free(thread_buf);
+		return -1;
+	}
+
+	retval = target_read_buffer(rtos->target, rlist, rlist_size, rlist_buf);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Could not read next ChibiOS thread");
+		free(rlist_buf);
+		free(thread_buf);
+		return retval;
+	}
+
+	/* ChibiOS does not save the current thread count. We have to
+	 * parse the double linked thread list to check for errors and the number of
+	 * threads, collecting each thread's fields on the way. */
+	current = target_buffer_get_u32(rtos->target, rlist_buf + signature->cf_off_newer);
 	previous = rlist;
 	while (1) {
-		retval = target_read_u32(rtos->target,
-								 current + signature->cf_off_newer, &current);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Could not read next ChibiOS thread");
-			return retval;
-		}
 		/* Could be NULL if the kernel is not initialized yet or if the
 		 * registry is corrupted. */
 		if (current == 0) {
@@ -332,21 +358,52 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 			rtos_valid = 0;
 			break;
 		}
+		/* Check for full iteration of the linked list. */
+		if (current == rlist) {
+			older = target_buffer_get_u32(rtos->target,
+					rlist_buf + signature->cf_off_older);
+			if (older != previous) {
+				LOG_ERROR("ChibiOS registry integrity check failed, "
+							"double linked list violation");
+				rtos_valid = 0;
+			}
+			break;
+		}
+
+		retval = target_read_buffer(rtos->target, current, thread_size, thread_buf);
 		/* Fetch previous thread in the list as a integrity check. */
-		retval = target_read_u32(rtos->target,
-								 current + signature->cf_off_older, &older);
+		older = target_buffer_get_u32(rtos->target, thread_buf + signature->cf_off_older);
 		if ((retval != ERROR_OK) || (older == 0) || (older != previous)) {
 			LOG_ERROR("ChibiOS registry integrity check failed, "
 						"double linked list violation");
 			rtos_valid = 0;
 			break;
 		}
-		/* Check for full iteration of the linked list. */
-		if (current == rlist)
-			break;
+
+		if (tasks_found == threads_allocated) {
+			void *grown = realloc(threads,
+					(threads_allocated * 2 + 8) * sizeof(*threads));
+			if (!grown) {
+				LOG_ERROR("Could not allocate space for thread details");
+				free(threads);
+				free(rlist_buf);
+				free(thread_buf);
+				return -1;
+			}
+			threads = grown;
+			threads_allocated = threads_allocated * 2 + 8;
+		}
+		threads[tasks_found].addr = current;
+		threads[tasks_found].name_ptr = target_buffer_get_u32(rtos->target,
+				thread_buf + signature->cf_off_name);
+		threads[tasks_found].state = thread_buf[signature->cf_off_state];
 		tasks_found++;
+
 		previous = current;
+		current = target_buffer_get_u32(rtos->target, thread_buf + signature->cf_off_newer);
 	}
+	free(thread_buf);
+
 	if (!rtos_valid) {
 		/* No RTOS, there is always at least the current execution, though */
 		LOG_INFO("Only showing current execution because of a broken "
@@ -355,6 +412,9 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 		const char tmp_thread_name[] = "Current Execution";
 		const char tmp_thread_extra_info[] = "No RTOS thread";
 
+		free(threads);
+		free(rlist_buf);
+
 		rtos->thread_details = malloc(
 				sizeof(struct thread_detail));
 		rtos->thread_details->threadid = 1;
@@ -374,49 +434,34 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 		return ERROR_OK;
 	}
 
+	rtos->current_thread = target_buffer_get_u32(rtos->target,
+			rlist_buf + signature->cf_off_name);
+	free(rlist_buf);
+
 	/* create space for new thread details */
 	rtos->thread_details = malloc(
-			sizeof(struct thread_detail) * tasks_found);
+			sizeof(struct thread_detail) * (tasks_found ? tasks_found : 1));
 	if (!rtos->thread_details) {
 		LOG_ERROR("Could not allocate space for thread details");
+		free(threads);
 		return -1;
 	}
 
-	rtos->thread_count = tasks_found;
-	/* Loop through linked list. */
-	struct thread_detail *curr_thrd_details = rtos->thread_details;
-	while (curr_thrd_details < rtos->thread_details + tasks_found) {
-		uint32_t name_ptr = 0;
+	/* Fill in the threads found by the walk. */
+	for (int i = 0; i < tasks_found; i++) {
+		struct thread_detail *curr_thrd_details = &rtos->thread_details[i];
 		char tmp_str[CHIBIOS_THREAD_NAME_STR_SIZE];
 
-		retval = target_read_u32(rtos->target,
-								 current + signature->cf_off_newer, &current);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Could not read next ChibiOS thread");
-			return -6;
-		}
-
-		/* Check for full iteration of the linked list. */
-		if (current == rlist)
-			break;
-
 		/* Save the thread pointer */
-		curr_thrd_details->threadid = current;
-
-		/* read the name pointer */
-		retval = target_read_u32(rtos->target,
-								 current + signature->cf_off_name, &name_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Could not read ChibiOS thread name pointer from target");
-			return retval;
-		}
+		curr_thrd_details->threadid = threads[i].addr;
 
 		/* Read the thread name */
-		retval = target_read_buffer(rtos->target, name_ptr,
+		retval = target_read_buffer(rtos->target, threads[i].name_ptr,
 									CHIBIOS_THREAD_NAME_STR_SIZE,
 									(uint8_t *)&tmp_str);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Error reading thread name from ChibiOS target");
+			free(threads);
 			return retval;
 		}
 		tmp_str[CHIBIOS_THREAD_NAME_STR_SIZE - 1] = '\x00';
@@ -429,19 +474,10 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 		strcpy(curr_thrd_details->thread_name_str, tmp_str);
 
 		/* State info */
-		uint8_t threadState;
 		const char *state_desc;
 
-		retval = target_read_u8(rtos->target,
-								current + signature->cf_off_state, &threadState);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading thread state from ChibiOS target");
-			return retval;
-		}
-
-
-		if (threadState < CHIBIOS_NUM_STATES)
-			state_desc = ChibiOS_thread_states[threadState];
+		if (threads[i].state < CHIBIOS_NUM_STATES)
+			state_desc = ChibiOS_thread_states[threads[i].state];
 		else
 			state_desc = "Unknown state";
 
@@ -452,19 +488,9 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 		curr_thrd_details->exists = true;
 		curr_thrd_details->display_str = NULL;
 
-		curr_thrd_details++;
-	}
-
-	uint32_t current_thrd;
-	/* NOTE: By design, cf_off_name equals readylist_current_offset */
-	retval = target_read_u32(rtos->target,
-							 rlist + signature->cf_off_name,
-							 &current_thrd);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("Could not read current Thread from ChibiOS target");
-		return retval;
+		rtos->thread_count = i + 1;
 	}
-	rtos->current_thread = current_thrd;
+	free(threads);
 
 	return 0;
 }
@@ -102,6 +102,7 @@ static const struct FreeRTOS_params FreeRTOS_params_list[] = {
 static int FreeRTOS_detect_rtos(struct target *target);
 static int FreeRTOS_create(struct target *target);
 static int FreeRTOS_update_threads(struct rtos *rtos);
+static int FreeRTOS_threads_unchanged(struct rtos *rtos);
 static int FreeRTOS_get_thread_reg_list(struct rtos *rtos, int64_t thread_id, char **hex_reg_list);
 static int FreeRTOS_get_symbol_list_to_lookup(symbol_table_elem_t *symbol_list[]);
 
@@ -111,6 +112,7 @@ struct rtos_type FreeRTOS_rtos = {
 	.detect_rtos = FreeRTOS_detect_rtos,
 	.create = FreeRTOS_create,
 	.update_threads = FreeRTOS_update_threads,
+	.threads_unchanged = FreeRTOS_threads_unchanged,
 	.get_thread_reg_list = FreeRTOS_get_thread_reg_list,
 	.get_symbol_list_to_lookup = FreeRTOS_get_symbol_list_to_lookup,
 };
@@ -127,6 +129,7 @@ enum FreeRTOS_symbol_values {
 	FreeRTOS_VAL_xSuspendedTaskList = 8,
 	FreeRTOS_VAL_uxCurrentNumberOfTasks = 9,
 	FreeRTOS_VAL_uxTopUsedPriority = 10,
+	FreeRTOS_VAL_uxTaskNumber = 11,
 };
 
 struct symbols {
@@ -146,6 +149,7 @@ static const struct symbols FreeRTOS_symbol_list[] = {
 	{ "xSuspendedTaskList", true }, /* Only if INCLUDE_vTaskSuspend */
 	{ "uxCurrentNumberOfTasks", false },
 	{ "uxTopUsedPriority", true }, /* Unavailable since v7.5.3 */
+	{ "uxTaskNumber", true }, /* Only used to validate the thread list cache */
 	{ NULL, false }
 };
 
@@ -154,6 +158,134 @@ static const struct symbols FreeRTOS_symbol_list[] = {
 /* may be problems reading if sizes are not 32 bit long integers. */
 /* test mallocs for failure */
 
+#define FREERTOS_THREAD_NAME_STR_SIZE (200)
+
+/* The number of non-ready lists walked after pxReadyTasksLists */
+#define FREERTOS_NUM_OTHER_LISTS 5
+
+/*
+ * Result of the last thread list walk.  "snapshot" holds the raw list
+ * headers and uxTaskNumber as they were read; if none of them changed
+ * since, the scheduler has not moved, created or deleted any task and the
+ * ids and names can be reused without walking the lists again.
+ */
+struct FreeRTOS_thread_cache {
+	const struct rtos *rtos;
+	int64_t task_count;
+	int thread_list_size;
+	uint8_t *snapshot;
+	int snapshot_size;
+	int num_threads;
+	int64_t *threadid;
+	char **name;
+};
+
+static struct FreeRTOS_thread_cache FreeRTOS_cache;
+
+static void FreeRTOS_cache_free(void)
+{
+	for (int i = 0; i < FreeRTOS_cache.num_threads; i++)
+		free(FreeRTOS_cache.name[i]);
+	free(FreeRTOS_cache.name);
+	free(FreeRTOS_cache.threadid);
+	free(FreeRTOS_cache.snapshot);
+	memset(&FreeRTOS_cache, 0, sizeof(FreeRTOS_cache));
+}
+
+static int FreeRTOS_target_event_handler(struct target *target,
+		enum target_event event, void *priv)
+{
+	/* new code may have been loaded behind an unchanged list layout */
+	if (event == TARGET_EVENT_GDB_FLASH_WRITE_END &&
+			FreeRTOS_cache.rtos == target->rtos)
+		FreeRTOS_cache_free();
+	return ERROR_OK;
+}
+
+static uint64_t FreeRTOS_get_value(struct target *target,
+		const uint8_t *buffer, unsigned width)
+{
+	switch (width) {
+		case 8:
+			return target_buffer_get_u64(target, buffer);
+		case 4:
+			return target_buffer_get_u32(target, buffer);
+		case 2:
+			return target_buffer_get_u16(target, buffer);
+		default:
+			return *buffer;
+	}
+}
+
+static const char *FreeRTOS_cached_name(int64_t threadid)
+{
+	for (int i = 0; i < FreeRTOS_cache.num_threads; i++) {
+		if (FreeRTOS_cache.threadid[i] == threadid)
+			return FreeRTOS_cache.name[i];
+	}
+	return NULL;
+}
+
+/*
+ * uxTaskNumber is bumped on every task creation and uxCurrentNumberOfTasks
+ * drops on every deletion, so while both hold their values the task set
+ * of the last walk is still current; only the running task may differ.
+ */
+static int FreeRTOS_threads_unchanged(struct rtos *rtos)
+{
+	const struct FreeRTOS_params *param = rtos->rtos_specific_params;
+	uint8_t buf[8];
+	int retval;
+
+	if (param == NULL || rtos->symbols == NULL ||
+			rtos->symbols[FreeRTOS_VAL_uxTaskNumber].address == 0 ||
+			FreeRTOS_cache.rtos != rtos || FreeRTOS_cache.snapshot == NULL ||
+			FreeRTOS_cache.task_count == 0 ||
+			FreeRTOS_cache.thread_list_size != FreeRTOS_cache.task_count)
+		return 0;
+
+	retval = target_read_buffer(rtos->target,
+			rtos->symbols[FreeRTOS_VAL_uxCurrentNumberOfTasks].address,
+			param->thread_count_width, buf);
+	if (retval != ERROR_OK ||
+			(int64_t)FreeRTOS_get_value(rtos->target, buf, param->thread_count_width)
+			!= FreeRTOS_cache.task_count)
+		return 0;
+
+	retval = target_read_buffer(rtos->target,
+			rtos->symbols[FreeRTOS_VAL_uxTaskNumber].address,
+			param->thread_count_width, buf);
+	if (retval != ERROR_OK || memcmp(buf, FreeRTOS_cache.snapshot +
+				FreeRTOS_cache.snapshot_size - param->thread_count_width,
+				param->thread_count_width) != 0)
+		return 0;
+
+	retval = target_read_buffer(rtos->target,
+			rtos->symbols[FreeRTOS_VAL_pxCurrentTCB].address,
+			param->pointer_width, buf);
+	if (retval != ERROR_OK)
+		return 0;
+	int64_t current = FreeRTOS_get_value(rtos->target, buf, param->pointer_width);
+
+	/* a running task missing from the list means the walk raced the kernel */
+	int i;
+	for (i = 0; i < rtos->thread_count; i++) {
+		if (rtos->thread_details[i].threadid == current)
+			break;
+	}
+	if (current == 0 || i == rtos->thread_count)
+		return 0;
+
+	rtos->current_thread = current;
+	for (i = 0; i < rtos->thread_count; i++) {
+		struct thread_detail *thread = &rtos->thread_details[i];
+
+		free(thread->extra_info_str);
+		thread->extra_info_str = thread->threadid == current ? strdup("Running") : NULL;
+	}
+	return 1;
+}
+
 static int FreeRTOS_update_threads(struct rtos *rtos)
 {
 	int i = 0;
@@ -190,6 +322,8 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		return retval;
 	}
 
+	int64_t task_count = thread_list_size;
+
 	/* wipe out previous thread details if any */
 	rtos_free_threadlist(rtos);
 
@@ -239,6 +373,8 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 			return ERROR_FAIL;
 		}
 	}
+	/* the entries are filled in below, keep them freeable until then */
+	rtos->thread_count = tasks_found;
 
 	/* Find out how many lists are needed to be read from pxReadyTasksLists, */
 	if (rtos->symbols[FreeRTOS_VAL_uxTopUsedPriority].address == 0) {
@@ -261,138 +397,200 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		return ERROR_FAIL;
 	}
 
-	symbol_address_t *list_of_lists =
-		malloc(sizeof(symbol_address_t) *
-			(max_used_priority+1 + 5));
-	if (!list_of_lists) {
+	/*
+	 * Phase 1: fetch every list header.  The ready lists are one array on
+	 * the target and come in a single read; uxTaskNumber, which changes on
+	 * every task creation, is appended so the snapshot also catches a task
+	 * being replaced by a new one at the same address.
+	 */
+	int num_lists = max_used_priority + 1 + FREERTOS_NUM_OTHER_LISTS;
+	int snapshot_size = num_lists * param->list_width + param->thread_count_width;
+	uint8_t *snapshot = calloc(1, snapshot_size);
+	if (!snapshot) {
 		LOG_ERROR("Error allocating memory for %" PRId64 " priorities", max_used_priority);
 		return ERROR_FAIL;
 	}
 
-	int num_lists;
-	for (num_lists = 0; num_lists <= max_used_priority; num_lists++)
-		list_of_lists[num_lists] = rtos->symbols[FreeRTOS_VAL_pxReadyTasksLists].address +
-			num_lists * param->list_width;
-
-	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xDelayedTaskList1].address;
-	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xDelayedTaskList2].address;
-	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xPendingReadyList].address;
-	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xSuspendedTaskList].address;
-	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xTasksWaitingTermination].address;
+	symbol_address_t other_lists[FREERTOS_NUM_OTHER_LISTS] = {
+		rtos->symbols[FreeRTOS_VAL_xDelayedTaskList1].address,
+		rtos->symbols[FreeRTOS_VAL_xDelayedTaskList2].address,
+		rtos->symbols[FreeRTOS_VAL_xPendingReadyList].address,
+		rtos->symbols[FreeRTOS_VAL_xSuspendedTaskList].address,
+		rtos->symbols[FreeRTOS_VAL_xTasksWaitingTermination].address,
+	};
 
-	for (i = 0; i < num_lists; i++) {
-		if (list_of_lists[i] == 0)
+	retval = target_read_buffer(rtos->target,
+			rtos->symbols[FreeRTOS_VAL_pxReadyTasksLists].address,
+			(max_used_priority + 1) * param->list_width, snapshot);
+	for (i = 0; retval == ERROR_OK && i < FREERTOS_NUM_OTHER_LISTS; i++) {
+		if (other_lists[i] == 0)
 			continue;
-
-		/* Read the number of threads in this list */
-		int64_t list_thread_count = 0;
+		retval = target_read_buffer(rtos->target, other_lists[i], param->list_width,
+				snapshot + (max_used_priority + 1 + i) * param->list_width);
+	}
+	bool have_task_number = rtos->symbols[FreeRTOS_VAL_uxTaskNumber].address != 0;
+	if (retval == ERROR_OK && have_task_number)
 		retval = target_read_buffer(rtos->target,
-				list_of_lists[i],
+				rtos->symbols[FreeRTOS_VAL_uxTaskNumber].address,
 				param->thread_count_width,
-				(uint8_t *)&list_thread_count);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading number of threads in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
-		}
+				snapshot + num_lists * param->list_width);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading FreeRTOS task list headers");
+		free(snapshot);
+		return retval;
+	}
+
+	/*
+	 * Without uxTaskNumber a deleted task could be replaced by a new one at
+	 * the same TCB address and in the same list position, so only trust
+	 * the previous walk when it is available.
+	 */
+	bool cache_valid = have_task_number && FreeRTOS_cache.rtos == rtos &&
+		FreeRTOS_cache.snapshot_size == snapshot_size &&
+		memcmp(FreeRTOS_cache.snapshot + num_lists * param->list_width,
+				snapshot + num_lists * param->list_width,
+				param->thread_count_width) == 0;
+	bool lists_unchanged = cache_valid &&
+		FreeRTOS_cache.thread_list_size == thread_list_size &&
+		memcmp(FreeRTOS_cache.snapshot, snapshot, snapshot_size) == 0;
+
+	int first_task = tasks_found;
+	if (lists_unchanged) {
+		LOG_DEBUG("FreeRTOS: task lists unchanged, reusing %d threads",
+				FreeRTOS_cache.num_threads);
+		for (i = 0; i < FreeRTOS_cache.num_threads && tasks_found < thread_list_size; i++)
+			rtos->thread_details[tasks_found++].threadid = FreeRTOS_cache.threadid[i];
+	}
+
+	/*
+	 * Phase 2: walk the list items.  They are linked, so each hop needs a
+	 * read, but one read covers both the owner and the next pointer.
+	 */
+	unsigned item_lo = MIN(param->list_elem_next_offset, param->list_elem_content_offset);
+	unsigned item_size = MAX(param->list_elem_next_offset, param->list_elem_content_offset)
+		+ param->pointer_width - item_lo;
+	uint8_t item[UINT8_MAX + 8];
+
+	for (i = 0; !lists_unchanged && i < num_lists; i++) {
+		const uint8_t *header = snapshot + i * param->list_width;
+		symbol_address_t list_address = i <= max_used_priority
+			? rtos->symbols[FreeRTOS_VAL_pxReadyTasksLists].address + i * param->list_width
+			: other_lists[i - max_used_priority - 1];
+		if (list_address == 0)
+			continue;
+
+		int64_t list_thread_count = FreeRTOS_get_value(rtos->target, header,
+				param->thread_count_width);
 		LOG_DEBUG("FreeRTOS: Read thread count for list %d at 0x%" PRIx64 ", value %" PRId64 "\r\n",
-										i, list_of_lists[i], list_thread_count);
+										i, list_address, list_thread_count);
 
 		if (list_thread_count == 0)
 			continue;
 
-		/* Read the location of first list item */
 		uint64_t prev_list_elem_ptr = -1;
-		uint64_t list_elem_ptr = 0;
-		retval = target_read_buffer(rtos->target,
-				list_of_lists[i] + param->list_next_offset,
-				param->pointer_width,
-				(uint8_t *)&list_elem_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
-		}
+		uint64_t list_elem_ptr = FreeRTOS_get_value(rtos->target,
+				header + param->list_next_offset, param->pointer_width);
 		LOG_DEBUG("FreeRTOS: Read first item for list %d at 0x%" PRIx64 ", value 0x%" PRIx64 "\r\n",
-										i, list_of_lists[i] + param->list_next_offset, list_elem_ptr);
+										i, list_address + param->list_next_offset, list_elem_ptr);
 
 		while ((list_thread_count > 0) && (list_elem_ptr != 0) &&
 				(list_elem_ptr != prev_list_elem_ptr) &&
 				(tasks_found < thread_list_size)) {
-			/* Get the location of the thread structure. */
-			rtos->thread_details[tasks_found].threadid = 0;
 			retval = target_read_buffer(rtos->target,
-					list_elem_ptr + param->list_elem_content_offset,
-					param->pointer_width,
-					(uint8_t *)&(rtos->thread_details[tasks_found].threadid));
+					list_elem_ptr + item_lo, item_size, item);
 			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading thread list item object in FreeRTOS thread list");
-				free(list_of_lists);
+				LOG_ERROR("Error reading thread list item in FreeRTOS thread list");
+				free(snapshot);
 				return retval;
 			}
+
+			/* Get the location of the thread structure. */
+			rtos->thread_details[tasks_found].threadid = FreeRTOS_get_value(rtos->target,
+					item + param->list_elem_content_offset - item_lo, param->pointer_width);
 			LOG_DEBUG("FreeRTOS: Read Thread ID at 0x%" PRIx64 ", value 0x%" PRIx64 "\r\n",
 										list_elem_ptr + param->list_elem_content_offset,
 										rtos->thread_details[tasks_found].threadid);
 
-			/* get thread name */
+			tasks_found++;
+			list_thread_count--;
+
+			prev_list_elem_ptr = list_elem_ptr;
+			list_elem_ptr = FreeRTOS_get_value(rtos->target,
+					item + param->list_elem_next_offset - item_lo, param->pointer_width);
+			LOG_DEBUG("FreeRTOS: Read next thread location at 0x%" PRIx64 ", value 0x%" PRIx64 "\r\n",
+										prev_list_elem_ptr + param->list_elem_next_offset,
+										list_elem_ptr);
+		}
+	}
 
-			#define FREERTOS_THREAD_NAME_STR_SIZE (200)
-			char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
+	/*
+	 * Phase 3: thread names.  A name never changes once the task exists,
+	 * so only TCBs that were not seen by the previous walk are read.
+	 */
+	for (i = first_task; i < tasks_found; i++) {
+		struct thread_detail *thread = &rtos->thread_details[i];
+		char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
+		const char *name = cache_valid ? FreeRTOS_cached_name(thread->threadid) : NULL;
 
+		if (!name) {
 			/* Read the thread name */
 			retval = target_read_buffer(rtos->target,
-					rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
+					thread->threadid + param->thread_name_offset,
 					FREERTOS_THREAD_NAME_STR_SIZE,
 					(uint8_t *)&tmp_str);
 			if (retval != ERROR_OK) {
 				LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-				free(list_of_lists);
+				free(snapshot);
 				return retval;
 			}
 			tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
 			LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value \"%s\"\r\n",
-										rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
+										thread->threadid + param->thread_name_offset,
 										tmp_str);
 
 			if (tmp_str[0] == '\x00')
 				strcpy(tmp_str, "No Name");
+			name = tmp_str;
+		}
 
-			rtos->thread_details[tasks_found].thread_name_str =
-				malloc(strlen(tmp_str)+1);
-			strcpy(rtos->thread_details[tasks_found].thread_name_str, tmp_str);
-			rtos->thread_details[tasks_found].display_str = NULL;
-			rtos->thread_details[tasks_found].exists = true;
-
-			if (rtos->thread_details[tasks_found].threadid == rtos->current_thread) {
-				char running_str[] = "Running";
-				rtos->thread_details[tasks_found].extra_info_str = malloc(
-						sizeof(running_str));
-				strcpy(rtos->thread_details[tasks_found].extra_info_str,
-					running_str);
-			} else
-				rtos->thread_details[tasks_found].extra_info_str = NULL;
+		thread->thread_name_str = strdup(name);
+		thread->display_str = NULL;
+		thread->exists = true;
 
-			tasks_found++;
-			list_thread_count--;
+		if (thread->threadid == rtos->current_thread) {
+			char running_str[] = "Running";
+			thread->extra_info_str = malloc(sizeof(running_str));
+			strcpy(thread->extra_info_str, running_str);
+		} else
+			thread->extra_info_str = NULL;
 
-			prev_list_elem_ptr = list_elem_ptr;
-			list_elem_ptr = 0;
-			retval = target_read_buffer(rtos->target,
-					prev_list_elem_ptr + param->list_elem_next_offset,
-					param->pointer_width,
-					(uint8_t *)&list_elem_ptr);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading next thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
+		rtos->thread_count = i + 1;
+	}
+
+	/* remember this walk for the next halt */
+	if (lists_unchanged) {
+		free(snapshot);
+	} else {
+		FreeRTOS_cache_free();
+		FreeRTOS_cache.threadid = malloc(sizeof(int64_t) * (tasks_found - first_task + 1));
+		FreeRTOS_cache.name = malloc(sizeof(char *) * (tasks_found - first_task + 1));
+		if (!FreeRTOS_cache.threadid || !FreeRTOS_cache.name) {
+			FreeRTOS_cache_free();
+			free(snapshot);
+		} else {
+			FreeRTOS_cache.rtos = rtos;
+			FreeRTOS_cache.thread_list_size = thread_list_size;
+			FreeRTOS_cache.task_count = task_count;
+			FreeRTOS_cache.snapshot = snapshot;
+			FreeRTOS_cache.snapshot_size = snapshot_size;
+			for (i = first_task; i < tasks_found; i++) {
+				int n = FreeRTOS_cache.num_threads++;
+				FreeRTOS_cache.threadid[n] = rtos->thread_details[i].threadid;
+				FreeRTOS_cache.name[n] = strdup(rtos->thread_details[i].thread_name_str);
 			}
-			LOG_DEBUG("FreeRTOS: Read next thread location at 0x%" PRIx64 ", value 0x%" PRIx64 "\r\n",
-										prev_list_elem_ptr + param->list_elem_next_offset,
-										list_elem_ptr);
 		}
 	}
 
-	free(list_of_lists);
 	rtos->thread_count = tasks_found;
 	return 0;
 }
@@ -553,5 +751,6 @@ static int FreeRTOS_create(struct target *target)
 	}
 
 	target->rtos->rtos_specific_params = (void *) &FreeRTOS_params_list[i];
+	target_register_event_callback(FreeRTOS_target_event_handler, NULL);
 	return 0;
 }
@@ -345,6 +345,17 @@ static int ThreadX_update_threads(struct rtos *rtos)
 		return retval;
 	}
 
+	/* Each thread control block is fetched with a single read covering
+	 * the name pointer, state and next pointer; the fields are then
+	 * extracted on the host. */
+	unsigned tcb_size = MAX(MAX(param->thread_name_offset, param->thread_next_offset)
+			+ param->pointer_width, param->thread_state_offset + 4);
+	uint8_t *tcb = malloc(tcb_size);
+	if (!tcb) {
+		LOG_ERROR("Error allocating memory for ThreadX thread control block");
+		return ERROR_FAIL;
+	}
+
 	/* loop over all threads */
 	int64_t prev_thread_ptr = 0;
 	while ((thread_ptr != prev_thread_ptr) && (tasks_found < thread_list_size)) {
@@ -357,16 +368,16 @@ static int ThreadX_update_threads(struct rtos *rtos)
 		/* Save the thread pointer */
 		rtos->thread_details[tasks_found].threadid = thread_ptr;
 
-		/* read the name pointer */
-		retval = target_read_buffer(rtos->target,
-				thread_ptr + param->thread_name_offset,
-				param->pointer_width,
-				(uint8_t *)&name_ptr);
+		retval = target_read_buffer(rtos->target, thread_ptr, tcb_size, tcb);
 		if (retval != ERROR_OK) {
-			LOG_ERROR("Could not read ThreadX thread name pointer from target");
+			LOG_ERROR("Could not read ThreadX thread control block from target");
+			free(tcb);
 			return retval;
 		}
 
+		/* the name pointer */
+		memcpy(&name_ptr, tcb + param->thread_name_offset, param->pointer_width);
+
 		/* Read the thread name */
 		retval =
 			target_read_buffer(rtos->target,
@@ -375,6 +386,7 @@ static int ThreadX_update_threads(struct rtos *rtos)
 				(uint8_t *)&tmp_str);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Error reading thread name from ThreadX target");
+			free(tcb);
 			return retval;
 		}
 		tmp_str[THREADX_THREAD_NAME_STR_SIZE-1] = '\x00';
@@ -386,16 +398,9 @@ static int ThreadX_update_threads(struct rtos *rtos)
 			malloc(strlen(tmp_str)+1);
 		strcpy(rtos->thread_details[tasks_found].thread_name_str, tmp_str);
 
-		/* Read the thread status */
+		/* the thread status */
 		int64_t thread_status = 0;
-		retval = target_read_buffer(rtos->target,
-				thread_ptr + param->thread_state_offset,
-				4,
-				(uint8_t *)&thread_status);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading thread state from ThreadX target");
-			return retval;
-		}
+		memcpy(&thread_status, tcb + param->thread_state_offset, 4);
 
 		for (i = 0; (i < THREADX_NUM_STATES) &&
 				(ThreadX_thread_states[i].value != thread_status); i++) {
@@ -421,15 +426,9 @@ static int ThreadX_update_threads(struct rtos *rtos)
 
 		/* Get the location of the next thread structure. */
 		thread_ptr = 0;
-		retval = target_read_buffer(rtos->target,
-				prev_thread_ptr + param->thread_next_offset,
-				param->pointer_width,
-				(uint8_t *) &thread_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading next thread pointer in ThreadX thread list");
-			return retval;
-		}
+		memcpy(&thread_ptr, tcb + param->thread_next_offset, param->pointer_width);
 	}
+	free(tcb);
 
 	rtos->thread_count = tasks_found;
 
@@ -51,6 +51,12 @@ struct linux_os {
 	/*  virt2phys parameter */
 	uint32_t phys_mask;
 	uint32_t phys_base;
+	/*  phys_base was computed from the target: the kernel linear mapping
+	 *  is known and task memory can be read without the MMU */
+	int phys_valid;
+	/*  thread_list entry following the last one matched by
+	 *  linux_task_update(), the task list order is mostly stable */
+	struct threads *update_hint;
 };
 
 struct current_thread {
@@ -115,12 +121,14 @@ static int linux_compute_virt2phys(struct target *target, uint32_t address)
 		LOG_ERROR("Cannot compute linux virt2phys translation");
 		/*  fixes default address  */
 		linux_os->phys_base = 0;
+		linux_os->phys_valid = 0;
 		return ERROR_FAIL;
 	}
 
 	linux_os->init_task_addr = address;
 	address = address & linux_os->phys_mask;
 	linux_os->phys_base = pa - address;
+	linux_os->phys_valid = 1;
 	return ERROR_OK;
 }
 
@@ -138,10 +146,11 @@ static int linux_read_memory(struct target *target,
 		return ERROR_FAIL;
 	}
 #ifdef PHYS
-	target_read_phys_memory(target, pa, size, count, buffer);
+	/*  the cached linear translation spares a page table walk per access */
+	if (linux_os->phys_valid)
+		return target_read_phys_memory(target, pa, size, count, buffer);
 #endif
-	target_read_memory(target, address, size, count, buffer);
-	return ERROR_OK;
+	return target_read_memory(target, address, size, count, buffer);
 }
 
 static char *reg_converter(char *buffer, void *reg, int size)
@@ -370,44 +379,38 @@ int fill_task_pid(struct target *target, struct threads *t)
 }
 #endif
 
+/*  task_struct fields are fetched in two slices rather than one word at a
+ *  time: state and on_cpu sit at the start, mm and pid close together */
+#define TASK_HEAD_SIZE (ONCPU + 4)
+#define TASK_MID_START MIN(MEM, PID)
+#define TASK_MID_SIZE (MAX(MEM, PID) + 4 - TASK_MID_START)
+
 int fill_task(struct target *target, struct threads *t)
 {
 	int retval;
-	uint32_t pid_addr = t->base_addr + PID;
-	uint32_t mem_addr = t->base_addr + MEM;
-	uint32_t on_cpu = t->base_addr + ONCPU;
-	uint8_t *buffer = calloc(1, 4);
-	retval = fill_buffer(target, t->base_addr, buffer);
+	uint8_t head[TASK_HEAD_SIZE];
+	uint8_t mid[TASK_MID_SIZE];
+
+	retval = linux_read_memory(target, t->base_addr, 4, TASK_HEAD_SIZE / 4, head);
 
 	if (retval == ERROR_OK) {
-		uint32_t val = get_buffer(target, buffer);
-		t->state = val;
+		t->state = get_buffer(target, head);
+		t->oncpu = get_buffer(target, head + ONCPU);
 	} else
 		LOG_ERROR("fill_task: unable to read memory");
 
-	retval = fill_buffer(target, pid_addr, buffer);
+	retval = linux_read_memory(target, t->base_addr + TASK_MID_START, 4,
+			TASK_MID_SIZE / 4, mid);
 
 	if (retval == ERROR_OK) {
-		uint32_t val = get_buffer(target, buffer);
+		uint32_t val = get_buffer(target, mid + PID - TASK_MID_START);
 		t->pid = val;
-	} else
-		LOG_ERROR("fill task: unable to read memory");
 
-	retval = fill_buffer(target, on_cpu, buffer);
-
-	if (retval == ERROR_OK) {
-		uint32_t val = get_buffer(target, buffer);
-		t->oncpu = val;
-	} else
-		LOG_ERROR("fill task: unable to read memory");
-
-	retval = fill_buffer(target, mem_addr, buffer);
-
-	if (retval == ERROR_OK) {
-		uint32_t val = get_buffer(target, buffer);
+		val = get_buffer(target, mid + MEM - TASK_MID_START);
 
 		if (val != 0) {
 			uint32_t asid_addr = val + MM_CTX;
+			uint8_t buffer[4];
 			retval = fill_buffer(target, asid_addr, buffer);
 
 			if (retval == ERROR_OK) {
@@ -421,8 +424,6 @@ int fill_task(struct target *target, struct threads *t)
 	} else
 		LOG_ERROR("fill task: unable to read memory");
 
-	free(buffer);
-
 	return retval;
 }
 
@@ -1023,6 +1024,7 @@ static int linux_task_update(struct target *target, int context)
 	int64_t start = timeval_ms();
 	struct threads *t = calloc(1, sizeof(struct threads));
 	uint32_t previous = 0xdeadbeef;
+	linux_os->update_hint = NULL;
 	t->base_addr = linux_os->init_task_addr;
 	retval = get_current(target, 0);
 	/*check that all current threads have been identified  */
@@ -1044,7 +1046,15 @@ static int linux_task_update(struct target *target, int context)
 			return ERROR_FAIL;
 		}
 
-		thread_list = linux_os->thread_list;
+		/*  tasks mostly come back in the order of the previous walk, so
+		 *  try the entry after the last match before searching the list */
+		thread_list = linux_os->update_hint;
+#ifdef PID_CHECK
+		if (thread_list == NULL || t->pid != thread_list->pid)
+#else
+		if (thread_list == NULL || t->base_addr != thread_list->base_addr)
+#endif
+			thread_list = linux_os->thread_list;
 
 		while (thread_list != NULL) {
 #ifdef PID_CHECK
@@ -1079,6 +1089,7 @@ static int linux_task_update(struct target *target, int context)
 				}
 
 				linux_os->thread_count++;
+				linux_os->update_hint = thread_list->next;
 				found = 1;
 				break;
 			} else {
@@ -24,6 +24,7 @@
 #include "target/target.h"
 #include "helper/log.h"
 #include "helper/binarybuffer.h"
+#include "helper/perf.h"
 #include "server/gdb_server.h"
 
 /* RTOSs */
@@ -81,6 +82,7 @@ static void os_free(struct target *target)
 
 	if (target->rtos->symbols)
 		free(target->rtos->symbols);
+	rtos_reg_cache_invalidate(target->rtos);
 
 	free(target->rtos);
 	target->rtos = NULL;
@@ -178,6 +180,17 @@ static bool is_symbol_mandatory(const struct rtos *os, const char *symbol)
 	return false;
 }
 
+/* first symbol GDB resolved in the cached lookup, used to check that a
+ * new session still debugs the same binary */
+static symbol_table_elem_t *cached_symbol_probe(const struct rtos *os)
+{
+	for (symbol_table_elem_t *s = os->symbols; s->symbol_name; ++s) {
+		if (s->address)
+			return s;
+	}
+	return NULL;
+}
+
 /* rtos_qsymbol() processes and replies to all qSymbol packets from GDB.
  *
  * GDB sends a qSymbol:: packet (empty address, empty name) to notify
@@ -195,6 +208,11 @@ static bool is_symbol_mandatory(const struct rtos *os, const char *symbol)
  * specified explicitly, then no further symbol lookup is done. When
  * auto-detecting, the RTOS driver _detect() function must return success.
  *
+ * Once a lookup completed, the table is kept for later sessions: a new
+ * qSymbol:: offer is answered by asking for a single resolved symbol, and
+ * if GDB still reports the same address the whole table is reused.  Any
+ * difference restarts the full lookup.
+ *
  * rtos_qsymbol() returns 1 if an RTOS has been detected, or 0 otherwise.
  */
 int rtos_qsymbol(struct connection *connection, char const *packet, int packet_size)
@@ -216,6 +234,31 @@ int rtos_qsymbol(struct connection *connection, char const *packet, int packet_s
 	int len = unhexify(cur_sym, strchr(packet + 8, ':') + 1, strlen(strchr(packet + 8, ':') + 1));
 	cur_sym[len] = 0;
 
+	if (os->symbols_cached) {
+		symbol_table_elem_t *probe = cached_symbol_probe(os);
+
+		if (probe && (strcmp(packet, "qSymbol::") == 0)) {
+			next_sym = probe;
+			goto ask;
+		}
+		if (probe && !strcmp(probe->symbol_name, cur_sym) &&
+				sscanf(packet, "qSymbol:%" SCNx64 ":", &addr) &&
+				((symbol_address_t)addr == probe->address)) {
+			LOG_DEBUG("RTOS: reusing %s symbols from the previous session", os->type->name);
+			rtos_detected = 1;
+			goto done;
+		}
+
+		/* a different binary: look everything up again */
+		LOG_DEBUG("RTOS: symbols changed, repeating the lookup");
+		os->symbols_cached = false;
+		for (symbol_table_elem_t *s = os->symbols; s->symbol_name; ++s)
+			s->address = 0;
+		cur_sym[0] = '\x00';
+		addr = 0;
+		goto lookup;
+	}
+
 	if ((strcmp(packet, "qSymbol::") != 0) &&               /* GDB is not offering symbol lookup for the first time */
 	    (!sscanf(packet, "qSymbol:%" SCNx64 ":", &addr)) && /* GDB did not find an address for a symbol */
 	    is_symbol_mandatory(os, cur_sym)) {					/* the symbol is mandatory for this RTOS */
@@ -235,6 +278,7 @@ int rtos_qsymbol(struct connection *connection, char const *packet, int packet_s
 			cur_sym[0] = '\x00';
 		}
 	}
+lookup:
 	next_sym = next_symbol(os, cur_sym, addr);
 
 	if (!next_sym->symbol_name) {
@@ -242,12 +286,14 @@ int rtos_qsymbol(struct connection *connection, char const *packet, int packet_s
 
 		if (!target->rtos_auto_detect) {
 			rtos_detected = 1;
+			os->symbols_cached = true;
 			goto done;
 		}
 
 		if (os->type->detect_rtos(target)) {
 			LOG_INFO("Auto-detected RTOS: %s", os->type->name);
 			rtos_detected = 1;
+			os->symbols_cached = true;
 			goto done;
 		} else {
 			LOG_WARNING("No RTOS could be auto-detected!");
@@ -260,6 +306,7 @@ int rtos_qsymbol(struct connection *connection, char const *packet, int packet_s
 		goto done;
 	}
 
+ask:
 	reply_len = snprintf(reply, sizeof(reply), "qSymbol:");
 	reply_len += hexify(reply + reply_len, next_sym->symbol_name, 0, sizeof(reply) - reply_len);
 
@@ -416,34 +463,106 @@ int rtos_thread_packet(struct connection *connection, char const *packet, int pa
 	return GDB_THREAD_PACKET_NOT_CONSUMED;
 }
 
+struct rtos_reg_cache {
+	threadid_t threadid;
+	char *hex_reg_list;
+	/* layout of hex_reg_list, NULL if not built by rtos_generic_stack_read() */
+	const struct rtos_register_stacking *stacking;
+};
+
+/* stacking used by the last rtos_generic_stack_read(), for the cache entry */
+static const struct rtos_register_stacking *rtos_last_stacking;
+
+void rtos_reg_cache_invalidate(struct rtos *rtos)
+{
+	for (int i = 0; i < rtos->reg_cache_count; i++)
+		free(rtos->reg_cache[i].hex_reg_list);
+	free(rtos->reg_cache);
+	rtos->reg_cache = NULL;
+	rtos->reg_cache_count = 0;
+}
+
+/* Register list of a thread other than the running one.  A thread's stack
+ * frame cannot change while the target stays halted, so it is read once
+ * and kept until the next halt. */
+static struct rtos_reg_cache *rtos_get_thread_regs(struct rtos *rtos, threadid_t threadid)
+{
+	char *hex_reg_list = NULL;
+
+	for (int i = 0; i < rtos->reg_cache_count; i++) {
+		if (rtos->reg_cache[i].threadid == threadid)
+			return &rtos->reg_cache[i];
+	}
+
+	LOG_DEBUG("RTOS: getting register list for thread 0x%" PRIx64
+			  ", target->rtos->current_thread=0x%" PRIx64 "\r\n",
+									threadid,
+									rtos->current_thread);
+
+	rtos_last_stacking = NULL;
+	rtos->type->get_thread_reg_list(rtos, threadid, &hex_reg_list);
+	if (hex_reg_list == NULL)
+		return NULL;
+
+	struct rtos_reg_cache *cache = realloc(rtos->reg_cache,
+			(rtos->reg_cache_count + 1) * sizeof(*cache));
+	if (cache == NULL) {
+		free(hex_reg_list);
+		return NULL;
+	}
+	rtos->reg_cache = cache;
+	cache += rtos->reg_cache_count++;
+	cache->threadid = threadid;
+	cache->hex_reg_list = hex_reg_list;
+	cache->stacking = rtos_last_stacking;
+	return cache;
+}
+
+static bool rtos_thread_regs_needed(struct target *target)
+{
+	int64_t current_threadid = target->rtos->current_threadid;
+
+	return (current_threadid != -1) && (current_threadid != 0) &&
+		((current_threadid != target->rtos->current_thread) ||
+		(target->smp));	/* in smp several current thread are possible */
+}
+
 int rtos_get_gdb_reg_list(struct connection *connection)
 {
 	struct target *target = get_target_from_connection(connection);
-	int64_t current_threadid = target->rtos->current_threadid;
-	if ((target->rtos != NULL) && (current_threadid != -1) &&
-			(current_threadid != 0) &&
-			((current_threadid != target->rtos->current_thread) ||
-			(target->smp))) {	/* in smp several current thread are possible */
-		char *hex_reg_list;
-
-		LOG_DEBUG("RTOS: getting register list for thread 0x%" PRIx64
-				  ", target->rtos->current_thread=0x%" PRIx64 "\r\n",
-										current_threadid,
-										target->rtos->current_thread);
-
-		target->rtos->type->get_thread_reg_list(target->rtos,
-			current_threadid,
-			&hex_reg_list);
-
-		if (hex_reg_list != NULL) {
-			gdb_put_packet(connection, hex_reg_list, strlen(hex_reg_list));
-			free(hex_reg_list);
+	if ((target->rtos != NULL) && rtos_thread_regs_needed(target)) {
+		struct rtos_reg_cache *regs = rtos_get_thread_regs(target->rtos,
+				target->rtos->current_threadid);
+
+		if (regs != NULL) {
+			gdb_put_packet(connection, regs->hex_reg_list, strlen(regs->hex_reg_list));
 			return ERROR_OK;
 		}
 	}
 	return ERROR_FAIL;
 }
 
+/* Serve a 'p' packet for the selected thread from its cached register list. */
+int rtos_get_gdb_reg(struct connection *connection, int reg_num)
+{
+	struct target *target = get_target_from_connection(connection);
+	if ((target->rtos == NULL) || !rtos_thread_regs_needed(target))
+		return ERROR_FAIL;
+
+	struct rtos_reg_cache *regs = rtos_get_thread_regs(target->rtos,
+			target->rtos->current_threadid);
+	if ((regs == NULL) || (regs->stacking == NULL) ||
+			(reg_num >= regs->stacking->num_output_registers))
+		return ERROR_FAIL;
+
+	int offset = 0;
+	for (int i = 0; i < reg_num; i++)
+		offset += regs->stacking->register_offsets[i].width_bits / 8 * 2;
+	gdb_put_packet(connection, regs->hex_reg_list + offset,
+			regs->stacking->register_offsets[reg_num].width_bits / 8 * 2);
+	return ERROR_OK;
+}
+
 int rtos_generic_stack_read(struct target *target,
 	const struct rtos_register_stacking *stacking,
 	int64_t stack_ptr,
@@ -504,6 +623,7 @@ int rtos_generic_stack_read(struct target *target,
 		}
 	}
 	free(stack_data);
+	rtos_last_stacking = stacking;
 /*	LOG_OUTPUT("Output register string: %s\r\n", *hex_reg_list); */
 	return ERROR_OK;
 }
@@ -527,14 +647,31 @@ int rtos_try_next(struct target *target)
 		free(os->symbols);
 		os->symbols = NULL;
 	}
+	os->symbols_cached = false;
 
 	return 1;
 }
 
 int rtos_update_threads(struct target *target)
 {
-	if ((target->rtos != NULL) && (target->rtos->type != NULL))
-		target->rtos->type->update_threads(target->rtos);
+	struct rtos *rtos = target->rtos;
+
+	if ((rtos == NULL) || (rtos->type == NULL))
+		return ERROR_OK;
+
+	rtos_reg_cache_invalidate(rtos);
+
+	/* skip the rebuild when the kernel reports no thread was created or deleted */
+	if ((rtos->thread_details != NULL) && (rtos->type->threads_unchanged != NULL) &&
+			(rtos->type->threads_unchanged(rtos) > 0)) {
+		LOG_DEBUG("%s: thread list unchanged", rtos->type->name);
+		return ERROR_OK;
+	}
+
+	int64_t start = perf_time_us();
+	rtos->type->update_threads(rtos);
+	perf_add(PERF_RTOS_UPDATES, 1);
+	perf_add(PERF_RTOS_UPDATE_US, perf_time_us() - start);
 	return ERROR_OK;
 }
 
@@ -26,6 +26,7 @@ typedef int64_t threadid_t;
 typedef int64_t symbol_address_t;
 
 struct reg;
+struct rtos_reg_cache;
 
 /**
  * Table should be terminated by an element with NULL in symbol_name
@@ -48,12 +49,17 @@ struct rtos {
 	const struct rtos_type *type;
 
 	symbol_table_elem_t *symbols;
+	/* symbols holds a complete lookup from an earlier GDB session */
+	bool symbols_cached;
 	struct target *target;
 	/*  add a context variable instead of global variable */
 	int64_t current_threadid;
 	threadid_t current_thread;
 	struct thread_detail *thread_details;
 	int thread_count;
+	/* register lists of other threads fetched since the last halt */
+	struct rtos_reg_cache *reg_cache;
+	int reg_cache_count;
 	int (*gdb_thread_packet)(struct connection *connection, char const *packet, int packet_size);
 	void *rtos_specific_params;
 };
@@ -64,6 +70,11 @@ struct rtos_type {
 	int (*create)(struct target *target);
 	int (*smp_init)(struct target *target);
 	int (*update_threads)(struct rtos *rtos);
+	/** Optional: cheaply check the kernel's change counters.  If the thread
+	 * set built by the last update_threads() is still valid, refresh
+	 * current_thread and the per-thread extra info and return 1; return 0
+	 * to request a full update_threads(). */
+	int (*threads_unchanged)(struct rtos *rtos);
 	int (*get_thread_reg_list)(struct rtos *rtos, int64_t thread_id, char **hex_reg_list);
 	int (*get_symbol_list_to_lookup)(symbol_table_elem_t *symbol_list[]);
 	int (*clean)(struct target *target);
@@ -103,6 +114,8 @@ int rtos_generic_stack_read(struct target *target,
 int rtos_try_next(struct target *target);
 int gdb_thread_packet(struct connection *connection, char const *packet, int packet_size);
 int rtos_get_gdb_reg_list(struct connection *connection);
+int rtos_get_gdb_reg(struct connection *connection, int reg_num);
+void rtos_reg_cache_invalidate(struct rtos *rtos);
 int rtos_update_threads(struct target *target);
 void rtos_free_threadlist(struct rtos *rtos);
 int rtos_smp_init(struct target *target);
@@ -46,6 +46,8 @@
 #include "gdb_server.h"
 #include <target/image.h>
 #include <jtag/jtag.h>
+#include <helper/perf.h>
+#include <helper/time_support.h>
 #include "rtos/rtos.h"
 #include "target/smp.h"
 
@@ -58,11 +60,22 @@
  * found in most modern embedded processors.
  */
 
-struct target_desc_format {
+/* XML documents served through qXfer, kept per target and rebuilt when
+ * the flash banks or registers they describe change, so that reconnecting
+ * GDB doesn't regenerate them */
+struct gdb_xml_cache {
+	struct target *target;
+	char *memory_map;
+	size_t memory_map_length;
+	uint32_t memory_map_key;
 	char *tdesc;
-	uint32_t tdesc_length;
+	size_t tdesc_length;
+	uint32_t tdesc_key;
+	struct gdb_xml_cache *next;
 };
 
+static struct gdb_xml_cache *gdb_xml_caches;
+
 /* private connection data for GDB */
 struct gdb_connection {
 	char buffer[GDB_BUFFER_SIZE];
@@ -88,8 +101,34 @@ struct gdb_connection {
 	 * normally we reply with a S reply via gdb_last_signal_packet.
 	 * as a side note this behaviour only effects gdb > 6.8 */
 	bool attached;
-	/* temporarily used for target description support */
-	struct target_desc_format target_desc;
+	/* incoming packets are assembled here, packet_size is the PacketSize
+	 * advertised to GDB when the connection was opened */
+	char *packet_buffer;
+	int packet_size;
+	/* outgoing bytes are collected here, so that an ack and the complete
+	 * reply packet ('$', payload, '#xx') leave in a single write */
+	char *out_buffer;
+	int out_size;
+	int out_cnt;
+	/* number of registers in 'g' replies when gdb_lazy_registers is
+	 * enabled, fixed by the first reply; -1 until then */
+	int g_packet_regs;
+	/* qXfer:threads:read document, built for offset 0 and kept until
+	 * the last chunk is sent */
+	char *thread_list;
+	/* with gdb_flash_stream, vFlashWrite data that isn't programmed yet.
+	 * It covers vflash_stream_len bytes from vflash_stream_start, gaps
+	 * between packets are padded with 0xff */
+	uint8_t *vflash_stream;
+	uint32_t vflash_stream_start;
+	uint32_t vflash_stream_len;
+	uint32_t vflash_stream_alloc;
+	/* set when the GDB_FLASH_WRITE_START event was sent for this download */
+	bool vflash_stream_started;
+	/* first programming error of this download, reported at vFlashDone */
+	int vflash_stream_error;
+	/* observer connection, see gdb_observers. It may only read the target */
+	bool read_only;
 };
 
 #if 0
@@ -102,6 +141,7 @@ static int gdb_breakpoint_override;
 static enum breakpoint_type gdb_breakpoint_override_type;
 
 static int gdb_error(struct connection *connection, int retval);
+static int gdb_flush(struct connection *connection);
 static char *gdb_port;
 static char *gdb_port_next;
 
@@ -118,6 +158,9 @@ int gdb_actual_connections;
 static int gdb_use_memory_map = 1;
 /* enabled by default*/
 static int gdb_flash_program = 1;
+/* program flash while vFlashWrite packets arrive instead of at vFlashDone,
+ * disabled by default */
+static int gdb_flash_stream;
 
 /* if set, data aborts cause an error to be reported in memory read packets
  * see the code in gdb_read_memory_packet() for further explanations.
@@ -133,6 +176,40 @@ static int gdb_use_target_description = 1;
 /* current processing free-run type, used by file-I/O */
 static char gdb_running_type;
 
+/* PacketSize advertised to new connections, "gdb_packet_size" command */
+static int gdb_packet_size = GDB_BUFFER_SIZE;
+
+/* if set, 'g' replies only carry the registers cached at the first reply,
+ * GDB then reads the others with 'p' when it needs them.
+ * Disabled by default.
+ */
+static int gdb_lazy_registers;
+
+/* number of read-only connections accepted in addition to the one that
+ * controls the target, "gdb_observers" command. Memory they read comes
+ * from a snapshot shared by all connections of the target, which lives
+ * until the target state changes. */
+static int gdb_observers;
+
+/* limit of the memory kept in the snapshot of one target */
+#define GDB_SNAPSHOT_MAX (1024 * 1024)
+
+struct gdb_snapshot_block {
+	uint32_t address;
+	uint32_t size;
+	uint8_t *data;
+	struct gdb_snapshot_block *next;
+};
+
+struct gdb_snapshot {
+	struct target *target;
+	struct gdb_snapshot_block *blocks;
+	uint32_t size;
+	struct gdb_snapshot *next;
+};
+
+static struct gdb_snapshot *gdb_snapshots;
+
 static int gdb_last_signal(struct target *target)
 {
 	switch (target->debug_reason) {
@@ -198,6 +275,11 @@ static int gdb_get_char_inner(struct connection *connection, int *next_char)
 #ifdef _DEBUG_GDB_IO_
 	char *debug_buffer;
 #endif
+	/* GDB will not send anything before it got our pending output */
+	retval = gdb_flush(connection);
+	if (retval != ERROR_OK)
+		return retval;
+
 	for (;; ) {
 		if (connection->service->type != CONNECTION_TCP)
 			gdb_con->buf_cnt = read(connection->fd, gdb_con->buffer, GDB_BUFFER_SIZE);
@@ -331,7 +413,7 @@ static int gdb_putback_char(struct connection *connection, int last_char)
 /* The only way we can detect that the socket is closed is the first time
  * we write to it, we will fail. Subsequent write operations will
  * succeed. Shudder! */
-static int gdb_write(struct connection *connection, void *data, int len)
+static int gdb_write_direct(struct connection *connection, const void *data, int len)
 {
 	struct gdb_connection *gdb_con = connection->priv;
 	if (gdb_con->closed)
@@ -343,21 +425,118 @@ static int gdb_write(struct connection *connection, void *data, int len)
 	return ERROR_SERVER_REMOTE_CLOSED;
 }
 
-static int gdb_put_packet_inner(struct connection *connection,
-		char *buffer, int len)
+/* send everything collected by gdb_write() so far */
+static int gdb_flush(struct connection *connection)
 {
-	int i;
+	struct gdb_connection *gdb_con = connection->priv;
+	int len = gdb_con->out_cnt;
+
+	if (len == 0)
+		return ERROR_OK;
+
+	gdb_con->out_cnt = 0;
+	return gdb_write_direct(connection, gdb_con->out_buffer, len);
+}
+
+/* Output is only collected here, it is sent by gdb_flush(). This happens
+ * at the latest when we are about to wait for input from GDB. */
+static int gdb_write(struct connection *connection, const void *data, int len)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	int retval;
+
+	if (gdb_con->closed)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
+	if (gdb_con->out_cnt + len > gdb_con->out_size) {
+		retval = gdb_flush(connection);
+		if (retval != ERROR_OK)
+			return retval;
+		if (len > gdb_con->out_size)
+			return gdb_write_direct(connection, data, len);
+	}
+
+	memcpy(gdb_con->out_buffer + gdb_con->out_cnt, data, len);
+	gdb_con->out_cnt += len;
+	return ERROR_OK;
+}
+
+/* Append "$<payload>#xx" to the output buffer, computing the checksum
+ * while copying; the payload is only touched once. Returns false if the
+ * packet does not fit even into an empty buffer. */
+static bool gdb_frame_packet(struct gdb_connection *gdb_con,
+		const char *buffer, int len)
+{
+	static const char hex[] = "0123456789abcdef";
 	unsigned char my_checksum = 0;
+
+	if (gdb_con->out_cnt + len + 4 > gdb_con->out_size)
+		return false;
+
+	char *out = gdb_con->out_buffer + gdb_con->out_cnt;
+	*out++ = '$';
+	for (int i = 0; i < len; i++) {
+		my_checksum += buffer[i];
+		*out++ = buffer[i];
+	}
+	*out++ = '#';
+	*out++ = hex[my_checksum >> 4];
+	*out++ = hex[my_checksum & 0xf];
+
+	gdb_con->out_cnt += len + 4;
+	return true;
+}
+
+/* send one complete "$<payload>#xx" frame */
+static int gdb_send_frame(struct connection *connection, char *buffer, int len)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	int retval;
+
+	/* usually the whole packet, together with a pending ack, goes
+	 * out in one write; oversized packets are sent from the caller
+	 * supplied buffer to avoid dynamic allocation */
+	if (!gdb_frame_packet(gdb_con, buffer, len)) {
+		retval = gdb_flush(connection);
+		if (retval != ERROR_OK)
+			return retval;
+		if (!gdb_frame_packet(gdb_con, buffer, len)) {
+			unsigned char checksum = 0;
+			char trailer[4];
+			for (int i = 0; i < len; i++)
+				checksum += buffer[i];
+			snprintf(trailer, sizeof(trailer), "#%02x", checksum);
+			retval = gdb_write_direct(connection, "$", 1);
+			if (retval != ERROR_OK)
+				return retval;
+			retval = gdb_write_direct(connection, buffer, len);
+			if (retval != ERROR_OK)
+				return retval;
+			retval = gdb_write(connection, trailer, 3);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+	}
+
+	return gdb_flush(connection);
+}
+
+/* Send a packet and wait for GDB to ack it. If already_sent is set, the
+ * first transmission has been streamed by the caller and only a
+ * retransmission after a '-' reply uses buffer. */
+static int gdb_put_packet_inner(struct connection *connection,
+		char *buffer, int len, bool already_sent)
+{
 #ifdef _DEBUG_GDB_IO_
 	char *debug_buffer;
+	unsigned char my_checksum = 0;
+	for (int i = 0; i < len; i++)
+		my_checksum += buffer[i];
 #endif
 	int reply;
 	int retval;
 	struct gdb_connection *gdb_con = connection->priv;
 
-	for (i = 0; i < len; i++)
-		my_checksum += buffer[i];
-
 #ifdef _DEBUG_GDB_IO_
 	/*
 	 * At this point we should have nothing in the input queue from GDB,
@@ -365,7 +544,7 @@ static int gdb_put_packet_inner(struct connection *connection,
 	 * an ACK (+) for everything we've sent off.
 	 */
 	int gotdata;
-	for (;; ) {
+	while (!already_sent) {
 		retval = check_pending(connection, 0, &gotdata);
 		if (retval != ERROR_OK)
 			return retval;
@@ -392,26 +571,10 @@ static int gdb_put_packet_inner(struct connection *connection,
 		free(debug_buffer);
 #endif
 
-		char local_buffer[1024];
-		local_buffer[0] = '$';
-		if ((size_t)len + 4 <= sizeof(local_buffer)) {
-			/* performance gain on smaller packets by only a single call to gdb_write() */
-			memcpy(local_buffer + 1, buffer, len++);
-			len += snprintf(local_buffer + len, sizeof(local_buffer) - len, "#%02x", my_checksum);
-			retval = gdb_write(connection, local_buffer, len);
-			if (retval != ERROR_OK)
-				return retval;
-		} else {
-			/* larger packets are transmitted directly from caller supplied buffer
-			 * by several calls to gdb_write() to avoid dynamic allocation */
-			snprintf(local_buffer + 1, sizeof(local_buffer) - 1, "#%02x", my_checksum);
-			retval = gdb_write(connection, local_buffer, 1);
-			if (retval != ERROR_OK)
-				return retval;
-			retval = gdb_write(connection, buffer, len);
-			if (retval != ERROR_OK)
-				return retval;
-			retval = gdb_write(connection, local_buffer + 1, 3);
+		if (already_sent)
+			already_sent = false;
+		else {
+			retval = gdb_send_frame(connection, buffer, len);
 			if (retval != ERROR_OK)
 				return retval;
 		}
@@ -470,7 +633,7 @@ int gdb_put_packet(struct connection *connection, char *buffer, int len)
 {
 	struct gdb_connection *gdb_con = connection->priv;
 	gdb_con->busy = 1;
-	int retval = gdb_put_packet_inner(connection, buffer, len);
+	int retval = gdb_put_packet_inner(connection, buffer, len, false);
 	gdb_con->busy = 0;
 
 	/* we sent some data, reset timer for keep alive messages */
@@ -911,6 +1074,17 @@ static int gdb_target_callback_event_handler(struct target *target,
 	return ERROR_OK;
 }
 
+/* true if another connection of the service controls the target */
+static bool gdb_service_has_controller(struct connection *connection)
+{
+	for (struct connection *c = connection->service->connections; c; c = c->next) {
+		struct gdb_connection *gdb_con = c->priv;
+		if (c != connection && gdb_con && !gdb_con->read_only)
+			return true;
+	}
+	return false;
+}
+
 static int gdb_new_connection(struct connection *connection)
 {
 	struct gdb_connection *gdb_connection = malloc(sizeof(struct gdb_connection));
@@ -932,8 +1106,29 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->sync = false;
 	gdb_connection->mem_write_error = false;
 	gdb_connection->attached = true;
-	gdb_connection->target_desc.tdesc = NULL;
-	gdb_connection->target_desc.tdesc_length = 0;
+	gdb_connection->thread_list = NULL;
+	gdb_connection->vflash_stream = NULL;
+	gdb_connection->vflash_stream_start = 0;
+	gdb_connection->vflash_stream_len = 0;
+	gdb_connection->vflash_stream_alloc = 0;
+	gdb_connection->vflash_stream_started = false;
+	gdb_connection->vflash_stream_error = ERROR_OK;
+	gdb_connection->read_only = gdb_service_has_controller(connection);
+	gdb_connection->packet_size = gdb_packet_size;
+	gdb_connection->packet_buffer = malloc(gdb_packet_size);
+	gdb_connection->out_size = gdb_packet_size + 5;
+	gdb_connection->out_buffer = malloc(gdb_connection->out_size);
+	gdb_connection->out_cnt = 0;
+	gdb_connection->g_packet_regs = -1;
+	if (gdb_connection->packet_buffer == NULL || gdb_connection->out_buffer == NULL) {
+		LOG_ERROR("out of memory allocating %d byte GDB packet buffers", gdb_packet_size);
+		free(gdb_connection->packet_buffer);
+		free(gdb_connection->out_buffer);
+		free(gdb_connection->thread_list);
+		free(gdb_connection);
+		connection->priv = NULL;
+		return ERROR_FAIL;
+	}
 
 	/* send ACK to GDB for debug request */
 	gdb_write(connection, "+", 1);
@@ -941,6 +1136,15 @@ static int gdb_new_connection(struct connection *connection)
 	/* output goes through gdb connection */
 	command_set_output_handler(connection->cmd_ctx, gdb_output, connection);
 
+	/* an observer leaves the target, its breakpoints and the events to the
+	 * connection in control */
+	if (gdb_connection->read_only) {
+		gdb_actual_connections++;
+		LOG_INFO("New read-only GDB Connection: %d, Target %s",
+				gdb_actual_connections, target_name(gdb_service->target));
+		return ERROR_OK;
+	}
+
 	/* we must remove all breakpoints registered to the target as a previous
 	 * GDB session could leave dangling breakpoints if e.g. communication
 	 * timed out.
@@ -962,6 +1166,10 @@ static int gdb_new_connection(struct connection *connection)
 	 */
 	if (initial_ack != '+')
 		gdb_putback_char(connection, initial_ack);
+
+	/* attaching is the first use of a target with deferred examination */
+	target_examine_deferred(gdb_service->target);
+
 	target_call_event_callbacks(gdb_service->target, TARGET_EVENT_GDB_ATTACH);
 
 	if (gdb_use_memory_map) {
@@ -1005,6 +1213,7 @@ static int gdb_connection_closed(struct connection *connection)
 {
 	struct gdb_service *gdb_service = connection->service->priv;
 	struct gdb_connection *gdb_connection = connection->priv;
+	bool read_only = gdb_connection->read_only;
 
 	/* we're done forwarding messages. Tear down callback before
 	 * cleaning up connection.
@@ -1023,16 +1232,23 @@ static int gdb_connection_closed(struct connection *connection)
 		free(gdb_connection->vflash_image);
 		gdb_connection->vflash_image = NULL;
 	}
+	free(gdb_connection->vflash_stream);
+	gdb_connection->vflash_stream = NULL;
 
 	/* if this connection registered a debug-message receiver delete it */
 	delete_debug_msg_receiver(connection->cmd_ctx, gdb_service->target);
 
 	if (connection->priv) {
+		free(gdb_connection->packet_buffer);
+		free(gdb_connection->out_buffer);
 		free(connection->priv);
 		connection->priv = NULL;
 	} else
 		LOG_ERROR("BUG: connection->priv == NULL");
 
+	if (read_only)
+		return ERROR_OK;
+
 	target_unregister_event_callback(gdb_target_callback_event_handler, connection);
 
 	target_call_event_callbacks(gdb_service->target, TARGET_EVENT_GDB_END);
@@ -1151,6 +1367,23 @@ static int gdb_get_registers_packet(struct connection *connection,
 	if (retval != ERROR_OK)
 		return gdb_error(connection, retval);
 
+	if (gdb_lazy_registers && target->rtos == NULL) {
+		/* GDB shrinks its idea of the 'g' packet to the first short
+		 * reply and never accepts a longer one on this connection, so
+		 * the number of registers sent is decided once: the leading
+		 * run of registers the target already has cached. */
+		struct gdb_connection *gdb_con = connection->priv;
+		if (gdb_con->g_packet_regs < 0) {
+			for (i = 0; i < reg_list_size && reg_list[i]->valid; i++)
+				;
+			gdb_con->g_packet_regs = i ? i : reg_list_size;
+			LOG_DEBUG("'g' replies carry %d of %d registers",
+					gdb_con->g_packet_regs, reg_list_size);
+		}
+		if (reg_list_size > gdb_con->g_packet_regs)
+			reg_list_size = gdb_con->g_packet_regs;
+	}
+
 	for (i = 0; i < reg_list_size; i++)
 		reg_packet_size += DIV_ROUND_UP(reg_list[i]->size, 8) * 2;
 
@@ -1162,6 +1395,9 @@ static int gdb_get_registers_packet(struct connection *connection,
 
 	reg_packet_p = reg_packet;
 
+	/* fetch whatever is not cached yet in as few batches as possible */
+	register_get_many(reg_list, reg_list_size);
+
 	for (i = 0; i < reg_list_size; i++) {
 		if (!reg_list[i]->valid)
 			reg_list[i]->type->get(reg_list[i]);
@@ -1219,8 +1455,12 @@ static int gdb_set_registers_packet(struct connection *connection,
 		uint8_t *bin_buf;
 		int chars = (DIV_ROUND_UP(reg_list[i]->size, 8) * 2);
 
-		if (packet_p + chars > packet + packet_size)
-			LOG_ERROR("BUG: register packet is too small for registers");
+		/* a 'G' packet only carries as many registers as our 'g' replies */
+		if (packet_p + chars > packet + packet_size) {
+			if (packet_p != packet + packet_size)
+				LOG_ERROR("BUG: register packet is too small for registers");
+			break;
+		}
 
 		bin_buf = malloc(DIV_ROUND_UP(reg_list[i]->size, 8));
 		gdb_target_to_reg(target, packet_p, chars, bin_buf);
@@ -1255,6 +1495,9 @@ static int gdb_get_register_packet(struct connection *connection,
 	LOG_DEBUG("-");
 #endif
 
+	if ((target->rtos != NULL) && (ERROR_OK == rtos_get_gdb_reg(connection, reg_num)))
+		return ERROR_OK;
+
 	retval = target_get_gdb_reg_list(target, &reg_list, &reg_list_size,
 			REG_CLASS_ALL);
 	if (retval != ERROR_OK)
@@ -1334,6 +1577,128 @@ static int gdb_set_register_packet(struct connection *connection,
  * GDB speak. This has to be done at the calling
  * site as no mapping really exists.
  */
+static void gdb_snapshot_invalidate(struct gdb_snapshot *snapshot)
+{
+	while (snapshot->blocks) {
+		struct gdb_snapshot_block *block = snapshot->blocks;
+		snapshot->blocks = block->next;
+		free(block->data);
+		free(block);
+	}
+	snapshot->size = 0;
+}
+
+/* any event may come with a change of target memory, e.g. resume, reset or
+ * flash programming, so the snapshot is dropped on all of them */
+static int gdb_snapshot_event_handler(struct target *target,
+		enum target_event event, void *priv)
+{
+	struct gdb_snapshot *snapshot = priv;
+
+	if (snapshot->target == target)
+		gdb_snapshot_invalidate(snapshot);
+	return ERROR_OK;
+}
+
+static struct gdb_snapshot *gdb_snapshot_get(struct target *target, bool create)
+{
+	struct gdb_snapshot *snapshot;
+
+	if (gdb_observers == 0)
+		return NULL;
+
+	for (snapshot = gdb_snapshots; snapshot; snapshot = snapshot->next)
+		if (snapshot->target == target)
+			return snapshot;
+	if (!create)
+		return NULL;
+
+	snapshot = calloc(1, sizeof(*snapshot));
+	if (snapshot == NULL)
+		return NULL;
+	snapshot->target = target;
+	if (target_register_event_callback(gdb_snapshot_event_handler, snapshot) != ERROR_OK) {
+		free(snapshot);
+		return NULL;
+	}
+	snapshot->next = gdb_snapshots;
+	gdb_snapshots = snapshot;
+	return snapshot;
+}
+
+/* copies len bytes at addr from the snapshot, returns false if any of them
+ * weren't read during the current stop */
+static bool gdb_snapshot_read(struct target *target, uint32_t addr, uint32_t len,
+		uint8_t *buffer)
+{
+	struct gdb_snapshot *snapshot = gdb_snapshot_get(target, false);
+
+	if (snapshot == NULL || target->state != TARGET_HALTED)
+		return false;
+
+	for (struct gdb_snapshot_block *block = snapshot->blocks; block; block = block->next) {
+		if (addr >= block->address && addr - block->address + len <= block->size) {
+			memcpy(buffer, block->data + (addr - block->address), len);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void gdb_snapshot_add(struct target *target, uint32_t addr, uint32_t len,
+		const uint8_t *buffer)
+{
+	struct gdb_snapshot *snapshot;
+	struct gdb_snapshot_block *block;
+
+	if (target->state != TARGET_HALTED)
+		return;
+	snapshot = gdb_snapshot_get(target, true);
+	if (snapshot == NULL || len > GDB_SNAPSHOT_MAX - snapshot->size)
+		return;
+
+	block = malloc(sizeof(*block));
+	if (block == NULL)
+		return;
+	block->data = malloc(len);
+	if (block->data == NULL) {
+		free(block);
+		return;
+	}
+	memcpy(block->data, buffer, len);
+	block->address = addr;
+	block->size = len;
+	block->next = snapshot->blocks;
+	snapshot->blocks = block;
+	snapshot->size += len;
+}
+
+/* packets an observer may send, none of them changes the target */
+static bool gdb_packet_is_read_only(char const *packet)
+{
+	switch (packet[0]) {
+		case 'q':
+			return strncmp(packet, "qRcmd,", 6) != 0;
+		case 'v':
+			if (strncmp(packet, "vCont", 5) == 0)
+				return packet[5] == '?';
+			return strncmp(packet, "vFlash", 6) != 0;
+		case 'Q':
+		case 'T':
+		case 'H':
+		case 'g':
+		case 'p':
+		case 'm':
+		case '?':
+		case 'j':
+		case 'D':
+		case 'k':
+			return true;
+		default:
+			return false;
+	}
+}
+
 static int gdb_error(struct connection *connection, int retval)
 {
 	LOG_DEBUG("Reporting %i to GDB as generic error", retval);
@@ -1346,10 +1711,64 @@ static int gdb_error(struct connection *connection, int retval)
  *
  * 8191 bytes by the looks of it. Why 8191 bytes instead of 8192?????
  */
+/* Memory reads larger than this are streamed to GDB chunk by chunk, so
+ * that sending one chunk overlaps with reading the next one from the
+ * target. */
+#define GDB_READ_MEMORY_CHUNK 1024
+
+/* Read memory and stream the hex encoded reply while reading. A chunk that
+ * fails to read is replied as zeros, see gdb_read_memory_packet(). Since
+ * the reply is already on its way, this is not used when data aborts are
+ * to be reported as errors. */
+static int gdb_read_memory_streamed(struct connection *connection,
+		uint32_t addr, uint32_t len, uint8_t *buffer, char *hex_buffer)
+{
+	struct target *target = get_target_from_connection(connection);
+	struct gdb_connection *gdb_con = connection->priv;
+	unsigned char checksum = 0;
+	char trailer[4];
+	uint32_t chunk;
+	int retval;
+
+	/* keep log output from ending up in the middle of the packet */
+	gdb_con->busy = 1;
+
+	retval = gdb_write(connection, "$", 1);
+	for (uint32_t done = 0; retval == ERROR_OK && done < len; done += chunk) {
+		chunk = MIN(len - done, GDB_READ_MEMORY_CHUNK);
+
+		if (target_read_buffer(target, addr + done, chunk, buffer + done) != ERROR_OK)
+			memset(buffer + done, 0, chunk);
+
+		char *hex = hex_buffer + 2 * done;
+		hexify(hex, (char *)buffer + done, chunk, 2 * chunk + 1);
+		for (uint32_t i = 0; i < 2 * chunk; i++)
+			checksum += hex[i];
+
+		retval = gdb_write(connection, hex, 2 * chunk);
+		if (retval == ERROR_OK)
+			retval = gdb_flush(connection);
+	}
+
+	if (retval == ERROR_OK) {
+		snprintf(trailer, sizeof(trailer), "#%02x", checksum);
+		retval = gdb_write(connection, trailer, 3);
+	}
+	/* wait for the ack, a retransmission uses the complete hex_buffer */
+	if (retval == ERROR_OK)
+		retval = gdb_put_packet_inner(connection, hex_buffer, 2 * len, true);
+
+	gdb_con->busy = 0;
+	kept_alive();
+
+	return retval;
+}
+
 static int gdb_read_memory_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
 	struct target *target = get_target_from_connection(connection);
+	struct gdb_connection *gdb_con = connection->priv;
 	char *separator;
 	uint32_t addr = 0;
 	uint32_t len = 0;
@@ -1381,7 +1800,28 @@ static int gdb_read_memory_packet(struct connection *connection,
 
 	LOG_DEBUG("addr: 0x%8.8" PRIx32 ", len: 0x%8.8" PRIx32 "", addr, len);
 
-	retval = target_read_buffer(target, addr, len, buffer);
+	if (gdb_snapshot_read(target, addr, len, buffer)) {
+		LOG_DEBUG("served from the memory snapshot");
+	} else {
+		/* observers must not get in the way of a running target */
+		if (gdb_con->read_only && target->state != TARGET_HALTED) {
+			free(buffer);
+			gdb_send_error(connection, EBUSY);
+			return ERROR_OK;
+		}
+
+		if (len > GDB_READ_MEMORY_CHUNK && !gdb_report_data_abort && !gdb_con->read_only) {
+			hex_buffer = malloc(len * 2 + 1);
+			retval = gdb_read_memory_streamed(connection, addr, len, buffer, hex_buffer);
+			free(hex_buffer);
+			free(buffer);
+			return retval;
+		}
+
+		retval = target_read_buffer(target, addr, len, buffer);
+		if (retval == ERROR_OK)
+			gdb_snapshot_add(target, addr, len, buffer);
+	}
 
 	if ((retval != ERROR_OK) && !gdb_report_data_abort) {
 		/* TODO : Here we have to lie and send back all zero's lest stack traces won't work.
@@ -1454,6 +1894,10 @@ static int gdb_write_memory_packet(struct connection *connection,
 
 	retval = target_write_buffer(target, addr, len, buffer);
 
+	/* the write may have hit a thread's saved stack frame */
+	if (target->rtos != NULL)
+		rtos_reg_cache_invalidate(target->rtos);
+
 	if (retval == ERROR_OK)
 		gdb_put_packet(connection, "OK", 2);
 	else
@@ -1516,11 +1960,68 @@ static int gdb_write_memory_binary_packet(struct connection *connection,
 		retval = target_write_buffer(target, addr, len, (uint8_t *)separator);
 		if (retval != ERROR_OK)
 			gdb_connection->mem_write_error = true;
+		if (target->rtos != NULL)
+			rtos_reg_cache_invalidate(target->rtos);
 	}
 
 	return ERROR_OK;
 }
 
+/* Range steps stop inside the range after this long; GDB just sends
+ * the next vCont;r, and meanwhile gets to see a Ctrl-C. */
+#define GDB_RANGE_STEP_MAX_MS	200
+
+/*
+ * vCont;r: step while the PC stays in [start,end), and send a single stop
+ * reply. The target's own step is used, e.g. arm7_9 predicts the next PC
+ * with the ARM simulator; only the PC is looked at between steps. Stops
+ * early at breakpoints and watchpoints, as GDB expects.
+ */
+static int gdb_range_step(struct connection *connection, uint32_t start, uint32_t end)
+{
+	struct target *target = get_target_from_connection(connection);
+	struct gdb_connection *gdb_con = connection->priv;
+	struct reg *pc = register_get_by_name(target->reg_cache, "pc", 1);
+	int64_t then = timeval_ms();
+	unsigned steps = 0;
+	uint32_t pc_value;
+	int retval;
+
+	LOG_DEBUG("range step 0x%8.8" PRIx32 "-0x%8.8" PRIx32, start, end);
+
+	/* the halt after each step is not for GDB, hold the stop reply */
+	gdb_con->frontend_state = TARGET_HALTED;
+
+	for (;;) {
+		retval = target_step(target, 1, 0, 0);
+		steps++;
+		if (retval != ERROR_OK || target->state != TARGET_HALTED || pc == NULL)
+			break;
+
+		if (!pc->valid) {
+			retval = pc->type->get(pc);
+			if (retval != ERROR_OK)
+				break;
+		}
+		pc_value = buf_get_u32(pc->value, 0, 32);
+		if (pc_value < start || pc_value >= end)
+			break;
+		if (target->debug_reason != DBG_REASON_SINGLESTEP ||
+				breakpoint_find(target, pc_value) != NULL)
+			break;
+		if (timeval_ms() - then > GDB_RANGE_STEP_MAX_MS)
+			break;
+		keep_alive();
+	}
+
+	LOG_DEBUG("range step: %u steps", steps);
+
+	gdb_con->frontend_state = TARGET_RUNNING;
+	if (retval == ERROR_OK && target->state == TARGET_HALTED)
+		gdb_frontend_halted(target, connection);
+	return retval;
+}
+
 static int gdb_step_continue_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
@@ -1531,6 +2032,15 @@ static int gdb_step_continue_packet(struct connection *connection,
 
 	LOG_DEBUG("-");
 
+	if (packet[0] == 'r') {
+		char *separator;
+		uint32_t start = strtoul(packet + 1, &separator, 16);
+		uint32_t end = strtoul(separator + 1, NULL, 16);
+
+		gdb_running_type = 's';
+		return gdb_range_step(connection, start, end);
+	}
+
 	if (packet_size > 1)
 		address = strtoul(packet + 1, NULL, 16);
 	else
@@ -1719,47 +2229,92 @@ static int compare_bank(const void *a, const void *b)
 		return -1;
 }
 
-static int gdb_memory_map(struct connection *connection,
-		char const *packet, int packet_size)
+static uint32_t gdb_xml_key_add(uint32_t key, uint32_t value)
+{
+	/* FNV-1a, a word at a time */
+	for (int i = 0; i < 4; i++) {
+		key ^= (value >> (8 * i)) & 0xff;
+		key *= 16777619u;
+	}
+	return key;
+}
+
+static uint32_t gdb_xml_key_add_ptr(uint32_t key, const void *p)
+{
+	uint64_t value = (uintptr_t)p;
+
+	key = gdb_xml_key_add(key, value);
+	return gdb_xml_key_add(key, value >> 32);
+}
+
+static struct gdb_xml_cache *gdb_xml_cache_get(struct target *target)
+{
+	struct gdb_xml_cache *cache;
+
+	for (cache = gdb_xml_caches; cache; cache = cache->next)
+		if (cache->target == target)
+			return cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (cache == NULL)
+		return NULL;
+	cache->target = target;
+	cache->next = gdb_xml_caches;
+	gdb_xml_caches = cache;
+	return cache;
+}
+
+/* One qXfer chunk of xml: 'm' if more follows, 'l' for the last one */
+static char *gdb_xml_chunk(const char *xml, size_t xml_length,
+		uint32_t offset, uint32_t length)
+{
+	char transfer_type = 'm';
+
+	if (offset > xml_length)
+		offset = xml_length;
+	if (length >= xml_length - offset) {
+		length = xml_length - offset;
+		transfer_type = 'l';
+	}
+
+	char *chunk = malloc(length + 2);
+	if (chunk == NULL) {
+		LOG_ERROR("Unable to allocate memory");
+		return NULL;
+	}
+
+	chunk[0] = transfer_type;
+	memcpy(chunk + 1, xml + offset, length);
+	chunk[1 + length] = '\0';
+
+	return chunk;
+}
+
+/* Rebuild the cached memory map if the flash banks of the target changed */
+static int gdb_update_memory_map(struct target *target, struct gdb_xml_cache *cache)
 {
 	/* We get away with only specifying flash here. Regions that are not
 	 * specified are treated as if we provided no memory map(if not we
 	 * could detect the holes and mark them as RAM).
-	 * Normally we only execute this code once, but no big deal if we
-	 * have to regenerate it a couple of times.
 	 */
 
-	struct target *target = get_target_from_connection(connection);
 	struct flash_bank *p;
 	char *xml = NULL;
 	int size = 0;
 	int pos = 0;
 	int retval = ERROR_OK;
 	struct flash_bank **banks;
-	int offset;
-	int length;
-	char *separator;
 	uint32_t ram_start = 0;
+	uint32_t key = 2166136261u;
 	int i;
 	int target_flash_banks = 0;
 
-	/* skip command character */
-	packet += 23;
-
-	offset = strtoul(packet, &separator, 16);
-	length = strtoul(separator + 1, &separator, 16);
-
-	xml_printf(&retval, &xml, &pos, &size, "<memory-map>\n");
-
-	/* Sort banks in ascending order.  We need to report non-flash
-	 * memory as ram (or rather read/write) by default for GDB, since
-	 * it has no concept of non-cacheable read/write memory (i/o etc).
-	 *
-	 * FIXME Most non-flash addresses are *NOT* RAM!  Don't lie.
-	 * Current versions of GDB assume unlisted addresses are RAM...
-	 */
 	banks = malloc(sizeof(struct flash_bank *)*flash_get_bank_count());
+	if (banks == NULL && flash_get_bank_count() > 0)
+		return ERROR_FAIL;
 
+	/* the geometry of the banks, which may change when they are probed,
+	 * decides whether the cached map is still good */
 	for (i = 0; i < flash_get_bank_count(); i++) {
 		p = get_flash_bank_by_num_noprobe(i);
 		if (p->target != target)
@@ -1767,12 +2322,34 @@ static int gdb_memory_map(struct connection *connection,
 		retval = get_flash_bank_by_num(i, &p);
 		if (retval != ERROR_OK) {
 			free(banks);
-			gdb_error(connection, retval);
 			return retval;
 		}
 		banks[target_flash_banks++] = p;
+
+		key = gdb_xml_key_add_ptr(key, p);
+		key = gdb_xml_key_add(key, p->base);
+		key = gdb_xml_key_add(key, p->size);
+		key = gdb_xml_key_add(key, p->num_sectors);
+		for (int j = 0; j < p->num_sectors; j++) {
+			key = gdb_xml_key_add(key, p->sectors[j].offset);
+			key = gdb_xml_key_add(key, p->sectors[j].size);
+		}
+	}
+
+	if (cache->memory_map != NULL && cache->memory_map_key == key) {
+		free(banks);
+		return ERROR_OK;
 	}
 
+	xml_printf(&retval, &xml, &pos, &size, "<memory-map>\n");
+
+	/* Sort banks in ascending order.  We need to report non-flash
+	 * memory as ram (or rather read/write) by default for GDB, since
+	 * it has no concept of non-cacheable read/write memory (i/o etc).
+	 *
+	 * FIXME Most non-flash addresses are *NOT* RAM!  Don't lie.
+	 * Current versions of GDB assume unlisted addresses are RAM...
+	 */
 	qsort(banks, target_flash_banks, sizeof(struct flash_bank *),
 		compare_bank);
 
@@ -1847,21 +2424,57 @@ static int gdb_memory_map(struct connection *connection,
 
 	xml_printf(&retval, &xml, &pos, &size, "</memory-map>\n");
 
-	if (retval != ERROR_OK) {
-		gdb_error(connection, retval);
+	if (retval != ERROR_OK)
 		return retval;
+
+	free(cache->memory_map);
+	cache->memory_map = xml;
+	cache->memory_map_length = pos;
+	cache->memory_map_key = key;
+
+	return ERROR_OK;
+}
+
+static int gdb_memory_map(struct connection *connection,
+		char const *packet, int packet_size)
+{
+	struct target *target = get_target_from_connection(connection);
+	struct gdb_xml_cache *cache = gdb_xml_cache_get(target);
+	int retval;
+	uint32_t offset;
+	uint32_t length;
+	char *separator;
+
+	/* skip command character */
+	packet += 23;
+
+	offset = strtoul(packet, &separator, 16);
+	length = strtoul(separator + 1, &separator, 16);
+
+	if (cache == NULL) {
+		gdb_error(connection, ERROR_FAIL);
+		return ERROR_FAIL;
 	}
 
-	if (offset + length > pos)
-		length = pos - offset;
+	/* A read starts at offset 0, that's when the banks are checked.
+	 * The following chunks come from the same document. */
+	if (offset == 0 || cache->memory_map == NULL) {
+		retval = gdb_update_memory_map(target, cache);
+		if (retval != ERROR_OK) {
+			gdb_error(connection, retval);
+			return retval;
+		}
+	}
 
-	char *t = malloc(length + 1);
-	t[0] = 'l';
-	memcpy(t + 1, xml + offset, length);
-	gdb_put_packet(connection, t, length + 1);
+	char *t = gdb_xml_chunk(cache->memory_map, cache->memory_map_length,
+			offset, length);
+	if (t == NULL) {
+		gdb_error(connection, ERROR_FAIL);
+		return ERROR_FAIL;
+	}
+	gdb_put_packet(connection, t, strlen(t));
 
 	free(t);
-	free(xml);
 	return ERROR_OK;
 }
 
@@ -2169,33 +2782,174 @@ error:
 	return retval;
 }
 
-static int gdb_get_target_description_chunk(struct target *target, struct target_desc_format *target_desc,
+static int gdb_get_target_description_chunk(struct target *target,
 		char **chunk, int32_t offset, uint32_t length)
 {
-	if (target_desc == NULL) {
+	struct gdb_xml_cache *cache = gdb_xml_cache_get(target);
+	if (cache == NULL) {
 		LOG_ERROR("Unable to Generate Target Description");
 		return ERROR_FAIL;
 	}
 
-	char *tdesc = target_desc->tdesc;
-	uint32_t tdesc_length = target_desc->tdesc_length;
+	/* A read starts at offset 0, that's when the register list is
+	 * checked. The following chunks come from the same document. */
+	if (offset == 0 || cache->tdesc == NULL) {
+		struct reg **reg_list = NULL;
+		int reg_list_size = 0;
+		uint32_t key = 2166136261u;
 
-	if (tdesc == NULL) {
-		int retval = gdb_generate_target_description(target, &tdesc);
+		int retval = target_get_gdb_reg_list(target, &reg_list,
+				&reg_list_size, REG_CLASS_ALL);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Unable to Generate Target Description");
 			return ERROR_FAIL;
 		}
+		for (int i = 0; i < reg_list_size; i++) {
+			struct reg *reg = reg_list[i];
+			key = gdb_xml_key_add_ptr(key, reg);
+			key = gdb_xml_key_add_ptr(key, reg->name);
+			key = gdb_xml_key_add_ptr(key, reg->feature);
+			key = gdb_xml_key_add_ptr(key, reg->reg_data_type);
+			key = gdb_xml_key_add(key, reg->size);
+			key = gdb_xml_key_add(key, reg->exist);
+		}
+		free(reg_list);
+
+		if (cache->tdesc == NULL || cache->tdesc_key != key) {
+			char *tdesc;
+
+			retval = gdb_generate_target_description(target, &tdesc);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("Unable to Generate Target Description");
+				return ERROR_FAIL;
+			}
+
+			free(cache->tdesc);
+			cache->tdesc = tdesc;
+			cache->tdesc_length = strlen(tdesc);
+			cache->tdesc_key = key;
+		}
+	}
+
+	*chunk = gdb_xml_chunk(cache->tdesc, cache->tdesc_length, offset, length);
+	if (*chunk == NULL)
+		return ERROR_FAIL;
+
+	return ERROR_OK;
+}
+
+/* print s with the XML special characters escaped */
+static void xml_print_escaped(int *retval, char **xml, int *pos, int *size,
+		const char *s)
+{
+	for (; *s; s++) {
+		size_t n = strcspn(s, "<>&\"");
+		if (n > 0) {
+			xml_printf(retval, xml, pos, size, "%.*s", (int)n, s);
+			s += n;
+			if (*s == '\0')
+				break;
+		}
+		switch (*s) {
+			case '<':
+				xml_printf(retval, xml, pos, size, "&lt;");
+				break;
+			case '>':
+				xml_printf(retval, xml, pos, size, "&gt;");
+				break;
+			case '&':
+				xml_printf(retval, xml, pos, size, "&amp;");
+				break;
+			default:
+				xml_printf(retval, xml, pos, size, "&quot;");
+				break;
+		}
+	}
+}
+
+/*
+ * The whole RTOS thread list for qXfer:threads:read, so that GDB gets ids,
+ * names and extra info in a few chunks instead of a qThreadExtraInfo
+ * round trip per thread.
+ */
+static int gdb_generate_thread_list(struct target *target, char **thread_list_out)
+{
+	struct rtos *rtos = target->rtos;
+	int retval = ERROR_OK;
+	char *thread_list = NULL;
+	int pos = 0;
+	int size = 0;
+
+	xml_printf(&retval, &thread_list, &pos, &size,
+			"<?xml version=\"1.0\"?>\n<threads>\n");
+
+	if (rtos != NULL && rtos->thread_details != NULL) {
+		for (int i = 0; i < rtos->thread_count; i++) {
+			struct thread_detail *detail = &rtos->thread_details[i];
+
+			if (!detail->exists)
+				continue;
+
+			xml_printf(&retval, &thread_list, &pos, &size,
+					"<thread id=\"%" PRIx64 "\"", detail->threadid);
+			if (detail->thread_name_str != NULL) {
+				xml_printf(&retval, &thread_list, &pos, &size, " name=\"");
+				xml_print_escaped(&retval, &thread_list, &pos, &size,
+						detail->thread_name_str);
+				xml_printf(&retval, &thread_list, &pos, &size, "\"");
+			}
+			xml_printf(&retval, &thread_list, &pos, &size, ">");
+
+			/* the same text qThreadExtraInfo reports, minus the name */
+			if (detail->display_str != NULL)
+				xml_print_escaped(&retval, &thread_list, &pos, &size,
+						detail->display_str);
+			if (detail->extra_info_str != NULL) {
+				if (detail->display_str != NULL)
+					xml_printf(&retval, &thread_list, &pos, &size, " : ");
+				xml_print_escaped(&retval, &thread_list, &pos, &size,
+						detail->extra_info_str);
+			}
+
+			xml_printf(&retval, &thread_list, &pos, &size, "</thread>\n");
+		}
+	}
+
+	xml_printf(&retval, &thread_list, &pos, &size, "</threads>\n");
+
+	if (retval == ERROR_OK)
+		*thread_list_out = thread_list;
+	else
+		free(thread_list);
+
+	return retval;
+}
 
-		tdesc_length = strlen(tdesc);
+static int gdb_get_thread_list_chunk(struct target *target, char **thread_list,
+		char **chunk, int32_t offset, uint32_t length)
+{
+	if (*thread_list == NULL || offset == 0) {
+		free(*thread_list);
+		*thread_list = NULL;
+		int retval = gdb_generate_thread_list(target, thread_list);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Unable to Generate Thread List");
+			return ERROR_FAIL;
+		}
 	}
 
+	size_t thread_list_length = strlen(*thread_list);
+	if ((size_t)offset > thread_list_length)
+		offset = thread_list_length;
+
 	char transfer_type;
 
-	if (length < (tdesc_length - offset))
+	if (length < (thread_list_length - offset))
 		transfer_type = 'm';
-	else
+	else {
 		transfer_type = 'l';
+		length = thread_list_length - offset;
+	}
 
 	*chunk = malloc(length + 2);
 	if (*chunk == NULL) {
@@ -2204,22 +2958,15 @@ static int gdb_get_target_description_chunk(struct target *target, struct target
 	}
 
 	(*chunk)[0] = transfer_type;
-	if (transfer_type == 'm') {
-		strncpy((*chunk) + 1, tdesc + offset, length);
-		(*chunk)[1 + length] = '\0';
-	} else {
-		strncpy((*chunk) + 1, tdesc + offset, tdesc_length - offset);
-		(*chunk)[1 + (tdesc_length - offset)] = '\0';
+	memcpy((*chunk) + 1, *thread_list + offset, length);
+	(*chunk)[1 + length] = '\0';
 
-		/* After gdb-server sends out last chunk, invalidate tdesc. */
-		free(tdesc);
-		tdesc = NULL;
-		tdesc_length = 0;
+	/* After gdb-server sends out last chunk, invalidate the list. */
+	if (transfer_type == 'l') {
+		free(*thread_list);
+		*thread_list = NULL;
 	}
 
-	target_desc->tdesc = tdesc;
-	target_desc->tdesc_length = tdesc_length;
-
 	return ERROR_OK;
 }
 
@@ -2355,8 +3102,9 @@ static int gdb_query_packet(struct connection *connection,
 			&buffer,
 			&pos,
 			&size,
-			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;QStartNoAckMode+",
-			(GDB_BUFFER_SIZE - 1),
+			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;"
+			"qXfer:threads:read+;QStartNoAckMode+",
+			(gdb_connection->packet_size - 1),
 			((gdb_use_memory_map == 1) && (flash_get_bank_count() > 0)) ? '+' : '-',
 			(gdb_target_desc_supported == 1) ? '+' : '-');
 
@@ -2392,7 +3140,32 @@ static int gdb_query_packet(struct connection *connection,
 		 * there are *more* chunks to transfer. 'l' for it is the *last*
 		 * chunk of target description.
 		 */
-		retval = gdb_get_target_description_chunk(target, &gdb_connection->target_desc,
+		retval = gdb_get_target_description_chunk(target, &xml, offset, length);
+		if (retval != ERROR_OK) {
+			gdb_error(connection, retval);
+			return retval;
+		}
+
+		gdb_put_packet(connection, xml, strlen(xml));
+
+		free(xml);
+		return ERROR_OK;
+	} else if (strncmp(packet, "qXfer:threads:read:", 19) == 0) {
+		char *xml = NULL;
+		int retval = ERROR_OK;
+
+		int offset;
+		unsigned int length;
+
+		/* skip command character */
+		packet += 19;
+
+		if (decode_xfer_read(packet, NULL, &offset, &length) < 0) {
+			gdb_send_error(connection, 01);
+			return ERROR_OK;
+		}
+
+		retval = gdb_get_thread_list_chunk(target, &gdb_connection->thread_list,
 				&xml, offset, length);
 		if (retval != ERROR_OK) {
 			gdb_error(connection, retval);
@@ -2413,6 +3186,138 @@ static int gdb_query_packet(struct connection *connection,
 	return ERROR_OK;
 }
 
+/* Programs the first len bytes of the pending vFlashWrite data and drops
+ * them from the buffer. The first error is kept for vFlashDone. */
+static void gdb_vflash_stream_program(struct connection *connection, uint32_t len)
+{
+	struct gdb_service *gdb_service = connection->service->priv;
+	struct gdb_connection *gdb_con = connection->priv;
+	struct target *target = gdb_service->target;
+	struct image image;
+	uint32_t written;
+	int retval;
+
+	if (len == 0)
+		return;
+
+	if (!gdb_con->vflash_stream_started) {
+		target_call_event_callbacks(target, TARGET_EVENT_GDB_FLASH_WRITE_START);
+		gdb_con->vflash_stream_started = true;
+	}
+
+	if (gdb_con->vflash_stream_error == ERROR_OK) {
+		retval = image_open(&image, "", "build");
+		if (retval == ERROR_OK) {
+			retval = image_add_section(&image, gdb_con->vflash_stream_start, len,
+					0x0, gdb_con->vflash_stream);
+			if (retval == ERROR_OK)
+				retval = flash_write(target, &image, &written, 0);
+			image_close(&image);
+		}
+		if (retval != ERROR_OK) {
+			LOG_ERROR("programming flash at 0x%8.8" PRIx32 " failed",
+					gdb_con->vflash_stream_start);
+			gdb_con->vflash_stream_error = retval;
+		} else
+			LOG_DEBUG("wrote %" PRIu32 " bytes at 0x%8.8" PRIx32 " to flash",
+					written, gdb_con->vflash_stream_start);
+	}
+
+	gdb_con->vflash_stream_len -= len;
+	gdb_con->vflash_stream_start += len;
+	memmove(gdb_con->vflash_stream, gdb_con->vflash_stream + len,
+			gdb_con->vflash_stream_len);
+}
+
+/* Programs the pending data up to the last complete sector, the rest may
+ * still be followed by data of the next vFlashWrite. */
+static void gdb_vflash_stream_program_sectors(struct connection *connection)
+{
+	struct gdb_service *gdb_service = connection->service->priv;
+	struct gdb_connection *gdb_con = connection->priv;
+	struct flash_bank *bank;
+	uint32_t end = gdb_con->vflash_stream_start + gdb_con->vflash_stream_len;
+	uint32_t boundary = gdb_con->vflash_stream_start;
+
+	if (gdb_con->vflash_stream_len == 0 ||
+			get_flash_bank_by_addr(gdb_service->target, gdb_con->vflash_stream_start,
+				false, &bank) != ERROR_OK || bank == NULL)
+		return;
+
+	for (int i = 0; i < bank->num_sectors; i++) {
+		uint32_t sector_end = bank->base + bank->sectors[i].offset + bank->sectors[i].size;
+		if (sector_end > end)
+			break;
+		if (sector_end > boundary)
+			boundary = sector_end;
+	}
+
+	gdb_vflash_stream_program(connection, boundary - gdb_con->vflash_stream_start);
+}
+
+/* Adds a vFlashWrite packet to the pending data, after programming what
+ * is pending in another bank. Returns ERROR_FAIL if the packet is outside
+ * the flash banks or precedes the pending data; the caller then moves the
+ * pending data into the vFlash image and goes on with that. */
+static int gdb_vflash_stream_add(struct connection *connection, uint32_t addr,
+		uint32_t length, const uint8_t *data)
+{
+	struct gdb_service *gdb_service = connection->service->priv;
+	struct gdb_connection *gdb_con = connection->priv;
+	struct target *target = gdb_service->target;
+	struct flash_bank *bank;
+	uint32_t end = gdb_con->vflash_stream_start + gdb_con->vflash_stream_len;
+	uint32_t pad = 0;
+	int retval;
+
+	retval = get_flash_bank_by_addr(target, addr, false, &bank);
+	if (retval != ERROR_OK || bank == NULL)
+		return ERROR_FAIL;
+
+	if (gdb_con->vflash_stream_len > 0) {
+		if (addr < end)
+			return ERROR_FAIL;
+		if (gdb_con->vflash_stream_start < bank->base ||
+				gdb_con->vflash_stream_start - bank->base >= bank->size)
+			gdb_vflash_stream_program(connection, gdb_con->vflash_stream_len);
+		else
+			pad = addr - end;
+	}
+	if (gdb_con->vflash_stream_len == 0)
+		gdb_con->vflash_stream_start = addr;
+
+	uint32_t needed = gdb_con->vflash_stream_len + pad + length;
+	if (needed > gdb_con->vflash_stream_alloc) {
+		uint8_t *buf = realloc(gdb_con->vflash_stream, needed);
+		if (buf == NULL)
+			return ERROR_FAIL;
+		gdb_con->vflash_stream = buf;
+		gdb_con->vflash_stream_alloc = needed;
+	}
+
+	memset(gdb_con->vflash_stream + gdb_con->vflash_stream_len, 0xff, pad);
+	memcpy(gdb_con->vflash_stream + gdb_con->vflash_stream_len + pad, data, length);
+	gdb_con->vflash_stream_len = needed;
+
+	return ERROR_OK;
+}
+
+/* Moves the pending data into the vFlash image, for downloads that
+ * don't arrive in address order */
+static int gdb_vflash_stream_to_image(struct connection *connection)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	int retval;
+
+	if (gdb_con->vflash_stream_len == 0)
+		return ERROR_OK;
+
+	retval = image_add_section(gdb_con->vflash_image, gdb_con->vflash_stream_start,
+			gdb_con->vflash_stream_len, 0x0, gdb_con->vflash_stream);
+	gdb_con->vflash_stream_len = 0;
+	return retval;
+}
+
 static int gdb_v_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
@@ -2500,10 +3405,23 @@ static int gdb_v_packet(struct connection *connection,
 		}
 		length = packet_size - (parse - packet);
 
+		/* program the data we have while GDB sends the next packet */
+		if (gdb_flash_stream && gdb_connection->vflash_image == NULL &&
+				gdb_vflash_stream_add(connection, addr, length,
+					(const uint8_t *)parse) == ERROR_OK) {
+			gdb_put_packet(connection, "OK", 2);
+			gdb_flush(connection);
+			gdb_vflash_stream_program_sectors(connection);
+			return ERROR_OK;
+		}
+
 		/* create a new image if there isn't already one */
 		if (gdb_connection->vflash_image == NULL) {
 			gdb_connection->vflash_image = malloc(sizeof(struct image));
 			image_open(gdb_connection->vflash_image, "", "build");
+			retval = gdb_vflash_stream_to_image(connection);
+			if (retval != ERROR_OK)
+				return retval;
 		}
 
 		/* create new section with content from packet buffer */
@@ -2522,10 +3440,19 @@ static int gdb_v_packet(struct connection *connection,
 
 		/* process the flashing buffer. No need to erase as GDB
 		 * always issues a vFlashErase first. */
-		target_call_event_callbacks(gdb_service->target,
-				TARGET_EVENT_GDB_FLASH_WRITE_START);
-		result = flash_write(gdb_service->target, gdb_connection->vflash_image, &written, 0);
+		gdb_vflash_stream_program(connection, gdb_connection->vflash_stream_len);
+		if (!gdb_connection->vflash_stream_started)
+			target_call_event_callbacks(gdb_service->target,
+					TARGET_EVENT_GDB_FLASH_WRITE_START);
+		result = gdb_connection->vflash_stream_error;
+		if (result == ERROR_OK && gdb_connection->vflash_image)
+			result = flash_write(gdb_service->target, gdb_connection->vflash_image,
+					&written, 0);
+		else
+			written = 0;
 		target_call_event_callbacks(gdb_service->target, TARGET_EVENT_GDB_FLASH_WRITE_END);
+		gdb_connection->vflash_stream_started = false;
+		gdb_connection->vflash_stream_error = ERROR_OK;
 		if (result != ERROR_OK) {
 			if (result == ERROR_FLASH_DST_OUT_OF_BANK)
 				gdb_put_packet(connection, "E.memtype", 9);
@@ -2536,9 +3463,11 @@ static int gdb_v_packet(struct connection *connection,
 			gdb_put_packet(connection, "OK", 2);
 		}
 
-		image_close(gdb_connection->vflash_image);
-		free(gdb_connection->vflash_image);
-		gdb_connection->vflash_image = NULL;
+		if (gdb_connection->vflash_image) {
+			image_close(gdb_connection->vflash_image);
+			free(gdb_connection->vflash_image);
+			gdb_connection->vflash_image = NULL;
+		}
 
 		return ERROR_OK;
 	}
@@ -2550,8 +3479,10 @@ static int gdb_v_packet(struct connection *connection,
 static int gdb_detach(struct connection *connection)
 {
 	struct gdb_service *gdb_service = connection->service->priv;
+	struct gdb_connection *gdb_con = connection->priv;
 
-	target_call_event_callbacks(gdb_service->target, TARGET_EVENT_GDB_DETACH);
+	if (!gdb_con->read_only)
+		target_call_event_callbacks(gdb_service->target, TARGET_EVENT_GDB_DETACH);
 
 	return gdb_put_packet(connection, "OK", 2);
 }
@@ -2625,17 +3556,200 @@ static void gdb_sig_halted(struct connection *connection)
 	gdb_put_packet(connection, sig_reply, 3);
 }
 
-static int gdb_input_inner(struct connection *connection)
+/* "perf dump" counter for a packet, by its first character */
+static enum perf_counter gdb_packet_perf_counter(char type)
+{
+	switch (type) {
+		case 'q':
+		case 'Q':
+		case 'H':
+		case 'T':
+			return PERF_GDB_QUERY;
+		case 'g':
+		case 'G':
+		case 'p':
+		case 'P':
+			return PERF_GDB_REGISTER;
+		case 'm':
+			return PERF_GDB_MEM_READ;
+		case 'M':
+		case 'X':
+			return PERF_GDB_MEM_WRITE;
+		case 'z':
+		case 'Z':
+			return PERF_GDB_BREAKPOINT;
+		case 'c':
+		case 's':
+		case 'v':
+			return PERF_GDB_RUN;
+		default:
+			return PERF_GDB_OTHER;
+	}
+}
+
+/* packets whose reply is produced without lengthy target operations */
+/* 'c' and 's', and the actions of vCont */
+static int gdb_resume_packet(struct connection *connection,
+		char const *packet, int packet_size)
+{
+	struct target *target = get_target_from_connection(connection);
+	struct gdb_connection *gdb_con = connection->priv;
+	int retval = ERROR_OK;
+
+	gdb_thread_packet(connection, packet, packet_size);
+	log_add_callback(gdb_log_callback, connection);
+
+	if (gdb_con->mem_write_error) {
+		LOG_ERROR("Memory write failure!");
+
+		/* now that we have reported the memory write error,
+		 * we can clear the condition */
+		gdb_con->mem_write_error = false;
+	}
+
+	bool nostep = false;
+	bool already_running = false;
+	if (target->state == TARGET_RUNNING) {
+		LOG_WARNING("WARNING! The target is already running. "
+				"All changes GDB did to registers will be discarded! "
+				"Waiting for target to halt.");
+		already_running = true;
+	} else if (target->state != TARGET_HALTED) {
+		LOG_WARNING("The target is not in the halted nor running stated, " \
+				"stepi/continue ignored.");
+		nostep = true;
+	} else if ((packet[0] == 's' || packet[0] == 'r') && gdb_con->sync) {
+		/* Hmm..... when you issue a continue in GDB, then a "stepi" is
+		 * sent by GDB first to OpenOCD, thus defeating the check to
+		 * make only the single stepping have the sync feature...
+		 */
+		nostep = true;
+		LOG_WARNING("stepi ignored. GDB will now fetch the register state " \
+				"from the target.");
+	}
+	gdb_con->sync = false;
+
+	if (!already_running && nostep) {
+		/* Either the target isn't in the halted state, then we can't
+		 * step/continue. This might be early setup, etc.
+		 *
+		 * Or we want to allow GDB to pick up a fresh set of
+		 * register values without modifying the target state.
+		 *
+		 */
+		gdb_sig_halted(connection);
+
+		/* stop forwarding log packets! */
+		log_remove_callback(gdb_log_callback, connection);
+	} else {
+		/* We're running/stepping, in which case we can
+		 * forward log output until the target is halted
+		 */
+		gdb_con->frontend_state = TARGET_RUNNING;
+		target_call_event_callbacks(target, TARGET_EVENT_GDB_START);
+
+		if (!already_running) {
+			/* Here we don't want packet processing to stop even if this fails,
+			 * so we use a local variable instead of retval. */
+			retval = gdb_step_continue_packet(connection, packet, packet_size);
+			if (retval != ERROR_OK) {
+				/* we'll never receive a halted
+				 * condition... issue a false one..
+				 */
+				gdb_frontend_halted(target, connection);
+			}
+		}
+	}
+
+	return retval;
+}
+
+/*
+ * vCont with all-stop semantics. OpenOCD resumes and steps whole cores
+ * (all of them for SMP), not threads, so the thread ids of the actions
+ * are ignored: if any action steps, the core steps, otherwise it
+ * continues. A range step 'r' is run by gdb_range_step(). Signals to
+ * deliver are ignored, and 't' actions only make sense in non-stop mode,
+ * which isn't supported.
+ */
+static int gdb_vcont_packet(struct connection *connection,
+		char const *packet, int packet_size)
+{
+	char const *action;
+	char resume_type = 0;
+	char resume_packet[32];
+
+	if (strcmp(packet, "vCont?") == 0) {
+		gdb_put_packet(connection, "vCont;c;C;s;S;r", 15);
+		return ERROR_OK;
+	}
+
+	if (strncmp(packet, "vCont;", 6) != 0) {
+		gdb_put_packet(connection, "", 0);
+		return ERROR_OK;
+	}
+
+	for (action = packet + 5; action; action = strchr(action + 1, ';')) {
+		switch (action[1]) {
+			case 'r':
+				if (resume_type == 0 || resume_type == 'c') {
+					uint32_t start, end;
+					if (sscanf(action + 2, "%" SCNx32 ",%" SCNx32, &start, &end) != 2) {
+						gdb_send_error(connection, 01);
+						return ERROR_OK;
+					}
+					resume_type = 'r';
+					snprintf(resume_packet, sizeof(resume_packet),
+							"r%" PRIx32 ",%" PRIx32, start, end);
+				}
+				break;
+			case 's':
+			case 'S':
+				resume_type = 's';
+				break;
+			case 'c':
+			case 'C':
+				if (resume_type == 0)
+					resume_type = 'c';
+				break;
+			default:
+				LOG_DEBUG("ignoring vCont action '%c'", action[1]);
+				break;
+		}
+	}
+
+	if (resume_type == 0) {
+		gdb_send_error(connection, 01);
+		return ERROR_OK;
+	}
+
+	if (resume_type != 'r') {
+		resume_packet[0] = resume_type;
+		resume_packet[1] = 0;
+	}
+	return gdb_resume_packet(connection, resume_packet, strlen(resume_packet));
+}
+
+static bool gdb_packet_is_quick(const char *packet, int packet_size)
 {
-	/* Do not allocate this on the stack */
-	static char gdb_packet_buffer[GDB_BUFFER_SIZE];
+	if (packet_size == 0)
+		return false;
 
+	if (packet[0] == 'q')
+		return strncmp(packet, "qRcmd,", 6) != 0;
+
+	return strchr("gmpHT?", packet[0]) != NULL;
+}
+
+static int gdb_input_inner(struct connection *connection)
+{
 	struct gdb_service *gdb_service = connection->service->priv;
 	struct target *target = gdb_service->target;
+	struct gdb_connection *gdb_con = connection->priv;
+	char *gdb_packet_buffer = gdb_con->packet_buffer;
 	char const *packet = gdb_packet_buffer;
 	int packet_size;
 	int retval;
-	struct gdb_connection *gdb_con = connection->priv;
 	static int extended_protocol;
 
 	/* drain input buffer. If one of the packets fail, then an error
@@ -2650,7 +3764,7 @@ static int gdb_input_inner(struct connection *connection)
 	 * drain the rest of the buffer.
 	 */
 	do {
-		packet_size = GDB_BUFFER_SIZE-1;
+		packet_size = gdb_con->packet_size - 1;
 		retval = gdb_get_packet(connection, gdb_packet_buffer, &packet_size);
 		if (retval != ERROR_OK)
 			return retval;
@@ -2658,6 +3772,16 @@ static int gdb_input_inner(struct connection *connection)
 		/* terminate with zero */
 		gdb_packet_buffer[packet_size] = '\0';
 
+		/* The ack of packets that are answered quickly stays buffered and
+		 * goes out with the reply. Anything else may keep us busy for a
+		 * while (flash, reset, monitor commands, resume), so send the ack
+		 * right away and keep GDB from timing out on it. */
+		if (!gdb_packet_is_quick(packet, packet_size)) {
+			retval = gdb_flush(connection);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+
 		if (LOG_LEVEL_IS(LOG_LVL_DEBUG)) {
 			if (packet[0] == 'X') {
 				/* binary packets spew junk into the debug log stream */
@@ -2671,7 +3795,13 @@ static int gdb_input_inner(struct connection *connection)
 				LOG_DEBUG("received packet: '%s'", packet);
 		}
 
-		if (packet_size > 0) {
+		if (packet_size > 0 && gdb_con->read_only && !gdb_packet_is_read_only(packet)) {
+			LOG_DEBUG("refusing 0x%2.2x packet of read-only connection", packet[0]);
+			gdb_send_error(connection, EPERM);
+		} else if (packet_size > 0) {
+			perf_add(PERF_GDB_PACKETS, 1);
+			perf_add(gdb_packet_perf_counter(packet[0]), 1);
+
 			retval = ERROR_OK;
 			switch (packet[0]) {
 				case 'T':	/* Is thread alive? */
@@ -2714,78 +3844,18 @@ static int gdb_input_inner(struct connection *connection)
 					break;
 				case 'c':
 				case 's':
-				{
-					gdb_thread_packet(connection, packet, packet_size);
-					log_add_callback(gdb_log_callback, connection);
-
-					if (gdb_con->mem_write_error) {
-						LOG_ERROR("Memory write failure!");
-
-						/* now that we have reported the memory write error,
-						 * we can clear the condition */
-						gdb_con->mem_write_error = false;
-					}
-
-					bool nostep = false;
-					bool already_running = false;
-					if (target->state == TARGET_RUNNING) {
-						LOG_WARNING("WARNING! The target is already running. "
-								"All changes GDB did to registers will be discarded! "
-								"Waiting for target to halt.");
-						already_running = true;
-					} else if (target->state != TARGET_HALTED) {
-						LOG_WARNING("The target is not in the halted nor running stated, " \
-								"stepi/continue ignored.");
-						nostep = true;
-					} else if ((packet[0] == 's') && gdb_con->sync) {
-						/* Hmm..... when you issue a continue in GDB, then a "stepi" is
-						 * sent by GDB first to OpenOCD, thus defeating the check to
-						 * make only the single stepping have the sync feature...
-						 */
-						nostep = true;
-						LOG_WARNING("stepi ignored. GDB will now fetch the register state " \
-								"from the target.");
-					}
-					gdb_con->sync = false;
-
-					if (!already_running && nostep) {
-						/* Either the target isn't in the halted state, then we can't
-						 * step/continue. This might be early setup, etc.
-						 *
-						 * Or we want to allow GDB to pick up a fresh set of
-						 * register values without modifying the target state.
-						 *
-						 */
-						gdb_sig_halted(connection);
-
-						/* stop forwarding log packets! */
-						log_remove_callback(gdb_log_callback, connection);
-					} else {
-						/* We're running/stepping, in which case we can
-						 * forward log output until the target is halted
-						 */
-						gdb_con->frontend_state = TARGET_RUNNING;
-						target_call_event_callbacks(target, TARGET_EVENT_GDB_START);
-
-						if (!already_running) {
-							/* Here we don't want packet processing to stop even if this fails,
-							 * so we use a local variable instead of retval. */
-							retval = gdb_step_continue_packet(connection, packet, packet_size);
-							if (retval != ERROR_OK) {
-								/* we'll never receive a halted
-								 * condition... issue a false one..
-								 */
-								gdb_frontend_halted(target, connection);
-							}
-						}
-					}
-				}
-				break;
+					retval = gdb_resume_packet(connection, packet, packet_size);
+					break;
 				case 'v':
-					retval = gdb_v_packet(connection, packet, packet_size);
+					if (strncmp(packet, "vCont", 5) == 0)
+						retval = gdb_vcont_packet(connection, packet, packet_size);
+					else
+						retval = gdb_v_packet(connection, packet, packet_size);
 					break;
 				case 'D':
 					retval = gdb_detach(connection);
+					if (gdb_con->read_only)
+						return ERROR_SERVER_REMOTE_CLOSED;
 					extended_protocol = 0;
 					break;
 				case 'X':
@@ -2794,7 +3864,7 @@ static int gdb_input_inner(struct connection *connection)
 						return retval;
 					break;
 				case 'k':
-					if (extended_protocol != 0) {
+					if (extended_protocol != 0 && !gdb_con->read_only) {
 						gdb_con->attached = false;
 						break;
 					}
@@ -2850,11 +3920,22 @@ static int gdb_input_inner(struct connection *connection)
 					break;
 			}
 
+			/* memory read by any connection before may be stale now */
+			if (!gdb_packet_is_read_only(packet)) {
+				struct gdb_snapshot *snapshot = gdb_snapshot_get(target, false);
+				if (snapshot)
+					gdb_snapshot_invalidate(snapshot);
+			}
+
 			/* if a packet handler returned an error, exit input loop */
 			if (retval != ERROR_OK)
 				return retval;
 		}
 
+		/* observers can't halt the target */
+		if (gdb_con->read_only)
+			gdb_con->ctrl_c = 0;
+
 		if (gdb_con->ctrl_c) {
 			if (target->state == TARGET_RUNNING) {
 				retval = target_halt(target);
@@ -2879,6 +3960,10 @@ static int gdb_input(struct connection *connection)
 	if (retval == ERROR_SERVER_REMOTE_CLOSED)
 		return retval;
 
+	/* do not keep anything back while we return to the server loop */
+	if (gdb_flush(connection) != ERROR_OK)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
 	/* logging does not propagate the error, yet can set the gdb_con->closed flag */
 	if (gdb_con->closed)
 		return ERROR_SERVER_REMOTE_CLOSED;
@@ -2902,7 +3987,7 @@ static int gdb_target_start(struct target *target, const char *port)
 	target->gdb_service = gdb_service;
 
 	ret = add_service("gdb",
-			port, 1, &gdb_new_connection, &gdb_input,
+			port, 1 + gdb_observers, &gdb_new_connection, &gdb_input,
 			&gdb_connection_closed, gdb_service);
 	/* initialialize all targets gdb service with the same pointer */
 	{
@@ -3005,6 +4090,15 @@ COMMAND_HANDLER(handle_gdb_flash_program_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_flash_stream_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ENABLE(CMD_ARGV[0], gdb_flash_stream);
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_gdb_report_data_abort_command)
 {
 	if (CMD_ARGC != 1)
@@ -3014,6 +4108,48 @@ COMMAND_HANDLER(handle_gdb_report_data_abort_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_lazy_registers_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ENABLE(CMD_ARGV[0], gdb_lazy_registers);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_gdb_packet_size_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		int size;
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], size);
+		if (size < GDB_BUFFER_SIZE || size > GDB_MAX_PACKET_SIZE) {
+			LOG_ERROR("packet size must be between %d and %d bytes",
+				GDB_BUFFER_SIZE, GDB_MAX_PACKET_SIZE);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		gdb_packet_size = size;
+	}
+
+	command_print(CMD_CTX, "gdb packet size: %d bytes", gdb_packet_size);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_gdb_observers_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], gdb_observers);
+	if (gdb_observers < 0) {
+		gdb_observers = 0;
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+	return ERROR_OK;
+}
+
 /* gdb_breakpoint_override */
 COMMAND_HANDLER(handle_gdb_breakpoint_override_command)
 {
@@ -3128,6 +4264,13 @@ static const struct command_registration gdb_command_handlers[] = {
 		.help = "enable or disable flash program",
 		.usage = "('enable'|'disable')"
 	},
+	{
+		.name = "gdb_flash_stream",
+		.handler = handle_gdb_flash_stream_command,
+		.mode = COMMAND_CONFIG,
+		.help = "enable or disable programming flash while GDB sends the data",
+		.usage = "('enable'|'disable')"
+	},
 	{
 		.name = "gdb_report_data_abort",
 		.handler = handle_gdb_report_data_abort_command,
@@ -3135,6 +4278,31 @@ static const struct command_registration gdb_command_handlers[] = {
 		.help = "enable or disable reporting data aborts",
 		.usage = "('enable'|'disable')"
 	},
+	{
+		.name = "gdb_lazy_registers",
+		.handler = handle_gdb_lazy_registers_command,
+		.mode = COMMAND_CONFIG,
+		.help = "enable or disable sending only cached registers "
+			"in 'g' replies",
+		.usage = "('enable'|'disable')"
+	},
+	{
+		.name = "gdb_packet_size",
+		.handler = handle_gdb_packet_size_command,
+		.mode = COMMAND_ANY,
+		.help = "Display or specify the PacketSize offered to new GDB "
+			"connections. Larger packets speed up GDB load and "
+			"memory reads on fast adapters.",
+		.usage = "[bytes]"
+	},
+	{
+		.name = "gdb_observers",
+		.handler = handle_gdb_observers_command,
+		.mode = COMMAND_CONFIG,
+		.help = "number of read-only GDB connections accepted per target "
+			"in addition to the one in control",
+		.usage = "count"
+	},
 	{
 		.name = "gdb_breakpoint_override",
 		.handler = handle_gdb_breakpoint_override_command,
@@ -0,0 +1,442 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "remote_adapter_server.h"
+#include <jtag/jtag.h>
+#include <jtag/interface.h>
+#include <jtag/minidriver.h>
+#include <jtag/swd.h>
+#include <jtag/remote_adapter.h>
+#include <transport/transport.h>
+
+/* Runs the requests of the remote_adapter driver of another OpenOCD on
+ * the adapter of this one, see jtag/remote_adapter.h */
+
+extern struct jtag_interface *jtag_interface;
+
+struct remote_adapter_connection {
+	/* received bytes, not yet a complete request */
+	uint8_t *in;
+	size_t in_len;
+	size_t in_size;
+};
+
+/* walks the operations of a request */
+struct remote_adapter_reader {
+	const uint8_t *data;
+	size_t left;
+	bool error;
+};
+
+static char *remote_adapter_server_port;
+
+/* longest path move, more than enough to get from any state to any other */
+#define REMOTE_ADAPTER_MAX_PATH		64
+
+static const uint8_t *remote_adapter_get(struct remote_adapter_reader *r, size_t len)
+{
+	if (r->error || r->left < len) {
+		r->error = true;
+		return NULL;
+	}
+	const uint8_t *data = r->data;
+	r->data += len;
+	r->left -= len;
+	return data;
+}
+
+static uint8_t remote_adapter_get_u8(struct remote_adapter_reader *r)
+{
+	const uint8_t *data = remote_adapter_get(r, 1);
+	return data ? *data : 0;
+}
+
+static uint32_t remote_adapter_get_u32(struct remote_adapter_reader *r)
+{
+	const uint8_t *data = remote_adapter_get(r, 4);
+	return data ? le_to_h_u32(data) : 0;
+}
+
+static tap_state_t remote_adapter_get_state(struct remote_adapter_reader *r)
+{
+	uint8_t state = remote_adapter_get_u8(r);
+	if (state > 15)
+		r->error = true;
+	return state;
+}
+
+/* Goes through the JTAG operations of a request, adding up the size of
+ * the reply; with @a reply, queues them, capturing into @a reply */
+static int remote_adapter_jtag_ops(const uint8_t *data, size_t len,
+		uint8_t *reply, size_t *reply_len)
+{
+	struct remote_adapter_reader r = { .data = data, .left = len };
+	int retval = ERROR_OK;
+
+	*reply_len = 0;
+	while (r.left > 0 && !r.error && retval == ERROR_OK) {
+		uint8_t op = remote_adapter_get_u8(&r);
+
+		switch (op) {
+		case REMOTE_ADAPTER_SCAN:
+		{
+			bool ir = remote_adapter_get_u8(&r);
+			tap_state_t state = remote_adapter_get_state(&r);
+			bool capture = remote_adapter_get_u8(&r);
+			bool out = remote_adapter_get_u8(&r);
+			uint32_t num_bits = remote_adapter_get_u32(&r);
+			if (num_bits == 0 || num_bits > REMOTE_ADAPTER_MAX_MESSAGE * 8) {
+				r.error = true;
+				break;
+			}
+			const uint8_t *out_bits = out ?
+				remote_adapter_get(&r, DIV_ROUND_UP(num_bits, 8)) : NULL;
+			uint8_t *in_bits = capture && reply ? reply + *reply_len : NULL;
+			if (capture)
+				*reply_len += DIV_ROUND_UP(num_bits, 8);
+			if (r.error || !reply)
+				break;
+			if (ir)
+				retval = interface_jtag_add_plain_ir_scan(num_bits, out_bits, in_bits, state);
+			else
+				retval = interface_jtag_add_plain_dr_scan(num_bits, out_bits, in_bits, state);
+			break;
+		}
+		case REMOTE_ADAPTER_TLR:
+			if (reply)
+				retval = interface_jtag_add_tlr();
+			break;
+		case REMOTE_ADAPTER_RUNTEST:
+		{
+			uint32_t cycles = remote_adapter_get_u32(&r);
+			tap_state_t state = remote_adapter_get_state(&r);
+			if (reply && !r.error)
+				retval = interface_jtag_add_runtest(cycles, state);
+			break;
+		}
+		case REMOTE_ADAPTER_CLOCKS:
+		{
+			uint32_t cycles = remote_adapter_get_u32(&r);
+			if (reply && !r.error)
+				retval = interface_jtag_add_clocks(cycles);
+			break;
+		}
+		case REMOTE_ADAPTER_PATHMOVE:
+		{
+			uint32_t num_states = remote_adapter_get_u32(&r);
+			tap_state_t path[REMOTE_ADAPTER_MAX_PATH];
+			if (num_states == 0 || num_states > REMOTE_ADAPTER_MAX_PATH) {
+				r.error = true;
+				break;
+			}
+			for (uint32_t i = 0; i < num_states; i++)
+				path[i] = remote_adapter_get_state(&r);
+			if (reply && !r.error)
+				retval = interface_jtag_add_pathmove(num_states, path);
+			break;
+		}
+		case REMOTE_ADAPTER_SLEEP:
+		{
+			uint32_t us = remote_adapter_get_u32(&r);
+			if (reply && !r.error)
+				retval = interface_jtag_add_sleep(us);
+			break;
+		}
+		case REMOTE_ADAPTER_RESET:
+		{
+			int trst = remote_adapter_get_u8(&r);
+			int srst = remote_adapter_get_u8(&r);
+			if (reply && !r.error)
+				retval = interface_jtag_add_reset(trst, srst);
+			break;
+		}
+		default:
+			r.error = true;
+			break;
+		}
+	}
+
+	if (r.error) {
+		LOG_ERROR("remote adapter: malformed JTAG request");
+		return ERROR_FAIL;
+	}
+	return retval;
+}
+
+static int remote_adapter_jtag(const uint8_t *data, size_t len,
+		uint8_t **reply, size_t *reply_len)
+{
+	/* check the whole request before queueing any of it */
+	int retval = remote_adapter_jtag_ops(data, len, NULL, reply_len);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* room for one byte more, so that a request without captures
+	 * still gets a buffer to queue them with */
+	*reply = calloc(1, *reply_len + 1);
+	if (*reply == NULL)
+		return ERROR_FAIL;
+
+	retval = remote_adapter_jtag_ops(data, len, *reply, reply_len);
+	if (retval != ERROR_OK) {
+		jtag_command_queue_reset();
+		return retval;
+	}
+
+	return jtag_execute_queue();
+}
+
+static int remote_adapter_swd(const uint8_t *data, size_t len,
+		uint8_t **reply, size_t *reply_len)
+{
+	const struct swd_driver *swd = jtag_interface->swd;
+	struct remote_adapter_reader r = { .data = data, .left = len };
+	unsigned num_reads = 0;
+	int retval = ERROR_OK;
+
+	if (!transport_is_swd() || swd == NULL)
+		return ERROR_FAIL;
+
+	/* each operation is at least 2 bytes, so this is enough for the reads */
+	uint32_t *values = calloc(len / 2 + 1, sizeof(uint32_t));
+	if (values == NULL)
+		return ERROR_FAIL;
+
+	while (r.left > 0 && !r.error && retval == ERROR_OK) {
+		uint8_t op = remote_adapter_get_u8(&r);
+
+		switch (op) {
+		case REMOTE_ADAPTER_SWD_SEQ:
+		{
+			uint8_t seq = remote_adapter_get_u8(&r);
+			if (!r.error)
+				retval = swd->switch_seq(seq);
+			break;
+		}
+		case REMOTE_ADAPTER_SWD_READ:
+		{
+			uint8_t cmd = remote_adapter_get_u8(&r);
+			uint32_t ap_delay_clk = remote_adapter_get_u32(&r);
+			if (!r.error)
+				swd->read_reg(cmd, &values[num_reads++], ap_delay_clk);
+			break;
+		}
+		case REMOTE_ADAPTER_SWD_WRITE:
+		{
+			uint8_t cmd = remote_adapter_get_u8(&r);
+			uint32_t value = remote_adapter_get_u32(&r);
+			uint32_t ap_delay_clk = remote_adapter_get_u32(&r);
+			if (!r.error)
+				swd->write_reg(cmd, value, ap_delay_clk);
+			break;
+		}
+		default:
+			r.error = true;
+			break;
+		}
+	}
+
+	if (r.error)
+		LOG_ERROR("remote adapter: malformed SWD request");
+
+	/* always run, so that nothing stays queued */
+	int run_retval = swd->run();
+	if (r.error)
+		retval = ERROR_FAIL;
+	else if (retval == ERROR_OK)
+		retval = run_retval;
+
+	*reply = (uint8_t *)values;
+	*reply_len = num_reads * 4;
+	for (unsigned i = 0; i < num_reads; i++)
+		h_u32_to_le(*reply + 4 * i, values[i]);
+
+	return retval;
+}
+
+static int remote_adapter_request(const uint8_t *data, size_t len,
+		uint8_t **reply, size_t *reply_len)
+{
+	struct remote_adapter_reader r = { .data = data + 1, .left = len - 1 };
+
+	switch (data[0]) {
+	case REMOTE_ADAPTER_HELLO:
+	{
+		uint32_t version = remote_adapter_get_u32(&r);
+		bool swd = remote_adapter_get_u8(&r);
+		if (r.error || version != REMOTE_ADAPTER_VERSION) {
+			LOG_ERROR("remote adapter: unsupported protocol version");
+			return ERROR_FAIL;
+		}
+		if (swd != transport_is_swd()) {
+			LOG_ERROR("remote adapter: the client uses %s, this server %s",
+					swd ? "SWD" : "JTAG", swd ? "JTAG" : "SWD");
+			return ERROR_FAIL;
+		}
+		LOG_INFO("remote adapter: client connected");
+		return ERROR_OK;
+	}
+	case REMOTE_ADAPTER_SPEED:
+	{
+		uint32_t khz = remote_adapter_get_u32(&r);
+		int actual_khz;
+		if (r.error)
+			return ERROR_FAIL;
+		int retval = jtag_config_khz(khz);
+		if (retval == ERROR_OK)
+			retval = jtag_get_speed_readable(&actual_khz);
+		if (retval != ERROR_OK)
+			return retval;
+		*reply = malloc(4);
+		if (*reply == NULL)
+			return ERROR_FAIL;
+		h_u32_to_le(*reply, actual_khz);
+		*reply_len = 4;
+		return ERROR_OK;
+	}
+	case REMOTE_ADAPTER_JTAG:
+		return remote_adapter_jtag(r.data, r.left, reply, reply_len);
+	case REMOTE_ADAPTER_SWD:
+		return remote_adapter_swd(r.data, r.left, reply, reply_len);
+	default:
+		LOG_ERROR("remote adapter: unknown request 0x%02x", data[0]);
+		return ERROR_FAIL;
+	}
+}
+
+static int remote_adapter_reply(struct connection *connection, int status,
+		const uint8_t *data, size_t len)
+{
+	uint8_t header[8];
+
+	h_u32_to_le(header, len + 4);
+	h_u32_to_le(header + 4, status);
+
+	int retval = connection_write_buffered(connection, header, sizeof(header));
+	if (retval == ERROR_OK && len > 0)
+		retval = connection_write_buffered(connection, data, len);
+	return retval;
+}
+
+static int remote_adapter_new_connection(struct connection *connection)
+{
+	connection->priv = calloc(1, sizeof(struct remote_adapter_connection));
+	if (connection->priv == NULL)
+		return ERROR_CONNECTION_REJECTED;
+	return ERROR_OK;
+}
+
+static int remote_adapter_input(struct connection *connection)
+{
+	struct remote_adapter_connection *rc = connection->priv;
+	uint8_t buf[4096];
+	int retval = ERROR_OK;
+
+	int len = connection_read(connection, buf, sizeof(buf));
+	if (len <= 0)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
+	if (rc->in_len + len > rc->in_size) {
+		size_t size = MAX(rc->in_size * 2, rc->in_len + len);
+		uint8_t *in = realloc(rc->in, size);
+		if (in == NULL)
+			return ERROR_SERVER_REMOTE_CLOSED;
+		rc->in = in;
+		rc->in_size = size;
+	}
+	memcpy(rc->in + rc->in_len, buf, len);
+	rc->in_len += len;
+
+	size_t done = 0;
+	while (rc->in_len - done >= 4 && retval == ERROR_OK) {
+		uint32_t size = le_to_h_u32(rc->in + done);
+
+		if (size == 0 || size > REMOTE_ADAPTER_MAX_MESSAGE) {
+			LOG_ERROR("remote adapter: invalid request size %" PRIu32
+					", closing connection", size);
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+		if (rc->in_len - done < 4 + size)
+			break;
+
+		uint8_t *reply = NULL;
+		size_t reply_len = 0;
+		int status = remote_adapter_request(rc->in + done + 4, size, &reply, &reply_len);
+		if (status != ERROR_OK)
+			reply_len = 0;
+		retval = remote_adapter_reply(connection, status, reply, reply_len);
+		free(reply);
+		done += 4 + size;
+	}
+
+	memmove(rc->in, rc->in + done, rc->in_len - done);
+	rc->in_len -= done;
+
+	if (connection_flush(connection) != ERROR_OK)
+		return ERROR_SERVER_REMOTE_CLOSED;
+	return retval;
+}
+
+static int remote_adapter_closed(struct connection *connection)
+{
+	struct remote_adapter_connection *rc = connection->priv;
+
+	if (rc) {
+		free(rc->in);
+		free(rc);
+		connection->priv = NULL;
+	}
+
+	LOG_INFO("remote adapter: client disconnected");
+	return ERROR_OK;
+}
+
+int remote_adapter_server_init(void)
+{
+	if (strcmp(remote_adapter_server_port, "disabled") == 0)
+		return ERROR_OK;
+
+	return add_service("remote adapter", remote_adapter_server_port, 1,
+		&remote_adapter_new_connection, &remote_adapter_input,
+		&remote_adapter_closed, NULL);
+}
+
+COMMAND_HANDLER(handle_remote_adapter_server_port_command)
+{
+	return CALL_COMMAND_HANDLER(server_pipe_command, &remote_adapter_server_port);
+}
+
+static const struct command_registration remote_adapter_server_command_handlers[] = {
+	{
+		.name = "remote_adapter_server_port",
+		.handler = handle_remote_adapter_server_port_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Specify port on which to serve the adapter to the "
+			"remote_adapter driver of another OpenOCD, "
+			"\"disabled\" by default.",
+		.usage = "[port_num]",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int remote_adapter_server_register_commands(struct command_context *cmd_ctx)
+{
+	remote_adapter_server_port = strdup("disabled");
+	return register_commands(cmd_ctx, NULL, remote_adapter_server_command_handlers);
+}
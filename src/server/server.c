@@ -27,12 +27,14 @@
 #endif
 
 #include "server.h"
+#include <helper/time_support.h>
 #include <target/target.h>
 #include <target/target_request.h>
 #include <target/openrisc/jsp_server.h>
 #include "openocd.h"
 #include "tcl_server.h"
 #include "telnet_server.h"
+#include "remote_adapter_server.h"
 
 #include <signal.h>
 
@@ -44,6 +46,14 @@
 #include <netinet/tcp.h>
 #endif
 
+#if defined(HAVE_SYS_EPOLL_H) && !defined(_WIN32)
+#include <sys/epoll.h>
+#define SERVER_EVENTS_EPOLL
+#elif defined(HAVE_POLL_H) && !defined(_WIN32)
+#include <poll.h>
+#define SERVER_EVENTS_POLL
+#endif
+
 static struct service *services;
 
 /* shutdown_openocd == 1: exit the main event loop, and quit the
@@ -59,6 +69,219 @@ static int polling_period = 100;
 /* address by name on which to listen for incoming TCP/IP connections */
 static char *bindto_name;
 
+/*
+ * Event backend used by server_loop().
+ *
+ * File descriptors are registered once, when a service starts listening or
+ * a connection is accepted, and stay registered until they are closed. On
+ * every wakeup the backend only raises the "readable" flag of the owning
+ * service or connection; server_loop() then walks the lists as before. The
+ * flag is set for the whole batch before any input handler runs, so a
+ * handler dropping a connection never leaves a dangling event behind.
+ *
+ * Linux uses epoll, other hosts use poll() and _WIN32 keeps select().
+ */
+#if defined(SERVER_EVENTS_EPOLL)
+
+#define SERVER_MAX_EVENTS 32
+
+static int epoll_fd = -1;
+
+static int server_events_init(void)
+{
+	epoll_fd = epoll_create(SERVER_MAX_EVENTS);
+	if (epoll_fd == -1) {
+		LOG_ERROR("error creating epoll instance: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+static void server_events_quit(void)
+{
+	if (epoll_fd != -1)
+		close(epoll_fd);
+	epoll_fd = -1;
+}
+
+static void server_events_add(int fd, bool *readable)
+{
+	struct epoll_event ev;
+
+	if (fd == -1 || (epoll_fd == -1 && server_events_init() != ERROR_OK))
+		return;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = readable;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+		LOG_ERROR("couldn't watch fd %d: %s", fd, strerror(errno));
+}
+
+static void server_events_del(int fd)
+{
+	struct epoll_event ev;
+
+	if (fd == -1 || epoll_fd == -1)
+		return;
+
+	/* a non-NULL event is needed by kernels before 2.6.9 */
+	memset(&ev, 0, sizeof(ev));
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+}
+
+static int server_events_wait(int timeout_ms)
+{
+	struct epoll_event events[SERVER_MAX_EVENTS];
+
+	int n = epoll_wait(epoll_fd, events, SERVER_MAX_EVENTS, timeout_ms);
+	for (int i = 0; i < n; i++)
+		*(bool *)events[i].data.ptr = true;
+
+	return n;
+}
+
+#elif defined(SERVER_EVENTS_POLL)
+
+static struct pollfd *poll_fds;
+static bool **poll_flags;
+static unsigned poll_count, poll_size;
+
+static void server_events_quit(void)
+{
+	free(poll_fds);
+	free(poll_flags);
+	poll_fds = NULL;
+	poll_flags = NULL;
+	poll_count = 0;
+	poll_size = 0;
+}
+
+static void server_events_add(int fd, bool *readable)
+{
+	if (fd == -1)
+		return;
+
+	if (poll_count == poll_size) {
+		unsigned size = poll_size ? poll_size * 2 : 16;
+		struct pollfd *fds = realloc(poll_fds, size * sizeof(*fds));
+		bool **flags = realloc(poll_flags, size * sizeof(*flags));
+		if (fds)
+			poll_fds = fds;
+		if (flags)
+			poll_flags = flags;
+		if (fds == NULL || flags == NULL) {
+			LOG_ERROR("out of memory watching fd %d", fd);
+			return;
+		}
+		poll_size = size;
+	}
+
+	poll_fds[poll_count].fd = fd;
+	poll_fds[poll_count].events = POLLIN;
+	poll_fds[poll_count].revents = 0;
+	poll_flags[poll_count] = readable;
+	poll_count++;
+}
+
+static void server_events_del(int fd)
+{
+	for (unsigned i = 0; i < poll_count; i++) {
+		if (poll_fds[i].fd == fd) {
+			/* order does not matter, move the last entry here */
+			poll_count--;
+			poll_fds[i] = poll_fds[poll_count];
+			poll_flags[i] = poll_flags[poll_count];
+			return;
+		}
+	}
+}
+
+static int server_events_wait(int timeout_ms)
+{
+	int n = poll(poll_fds, poll_count, timeout_ms);
+	if (n <= 0)
+		return n;
+
+	for (unsigned i = 0; i < poll_count; i++) {
+		/* also report hangups and errors, input() then sees the EOF */
+		if (poll_fds[i].revents)
+			*poll_flags[i] = true;
+	}
+
+	return n;
+}
+
+#else
+
+static void server_events_quit(void)
+{
+}
+
+static void server_events_add(int fd, bool *readable)
+{
+}
+
+static void server_events_del(int fd)
+{
+}
+
+/* select() fallback, the fd_set has to be rebuilt on every call */
+static int server_events_wait(int timeout_ms)
+{
+	struct service *service;
+	struct connection *c;
+	fd_set read_fds;
+	int fd_max = 0;
+	int retval;
+
+	FD_ZERO(&read_fds);
+
+	for (service = services; service; service = service->next) {
+		if (service->fd != -1) {
+			FD_SET(service->fd, &read_fds);
+			if (service->fd > fd_max)
+				fd_max = service->fd;
+		}
+
+		for (c = service->connections; c; c = c->next) {
+			FD_SET(c->fd, &read_fds);
+			if (c->fd > fd_max)
+				fd_max = c->fd;
+		}
+	}
+
+	struct timeval tv;
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+	retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
+	if (retval <= 0) {
+#ifdef _WIN32
+		if (retval == -1) {
+			errno = WSAGetLastError();
+			if (errno == WSAEINTR)
+				errno = EINTR;
+		}
+#endif
+		return retval;
+	}
+
+	for (service = services; service; service = service->next) {
+		if (service->fd != -1 && FD_ISSET(service->fd, &read_fds))
+			service->readable = true;
+
+		for (c = service->connections; c; c = c->next) {
+			if (FD_ISSET(c->fd, &read_fds))
+				c->readable = true;
+		}
+	}
+
+	return retval;
+}
+
+#endif
+
 static int add_connection(struct service *service, struct command_context *cmd_ctx)
 {
 	socklen_t address_size;
@@ -73,6 +296,12 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	c->cmd_ctx = copy_command_context(cmd_ctx);
 	c->service = service;
 	c->input_pending = 0;
+	c->readable = false;
+	c->out_buf = NULL;
+	c->out_len = 0;
+	c->out_size = 0;
+	c->out_since = 0;
+	c->out_error = false;
 	c->priv = NULL;
 	c->next = NULL;
 
@@ -111,7 +340,9 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 		SetConsoleCtrlHandler(NULL, TRUE);
 #endif
 
-		/* do not check for new connections again on stdin */
+		/* do not check for new connections again on stdin, the fd is
+		 * now watched on behalf of the connection */
+		server_events_del(service->fd);
 		service->fd = -1;
 
 		LOG_INFO("accepting '%s' connection from pipe", service->name);
@@ -125,6 +356,7 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	} else if (service->type == CONNECTION_PIPE) {
 		c->fd = service->fd;
 		/* do not check for new connections again on stdin */
+		server_events_del(service->fd);
 		service->fd = -1;
 
 		char *out_file = alloc_printf("%so", service->port);
@@ -150,6 +382,8 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 		;
 	*p = c;
 
+	server_events_add(c->fd, &c->readable);
+
 	if (service->max_connections != CONNECTION_LIMIT_UNLIMITED)
 		service->max_connections--;
 
@@ -165,17 +399,21 @@ static int remove_connection(struct service *service, struct connection *connect
 	while ((c = *p)) {
 		if (c->fd == connection->fd) {
 			service->connection_closed(c);
+			server_events_del(c->fd);
 			if (service->type == CONNECTION_TCP)
 				close_socket(c->fd);
 			else if (service->type == CONNECTION_PIPE) {
 				/* The service will listen to the pipe again */
 				c->service->fd = c->fd;
+				c->service->readable = false;
+				server_events_add(c->fd, &c->service->readable);
 			}
 
 			command_done(c->cmd_ctx);
 
 			/* delete connection */
 			*p = c->next;
+			free(c->out_buf);
 			free(c);
 
 			if (service->max_connections != CONNECTION_LIMIT_UNLIMITED)
@@ -214,6 +452,7 @@ int add_service(char *name,
 	c->new_connection = new_connection_handler;
 	c->input = input_handler;
 	c->connection_closed = connection_closed_handler;
+	c->readable = false;
 	c->priv = priv;
 	c->next = NULL;
 	long portnumber;
@@ -318,6 +557,8 @@ int add_service(char *name,
 		;
 	*p = c;
 
+	server_events_add(c->fd, &c->readable);
+
 	return ERROR_OK;
 }
 
@@ -329,6 +570,8 @@ static int remove_services(void)
 	while (c) {
 		struct service *next = c->next;
 
+		server_events_del(c->fd);
+
 		if (c->name)
 			free(c->name);
 
@@ -350,20 +593,29 @@ static int remove_services(void)
 	}
 
 	services = NULL;
+	server_events_quit();
 
 	return ERROR_OK;
 }
 
+/* how long server_loop() may sleep before the next timer callback is due */
+static int server_sleep_ms(void)
+{
+	int timeout_ms = polling_period;
+	int next_timer_ms = target_timer_next_due_ms();
+
+	if (next_timer_ms >= 0 && next_timer_ms < timeout_ms)
+		timeout_ms = next_timer_ms;
+
+	return timeout_ms;
+}
+
 int server_loop(struct command_context *command_context)
 {
 	struct service *service;
 
 	bool poll_ok = true;
 
-	/* used in select() */
-	fd_set read_fds;
-	int fd_max;
-
 	/* used in accept() */
 	int retval;
 
@@ -373,69 +625,35 @@ int server_loop(struct command_context *command_context)
 #endif
 
 	while (!shutdown_openocd) {
-		/* monitor sockets for activity */
-		fd_max = 0;
-		FD_ZERO(&read_fds);
-
-		/* add service and connection fds to read_fds */
+		/* send what the connections queued in the last iteration */
 		for (service = services; service; service = service->next) {
-			if (service->fd != -1) {
-				/* listen for new connections */
-				FD_SET(service->fd, &read_fds);
-
-				if (service->fd > fd_max)
-					fd_max = service->fd;
-			}
-
-			if (service->connections) {
-				struct connection *c;
-
-				for (c = service->connections; c; c = c->next) {
-					/* check for activity on the connection */
-					FD_SET(c->fd, &read_fds);
-					if (c->fd > fd_max)
-						fd_max = c->fd;
-				}
+			for (struct connection *c = service->connections; c; c = c->next) {
+				if (c->out_len)
+					connection_flush(c);
 			}
 		}
 
-		struct timeval tv;
-		tv.tv_sec = 0;
 		if (poll_ok) {
 			/* we're just polling this iteration, this is faster on embedded
 			 * hosts */
-			tv.tv_usec = 0;
-			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
+			retval = server_events_wait(0);
 		} else {
-			/* Every 100ms, can be changed with "poll_period" command */
-			tv.tv_usec = polling_period * 1000;
-			/* Only while we're sleeping we'll let others run */
+			/* Sleep until the next timer callback is due, but at most
+			 * for the period set with the "poll_period" command.
+			 * Only while we're sleeping we'll let others run */
 			openocd_sleep_prelude();
 			kept_alive();
-			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
+			retval = server_events_wait(server_sleep_ms());
 			openocd_sleep_postlude();
 		}
 
 		if (retval == -1) {
-#ifdef _WIN32
-
-			errno = WSAGetLastError();
-
-			if (errno == WSAEINTR)
-				FD_ZERO(&read_fds);
-			else {
-				LOG_ERROR("error during select: %s", strerror(errno));
-				exit(-1);
-			}
-#else
-
 			if (errno == EINTR)
-				FD_ZERO(&read_fds);
+				retval = 0;
 			else {
-				LOG_ERROR("error during select: %s", strerror(errno));
+				LOG_ERROR("error waiting for events: %s", strerror(errno));
 				exit(-1);
 			}
-#endif
 		}
 
 		if (retval == 0) {
@@ -444,13 +662,15 @@ int server_loop(struct command_context *command_context)
 			target_call_timer_callbacks();
 			process_jim_events(command_context);
 
-			FD_ZERO(&read_fds);	/* eCos leaves read_fds unchanged in this case!  */
-
 			/* We timed out/there was nothing to do, timeout rather than poll next time
 			 **/
 			poll_ok = false;
 		} else {
-			/* There was something to do, next time we'll just poll */
+			/* There was something to do, next time we'll just poll.
+			 * Do not let a busy connection starve callbacks that
+			 * are already overdue, e.g. target polling. */
+			if (target_timer_next_due_ms() == 0)
+				target_call_timer_callbacks();
 			poll_ok = true;
 		}
 
@@ -463,8 +683,8 @@ int server_loop(struct command_context *command_context)
 
 		for (service = services; service; service = service->next) {
 			/* handle new connections on listeners */
-			if ((service->fd != -1)
-			    && (FD_ISSET(service->fd, &read_fds))) {
+			if ((service->fd != -1) && service->readable) {
+				service->readable = false;
 				if (service->max_connections != 0)
 					add_connection(service, command_context);
 				else {
@@ -488,7 +708,8 @@ int server_loop(struct command_context *command_context)
 				struct connection *c;
 
 				for (c = service->connections; c; ) {
-					if ((FD_ISSET(c->fd, &read_fds)) || c->input_pending) {
+					if (c->readable || c->input_pending) {
+						c->readable = false;
 						retval = service->input(c);
 						if (retval != ERROR_OK) {
 							struct connection *next = c->next;
@@ -573,6 +794,10 @@ int server_init(struct command_context *cmd_ctx)
 	if (ERROR_OK != ret)
 		return ret;
 
+	ret = remote_adapter_server_init();
+	if (ERROR_OK != ret)
+		return ret;
+
 	return telnet_init("Open On-Chip Debugger");
 }
 
@@ -613,6 +838,65 @@ int connection_write(struct connection *connection, const void *data, int len)
 		return write(connection->fd_out, data, len);
 }
 
+int connection_flush(struct connection *connection)
+{
+	int done = 0;
+
+	while (done < connection->out_len && !connection->out_error) {
+		int ret = connection_write(connection, connection->out_buf + done,
+				connection->out_len - done);
+		if (ret > 0) {
+			done += ret;
+			continue;
+		}
+		if (ret < 0 && socket_would_block())
+			break;
+		connection->out_error = true;
+	}
+
+	if (connection->out_error) {
+		connection->out_len = 0;
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	/* keep what the client didn't take yet */
+	connection->out_len -= done;
+	memmove(connection->out_buf, connection->out_buf + done, connection->out_len);
+	if (connection->out_len)
+		connection->out_since = timeval_ms();
+	return ERROR_OK;
+}
+
+int connection_write_buffered(struct connection *connection, const void *data, int len)
+{
+	if (connection->out_error)
+		return ERROR_SERVER_REMOTE_CLOSED;
+	if (len == 0)
+		return ERROR_OK;
+
+	if (connection->out_len + len > connection->out_size) {
+		int size = connection->out_size ? connection->out_size : 1024;
+		while (size < connection->out_len + len)
+			size *= 2;
+		char *buf = realloc(connection->out_buf, size);
+		if (buf == NULL)
+			return ERROR_FAIL;
+		connection->out_buf = buf;
+		connection->out_size = size;
+	}
+
+	int64_t now = timeval_ms();
+	if (connection->out_len == 0)
+		connection->out_since = now;
+	memcpy(connection->out_buf + connection->out_len, data, len);
+	connection->out_len += len;
+
+	/* don't sit on output while a long command keeps the server loop busy */
+	if (now - connection->out_since >= CONNECTION_OUTPUT_LATENCY)
+		return connection_flush(connection);
+	return ERROR_OK;
+}
+
 int connection_read(struct connection *connection, void *data, int len)
 {
 	if (connection->service->type == CONNECTION_TCP)
@@ -706,6 +990,10 @@ int server_register_commands(struct command_context *cmd_ctx)
 	if (ERROR_OK != retval)
 		return retval;
 
+	retval = remote_adapter_server_register_commands(cmd_ctx);
+	if (ERROR_OK != retval)
+		return retval;
+
 	return register_commands(cmd_ctx, NULL, server_command_handlers);
 }
 
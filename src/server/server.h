@@ -46,10 +46,23 @@ struct connection {
 	struct command_context *cmd_ctx;
 	struct service *service;
 	int input_pending;
+	bool readable;	/* set by the event backend in server_loop() */
+	/* output queued by connection_write_buffered() */
+	char *out_buf;
+	int out_len;
+	int out_size;
+	int64_t out_since;	/* timeval_ms() of the oldest queued byte */
+	bool out_error;
 	void *priv;
 	struct connection *next;
 };
 
+/* Queued output goes out on the next server_loop() iteration, or at once
+ * when it is older than this.  Services drop asynchronous messages rather
+ * than queue more than CONNECTION_OUTPUT_MAX for a client not keeping up. */
+#define CONNECTION_OUTPUT_LATENCY	50	/* ms */
+#define CONNECTION_OUTPUT_MAX		(64 * 1024)
+
 typedef int (*new_connection_handler_t)(struct connection *connection);
 typedef int (*input_handler_t)(struct connection *connection);
 typedef int (*connection_closed_handler_t)(struct connection *connection);
@@ -66,6 +79,7 @@ struct service {
 	new_connection_handler_t new_connection;
 	input_handler_t input;
 	connection_closed_handler_t connection_closed;
+	bool readable;	/* set by the event backend in server_loop() */
 	void *priv;
 	struct service *next;
 };
@@ -86,6 +100,15 @@ int server_register_commands(struct command_context *context);
 
 int connection_write(struct connection *connection, const void *data, int len);
 int connection_read(struct connection *connection, void *data, int len);
+/**
+ * Queue output for the connection, so many small writes cost one system
+ * call.  On a non-blocking socket, whatever the client doesn't take stays
+ * queued.
+ * @returns ERROR_OK, or ERROR_SERVER_REMOTE_CLOSED once a write failed.
+ */
+int connection_write_buffered(struct connection *connection, const void *data, int len);
+/** Send queued output now, as far as the client takes it. */
+int connection_flush(struct connection *connection);
 
 /**
  * Used by server_loop(), defined in server_stubs.c
@@ -28,6 +28,14 @@
 #define TCL_LINE_INITIAL		(4*1024)
 #define TCL_LINE_MAX			(4*1024*1024)
 
+/* Binary framing, see "tcl_binary_framing". All fields little-endian.
+ * request:  u32 size of the rest, u32 id, u32 script length, script, data
+ * response: u32 size of the rest, u32 id, i32 Jim return code, result
+ * Notifications are sent as responses with id 0.
+ */
+#define TCL_FRAME_HEADER		12
+#define TCL_NOTIFICATION_ID		0
+
 struct tcl_connection {
 	int tc_linedrop;
 	int tc_lineoffset;
@@ -37,6 +45,8 @@ struct tcl_connection {
 	enum target_state tc_laststate;
 	bool tc_notify;
 	bool tc_trace;
+	bool tc_binary;
+	size_t tc_dropped;	/* notifications dropped for a slow client */
 };
 
 static char *tcl_port;
@@ -47,6 +57,65 @@ static int tcl_input(struct connection *connection);
 static int tcl_output(struct connection *connection, const void *buf, ssize_t len);
 static int tcl_closed(struct connection *connection);
 
+/* notifications and trace data are dropped rather than queued without
+ * bound for a client that doesn't read them */
+static bool tcl_output_full(struct connection *connection)
+{
+	struct tcl_connection *tclc = connection->priv;
+
+	if (connection->out_len >= CONNECTION_OUTPUT_MAX) {
+		tclc->tc_dropped++;
+		return true;
+	}
+	if (tclc->tc_dropped) {
+		LOG_WARNING("tcl: %zu notifications dropped, the client is not keeping up",
+				tclc->tc_dropped);
+		tclc->tc_dropped = 0;
+	}
+	return false;
+}
+
+static int tcl_output_frame(struct connection *connection, uint32_t id, int status,
+		const void *data, size_t len)
+{
+	uint8_t header[TCL_FRAME_HEADER];
+	int retval;
+
+	h_u32_to_le(header, len + TCL_FRAME_HEADER - 4);
+	h_u32_to_le(header + 4, id);
+	h_u32_to_le(header + 8, status);
+
+	/* small frames in one write, so they go out in one segment */
+	if (len <= 256) {
+		uint8_t buf[TCL_FRAME_HEADER + 256];
+
+		memcpy(buf, header, TCL_FRAME_HEADER);
+		memcpy(buf + TCL_FRAME_HEADER, data, len);
+		return tcl_output(connection, buf, TCL_FRAME_HEADER + len);
+	}
+
+	retval = tcl_output(connection, header, TCL_FRAME_HEADER);
+	if (retval != ERROR_OK)
+		return retval;
+	return tcl_output(connection, data, len);
+}
+
+/* sends a "type ..." notification in the framing of the connection */
+static int tcl_output_notification(struct connection *connection, const char *msg)
+{
+	struct tcl_connection *tclc = connection->priv;
+
+	if (tcl_output_full(connection))
+		return ERROR_OK;
+
+	if (tclc->tc_binary)
+		return tcl_output_frame(connection, TCL_NOTIFICATION_ID, JIM_OK, msg, strlen(msg));
+
+	char buf[256];
+	snprintf(buf, sizeof(buf), "%s\r\n\x1a", msg);
+	return tcl_output(connection, buf, strlen(buf));
+}
+
 static int tcl_target_callback_event_handler(struct target *target,
 		enum target_event event, void *priv)
 {
@@ -57,15 +126,15 @@ static int tcl_target_callback_event_handler(struct target *target,
 	tclc = connection->priv;
 
 	if (tclc->tc_notify) {
-		snprintf(buf, sizeof(buf), "type target_event event %s\r\n\x1a", target_event_name(event));
-		tcl_output(connection, buf, strlen(buf));
+		snprintf(buf, sizeof(buf), "type target_event event %s", target_event_name(event));
+		tcl_output_notification(connection, buf);
 	}
 
 	if (tclc->tc_laststate != target->state) {
 		tclc->tc_laststate = target->state;
 		if (tclc->tc_notify) {
-			snprintf(buf, sizeof(buf), "type target_state state %s\r\n\x1a", target_state_name(target));
-			tcl_output(connection, buf, strlen(buf));
+			snprintf(buf, sizeof(buf), "type target_state state %s", target_state_name(target));
+			tcl_output_notification(connection, buf);
 		}
 	}
 
@@ -82,8 +151,8 @@ static int tcl_target_callback_reset_handler(struct target *target,
 	tclc = connection->priv;
 
 	if (tclc->tc_notify) {
-		snprintf(buf, sizeof(buf), "type target_reset mode %s\r\n\x1a", target_reset_mode_name(reset_mode));
-		tcl_output(connection, buf, strlen(buf));
+		snprintf(buf, sizeof(buf), "type target_reset mode %s", target_reset_mode_name(reset_mode));
+		tcl_output_notification(connection, buf);
 	}
 
 	return ERROR_OK;
@@ -102,7 +171,20 @@ static int tcl_target_callback_trace_handler(struct target *target,
 
 	tclc = connection->priv;
 
-	if (tclc->tc_trace) {
+	if (tclc->tc_trace && tcl_output_full(connection))
+		return ERROR_OK;
+
+	if (tclc->tc_trace && tclc->tc_binary) {
+		/* the data as is, no need to hexify */
+		size_t header_len = strlen(header);
+		buf = malloc(header_len + len);
+		if (buf == NULL)
+			return ERROR_FAIL;
+		memcpy(buf, header, header_len);
+		memcpy(buf + header_len, data, len);
+		tcl_output_frame(connection, TCL_NOTIFICATION_ID, JIM_OK, buf, header_len + len);
+		free(buf);
+	} else if (tclc->tc_trace) {
 		hex = malloc(hex_len);
 		buf = malloc(max_len);
 		hexify(hex, (const char *)data, len, hex_len);
@@ -115,26 +197,24 @@ static int tcl_target_callback_trace_handler(struct target *target,
 	return ERROR_OK;
 }
 
-/* write data out to a socket.
+/* queue data for the socket, it goes out once per server loop iteration.
  *
- * this is a blocking write, so the return value must equal the length, if
- * that is not the case then flag the connection with an output error.
+ * if queueing fails, flag the connection with an output error.
  */
 int tcl_output(struct connection *connection, const void *data, ssize_t len)
 {
-	ssize_t wlen;
+	int retval;
 	struct tcl_connection *tclc;
 
 	tclc = connection->priv;
 	if (tclc->tc_outerror)
 		return ERROR_SERVER_REMOTE_CLOSED;
 
-	wlen = connection_write(connection, data, len);
-
-	if (wlen == len)
+	retval = connection_write_buffered(connection, data, len);
+	if (retval == ERROR_OK)
 		return ERROR_OK;
 
-	LOG_ERROR("error during write: %d != %d", (int)wlen, (int)len);
+	LOG_ERROR("error during write to tcl connection");
 	tclc->tc_outerror = 1;
 	return ERROR_SERVER_REMOTE_CLOSED;
 }
@@ -157,6 +237,10 @@ static int tcl_new_connection(struct connection *connection)
 
 	connection->priv = tclc;
 
+	/* output is queued, don't let a slow client block the server */
+	if (connection->service->type == CONNECTION_TCP)
+		socket_nonblock(connection->fd);
+
 	struct target *target = get_target_by_num(connection->cmd_ctx->current_target);
 	if (target != NULL)
 		tclc->tc_laststate = target->state;
@@ -171,7 +255,75 @@ static int tcl_new_connection(struct connection *connection)
 	return ERROR_OK;
 }
 
-static int tcl_input(struct connection *connection)
+static int tcl_run_frame(struct connection *connection, const uint8_t *frame, uint32_t size)
+{
+	Jim_Interp *interp = (Jim_Interp *)connection->cmd_ctx->interp;
+	uint32_t id = le_to_h_u32(frame + 4);
+	uint32_t script_len = le_to_h_u32(frame + 8);
+	const char *result;
+	int reslen, retcode;
+
+	if (script_len > size - (TCL_FRAME_HEADER - 4)) {
+		static const char msg[] = "script length exceeds the frame";
+		return tcl_output_frame(connection, id, JIM_ERR, msg, strlen(msg));
+	}
+
+	const char *script = (const char *)frame + TCL_FRAME_HEADER;
+	uint32_t data_len = size - (TCL_FRAME_HEADER - 4) - script_len;
+
+	/* binary arguments don't survive quoting, pass them by variable */
+	Jim_SetGlobalVariableStr(interp, "tcl_rpc_data",
+			Jim_NewStringObj(interp, script + script_len, data_len));
+
+	retcode = command_run_script_obj(connection->cmd_ctx,
+			Jim_NewStringObj(interp, script, script_len));
+
+	result = Jim_GetString(Jim_GetResult(interp), &reslen);
+	return tcl_output_frame(connection, id, retcode, result, reslen);
+}
+
+/* accumulates binary frames in tc_line and runs each one as it completes */
+static int tcl_input_binary(struct connection *connection, const uint8_t *in, size_t len)
+{
+	struct tcl_connection *tclc = connection->priv;
+	int retval;
+
+	if (tclc->tc_lineoffset + len > (size_t)tclc->tc_line_size) {
+		char *tc_line_new = realloc(tclc->tc_line, tclc->tc_lineoffset + len);
+		if (tc_line_new == NULL)
+			return ERROR_SERVER_REMOTE_CLOSED;
+		tclc->tc_line = tc_line_new;
+		tclc->tc_line_size = tclc->tc_lineoffset + len;
+	}
+	memcpy(tclc->tc_line + tclc->tc_lineoffset, in, len);
+	tclc->tc_lineoffset += len;
+
+	int done = 0;
+	while (tclc->tc_lineoffset - done >= TCL_FRAME_HEADER) {
+		const uint8_t *frame = (const uint8_t *)tclc->tc_line + done;
+		uint32_t size = le_to_h_u32(frame);
+
+		if (size < TCL_FRAME_HEADER - 4 || size > TCL_LINE_MAX) {
+			/* no way to find the next frame */
+			LOG_ERROR("tcl: invalid frame size %" PRIu32 ", closing connection", size);
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+		if (tclc->tc_lineoffset - done < 4 + (int)size)
+			break;
+
+		retval = tcl_run_frame(connection, frame, size);
+		if (retval != ERROR_OK)
+			return retval;
+		done += 4 + size;
+	}
+
+	memmove(tclc->tc_line, tclc->tc_line + done, tclc->tc_lineoffset - done);
+	tclc->tc_lineoffset -= done;
+
+	return ERROR_OK;
+}
+
+static int tcl_input_data(struct connection *connection)
 {
 	Jim_Interp *interp = (Jim_Interp *)connection->cmd_ctx->interp;
 	int retval;
@@ -180,11 +332,13 @@ static int tcl_input(struct connection *connection)
 	const char *result;
 	int reslen;
 	struct tcl_connection *tclc;
-	unsigned char in[256];
+	unsigned char in[4096];
 	char *tc_line_new;
 	int tc_line_size_new;
 
 	rlen = connection_read(connection, &in, sizeof(in));
+	if (rlen < 0 && socket_would_block())
+		return ERROR_OK;
 	if (rlen <= 0) {
 		if (rlen < 0)
 			LOG_ERROR("error during read: %s", strerror(errno));
@@ -195,6 +349,9 @@ static int tcl_input(struct connection *connection)
 	if (tclc == NULL)
 		return ERROR_CONNECTION_REJECTED;
 
+	if (tclc->tc_binary)
+		return tcl_input_binary(connection, in, rlen);
+
 	/* push as much data into the line as possible */
 	for (i = 0; i < rlen; i++) {
 		/* buffer the data */
@@ -252,16 +409,32 @@ static int tcl_input(struct connection *connection)
 
 		tclc->tc_lineoffset = 0;
 		tclc->tc_linedrop = 0;
+
+		/* the rest of the input is already in binary frames */
+		if (tclc->tc_binary)
+			return tcl_input_binary(connection, in + i + 1, rlen - i - 1);
 	}
 
 	return ERROR_OK;
 }
 
+static int tcl_input(struct connection *connection)
+{
+	int retval = tcl_input_data(connection);
+
+	/* results go out right away */
+	if (connection_flush(connection) != ERROR_OK)
+		return ERROR_SERVER_REMOTE_CLOSED;
+	return retval;
+}
+
 static int tcl_closed(struct connection *connection)
 {
 	struct tcl_connection *tclc;
 	tclc = connection->priv;
 
+	connection_flush(connection);
+
 	/* cleanup connection context */
 	if (tclc) {
 		free(tclc->tc_line);
@@ -327,6 +500,23 @@ COMMAND_HANDLER(handle_tcl_trace_command)
 	}
 }
 
+COMMAND_HANDLER(handle_tcl_binary_framing_command)
+{
+	struct connection *connection = CMD_CTX->output_handler_priv;
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (connection != NULL && !strcmp(connection->service->name, "tcl")) {
+		struct tcl_connection *tclc = connection->priv;
+		tclc->tc_binary = true;
+		return ERROR_OK;
+	} else {
+		LOG_ERROR("%s: can only be called from the tcl server", CMD_NAME);
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+}
+
 static const struct command_registration tcl_command_handlers[] = {
 	{
 		.name = "tcl_port",
@@ -351,6 +541,14 @@ static const struct command_registration tcl_command_handlers[] = {
 		.help = "Target trace output",
 		.usage = "[on|off]",
 	},
+	{
+		.name = "tcl_binary_framing",
+		.handler = handle_tcl_binary_framing_command,
+		.mode = COMMAND_EXEC,
+		.help = "Switch the current Tcl server connection to length "
+			"prefixed binary frames with request ids",
+		.usage = "",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -44,6 +44,9 @@ static char *negotiate =
 /* The only way we can detect that the socket is closed is the first time
  * we write to it, we will fail. Subsequent write operations will
  * succeed. Shudder!
+ *
+ * Output is queued and sent once per server loop iteration, so echoing
+ * a key or printing a log line above the prompt costs one system call.
  */
 static int telnet_write(struct connection *connection, const void *data,
 	int len)
@@ -52,7 +55,7 @@ static int telnet_write(struct connection *connection, const void *data,
 	if (t_con->closed)
 		return ERROR_SERVER_REMOTE_CLOSED;
 
-	if (connection_write(connection, data, len) == len)
+	if (connection_write_buffered(connection, data, len) == ERROR_OK)
 		return ERROR_OK;
 	t_con->closed = 1;
 	return ERROR_SERVER_REMOTE_CLOSED;
@@ -103,6 +106,27 @@ static void telnet_log_callback(void *priv, const char *file, unsigned line,
 	struct telnet_connection *t_con = connection->priv;
 	int i;
 
+	/* empty strings only keep GDB connections alive, for a long command
+	 * they are also a chance to send what was queued */
+	if (*string == 0) {
+		if (connection->out_len)
+			connection_flush(connection);
+		return;
+	}
+
+	/* drop log output a slow client doesn't take, and tell it so once
+	 * it catches up */
+	if (connection->out_len >= CONNECTION_OUTPUT_MAX) {
+		t_con->dropped += strlen(string);
+		return;
+	}
+	if (t_con->dropped) {
+		char msg[64];
+		snprintf(msg, sizeof(msg), "(%zu bytes of log output dropped)\n", t_con->dropped);
+		t_con->dropped = 0;
+		telnet_log_callback(priv, file, line, function, msg);
+	}
+
 	/* if there is no prompt, simply output the message */
 	if (t_con->line_cursor < 0) {
 		telnet_outputline(connection, string);
@@ -218,8 +242,13 @@ static int telnet_new_connection(struct connection *connection)
 
 	connection->priv = telnet_connection;
 
+	/* output is queued, don't let a slow client block the server */
+	if (connection->service->type == CONNECTION_TCP)
+		socket_nonblock(connection->fd);
+
 	/* initialize telnet connection information */
 	telnet_connection->closed = 0;
+	telnet_connection->dropped = 0;
 	telnet_connection->line_size = 0;
 	telnet_connection->line_cursor = 0;
 	telnet_connection->option_size = 0;
@@ -251,7 +280,7 @@ static int telnet_new_connection(struct connection *connection)
 
 	log_add_callback(telnet_log_callback, connection);
 
-	return ERROR_OK;
+	return connection_flush(connection);
 }
 
 static void telnet_clear_line(struct connection *connection,
@@ -317,6 +346,9 @@ static int telnet_input(struct connection *connection)
 	if (bytes_read == 0)
 		return ERROR_SERVER_REMOTE_CLOSED;
 	else if (bytes_read == -1) {
+		/* the socket is non-blocking */
+		if (socket_would_block())
+			return ERROR_OK;
 		LOG_ERROR("error during read: %s", strerror(errno));
 		return ERROR_SERVER_REMOTE_CLOSED;
 	}
@@ -580,7 +612,8 @@ static int telnet_input(struct connection *connection)
 		buf_p++;
 	}
 
-	return ERROR_OK;
+	/* echo and command output go out right away */
+	return connection_flush(connection);
 }
 
 static int telnet_connection_closed(struct connection *connection)
@@ -589,6 +622,7 @@ static int telnet_connection_closed(struct connection *connection)
 	int i;
 
 	log_remove_callback(telnet_log_callback, connection);
+	connection_flush(connection);
 
 	if (t_con->prompt) {
 		free(t_con->prompt);
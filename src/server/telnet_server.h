@@ -58,6 +58,7 @@ struct telnet_connection {
 	int next_history;
 	int current_history;
 	int closed;
+	size_t dropped;		/* log output dropped, see telnet_log_callback() */
 };
 
 struct telnet_service {
@@ -32,6 +32,7 @@
 #include <jtag/jtag.h>
 #include "svf.h"
 #include <helper/time_support.h>
+#include <helper/fileio.h>
 
 /* SVF command */
 enum svf_command {
@@ -206,15 +207,24 @@ struct svf_check_tdo_para {
 	int bit_len;		/* bit length to check */
 };
 
+/* initial number of check records, the array grows as needed */
 #define SVF_CHECK_TDO_PARA_SIZE 1024
 static struct svf_check_tdo_para *svf_check_tdo_para;
 static int svf_check_tdo_para_index;
+static int svf_check_tdo_para_size;
 
 static int svf_read_command_from_file(FILE *fd);
 static int svf_check_tdo(void);
 static int svf_add_check_para(uint8_t enabled, int buffer_offset, int bit_len);
 static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str);
 static int svf_execute_tap(void);
+static int svf_compile(struct command_context *cmd_ctx, const char *svf_name,
+		const char *bin_name);
+static int svf_run_compiled(struct command_context *cmd_ctx, const char *name,
+		int *command_num);
+
+/* first bytes of a file written by "svf compile" */
+static const char svf_bin_magic[8] = "OCDSVF1";
 
 static FILE *svf_fd;
 static char *svf_read_line;
@@ -225,6 +235,9 @@ static int svf_line_number;
 static int svf_getline(char **lineptr, size_t *n, FILE *stream);
 
 #define SVF_MAX_BUFFER_SIZE_TO_COMMIT   (1024 * 1024)
+/* memory the scan buffers and check records of the queued but not yet
+ * executed commands may use before the queue is flushed */
+#define SVF_COMMIT_BUDGET				(16 * 1024 * 1024)
 static uint8_t *svf_tdi_buffer, *svf_tdo_buffer, *svf_mask_buffer;
 static int svf_buffer_index, svf_buffer_size ;
 static int svf_quiet;
@@ -369,10 +382,19 @@ COMMAND_HANDLER(handle_svf_command)
 	 * that should be affected
 	*/
 	struct jtag_tap *tap = NULL;
+	/* name of the file when it was written by "svf compile" */
+	const char *compiled = NULL;
+	char magic[sizeof(svf_bin_magic)];
 
 	if ((CMD_ARGC < SVF_MIN_NUM_OF_OPTIONS) || (CMD_ARGC > SVF_MAX_NUM_OF_OPTIONS))
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
+	if (strcmp(CMD_ARGV[0], "compile") == 0) {
+		if (CMD_ARGC != 3)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		return svf_compile(CMD_CTX, CMD_ARGV[1], CMD_ARGV[2]);
+	}
+
 	/* parse command line */
 	svf_quiet = 0;
 	svf_nil = 0;
@@ -406,6 +428,12 @@ COMMAND_HANDLER(handle_svf_command)
 				return ERROR_COMMAND_SYNTAX_ERROR;
 			} else
 				LOG_USER("svf processing file: \"%s\"", CMD_ARGV[i]);
+
+			if (fread(magic, 1, sizeof(magic), svf_fd) == sizeof(magic)
+					&& memcmp(magic, svf_bin_magic, sizeof(magic)) == 0)
+				compiled = CMD_ARGV[i];
+			else
+				rewind(svf_fd);
 		}
 	}
 
@@ -420,6 +448,7 @@ COMMAND_HANDLER(handle_svf_command)
 	svf_command_buffer_size = 0;
 
 	svf_check_tdo_para_index = 0;
+	svf_check_tdo_para_size = SVF_CHECK_TDO_PARA_SIZE;
 	svf_check_tdo_para = malloc(sizeof(struct svf_check_tdo_para) * SVF_CHECK_TDO_PARA_SIZE);
 	if (NULL == svf_check_tdo_para) {
 		LOG_ERROR("not enough memory");
@@ -488,7 +517,9 @@ COMMAND_HANDLER(handle_svf_command)
 		}
 	}
 
-	if (svf_progress_enabled) {
+	if (compiled)
+		ret = svf_run_compiled(CMD_CTX, compiled, &command_num);
+	else if (svf_progress_enabled) {
 		/* Count total lines in file. */
 		while (!feof(svf_fd)) {
 			svf_getline(&svf_command_buffer, &svf_command_buffer_size, svf_fd);
@@ -496,7 +527,7 @@ COMMAND_HANDLER(handle_svf_command)
 		}
 		rewind(svf_fd);
 	}
-	while (ERROR_OK == svf_read_command_from_file(svf_fd)) {
+	while (!compiled && ERROR_OK == svf_read_command_from_file(svf_fd)) {
 		/* Log Output */
 		if (svf_quiet) {
 			if (svf_progress_enabled) {
@@ -555,6 +586,7 @@ free_all:
 		free(svf_check_tdo_para);
 		svf_check_tdo_para = NULL;
 		svf_check_tdo_para_index = 0;
+		svf_check_tdo_para_size = 0;
 	}
 	if (svf_tdi_buffer) {
 		free(svf_tdi_buffer);
@@ -593,7 +625,7 @@ free_all:
 
 static int svf_getline(char **lineptr, size_t *n, FILE *stream)
 {
-#define MIN_CHUNK 16	/* Buffer is increased by this size each time as required */
+#define MIN_CHUNK 16	/* Initial buffer size, doubled each time as required */
 	size_t i = 0;
 
 	if (*lineptr == NULL) {
@@ -603,16 +635,19 @@ static int svf_getline(char **lineptr, size_t *n, FILE *stream)
 			return -1;
 	}
 
-	(*lineptr)[0] = fgetc(stream);
+	(*lineptr)[0] = getc(stream);
 	while ((*lineptr)[i] != '\n') {
-		(*lineptr)[++i] = fgetc(stream);
+		(*lineptr)[++i] = getc(stream);
 		if (feof(stream)) {
 			(*lineptr)[0] = 0;
 			return -1;
 		}
 		if ((i + 2) > *n) {
-			*n += MIN_CHUNK;
-			*lineptr = realloc(*lineptr, *n);
+			char *line = realloc(*lineptr, *n * 2);
+			if (!line)
+				return -1;
+			*lineptr = line;
+			*n *= 2;
 		}
 	}
 
@@ -680,8 +715,12 @@ static int svf_read_command_from_file(FILE *fd)
 				 *  - terminating NUL ('\0')
 				 */
 				if (cmd_pos + 3 > svf_command_buffer_size) {
-					svf_command_buffer = realloc(svf_command_buffer, cmd_pos + 3);
-					svf_command_buffer_size = cmd_pos + 3;
+					/* grow geometrically, multi-megabyte commands
+					 * are common in FPGA bitstreams */
+					size_t new_size = MAX(cmd_pos + 3,
+							2 * svf_command_buffer_size);
+					svf_command_buffer = realloc(svf_command_buffer, new_size);
+					svf_command_buffer_size = new_size;
 					if (svf_command_buffer == NULL) {
 						LOG_ERROR("not enough memory");
 						return ERROR_FAIL;
@@ -885,9 +924,16 @@ static int svf_check_tdo(void)
 
 static int svf_add_check_para(uint8_t enabled, int buffer_offset, int bit_len)
 {
-	if (svf_check_tdo_para_index >= SVF_CHECK_TDO_PARA_SIZE) {
-		LOG_ERROR("toooooo many operation undone");
-		return ERROR_FAIL;
+	if (svf_check_tdo_para_index >= svf_check_tdo_para_size) {
+		int new_size = 2 * svf_check_tdo_para_size;
+		struct svf_check_tdo_para *new_para = realloc(svf_check_tdo_para,
+				sizeof(struct svf_check_tdo_para) * new_size);
+		if (new_para == NULL) {
+			LOG_ERROR("not enough memory");
+			return ERROR_FAIL;
+		}
+		svf_check_tdo_para = new_para;
+		svf_check_tdo_para_size = new_size;
 	}
 
 	svf_check_tdo_para[svf_check_tdo_para_index].line_num = svf_line_number;
@@ -911,6 +957,348 @@ static int svf_execute_tap(void)
 	return ERROR_OK;
 }
 
+/* XXR length [TDI (tdi)] [TDO (tdo)][MASK (mask)] [SMASK (smask)]
+ * decodes the parameters of a HDR/HIR/TDR/TIR/SDR/SIR command into @a xxr_para_tmp,
+ * @a orig_len returns the length of the previous scan of the same type
+ */
+static int svf_parse_xxr(char **argus, int num_of_argu,
+		struct svf_xxr_para *xxr_para_tmp, int *orig_len)
+{
+	uint8_t **pbuffer_tmp;
+	int i, i_tmp;
+
+	if ((num_of_argu > 10) || (num_of_argu % 2)) {
+		LOG_ERROR("invalid parameter of %s", argus[0]);
+		return ERROR_FAIL;
+	}
+	i_tmp = xxr_para_tmp->len;
+	xxr_para_tmp->len = atoi(argus[1]);
+	/* If we are to enlarge the buffers, all parts of xxr_para_tmp
+	 * need to be freed */
+	if (i_tmp < xxr_para_tmp->len) {
+		free(xxr_para_tmp->tdi);
+		xxr_para_tmp->tdi = NULL;
+		free(xxr_para_tmp->tdo);
+		xxr_para_tmp->tdo = NULL;
+		free(xxr_para_tmp->mask);
+		xxr_para_tmp->mask = NULL;
+		free(xxr_para_tmp->smask);
+		xxr_para_tmp->smask = NULL;
+	}
+
+	LOG_DEBUG("\tlength = %d", xxr_para_tmp->len);
+	xxr_para_tmp->data_mask = 0;
+	for (i = 2; i < num_of_argu; i += 2) {
+		if ((strlen(argus[i + 1]) < 3) || (argus[i + 1][0] != '(') ||
+		(argus[i + 1][strlen(argus[i + 1]) - 1] != ')')) {
+			LOG_ERROR("data section error");
+			return ERROR_FAIL;
+		}
+		argus[i + 1][strlen(argus[i + 1]) - 1] = '\0';
+		/* TDI, TDO, MASK, SMASK */
+		if (!strcmp(argus[i], "TDI")) {
+			/* TDI */
+			pbuffer_tmp = &xxr_para_tmp->tdi;
+			xxr_para_tmp->data_mask |= XXR_TDI;
+		} else if (!strcmp(argus[i], "TDO")) {
+			/* TDO */
+			pbuffer_tmp = &xxr_para_tmp->tdo;
+			xxr_para_tmp->data_mask |= XXR_TDO;
+		} else if (!strcmp(argus[i], "MASK")) {
+			/* MASK */
+			pbuffer_tmp = &xxr_para_tmp->mask;
+			xxr_para_tmp->data_mask |= XXR_MASK;
+		} else if (!strcmp(argus[i], "SMASK")) {
+			/* SMASK */
+			pbuffer_tmp = &xxr_para_tmp->smask;
+			xxr_para_tmp->data_mask |= XXR_SMASK;
+		} else {
+			LOG_ERROR("unknow parameter: %s", argus[i]);
+			return ERROR_FAIL;
+		}
+		if (ERROR_OK !=
+		svf_copy_hexstring_to_binary(&argus[i + 1][1], pbuffer_tmp, i_tmp,
+			xxr_para_tmp->len)) {
+			LOG_ERROR("fail to parse hex value");
+			return ERROR_FAIL;
+		}
+		SVF_BUF_LOG(DEBUG, *pbuffer_tmp, xxr_para_tmp->len, argus[i]);
+	}
+
+	*orig_len = i_tmp;
+	return ERROR_OK;
+}
+
+/* queues the scan of an already decoded XXR command */
+static int svf_xxr_scan(int command, struct svf_xxr_para *xxr_para_tmp, int i_tmp)
+{
+	struct scan_field field;
+	int i;
+
+	/* If a command changes the length of the last scan of the same type and the
+	 * MASK parameter is absent, */
+	/* the mask pattern used is all cares */
+	if (!(xxr_para_tmp->data_mask & XXR_MASK) && (i_tmp != xxr_para_tmp->len)) {
+		/* MASK not defined and length changed */
+		if (ERROR_OK !=
+		svf_adjust_array_length(&xxr_para_tmp->mask, i_tmp,
+			xxr_para_tmp->len)) {
+			LOG_ERROR("fail to adjust length of array");
+			return ERROR_FAIL;
+		}
+		buf_set_ones(xxr_para_tmp->mask, xxr_para_tmp->len);
+	}
+	/* If TDO is absent, no comparison is needed, set the mask to 0 */
+	if (!(xxr_para_tmp->data_mask & XXR_TDO)) {
+		if (NULL == xxr_para_tmp->tdo) {
+			if (ERROR_OK !=
+			svf_adjust_array_length(&xxr_para_tmp->tdo, i_tmp,
+				xxr_para_tmp->len)) {
+				LOG_ERROR("fail to adjust length of array");
+				return ERROR_FAIL;
+			}
+		}
+		if (NULL == xxr_para_tmp->mask) {
+			if (ERROR_OK !=
+			svf_adjust_array_length(&xxr_para_tmp->mask, i_tmp,
+				xxr_para_tmp->len)) {
+				LOG_ERROR("fail to adjust length of array");
+				return ERROR_FAIL;
+			}
+		}
+		memset(xxr_para_tmp->mask, 0, (xxr_para_tmp->len + 7) >> 3);
+	}
+	/* do scan if necessary */
+	if (SDR == command) {
+		/* check buffer size first, reallocate if necessary */
+		i = svf_para.hdr_para.len + svf_para.sdr_para.len +
+				svf_para.tdr_para.len;
+		if ((svf_buffer_size - svf_buffer_index) < ((i + 7) >> 3)) {
+			/* reallocate buffer */
+			if (svf_realloc_buffers(svf_buffer_index + ((i + 7) >> 3)) != ERROR_OK) {
+				LOG_ERROR("not enough memory");
+				return ERROR_FAIL;
+			}
+		}
+
+		/* assemble dr data */
+		i = 0;
+		buf_set_buf(svf_para.hdr_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.hdr_para.len);
+		i += svf_para.hdr_para.len;
+		buf_set_buf(svf_para.sdr_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.sdr_para.len);
+		i += svf_para.sdr_para.len;
+		buf_set_buf(svf_para.tdr_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.tdr_para.len);
+		i += svf_para.tdr_para.len;
+
+		/* add check data */
+		if (svf_para.sdr_para.data_mask & XXR_TDO) {
+			/* assemble dr mask data */
+			i = 0;
+			buf_set_buf(svf_para.hdr_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.hdr_para.len);
+			i += svf_para.hdr_para.len;
+			buf_set_buf(svf_para.sdr_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.sdr_para.len);
+			i += svf_para.sdr_para.len;
+			buf_set_buf(svf_para.tdr_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.tdr_para.len);
+
+			/* assemble dr check data */
+			i = 0;
+			buf_set_buf(svf_para.hdr_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.hdr_para.len);
+			i += svf_para.hdr_para.len;
+			buf_set_buf(svf_para.sdr_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.sdr_para.len);
+			i += svf_para.sdr_para.len;
+			buf_set_buf(svf_para.tdr_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.tdr_para.len);
+			i += svf_para.tdr_para.len;
+
+			if (ERROR_OK != svf_add_check_para(1, svf_buffer_index, i))
+				return ERROR_FAIL;
+		} else if (ERROR_OK != svf_add_check_para(0, svf_buffer_index, i))
+			return ERROR_FAIL;
+		field.num_bits = i;
+		field.out_value = &svf_tdi_buffer[svf_buffer_index];
+		field.in_value = (xxr_para_tmp->data_mask & XXR_TDO) ? &svf_tdi_buffer[svf_buffer_index] : NULL;
+		if (!svf_nil) {
+			/* NOTE:  doesn't use SVF-specified state paths */
+			jtag_add_plain_dr_scan(field.num_bits,
+					field.out_value,
+					field.in_value,
+					svf_para.dr_end_state);
+		}
+
+		svf_buffer_index += (i + 7) >> 3;
+	} else if (SIR == command) {
+		/* check buffer size first, reallocate if necessary */
+		i = svf_para.hir_para.len + svf_para.sir_para.len +
+				svf_para.tir_para.len;
+		if ((svf_buffer_size - svf_buffer_index) < ((i + 7) >> 3)) {
+			if (svf_realloc_buffers(svf_buffer_index + ((i + 7) >> 3)) != ERROR_OK) {
+				LOG_ERROR("not enough memory");
+				return ERROR_FAIL;
+			}
+		}
+
+		/* assemble ir data */
+		i = 0;
+		buf_set_buf(svf_para.hir_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.hir_para.len);
+		i += svf_para.hir_para.len;
+		buf_set_buf(svf_para.sir_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.sir_para.len);
+		i += svf_para.sir_para.len;
+		buf_set_buf(svf_para.tir_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.tir_para.len);
+		i += svf_para.tir_para.len;
+
+		/* add check data */
+		if (svf_para.sir_para.data_mask & XXR_TDO) {
+			/* assemble dr mask data */
+			i = 0;
+			buf_set_buf(svf_para.hir_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.hir_para.len);
+			i += svf_para.hir_para.len;
+			buf_set_buf(svf_para.sir_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.sir_para.len);
+			i += svf_para.sir_para.len;
+			buf_set_buf(svf_para.tir_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.tir_para.len);
+
+			/* assemble dr check data */
+			i = 0;
+			buf_set_buf(svf_para.hir_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.hir_para.len);
+			i += svf_para.hir_para.len;
+			buf_set_buf(svf_para.sir_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.sir_para.len);
+			i += svf_para.sir_para.len;
+			buf_set_buf(svf_para.tir_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.tir_para.len);
+			i += svf_para.tir_para.len;
+
+			if (ERROR_OK != svf_add_check_para(1, svf_buffer_index, i))
+				return ERROR_FAIL;
+		} else if (ERROR_OK != svf_add_check_para(0, svf_buffer_index, i))
+			return ERROR_FAIL;
+		field.num_bits = i;
+		field.out_value = &svf_tdi_buffer[svf_buffer_index];
+		field.in_value = (xxr_para_tmp->data_mask & XXR_TDO) ? &svf_tdi_buffer[svf_buffer_index] : NULL;
+		if (!svf_nil) {
+			/* NOTE:  doesn't use SVF-specified state paths */
+			jtag_add_plain_ir_scan(field.num_bits,
+					field.out_value,
+					field.in_value,
+					svf_para.ir_end_state);
+		}
+
+		svf_buffer_index += (i + 7) >> 3;
+	}
+
+	return ERROR_OK;
+}
+
+/* memory held by the commands queued since the last flush: the tdi, tdo
+ * and mask bytes of their scans plus the records checking them */
+static size_t svf_pending_size(void)
+{
+	return 3 * (size_t)svf_buffer_index +
+		svf_check_tdo_para_index * sizeof(struct svf_check_tdo_para);
+}
+
+/* common tail of every command, commits the queue when needed */
+static int svf_command_done(int command, int num_of_argu, int padding_command_skipped)
+{
+	if (!svf_quiet) {
+		if (padding_command_skipped)
+			LOG_USER("(Above Padding command skipped, as per -tap argument)");
+	}
+
+	if (debug_level >= LOG_LVL_DEBUG) {
+		/* for convenient debugging, execute tap if possible */
+		if ((svf_buffer_index > 0) && \
+				(((command != STATE) && (command != RUNTEST)) || \
+						((command == STATE) && (num_of_argu == 2)))) {
+			if (ERROR_OK != svf_execute_tap())
+				return ERROR_FAIL;
+
+			/* output debug info */
+			if ((SIR == command) || (SDR == command)) {
+				SVF_BUF_LOG(DEBUG, svf_tdi_buffer, svf_check_tdo_para[0].bit_len, "TDO read");
+			}
+		}
+	} else {
+		/* for fast executing, execute tap if necessary */
+		/* buffers and check records grow as needed, flush once the
+		 * queued commands hold SVF_COMMIT_BUDGET bytes */
+		if ((svf_pending_size() >= SVF_COMMIT_BUDGET) && \
+				(((command != STATE) && (command != RUNTEST)) || \
+						((command == STATE) && (num_of_argu == 2))))
+			return svf_execute_tap();
+	}
+
+	return ERROR_OK;
+}
+
 static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 {
 	char *argus[256], command;
@@ -924,8 +1312,6 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 	float min_time;
 	/* for XXR */
 	struct svf_xxr_para *xxr_para_tmp;
-	uint8_t **pbuffer_tmp;
-	struct scan_field field;
 	/* for STATE */
 	tap_state_t *path = NULL, state;
 	/* flag padding commands skipped due to -tap command */
@@ -1026,280 +1412,10 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 			xxr_para_tmp = &svf_para.sir_para;
 			goto XXR_common;
 XXR_common:
-			/* XXR length [TDI (tdi)] [TDO (tdo)][MASK (mask)] [SMASK (smask)] */
-			if ((num_of_argu > 10) || (num_of_argu % 2)) {
-				LOG_ERROR("invalid parameter of %s", argus[0]);
+			if (ERROR_OK != svf_parse_xxr(argus, num_of_argu, xxr_para_tmp, &i_tmp))
+				return ERROR_FAIL;
+			if (ERROR_OK != svf_xxr_scan(command, xxr_para_tmp, i_tmp))
 				return ERROR_FAIL;
-			}
-			i_tmp = xxr_para_tmp->len;
-			xxr_para_tmp->len = atoi(argus[1]);
-			/* If we are to enlarge the buffers, all parts of xxr_para_tmp
-			 * need to be freed */
-			if (i_tmp < xxr_para_tmp->len) {
-				free(xxr_para_tmp->tdi);
-				xxr_para_tmp->tdi = NULL;
-				free(xxr_para_tmp->tdo);
-				xxr_para_tmp->tdo = NULL;
-				free(xxr_para_tmp->mask);
-				xxr_para_tmp->mask = NULL;
-				free(xxr_para_tmp->smask);
-				xxr_para_tmp->smask = NULL;
-			}
-
-			LOG_DEBUG("\tlength = %d", xxr_para_tmp->len);
-			xxr_para_tmp->data_mask = 0;
-			for (i = 2; i < num_of_argu; i += 2) {
-				if ((strlen(argus[i + 1]) < 3) || (argus[i + 1][0] != '(') ||
-				(argus[i + 1][strlen(argus[i + 1]) - 1] != ')')) {
-					LOG_ERROR("data section error");
-					return ERROR_FAIL;
-				}
-				argus[i + 1][strlen(argus[i + 1]) - 1] = '\0';
-				/* TDI, TDO, MASK, SMASK */
-				if (!strcmp(argus[i], "TDI")) {
-					/* TDI */
-					pbuffer_tmp = &xxr_para_tmp->tdi;
-					xxr_para_tmp->data_mask |= XXR_TDI;
-				} else if (!strcmp(argus[i], "TDO")) {
-					/* TDO */
-					pbuffer_tmp = &xxr_para_tmp->tdo;
-					xxr_para_tmp->data_mask |= XXR_TDO;
-				} else if (!strcmp(argus[i], "MASK")) {
-					/* MASK */
-					pbuffer_tmp = &xxr_para_tmp->mask;
-					xxr_para_tmp->data_mask |= XXR_MASK;
-				} else if (!strcmp(argus[i], "SMASK")) {
-					/* SMASK */
-					pbuffer_tmp = &xxr_para_tmp->smask;
-					xxr_para_tmp->data_mask |= XXR_SMASK;
-				} else {
-					LOG_ERROR("unknow parameter: %s", argus[i]);
-					return ERROR_FAIL;
-				}
-				if (ERROR_OK !=
-				svf_copy_hexstring_to_binary(&argus[i + 1][1], pbuffer_tmp, i_tmp,
-					xxr_para_tmp->len)) {
-					LOG_ERROR("fail to parse hex value");
-					return ERROR_FAIL;
-				}
-				SVF_BUF_LOG(DEBUG, *pbuffer_tmp, xxr_para_tmp->len, argus[i]);
-			}
-			/* If a command changes the length of the last scan of the same type and the
-			 * MASK parameter is absent, */
-			/* the mask pattern used is all cares */
-			if (!(xxr_para_tmp->data_mask & XXR_MASK) && (i_tmp != xxr_para_tmp->len)) {
-				/* MASK not defined and length changed */
-				if (ERROR_OK !=
-				svf_adjust_array_length(&xxr_para_tmp->mask, i_tmp,
-					xxr_para_tmp->len)) {
-					LOG_ERROR("fail to adjust length of array");
-					return ERROR_FAIL;
-				}
-				buf_set_ones(xxr_para_tmp->mask, xxr_para_tmp->len);
-			}
-			/* If TDO is absent, no comparison is needed, set the mask to 0 */
-			if (!(xxr_para_tmp->data_mask & XXR_TDO)) {
-				if (NULL == xxr_para_tmp->tdo) {
-					if (ERROR_OK !=
-					svf_adjust_array_length(&xxr_para_tmp->tdo, i_tmp,
-						xxr_para_tmp->len)) {
-						LOG_ERROR("fail to adjust length of array");
-						return ERROR_FAIL;
-					}
-				}
-				if (NULL == xxr_para_tmp->mask) {
-					if (ERROR_OK !=
-					svf_adjust_array_length(&xxr_para_tmp->mask, i_tmp,
-						xxr_para_tmp->len)) {
-						LOG_ERROR("fail to adjust length of array");
-						return ERROR_FAIL;
-					}
-				}
-				memset(xxr_para_tmp->mask, 0, (xxr_para_tmp->len + 7) >> 3);
-			}
-			/* do scan if necessary */
-			if (SDR == command) {
-				/* check buffer size first, reallocate if necessary */
-				i = svf_para.hdr_para.len + svf_para.sdr_para.len +
-						svf_para.tdr_para.len;
-				if ((svf_buffer_size - svf_buffer_index) < ((i + 7) >> 3)) {
-					/* reallocate buffer */
-					if (svf_realloc_buffers(svf_buffer_index + ((i + 7) >> 3)) != ERROR_OK) {
-						LOG_ERROR("not enough memory");
-						return ERROR_FAIL;
-					}
-				}
-
-				/* assemble dr data */
-				i = 0;
-				buf_set_buf(svf_para.hdr_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.hdr_para.len);
-				i += svf_para.hdr_para.len;
-				buf_set_buf(svf_para.sdr_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.sdr_para.len);
-				i += svf_para.sdr_para.len;
-				buf_set_buf(svf_para.tdr_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.tdr_para.len);
-				i += svf_para.tdr_para.len;
-
-				/* add check data */
-				if (svf_para.sdr_para.data_mask & XXR_TDO) {
-					/* assemble dr mask data */
-					i = 0;
-					buf_set_buf(svf_para.hdr_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.hdr_para.len);
-					i += svf_para.hdr_para.len;
-					buf_set_buf(svf_para.sdr_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.sdr_para.len);
-					i += svf_para.sdr_para.len;
-					buf_set_buf(svf_para.tdr_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.tdr_para.len);
-
-					/* assemble dr check data */
-					i = 0;
-					buf_set_buf(svf_para.hdr_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.hdr_para.len);
-					i += svf_para.hdr_para.len;
-					buf_set_buf(svf_para.sdr_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.sdr_para.len);
-					i += svf_para.sdr_para.len;
-					buf_set_buf(svf_para.tdr_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.tdr_para.len);
-					i += svf_para.tdr_para.len;
-
-					svf_add_check_para(1, svf_buffer_index, i);
-				} else
-					svf_add_check_para(0, svf_buffer_index, i);
-				field.num_bits = i;
-				field.out_value = &svf_tdi_buffer[svf_buffer_index];
-				field.in_value = (xxr_para_tmp->data_mask & XXR_TDO) ? &svf_tdi_buffer[svf_buffer_index] : NULL;
-				if (!svf_nil) {
-					/* NOTE:  doesn't use SVF-specified state paths */
-					jtag_add_plain_dr_scan(field.num_bits,
-							field.out_value,
-							field.in_value,
-							svf_para.dr_end_state);
-				}
-
-				svf_buffer_index += (i + 7) >> 3;
-			} else if (SIR == command) {
-				/* check buffer size first, reallocate if necessary */
-				i = svf_para.hir_para.len + svf_para.sir_para.len +
-						svf_para.tir_para.len;
-				if ((svf_buffer_size - svf_buffer_index) < ((i + 7) >> 3)) {
-					if (svf_realloc_buffers(svf_buffer_index + ((i + 7) >> 3)) != ERROR_OK) {
-						LOG_ERROR("not enough memory");
-						return ERROR_FAIL;
-					}
-				}
-
-				/* assemble ir data */
-				i = 0;
-				buf_set_buf(svf_para.hir_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.hir_para.len);
-				i += svf_para.hir_para.len;
-				buf_set_buf(svf_para.sir_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.sir_para.len);
-				i += svf_para.sir_para.len;
-				buf_set_buf(svf_para.tir_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.tir_para.len);
-				i += svf_para.tir_para.len;
-
-				/* add check data */
-				if (svf_para.sir_para.data_mask & XXR_TDO) {
-					/* assemble dr mask data */
-					i = 0;
-					buf_set_buf(svf_para.hir_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.hir_para.len);
-					i += svf_para.hir_para.len;
-					buf_set_buf(svf_para.sir_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.sir_para.len);
-					i += svf_para.sir_para.len;
-					buf_set_buf(svf_para.tir_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.tir_para.len);
-
-					/* assemble dr check data */
-					i = 0;
-					buf_set_buf(svf_para.hir_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.hir_para.len);
-					i += svf_para.hir_para.len;
-					buf_set_buf(svf_para.sir_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.sir_para.len);
-					i += svf_para.sir_para.len;
-					buf_set_buf(svf_para.tir_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.tir_para.len);
-					i += svf_para.tir_para.len;
-
-					svf_add_check_para(1, svf_buffer_index, i);
-				} else
-					svf_add_check_para(0, svf_buffer_index, i);
-				field.num_bits = i;
-				field.out_value = &svf_tdi_buffer[svf_buffer_index];
-				field.in_value = (xxr_para_tmp->data_mask & XXR_TDO) ? &svf_tdi_buffer[svf_buffer_index] : NULL;
-				if (!svf_nil) {
-					/* NOTE:  doesn't use SVF-specified state paths */
-					jtag_add_plain_ir_scan(field.num_bits,
-							field.out_value,
-							field.in_value,
-							svf_para.ir_end_state);
-				}
-
-				svf_buffer_index += (i + 7) >> 3;
-			}
 			break;
 		case PIO:
 		case PIOMAP:
@@ -1530,44 +1646,360 @@ XXR_common:
 			break;
 	}
 
-	if (!svf_quiet) {
-		if (padding_command_skipped)
-			LOG_USER("(Above Padding command skipped, as per -tap argument)");
+	return svf_command_done(command, num_of_argu, padding_command_skipped);
+}
+
+/*
+ * Compiled SVF files.
+ *
+ * "svf compile" normalizes an SVF file once and stores the HDR/HIR/TDR/TIR/
+ * SDR/SIR vectors already decoded to binary, so replaying it neither strips
+ * comments nor parses hex strings.  The other commands are few and short,
+ * they are kept as normalized text and go through svf_run_command().
+ *
+ * The file starts with svf_bin_magic, followed by records made of a
+ * SVF_BIN_HEADER_SIZE byte header:
+ *   u8 type, u8 command, u8 data_mask, u8 reserved, le32 line, le32 length
+ * SVF_BIN_TEXT records are followed by length bytes of command text,
+ * SVF_BIN_XXR records by one (length + 7) / 8 byte vector for each of
+ * TDI, TDO, MASK, SMASK present in data_mask, in that order.
+ */
+#define SVF_BIN_HEADER_SIZE	12
+#define SVF_BIN_TEXT		0
+#define SVF_BIN_XXR			1
+
+struct svf_bin {
+	struct fileio *fileio;
+	const uint8_t *map;
+	size_t size;
+	size_t pos;
+};
+
+static int svf_bin_write_record(struct fileio *fileio, int type, int command,
+		int data_mask, uint32_t length)
+{
+	uint8_t header[SVF_BIN_HEADER_SIZE];
+	size_t written;
+
+	header[0] = type;
+	header[1] = command;
+	header[2] = data_mask;
+	header[3] = 0;
+	h_u32_to_le(header + 4, svf_line_number);
+	h_u32_to_le(header + 8, length);
+
+	return fileio_write(fileio, sizeof(header), header, &written);
+}
+
+static int svf_compile(struct command_context *cmd_ctx, const char *svf_name,
+		const char *bin_name)
+{
+	struct svf_xxr_para xxr_para_tmp;
+	struct fileio *fileio;
+	char *argus[256];
+	int num_of_argu, command, orig_len, command_num = 0;
+	size_t len, name_len, written;
+	char saved;
+	int retval;
+
+	svf_fd = fopen(svf_name, "r");
+	if (svf_fd == NULL) {
+		int err = errno;
+		command_print(cmd_ctx, "open(\"%s\"): %s", svf_name, strerror(err));
+		return ERROR_FAIL;
 	}
 
-	if (debug_level >= LOG_LVL_DEBUG) {
-		/* for convenient debugging, execute tap if possible */
-		if ((svf_buffer_index > 0) && \
-				(((command != STATE) && (command != RUNTEST)) || \
-						((command == STATE) && (num_of_argu == 2)))) {
-			if (ERROR_OK != svf_execute_tap())
-				return ERROR_FAIL;
+	retval = fileio_open(&fileio, bin_name, FILEIO_WRITE, FILEIO_BINARY);
+	if (retval != ERROR_OK) {
+		fclose(svf_fd);
+		svf_fd = NULL;
+		return retval;
+	}
 
-			/* output debug info */
-			if ((SIR == command) || (SDR == command)) {
-				SVF_BUF_LOG(DEBUG, svf_tdi_buffer, svf_check_tdo_para[0].bit_len, "TDO read");
-			}
+	memset(&xxr_para_tmp, 0, sizeof(xxr_para_tmp));
+	svf_line_number = 0;
+	svf_command_buffer_size = 0;
+
+	retval = fileio_write(fileio, sizeof(svf_bin_magic), svf_bin_magic, &written);
+
+	while (retval == ERROR_OK && svf_read_command_from_file(svf_fd) == ERROR_OK) {
+		len = strlen(svf_command_buffer);
+
+		name_len = strcspn(svf_command_buffer, " ");
+		saved = svf_command_buffer[name_len];
+		svf_command_buffer[name_len] = '\0';
+		command = svf_find_string_in_array(svf_command_buffer,
+				(char **)svf_command_name, ARRAY_SIZE(svf_command_name));
+		svf_command_buffer[name_len] = saved;
+
+		switch (command) {
+			case HDR:
+			case HIR:
+			case TDR:
+			case TIR:
+			case SDR:
+			case SIR:
+				if (svf_parse_cmd_string(svf_command_buffer, len, argus,
+							&num_of_argu) != ERROR_OK ||
+						svf_parse_xxr(argus, num_of_argu, &xxr_para_tmp,
+							&orig_len) != ERROR_OK) {
+					retval = ERROR_FAIL;
+					break;
+				}
+
+				len = DIV_ROUND_UP(xxr_para_tmp.len, 8);
+				retval = svf_bin_write_record(fileio, SVF_BIN_XXR, command,
+						xxr_para_tmp.data_mask, xxr_para_tmp.len);
+				if (retval == ERROR_OK && (xxr_para_tmp.data_mask & XXR_TDI))
+					retval = fileio_write(fileio, len, xxr_para_tmp.tdi, &written);
+				if (retval == ERROR_OK && (xxr_para_tmp.data_mask & XXR_TDO))
+					retval = fileio_write(fileio, len, xxr_para_tmp.tdo, &written);
+				if (retval == ERROR_OK && (xxr_para_tmp.data_mask & XXR_MASK))
+					retval = fileio_write(fileio, len, xxr_para_tmp.mask, &written);
+				if (retval == ERROR_OK && (xxr_para_tmp.data_mask & XXR_SMASK))
+					retval = fileio_write(fileio, len, xxr_para_tmp.smask, &written);
+				break;
+			default:
+				retval = svf_bin_write_record(fileio, SVF_BIN_TEXT, 0, 0, len);
+				if (retval == ERROR_OK)
+					retval = fileio_write(fileio, len, svf_command_buffer, &written);
+				break;
 		}
-	} else {
-		/* for fast executing, execute tap if necessary */
-		/* half of the buffer is for the next command */
-		if (((svf_buffer_index >= SVF_MAX_BUFFER_SIZE_TO_COMMIT) ||
-				(svf_check_tdo_para_index >= SVF_CHECK_TDO_PARA_SIZE / 2)) && \
-				(((command != STATE) && (command != RUNTEST)) || \
-						((command == STATE) && (num_of_argu == 2))))
-			return svf_execute_tap();
+
+		if (retval != ERROR_OK)
+			LOG_ERROR("fail to compile command at line %d", svf_line_number);
+		else
+			command_num++;
 	}
 
+	fileio_close(fileio);
+	fclose(svf_fd);
+	svf_fd = NULL;
+
+	free(svf_command_buffer);
+	svf_command_buffer = NULL;
+	svf_command_buffer_size = 0;
+	svf_free_xxd_para(&xxr_para_tmp);
+
+	if (retval == ERROR_OK)
+		command_print(cmd_ctx, "compiled %d svf commands into %s",
+				command_num, bin_name);
+
+	return retval;
+}
+
+static int svf_bin_read(struct svf_bin *bin, void *buffer, size_t size)
+{
+	size_t size_read;
+
+	if (size > bin->size - bin->pos) {
+		LOG_ERROR("compiled svf file is truncated");
+		return ERROR_FAIL;
+	}
+
+	if (bin->map)
+		memcpy(buffer, bin->map + bin->pos, size);
+	else if (fileio_read(bin->fileio, size, buffer, &size_read) != ERROR_OK
+			|| size_read != size)
+		return ERROR_FAIL;
+
+	bin->pos += size;
 	return ERROR_OK;
 }
 
+static int svf_bin_skip(struct svf_bin *bin, size_t size)
+{
+	if (size > bin->size - bin->pos) {
+		LOG_ERROR("compiled svf file is truncated");
+		return ERROR_FAIL;
+	}
+
+	bin->pos += size;
+	if (bin->map)
+		return ERROR_OK;
+	return fileio_seek(bin->fileio, bin->pos);
+}
+
+static int svf_run_compiled_xxr(struct svf_bin *bin, int command,
+		int data_mask, int len)
+{
+	struct svf_xxr_para *xxr_para_tmp;
+	uint8_t **vector[4];
+	size_t byte_len = DIV_ROUND_UP(len, 8);
+	int i, orig_len;
+
+	switch (command) {
+		case HDR:
+			xxr_para_tmp = &svf_para.hdr_para;
+			break;
+		case HIR:
+			xxr_para_tmp = &svf_para.hir_para;
+			break;
+		case TDR:
+			xxr_para_tmp = &svf_para.tdr_para;
+			break;
+		case TIR:
+			xxr_para_tmp = &svf_para.tir_para;
+			break;
+		case SDR:
+			xxr_para_tmp = &svf_para.sdr_para;
+			break;
+		case SIR:
+			xxr_para_tmp = &svf_para.sir_para;
+			break;
+		default:
+			LOG_ERROR("invalid scan command in compiled svf file");
+			return ERROR_FAIL;
+	}
+
+	vector[0] = &xxr_para_tmp->tdi;
+	vector[1] = &xxr_para_tmp->tdo;
+	vector[2] = &xxr_para_tmp->mask;
+	vector[3] = &xxr_para_tmp->smask;
+
+	if (svf_tap_is_specified && command != SDR && command != SIR) {
+		for (i = 0; i < 4; i++) {
+			if ((data_mask & (1 << i)) && svf_bin_skip(bin, byte_len) != ERROR_OK)
+				return ERROR_FAIL;
+		}
+		return svf_command_done(command, 0, 1);
+	}
+
+	orig_len = xxr_para_tmp->len;
+	xxr_para_tmp->len = len;
+	/* If we are to enlarge the buffers, all parts of xxr_para_tmp
+	 * need to be freed */
+	if (orig_len < len) {
+		for (i = 0; i < 4; i++) {
+			free(*vector[i]);
+			*vector[i] = NULL;
+		}
+	}
+
+	xxr_para_tmp->data_mask = data_mask;
+	for (i = 0; i < 4; i++) {
+		if (!(data_mask & (1 << i)))
+			continue;
+		if (svf_adjust_array_length(vector[i], orig_len, len) != ERROR_OK
+				|| svf_bin_read(bin, *vector[i], byte_len) != ERROR_OK)
+			return ERROR_FAIL;
+	}
+
+	if (svf_xxr_scan(command, xxr_para_tmp, orig_len) != ERROR_OK)
+		return ERROR_FAIL;
+
+	return svf_command_done(command, 0, 0);
+}
+
+static int svf_run_compiled(struct command_context *cmd_ctx, const char *name,
+		int *command_num)
+{
+	uint8_t header[SVF_BIN_HEADER_SIZE];
+	struct svf_bin bin;
+	uint32_t len;
+	int retval;
+
+	memset(&bin, 0, sizeof(bin));
+	retval = fileio_open(&bin.fileio, name, FILEIO_READ, FILEIO_BINARY);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = fileio_size(bin.fileio, &bin.size);
+	if (retval != ERROR_OK)
+		goto done;
+
+	/* read straight from the mapping when the file could be mapped */
+	if (fileio_data(bin.fileio, 0, bin.size, &bin.map) != ERROR_OK)
+		bin.map = NULL;
+
+	retval = svf_bin_skip(&bin, sizeof(svf_bin_magic));
+
+	while (retval == ERROR_OK && bin.pos < bin.size) {
+		retval = svf_bin_read(&bin, header, sizeof(header));
+		if (retval != ERROR_OK)
+			break;
+		svf_line_number = le_to_h_u32(header + 4);
+		len = le_to_h_u32(header + 8);
+
+		if (svf_progress_enabled)
+			svf_percentage = ((bin.pos * 20) / bin.size) * 5;
+
+		switch (header[0]) {
+			case SVF_BIN_TEXT:
+				if (len + 1 > svf_command_buffer_size) {
+					free(svf_command_buffer);
+					svf_command_buffer = malloc(len + 1);
+					if (svf_command_buffer == NULL) {
+						svf_command_buffer_size = 0;
+						LOG_ERROR("not enough memory");
+						retval = ERROR_FAIL;
+						break;
+					}
+					svf_command_buffer_size = len + 1;
+				}
+				retval = svf_bin_read(&bin, svf_command_buffer, len);
+				if (retval != ERROR_OK)
+					break;
+				svf_command_buffer[len] = '\0';
+
+				if (svf_quiet) {
+					if (svf_progress_enabled &&
+							svf_last_printed_percentage != svf_percentage) {
+						LOG_USER_N("\r%d%%    ", svf_percentage);
+						svf_last_printed_percentage = svf_percentage;
+					}
+				} else if (svf_progress_enabled)
+					LOG_USER("%3d%%  %s;", svf_percentage, svf_command_buffer);
+				else
+					LOG_USER("%s;", svf_command_buffer);
+
+				retval = svf_run_command(cmd_ctx, svf_command_buffer);
+				break;
+			case SVF_BIN_XXR:
+				if (header[1] >= ARRAY_SIZE(svf_command_name)) {
+					retval = ERROR_FAIL;
+					break;
+				}
+
+				if (svf_quiet) {
+					if (svf_progress_enabled &&
+							svf_last_printed_percentage != svf_percentage) {
+						LOG_USER_N("\r%d%%    ", svf_percentage);
+						svf_last_printed_percentage = svf_percentage;
+					}
+				} else if (svf_progress_enabled)
+					LOG_USER("%3d%%  %s %" PRIu32 ";", svf_percentage,
+							svf_command_name[header[1]], len);
+				else
+					LOG_USER("%s %" PRIu32 ";", svf_command_name[header[1]], len);
+
+				retval = svf_run_compiled_xxr(&bin, header[1], header[2], len);
+				break;
+			default:
+				LOG_ERROR("invalid record in compiled svf file");
+				retval = ERROR_FAIL;
+				break;
+		}
+
+		if (retval != ERROR_OK)
+			LOG_ERROR("fail to run command at line %d", svf_line_number);
+		else
+			(*command_num)++;
+	}
+
+done:
+	fileio_close(bin.fileio);
+	return retval;
+}
+
 static const struct command_registration svf_command_handlers[] = {
 	{
 		.name = "svf",
 		.handler = handle_svf_command,
 		.mode = COMMAND_EXEC,
-		.help = "Runs a SVF file.",
-		.usage = "svf [-tap device.tap] <file> [quiet] [nil] [progress] [ignore_error]",
+		.help = "Runs a SVF file, or compiles it for faster playback.",
+		.usage = "svf [-tap device.tap] <file> [quiet] [nil] [progress] [ignore_error] | "
+			"svf compile <file> <compiled_file>",
 	},
 	COMMAND_REGISTRATION_DONE
 };
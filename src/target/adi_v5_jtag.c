@@ -37,6 +37,7 @@
 #include "arm.h"
 #include "arm_adi_v5.h"
 #include <helper/time_support.h>
+#include <helper/perf.h>
 #include <helper/list.h>
 
 /*#define DEBUG_WAIT*/
@@ -123,17 +124,19 @@ static const char *dap_reg_name(int instr, int reg_addr)
 }
 #endif
 
+/* number of dap_cmd entries allocated at once when the pool runs dry */
+#define DAP_CMD_POOL_BLOCK	64
+
 struct dap_cmd {
 	struct list_head lh;
+	struct scan_field fields[2];
+	uint8_t *invalue;
+	uint32_t memaccess_tck;
+	uint32_t dp_select;
 	uint8_t instr;
 	uint8_t reg_addr;
 	uint8_t RnW;
-	uint8_t *invalue;
 	uint8_t ack;
-	uint32_t memaccess_tck;
-	uint32_t dp_select;
-
-	struct scan_field fields[2];
 	uint8_t out_addr_buf;
 	uint8_t invalue_buf[4];
 	uint8_t outvalue_buf[4];
@@ -153,36 +156,100 @@ static void log_dap_cmd(const char *header, struct dap_cmd *el)
 #endif
 }
 
-static struct dap_cmd *dap_cmd_new(uint8_t instr,
+/*
+ * Commands come from a per-DAP pool and go back to it once the journal is
+ * flushed, so queueing a transaction does not cost a heap allocation.
+ */
+static struct dap_cmd *dap_cmd_new(struct adiv5_dap *dap, uint8_t instr,
 		uint8_t reg_addr, uint8_t RnW,
 		uint8_t *outvalue, uint8_t *invalue,
 		uint32_t memaccess_tck)
 {
 	struct dap_cmd *cmd;
 
-	cmd = (struct dap_cmd *)calloc(1, sizeof(struct dap_cmd));
-	if (cmd != NULL) {
-		INIT_LIST_HEAD(&cmd->lh);
-		cmd->instr = instr;
-		cmd->reg_addr = reg_addr;
-		cmd->RnW = RnW;
-		if (outvalue != NULL)
-			memcpy(cmd->outvalue_buf, outvalue, 4);
-		cmd->invalue = (invalue != NULL) ? invalue : cmd->invalue_buf;
-		cmd->memaccess_tck = memaccess_tck;
+	if (list_empty(&dap->cmd_pool)) {
+		struct dap_cmd *block = calloc(DAP_CMD_POOL_BLOCK, sizeof(struct dap_cmd));
+		if (block == NULL)
+			return NULL;
+		for (unsigned i = 0; i < DAP_CMD_POOL_BLOCK; i++)
+			list_add_tail(&block[i].lh, &dap->cmd_pool);
 	}
 
+	cmd = list_first_entry(&dap->cmd_pool, struct dap_cmd, lh);
+	list_del(&cmd->lh);
+
+	memset(cmd, 0, sizeof(*cmd));
+	INIT_LIST_HEAD(&cmd->lh);
+	cmd->instr = instr;
+	cmd->reg_addr = reg_addr;
+	cmd->RnW = RnW;
+	if (outvalue != NULL)
+		memcpy(cmd->outvalue_buf, outvalue, 4);
+	cmd->invalue = (invalue != NULL) ? invalue : cmd->invalue_buf;
+	cmd->memaccess_tck = memaccess_tck;
+
 	return cmd;
 }
 
-static void flush_journal(struct list_head *lh)
+/* return a command that is not on any list to the pool */
+static void dap_cmd_release(struct adiv5_dap *dap, struct dap_cmd *cmd)
 {
-	struct dap_cmd *el, *tmp;
+	list_add(&cmd->lh, &dap->cmd_pool);
+}
 
-	list_for_each_entry_safe(el, tmp, lh, lh) {
-		list_del(&el->lh);
-		free(el);
-	}
+static void flush_journal(struct adiv5_dap *dap, struct list_head *lh)
+{
+	list_splice_init(lh, &dap->cmd_pool);
+}
+
+/* idle cycles added on the first WAIT, doubled on each further one */
+#define MEMACCESS_TCK_STEP	8
+/* WAIT free runs after which the added idle cycles are reduced */
+#define MEMACCESS_DECAY_RUNS	64
+
+/* AP a journaled APACC command was sent to */
+static struct adiv5_ap *dap_cmd_ap(struct adiv5_dap *dap, struct dap_cmd *cmd)
+{
+	return &dap->ap[(cmd->dp_select & DP_SELECT_APSEL) >> 24];
+}
+
+/* idle cycles to add after an access to this AP, see "dap memaccess" */
+static uint32_t jtag_ap_memaccess_tck(struct adiv5_ap *ap)
+{
+	uint32_t tck = ap->memaccess_tck + ap->memaccess_tck_extra;
+
+	/* memaccess_tck max is 255 */
+	return tck > 255 ? 255 : tck;
+}
+
+/*
+ * An access to this AP stalled: give it more idle cycles until the
+ * WAIT responses stop.
+ */
+static void jtag_ap_slow_down(struct adiv5_ap *ap)
+{
+	if (ap->memaccess_tck_extra == 0)
+		ap->memaccess_tck_extra = MEMACCESS_TCK_STEP;
+	else if (jtag_ap_memaccess_tck(ap) < 255)
+		ap->memaccess_tck_extra *= 2;
+	ap->wait_free_runs = 0;
+
+	LOG_INFO("DAP transaction stalled (WAIT) - slowing down AP %d to %" PRIu32 " idle cycles",
+			ap->ap_num, jtag_ap_memaccess_tck(ap));
+}
+
+/*
+ * A run completed without WAIT: once this happened often enough in a row,
+ * hand back some of the idle cycles added by jtag_ap_slow_down().
+ */
+static void jtag_ap_speed_up(struct adiv5_ap *ap)
+{
+	if (ap->memaccess_tck_extra == 0 || ++ap->wait_free_runs < MEMACCESS_DECAY_RUNS)
+		return;
+
+	ap->memaccess_tck_extra -= (ap->memaccess_tck_extra + 3) / 4;
+	ap->wait_free_runs = 0;
+	LOG_DEBUG("AP %d back to %" PRIu32 " idle cycles", ap->ap_num, jtag_ap_memaccess_tck(ap));
 }
 
 /***************************************************************************
@@ -273,15 +340,19 @@ static int adi_jtag_dp_scan(struct adiv5_dap *dap,
 	struct dap_cmd *cmd;
 	int retval;
 
-	cmd = dap_cmd_new(instr, reg_addr, RnW, outvalue, invalue, memaccess_tck);
+	cmd = dap_cmd_new(dap, instr, reg_addr, RnW, outvalue, invalue, memaccess_tck);
 	if (cmd != NULL)
 		cmd->dp_select = dap->select;
 	else
 		return ERROR_JTAG_DEVICE_ERROR;
 
 	retval = adi_jtag_dp_scan_cmd(dap, cmd, ack);
-	if (retval == ERROR_OK)
+	if (retval == ERROR_OK) {
 		list_add_tail(&cmd->lh,	&dap->cmd_journal);
+		dap->perf.transactions++;
+		perf_add(PERF_DAP_TRANSACTIONS, 1);
+	} else
+		dap_cmd_release(dap, cmd);
 
 	return retval;
 }
@@ -359,6 +430,10 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 	int found_wait = 0;
 	int64_t time_now;
 	LIST_HEAD(replay_list);
+	uint8_t ap_seen[256 / 8] = { 0 };
+	struct adiv5_ap *stalled_ap = NULL;
+
+	dap->perf.runs++;
 
 	/* make sure all queued transactions are complete */
 	retval = jtag_execute_queue();
@@ -367,9 +442,14 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 
 	/* skip all completed transactions up to the first WAIT */
 	list_for_each_entry(el, &dap->cmd_journal, lh) {
+		if (el->instr == JTAG_DP_APACC) {
+			unsigned apsel = (el->dp_select & DP_SELECT_APSEL) >> 24;
+			ap_seen[apsel / 8] |= 1 << (apsel % 8);
+		}
 		if (el->ack == JTAG_ACK_OK_FAULT) {
 			log_dap_cmd("LOG", el);
 		} else if (el->ack == JTAG_ACK_WAIT) {
+			jtag_trace_wait();
 			found_wait = 1;
 			break;
 		} else {
@@ -380,6 +460,19 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 		}
 	}
 
+	/* the AP access still in progress when the WAIT came is the one
+	 * that stalled, usually the transaction just before the WAIT */
+	if (found_wait) {
+		struct dap_cmd *stalled = el;
+		if (el != list_first_entry(&dap->cmd_journal, struct dap_cmd, lh)) {
+			struct dap_cmd *before = list_entry(el->lh.prev, struct dap_cmd, lh);
+			if (before->instr == JTAG_DP_APACC)
+				stalled = before;
+		}
+		if (stalled->instr == JTAG_DP_APACC)
+			stalled_ap = dap_cmd_ap(dap, stalled);
+	}
+
 	/*
 	 * If we found a stalled transaction and a previous transaction
 	 * exists, check if it's a READ access.
@@ -415,7 +508,7 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 				* To complete the READ, we just keep polling RDBUFF
 				* until the WAIT condition clears
 				*/
-				tmp = dap_cmd_new(JTAG_DP_DPACC,
+				tmp = dap_cmd_new(dap, JTAG_DP_DPACC,
 						DP_RDBUFF, DPAP_READ, NULL, NULL, 0);
 				if (tmp == NULL) {
 					retval = ERROR_JTAG_DEVICE_ERROR;
@@ -454,7 +547,7 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 				}
 
 				/* we're done with this command, release it */
-				free(tmp);
+				dap_cmd_release(dap, tmp);
 
 				if (retval != ERROR_OK)
 					goto done;
@@ -474,11 +567,23 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 	}
 
 	/* we're done with the journal, flush it */
-	flush_journal(&dap->cmd_journal);
+	flush_journal(dap, &dap->cmd_journal);
+
+	/* let the APs that kept up without WAIT go faster again */
+	if (!found_wait) {
+		for (unsigned apsel = 0; apsel < 256; apsel++)
+			if (ap_seen[apsel / 8] & (1 << (apsel % 8)))
+				jtag_ap_speed_up(&dap->ap[apsel]);
+	}
 
 	/* check for overrun condition in the last batch of transactions */
 	if (found_wait) {
-		LOG_INFO("DAP transaction stalled (WAIT) - slowing down");
+		if (stalled_ap != NULL)
+			jtag_ap_slow_down(stalled_ap);
+		else
+			LOG_INFO("DAP transaction stalled (WAIT) - slowing down");
+		dap->perf.waits++;
+
 		/* clear the sticky overrun condition */
 		retval = adi_jtag_scan_inout_check_u32(dap, JTAG_DP_DPACC,
 				DP_CTRL_STAT, DPAP_WRITE,
@@ -489,7 +594,7 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 		/* restore SELECT register first */
 		if (!list_empty(&replay_list)) {
 			el = list_first_entry(&replay_list, struct dap_cmd, lh);
-			tmp = dap_cmd_new(JTAG_DP_DPACC,
+			tmp = dap_cmd_new(dap, JTAG_DP_DPACC,
 					  DP_SELECT, DPAP_WRITE, (uint8_t *)&el->dp_select, NULL, 0);
 			if (tmp == NULL) {
 				retval = ERROR_JTAG_DEVICE_ERROR;
@@ -501,8 +606,12 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 		}
 
 		list_for_each_entry_safe(el, tmp, &replay_list, lh) {
+			/* replay AP accesses with the raised idle cycle count */
+			if (el->instr == JTAG_DP_APACC)
+				el->memaccess_tck = jtag_ap_memaccess_tck(dap_cmd_ap(dap, el));
 			time_now = timeval_ms();
 			do {
+				dap->perf.replays++;
 				retval = adi_jtag_dp_scan_cmd_sync(dap, el, NULL);
 				if (retval != ERROR_OK)
 					break;
@@ -534,8 +643,8 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 	}
 
  done:
-	flush_journal(&replay_list);
-	flush_journal(&dap->cmd_journal);
+	flush_journal(dap, &replay_list);
+	flush_journal(dap, &dap->cmd_journal);
 	return retval;
 }
 
@@ -586,7 +695,7 @@ static int jtagdp_transaction_endcheck(struct adiv5_dap *dap)
 	}
 
  done:
-	flush_journal(&dap->cmd_journal);
+	flush_journal(dap, &dap->cmd_journal);
 	return retval;
 }
 
@@ -632,7 +741,7 @@ static int jtag_ap_q_read(struct adiv5_ap *ap, unsigned reg,
 		return retval;
 
 	retval =  adi_jtag_dp_scan_u32(ap->dap, JTAG_DP_APACC, reg,
-			DPAP_READ, 0, ap->dap->last_read, ap->memaccess_tck, NULL);
+			DPAP_READ, 0, ap->dap->last_read, jtag_ap_memaccess_tck(ap), NULL);
 	ap->dap->last_read = data;
 
 	return retval;
@@ -646,7 +755,7 @@ static int jtag_ap_q_write(struct adiv5_ap *ap, unsigned reg,
 		return retval;
 
 	retval =  adi_jtag_dp_scan_u32(ap->dap, JTAG_DP_APACC, reg,
-			DPAP_WRITE, data, ap->dap->last_read, ap->memaccess_tck, NULL);
+			DPAP_WRITE, data, ap->dap->last_read, jtag_ap_memaccess_tck(ap), NULL);
 	ap->dap->last_read = NULL;
 	return retval;
 }
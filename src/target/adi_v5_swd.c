@@ -24,7 +24,8 @@
  * is a transport level interface, with "target/arm_adi_v5.[hc]" code
  * understanding operation semantics, shared with the JTAG transport.
  *
- * Single-DAP support only.
+ * Several DPv2 DPs can share one bus (multidrop), each one is then picked
+ * with a TARGETSEL write before it is accessed.
  *
  * for details, see "ARM IHI 0031A"
  * ARM Debug Interface v5 Architecture Specification
@@ -47,6 +48,7 @@
 #include "arm.h"
 #include "arm_adi_v5.h"
 #include <helper/time_support.h>
+#include <helper/perf.h>
 
 #include <transport/transport.h>
 #include <jtag/interface.h>
@@ -57,6 +59,12 @@
 extern struct jtag_interface *jtag_interface;
 static bool do_sync;
 
+/* DP that answers on a multidrop bus, NULL after a plain line reset */
+static struct adiv5_dap *swd_multidrop_selected;
+
+/* DP/AP transactions queued since the last run, for the flush trace */
+static unsigned swd_queued;
+
 static void swd_finish_read(struct adiv5_dap *dap)
 {
 	const struct swd_driver *swd = jtag_interface->swd;
@@ -83,18 +91,51 @@ static void swd_clear_sticky_errors(struct adiv5_dap *dap)
 static int swd_run_inner(struct adiv5_dap *dap)
 {
 	const struct swd_driver *swd = jtag_interface->swd;
+	int64_t trace_begin = jtag_trace_begin();
 	int retval;
 
 	retval = swd->run();
 
+	jtag_trace_record(JTAG_TRACE_SWD, trace_begin, swd_queued, swd_queued * 32, retval);
+	perf_add(PERF_SWD_RUNS, 1);
+	perf_add(PERF_DAP_TRANSACTIONS, swd_queued);
+	swd_queued = 0;
+
 	if (retval != ERROR_OK) {
 		/* fault response */
 		dap->do_reconnect = true;
+		swd_multidrop_selected = NULL;
 	}
 
 	return retval;
 }
 
+/*
+ * On a multidrop bus only the DP picked by the last TARGETSEL responds.
+ * Switching to another DP takes a line reset, TARGETSEL and a DPIDR read,
+ * and is only queued when the DP changes. Nothing is flushed, so the
+ * transactions for several DPs can go out in the same run.
+ */
+static void swd_multidrop_select(struct adiv5_dap *dap)
+{
+	const struct swd_driver *swd = jtag_interface->swd;
+
+	if (!dap->multidrop || swd_multidrop_selected == dap)
+		return;
+
+	/* collect the posted read of the DP we leave */
+	if (swd_multidrop_selected != NULL)
+		swd_finish_read(swd_multidrop_selected);
+
+	swd->switch_seq(LINE_RESET);
+	swd->write_reg(swd_cmd(false, false, DP_TARGETSEL), dap->targetsel, 0);
+	/* the DP leaves its reset state once DPIDR is read */
+	swd->read_reg(swd_cmd(true, false, DP_DPIDR), NULL, 0);
+
+	dap->select = DP_SELECT_INVALID;
+	swd_multidrop_selected = dap;
+}
+
 static int swd_connect(struct adiv5_dap *dap)
 {
 	uint32_t dpidr;
@@ -125,6 +166,7 @@ static int swd_connect(struct adiv5_dap *dap)
 	/* Clear link state, including the SELECT cache. */
 	dap->do_reconnect = false;
 	dap->select = DP_SELECT_INVALID;
+	swd_multidrop_selected = NULL;
 
 	swd_queue_dp_read(dap, DP_DPIDR, &dpidr);
 
@@ -134,7 +176,11 @@ static int swd_connect(struct adiv5_dap *dap)
 	status = swd_run_inner(dap);
 
 	if (status == ERROR_OK) {
-		LOG_INFO("SWD DPIDR %#8.8" PRIx32, dpidr);
+		if (dap->multidrop)
+			LOG_INFO("SWD DPIDR %#8.8" PRIx32 ", TARGETSEL %#8.8" PRIx32,
+					dpidr, dap->targetsel);
+		else
+			LOG_INFO("SWD DPIDR %#8.8" PRIx32, dpidr);
 		dap->do_reconnect = false;
 	} else
 		dap->do_reconnect = true;
@@ -147,10 +193,34 @@ static inline int check_sync(struct adiv5_dap *dap)
 	return do_sync ? swd_run_inner(dap) : ERROR_OK;
 }
 
+/*
+ * Recover the link after a failed run without a round trip of its own:
+ * the switch sequence, DPIDR read and sticky error clearing are queued in
+ * front of the transactions that follow and go out in the same run. If
+ * the link is still broken that run fails, and the next access retries.
+ */
+static void swd_queue_reconnect(struct adiv5_dap *dap)
+{
+	const struct swd_driver *swd = jtag_interface->swd;
+
+	swd->switch_seq(JTAG_TO_SWD);
+
+	/* Clear link state, including the SELECT cache. */
+	dap->do_reconnect = false;
+	dap->select = DP_SELECT_INVALID;
+	swd_multidrop_selected = NULL;
+
+	swd_multidrop_select(dap);
+	swd->read_reg(swd_cmd(true, false, DP_DPIDR), NULL, 0);
+	swd_clear_sticky_errors(dap);
+}
+
 static int swd_check_reconnect(struct adiv5_dap *dap)
 {
 	if (dap->do_reconnect)
-		return swd_connect(dap);
+		swd_queue_reconnect(dap);
+	else
+		swd_multidrop_select(dap);
 
 	return ERROR_OK;
 }
@@ -160,8 +230,10 @@ static int swd_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 	const struct swd_driver *swd = jtag_interface->swd;
 	assert(swd);
 
+	swd_multidrop_select(dap);
 	swd->write_reg(swd_cmd(false,  false, DP_ABORT),
 		DAPABORT | STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR, 0);
+	swd_queued++;
 	return check_sync(dap);
 }
 
@@ -196,6 +268,7 @@ static int swd_queue_dp_read(struct adiv5_dap *dap, unsigned reg,
 
 	swd_queue_dp_bankselect(dap, reg);
 	swd->read_reg(swd_cmd(true,  false, reg), data, 0);
+	swd_queued++;
 
 	return check_sync(dap);
 }
@@ -213,6 +286,7 @@ static int swd_queue_dp_write(struct adiv5_dap *dap, unsigned reg,
 	swd_finish_read(dap);
 	swd_queue_dp_bankselect(dap, reg);
 	swd->write_reg(swd_cmd(false,  false, reg), data, 0);
+	swd_queued++;
 
 	return check_sync(dap);
 }
@@ -248,6 +322,7 @@ static int swd_queue_ap_read(struct adiv5_ap *ap, unsigned reg,
 	swd_queue_ap_bankselect(ap, reg);
 	swd->read_reg(swd_cmd(true,  true, reg), dap->last_read, ap->memaccess_tck);
 	dap->last_read = data;
+	swd_queued++;
 
 	return check_sync(dap);
 }
@@ -267,6 +342,7 @@ static int swd_queue_ap_write(struct adiv5_ap *ap, unsigned reg,
 	swd_finish_read(dap);
 	swd_queue_ap_bankselect(ap, reg);
 	swd->write_reg(swd_cmd(false,  true, reg), data, ap->memaccess_tck);
+	swd_queued++;
 
 	return check_sync(dap);
 }
@@ -856,7 +856,12 @@ static int arm11_read_memory_inner(struct target *target,
 
 			/* LDC p14,c5,[R0],#4 */
 			/* LDC p14,c5,[R0] */
-			CHECK_RETVAL(arm11_run_instr_data_from_core(arm11, instr, words, count));
+			if (count > 1)
+				CHECK_RETVAL(arm11_run_instr_data_from_core_burst(arm11,
+						instr, words, count));
+			else
+				CHECK_RETVAL(arm11_run_instr_data_from_core(arm11,
+						instr, words, count));
 			break;
 		}
 	}
@@ -1347,6 +1352,7 @@ struct target_type arm11_target = {
 
 	.checksum_memory = arm_checksum_memory,
 	.blank_check_memory = arm_blank_check_memory,
+	.fill_memory = arm_fill_memory,
 
 	.add_breakpoint = arm11_add_breakpoint,
 	.remove_breakpoint = arm11_remove_breakpoint,
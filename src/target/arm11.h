@@ -74,6 +74,9 @@ struct arm11_common {
 	bool step_irq_enable;
 	bool hardware_step;
 
+	/** TAP_IDLE cycles between burst scans, adapted to the core's speed. */
+	unsigned burst_idle_cycles;
+
 	/** Configured Vector Catch Register settings. */
 	uint32_t vcr;
 
@@ -808,6 +808,127 @@ int arm11_run_instr_data_from_core(struct arm11_common *arm11,
 	return ERROR_OK;
 }
 
+/* words scanned per JTAG queue flush in burst reads */
+#define ARM11_BURST_BATCH	256
+/* upper limit for the adaptive TAP_IDLE delay between burst scans */
+#define ARM11_BURST_IDLE_MAX	64
+
+static const tap_state_t arm11_move_pd_to_idle[] = {
+	TAP_DREXIT2, TAP_DRUPDATE, TAP_IDLE
+};
+
+/** Execute one instruction via ITR repeatedly while reading data
+ *  from the core via DTR on each execution, without waiting for
+ *  the Ready flag after every word.
+ *
+ * Same preconditions as arm11_run_instr_data_from_core().
+ *
+ * Scans are queued in batches.  The instruction is only reissued after
+ * a scan that saw Ready, so words whose Ready flag was clear are simply
+ * scanned again in the next batch.  The number of TAP_IDLE cycles
+ * between scans grows while that happens and shrinks again once whole
+ * batches come back ready.
+ *
+ * \pre arm11_run_instr_data_prepare() /  arm11_run_instr_data_finish() block
+ *
+ * \param arm11		Target state variable.
+ * \param opcode	ARM opcode
+ * \param data		Pointer to an array that receives the data words from the core
+ * \param count		Number of data words and instruction repetitions
+ *
+ */
+int arm11_run_instr_data_from_core_burst(struct arm11_common *arm11,
+	uint32_t opcode,
+	uint32_t *data,
+	size_t count)
+{
+	struct jtag_tap *tap = arm11->arm.target->tap;
+	size_t batch = MIN(count, (size_t)ARM11_BURST_BATCH);
+	int retval = ERROR_OK;
+
+	if (count == 0)
+		return ERROR_OK;
+
+	uint32_t *Data = malloc(batch * sizeof(*Data));
+	uint8_t *Ready = malloc(batch);
+	if (Data == NULL || Ready == NULL) {
+		LOG_ERROR("Out of memory");
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	arm11_add_IR(arm11, ARM11_ITRSEL, ARM11_TAP_DEFAULT);
+
+	arm11_add_debug_INST(arm11, opcode, NULL, TAP_IDLE);
+
+	arm11_add_IR(arm11, ARM11_INTEST, ARM11_TAP_DEFAULT);
+
+	struct scan_field chain5_fields[3];
+	int64_t then = timeval_ms();
+
+	while (count > 0) {
+		size_t n = MIN(count, batch);
+
+		for (size_t i = 0; i < n; i++) {
+			arm11_setup_field(arm11, 32, NULL, Data + i,  chain5_fields + 0);
+			arm11_setup_field(arm11,  1, NULL, Ready + i, chain5_fields + 1);
+			arm11_setup_field(arm11,  1, NULL, NULL,      chain5_fields + 2);
+
+			/* stop short of issuing one instruction too many */
+			if (i == n - 1) {
+				arm11_add_dr_scan_vc(tap, ARRAY_SIZE(chain5_fields),
+						chain5_fields, TAP_DRPAUSE);
+			} else {
+				arm11_add_dr_scan_vc(tap, ARRAY_SIZE(chain5_fields),
+						chain5_fields, TAP_IDLE);
+				if (arm11->burst_idle_cycles)
+					jtag_add_runtest(arm11->burst_idle_cycles, TAP_IDLE);
+			}
+		}
+
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			goto done;
+
+		size_t valid = 0;
+		for (size_t i = 0; i < n; i++) {
+			if (Ready[i] & 1)
+				data[valid++] = Data[i];
+		}
+		data += valid;
+		count -= valid;
+
+		if (valid < n) {
+			unsigned idle = MIN(arm11->burst_idle_cycles * 2 + 1,
+					(unsigned)ARM11_BURST_IDLE_MAX);
+			if (idle != arm11->burst_idle_cycles)
+				LOG_DEBUG("%zu of %zu words not ready, using %u idle cycles",
+					n - valid, n, idle);
+			arm11->burst_idle_cycles = idle;
+		} else if (arm11->burst_idle_cycles > 0)
+			arm11->burst_idle_cycles--;
+
+		if (valid > 0)
+			then = timeval_ms();
+		else if (timeval_ms() - then > 1000) {
+			LOG_WARNING("Timeout (1000ms) waiting for instructions to complete");
+			retval = ERROR_FAIL;
+			goto done;
+		}
+
+		/* the last scan ended in DRPAUSE; if it consumed a word, pass
+		 * through TAP_IDLE so the next instruction gets issued */
+		if (count > 0 && (Ready[n - 1] & 1))
+			jtag_add_pathmove(ARRAY_SIZE(arm11_move_pd_to_idle),
+				arm11_move_pd_to_idle);
+	}
+
+done:
+	free(Ready);
+	free(Data);
+	return retval;
+}
+
 /** Execute one instruction via ITR
  *  then load r0 into DTR and read DTR from core.
  *
@@ -862,6 +983,159 @@ int arm11_run_instr_data_to_core_via_r0(struct arm11_common *arm11, uint32_t opc
 	return ERROR_OK;
 }
 
+/* Check the Ready flags captured by a queue of array transfers */
+static int arm11_check_ready(const uint8_t *ready, size_t count, const char *what)
+{
+	unsigned error_count = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		if ((ready[i] & 1) == 0)
+			error_count++;
+	}
+
+	if (error_count > 0) {
+		LOG_ERROR("%u %s out of %zu not transferred", error_count, what, count);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+/** Execute a sequence of instructions via ITR, each reading a word from
+ *  the core via DTR, in a single JTAG queue.
+ *
+ * Same preconditions as arm11_run_instr_data_from_core().
+ *
+ *  Every executed instruction \em must write data to DTR.
+ *
+ *  There is no waiting for the Ready flags; they are checked once the
+ *  queue ran, and the whole sequence fails if any was clear.  Each
+ *  instruction gets the time of two IR scans to complete, which covers
+ *  the register moves this is used for.
+ *
+ * \pre arm11_run_instr_data_prepare() /  arm11_run_instr_data_finish() block
+ *
+ * \param arm11		Target state variable.
+ * \param opcode	Pointer to sequence of ARM opcodes
+ * \param data		Pointer to an array that receives the data words from the core
+ * \param count		Number of opcodes and data words
+ *
+ */
+static int arm11_run_instr_array_from_core(struct arm11_common *arm11,
+	const uint32_t *opcode, uint32_t *data, size_t count)
+{
+	struct jtag_tap *tap = arm11->arm.target->tap;
+	struct scan_field chain5_fields[3];
+	int retval;
+
+	if (count == 0)
+		return ERROR_OK;
+
+	/* Ready flags of the ITR scans, then of the DTR scans */
+	uint8_t *ready = malloc(2 * count);
+	if (ready == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		arm11_add_IR(arm11, ARM11_ITRSEL, ARM11_TAP_DEFAULT);
+
+		arm11_add_debug_INST(arm11, opcode[i], ready + i, TAP_IDLE);
+
+		arm11_add_IR(arm11, ARM11_INTEST, ARM11_TAP_DEFAULT);
+
+		arm11_setup_field(arm11, 32, NULL, data + i,          chain5_fields + 0);
+		arm11_setup_field(arm11,  1, NULL, ready + count + i, chain5_fields + 1);
+		arm11_setup_field(arm11,  1, NULL, NULL,              chain5_fields + 2);
+
+		/* don't pass TAP_IDLE, that would run the opcode again */
+		arm11_add_dr_scan_vc(tap, ARRAY_SIZE(chain5_fields), chain5_fields,
+				TAP_DRPAUSE);
+	}
+
+	retval = jtag_execute_queue();
+	if (retval == ERROR_OK)
+		retval = arm11_check_ready(ready, count, "instructions");
+	if (retval == ERROR_OK)
+		retval = arm11_check_ready(ready + count, count, "words");
+
+	free(ready);
+	return retval;
+}
+
+/** Execute a sequence of instructions via ITR, each after passing
+ *  a word to the core via DTR, in a single JTAG queue.
+ *
+ * Same preconditions as arm11_run_instr_data_to_core().
+ *
+ *  Every executed instruction \em must read data from DTR.
+ *
+ *  As with arm11_run_instr_array_from_core(), the Ready flags are only
+ *  checked once the queue ran.
+ *
+ * \pre arm11_run_instr_data_prepare() /  arm11_run_instr_data_finish() block
+ *
+ * \param arm11		Target state variable.
+ * \param opcode	Pointer to sequence of ARM opcodes
+ * \param data		Pointer to the data words to be passed to the core
+ * \param count		Number of opcodes and data words
+ *
+ */
+static int arm11_run_instr_array_to_core(struct arm11_common *arm11,
+	const uint32_t *opcode, const uint32_t *data, size_t count)
+{
+	struct jtag_tap *tap = arm11->arm.target->tap;
+	struct scan_field chain5_fields[3];
+	int retval;
+
+	if (count == 0)
+		return ERROR_OK;
+
+	/* Ready flags of the ITR scans, of the DTR scans, and the last check */
+	uint8_t *ready = malloc(2 * count + 1);
+	if (ready == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		arm11_add_IR(arm11, ARM11_ITRSEL, ARM11_TAP_DEFAULT);
+
+		/* loaded here, run when the DTR scan passes TAP_IDLE */
+		arm11_add_debug_INST(arm11, opcode[i], ready + i, TAP_DRPAUSE);
+
+		arm11_add_IR(arm11, ARM11_EXTEST, ARM11_TAP_DEFAULT);
+
+		/* scans copy the data shifted out, so it may stay const */
+		arm11_setup_field(arm11, 32, (void *)(data + i), NULL, chain5_fields + 0);
+		arm11_setup_field(arm11,  1, NULL, ready + count + i,  chain5_fields + 1);
+		arm11_setup_field(arm11,  1, NULL, NULL,               chain5_fields + 2);
+
+		arm11_add_dr_scan_vc(tap, ARRAY_SIZE(chain5_fields), chain5_fields,
+				TAP_IDLE);
+	}
+
+	/* see that the last instruction took its word */
+	arm11_add_IR(arm11, ARM11_INTEST, ARM11_TAP_DEFAULT);
+
+	arm11_setup_field(arm11, 32, NULL, NULL,              chain5_fields + 0);
+	arm11_setup_field(arm11,  1, NULL, ready + 2 * count, chain5_fields + 1);
+	arm11_setup_field(arm11,  1, NULL, NULL,              chain5_fields + 2);
+
+	arm11_add_dr_scan_vc(tap, ARRAY_SIZE(chain5_fields), chain5_fields,
+			TAP_DRPAUSE);
+
+	retval = jtag_execute_queue();
+	if (retval == ERROR_OK)
+		retval = arm11_check_ready(ready, count, "instructions");
+	if (retval == ERROR_OK)
+		retval = arm11_check_ready(ready + count, count + 1, "words");
+
+	free(ready);
+	return retval;
+}
+
 /** Apply reads and writes to scan chain 7
  *
  * \see struct arm11_sc7_action
@@ -1073,6 +1347,20 @@ static int arm11_dpm_instr_read_data_r0(struct arm_dpm *dpm,
 		opcode, data);
 }
 
+static int arm11_dpm_instr_write_data_dcc_array(struct arm_dpm *dpm,
+	const uint32_t *opcode, const uint32_t *data, unsigned count)
+{
+	return arm11_run_instr_array_to_core(dpm_to_arm11(dpm),
+		opcode, data, count);
+}
+
+static int arm11_dpm_instr_read_data_dcc_array(struct arm_dpm *dpm,
+	const uint32_t *opcode, uint32_t *data, unsigned count)
+{
+	return arm11_run_instr_array_from_core(dpm_to_arm11(dpm),
+		opcode, data, count);
+}
+
 /* Because arm11_sc7_run() takes a vector of actions, we batch breakpoint
  * and watchpoint operations instead of running them right away.  Since we
  * pre-allocated our vector, we don't need to worry about space.
@@ -1170,9 +1458,11 @@ int arm11_dpm_init(struct arm11_common *arm11, uint32_t didr)
 
 	dpm->instr_write_data_dcc = arm11_dpm_instr_write_data_dcc;
 	dpm->instr_write_data_r0 = arm11_dpm_instr_write_data_r0;
+	dpm->instr_write_data_dcc_array = arm11_dpm_instr_write_data_dcc_array;
 
 	dpm->instr_read_data_dcc = arm11_dpm_instr_read_data_dcc;
 	dpm->instr_read_data_r0 = arm11_dpm_instr_read_data_r0;
+	dpm->instr_read_data_dcc_array = arm11_dpm_instr_read_data_dcc_array;
 
 	dpm->bpwp_enable = arm11_bpwp_enable;
 	dpm->bpwp_disable = arm11_bpwp_disable;
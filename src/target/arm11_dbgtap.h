@@ -45,6 +45,8 @@ int arm11_run_instr_data_to_core1(struct arm11_common *arm11,
 		uint32_t opcode, uint32_t data);
 int arm11_run_instr_data_from_core(struct arm11_common *arm11,
 		uint32_t opcode, uint32_t *data, size_t count);
+int arm11_run_instr_data_from_core_burst(struct arm11_common *arm11,
+		uint32_t opcode, uint32_t *data, size_t count);
 int arm11_run_instr_data_from_core_via_r0(struct arm11_common *arm11,
 		uint32_t opcode, uint32_t *data);
 int arm11_run_instr_data_to_core_via_r0(struct arm11_common *arm11,
@@ -757,7 +757,8 @@ static int arm7_9_handle_target_request(void *priv)
 	if (!target->dbg_msg_enabled)
 		return ERROR_OK;
 
-	if (target->state == TARGET_RUNNING) {
+	/* drain everything the target has queued up, within a budget */
+	for (int i = 0; i < TARGET_REQ_BURST_WORDS && target->state == TARGET_RUNNING; i++) {
 		/* read DCC control register */
 		embeddedice_read_reg(dcc_control);
 		retval = jtag_execute_queue();
@@ -765,16 +766,17 @@ static int arm7_9_handle_target_request(void *priv)
 			return retval;
 
 		/* check W bit */
-		if (buf_get_u32(dcc_control->value, 1, 1) == 1) {
-			uint32_t request;
+		if (buf_get_u32(dcc_control->value, 1, 1) == 0)
+			break;
 
-			retval = embeddedice_receive(jtag_info, &request, 1);
-			if (retval != ERROR_OK)
-				return retval;
-			retval = target_request(target, request);
-			if (retval != ERROR_OK)
-				return retval;
-		}
+		uint32_t request;
+
+		retval = embeddedice_receive(jtag_info, &request, 1);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = target_request(target, request);
+		if (retval != ERROR_OK)
+			return retval;
 	}
 
 	return ERROR_OK;
@@ -2644,6 +2646,177 @@ int arm7_9_bulk_write_memory(struct target *target,
 	return retval;
 }
 
+/* words read back per JTAG queue flush during DCC uploads */
+#define DCC_UPLOAD_CHUNK	1024
+
+static uint8_t *dcc_read_buffer;
+
+static int arm7_9_dcc_read_completion(struct target *target,
+	uint32_t exit_point,
+	int timeout_ms,
+	void *arch_info)
+{
+	int retval = ERROR_OK;
+	struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
+	struct reg *dcc_ctrl = &arm7_9->eice_cache->reg_list[EICE_COMMS_CTRL];
+	uint32_t data[DCC_UPLOAD_CHUNK];
+	uint8_t *buffer = dcc_read_buffer;
+	int count = dcc_count;
+
+	retval = target_wait_state(target, TARGET_DEBUG_RUNNING, 500);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Like the downloader, this relies on the core being faster than
+	 * JTAG: every read is queued blindly and only the final state of
+	 * the handshake is checked below. */
+	while (count > 0) {
+		int thisrun = MIN(count, DCC_UPLOAD_CHUNK);
+
+		retval = embeddedice_receive(&arm7_9->jtag_info, data, thisrun);
+		if (retval != ERROR_OK)
+			return retval;
+
+		target_buffer_set_u32_array(target, buffer, thisrun, data);
+		buffer += thisrun * 4;
+		count -= thisrun;
+	}
+
+	/* a word still pending means one of the reads above came too early */
+	embeddedice_read_reg(dcc_ctrl);
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+	if (buf_get_u32(dcc_ctrl->value, EICE_COMM_CTRL_WBIT, 1)) {
+		LOG_ERROR("DCC read overran the target, data is invalid");
+		retval = ERROR_FAIL;
+	}
+
+	int retval2 = target_halt(target);
+	if (retval2 == ERROR_OK)
+		retval2 = target_wait_state(target, TARGET_HALTED, 500);
+	if (retval == ERROR_OK)
+		retval = retval2;
+	return retval;
+}
+
+static const uint32_t dcc_read_code[] = {
+	/* r0 == input, points to memory buffer
+	 * r1 == input, number of words to send
+	 * r2, r3 == scratch
+	 */
+
+	/* read word from memory */
+	0xe4902004,	/* l: ldr r2, [r0], #4        */
+
+	/* spin until DCC control (c0) reports the host took the last word */
+	0xee103e10,	/* w: mrc p14, #0, r3, c0, c0 */
+	0xe3130002,	/*    tst r3, #2              */
+	0x1afffffc,	/*    bne w                   */
+
+	/* write word to DCC (c1) */
+	0xee012e10,	/*    mcr p14, #0, r2, c1, c0 */
+
+	/* repeat */
+	0xe2511001,	/*    subs r1, r1, #1         */
+	0x1afffff8,	/*    bne l                   */
+	0xeafffffe	/* d: b   d                   */
+};
+
+int arm7_9_bulk_read_memory(struct target *target,
+	uint32_t address,
+	uint32_t count,
+	uint8_t *buffer)
+{
+	int retval;
+	struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
+
+	if (address % 4 != 0)
+		return ERROR_TARGET_UNALIGNED_ACCESS;
+
+	if (!arm7_9->dcc_downloads)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* regrab previously allocated working_area, or allocate a new one */
+	if (!arm7_9->dcc_read_working_area) {
+		uint8_t dcc_code_buf[ARRAY_SIZE(dcc_read_code) * 4];
+
+		/* make sure we have a working area */
+		if (target_alloc_working_area(target, sizeof(dcc_code_buf),
+				&arm7_9->dcc_read_working_area) != ERROR_OK) {
+			LOG_INFO("no working area available, falling back to memory reads");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+
+		/* copy target instructions to target endianness */
+		target_buffer_set_u32_array(target, dcc_code_buf,
+				ARRAY_SIZE(dcc_read_code), dcc_read_code);
+
+		retval = arm7_9_write_memory_no_opt(target,
+				arm7_9->dcc_read_working_area->address, 4,
+				ARRAY_SIZE(dcc_read_code), dcc_code_buf);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	struct arm_algorithm arm_algo;
+	struct reg_param reg_params[2];
+
+	arm_algo.common_magic = ARM_COMMON_MAGIC;
+	arm_algo.core_mode = ARM_MODE_SVC;
+	arm_algo.core_state = ARM_STATE_ARM;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, address);
+	buf_set_u32(reg_params[1].value, 0, 32, count);
+
+	dcc_count = count;
+	dcc_read_buffer = buffer;
+	retval = armv4_5_run_algorithm_inner(target, 0, NULL, 2, reg_params,
+			arm7_9->dcc_read_working_area->address,
+			arm7_9->dcc_read_working_area->address + sizeof(dcc_read_code),
+			20*1000, &arm_algo, arm7_9_dcc_read_completion);
+
+	if (retval == ERROR_OK) {
+		uint32_t endaddress = buf_get_u32(reg_params[0].value, 0, 32);
+		uint32_t remaining = buf_get_u32(reg_params[1].value, 0, 32);
+		if (endaddress != (address + count*4) || remaining != 0) {
+			LOG_ERROR(
+				"DCC read failed, expected end address 0x%08" PRIx32 " got 0x%0" PRIx32 "",
+				(address + count*4),
+				endaddress);
+			retval = ERROR_FAIL;
+		}
+	}
+
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[0]);
+
+	return retval;
+}
+
+int arm7_9_read_memory_opt(struct target *target,
+	uint32_t address,
+	uint32_t size,
+	uint32_t count,
+	uint8_t *buffer)
+{
+	struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
+	int retval;
+
+	if (size == 4 && count > 32 && arm7_9->bulk_read_memory) {
+		/* Attempt to do a bulk read */
+		retval = arm7_9->bulk_read_memory(target, address, count, buffer);
+
+		if (retval == ERROR_OK)
+			return ERROR_OK;
+	}
+
+	return arm7_9_read_memory(target, address, size, count, buffer);
+}
+
 /**
  * Perform per-target setup that requires JTAG access.
  */
@@ -2881,7 +3054,7 @@ static const struct command_registration arm7_9_any_command_handlers[] = {
 		.handler = handle_arm7_9_dcc_downloads_command,
 		.mode = COMMAND_ANY,
 		.usage = "['enable'|'disable']",
-		.help = "use DCC downloads for larger memory writes",
+		.help = "use DCC transfers for larger memory writes and reads",
 	},
 	COMMAND_REGISTRATION_DONE
 };
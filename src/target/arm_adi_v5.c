@@ -111,17 +111,61 @@ static int mem_ap_setup_csw(struct adiv5_ap *ap, uint32_t csw)
 
 static int mem_ap_setup_tar(struct adiv5_ap *ap, uint32_t tar)
 {
-	if (tar != ap->tar_value ||
-			(ap->csw_value & CSW_ADDRINC_MASK)) {
+	if (tar != ap->tar_value || !ap->tar_valid) {
 		/* LOG_DEBUG("DAP: Set TAR %x",tar); */
 		int retval = dap_queue_ap_write(ap, MEM_AP_REG_TAR, tar);
-		if (retval != ERROR_OK)
+		if (retval != ERROR_OK) {
+			ap->tar_valid = false;
 			return retval;
+		}
 		ap->tar_value = tar;
+		ap->tar_valid = true;
 	}
 	return ERROR_OK;
 }
 
+/**
+ * Follow the TAR auto-increment done by the MEM-AP after a DRW access, so
+ * that an access to the next address does not have to write TAR again.
+ * Crossing the end of the auto-increment block drops the cached value, as
+ * the MEM-AP behaviour is implementation defined there.
+ */
+static void mem_ap_update_tar_cache(struct adiv5_ap *ap)
+{
+	uint32_t tar = ap->tar_value;
+
+	if (!ap->tar_valid)
+		return;
+
+	switch (ap->csw_value & CSW_ADDRINC_MASK) {
+	case CSW_ADDRINC_SINGLE:
+		ap->tar_value += 1 << (ap->csw_value & CSW_SIZE_MASK);
+		break;
+	case CSW_ADDRINC_PACKED:
+		ap->tar_value += 4;
+		break;
+	default:
+		return;
+	}
+
+	if (tar / ap->tar_autoincr_block != ap->tar_value / ap->tar_autoincr_block)
+		ap->tar_valid = false;
+}
+
+/**
+ * Check whether a 32-bit access to @a address can go through DRW using
+ * the CSW and TAR values the MEM-AP already holds, i.e. it continues an
+ * auto-incrementing run left by the previous accesses.
+ */
+static bool mem_ap_continues_run(struct adiv5_ap *ap, uint32_t address)
+{
+	uint32_t csw = ap->csw_value & (CSW_SIZE_MASK | CSW_ADDRINC_MASK);
+
+	return ap->tar_valid && ap->tar_value == address &&
+		(csw == (CSW_32BIT | CSW_ADDRINC_SINGLE) ||
+		 csw == (CSW_32BIT | CSW_ADDRINC_PACKED));
+}
+
 /**
  * Queue transactions setting up transfer parameters for the
  * currently selected MEM-AP.
@@ -167,6 +211,19 @@ int mem_ap_read_u32(struct adiv5_ap *ap, uint32_t address,
 {
 	int retval;
 
+	/* Words following an auto-incrementing access need neither CSW nor
+	 * TAR to be written.
+	 */
+	if (mem_ap_continues_run(ap, address)) {
+		retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW, value);
+		if (retval != ERROR_OK) {
+			ap->tar_valid = false;
+			return retval;
+		}
+		mem_ap_update_tar_cache(ap);
+		return ERROR_OK;
+	}
+
 	/* Use banked addressing (REG_BDx) to avoid some link traffic
 	 * (updating TAR) when reading several consecutive addresses.
 	 */
@@ -218,6 +275,19 @@ int mem_ap_write_u32(struct adiv5_ap *ap, uint32_t address,
 {
 	int retval;
 
+	/* Words following an auto-incrementing access need neither CSW nor
+	 * TAR to be written.
+	 */
+	if (mem_ap_continues_run(ap, address)) {
+		retval = dap_queue_ap_write(ap, MEM_AP_REG_DRW, value);
+		if (retval != ERROR_OK) {
+			ap->tar_valid = false;
+			return retval;
+		}
+		mem_ap_update_tar_cache(ap);
+		return ERROR_OK;
+	}
+
 	/* Use banked addressing (REG_BDx) to avoid some link traffic
 	 * (updating TAR) when writing several consecutive addresses.
 	 */
@@ -358,6 +428,7 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 		retval = dap_queue_ap_write(ap, MEM_AP_REG_DRW, outvalue);
 		if (retval != ERROR_OK)
 			break;
+		mem_ap_update_tar_cache(ap);
 
 		/* Rewrite TAR if it wrapped or we're xoring addresses */
 		if (addrinc && (addr_xor || (address % ap->tar_autoincr_block < size && nbytes > 0))) {
@@ -373,6 +444,7 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 
 	if (retval != ERROR_OK) {
 		uint32_t tar;
+		ap->tar_valid = false;
 		if (dap_queue_ap_read(ap, MEM_AP_REG_TAR, &tar) == ERROR_OK
 				&& dap_run(dap) == ERROR_OK)
 			LOG_ERROR("Failed to write memory at 0x%08"PRIx32, tar);
@@ -460,6 +532,7 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 		retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW, read_ptr++);
 		if (retval != ERROR_OK)
 			break;
+		mem_ap_update_tar_cache(ap);
 
 		nbytes -= this_size;
 		address += this_size;
@@ -484,6 +557,7 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 	 * at least give the caller what we have. */
 	if (retval != ERROR_OK) {
 		uint32_t tar;
+		ap->tar_valid = false;
 		if (dap_queue_ap_read(ap, MEM_AP_REG_TAR, &tar) == ERROR_OK
 				&& dap_run(dap) == ERROR_OK) {
 			LOG_ERROR("Failed to read memory at 0x%08"PRIx32, tar);
@@ -587,6 +661,7 @@ struct adiv5_dap *dap_init(void)
 		dap->ap[i].tar_autoincr_block = (1<<10);
 	}
 	INIT_LIST_HEAD(&dap->cmd_journal);
+	INIT_LIST_HEAD(&dap->cmd_pool);
 	return dap;
 }
 
@@ -611,6 +686,7 @@ int dap_dp_init(struct adiv5_dap *dap)
 
 	dap->select = DP_SELECT_INVALID;
 	dap->last_read = NULL;
+	dap_invalidate_tar_cache(dap);
 
 	for (size_t i = 0; i < 10; i++) {
 		/* DP initialization */
@@ -818,26 +894,81 @@ int dap_get_debugbase(struct adiv5_ap *ap,
 	return ERROR_OK;
 }
 
+/* ROM table entries live below this offset, the rest of the 4K page holds
+ * the identification registers */
+#define ROM_TABLE_END	0xF00
+
+/* number of ROM table entries queued before each DAP run */
+#define ROM_TABLE_BATCH	16
+
+/**
+ * Read a batch of ROM table entries in a single DAP run.
+ *
+ * @param ap The MEM-AP holding the ROM table.
+ * @param base_addr Base address of the ROM table.
+ * @param entry_offset Offset of the first entry to read.
+ * @param entries Receives ROM_TABLE_BATCH entries, fewer at the end of the table.
+ * @param count Receives the number of entries read.
+ *
+ * @return ERROR_OK for success.  Otherwise a fault code.
+ */
+static int dap_read_rom_entries(struct adiv5_ap *ap, uint32_t base_addr,
+		uint32_t entry_offset, uint32_t *entries, unsigned *count)
+{
+	unsigned n = (ROM_TABLE_END - entry_offset) / 4;
+	int retval;
+
+	if (n > ROM_TABLE_BATCH)
+		n = ROM_TABLE_BATCH;
+
+	for (unsigned i = 0; i < n; i++) {
+		retval = mem_ap_read_u32(ap, base_addr | (entry_offset + 4 * i), &entries[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	retval = dap_run(ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	*count = n;
+	return ERROR_OK;
+}
+
 int dap_lookup_cs_component(struct adiv5_ap *ap,
 			uint32_t dbgbase, uint8_t type, uint32_t *addr, int32_t *idx)
 {
-	uint32_t romentry, entry_offset = 0, component_base, devtype;
+	uint32_t entries[ROM_TABLE_BATCH];
+	uint32_t base_addr = dbgbase & 0xFFFFF000;
+	uint32_t romentry, component_base, devtype;
+	unsigned count = 0, i = 0;
 	int retval;
 
 	*addr = 0;
 
-	do {
-		retval = mem_ap_read_atomic_u32(ap, (dbgbase&0xFFFFF000) |
-						entry_offset, &romentry);
-		if (retval != ERROR_OK)
-			return retval;
+	for (uint32_t entry_offset = 0; entry_offset < ROM_TABLE_END; entry_offset += 4) {
+		if (i == count) {
+			retval = dap_read_rom_entries(ap, base_addr, entry_offset, entries, &count);
+			if (retval != ERROR_OK)
+				return retval;
+			i = 0;
+		}
+
+		romentry = entries[i++];
+		if (romentry == 0)
+			break;
 
-		component_base = (dbgbase & 0xFFFFF000)
-			+ (romentry & 0xFFFFF000);
+		component_base = base_addr + (romentry & 0xFFFFF000);
 
 		if (romentry & 0x1) {
 			uint32_t c_cid1;
-			retval = mem_ap_read_atomic_u32(ap, component_base | 0xff4, &c_cid1);
+			/* fetch both registers in one run, devtype is only
+			 * needed if this is not a nested ROM table */
+			retval = mem_ap_read_u32(ap, component_base | 0xff4, &c_cid1);
+			if (retval == ERROR_OK)
+				retval = mem_ap_read_u32(ap, component_base | 0xfcc, &devtype);
+			if (retval == ERROR_OK)
+				retval = dap_run(ap->dap);
 			if (retval != ERROR_OK) {
 				LOG_ERROR("Can't read component with base address 0x%" PRIx32
 					  ", the corresponding core might be turned off", component_base);
@@ -852,11 +983,6 @@ int dap_lookup_cs_component(struct adiv5_ap *ap,
 					return retval;
 			}
 
-			retval = mem_ap_read_atomic_u32(ap,
-					(component_base & 0xfffff000) | 0xfcc,
-					&devtype);
-			if (retval != ERROR_OK)
-				return retval;
 			if ((devtype & 0xff) == type) {
 				if (!*idx) {
 					*addr = component_base;
@@ -865,8 +991,7 @@ int dap_lookup_cs_component(struct adiv5_ap *ap,
 					(*idx)--;
 			}
 		}
-		entry_offset += 4;
-	} while (romentry > 0);
+	}
 
 	if (!*addr)
 		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
@@ -1134,11 +1259,16 @@ static int dap_rom_display(struct command_context *cmd_ctx,
 			command_print(cmd_ctx, "\t\tMEMTYPE system memory not present: dedicated debug bus");
 
 		/* Read ROM table entries from base address until we get 0x00000000 or reach the reserved area */
-		for (uint16_t entry_offset = 0; entry_offset < 0xF00; entry_offset += 4) {
-			uint32_t romentry;
-			retval = mem_ap_read_atomic_u32(ap, base_addr | entry_offset, &romentry);
-			if (retval != ERROR_OK)
-				return retval;
+		uint32_t entries[ROM_TABLE_BATCH];
+		unsigned count = 0, i = 0;
+		for (uint16_t entry_offset = 0; entry_offset < ROM_TABLE_END; entry_offset += 4) {
+			if (i == count) {
+				retval = dap_read_rom_entries(ap, base_addr, entry_offset, entries, &count);
+				if (retval != ERROR_OK)
+					return retval;
+				i = 0;
+			}
+			uint32_t romentry = entries[i++];
 			command_print(cmd_ctx, "\t%sROMTABLE[0x%x] = 0x%" PRIx32 "",
 					tabs, entry_offset, romentry);
 			if (romentry & 0x01) {
@@ -1438,6 +1568,8 @@ COMMAND_HANDLER(dap_memaccess_command)
 		break;
 	case 1:
 		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], memaccess_tck);
+		/* start adapting again from the new value */
+		dap->ap[dap->apsel].memaccess_tck_extra = 0;
 		break;
 	default:
 		return ERROR_COMMAND_SYNTAX_ERROR;
@@ -1450,6 +1582,38 @@ COMMAND_HANDLER(dap_memaccess_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(dap_perf_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct arm *arm = target_to_arm(target);
+	struct adiv5_dap *dap = arm->dap;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		memset(&dap->perf, 0, sizeof(dap->perf));
+		return ERROR_OK;
+	} else if (CMD_ARGC != 0) {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	command_print(CMD_CTX, "transactions %" PRIu64 ", runs %" PRIu64
+			", WAIT stalls %" PRIu64 ", replayed scans %" PRIu64,
+			dap->perf.transactions, dap->perf.runs,
+			dap->perf.waits, dap->perf.replays);
+
+	for (unsigned i = 0; i < ARRAY_SIZE(dap->ap); i++) {
+		struct adiv5_ap *ap = &dap->ap[i];
+		if (ap->memaccess_tck_extra == 0)
+			continue;
+		command_print(CMD_CTX, "ap %u: memory bus access delay %" PRIu32
+				" + %" PRIu32 " tck (adapted)",
+				i, ap->memaccess_tck, ap->memaccess_tck_extra);
+	}
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(dap_apsel_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -1583,6 +1747,8 @@ COMMAND_HANDLER(dap_apreg_command)
 	} else {
 		retval = dap_queue_ap_read(dap_ap(dap, apsel), reg, &value);
 	}
+	/* a raw access may move TAR behind the cache's back */
+	dap_ap(dap, apsel)->tar_valid = false;
 	if (retval == ERROR_OK)
 		retval = dap_run(dap);
 
@@ -1621,6 +1787,35 @@ COMMAND_HANDLER(dap_ti_be_32_quirks_command)
 	return 0;
 }
 
+COMMAND_HANDLER(dap_targetsel_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct arm *arm = target_to_arm(target);
+	struct adiv5_dap *dap = arm->dap;
+
+	switch (CMD_ARGC) {
+	case 0:
+		break;
+	case 1:
+		if (strcmp(CMD_ARGV[0], "none") == 0) {
+			dap->multidrop = false;
+		} else {
+			COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], dap->targetsel);
+			dap->multidrop = true;
+		}
+		break;
+	default:
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	if (dap->multidrop)
+		command_print(CMD_CTX, "SWD multidrop TARGETSEL 0x%08" PRIx32, dap->targetsel);
+	else
+		command_print(CMD_CTX, "SWD multidrop disabled");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration dap_commands[] = {
 	{
 		.name = "info",
@@ -1678,6 +1873,21 @@ static const struct command_registration dap_commands[] = {
 			"bus access [0-255]",
 		.usage = "[cycles]",
 	},
+	{
+		.name = "perf",
+		.handler = dap_perf_command,
+		.mode = COMMAND_EXEC,
+		.help = "display or reset JTAG-DP transaction statistics "
+			"and adapted memory bus access delays",
+		.usage = "['reset']",
+	},
+	{
+		.name = "targetsel",
+		.handler = dap_targetsel_command,
+		.mode = COMMAND_CONFIG,
+		.help = "set/get the SWD multidrop TARGETSEL value of this DAP",
+		.usage = "[value|'none']",
+	},
 	{
 		.name = "ti_be_32_quirks",
 		.handler = dap_ti_be_32_quirks_command,
@@ -105,6 +105,7 @@
 #define CSW_8BIT		0
 #define CSW_16BIT		1
 #define CSW_32BIT		2
+#define CSW_SIZE_MASK		7
 #define CSW_ADDRINC_MASK    (3UL << 4)
 #define CSW_ADDRINC_OFF     0UL
 #define CSW_ADDRINC_SINGLE  (1UL << 4)
@@ -161,11 +162,17 @@ struct adiv5_ap {
 
 	/**
 	 * Cache for (MEM-AP) AP_REG_TAR register value This is written to
-	 * configure the address being read or written
-	 * "-1" indicates no cached value.
+	 * configure the address being read or written. It follows the
+	 * auto-increment done by DRW accesses and is only meaningful while
+	 * tar_valid is set.
 	 */
 	uint32_t tar_value;
 
+	/**
+	 * true if tar_value is known to match the AP_REG_TAR register.
+	 */
+	bool tar_valid;
+
 	/**
 	 * Configures how many extra tck clocks are added after starting a
 	 * MEM-AP access before we try to read its status (and/or result).
@@ -180,6 +187,11 @@ struct adiv5_ap {
 
 	/* true if unaligned memory access is not supported by the MEM-AP */
 	bool unaligned_access_bad;
+
+	/* Idle cycles added on top of memaccess_tck by the JTAG-DP after WAIT
+	 * responses, and the number of WAIT free runs since the last change */
+	uint32_t memaccess_tck_extra;
+	uint32_t wait_free_runs;
 };
 
 
@@ -205,6 +217,17 @@ struct adiv5_dap {
 	/* dap transaction list for WAIT support */
 	struct list_head cmd_journal;
 
+	/* free dap transaction entries, reused by the JTAG-DP journal */
+	struct list_head cmd_pool;
+
+	/* JTAG-DP transaction statistics, see "dap perf" */
+	struct {
+		uint64_t transactions;
+		uint64_t runs;
+		uint64_t waits;
+		uint64_t replays;
+	} perf;
+
 	struct jtag_tap *tap;
 	/* Control config */
 	uint32_t dp_ctrl_stat;
@@ -240,6 +263,13 @@ struct adiv5_dap {
 	 * should be performed before the next access.
 	 */
 	bool do_reconnect;
+
+	/**
+	 * SWD multidrop (DPv2): when set, the DP shares its SWD bus with other
+	 * DPs and is selected by writing targetsel to TARGETSEL.
+	 */
+	bool multidrop;
+	uint32_t targetsel;
 };
 
 /**
@@ -390,10 +420,23 @@ static inline int dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
  *
  * @return ERROR_OK for success, else a fault code.
  */
+/**
+ * Forget the cached TAR of all APs. Used once a transaction failed, as the
+ * MEM-AP may not have incremented TAR for the accesses that were dropped.
+ */
+static inline void dap_invalidate_tar_cache(struct adiv5_dap *dap)
+{
+	for (int i = 0; i <= 255; i++)
+		dap->ap[i].tar_valid = false;
+}
+
 static inline int dap_run(struct adiv5_dap *dap)
 {
 	assert(dap->ops != NULL);
-	return dap->ops->run(dap);
+	int retval = dap->ops->run(dap);
+	if (retval != ERROR_OK)
+		dap_invalidate_tar_cache(dap);
+	return retval;
 }
 
 static inline int dap_sync(struct adiv5_dap *dap)
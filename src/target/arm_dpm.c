@@ -228,6 +228,67 @@ static int dpm_write_reg(struct arm_dpm *dpm, struct reg *r, unsigned regnum)
 	return retval;
 }
 
+/* at most R0..R14 go through DCC in one batch */
+#define DPM_DCC_BATCH	15
+
+/* just read registers R0..R14 in one queued sequence, if the DPM supports it */
+static int dpm_read_regs_dcc(struct arm_dpm *dpm, struct reg **regs,
+	const unsigned *regnum, unsigned count)
+{
+	uint32_t opcodes[DPM_DCC_BATCH];
+	uint32_t values[DPM_DCC_BATCH];
+	int retval;
+
+	if (count == 0)
+		return ERROR_OK;
+
+	/* return via DCC:  "MCR p14, 0, Rnum, c0, c5, 0" */
+	for (unsigned i = 0; i < count; i++)
+		opcodes[i] = ARMV4_5_MCR(14, 0, regnum[i], 0, 5, 0);
+
+	retval = dpm->instr_read_data_dcc_array(dpm, opcodes, values, count);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned i = 0; i < count; i++) {
+		buf_set_u32(regs[i]->value, 0, 32, values[i]);
+		regs[i]->valid = true;
+		regs[i]->dirty = false;
+		LOG_DEBUG("READ: %s, %8.8x", regs[i]->name, (unsigned) values[i]);
+	}
+
+	return ERROR_OK;
+}
+
+/* just write registers R0..R14 in one queued sequence, if the DPM supports it */
+static int dpm_write_regs_dcc(struct arm_dpm *dpm, struct reg **regs,
+	const unsigned *regnum, unsigned count)
+{
+	uint32_t opcodes[DPM_DCC_BATCH];
+	uint32_t values[DPM_DCC_BATCH];
+	int retval;
+
+	if (count == 0)
+		return ERROR_OK;
+
+	/* load register from DCC:  "MRC p14, 0, Rnum, c0, c5, 0" */
+	for (unsigned i = 0; i < count; i++) {
+		opcodes[i] = ARMV4_5_MRC(14, 0, regnum[i], 0, 5, 0);
+		values[i] = buf_get_u32(regs[i]->value, 0, 32);
+	}
+
+	retval = dpm->instr_write_data_dcc_array(dpm, opcodes, values, count);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned i = 0; i < count; i++) {
+		regs[i]->dirty = false;
+		LOG_DEBUG("WRITE: %s, %8.8x", regs[i]->name, (unsigned) values[i]);
+	}
+
+	return ERROR_OK;
+}
+
 /**
  * Read basic registers of the the current context:  R0 to R15, and CPSR;
  * sets the core mode (such as USR or IRQ) and state (such as ARM or Thumb).
@@ -262,17 +323,33 @@ int arm_dpm_read_current_registers(struct arm_dpm *dpm)
 	/* update core mode and state, plus shadow mapping for R8..R14 */
 	arm_set_cpsr(arm, cpsr);
 
-	/* REVISIT we can probably avoid reading R1..R14, saving time... */
+	/* REVISIT we can probably avoid reading R1..R14, saving time...
+	 * at least read them all in one go when the DPM can queue that.
+	 */
+	struct reg *batch[DPM_DCC_BATCH];
+	unsigned batch_num[DPM_DCC_BATCH];
+	unsigned count = 0;
+
 	for (unsigned i = 1; i < 16; i++) {
 		r = arm_reg_current(arm, i);
 		if (r->valid)
 			continue;
 
+		if (i < 15 && dpm->instr_read_data_dcc_array) {
+			batch[count] = r;
+			batch_num[count++] = i;
+			continue;
+		}
+
 		retval = dpm_read_reg(dpm, r, i);
 		if (retval != ERROR_OK)
 			goto fail;
 	}
 
+	retval = dpm_read_regs_dcc(dpm, batch, batch_num, count);
+	if (retval != ERROR_OK)
+		goto fail;
+
 	/* NOTE: SPSR ignored (if it's even relevant). */
 
 	/* REVISIT the debugger can trigger various exceptions.  See the
@@ -393,6 +470,9 @@ int arm_dpm_write_dirty_registers(struct arm_dpm *dpm, bool bpwp)
 	 */
 	do {
 		enum arm_mode mode = ARM_MODE_ANY;
+		struct reg *batch[DPM_DCC_BATCH];
+		unsigned batch_num[DPM_DCC_BATCH];
+		unsigned count = 0;
 
 		did_write = false;
 
@@ -447,6 +527,20 @@ int arm_dpm_write_dirty_registers(struct arm_dpm *dpm, bool bpwp)
 			if (r->mode != mode)
 				continue;
 
+			/* R1..R14 of this mode can be queued together */
+			if (regnum < 15 && dpm->instr_write_data_dcc_array) {
+				if (count == DPM_DCC_BATCH) {
+					retval = dpm_write_regs_dcc(dpm, batch,
+							batch_num, count);
+					if (retval != ERROR_OK)
+						goto done;
+					count = 0;
+				}
+				batch[count] = &cache->reg_list[i];
+				batch_num[count++] = regnum;
+				continue;
+			}
+
 			retval = dpm_write_reg(dpm,
 					&cache->reg_list[i],
 					regnum);
@@ -454,6 +548,11 @@ int arm_dpm_write_dirty_registers(struct arm_dpm *dpm, bool bpwp)
 				goto done;
 		}
 
+		/* flush them before switching to another mode */
+		retval = dpm_write_regs_dcc(dpm, batch, batch_num, count);
+		if (retval != ERROR_OK)
+			goto done;
+
 	} while (did_write);
 
 	/* Restore original CPSR ... assuming either that we changed it,
@@ -77,6 +77,23 @@ struct arm_dpm {
 	int (*instr_write_data_r0)(struct arm_dpm *,
 			uint32_t opcode, uint32_t data);
 
+	/**
+	 * Optional: runs one instruction once for each of count data words,
+	 * each written to R0 before execution.  Lets a core queue a long
+	 * sequence of cache maintenance operations and check for completion
+	 * only once at the end.
+	 */
+	int (*instr_write_data_r0_array)(struct arm_dpm *,
+			uint32_t opcode, const uint32_t *data, unsigned count);
+
+	/**
+	 * Optional: runs count instructions, each writing data[i] to DCC
+	 * before executing opcode[i], as one queued sequence.  Used to load
+	 * whole sets of core registers without a round trip per register.
+	 */
+	int (*instr_write_data_dcc_array)(struct arm_dpm *,
+			const uint32_t *opcode, const uint32_t *data, unsigned count);
+
 	/** Optional core-specific operation invoked after CPSR writes. */
 	int (*instr_cpsr_sync)(struct arm_dpm *dpm);
 
@@ -90,6 +107,14 @@ struct arm_dpm {
 	int (*instr_read_data_r0)(struct arm_dpm *,
 			uint32_t opcode, uint32_t *data);
 
+	/**
+	 * Optional: runs count instructions, reading data[i] from DCC after
+	 * executing opcode[i], as one queued sequence.  Used to save whole
+	 * sets of core registers without a round trip per register.
+	 */
+	int (*instr_read_data_dcc_array)(struct arm_dpm *,
+			const uint32_t *opcode, uint32_t *data, unsigned count);
+
 	/* BREAKPOINT/WATCHPOINT SUPPORT */
 
 	/**
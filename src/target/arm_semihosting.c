@@ -46,6 +46,11 @@
 #include <helper/log.h>
 #include <sys/stat.h>
 
+/* SYS_WRITE0 strings are read in aligned blocks of this many bytes */
+#define SEMIHOSTING_WRITE0_BLOCK	64
+/* SYS_WRITE and SYS_READ transfers up to this size don't use the heap */
+#define SEMIHOSTING_SMALL_BUF		256
+
 static const int open_modeflags[12] = {
 	O_RDONLY,
 	O_RDONLY | O_BINARY,
@@ -136,13 +141,20 @@ static int do_semihosting(struct target *target)
 
 	case 0x04:	/* SYS_WRITE0 */
 		do {
-			unsigned char c;
-			retval = target_read_memory(target, r1++, 1, 1, &c);
+			/* read up to the next aligned block, so we never read
+			 * past the page or region the string ends in */
+			uint8_t buf[SEMIHOSTING_WRITE0_BLOCK];
+			uint32_t len = SEMIHOSTING_WRITE0_BLOCK - (r1 % SEMIHOSTING_WRITE0_BLOCK);
+			uint8_t *end;
+
+			retval = target_read_buffer(target, r1, len, buf);
 			if (retval != ERROR_OK)
 				return retval;
-			if (!c)
+			end = memchr(buf, 0, len);
+			fwrite(buf, 1, end ? (size_t)(end - buf) : len, stdout);
+			if (end)
 				break;
-			putchar(c);
+			r1 += len;
 		} while (1);
 		result = 0;
 		break;
@@ -155,21 +167,24 @@ static int do_semihosting(struct target *target)
 			int fd = target_buffer_get_u32(target, params+0);
 			uint32_t a = target_buffer_get_u32(target, params+4);
 			size_t l = target_buffer_get_u32(target, params+8);
-			uint8_t *buf = malloc(l);
+			uint8_t small_buf[SEMIHOSTING_SMALL_BUF];
+			uint8_t *buf = l <= sizeof(small_buf) ? small_buf : malloc(l);
 			if (!buf) {
 				result = -1;
 				arm->semihosting_errno = ENOMEM;
 			} else {
 				retval = target_read_buffer(target, a, l, buf);
 				if (retval != ERROR_OK) {
-					free(buf);
+					if (buf != small_buf)
+						free(buf);
 					return retval;
 				}
 				result = write(fd, buf, l);
 				arm->semihosting_errno = errno;
 				if (result >= 0)
 					result = l - result;
-				free(buf);
+				if (buf != small_buf)
+					free(buf);
 			}
 		}
 		break;
@@ -182,7 +197,8 @@ static int do_semihosting(struct target *target)
 			int fd = target_buffer_get_u32(target, params+0);
 			uint32_t a = target_buffer_get_u32(target, params+4);
 			ssize_t l = target_buffer_get_u32(target, params+8);
-			uint8_t *buf = malloc(l);
+			uint8_t small_buf[SEMIHOSTING_SMALL_BUF];
+			uint8_t *buf = l <= (ssize_t)sizeof(small_buf) ? small_buf : malloc(l);
 			if (!buf) {
 				result = -1;
 				arm->semihosting_errno = ENOMEM;
@@ -192,12 +208,14 @@ static int do_semihosting(struct target *target)
 				if (result >= 0) {
 					retval = target_write_buffer(target, a, result, buf);
 					if (retval != ERROR_OK) {
-						free(buf);
+						if (buf != small_buf)
+							free(buf);
 						return retval;
 					}
 					result = l - result;
 				}
-				free(buf);
+				if (buf != small_buf)
+					free(buf);
 			}
 		}
 		break;
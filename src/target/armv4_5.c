@@ -579,6 +579,13 @@ static const struct reg_arch_type arm_reg_type = {
 	.set = armv4_5_set_core_reg,
 };
 
+/* shared by the registers of all ARM caches */
+static struct reg_data_type arm_reg_data_ptr = { .type = REG_TYPE_DATA_PTR };
+static struct reg_data_type arm_reg_code_ptr = { .type = REG_TYPE_CODE_PTR };
+static struct reg_data_type arm_reg_uint32 = { .type = REG_TYPE_UINT32 };
+static struct reg_feature arm_core_feature = { .name = "org.gnu.gdb.arm.core" };
+static struct reg_feature arm_banked_feature = { .name = "net.sourceforge.openocd.banked" };
+
 struct reg_cache *arm_build_reg_cache(struct target *target, struct arm *arm)
 {
 	int num_regs = ARRAY_SIZE(arm_core_regs);
@@ -624,27 +631,25 @@ struct reg_cache *arm_build_reg_cache(struct target *target, struct arm *arm)
 		reg_list[i].caller_save = false;
 
 		/* Registers data type, as used by GDB target description */
-		reg_list[i].reg_data_type = malloc(sizeof(struct reg_data_type));
 		switch (arm_core_regs[i].cookie) {
 		case 13:
-			reg_list[i].reg_data_type->type = REG_TYPE_DATA_PTR;
+			reg_list[i].reg_data_type = &arm_reg_data_ptr;
 			break;
 		case 14:
 		case 15:
-			reg_list[i].reg_data_type->type = REG_TYPE_CODE_PTR;
+			reg_list[i].reg_data_type = &arm_reg_code_ptr;
 		    break;
 		default:
-			reg_list[i].reg_data_type->type = REG_TYPE_UINT32;
+			reg_list[i].reg_data_type = &arm_reg_uint32;
 		    break;
 		}
 
 		/* let GDB shows banked registers only in "info all-reg" */
-		reg_list[i].feature = malloc(sizeof(struct reg_feature));
 		if (reg_list[i].number <= 15 || reg_list[i].number == 25) {
-			reg_list[i].feature->name = "org.gnu.gdb.arm.core";
+			reg_list[i].feature = &arm_core_feature;
 			reg_list[i].group = "general";
 		} else {
-			reg_list[i].feature->name = "net.sourceforge.openocd.banked";
+			reg_list[i].feature = &arm_banked_feature;
 			reg_list[i].group = "banked";
 		}
 
@@ -1479,6 +1484,83 @@ cleanup:
 	return retval;
 }
 
+/**
+ * Runs ARM code in the target to fill a word aligned memory block with
+ * a 32-bit pattern.
+ */
+int arm_fill_memory(struct target *target,
+	uint32_t address, uint32_t count, uint32_t pattern)
+{
+	struct working_area *fill_algorithm;
+	struct arm_algorithm arm_algo;
+	struct arm *arm = target_to_arm(target);
+	struct reg_param reg_params[3];
+	int retval;
+	uint32_t i;
+	uint32_t exit_var = 0;
+
+	static const uint8_t arm_fill_code_le[] = {
+#include "../../contrib/loaders/fill/armv4_5_fill.inc"
+	};
+
+	assert(sizeof(arm_fill_code_le) % 4 == 0);
+
+	retval = target_alloc_working_area(target,
+			sizeof(arm_fill_code_le), &fill_algorithm);
+	if (retval != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* the code must not overwrite itself */
+	if (fill_algorithm->address < address + count &&
+			address < fill_algorithm->address + fill_algorithm->size) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup;
+	}
+
+	/* convert code into a buffer in target endianness */
+	for (i = 0; i < ARRAY_SIZE(arm_fill_code_le) / 4; i++) {
+		retval = target_write_u32(target,
+				fill_algorithm->address + i * sizeof(uint32_t),
+				le_to_h_u32(&arm_fill_code_le[i * 4]));
+		if (retval != ERROR_OK)
+			goto cleanup;
+	}
+
+	arm_algo.common_magic = ARM_COMMON_MAGIC;
+	arm_algo.core_mode = ARM_MODE_SVC;
+	arm_algo.core_state = ARM_STATE_ARM;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, address);
+	buf_set_u32(reg_params[1].value, 0, 32, count);
+	buf_set_u32(reg_params[2].value, 0, 32, pattern);
+
+	int timeout = 10000 * (1 + (count / (16 * 1024 * 1024)));
+
+	/* armv4 must exit using a hardware breakpoint */
+	if (arm->is_armv4)
+		exit_var = fill_algorithm->address + sizeof(arm_fill_code_le) - 4;
+
+	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
+			fill_algorithm->address,
+			exit_var,
+			timeout, &arm_algo);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error executing ARM fill algorithm");
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+
+cleanup:
+	target_free_working_area(target, fill_algorithm);
+
+	return retval;
+}
+
 /**
  * Runs ARM code in the target to check whether a memory block holds
  * all ones.  NOR flash which has been erased, and thus may be written,
@@ -23,18 +23,52 @@
 #include <helper/log.h>
 #include "target.h"
 #include "armv4_5_mmu.h"
+#include "mmu_tlb.h"
+
+/* caches the mapping of a second level descriptor; page_va is the first
+ * address the descriptor covers, shift is 12 in coarse, 10 in fine tables */
+static void armv4_5_mmu_tlb_add(struct target *target, uint32_t ttb,
+		uint32_t page_va, unsigned shift, uint32_t descriptor)
+{
+	uint32_t size;
+
+	switch (descriptor & 0x3) {
+		case 1:
+			size = 0x10000;
+			break;
+		case 2:
+			size = 0x1000;
+			break;
+		case 3:
+			/* a tiny page fills its slot only in fine tables */
+			if (shift != 10)
+				return;
+			size = 0x400;
+			break;
+		default:
+			return;
+	}
+
+	mmu_tlb_add(target, ttb, 0, page_va, size, descriptor & ~(size - 1),
+			(descriptor & 0xc) >> 2);
+}
 
 int armv4_5_mmu_translate_va(struct target *target,
 		struct armv4_5_mmu_common *armv4_5_mmu, uint32_t va, uint32_t *cb, uint32_t *val)
 {
 	uint32_t first_lvl_descriptor = 0x0;
-	uint32_t second_lvl_descriptor = 0x0;
-	uint32_t ttb;
+	uint32_t second_lvl_descriptor;
+	uint8_t descriptors[4 * MMU_TLB_PREFETCH];
+	uint32_t ttb, table;
+	unsigned shift, index;
 	int retval;
 	retval = armv4_5_mmu->get_ttb(target, &ttb);
 	if (retval != ERROR_OK)
 		return retval;
 
+	if (mmu_tlb_lookup(target, ttb, 0, va, val, cb))
+		return ERROR_OK;
+
 	retval = armv4_5_mmu_read_physical(target, armv4_5_mmu,
 		(ttb & 0xffffc000) | ((va & 0xfff00000) >> 18),
 		4, 1, (uint8_t *)&first_lvl_descriptor);
@@ -58,26 +92,34 @@ int armv4_5_mmu_translate_va(struct target *target,
 		/* section descriptor */
 		*cb = (first_lvl_descriptor & 0xc) >> 2;
 		*val = (first_lvl_descriptor & 0xfff00000) | (va & 0x000fffff);
+		mmu_tlb_add(target, ttb, 0, va, 0x100000, first_lvl_descriptor, *cb);
 		return ERROR_OK;
 	}
 
 	if ((first_lvl_descriptor & 0x3) == 1) {
 		/* coarse page table */
-		retval = armv4_5_mmu_read_physical(target, armv4_5_mmu,
-			(first_lvl_descriptor & 0xfffffc00) | ((va & 0x000ff000) >> 10),
-			4, 1, (uint8_t *)&second_lvl_descriptor);
-		if (retval != ERROR_OK)
-			return retval;
-	} else if ((first_lvl_descriptor & 0x3) == 3) {
+		table = first_lvl_descriptor & 0xfffffc00;
+		shift = 12;
+	} else {
 		/* fine page table */
-		retval = armv4_5_mmu_read_physical(target, armv4_5_mmu,
-			(first_lvl_descriptor & 0xfffff000) | ((va & 0x000ffc00) >> 8),
-			4, 1, (uint8_t *)&second_lvl_descriptor);
-		if (retval != ERROR_OK)
-			return retval;
+		table = first_lvl_descriptor & 0xfffff000;
+		shift = 10;
 	}
 
-	second_lvl_descriptor = target_buffer_get_u32(target, (uint8_t *)&second_lvl_descriptor);
+	/* fetch the descriptors of the neighbouring pages with the same
+	 * access, the next translations are likely to need them */
+	index = ((va & 0x000fffff) >> shift) & ~(MMU_TLB_PREFETCH - 1);
+	retval = armv4_5_mmu_read_physical(target, armv4_5_mmu, table + 4 * index,
+		4, MMU_TLB_PREFETCH, descriptors);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned i = 0; i < MMU_TLB_PREFETCH; i++)
+		armv4_5_mmu_tlb_add(target, ttb, (va & 0xfff00000) | ((index + i) << shift),
+			shift, target_buffer_get_u32(target, descriptors + 4 * i));
+
+	second_lvl_descriptor = target_buffer_get_u32(target,
+		descriptors + 4 * (((va & 0x000fffff) >> shift) - index));
 
 	LOG_DEBUG("2nd lvl desc: %8.8" PRIx32 "", second_lvl_descriptor);
 
@@ -37,6 +37,7 @@
 #include "arm_opcodes.h"
 #include "target.h"
 #include "target_type.h"
+#include "mmu_tlb.h"
 
 static void armv7a_show_fault_registers(struct target *target)
 {
@@ -175,11 +176,30 @@ done:
 	return retval;
 }
 
+/* caches the mapping of a second level descriptor covering page_va */
+static void armv7a_mmu_tlb_add(struct target *target, uint32_t ttb,
+		uint32_t asid, uint32_t page_va, uint32_t descriptor)
+{
+	switch (descriptor & 0x3) {
+		case 0:
+			break;
+		case 1:
+			/* large page */
+			mmu_tlb_add(target, ttb, asid, page_va, 0x10000, descriptor, 0);
+			break;
+		default:
+			/* small page */
+			mmu_tlb_add(target, ttb, asid, page_va, 0x1000, descriptor, 0);
+			break;
+	}
+}
+
 /*  method adapted to Cortex-A : reused ARM v4 v5 method */
 int armv7a_mmu_translate_va(struct target *target,  uint32_t va, uint32_t *val)
 {
 	uint32_t first_lvl_descriptor = 0x0;
-	uint32_t second_lvl_descriptor = 0x0;
+	uint32_t second_lvl_descriptor;
+	uint8_t descriptors[4 * MMU_TLB_PREFETCH];
 	int retval;
 	struct armv7a_common *armv7a = target_to_armv7a(target);
 	struct arm_dpm *dpm = armv7a->arm.dpm;
@@ -188,6 +208,8 @@ int armv7a_mmu_translate_va(struct target *target,  uint32_t va, uint32_t *val)
 	uint32_t va_mask;
 	uint32_t ttbcr;
 	uint32_t ttb;
+	uint32_t asid;
+	uint32_t index;
 
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
@@ -218,6 +240,17 @@ int armv7a_mmu_translate_va(struct target *target,  uint32_t va, uint32_t *val)
 	if (retval != ERROR_OK)
 		return retval;
 
+	/*  MRC p15,0,<Rt>,c13,c0,1 ; Read CP15 Context ID Register, ASID in bits 7:0 */
+	retval = dpm->instr_read_data_r0(dpm,
+			ARMV4_5_MRC(15, 0, 0, 13, 0, 1),
+			&asid);
+	if (retval != ERROR_OK)
+		return retval;
+	asid &= 0xff;
+
+	if (mmu_tlb_lookup(target, ttb, asid, va, val, NULL))
+		return ERROR_OK;
+
 	ttb_mask = armv7a->armv7a_mmu.ttbr_mask[ttbidx];
 	va_mask = 0xfff00000 & armv7a->armv7a_mmu.ttbr_range[ttbidx];
 
@@ -242,6 +275,7 @@ int armv7a_mmu_translate_va(struct target *target,  uint32_t va, uint32_t *val)
 	if ((first_lvl_descriptor & 0x40002) == 2) {
 		/* section descriptor */
 		*val = (first_lvl_descriptor & 0xfff00000) | (va & 0x000fffff);
+		mmu_tlb_add(target, ttb, asid, va, 0x100000, first_lvl_descriptor, 0);
 		return ERROR_OK;
 	} else if ((first_lvl_descriptor & 0x40002) == 0x40002) {
 		/* supersection descriptor */
@@ -250,18 +284,25 @@ int armv7a_mmu_translate_va(struct target *target,  uint32_t va, uint32_t *val)
 			return ERROR_TARGET_TRANSLATION_FAULT;
 		}
 		*val = (first_lvl_descriptor & 0xff000000) | (va & 0x00ffffff);
+		mmu_tlb_add(target, ttb, asid, va, 0x1000000, first_lvl_descriptor, 0);
 		return ERROR_OK;
 	}
 
-	/* page table */
+	/* page table; fetch the descriptors of the neighbouring pages with
+	 * the same access, the next translations are likely to need them */
+	index = ((va & 0x000ff000) >> 12) & ~(MMU_TLB_PREFETCH - 1);
 	retval = armv7a->armv7a_mmu.read_physical_memory(target,
-			(first_lvl_descriptor & 0xfffffc00) | ((va & 0x000ff000) >> 10),
-			4, 1, (uint8_t *)&second_lvl_descriptor);
+			(first_lvl_descriptor & 0xfffffc00) | (index << 2),
+			4, MMU_TLB_PREFETCH, descriptors);
 	if (retval != ERROR_OK)
 		return retval;
 
-	second_lvl_descriptor = target_buffer_get_u32(target, (uint8_t *)
-			&second_lvl_descriptor);
+	for (unsigned i = 0; i < MMU_TLB_PREFETCH; i++)
+		armv7a_mmu_tlb_add(target, ttb, asid, (va & 0xfff00000) | ((index + i) << 12),
+				target_buffer_get_u32(target, descriptors + 4 * i));
+
+	second_lvl_descriptor = target_buffer_get_u32(target,
+			descriptors + 4 * (((va & 0x000ff000) >> 12) - index));
 
 	LOG_DEBUG("2nd lvl desc: %8.8" PRIx32 "", second_lvl_descriptor);
 
@@ -692,6 +733,7 @@ int armv7a_init_arch_info(struct target *target, struct armv7a_common *armv7a)
 	armv7a->armv7a_mmu.armv7a_cache.outer_cache = NULL;
 	armv7a->armv7a_mmu.armv7a_cache.flush_all_data_cache = NULL;
 	armv7a->armv7a_mmu.armv7a_cache.auto_cache_enabled = 1;
+	armv7a->armv7a_mmu.armv7a_cache.set_way_enabled = 1;
 	return ERROR_OK;
 }
 
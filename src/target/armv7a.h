@@ -79,6 +79,9 @@ struct armv7a_cache_common {
 	int d_u_cache_enabled;
 	int auto_cache_enabled;			/* openocd automatic
 						 * cache handling */
+	int set_way_enabled;			/* use set/way operations
+						 * for ranges larger than
+						 * the cache */
 	/* outer unified cache if some */
 	void *outer_cache;
 	int (*flush_all_data_cache)(struct target *target);
@@ -63,8 +63,90 @@ static int armv7a_l1_i_cache_sanity_check(struct target *target)
 	return ERROR_OK;
 }
 
+/* number of cache maintenance operations handed to the DPM at once */
+#define ARMV7A_CACHE_OP_BATCH	256
+
+struct armv7a_cache_op_batch {
+	struct arm_dpm *dpm;
+	uint32_t opcode;
+	unsigned count;
+	uint32_t data[ARMV7A_CACHE_OP_BATCH];
+};
+
+static int armv7a_cache_op_flush(struct armv7a_cache_op_batch *batch)
+{
+	struct arm_dpm *dpm = batch->dpm;
+	int retval = ERROR_OK;
+
+	if (dpm->instr_write_data_r0_array) {
+		retval = dpm->instr_write_data_r0_array(dpm, batch->opcode,
+				batch->data, batch->count);
+	} else {
+		for (unsigned i = 0; i < batch->count; i++) {
+			retval = dpm->instr_write_data_r0(dpm, batch->opcode,
+					batch->data[i]);
+			if (retval != ERROR_OK)
+				break;
+		}
+	}
+
+	batch->count = 0;
+	return retval;
+}
+
+static int armv7a_cache_op_add(struct armv7a_cache_op_batch *batch,
+		uint32_t value)
+{
+	batch->data[batch->count++] = value;
+	if (batch->count == ARMV7A_CACHE_OP_BATCH)
+		return armv7a_cache_op_flush(batch);
+
+	return ERROR_OK;
+}
+
+/* run one maintenance operation on every line in [va_line, va_end) */
+static int armv7a_cache_op_range(struct arm_dpm *dpm, uint32_t opcode,
+		uint32_t va_line, uint32_t va_end, uint32_t linelen)
+{
+	struct armv7a_cache_op_batch batch = {
+		.dpm = dpm,
+		.opcode = opcode,
+		.count = 0,
+	};
+	int retval = ERROR_OK;
+
+	while (va_line < va_end && retval == ERROR_OK) {
+		retval = armv7a_cache_op_add(&batch, va_line);
+		va_line += linelen;
+	}
+
+	if (retval == ERROR_OK)
+		retval = armv7a_cache_op_flush(&batch);
+
+	return retval;
+}
+
+/*
+ * Walking a range line by line costs more than a set/way operation on
+ * the whole cache once the range is larger than the L1 cache itself.
+ */
+static bool armv7a_cache_use_set_way(struct armv7a_cache_common *cache,
+		struct armv7a_cachesize *size, uint32_t range)
+{
+	if (!cache->set_way_enabled || cache->info == -1 || size->cachesize == 0)
+		return false;
+
+	return range >= size->cachesize * 1024;
+}
+
 static int armv7a_l1_d_cache_flush_level(struct arm_dpm *dpm, struct armv7a_cachesize *size, int cl)
 {
+	/* DCCISW - Clean and invalidate data cache line by Set/Way. */
+	struct armv7a_cache_op_batch batch = {
+		.dpm = dpm,
+		.opcode = ARMV4_5_MCR(15, 0, 0, 7, 14, 2),
+		.count = 0,
+	};
 	int retval = ERROR_OK;
 	int32_t c_way, c_index = size->index;
 
@@ -74,13 +156,7 @@ static int armv7a_l1_d_cache_flush_level(struct arm_dpm *dpm, struct armv7a_cach
 		do {
 			uint32_t value = (c_index << size->index_shift)
 				| (c_way << size->way_shift) | (cl << 1);
-			/*
-			 * DCCISW - Clean and invalidate data cache
-			 * line by Set/Way.
-			 */
-			retval = dpm->instr_write_data_r0(dpm,
-					ARMV4_5_MCR(15, 0, 0, 7, 14, 2),
-					value);
+			retval = armv7a_cache_op_add(&batch, value);
 			if (retval != ERROR_OK)
 				goto done;
 			c_way -= 1;
@@ -88,6 +164,8 @@ static int armv7a_l1_d_cache_flush_level(struct arm_dpm *dpm, struct armv7a_cach
 		c_index -= 1;
 	} while (c_index >= 0);
 
+	retval = armv7a_cache_op_flush(&batch);
+
  done:
 	return retval;
 }
@@ -113,7 +191,10 @@ static int armv7a_l1_d_cache_clean_inval_all(struct target *target)
 		if (cache->arch[cl].ctype < CACHE_LEVEL_HAS_D_CACHE)
 			continue;
 
-		armv7a_l1_d_cache_flush_level(dpm, &cache->arch[cl].d_u_size, cl);
+		retval = armv7a_l1_d_cache_flush_level(dpm,
+				&cache->arch[cl].d_u_size, cl);
+		if (retval != ERROR_OK)
+			goto done;
 	}
 
 	retval = dpm->finish(dpm);
@@ -196,14 +277,11 @@ int armv7a_l1_d_cache_inval_virt(struct target *target, uint32_t virt,
 			goto done;
 	}
 
-	while (va_line < va_end) {
-		/* DCIMVAC - Invalidate data cache line by VA to PoC. */
-		retval = dpm->instr_write_data_r0(dpm,
-				ARMV4_5_MCR(15, 0, 0, 7, 6, 1), va_line);
-		if (retval != ERROR_OK)
-			goto done;
-		va_line += linelen;
-	}
+	/* DCIMVAC - Invalidate data cache line by VA to PoC. */
+	retval = armv7a_cache_op_range(dpm, ARMV4_5_MCR(15, 0, 0, 7, 6, 1),
+			va_line, va_end, linelen);
+	if (retval != ERROR_OK)
+		goto done;
 
 	dpm->finish(dpm);
 	return retval;
@@ -229,6 +307,11 @@ int armv7a_l1_d_cache_clean_virt(struct target *target, uint32_t virt,
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* cleaning and invalidating everything is a superset of a clean */
+	if (armv7a_cache_use_set_way(armv7a_cache,
+			&armv7a_cache->arch[0].d_u_size, size))
+		return armv7a_l1_d_cache_clean_inval_all(target);
+
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
 		goto done;
@@ -236,14 +319,11 @@ int armv7a_l1_d_cache_clean_virt(struct target *target, uint32_t virt,
 	va_line = virt & (-linelen);
 	va_end = virt + size;
 
-	while (va_line < va_end) {
-		/* DCCMVAC - Data Cache Clean by MVA to PoC */
-		retval = dpm->instr_write_data_r0(dpm,
-				ARMV4_5_MCR(15, 0, 0, 7, 10, 1), va_line);
-		if (retval != ERROR_OK)
-			goto done;
-		va_line += linelen;
-	}
+	/* DCCMVAC - Data Cache Clean by MVA to PoC */
+	retval = armv7a_cache_op_range(dpm, ARMV4_5_MCR(15, 0, 0, 7, 10, 1),
+			va_line, va_end, linelen);
+	if (retval != ERROR_OK)
+		goto done;
 
 	dpm->finish(dpm);
 	return retval;
@@ -269,6 +349,10 @@ int armv7a_l1_d_cache_flush_virt(struct target *target, uint32_t virt,
 	if (retval != ERROR_OK)
 		return retval;
 
+	if (armv7a_cache_use_set_way(armv7a_cache,
+			&armv7a_cache->arch[0].d_u_size, size))
+		return armv7a_l1_d_cache_clean_inval_all(target);
+
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
 		goto done;
@@ -276,14 +360,11 @@ int armv7a_l1_d_cache_flush_virt(struct target *target, uint32_t virt,
 	va_line = virt & (-linelen);
 	va_end = virt + size;
 
-	while (va_line < va_end) {
-		/* DCCIMVAC */
-		retval = dpm->instr_write_data_r0(dpm,
-				ARMV4_5_MCR(15, 0, 0, 7, 14, 1), va_line);
-		if (retval != ERROR_OK)
-			goto done;
-		va_line += linelen;
-	}
+	/* DCCIMVAC */
+	retval = armv7a_cache_op_range(dpm, ARMV4_5_MCR(15, 0, 0, 7, 14, 1),
+			va_line, va_end, linelen);
+	if (retval != ERROR_OK)
+		goto done;
 
 	dpm->finish(dpm);
 	return retval;
@@ -347,6 +428,10 @@ int armv7a_l1_i_cache_inval_virt(struct target *target, uint32_t virt,
 	if (retval != ERROR_OK)
 		return retval;
 
+	if (armv7a_cache_use_set_way(armv7a_cache,
+			&armv7a_cache->arch[0].i_size, size))
+		return armv7a_l1_i_cache_inval_all(target);
+
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
 		goto done;
@@ -354,19 +439,19 @@ int armv7a_l1_i_cache_inval_virt(struct target *target, uint32_t virt,
 	va_line = virt & (-linelen);
 	va_end = virt + size;
 
-	while (va_line < va_end) {
-		/* ICIMVAU - Invalidate instruction cache by VA to PoU. */
-		retval = dpm->instr_write_data_r0(dpm,
-				ARMV4_5_MCR(15, 0, 0, 7, 5, 1), va_line);
-		if (retval != ERROR_OK)
-			goto done;
-		/* BPIMVA */
-		retval = dpm->instr_write_data_r0(dpm,
-				ARMV4_5_MCR(15, 0, 0, 7, 5, 7), va_line);
-		if (retval != ERROR_OK)
-			goto done;
-		va_line += linelen;
-	}
+	/* ICIMVAU - Invalidate instruction cache by VA to PoU. */
+	retval = armv7a_cache_op_range(dpm, ARMV4_5_MCR(15, 0, 0, 7, 5, 1),
+			va_line, va_end, linelen);
+	if (retval != ERROR_OK)
+		goto done;
+
+	/* BPIMVA */
+	retval = armv7a_cache_op_range(dpm, ARMV4_5_MCR(15, 0, 0, 7, 5, 7),
+			va_line, va_end, linelen);
+	if (retval != ERROR_OK)
+		goto done;
+
+	dpm->finish(dpm);
 	return retval;
 
 done:
@@ -509,6 +594,28 @@ COMMAND_HANDLER(arm7a_cache_disable_auto_cmd)
 	return ERROR_COMMAND_SYNTAX_ERROR;
 }
 
+COMMAND_HANDLER(arm7a_cache_set_way_cmd)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct armv7a_common *armv7a = target_to_armv7a(target);
+
+	if (CMD_ARGC == 0) {
+		command_print(CMD_CTX, "set/way fallback is %s",
+			armv7a->armv7a_mmu.armv7a_cache.set_way_enabled ? "enabled" : "disabled");
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC == 1) {
+		uint32_t set;
+
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], set);
+		armv7a->armv7a_mmu.armv7a_cache.set_way_enabled = !!set;
+		return ERROR_OK;
+	}
+
+	return ERROR_COMMAND_SYNTAX_ERROR;
+}
+
 static const struct command_registration arm7a_l1_d_cache_commands[] = {
 	{
 		.name = "flush_all",
@@ -585,6 +692,14 @@ const struct command_registration arm7a_cache_group_handlers[] = {
 		.help = "disable or enable automatic cache handling.",
 		.usage = "(1|0)",
 	},
+	{
+		.name = "setway",
+		.handler = arm7a_cache_set_way_cmd,
+		.mode = COMMAND_ANY,
+		.help = "use set/way operations for address ranges larger "
+			"than the cache.",
+		.usage = "(1|0)",
+	},
 	{
 		.name = "l1",
 		.mode = COMMAND_ANY,
@@ -246,6 +246,85 @@ static int armv7m_read_core_reg(struct target *target, struct reg *r,
 	return retval;
 }
 
+/**
+ * Reads the invalid registers among @a regs, which must all belong to
+ * the armv7m core cache.  When the core provides load_core_regs_u32()
+ * they are fetched in a single batch, otherwise one at a time.
+ */
+int armv7m_read_core_regs(struct target *target, struct reg **regs, unsigned count)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	uint32_t *num, *value;
+	unsigned i, n = 0;
+	int retval;
+
+	if (armv7m->load_core_regs_u32 == NULL) {
+		for (i = 0; i < count; i++) {
+			struct arm_reg *armv7m_reg = regs[i]->arch_info;
+			if (regs[i]->valid)
+				continue;
+			retval = armv7m_read_core_reg(target, regs[i],
+					armv7m_reg->num, ARM_MODE_ANY);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		return ERROR_OK;
+	}
+
+	/* D0..D15 take two words each */
+	num = malloc(2 * count * sizeof(uint32_t));
+	value = malloc(2 * count * sizeof(uint32_t));
+	if (num == NULL || value == NULL) {
+		retval = ERROR_FAIL;
+		goto out;
+	}
+
+	for (i = 0; i < count; i++) {
+		struct arm_reg *armv7m_reg = regs[i]->arch_info;
+		if (regs[i]->valid)
+			continue;
+		if ((armv7m_reg->num >= ARMV7M_D0) && (armv7m_reg->num <= ARMV7M_D15)) {
+			/* map D0..D15 to S0..S31 */
+			num[n++] = ARMV7M_S0 + 2 * (armv7m_reg->num - ARMV7M_D0);
+			num[n] = num[n - 1] + 1;
+			n++;
+		} else
+			num[n++] = armv7m_reg->num;
+	}
+
+	retval = n ? armv7m->load_core_regs_u32(target, num, value, n) : ERROR_OK;
+	if (retval != ERROR_OK)
+		goto out;
+
+	n = 0;
+	for (i = 0; i < count; i++) {
+		struct arm_reg *armv7m_reg = regs[i]->arch_info;
+		if (regs[i]->valid)
+			continue;
+		buf_set_u32(regs[i]->value, 0, 32, value[n++]);
+		if ((armv7m_reg->num >= ARMV7M_D0) && (armv7m_reg->num <= ARMV7M_D15))
+			buf_set_u32(regs[i]->value + 4, 0, 32, value[n++]);
+		regs[i]->valid = 1;
+		regs[i]->dirty = 0;
+	}
+
+out:
+	free(num);
+	free(value);
+	return retval;
+}
+
+static int armv7m_get_core_regs(struct reg **regs, unsigned count)
+{
+	struct arm_reg *armv7m_reg = regs[0]->arch_info;
+	struct target *target = armv7m_reg->target;
+
+	if (target->state != TARGET_HALTED)
+		return ERROR_TARGET_NOT_HALTED;
+
+	return armv7m_read_core_regs(target, regs, count);
+}
+
 static int armv7m_write_core_reg(struct target *target, struct reg *r,
 	int num, enum arm_mode mode, uint8_t *value)
 {
@@ -556,6 +635,7 @@ int armv7m_arch_state(struct target *target)
 static const struct reg_arch_type armv7m_reg_type = {
 	.get = armv7m_get_core_reg,
 	.set = armv7m_set_core_reg,
+	.get_many = armv7m_get_core_regs,
 };
 
 /** Builds cache of architecturally defined registers.  */
@@ -568,7 +648,8 @@ struct reg_cache *armv7m_build_reg_cache(struct target *target)
 	struct reg_cache *cache = malloc(sizeof(struct reg_cache));
 	struct reg *reg_list = calloc(num_regs, sizeof(struct reg));
 	struct arm_reg *arch_info = calloc(num_regs, sizeof(struct arm_reg));
-	struct reg_feature *feature;
+	struct reg_feature *features = calloc(num_regs, sizeof(struct reg_feature));
+	struct reg_data_type *reg_data_types = calloc(num_regs, sizeof(struct reg_data_type));
 	int i;
 
 	/* Build the process context cache */
@@ -585,10 +666,6 @@ struct reg_cache *armv7m_build_reg_cache(struct target *target)
 
 		reg_list[i].name = armv7m_regs[i].name;
 		reg_list[i].size = armv7m_regs[i].bits;
-		size_t storage_size = DIV_ROUND_UP(armv7m_regs[i].bits, 8);
-		if (storage_size < 4)
-			storage_size = 4;
-		reg_list[i].value = calloc(1, storage_size);
 		reg_list[i].dirty = 0;
 		reg_list[i].valid = 0;
 		reg_list[i].type = &armv7m_reg_type;
@@ -599,20 +676,18 @@ struct reg_cache *armv7m_build_reg_cache(struct target *target)
 		reg_list[i].exist = true;
 		reg_list[i].caller_save = true;	/* gdb defaults to true */
 
-		feature = calloc(1, sizeof(struct reg_feature));
-		if (feature) {
-			feature->name = armv7m_regs[i].feature;
-			reg_list[i].feature = feature;
-		} else
-			LOG_ERROR("unable to allocate feature list");
+		features[i].name = armv7m_regs[i].feature;
+		reg_list[i].feature = &features[i];
 
-		reg_list[i].reg_data_type = calloc(1, sizeof(struct reg_data_type));
-		if (reg_list[i].reg_data_type)
-			reg_list[i].reg_data_type->type = armv7m_regs[i].type;
-		else
-			LOG_ERROR("unable to allocate reg type list");
+		reg_data_types[i].type = armv7m_regs[i].type;
+		reg_list[i].reg_data_type = &reg_data_types[i];
 	}
 
+	/* the FPU registers are dropped again by examine if the core has
+	 * none, they stay in the block */
+	if (register_cache_alloc_values(cache) == NULL)
+		LOG_ERROR("unable to allocate register values");
+
 	arm->cpsr = reg_list + ARMV7M_xPSR;
 	arm->pc = reg_list + ARMV7M_PC;
 	arm->core_cache = cache;
@@ -625,22 +700,16 @@ void armv7m_free_reg_cache(struct target *target)
 	struct armv7m_common *armv7m = target_to_armv7m(target);
 	struct arm *arm = &armv7m->arm;
 	struct reg_cache *cache;
-	struct reg *reg;
-	unsigned int i;
 
 	cache = arm->core_cache;
 
 	if (!cache)
 		return;
 
-	for (i = 0; i < cache->num_regs; i++) {
-		reg = &cache->reg_list[i];
-
-		free(reg->feature);
-		free(reg->reg_data_type);
-		free(reg->value);
-	}
-
+	/* allocated in one block each, see armv7m_build_reg_cache() */
+	free(cache->reg_list[0].feature);
+	free(cache->reg_list[0].reg_data_type);
+	free(cache->reg_list[0].value);
 	free(cache->reg_list[0].arch_info);
 	free(cache->reg_list);
 	free(cache);
@@ -688,15 +757,11 @@ int armv7m_checksum_memory(struct target *target,
 #include "../../contrib/loaders/checksum/armv7m_crc.inc"
 	};
 
-	retval = target_alloc_working_area(target, sizeof(cortex_m_crc_code), &crc_algorithm);
+	retval = target_alloc_working_area_code(target, cortex_m_crc_code,
+			sizeof(cortex_m_crc_code), &crc_algorithm);
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = target_write_buffer(target, crc_algorithm->address,
-			sizeof(cortex_m_crc_code), (uint8_t *)cortex_m_crc_code);
-	if (retval != ERROR_OK)
-		goto cleanup;
-
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
 
@@ -720,12 +785,64 @@ int armv7m_checksum_memory(struct target *target,
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 
-cleanup:
 	target_free_working_area(target, crc_algorithm);
 
 	return retval;
 }
 
+/** Fills a word aligned memory region with a 32-bit pattern. */
+int armv7m_fill_memory(struct target *target,
+	uint32_t address, uint32_t count, uint32_t pattern)
+{
+	struct working_area *fill_algorithm;
+	struct armv7m_algorithm armv7m_info;
+	struct reg_param reg_params[3];
+	int retval;
+
+	static const uint8_t cortex_m_fill_code[] = {
+#include "../../contrib/loaders/fill/armv7m_fill.inc"
+	};
+
+	retval = target_alloc_working_area_code(target, cortex_m_fill_code,
+			sizeof(cortex_m_fill_code), &fill_algorithm);
+	if (retval != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* the code must not overwrite itself */
+	if (fill_algorithm->address < address + count &&
+			address < fill_algorithm->address + fill_algorithm->size) {
+		target_free_working_area(target, fill_algorithm);
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, address);
+	buf_set_u32(reg_params[1].value, 0, 32, count);
+	buf_set_u32(reg_params[2].value, 0, 32, pattern);
+
+	int timeout = 10000 * (1 + (count / (16 * 1024 * 1024)));
+
+	retval = target_run_algorithm(target, 0, NULL, 3, reg_params, fill_algorithm->address,
+			fill_algorithm->address + (sizeof(cortex_m_fill_code) - 2),
+			timeout, &armv7m_info);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error executing cortex_m fill algorithm");
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+
+	target_free_working_area(target, fill_algorithm);
+
+	return retval;
+}
+
 /** Checks whether a memory region is zeroed. */
 int armv7m_blank_check_memory(struct target *target,
 	uint32_t address, uint32_t count, uint32_t *blank)
@@ -740,14 +857,10 @@ int armv7m_blank_check_memory(struct target *target,
 	};
 
 	/* make sure we have a working area */
-	if (target_alloc_working_area(target, sizeof(erase_check_code),
-		&erase_check_algorithm) != ERROR_OK)
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-
-	retval = target_write_buffer(target, erase_check_algorithm->address,
-			sizeof(erase_check_code), (uint8_t *)erase_check_code);
+	retval = target_alloc_working_area_code(target, erase_check_code,
+			sizeof(erase_check_code), &erase_check_algorithm);
 	if (retval != ERROR_OK)
-		goto cleanup;
+		return retval;
 
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
@@ -778,7 +891,115 @@ int armv7m_blank_check_memory(struct target *target,
 	destroy_reg_param(&reg_params[1]);
 	destroy_reg_param(&reg_params[2]);
 
+	target_free_working_area(target, erase_check_algorithm);
+
+	return retval;
+}
+
+/** Checks several memory ranges for the erased value in one algorithm run. */
+int armv7m_blank_check_memory_blocks(struct target *target,
+	struct target_memory_check_block *blocks, int num_blocks,
+	uint8_t erased_value)
+{
+	struct working_area *erase_check_algorithm;
+	struct working_area *erase_check_params;
+	struct reg_param reg_params[2];
+	struct armv7m_algorithm armv7m_info;
+	uint8_t *params;
+	uint32_t total_size = 0;
+	int blocks_to_check;
+	int i;
+	int retval;
+
+	/* each block is { size_in_result_out, address }, 0-size terminated */
+	static const uint8_t erase_check_code[] = {
+#include "../../contrib/loaders/erase_check/armv7m_multi_erase_check.inc"
+	};
+
+	if (num_blocks < 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	/* an empty range would terminate the list early */
+	if (blocks[0].size == 0) {
+		blocks[0].result = 1;
+		return 1;
+	}
+	for (i = 1; i < num_blocks; i++)
+		if (blocks[i].size == 0)
+			break;
+	num_blocks = i;
+
+	retval = target_alloc_working_area_code(target, erase_check_code,
+			sizeof(erase_check_code), &erase_check_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* take as many blocks as the remaining working area can describe */
+	blocks_to_check = num_blocks;
+	while (target_alloc_working_area_try(target, (blocks_to_check + 1) * 8,
+			&erase_check_params) != ERROR_OK) {
+		blocks_to_check /= 2;
+		if (blocks_to_check == 0) {
+			target_free_working_area(target, erase_check_algorithm);
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	params = calloc(blocks_to_check + 1, 8);
+	if (params == NULL) {
+		retval = ERROR_FAIL;
+		goto cleanup;
+	}
+
+	for (i = 0; i < blocks_to_check; i++) {
+		target_buffer_set_u32(target, params + i * 8, blocks[i].size);
+		target_buffer_set_u32(target, params + i * 8 + 4, blocks[i].address);
+		total_size += blocks[i].size;
+	}
+
+	retval = target_write_buffer(target, erase_check_params->address,
+			(blocks_to_check + 1) * 8, params);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	buf_set_u32(reg_params[0].value, 0, 32, erase_check_params->address);
+
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	buf_set_u32(reg_params[1].value, 0, 32, erased_value);
+
+	int timeout = 10000 * (1 + (total_size / (1024 * 1024)));
+
+	retval = target_run_algorithm(target,
+			0,
+			NULL,
+			2,
+			reg_params,
+			erase_check_algorithm->address,
+			erase_check_algorithm->address + (sizeof(erase_check_code) - 2),
+			timeout,
+			&armv7m_info);
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+
+	if (retval == ERROR_OK)
+		retval = target_read_buffer(target, erase_check_params->address,
+				blocks_to_check * 8, params);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	for (i = 0; i < blocks_to_check; i++)
+		blocks[i].result = target_buffer_get_u32(target, params + i * 8);
+
+	retval = blocks_to_check;
+
 cleanup:
+	free(params);
+	target_free_working_area(target, erase_check_params);
 	target_free_working_area(target, erase_check_algorithm);
 
 	return retval;
@@ -159,6 +159,9 @@ struct armv7m_common {
 	/* Direct processor core register read and writes */
 	int (*load_core_reg_u32)(struct target *target, uint32_t num, uint32_t *value);
 	int (*store_core_reg_u32)(struct target *target, uint32_t num, uint32_t value);
+	/* Optional: read several core registers with a single queue flush */
+	int (*load_core_regs_u32)(struct target *target, const uint32_t *num,
+			uint32_t *value, unsigned count);
 
 	int (*examine_debug_reason)(struct target *target);
 	int (*post_debug_entry)(struct target *target);
@@ -217,6 +220,7 @@ int armv7m_wait_algorithm(struct target *target,
 		void *arch_info);
 
 int armv7m_invalidate_core_regs(struct target *target);
+int armv7m_read_core_regs(struct target *target, struct reg **regs, unsigned count);
 
 int armv7m_restore_context(struct target *target);
 
@@ -224,6 +228,11 @@ int armv7m_checksum_memory(struct target *target,
 		uint32_t address, uint32_t count, uint32_t *checksum);
 int armv7m_blank_check_memory(struct target *target,
 		uint32_t address, uint32_t count, uint32_t *blank);
+int armv7m_fill_memory(struct target *target,
+		uint32_t address, uint32_t count, uint32_t pattern);
+int armv7m_blank_check_memory_blocks(struct target *target,
+		struct target_memory_check_block *blocks, int num_blocks,
+		uint8_t erased_value);
 
 int armv7m_maybe_skip_bkpt_inst(struct target *target, bool *inst_found);
 
@@ -23,30 +23,91 @@
 #include <target/armv7m.h>
 #include <target/cortex_m.h>
 #include <target/armv7m_trace.h>
+#include <target/itm_server.h>
 #include <jtag/interface.h>
+#include <helper/time_support.h>
 
 #define TRACE_BUF_SIZE	4096
+/* Upper bound of adapter reads per poll, so a flood of trace data can
+ * not starve the rest of the server loop */
+#define TRACE_MAX_READS	16
+/* ACPR holds a 13-bit prescaler - 1 */
+#define TPIU_ACPR_MAX_PRESCALER	0x2000
+/* time to wait for ITM synchronisation packets after configuring the TPIU */
+#define TRACE_SYNC_CHECK_MS	1000
+
+static void armv7m_trace_check_sync(struct target *target)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct armv7m_trace_config *trace_config = &armv7m->trace_config;
+
+	if (!trace_config->sync_check_ms || timeval_ms() < trace_config->sync_check_ms)
+		return;
+	trace_config->sync_check_ms = 0;
+
+	if (itm_demux_syncs(target) != trace_config->sync_count)
+		LOG_INFO("%s: trace synchronised at %u Hz", target_name(target),
+				trace_config->trace_freq);
+	else
+		LOG_WARNING("%s: no ITM synchronisation packets received at %u Hz, check "
+				"the TRACECLKIN frequency and that DWT_CTRL.SYNCTAP is set",
+				target_name(target), trace_config->trace_freq);
+}
+
+/* Finds the highest trace port frequency the TPIU can derive from
+ * TRACECLKIN that the adapter can capture, returns the prescaler or 0 if
+ * the adapter can't tell. */
+static unsigned int armv7m_trace_select_freq(struct armv7m_trace_config *trace_config)
+{
+	for (unsigned int prescaler = 1; prescaler <= TPIU_ACPR_MAX_PRESCALER; prescaler++) {
+		unsigned int freq = trace_config->traceclkin_freq / prescaler;
+		bool supported;
+
+		if (!freq)
+			break;
+		if (adapter_check_trace_freq(trace_config->pin_protocol, freq, &supported) != ERROR_OK)
+			return 0;
+		if (supported) {
+			trace_config->trace_freq = freq;
+			return prescaler;
+		}
+	}
+
+	LOG_WARNING("the adapter can't capture any trace frequency derived from %u Hz TRACECLKIN",
+			trace_config->traceclkin_freq);
+	return 0;
+}
 
 static int armv7m_poll_trace(void *target)
 {
 	struct armv7m_common *armv7m = target_to_armv7m(target);
 	uint8_t buf[TRACE_BUF_SIZE];
-	size_t size = sizeof(buf);
+	size_t size;
 	int retval;
 
-	retval = adapter_poll_trace(buf, &size);
-	if (retval != ERROR_OK || !size)
-		return retval;
+	/* keep draining while the adapter hands out full buffers, the
+	 * probe side FIFO overflows long before the next poll otherwise */
+	armv7m_trace_check_sync(target);
+
+	for (int reads = 0; reads < TRACE_MAX_READS; reads++) {
+		size = sizeof(buf);
+		retval = adapter_poll_trace(buf, &size);
+		if (retval != ERROR_OK || !size)
+			return retval;
 
-	target_call_trace_callbacks(target, size, buf);
+		target_call_trace_callbacks(target, size, buf);
 
-	if (armv7m->trace_config.trace_file != NULL) {
-		if (fwrite(buf, 1, size, armv7m->trace_config.trace_file) == size)
-			fflush(armv7m->trace_config.trace_file);
-		else {
-			LOG_ERROR("Error writing to the trace destination file");
-			return ERROR_FAIL;
+		if (armv7m->trace_config.trace_file != NULL) {
+			if (fwrite(buf, 1, size, armv7m->trace_config.trace_file) == size)
+				fflush(armv7m->trace_config.trace_file);
+			else {
+				LOG_ERROR("Error writing to the trace destination file");
+				return ERROR_FAIL;
+			}
 		}
+
+		if (size < sizeof(buf))
+			break;
 	}
 
 	return ERROR_OK;
@@ -56,11 +117,20 @@ int armv7m_trace_tpiu_config(struct target *target)
 {
 	struct armv7m_common *armv7m = target_to_armv7m(target);
 	struct armv7m_trace_config *trace_config = &armv7m->trace_config;
-	int prescaler;
+	int prescaler = 0;
 	int retval;
 
 	target_unregister_timer_callback(armv7m_poll_trace, target);
-
+	trace_config->sync_check_ms = 0;
+
+	/* without a given frequency use the highest one both the TPIU and
+	 * the adapter support, if the adapter can tell */
+	if (trace_config->config_type == INTERNAL && !trace_config->trace_freq) {
+		prescaler = armv7m_trace_select_freq(trace_config);
+		if (prescaler)
+			LOG_INFO("Using %u Hz trace port frequency (TRACECLKIN / %d)",
+					trace_config->trace_freq, prescaler);
+	}
 
 	retval = adapter_config_trace(trace_config->config_type == INTERNAL,
 				      trace_config->pin_protocol,
@@ -74,21 +144,24 @@ int armv7m_trace_tpiu_config(struct target *target)
 		return ERROR_FAIL;
 	}
 
-	prescaler = trace_config->traceclkin_freq / trace_config->trace_freq;
-
-	if (trace_config->traceclkin_freq % trace_config->trace_freq) {
-		prescaler++;
-		int trace_freq = trace_config->traceclkin_freq / prescaler;
-		LOG_INFO("Can not obtain %u trace port frequency from %u TRACECLKIN frequency, using %u instead",
-			  trace_config->trace_freq, trace_config->traceclkin_freq,
-			  trace_freq);
-		trace_config->trace_freq = trace_freq;
-		retval = adapter_config_trace(trace_config->config_type == INTERNAL,
-					      trace_config->pin_protocol,
-					      trace_config->port_size,
-					      &trace_config->trace_freq);
-		if (retval != ERROR_OK)
-			return retval;
+	/* a selected frequency is exact, a given one may need rounding down */
+	if (!prescaler) {
+		prescaler = trace_config->traceclkin_freq / trace_config->trace_freq;
+
+		if (trace_config->traceclkin_freq % trace_config->trace_freq) {
+			prescaler++;
+			int trace_freq = trace_config->traceclkin_freq / prescaler;
+			LOG_INFO("Can not obtain %u trace port frequency from %u TRACECLKIN frequency, using %u instead",
+				  trace_config->trace_freq, trace_config->traceclkin_freq,
+				  trace_freq);
+			trace_config->trace_freq = trace_freq;
+			retval = adapter_config_trace(trace_config->config_type == INTERNAL,
+						      trace_config->pin_protocol,
+						      trace_config->port_size,
+						      &trace_config->trace_freq);
+			if (retval != ERROR_OK)
+				return retval;
+		}
 	}
 
 	retval = target_write_u32(target, TPIU_CSPSR, 1 << trace_config->port_size);
@@ -115,8 +188,15 @@ int armv7m_trace_tpiu_config(struct target *target)
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (trace_config->config_type == INTERNAL)
+	if (trace_config->config_type == INTERNAL) {
+		/* decode the ITM packets for the overflow and sync statistics */
+		if (!trace_config->formatter && itm_demux_enable(target) == ERROR_OK &&
+				trace_config->itm_synchro_packets) {
+			trace_config->sync_count = itm_demux_syncs(target);
+			trace_config->sync_check_ms = timeval_ms() + TRACE_SYNC_CHECK_MS;
+		}
 		target_register_timer_callback(armv7m_poll_trace, 1, 1, target);
+	}
 
 	target_call_event_callbacks(target, TARGET_EVENT_TRACE_CONFIG);
 
@@ -150,6 +230,21 @@ int armv7m_trace_itm_config(struct target *target)
 			return retval;
 	}
 
+	/* sync packets are paced by a CYCCNT tap, pick one unless the
+	 * application did */
+	if (trace_config->itm_synchro_packets) {
+		uint32_t dwt_ctrl;
+		retval = target_read_u32(target, DWT_CTRL, &dwt_ctrl);
+		if (retval != ERROR_OK)
+			return retval;
+		if (!(dwt_ctrl & DWT_CTRL_SYNCTAP_MASK)) {
+			dwt_ctrl |= DWT_CTRL_SYNCTAP_24 | DWT_CTRL_CYCCNTENA;
+			retval = target_write_u32(target, DWT_CTRL, dwt_ctrl);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+	}
+
 	return ERROR_OK;
 }
 
@@ -300,6 +395,39 @@ COMMAND_HANDLER(handle_itm_ports_command)
 		return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_itm_sync_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ON_OFF(CMD_ARGV[0], armv7m->trace_config.itm_synchro_packets);
+
+	if (CMD_CTX->mode == COMMAND_EXEC)
+		return armv7m_trace_itm_config(target);
+	else
+		return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_itm_stream_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	unsigned int port;
+
+	if (CMD_ARGC == 0) {
+		itm_stream_report(CMD_CTX, target);
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], port);
+	return itm_stream_add(target, port, CMD_ARGV[1]);
+}
+
 static const struct command_registration tpiu_command_handlers[] = {
 	{
 		.name = "config",
@@ -329,6 +457,21 @@ static const struct command_registration itm_command_handlers[] = {
 		.help = "Enable or disable all ITM stimulus ports",
 		.usage = "(0|1|on|off)",
 	},
+	{
+		.name = "sync",
+		.handler = handle_itm_sync_command,
+		.mode = COMMAND_ANY,
+		.help = "Enable or disable ITM synchronisation packets",
+		.usage = "(0|1|on|off)",
+	},
+	{
+		.name = "stream",
+		.handler = handle_itm_stream_command,
+		.mode = COMMAND_EXEC,
+		.help = "Serve the data of an ITM stimulus port on a TCP port, "
+			"or show streaming statistics",
+		.usage = "[<port> <tcp_port>]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
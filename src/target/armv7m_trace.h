@@ -66,7 +66,7 @@ struct armv7m_trace_config {
 	bool itm_diff_timestamps;
 	/** Enable async timestamps model */
 	bool itm_async_timestamps;
-	/** Enable synchronisation packet transmission (for sync port only) */
+	/** Enable synchronisation packet transmission */
 	bool itm_synchro_packets;
 
 	/** Current frequency of TRACECLKIN (usually matches HCLK) */
@@ -75,6 +75,11 @@ struct armv7m_trace_config {
 	unsigned int trace_freq;
 	/** Handle to output trace data in INTERNAL capture mode */
 	FILE *trace_file;
+	/** Time (timeval_ms) to check for ITM synchronisation packets after
+	 * the TPIU was configured, 0 when no check is pending */
+	int64_t sync_check_ms;
+	/** ITM synchronisation packets decoded before that */
+	uint32_t sync_count;
 };
 
 extern const struct command_registration armv7m_trace_command_handlers[];
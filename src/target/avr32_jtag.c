@@ -322,6 +322,159 @@ int avr32_jtag_mwa_write(struct avr32_jtag *jtag_info, int slave,
 	return ERROR_OK;
 }
 
+/* words per queue flush in the block functions */
+#define AVR32_MWA_BLOCK_WORDS	256
+
+struct avr32_mwa_scan {
+	uint8_t addr_busy[4];
+	uint8_t data[4];
+	uint8_t data_busy[4];
+};
+
+/*
+ * Queues the address and data scans of up to AVR32_MWA_BLOCK_WORDS word
+ * accesses and runs them in one flush.  The busy bits aren't waited for
+ * between the scans, they are only looked at afterwards: *done is the
+ * number of words before the first one that was busy.
+ */
+static int avr32_jtag_mwa_queued(struct avr32_jtag *jtag_info, int slave,
+		uint32_t addr, int count, uint32_t *buffer, int mode, int *done)
+{
+	struct avr32_mwa_scan *scans;
+	struct scan_field fields[2];
+	uint8_t addr_buf[4];
+	uint8_t slave_buf[4];
+	uint8_t data_buf[4];
+	uint8_t zero_buf[4];
+	int i, retval;
+
+	scans = calloc(count, sizeof(*scans));
+	if (scans == NULL)
+		return ERROR_FAIL;
+
+	memset(slave_buf, 0, sizeof(slave_buf));
+	memset(zero_buf, 0, sizeof(zero_buf));
+	buf_set_u32(slave_buf, 0, 4, slave);
+
+	for (i = 0; i < count; i++) {
+		/* avr32_jtag_mwa_set_address() */
+		memset(addr_buf, 0, sizeof(addr_buf));
+		buf_set_u32(addr_buf, 0, 1, mode);
+		buf_set_u32(addr_buf, 1, 30, (addr >> 2) + i);
+
+		fields[0].num_bits = 31;
+		fields[0].in_value = NULL;
+		fields[0].out_value = addr_buf;
+
+		fields[1].num_bits = 4;
+		fields[1].in_value = scans[i].addr_busy;
+		fields[1].out_value = slave_buf;
+
+		jtag_add_dr_scan(jtag_info->tap, 2, fields, TAP_IDLE);
+
+		if (mode == MODE_READ) {
+			/* avr32_jtag_mwa_read_data() */
+			fields[0].num_bits = 32;
+			fields[0].out_value = NULL;
+			fields[0].in_value = scans[i].data;
+
+			fields[1].num_bits = 3;
+			fields[1].in_value = scans[i].data_busy;
+			fields[1].out_value = NULL;
+		} else {
+			/* avr32_jtag_mwa_write_data() */
+			buf_set_u32(data_buf, 0, 32, buffer[i]);
+			fields[0].num_bits = 3;
+			fields[0].in_value = scans[i].data_busy;
+			fields[0].out_value = zero_buf;
+
+			fields[1].num_bits = 32;
+			fields[1].out_value = data_buf;
+			fields[1].in_value = NULL;
+		}
+
+		jtag_add_dr_scan(jtag_info->tap, 2, fields, TAP_IDLE);
+	}
+
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK) {
+		LOG_ERROR("%s: memory access failed", __func__);
+		free(scans);
+		return retval;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (buf_get_u32(scans[i].addr_busy, 1, 1) ||
+				(mode == MODE_READ && buf_get_u32(scans[i].data_busy, 0, 1)))
+			break;
+		if (mode == MODE_READ)
+			buffer[i] = buf_get_u32(scans[i].data, 0, 32);
+	}
+	*done = i;
+
+	free(scans);
+	return ERROR_OK;
+}
+
+/*
+ * Block transfers: word accesses with the busy checks deferred, see
+ * avr32_jtag_mwa_queued().  A word found busy is redone, waiting, with
+ * avr32_jtag_mwa_read()/write(), and queueing goes on after it.  The
+ * data is as avr32_jtag_mwa_read()/write() take it.
+ */
+static int avr32_jtag_mwa_block(struct avr32_jtag *jtag_info, int slave,
+		uint32_t addr, int count, uint32_t *buffer, int mode)
+{
+	int retval, done;
+
+	retval = avr32_jtag_set_instr(jtag_info, AVR32_INST_MW_ACCESS);
+	if (retval != ERROR_OK)
+		return retval;
+
+	while (count > 0) {
+		int n = MIN(count, AVR32_MWA_BLOCK_WORDS);
+
+		retval = avr32_jtag_mwa_queued(jtag_info, slave, addr, n, buffer,
+				mode, &done);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (done < n) {
+			LOG_DEBUG("SAB busy at 0x%8.8" PRIx32, addr + done * 4);
+			if (mode == MODE_READ)
+				retval = avr32_jtag_mwa_read(jtag_info, slave,
+						addr + done * 4, buffer + done);
+			else
+				retval = avr32_jtag_mwa_write(jtag_info, slave,
+						addr + done * 4, buffer[done]);
+			if (retval != ERROR_OK)
+				return retval;
+			done++;
+		}
+
+		addr += done * 4;
+		buffer += done;
+		count -= done;
+		keep_alive();
+	}
+
+	return ERROR_OK;
+}
+
+int avr32_jtag_mwa_read_block(struct avr32_jtag *jtag_info, int slave,
+		uint32_t addr, int count, uint32_t *buffer)
+{
+	return avr32_jtag_mwa_block(jtag_info, slave, addr, count, buffer, MODE_READ);
+}
+
+int avr32_jtag_mwa_write_block(struct avr32_jtag *jtag_info, int slave,
+		uint32_t addr, int count, const uint32_t *buffer)
+{
+	/* only read from in write mode */
+	return avr32_jtag_mwa_block(jtag_info, slave, addr, count,
+			(uint32_t *)buffer, MODE_WRITE);
+}
+
 int avr32_jtag_exec(struct avr32_jtag *jtag_info, uint32_t inst)
 {
 	int retval;
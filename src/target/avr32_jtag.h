@@ -94,6 +94,10 @@ int avr32_jtag_mwa_read(struct avr32_jtag *jtag_info, int slave,
 		uint32_t addr, uint32_t *value);
 int avr32_jtag_mwa_write(struct avr32_jtag *jtag_info, int slave,
 		uint32_t addr, uint32_t value);
+int avr32_jtag_mwa_read_block(struct avr32_jtag *jtag_info, int slave,
+		uint32_t addr, int count, uint32_t *buffer);
+int avr32_jtag_mwa_write_block(struct avr32_jtag *jtag_info, int slave,
+		uint32_t addr, int count, const uint32_t *buffer);
 
 int avr32_ocd_setbits(struct avr32_jtag *jtag, int reg, uint32_t bits);
 int avr32_ocd_clearbits(struct avr32_jtag *jtag, int reg, uint32_t bits);
@@ -24,22 +24,22 @@
 #include "avr32_jtag.h"
 #include "avr32_mem.h"
 
+/* The complete words of a transfer go through the block functions of
+ * avr32_jtag.c, which queue many words per flush. */
+
 int avr32_jtag_read_memory32(struct avr32_jtag *jtag_info,
 	uint32_t addr, int count, uint32_t *buffer)
 {
 	int i, retval;
-	uint32_t data;
 
-	for (i = 0; i < count; i++) {
-		retval = avr32_jtag_mwa_read(jtag_info, SLAVE_HSB_UNCACHED,
-				addr + i*4, &data);
+	retval = avr32_jtag_mwa_read_block(jtag_info, SLAVE_HSB_UNCACHED,
+			addr, count, buffer);
+	if (retval != ERROR_OK)
+		return retval;
 
-		if (retval != ERROR_OK)
-			return retval;
-
-		/* XXX: Assume AVR32 is BE */
-		buffer[i] = be_to_h_u32((uint8_t *)&data);
-	}
+	/* XXX: Assume AVR32 is BE */
+	for (i = 0; i < count; i++)
+		buffer[i] = be_to_h_u32((uint8_t *)&buffer[i]);
 
 	return ERROR_OK;
 }
@@ -47,7 +47,7 @@ int avr32_jtag_read_memory32(struct avr32_jtag *jtag_info,
 int avr32_jtag_read_memory16(struct avr32_jtag *jtag_info,
 	uint32_t addr, int count, uint16_t *buffer)
 {
-	int i, retval;
+	int i, j, words, retval;
 	uint32_t data;
 
 	i = 0;
@@ -67,17 +67,26 @@ int avr32_jtag_read_memory16(struct avr32_jtag *jtag_info,
 	}
 
 	/* read all complete words */
-	for (; i < (count & ~1); i += 2) {
-		retval = avr32_jtag_mwa_read(jtag_info, SLAVE_HSB_UNCACHED,
-				addr + i*2, &data);
-
-		if (retval != ERROR_OK)
+	words = (count - i) / 2;
+	if (words > 0) {
+		uint32_t *block = malloc(words * sizeof(uint32_t));
+		if (block == NULL)
+			return ERROR_FAIL;
+
+		retval = avr32_jtag_mwa_read_block(jtag_info, SLAVE_HSB_UNCACHED,
+				addr + i*2, words, block);
+		if (retval != ERROR_OK) {
+			free(block);
 			return retval;
+		}
 
-		/* XXX: Assume AVR32 is BE */
-		data = be_to_h_u32((uint8_t *)&data);
-		buffer[i] = data & 0xffff;
-		buffer[i+1] = (data >> 16) & 0xffff;
+		for (j = 0; j < words; j++, i += 2) {
+			/* XXX: Assume AVR32 is BE */
+			data = be_to_h_u32((uint8_t *)&block[j]);
+			buffer[i] = data & 0xffff;
+			buffer[i+1] = (data >> 16) & 0xffff;
+		}
+		free(block);
 	}
 
 	/* last halfword */
@@ -99,7 +108,7 @@ int avr32_jtag_read_memory16(struct avr32_jtag *jtag_info,
 int avr32_jtag_read_memory8(struct avr32_jtag *jtag_info,
 	uint32_t addr, int count, uint8_t *buffer)
 {
-	int i, j, retval;
+	int i, j, k, words, retval;
 	uint8_t data[4];
 	i = 0;
 
@@ -116,15 +125,25 @@ int avr32_jtag_read_memory8(struct avr32_jtag *jtag_info,
 	}
 
 	/* read all complete words */
-	for (; i < (count & ~3); i += 4) {
-		retval = avr32_jtag_mwa_read(jtag_info, SLAVE_HSB_UNCACHED,
-				addr + i, (uint32_t *)(void *)data);
-
-		if (retval != ERROR_OK)
+	words = (count - i) / 4;
+	if (words > 0) {
+		uint32_t *block = malloc(words * sizeof(uint32_t));
+		if (block == NULL)
+			return ERROR_FAIL;
+
+		retval = avr32_jtag_mwa_read_block(jtag_info, SLAVE_HSB_UNCACHED,
+				addr + i, words, block);
+		if (retval != ERROR_OK) {
+			free(block);
 			return retval;
+		}
 
-		for (j = 0; j < 4; j++)
-			buffer[i+j] = data[3-j];
+		for (k = 0; k < words; k++, i += 4) {
+			memcpy(data, &block[k], 4);
+			for (j = 0; j < 4; j++)
+				buffer[i+j] = data[3-j];
+		}
+		free(block);
 	}
 
 	/* remaining bytes */
@@ -146,26 +165,30 @@ int avr32_jtag_write_memory32(struct avr32_jtag *jtag_info,
 	uint32_t addr, int count, const uint32_t *buffer)
 {
 	int i, retval;
-	uint32_t data;
+	uint32_t *block;
 
-	for (i = 0; i < count; i++) {
-		/* XXX: Assume AVR32 is BE */
-		h_u32_to_be((uint8_t *)&data, buffer[i]);
-		retval = avr32_jtag_mwa_write(jtag_info, SLAVE_HSB_UNCACHED,
-				addr + i*4, data);
+	if (count == 0)
+		return ERROR_OK;
 
-		if (retval != ERROR_OK)
-			return retval;
+	block = malloc(count * sizeof(uint32_t));
+	if (block == NULL)
+		return ERROR_FAIL;
 
-	}
+	/* XXX: Assume AVR32 is BE */
+	for (i = 0; i < count; i++)
+		h_u32_to_be((uint8_t *)&block[i], buffer[i]);
 
-	return ERROR_OK;
+	retval = avr32_jtag_mwa_write_block(jtag_info, SLAVE_HSB_UNCACHED,
+			addr, count, block);
+	free(block);
+
+	return retval;
 }
 
 int avr32_jtag_write_memory16(struct avr32_jtag *jtag_info,
 	uint32_t addr, int count, const uint16_t *buffer)
 {
-	int i, retval;
+	int i, j, words, retval;
 	uint32_t data;
 	uint32_t data_out;
 
@@ -199,16 +222,24 @@ int avr32_jtag_write_memory16(struct avr32_jtag *jtag_info,
 	}
 
 	/* write all complete words */
-	for (; i < (count & ~1); i += 2) {
-		/* XXX: Assume AVR32 is BE */
-		data = (buffer[i+1] << 16) | buffer[i];
-		h_u32_to_be((uint8_t *)&data_out, data);
-
-		retval = avr32_jtag_mwa_write(jtag_info, SLAVE_HSB_UNCACHED,
-				addr + i*2, data_out);
+	words = (count - i) / 2;
+	if (words > 0) {
+		uint32_t *block = malloc(words * sizeof(uint32_t));
+		if (block == NULL)
+			return ERROR_FAIL;
+
+		for (j = 0; j < words; j++) {
+			/* XXX: Assume AVR32 is BE */
+			data = (buffer[i+2*j+1] << 16) | buffer[i+2*j];
+			h_u32_to_be((uint8_t *)&block[j], data);
+		}
 
+		retval = avr32_jtag_mwa_write_block(jtag_info, SLAVE_HSB_UNCACHED,
+				addr + i*2, words, block);
+		free(block);
 		if (retval != ERROR_OK)
 			return retval;
+		i += 2 * words;
 	}
 
 	/* last halfword */
@@ -237,7 +268,7 @@ int avr32_jtag_write_memory16(struct avr32_jtag *jtag_info,
 int avr32_jtag_write_memory8(struct avr32_jtag *jtag_info,
 	uint32_t addr, int count, const uint8_t *buffer)
 {
-	int i, j, retval;
+	int i, j, k, words, retval;
 	uint32_t data;
 	uint32_t data_out;
 
@@ -273,19 +304,27 @@ int avr32_jtag_write_memory8(struct avr32_jtag *jtag_info,
 
 
 	/* write all complete words */
-	for (; i < (count & ~3); i += 4) {
-		data = 0;
+	words = (count - i) / 4;
+	if (words > 0) {
+		uint32_t *block = malloc(words * sizeof(uint32_t));
+		if (block == NULL)
+			return ERROR_FAIL;
 
-		for (j = 0; j < 4; j++)
-			data |= (buffer[j+i] << j*8);
+		for (k = 0; k < words; k++) {
+			data = 0;
 
-		h_u32_to_be((uint8_t *)&data_out, data);
+			for (j = 0; j < 4; j++)
+				data |= (buffer[i+4*k+j] << j*8);
 
-		retval = avr32_jtag_mwa_write(jtag_info, SLAVE_HSB_UNCACHED,
-				addr + i, data_out);
+			h_u32_to_be((uint8_t *)&block[k], data);
+		}
 
+		retval = avr32_jtag_mwa_write_block(jtag_info, SLAVE_HSB_UNCACHED,
+				addr + i, words, block);
+		free(block);
 		if (retval != ERROR_OK)
 			return retval;
+		i += 4 * words;
 	}
 
 	/*
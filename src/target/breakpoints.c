@@ -41,20 +41,119 @@ static const char * const watchpoint_rw_strings[] = {
 /* monotonic counter/id-number for breakpoints and watch points */
 static int bpwp_unique_id;
 
+/* Breakpoints stay on the target->breakpoints list, which the targets
+ * walk to set and clear them, and are also hashed by address so that
+ * adding, finding and removing one doesn't scan hundreds of others.
+ * Context breakpoints have address 0 and all land in bucket 0. */
+#define BREAKPOINT_HASH_SIZE	256
+
+static unsigned breakpoint_hash(uint32_t address)
+{
+	/* instructions are at least halfword aligned */
+	return ((address >> 1) ^ (address >> 9)) & (BREAKPOINT_HASH_SIZE - 1);
+}
+
+static struct breakpoint *breakpoint_hash_first(struct target *target, uint32_t address)
+{
+	if (target->breakpoint_hash == NULL)
+		return NULL;
+	return target->breakpoint_hash[breakpoint_hash(address)];
+}
+
+static int breakpoint_hash_insert(struct target *target, struct breakpoint *breakpoint)
+{
+	if (target->breakpoint_hash == NULL) {
+		target->breakpoint_hash = calloc(BREAKPOINT_HASH_SIZE,
+				sizeof(*target->breakpoint_hash));
+		if (target->breakpoint_hash == NULL)
+			return ERROR_FAIL;
+	}
+
+	/* append, so lookups find the oldest of several at one address like
+	 * the list scans did */
+	struct breakpoint **p = &target->breakpoint_hash[breakpoint_hash(breakpoint->address)];
+	while (*p)
+		p = &(*p)->hash_next;
+	breakpoint->hash_next = NULL;
+	*p = breakpoint;
+	return ERROR_OK;
+}
+
+static void breakpoint_hash_remove(struct target *target, struct breakpoint *breakpoint)
+{
+	struct breakpoint **p;
+
+	if (target->breakpoint_hash == NULL)
+		return;
+
+	for (p = &target->breakpoint_hash[breakpoint_hash(breakpoint->address)]; *p;
+			p = &(*p)->hash_next) {
+		if (*p == breakpoint) {
+			*p = breakpoint->hash_next;
+			break;
+		}
+	}
+
+	if (target->breakpoints == NULL) {
+		free(target->breakpoint_hash);
+		target->breakpoint_hash = NULL;
+	}
+}
+
+/* allocate a breakpoint and append it to the list and the index */
+static struct breakpoint *breakpoint_new(struct target *target,
+	struct breakpoint **breakpoint_p, uint32_t address, uint32_t asid,
+	uint32_t length, enum breakpoint_type type)
+{
+	struct breakpoint *breakpoint = malloc(sizeof(struct breakpoint));
+
+	if (breakpoint == NULL)
+		return NULL;
+	breakpoint->address = address;
+	breakpoint->asid = asid;
+	breakpoint->length = length;
+	breakpoint->type = type;
+	breakpoint->set = 0;
+	breakpoint->orig_instr = malloc(length);
+	breakpoint->next = NULL;
+	breakpoint->hash_next = NULL;
+	breakpoint->unique_id = bpwp_unique_id++;
+
+	if (breakpoint->orig_instr == NULL ||
+			breakpoint_hash_insert(target, breakpoint) != ERROR_OK) {
+		free(breakpoint->orig_instr);
+		free(breakpoint);
+		return NULL;
+	}
+	*breakpoint_p = breakpoint;
+
+	return breakpoint;
+}
+
+/* undo breakpoint_new() for a breakpoint the target refused */
+static void breakpoint_discard(struct target *target,
+	struct breakpoint **breakpoint_p)
+{
+	struct breakpoint *breakpoint = *breakpoint_p;
+
+	*breakpoint_p = NULL;
+	breakpoint_hash_remove(target, breakpoint);
+	free(breakpoint->orig_instr);
+	free(breakpoint);
+}
+
 int breakpoint_add_internal(struct target *target,
 	uint32_t address,
 	uint32_t length,
 	enum breakpoint_type type)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
-	struct breakpoint **breakpoint_p = &target->breakpoints;
+	struct breakpoint *breakpoint;
+	struct breakpoint **breakpoint_p;
 	const char *reason;
 	int retval;
-	int n;
 
-	n = 0;
-	while (breakpoint) {
-		n++;
+	for (breakpoint = breakpoint_hash_first(target, address); breakpoint;
+			breakpoint = breakpoint->hash_next) {
 		if (breakpoint->address == address) {
 			/* FIXME don't assume "same address" means "same
 			 * breakpoint" ... check all the parameters before
@@ -64,19 +163,16 @@ int breakpoint_add_internal(struct target *target,
 				address, breakpoint->unique_id);
 			return ERROR_OK;
 		}
-		breakpoint_p = &breakpoint->next;
-		breakpoint = breakpoint->next;
 	}
 
-	(*breakpoint_p) = malloc(sizeof(struct breakpoint));
-	(*breakpoint_p)->address = address;
-	(*breakpoint_p)->asid = 0;
-	(*breakpoint_p)->length = length;
-	(*breakpoint_p)->type = type;
-	(*breakpoint_p)->set = 0;
-	(*breakpoint_p)->orig_instr = malloc(length);
-	(*breakpoint_p)->next = NULL;
-	(*breakpoint_p)->unique_id = bpwp_unique_id++;
+	breakpoint_p = &target->breakpoints;
+	while (*breakpoint_p)
+		breakpoint_p = &(*breakpoint_p)->next;
+
+	if (breakpoint_new(target, breakpoint_p, address, 0, length, type) == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
 
 	retval = target_add_breakpoint(target, *breakpoint_p);
 	switch (retval) {
@@ -92,9 +188,7 @@ int breakpoint_add_internal(struct target *target,
 			reason = "unknown reason";
 fail:
 			LOG_ERROR("can't add breakpoint: %s", reason);
-			free((*breakpoint_p)->orig_instr);
-			free(*breakpoint_p);
-			*breakpoint_p = NULL;
+			breakpoint_discard(target, breakpoint_p);
 			return retval;
 	}
 
@@ -132,21 +226,14 @@ int context_breakpoint_add_internal(struct target *target,
 		breakpoint = breakpoint->next;
 	}
 
-	(*breakpoint_p) = malloc(sizeof(struct breakpoint));
-	(*breakpoint_p)->address = 0;
-	(*breakpoint_p)->asid = asid;
-	(*breakpoint_p)->length = length;
-	(*breakpoint_p)->type = type;
-	(*breakpoint_p)->set = 0;
-	(*breakpoint_p)->orig_instr = malloc(length);
-	(*breakpoint_p)->next = NULL;
-	(*breakpoint_p)->unique_id = bpwp_unique_id++;
+	if (breakpoint_new(target, breakpoint_p, 0, asid, length, type) == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
 	retval = target_add_context_breakpoint(target, *breakpoint_p);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("could not add breakpoint");
-		free((*breakpoint_p)->orig_instr);
-		free(*breakpoint_p);
-		*breakpoint_p = NULL;
+		breakpoint_discard(target, breakpoint_p);
 		return retval;
 	}
 
@@ -188,23 +275,15 @@ int hybrid_breakpoint_add_internal(struct target *target,
 		breakpoint_p = &breakpoint->next;
 		breakpoint = breakpoint->next;
 	}
-	(*breakpoint_p) = malloc(sizeof(struct breakpoint));
-	(*breakpoint_p)->address = address;
-	(*breakpoint_p)->asid = asid;
-	(*breakpoint_p)->length = length;
-	(*breakpoint_p)->type = type;
-	(*breakpoint_p)->set = 0;
-	(*breakpoint_p)->orig_instr = malloc(length);
-	(*breakpoint_p)->next = NULL;
-	(*breakpoint_p)->unique_id = bpwp_unique_id++;
-
+	if (breakpoint_new(target, breakpoint_p, address, asid, length, type) == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
 
 	retval = target_add_hybrid_breakpoint(target, *breakpoint_p);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("could not add breakpoint");
-		free((*breakpoint_p)->orig_instr);
-		free(*breakpoint_p);
-		*breakpoint_p = NULL;
+		breakpoint_discard(target, breakpoint_p);
 		return retval;
 	}
 	LOG_DEBUG(
@@ -306,22 +385,26 @@ static void breakpoint_free(struct target *target, struct breakpoint *breakpoint
 
 	LOG_DEBUG("free BPID: %" PRIu32 " --> %d", breakpoint->unique_id, retval);
 	(*breakpoint_p) = breakpoint->next;
+	breakpoint_hash_remove(target, breakpoint);
 	free(breakpoint->orig_instr);
 	free(breakpoint);
 }
 
 int breakpoint_remove_internal(struct target *target, uint32_t address)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
+	struct breakpoint *breakpoint;
 
-	while (breakpoint) {
-		if ((breakpoint->address == address) && (breakpoint->asid == 0))
-			break;
-		else if ((breakpoint->address == 0) && (breakpoint->asid == address))
-			break;
-		else if ((breakpoint->address == address) && (breakpoint->asid != 0))
+	for (breakpoint = breakpoint_hash_first(target, address); breakpoint;
+			breakpoint = breakpoint->hash_next)
+		if (breakpoint->address == address)
 			break;
-		breakpoint = breakpoint->next;
+
+	/* context breakpoints are removed by asid */
+	if (breakpoint == NULL) {
+		for (breakpoint = breakpoint_hash_first(target, 0); breakpoint;
+				breakpoint = breakpoint->hash_next)
+			if (breakpoint->address == 0 && breakpoint->asid == address)
+				break;
 	}
 
 	if (breakpoint) {
@@ -377,13 +460,12 @@ void breakpoint_clear_target(struct target *target)
 
 struct breakpoint *breakpoint_find(struct target *target, uint32_t address)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
+	struct breakpoint *breakpoint;
 
-	while (breakpoint) {
+	for (breakpoint = breakpoint_hash_first(target, address); breakpoint;
+			breakpoint = breakpoint->hash_next)
 		if (breakpoint->address == address)
 			return breakpoint;
-		breakpoint = breakpoint->next;
-	}
 
 	return NULL;
 }
@@ -38,6 +38,8 @@ struct breakpoint {
 	int set;
 	uint8_t *orig_instr;
 	struct breakpoint *next;
+	/* next breakpoint in the same bucket of target->breakpoint_hash */
+	struct breakpoint *hash_next;
 	uint32_t unique_id;
 	int linked_BRP;
 };
@@ -66,11 +66,15 @@ static int cortex_a_set_hybrid_breakpoint(struct target *target,
 	struct breakpoint *breakpoint);
 static int cortex_a_unset_breakpoint(struct target *target,
 	struct breakpoint *breakpoint);
+static int cortex_a_rearm_breakpoint(struct target *target,
+	struct breakpoint *breakpoint);
 static int cortex_a_dap_read_coreregister_u32(struct target *target,
 	uint32_t *value, int regnum);
 static int cortex_a_dap_write_coreregister_u32(struct target *target,
 	uint32_t value, int regnum);
 static int cortex_a_mmu(struct target *target, int *enabled);
+static int cortex_a_set_dcc_mode(struct target *target, uint32_t mode,
+	uint32_t *dscr);
 static int cortex_a_mmu_modify(struct target *target, int enable);
 static int cortex_a_virt2phys(struct target *target,
 	uint32_t virt, uint32_t *phys);
@@ -369,6 +373,7 @@ static int cortex_a_read_regs_through_mem(struct target *target, uint32_t addres
 {
 	int retval = ERROR_OK;
 	struct armv7a_common *armv7a = target_to_armv7a(target);
+	uint8_t buf[14 * 4];
 
 	retval = cortex_a_dap_read_coreregister_u32(target, regfile, 0);
 	if (retval != ERROR_OK)
@@ -376,14 +381,40 @@ static int cortex_a_read_regs_through_mem(struct target *target, uint32_t addres
 	retval = cortex_a_dap_write_coreregister_u32(target, address, 0);
 	if (retval != ERROR_OK)
 		return retval;
-	retval = cortex_a_exec_opcode(target, ARMV4_5_STMIA(0, 0xFFFE, 0, 0), NULL);
+	/* r1..r14; what STM stores for the PC is implementation defined */
+	retval = cortex_a_exec_opcode(target, ARMV4_5_STMIA(0, 0x7FFE, 0, 0), NULL);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = mem_ap_read_buf(armv7a->memory_ap, buf, 4, 14, address);
 	if (retval != ERROR_OK)
 		return retval;
+	target_buffer_get_u32_array(target, buf, 14, &regfile[1]);
 
-	retval = mem_ap_read_buf(armv7a->memory_ap,
-			(uint8_t *)(&regfile[1]), 4, 15, address);
+	return cortex_a_dap_read_coreregister_u32(target, &regfile[15], 15);
+}
 
-	return retval;
+/*
+ * The core can store its registers with a single STM to a working area
+ * that is then fetched in one memory AP transfer, instead of a DCC round
+ * trip per register.  The memory AP only sees what the core stored while
+ * the MMU and data cache are off; that is taken from the previous debug
+ * entry here and checked again once SCTLR has been read.  A working area
+ * with backup would cost more than it saves.
+ */
+static bool cortex_a_use_regs_through_mem(struct target *target)
+{
+	struct cortex_a_common *cortex_a = target_to_cortex_a(target);
+	struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+
+	if (cortex_a->fast_reg_read)
+		return true;
+
+	return cortex_a->memap_auto && armv7a->memory_ap_available &&
+		!target->backup_working_area &&
+		(armv7a->armv7a_mmu.armv7a_cache.info != -1) &&
+		!armv7a->armv7a_mmu.mmu_enabled &&
+		!armv7a->armv7a_mmu.armv7a_cache.d_u_cache_enabled;
 }
 
 static int cortex_a_dap_read_coreregister_u32(struct target *target,
@@ -685,6 +716,125 @@ static int cortex_a_instr_write_data_r0(struct arm_dpm *dpm,
 	return retval;
 }
 
+/* In stall mode, writes to DTRRX and ITR and reads of DTRTX are held off
+ * by the core until the previous instruction has completed, so a whole
+ * sequence of them can be queued and DSCR only checked once at the end.
+ */
+static int cortex_a_stall_begin(struct cortex_a_common *a, uint32_t *dscr)
+{
+	struct armv7a_common *armv7a = &a->armv7a_common;
+	struct target *target = armv7a->arm.target;
+	int retval;
+
+	retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+			armv7a->debug_base + CPUDBG_DSCR, dscr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = cortex_a_wait_instrcmpl(target, dscr, false);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return cortex_a_set_dcc_mode(target, DSCR_EXT_DCC_STALL_MODE, dscr);
+}
+
+/* Runs what was queued after cortex_a_stall_begin(), unless retval
+ * already reports an error, and returns to non-blocking mode. */
+static int cortex_a_stall_end(struct cortex_a_common *a, uint32_t *dscr,
+	int retval)
+{
+	struct armv7a_common *armv7a = &a->armv7a_common;
+	struct target *target = armv7a->arm.target;
+	int retval2;
+
+	if (retval == ERROR_OK)
+		retval = dap_run(armv7a->debug_ap->dap);
+
+	/* always switch back to non-blocking mode */
+	retval2 = cortex_a_set_dcc_mode(target, DSCR_EXT_DCC_NON_BLOCKING, dscr);
+	if (retval == ERROR_OK)
+		retval = retval2;
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = cortex_a_wait_instrcmpl(target, dscr, true);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (*dscr & (DSCR_STICKY_ABORT_PRECISE | DSCR_STICKY_ABORT_IMPRECISE)) {
+		mem_ap_write_atomic_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DRCR, DRCR_CLEAR_EXCEPTIONS);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+static int cortex_a_instr_write_data_r0_array(struct arm_dpm *dpm,
+	uint32_t opcode, const uint32_t *data, unsigned count)
+{
+	struct cortex_a_common *a = dpm_to_a(dpm);
+	struct armv7a_common *armv7a = &a->armv7a_common;
+	uint32_t dscr;
+	int retval;
+
+	if (count == 0)
+		return ERROR_OK;
+
+	retval = cortex_a_stall_begin(a, &dscr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	LOG_DEBUG("exec opcode 0x%08" PRIx32 " for %u words", opcode, count);
+
+	for (unsigned i = 0; i < count && retval == ERROR_OK; i++) {
+		retval = cortex_a_write_dcc(a, data[i]);
+		/* DCCRX to R0, "MCR p14, 0, R0, c0, c5, 0", 0xEE000E15 */
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv7a->debug_ap,
+					armv7a->debug_base + CPUDBG_ITR,
+					ARMV4_5_MRC(14, 0, 0, 0, 5, 0));
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv7a->debug_ap,
+					armv7a->debug_base + CPUDBG_ITR, opcode);
+	}
+
+	retval = cortex_a_stall_end(a, &dscr, retval);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error while executing opcode 0x%08" PRIx32, opcode);
+	return retval;
+}
+
+static int cortex_a_instr_write_data_dcc_array(struct arm_dpm *dpm,
+	const uint32_t *opcode, const uint32_t *data, unsigned count)
+{
+	struct cortex_a_common *a = dpm_to_a(dpm);
+	struct armv7a_common *armv7a = &a->armv7a_common;
+	uint32_t dscr;
+	int retval;
+
+	if (count == 0)
+		return ERROR_OK;
+
+	retval = cortex_a_stall_begin(a, &dscr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	LOG_DEBUG("exec %u opcodes with data to DCC", count);
+
+	for (unsigned i = 0; i < count && retval == ERROR_OK; i++) {
+		retval = cortex_a_write_dcc(a, data[i]);
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv7a->debug_ap,
+					armv7a->debug_base + CPUDBG_ITR, opcode[i]);
+	}
+
+	retval = cortex_a_stall_end(a, &dscr, retval);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error while executing %u opcodes with data to DCC", count);
+	return retval;
+}
+
 static int cortex_a_instr_cpsr_sync(struct arm_dpm *dpm)
 {
 	struct target *target = dpm->arm->target;
@@ -741,6 +891,38 @@ static int cortex_a_instr_read_data_r0(struct arm_dpm *dpm,
 	return cortex_a_read_dcc(a, data, &dscr);
 }
 
+static int cortex_a_instr_read_data_dcc_array(struct arm_dpm *dpm,
+	const uint32_t *opcode, uint32_t *data, unsigned count)
+{
+	struct cortex_a_common *a = dpm_to_a(dpm);
+	struct armv7a_common *armv7a = &a->armv7a_common;
+	uint32_t dscr;
+	int retval;
+
+	if (count == 0)
+		return ERROR_OK;
+
+	retval = cortex_a_stall_begin(a, &dscr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	LOG_DEBUG("exec %u opcodes with data from DCC", count);
+
+	/* each DTRTX read waits for the opcode before it to fill DCC */
+	for (unsigned i = 0; i < count && retval == ERROR_OK; i++) {
+		retval = mem_ap_write_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_ITR, opcode[i]);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv7a->debug_ap,
+					armv7a->debug_base + CPUDBG_DTRTX, data + i);
+	}
+
+	retval = cortex_a_stall_end(a, &dscr, retval);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error while executing %u opcodes with data from DCC", count);
+	return retval;
+}
+
 static int cortex_a_bpwp_enable(struct arm_dpm *dpm, unsigned index_t,
 	uint32_t addr, uint32_t control)
 {
@@ -814,10 +996,13 @@ static int cortex_a_dpm_setup(struct cortex_a_common *a, uint32_t didr)
 
 	dpm->instr_write_data_dcc = cortex_a_instr_write_data_dcc;
 	dpm->instr_write_data_r0 = cortex_a_instr_write_data_r0;
+	dpm->instr_write_data_r0_array = cortex_a_instr_write_data_r0_array;
+	dpm->instr_write_data_dcc_array = cortex_a_instr_write_data_dcc_array;
 	dpm->instr_cpsr_sync = cortex_a_instr_cpsr_sync;
 
 	dpm->instr_read_data_dcc = cortex_a_instr_read_data_dcc;
 	dpm->instr_read_data_r0 = cortex_a_instr_read_data_r0;
+	dpm->instr_read_data_dcc_array = cortex_a_instr_read_data_dcc_array;
 
 	dpm->bpwp_enable = cortex_a_bpwp_enable;
 	dpm->bpwp_disable = cortex_a_bpwp_disable;
@@ -842,20 +1027,206 @@ static struct target *get_cortex_a(struct target *target, int32_t coreid)
 	}
 	return target;
 }
-static int cortex_a_halt(struct target *target);
 
-static int cortex_a_halt_smp(struct target *target)
+/*
+ * Run control for several cores at once: the debug register accesses for
+ * all cores are queued and flushed together, so the halt or restart
+ * requests reach the cores back to back and one pass of DSCR reads polls
+ * all of them.  This keeps the skew between SMP cores down to a single
+ * JTAG/SWD batch instead of a full halt or restart per core.
+ */
+
+/* flush the queue of every DAP used by 'cores' */
+static int cortex_a_run_cores(struct target **cores, int count)
+{
+	int retval = ERROR_OK;
+
+	for (int i = 0; i < count; i++) {
+		struct adiv5_dap *dap = target_to_armv7a(cores[i])->debug_ap->dap;
+		int j;
+
+		for (j = 0; j < i; j++) {
+			if (target_to_armv7a(cores[j])->debug_ap->dap == dap)
+				break;
+		}
+		if (j == i) {
+			int run_retval = dap_run(dap);
+			if (retval == ERROR_OK)
+				retval = run_retval;
+		}
+	}
+	return retval;
+}
+
+/* queue a DSCR read of every core in 'cores' into 'dscr' and flush */
+static int cortex_a_read_dscr_cores(struct target **cores, int count, uint32_t *dscr)
+{
+	for (int i = 0; i < count; i++) {
+		struct armv7a_common *armv7a = target_to_armv7a(cores[i]);
+		int retval = mem_ap_read_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DSCR, &dscr[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	return cortex_a_run_cores(cores, count);
+}
+
+/* poll all cores together until every DSCR has 'mask' set */
+static int cortex_a_wait_dscr_cores(struct target **cores, int count,
+	uint32_t *dscr, uint32_t mask, const char *what)
+{
+	int64_t then = timeval_ms();
+	for (;; ) {
+		int retval = cortex_a_read_dscr_cores(cores, count, dscr);
+		if (retval != ERROR_OK)
+			return retval;
+
+		int i;
+		for (i = 0; i < count && (dscr[i] & mask); i++)
+			;
+		if (i == count)
+			return ERROR_OK;
+
+		if (timeval_ms() > then + 1000) {
+			LOG_ERROR("Timeout waiting for %s", what);
+			return ERROR_FAIL;
+		}
+	}
+}
+
+static int cortex_a_halt_cores(struct target **cores, int count)
+{
+	int retval = ERROR_OK;
+	uint32_t *dscr = calloc(count, sizeof(*dscr));
+
+	if (dscr == NULL)
+		return ERROR_FAIL;
+
+	/*
+	 * Tell the cores to be halted by writing DRCR with 0x1
+	 * and then wait for the cores to be halted.
+	 */
+	for (int i = 0; i < count && retval == ERROR_OK; i++) {
+		struct armv7a_common *armv7a = target_to_armv7a(cores[i]);
+		retval = mem_ap_write_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DRCR, DRCR_HALT);
+	}
+	if (retval == ERROR_OK)
+		retval = cortex_a_run_cores(cores, count);
+
+	/*
+	 * enter halting debug mode
+	 */
+	if (retval == ERROR_OK)
+		retval = cortex_a_read_dscr_cores(cores, count, dscr);
+	for (int i = 0; i < count && retval == ERROR_OK; i++) {
+		struct armv7a_common *armv7a = target_to_armv7a(cores[i]);
+		retval = mem_ap_write_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DSCR, dscr[i] | DSCR_HALT_DBG_MODE);
+	}
+	if (retval == ERROR_OK)
+		retval = cortex_a_run_cores(cores, count);
+
+	if (retval == ERROR_OK)
+		retval = cortex_a_wait_dscr_cores(cores, count, dscr,
+				DSCR_CORE_HALTED, "halt");
+
+	for (int i = 0; i < count && retval == ERROR_OK; i++)
+		cores[i]->debug_reason = DBG_REASON_DBGRQ;
+
+	free(dscr);
+	return retval;
+}
+
+static int cortex_a_restart_cores(struct target **cores, int count)
+{
+	int retval;
+	uint32_t *dscr = calloc(count, sizeof(*dscr));
+
+	if (dscr == NULL)
+		return ERROR_FAIL;
+
+	/*
+	 * * Restart cores and wait for them to be started.  Clear ITRen and sticky
+	 * * exception flags: see ARMv7 ARM, C5.9.
+	 *
+	 * REVISIT: for single stepping, we probably want to
+	 * disable IRQs by default, with optional override...
+	 */
+
+	retval = cortex_a_read_dscr_cores(cores, count, dscr);
+	for (int i = 0; i < count && retval == ERROR_OK; i++) {
+		struct armv7a_common *armv7a = target_to_armv7a(cores[i]);
+
+		if ((dscr[i] & DSCR_INSTR_COMP) == 0)
+			LOG_ERROR("DSCR InstrCompl must be set before leaving debug!");
+
+		retval = mem_ap_write_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DSCR, dscr[i] & ~DSCR_ITR_EN);
+		if (retval != ERROR_OK)
+			break;
+	}
+	/* the restart requests go out last and back to back */
+	for (int i = 0; i < count && retval == ERROR_OK; i++) {
+		struct armv7a_common *armv7a = target_to_armv7a(cores[i]);
+		retval = mem_ap_write_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DRCR, DRCR_RESTART |
+				DRCR_CLEAR_EXCEPTIONS);
+	}
+	if (retval == ERROR_OK)
+		retval = cortex_a_run_cores(cores, count);
+
+	if (retval == ERROR_OK)
+		retval = cortex_a_wait_dscr_cores(cores, count, dscr,
+				DSCR_CORE_RESTARTED, "resume");
+
+	for (int i = 0; i < count && retval == ERROR_OK; i++) {
+		cores[i]->debug_reason = DBG_REASON_NOTHALTED;
+		cores[i]->state = TARGET_RUNNING;
+
+		/* registers are now invalid */
+		register_cache_invalidate(target_to_armv7a(cores[i])->arm.core_cache);
+	}
+
+	free(dscr);
+	return retval;
+}
+
+/* collect 'target' (if wanted) and the other SMP cores in 'skip_state' */
+static struct target **cortex_a_smp_cores(struct target *target, bool with_target,
+	enum target_state skip_state, int *count)
 {
-	int retval = 0;
 	struct target_list *head;
-	struct target *curr;
-	head = target->head;
-	while (head != (struct target_list *)NULL) {
-		curr = head->target;
-		if ((curr != target) && (curr->state != TARGET_HALTED))
-			retval += cortex_a_halt(curr);
-		head = head->next;
+	int n = 1;
+
+	for (head = target->head; head != NULL; head = head->next)
+		n++;
+
+	struct target **cores = calloc(n, sizeof(*cores));
+	if (cores == NULL)
+		return NULL;
+
+	*count = 0;
+	if (with_target)
+		cores[(*count)++] = target;
+	for (head = target->head; head != NULL; head = head->next) {
+		struct target *curr = head->target;
+		if ((curr != target) && (curr->state != skip_state))
+			cores[(*count)++] = curr;
 	}
+	return cores;
+}
+
+static int cortex_a_halt_smp(struct target *target)
+{
+	int retval, count;
+	struct target **cores = cortex_a_smp_cores(target, false,
+			TARGET_HALTED, &count);
+
+	if (cores == NULL)
+		return ERROR_FAIL;
+	retval = count ? cortex_a_halt_cores(cores, count) : ERROR_OK;
+	free(cores);
 	return retval;
 }
 
@@ -946,49 +1317,7 @@ static int cortex_a_poll(struct target *target)
 
 static int cortex_a_halt(struct target *target)
 {
-	int retval = ERROR_OK;
-	uint32_t dscr;
-	struct armv7a_common *armv7a = target_to_armv7a(target);
-
-	/*
-	 * Tell the core to be halted by writing DRCR with 0x1
-	 * and then wait for the core to be halted.
-	 */
-	retval = mem_ap_write_atomic_u32(armv7a->debug_ap,
-			armv7a->debug_base + CPUDBG_DRCR, DRCR_HALT);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/*
-	 * enter halting debug mode
-	 */
-	retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-			armv7a->debug_base + CPUDBG_DSCR, &dscr);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = mem_ap_write_atomic_u32(armv7a->debug_ap,
-			armv7a->debug_base + CPUDBG_DSCR, dscr | DSCR_HALT_DBG_MODE);
-	if (retval != ERROR_OK)
-		return retval;
-
-	int64_t then = timeval_ms();
-	for (;; ) {
-		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-				armv7a->debug_base + CPUDBG_DSCR, &dscr);
-		if (retval != ERROR_OK)
-			return retval;
-		if ((dscr & DSCR_CORE_HALTED) != 0)
-			break;
-		if (timeval_ms() > then + 1000) {
-			LOG_ERROR("Timeout waiting for halt");
-			return ERROR_FAIL;
-		}
-	}
-
-	target->debug_reason = DBG_REASON_DBGRQ;
-
-	return ERROR_OK;
+	return cortex_a_halt_cores(&target, 1);
 }
 
 static int cortex_a_internal_restore(struct target *target, int current,
@@ -1088,78 +1417,29 @@ static int cortex_a_internal_restore(struct target *target, int current,
 
 static int cortex_a_internal_restart(struct target *target)
 {
-	struct armv7a_common *armv7a = target_to_armv7a(target);
-	struct arm *arm = &armv7a->arm;
-	int retval;
-	uint32_t dscr;
-	/*
-	 * * Restart core and wait for it to be started.  Clear ITRen and sticky
-	 * * exception flags: see ARMv7 ARM, C5.9.
-	 *
-	 * REVISIT: for single stepping, we probably want to
-	 * disable IRQs by default, with optional override...
-	 */
-
-	retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-			armv7a->debug_base + CPUDBG_DSCR, &dscr);
-	if (retval != ERROR_OK)
-		return retval;
-
-	if ((dscr & DSCR_INSTR_COMP) == 0)
-		LOG_ERROR("DSCR InstrCompl must be set before leaving debug!");
-
-	retval = mem_ap_write_atomic_u32(armv7a->debug_ap,
-			armv7a->debug_base + CPUDBG_DSCR, dscr & ~DSCR_ITR_EN);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = mem_ap_write_atomic_u32(armv7a->debug_ap,
-			armv7a->debug_base + CPUDBG_DRCR, DRCR_RESTART |
-			DRCR_CLEAR_EXCEPTIONS);
-	if (retval != ERROR_OK)
-		return retval;
-
-	int64_t then = timeval_ms();
-	for (;; ) {
-		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-				armv7a->debug_base + CPUDBG_DSCR, &dscr);
-		if (retval != ERROR_OK)
-			return retval;
-		if ((dscr & DSCR_CORE_RESTARTED) != 0)
-			break;
-		if (timeval_ms() > then + 1000) {
-			LOG_ERROR("Timeout waiting for resume");
-			return ERROR_FAIL;
-		}
-	}
-
-	target->debug_reason = DBG_REASON_NOTHALTED;
-	target->state = TARGET_RUNNING;
-
-	/* registers are now invalid */
-	register_cache_invalidate(arm->core_cache);
-
-	return ERROR_OK;
+	return cortex_a_restart_cores(&target, 1);
 }
 
 static int cortex_a_restore_smp(struct target *target, int handle_breakpoints)
 {
 	int retval = 0;
-	struct target_list *head;
-	struct target *curr;
+	int count;
 	uint32_t address;
-	head = target->head;
-	while (head != (struct target_list *)NULL) {
-		curr = head->target;
-		if ((curr != target) && (curr->state != TARGET_RUNNING)) {
-			/*  resume current address , not in step mode */
-			retval += cortex_a_internal_restore(curr, 1, &address,
-					handle_breakpoints, 0);
-			retval += cortex_a_internal_restart(curr);
-		}
-		head = head->next;
+	struct target **cores = cortex_a_smp_cores(target, true,
+			TARGET_RUNNING, &count);
+
+	if (cores == NULL)
+		return ERROR_FAIL;
 
+	for (int i = 1; i < count; i++) {
+		/*  resume current address , not in step mode */
+		retval += cortex_a_internal_restore(cores[i], 1, &address,
+				handle_breakpoints, 0);
 	}
+
+	/* 'target' itself was restored by the caller, restart all together */
+	retval += cortex_a_restart_cores(cores, count);
+	free(cores);
 	return retval;
 }
 
@@ -1182,8 +1462,8 @@ static int cortex_a_resume(struct target *target, int current,
 		retval = cortex_a_restore_smp(target, handle_breakpoints);
 		if (retval != ERROR_OK)
 			return retval;
-	}
-	cortex_a_internal_restart(target);
+	} else
+		cortex_a_internal_restart(target);
 
 	if (!debug_execution) {
 		target->state = TARGET_RUNNING;
@@ -1244,11 +1524,10 @@ static int cortex_a_debug_entry(struct target *target)
 		arm_dpm_report_wfar(&armv7a->dpm, wfar);
 	}
 
-	/* REVISIT fast_reg_read is never set ... */
-
 	/* Examine target state and mode */
-	if (cortex_a->fast_reg_read)
-		target_alloc_working_area(target, 64, &regfile_working_area);
+	if (cortex_a_use_regs_through_mem(target))
+		target_alloc_working_area_try(target, 64, &regfile_working_area);
+	bool regs_through_mem = regfile_working_area != NULL;
 
 	/* First load register acessible through core debug port*/
 	if (!regfile_working_area)
@@ -1279,6 +1558,8 @@ static int cortex_a_debug_entry(struct target *target)
 			reg->valid = 1;
 			reg->dirty = 0;
 		}
+		/* r0 held the working area address */
+		arm->core_cache->reg_list[0].dirty = 1;
 
 		/* Fixup PC Resume Address */
 		if (cpsr & (1 << 5)) {
@@ -1315,6 +1596,17 @@ static int cortex_a_debug_entry(struct target *target)
 			return retval;
 	}
 
+	if (regs_through_mem && !cortex_a->fast_reg_read &&
+			(armv7a->armv7a_mmu.mmu_enabled ||
+			armv7a->armv7a_mmu.armv7a_cache.d_u_cache_enabled)) {
+		/* MMU or cache came on since the last halt, the memory AP may
+		 * have missed the stored registers: read them from the core */
+		LOG_DEBUG("re-reading registers through the core");
+		for (i = 1; i <= ARM_PC; i++)
+			arm_reg_current(arm, i)->valid = 0;
+		retval = arm_dpm_read_current_registers(&armv7a->dpm);
+	}
+
 	return retval;
 }
 
@@ -1465,7 +1757,7 @@ static int cortex_a_step(struct target *target, int current, uint32_t address,
 	target->debug_reason = DBG_REASON_BREAKPOINT;
 
 	if (breakpoint)
-		cortex_a_set_breakpoint(target, breakpoint, 0);
+		cortex_a_rearm_breakpoint(target, breakpoint);
 
 	if (target->state != TARGET_HALTED)
 		LOG_DEBUG("target stepped");
@@ -1489,6 +1781,42 @@ static int cortex_a_restore_context(struct target *target, bool bpwp)
  * Cortex-A Breakpoint and watchpoint functions
  */
 
+/* Write the BKPT of a soft breakpoint whose orig_instr is already saved */
+static int cortex_a_write_soft_breakpoint(struct target *target,
+	struct breakpoint *breakpoint)
+{
+	struct armv7a_common *armv7a = target_to_armv7a(target);
+	uint8_t code[4];
+	int retval;
+
+	if (breakpoint->length == 2)
+		buf_set_u32(code, 0, 32, ARMV5_T_BKPT(0x11));
+	else
+		buf_set_u32(code, 0, 32, ARMV5_BKPT(0x11));
+
+	/* make sure data cache is cleaned & invalidated down to PoC */
+	if (!armv7a->armv7a_mmu.armv7a_cache.auto_cache_enabled) {
+		armv7a_cache_flush_virt(target, breakpoint->address,
+					breakpoint->length);
+	}
+
+	retval = target_write_memory(target,
+			breakpoint->address & 0xFFFFFFFE,
+			breakpoint->length, 1, code);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* update i-cache at breakpoint location */
+	armv7a_l1_d_cache_inval_virt(target, breakpoint->address,
+				breakpoint->length);
+	armv7a_l1_i_cache_inval_virt(target, breakpoint->address,
+					 breakpoint->length);
+
+	breakpoint->set = 0x11;	/* Any nice value but 0 */
+
+	return ERROR_OK;
+}
+
 /* Setup hardware Breakpoint Register Pair */
 static int cortex_a_set_breakpoint(struct target *target,
 	struct breakpoint *breakpoint, uint8_t matchmode)
@@ -1536,11 +1864,6 @@ static int cortex_a_set_breakpoint(struct target *target,
 			brp_list[brp_i].control,
 			brp_list[brp_i].value);
 	} else if (breakpoint->type == BKPT_SOFT) {
-		uint8_t code[4];
-		if (breakpoint->length == 2)
-			buf_set_u32(code, 0, 32, ARMV5_T_BKPT(0x11));
-		else
-			buf_set_u32(code, 0, 32, ARMV5_BKPT(0x11));
 		retval = target_read_memory(target,
 				breakpoint->address & 0xFFFFFFFE,
 				breakpoint->length, 1,
@@ -1548,30 +1871,26 @@ static int cortex_a_set_breakpoint(struct target *target,
 		if (retval != ERROR_OK)
 			return retval;
 
-		/* make sure data cache is cleaned & invalidated down to PoC */
-		if (!armv7a->armv7a_mmu.armv7a_cache.auto_cache_enabled) {
-			armv7a_cache_flush_virt(target, breakpoint->address,
-						breakpoint->length);
-		}
-
-		retval = target_write_memory(target,
-				breakpoint->address & 0xFFFFFFFE,
-				breakpoint->length, 1, code);
-		if (retval != ERROR_OK)
-			return retval;
-
-		/* update i-cache at breakpoint location */
-		armv7a_l1_d_cache_inval_virt(target, breakpoint->address,
-					breakpoint->length);
-		armv7a_l1_i_cache_inval_virt(target, breakpoint->address,
-						 breakpoint->length);
-
-		breakpoint->set = 0x11;	/* Any nice value but 0 */
+		return cortex_a_write_soft_breakpoint(target, breakpoint);
 	}
 
 	return ERROR_OK;
 }
 
+/*
+ * Puts back a soft breakpoint that was lifted to step over it. Lifting
+ * it wrote orig_instr back to memory, so the original instruction isn't
+ * read again, and cache maintenance stays limited to its own lines.
+ */
+static int cortex_a_rearm_breakpoint(struct target *target,
+	struct breakpoint *breakpoint)
+{
+	if (breakpoint->type != BKPT_SOFT || breakpoint->set)
+		return cortex_a_set_breakpoint(target, breakpoint, 0);
+
+	return cortex_a_write_soft_breakpoint(target, breakpoint);
+}
+
 static int cortex_a_set_context_breakpoint(struct target *target,
 	struct breakpoint *breakpoint, uint8_t matchmode)
 {
@@ -2708,6 +3027,28 @@ static int cortex_a_read_memory(struct target *target, uint32_t address,
 	return retval;
 }
 
+/*
+ * Pick the memory AP for an access when it was selected with "dap apsel",
+ * or automatically while the MMU and the data cache are off: the memory AP
+ * then sees exactly what the core would, and bulk transfers avoid the DCC
+ * round trip through the core for every word.  This is the common case of
+ * loading images into DDR from a boot loader.
+ */
+static bool cortex_a_use_memory_ap(struct target *target)
+{
+	struct cortex_a_common *cortex_a = target_to_cortex_a(target);
+	struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+
+	if (!armv7a->memory_ap_available)
+		return false;
+	if (armv7a->arm.dap->apsel == armv7a->memory_ap->ap_num)
+		return true;
+
+	return cortex_a->memap_auto && (target->state == TARGET_HALTED) &&
+		!armv7a->armv7a_mmu.mmu_enabled &&
+		!armv7a->armv7a_mmu.armv7a_cache.d_u_cache_enabled;
+}
+
 static int cortex_a_read_memory_ahb(struct target *target, uint32_t address,
 	uint32_t size, uint32_t count, uint8_t *buffer)
 {
@@ -2715,10 +3056,8 @@ static int cortex_a_read_memory_ahb(struct target *target, uint32_t address,
 	uint32_t virt, phys;
 	int retval;
 	struct armv7a_common *armv7a = target_to_armv7a(target);
-	struct adiv5_dap *swjdp = armv7a->arm.dap;
-	uint8_t apsel = swjdp->apsel;
 
-	if (!armv7a->memory_ap_available || (apsel != armv7a->memory_ap->ap_num))
+	if (!cortex_a_use_memory_ap(target))
 		return target_read_memory(target, address, size, count, buffer);
 
 	/* cortex_a handles unaligned memory access */
@@ -2802,10 +3141,8 @@ static int cortex_a_write_memory_ahb(struct target *target, uint32_t address,
 	uint32_t virt, phys;
 	int retval;
 	struct armv7a_common *armv7a = target_to_armv7a(target);
-	struct adiv5_dap *swjdp = armv7a->arm.dap;
-	uint8_t apsel = swjdp->apsel;
 
-	if (!armv7a->memory_ap_available || (apsel != armv7a->memory_ap->ap_num))
+	if (!cortex_a_use_memory_ap(target))
 		return target_write_memory(target, address, size, count, buffer);
 
 	/* cortex_a handles unaligned memory access */
@@ -3171,6 +3508,7 @@ static int cortex_a_init_arch_info(struct target *target,
 	armv7a->arm.dap = tap->dap;
 
 	cortex_a->fast_reg_read = 0;
+	cortex_a->memap_auto = true;
 
 	/* register arch-specific functions */
 	armv7a->examine_debug_reason = NULL;
@@ -3394,6 +3732,20 @@ COMMAND_HANDLER(handle_cortex_a_dacrfixup_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_cortex_a_memap_auto_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct cortex_a_common *cortex_a = target_to_cortex_a(target);
+
+	if (CMD_ARGC > 0)
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], cortex_a->memap_auto);
+
+	command_print(CMD_CTX, "cortex_a automatic memory AP access %s",
+			cortex_a->memap_auto ? "on" : "off");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration cortex_a_exec_command_handlers[] = {
 	{
 		.name = "cache_info",
@@ -3443,6 +3795,14 @@ static const struct command_registration cortex_a_exec_command_handlers[] = {
 			"on memory access",
 		.usage = "['on'|'off']",
 	},
+	{
+		.name = "memap_auto",
+		.handler = handle_cortex_a_memap_auto_command,
+		.mode = COMMAND_ANY,
+		.help = "access memory through the memory AP while MMU and "
+			"data cache are off",
+		.usage = "['on'|'off']",
+	},
 
 	COMMAND_REGISTRATION_DONE
 };
@@ -3488,6 +3848,7 @@ struct target_type cortexa_target = {
 
 	.checksum_memory = arm_checksum_memory,
 	.blank_check_memory = arm_blank_check_memory,
+	.fill_memory = arm_fill_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
 
@@ -3573,6 +3934,7 @@ struct target_type cortexr4_target = {
 
 	.checksum_memory = arm_checksum_memory,
 	.blank_check_memory = arm_blank_check_memory,
+	.fill_memory = arm_fill_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
 
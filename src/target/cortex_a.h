@@ -103,6 +103,8 @@ struct cortex_a_common {
 
 	enum cortex_a_isrmasking_mode isrmasking_mode;
 	enum cortex_a_dacrfixup_mode dacrfixup_mode;
+	/* use the memory AP for plain accesses while MMU and data cache are off */
+	bool memap_auto;
 
 	struct armv7a_common armv7a_common;
 
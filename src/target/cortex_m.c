@@ -38,6 +38,8 @@
 #include "register.h"
 #include "arm_opcodes.h"
 #include "arm_semihosting.h"
+#include "algorithm.h"
+#include "live_watch.h"
 #include <helper/time_support.h>
 
 /* NOTE:  most of this should work fine for the Cortex-M1 and
@@ -219,15 +221,24 @@ static int cortex_m_endreset_event(struct target *target)
 {
 	int i;
 	int retval;
-	uint32_t dcb_demcr;
+	uint32_t dcb_demcr, fpctrl;
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct armv7m_common *armv7m = &cortex_m->armv7m;
 	struct adiv5_dap *swjdp = cortex_m->armv7m.arm.dap;
 	struct cortex_m_fp_comparator *fp_list = cortex_m->fp_comparator_list;
 	struct cortex_m_dwt_comparator *dwt_list = cortex_m->dwt_comparator_list;
 
+	/* This runs on every reset, so everything below is queued and sent
+	 * in two transactions: the reads it depends on, then the writes. */
+
 	/* REVISIT The four debug monitor bits are currently ignored... */
-	retval = mem_ap_read_atomic_u32(armv7m->debug_ap, DCB_DEMCR, &dcb_demcr);
+	retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DEMCR, &dcb_demcr);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = dap_run(swjdp);
 	if (retval != ERROR_OK)
 		return retval;
 	LOG_DEBUG("DCB_DEMCR = 0x%8.8" PRIx32 "", dcb_demcr);
@@ -237,18 +248,12 @@ static int cortex_m_endreset_event(struct target *target)
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* Enable debug requests */
-	retval = mem_ap_read_atomic_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
+	/* Enable debug requests and clear any interrupt masking */
+	cortex_m->dcb_dhcsr &= ~((0xFFFF << 16) | C_MASKINTS);
+	cortex_m->dcb_dhcsr |= DBGKEY | C_DEBUGEN;
+	retval = mem_ap_write_u32(armv7m->debug_ap, DCB_DHCSR, cortex_m->dcb_dhcsr);
 	if (retval != ERROR_OK)
 		return retval;
-	if (!(cortex_m->dcb_dhcsr & C_DEBUGEN)) {
-		retval = mem_ap_write_u32(armv7m->debug_ap, DCB_DHCSR, DBGKEY | C_DEBUGEN);
-		if (retval != ERROR_OK)
-			return retval;
-	}
-
-	/* clear any interrupt masking */
-	cortex_m_write_debug_halt_mask(target, 0, C_MASKINTS);
 
 	/* Enable features controlled by ITM and DWT blocks, and catch only
 	 * the vectors we were told to pay attention to.
@@ -265,47 +270,55 @@ static int cortex_m_endreset_event(struct target *target)
 	 * debug state (including FBP, DWT, etc) across reset...
 	 */
 
-	/* Enable FPB */
-	retval = cortex_m_enable_fpb(target);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("Failed to enable the FPB");
+	/* Enable FPB, checked below */
+	retval = mem_ap_write_u32(armv7m->debug_ap, FP_CTRL, 3);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = mem_ap_read_u32(armv7m->debug_ap, FP_CTRL, &fpctrl);
+	if (retval != ERROR_OK)
 		return retval;
-	}
-
-	cortex_m->fpb_enabled = 1;
 
 	/* Restore FPB registers */
 	for (i = 0; i < cortex_m->fp_num_code + cortex_m->fp_num_lit; i++) {
-		retval = target_write_u32(target, fp_list[i].fpcr_address, fp_list[i].fpcr_value);
+		retval = mem_ap_write_u32(armv7m->debug_ap, fp_list[i].fpcr_address,
+				fp_list[i].fpcr_value);
 		if (retval != ERROR_OK)
 			return retval;
 	}
 
 	/* Restore DWT registers */
 	for (i = 0; i < cortex_m->dwt_num_comp; i++) {
-		retval = target_write_u32(target, dwt_list[i].dwt_comparator_address + 0,
+		retval = mem_ap_write_u32(armv7m->debug_ap, dwt_list[i].dwt_comparator_address + 0,
 				dwt_list[i].comp);
 		if (retval != ERROR_OK)
 			return retval;
-		retval = target_write_u32(target, dwt_list[i].dwt_comparator_address + 4,
+		retval = mem_ap_write_u32(armv7m->debug_ap, dwt_list[i].dwt_comparator_address + 4,
 				dwt_list[i].mask);
 		if (retval != ERROR_OK)
 			return retval;
-		retval = target_write_u32(target, dwt_list[i].dwt_comparator_address + 8,
+		retval = mem_ap_write_u32(armv7m->debug_ap, dwt_list[i].dwt_comparator_address + 8,
 				dwt_list[i].function);
 		if (retval != ERROR_OK)
 			return retval;
 	}
+
+	/* make sure we have latest dhcsr flags */
+	retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
+	if (retval != ERROR_OK)
+		return retval;
 	retval = dap_run(swjdp);
 	if (retval != ERROR_OK)
 		return retval;
 
 	register_cache_invalidate(armv7m->arm.core_cache);
 
-	/* make sure we have latest dhcsr flags */
-	retval = mem_ap_read_atomic_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
+	if (!(fpctrl & 1)) {
+		LOG_ERROR("Failed to enable the FPB");
+		return ERROR_FAIL;
+	}
+	cortex_m->fpb_enabled = 1;
 
-	return retval;
+	return ERROR_OK;
 }
 
 static int cortex_m_examine_debug_reason(struct target *target)
@@ -424,6 +437,16 @@ static int cortex_m_debug_entry(struct target *target)
 	/* Examine target state and mode
 	 * First load register accessible through core debug port */
 	int num_regs = arm->core_cache->num_regs;
+	struct reg **regs = malloc(num_regs * sizeof(struct reg *));
+
+	if (regs != NULL) {
+		for (i = 0; i < num_regs; i++)
+			regs[i] = &armv7m->arm.core_cache->reg_list[i];
+		retval = armv7m_read_core_regs(target, regs, num_regs);
+		free(regs);
+		if (retval != ERROR_OK)
+			LOG_DEBUG("batched register read failed, retrying one by one");
+	}
 
 	for (i = 0; i < num_regs; i++) {
 		r = &armv7m->arm.core_cache->reg_list[i];
@@ -481,6 +504,16 @@ static int cortex_m_debug_entry(struct target *target)
 	return ERROR_OK;
 }
 
+/* Queues the DHCSR read of cortex_m_poll(); targets sharing an adapter
+ * all get their status from whichever poll flushes the queue first. */
+static int cortex_m_poll_queue(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct armv7m_common *armv7m = &cortex_m->armv7m;
+
+	return mem_ap_read_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
+}
+
 static int cortex_m_poll(struct target *target)
 {
 	int detected_failure = ERROR_OK;
@@ -489,8 +522,13 @@ static int cortex_m_poll(struct target *target)
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct armv7m_common *armv7m = &cortex_m->armv7m;
 
-	/* Read from Debug Halting Control and Status Register */
-	retval = mem_ap_read_atomic_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
+	/* Read from Debug Halting Control and Status Register, unless
+	 * cortex_m_poll_queue() already queued that read */
+	if (target->poll_queued) {
+		target->poll_queued = false;
+		retval = dap_run(armv7m->debug_ap->dap);
+	} else
+		retval = mem_ap_read_atomic_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
 	if (retval != ERROR_OK) {
 		target->state = TARGET_UNKNOWN;
 		return retval;
@@ -669,18 +707,121 @@ static int cortex_m_soft_reset_halt(struct target *target)
 	return ERROR_OK;
 }
 
+/* soft breakpoints set per batch of queued MEM-AP accesses */
+#define CORTEX_M_BKPT_BATCH	64
+
+/*
+ * Sets up to @a count pending 16-bit soft breakpoints with two DAP runs:
+ * one reads the words holding the original instructions, the other
+ * writes them back with the BKPT halfword merged in. Breakpoints that
+ * share a word are merged into the first write of that word.
+ */
+static int cortex_m_set_soft_breakpoints(struct target *target,
+	struct breakpoint **breakpoints, unsigned count)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	uint32_t words[CORTEX_M_BKPT_BATCH];
+	uint32_t bkpt = ARMV5_T_BKPT(0x11) & 0xffff;
+	unsigned i, j;
+	int retval;
+
+	for (i = 0; i < count; i++) {
+		retval = mem_ap_read_u32(armv7m->debug_ap,
+				breakpoints[i]->address & ~3, &words[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	retval = dap_run(armv7m->debug_ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (i = 0; i < count; i++) {
+		uint32_t aligned = breakpoints[i]->address & ~3;
+		unsigned shift = (breakpoints[i]->address & 2) * 8;
+
+		/* orig_instr is kept in target byte order */
+		h_u16_to_le(breakpoints[i]->orig_instr, words[i] >> shift);
+
+		for (j = 0; j < i; j++)
+			if ((breakpoints[j]->address & ~3) == aligned)
+				break;
+		words[j] = (words[j] & ~(0xffffu << shift)) | (bkpt << shift);
+		if (j < i)
+			continue;
+
+		retval = mem_ap_write_u32(armv7m->debug_ap, aligned, words[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	retval = dap_run(armv7m->debug_ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (i = 0; i < count; i++)
+		breakpoints[i]->set = true;
+
+	return ERROR_OK;
+}
+
 void cortex_m_enable_breakpoints(struct target *target)
 {
+	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct breakpoint *breakpoint = target->breakpoints;
+	struct breakpoint *batch[CORTEX_M_BKPT_BATCH];
+	unsigned count = 0;
 
-	/* set any pending breakpoints */
+	/* set any pending breakpoints, 16-bit soft ones in batches */
 	while (breakpoint) {
-		if (!breakpoint->set)
-			cortex_m_set_breakpoint(target, breakpoint);
+		if (!breakpoint->set) {
+			if (cortex_m->auto_bp_type)
+				breakpoint->type = BKPT_TYPE_BY_ADDR(breakpoint->address);
+
+			if (breakpoint->type == BKPT_SOFT && breakpoint->length == 2 &&
+					target->endianness == TARGET_LITTLE_ENDIAN &&
+					!target_to_armv7m(target)->stlink)
+				batch[count++] = breakpoint;
+			else
+				cortex_m_set_breakpoint(target, breakpoint);
+		}
 		breakpoint = breakpoint->next;
+
+		if (count == CORTEX_M_BKPT_BATCH || (breakpoint == NULL && count)) {
+			if (cortex_m_set_soft_breakpoints(target, batch, count) != ERROR_OK) {
+				/* fall back to one at a time, which reports what failed */
+				for (unsigned i = 0; i < count; i++)
+					if (!batch[i]->set)
+						cortex_m_set_breakpoint(target, batch[i]);
+			}
+			count = 0;
+		}
 	}
 }
 
+/*
+ * Puts back a soft breakpoint that was lifted to step over it. Lifting
+ * it wrote orig_instr back to memory, so only the BKPT is written and
+ * the original instruction isn't read again.
+ */
+static int cortex_m_rearm_breakpoint(struct target *target, struct breakpoint *breakpoint)
+{
+	uint8_t code[4];
+	int retval;
+
+	if (breakpoint->type != BKPT_SOFT || breakpoint->set)
+		return cortex_m_set_breakpoint(target, breakpoint);
+
+	buf_set_u32(code, 0, 32, ARMV5_T_BKPT(0x11));
+	retval = target_write_memory(target,
+			breakpoint->address & 0xFFFFFFFE,
+			breakpoint->length, 1,
+			code);
+	if (retval != ERROR_OK)
+		return retval;
+	breakpoint->set = true;
+
+	return ERROR_OK;
+}
+
 static int cortex_m_resume(struct target *target, int current,
 	uint32_t address, int handle_breakpoints, int debug_execution)
 {
@@ -755,7 +896,7 @@ static int cortex_m_resume(struct target *target, int current,
 				breakpoint->unique_id);
 			cortex_m_unset_breakpoint(target, breakpoint);
 			cortex_m_single_step_core(target);
-			cortex_m_set_breakpoint(target, breakpoint);
+			cortex_m_rearm_breakpoint(target, breakpoint);
 		}
 	}
 
@@ -930,7 +1071,7 @@ static int cortex_m_step(struct target *target, int current,
 	register_cache_invalidate(armv7m->arm.core_cache);
 
 	if (breakpoint)
-		cortex_m_set_breakpoint(target, breakpoint);
+		cortex_m_rearm_breakpoint(target, breakpoint);
 
 	if (isr_timed_out) {
 		/* Leave the core running. The user has to stop execution manually. */
@@ -955,6 +1096,45 @@ static int cortex_m_step(struct target *target, int current,
 	return ERROR_OK;
 }
 
+/* After a software reset with VC_CORERESET set, the core halts within
+ * microseconds.  Rather than sleeping a fixed time, poll DHCSR in queued
+ * batches until it has seen the reset and the halt; this gives up after
+ * CORTEX_M_RESET_POLL_TIMEOUT and leaves the rest to target_wait_state().
+ */
+#define CORTEX_M_RESET_POLL_BATCH	8
+#define CORTEX_M_RESET_POLL_TIMEOUT	50	/* ms */
+
+static void cortex_m_wait_reset_halt(struct target *target)
+{
+	struct armv7m_common *armv7m = &target_to_cm(target)->armv7m;
+	uint32_t dhcsr[CORTEX_M_RESET_POLL_BATCH];
+	bool reset_seen = false;
+	int64_t then = timeval_ms();
+	int i;
+
+	do {
+		for (i = 0; i < CORTEX_M_RESET_POLL_BATCH; i++) {
+			if (mem_ap_read_u32(armv7m->debug_ap, DCB_DHCSR, &dhcsr[i]) != ERROR_OK)
+				return;
+		}
+		if (dap_run(armv7m->debug_ap->dap) != ERROR_OK)
+			return;
+
+		/* S_RESET_ST is cleared by reading, any read may have it */
+		for (i = 0; i < CORTEX_M_RESET_POLL_BATCH; i++) {
+			if (dhcsr[i] & S_RESET_ST)
+				reset_seen = true;
+		}
+		if (reset_seen && (dhcsr[CORTEX_M_RESET_POLL_BATCH - 1] & S_HALT)) {
+			LOG_DEBUG("halted after reset in %" PRId64 " ms", timeval_ms() - then);
+			return;
+		}
+	} while (timeval_ms() - then < CORTEX_M_RESET_POLL_TIMEOUT);
+
+	LOG_DEBUG("no halt after reset yet, dcb_dhcsr 0x%" PRIx32,
+		dhcsr[CORTEX_M_RESET_POLL_BATCH - 1]);
+}
+
 static int cortex_m_assert_reset(struct target *target)
 {
 	struct cortex_m_common *cortex_m = target_to_cm(target);
@@ -1016,19 +1196,26 @@ static int cortex_m_assert_reset(struct target *target)
 		cortex_m_write_debug_halt_mask(target, 0, C_HALT);
 	} else {
 		/* Halt in debug on reset; endreset_event() restores DEMCR.
+		 * Queued with the writes above, and with AIRCR for a software
+		 * reset, so the whole setup is one transaction.
 		 *
 		 * REVISIT catching BUSERR presumably helps to defend against
 		 * bad vector table entries.  Should this include MMERR or
 		 * other flags too?
 		 */
 		int retval2;
-		retval2 = mem_ap_write_atomic_u32(armv7m->debug_ap, DCB_DEMCR,
+		retval2 = mem_ap_write_u32(armv7m->debug_ap, DCB_DEMCR,
 				TRCENA | VC_HARDERR | VC_BUSERR | VC_CORERESET);
 		if (retval != ERROR_OK || retval2 != ERROR_OK)
 			LOG_INFO("AP write error, reset will not halt");
 	}
 
+	bool poll_halt = false;
+
 	if (jtag_reset_config & RESET_HAS_SRST) {
+		if (dap_run(armv7m->debug_ap->dap) != ERROR_OK && target->reset_halt)
+			LOG_INFO("AP write error, reset will not halt");
+
 		/* default to asserting srst */
 		if (!srst_asserted)
 			adapter_assert_reset();
@@ -1050,9 +1237,11 @@ static int cortex_m_assert_reset(struct target *target)
 		}
 
 		int retval3;
-		retval3 = mem_ap_write_atomic_u32(armv7m->debug_ap, NVIC_AIRCR,
+		retval3 = mem_ap_write_u32(armv7m->debug_ap, NVIC_AIRCR,
 				AIRCR_VECTKEY | ((reset_config == CORTEX_M_RESET_SYSRESETREQ)
 				? AIRCR_SYSRESETREQ : AIRCR_VECTRESET));
+		if (retval3 == ERROR_OK)
+			retval3 = dap_run(armv7m->debug_ap->dap);
 		if (retval3 != ERROR_OK)
 			LOG_DEBUG("Ignoring AP write error right after reset");
 
@@ -1064,14 +1253,28 @@ static int cortex_m_assert_reset(struct target *target)
 			/* I do not know why this is necessary, but it
 			 * fixes strange effects (step/resume cause NMI
 			 * after reset) on LM3S6918 -- Michael Schwingen
+			 *
+			 * DEMCR is read back with it: the write above
+			 * could not be checked on its own.
 			 */
-			uint32_t tmp;
-			mem_ap_read_atomic_u32(armv7m->debug_ap, NVIC_AIRCR, &tmp);
+			uint32_t tmp, demcr = 0;
+			mem_ap_read_u32(armv7m->debug_ap, NVIC_AIRCR, &tmp);
+			mem_ap_read_u32(armv7m->debug_ap, DCB_DEMCR, &demcr);
+			retval3 = dap_run(armv7m->debug_ap->dap);
+			if (target->reset_halt) {
+				if (retval3 == ERROR_OK && (demcr & VC_CORERESET))
+					poll_halt = true;
+				else
+					LOG_INFO("AP write error, reset will not halt");
+			}
 		}
 	}
 
 	target->state = TARGET_RESET;
-	jtag_add_sleep(50000);
+	if (poll_halt)
+		cortex_m_wait_reset_halt(target);
+	else
+		jtag_add_sleep(50000);
 
 	register_cache_invalidate(cortex_m->armv7m.arm.core_cache);
 
@@ -1563,6 +1766,83 @@ static int cortex_m_load_core_reg_u32(struct target *target,
 	return ERROR_OK;
 }
 
+/* Queues DCRSR/DCRDR accesses for all @a count registers and flushes
+ * the DAP once, instead of once per register. */
+static int cortex_m_load_core_regs_u32(struct target *target,
+		const uint32_t *num, uint32_t *value, unsigned count)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	unsigned i;
+	int retval;
+
+	/* the emulated DCC channel needs DCRDR saved around every access */
+	if (target->dbg_msg_enabled) {
+		for (i = 0; i < count; i++) {
+			retval = cortex_m_load_core_reg_u32(target, num[i], &value[i]);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		return ERROR_OK;
+	}
+
+	for (i = 0; i < count; i++) {
+		uint32_t regsel;
+
+		switch (num[i]) {
+			case 0 ... 18:
+				regsel = num[i];
+				break;
+			case ARMV7M_FPSCR:
+				regsel = 0x21;
+				break;
+			case ARMV7M_S0 ... ARMV7M_S31:
+				regsel = num[i] - ARMV7M_S0 + 0x40;
+				break;
+			case ARMV7M_PRIMASK:
+			case ARMV7M_BASEPRI:
+			case ARMV7M_FAULTMASK:
+			case ARMV7M_CONTROL:
+				regsel = 20;
+				break;
+			default:
+				return ERROR_COMMAND_SYNTAX_ERROR;
+		}
+
+		retval = mem_ap_write_u32(armv7m->debug_ap, DCB_DCRSR, regsel);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DCRDR, &value[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	retval = dap_run(armv7m->debug_ap->dap);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("JTAG failure %i", retval);
+		return ERROR_JTAG_DEVICE_ERROR;
+	}
+
+	for (i = 0; i < count; i++) {
+		switch (num[i]) {
+			case ARMV7M_PRIMASK:
+				value[i] = buf_get_u32((uint8_t *)&value[i], 0, 1);
+				break;
+			case ARMV7M_BASEPRI:
+				value[i] = buf_get_u32((uint8_t *)&value[i], 8, 8);
+				break;
+			case ARMV7M_FAULTMASK:
+				value[i] = buf_get_u32((uint8_t *)&value[i], 16, 1);
+				break;
+			case ARMV7M_CONTROL:
+				value[i] = buf_get_u32((uint8_t *)&value[i], 24, 2);
+				break;
+		}
+		LOG_DEBUG("load from core reg %i value 0x%" PRIx32 "", (int)num[i], value[i]);
+	}
+
+	return ERROR_OK;
+}
+
 static int cortex_m_store_core_reg_u32(struct target *target,
 		uint32_t num, uint32_t value)
 {
@@ -1679,6 +1959,35 @@ static int cortex_m_write_memory(struct target *target, uint32_t address,
 	return mem_ap_write_buf(armv7m->debug_ap, buffer, size, count, address);
 }
 
+/*
+ * With packed transfers the MEM-AP moves four bytes per DRW access at any
+ * alignment, so an unaligned buffer is transferred in one run of byte
+ * accesses instead of being split into byte, halfword and word pieces that
+ * each need a round trip. Aligned buffers keep the default handling, which
+ * guarantees word accesses to peripheral registers.
+ */
+static int cortex_m_read_buffer(struct target *target, uint32_t address,
+	uint32_t count, uint8_t *buffer)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	if (armv7m->debug_ap->packed_transfers && ((address | count) & 0x3u))
+		return mem_ap_read_buf(armv7m->debug_ap, buffer, 1, count, address);
+
+	return target_read_buffer_default(target, address, count, buffer);
+}
+
+static int cortex_m_write_buffer(struct target *target, uint32_t address,
+	uint32_t count, const uint8_t *buffer)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	if (armv7m->debug_ap->packed_transfers && ((address | count) & 0x3u))
+		return mem_ap_write_buf(armv7m->debug_ap, buffer, 1, count, address);
+
+	return target_write_buffer_default(target, address, count, buffer);
+}
+
 static int cortex_m_init_target(struct command_context *cmd_ctx,
 	struct target *target)
 {
@@ -1787,6 +2096,7 @@ void cortex_m_dwt_setup(struct cortex_m_common *cm, struct target *target)
 	int reg, i;
 
 	target_read_u32(target, DWT_CTRL, &dwtcr);
+	cm->dwtcr_id = dwtcr & DWT_CTRL_ID_MASK;
 	if (!dwtcr) {
 		LOG_DEBUG("no DWT");
 		return;
@@ -1875,6 +2185,84 @@ static void cortex_m_dwt_free(struct target *target)
 #define MVFR0_DEFAULT_M4 0x10110021
 #define MVFR1_DEFAULT_M4 0x11000011
 
+/* Check the MEM-AP found before by its IDR, which saves searching the
+ * APs again when the DAP is initialized after a power cycle. */
+static bool cortex_m_debug_ap_matches(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct adiv5_ap *ap = cortex_m->armv7m.debug_ap;
+	uint32_t idr;
+
+	if (ap == NULL || cortex_m->debug_ap_idr == 0)
+		return false;
+
+	int retval = dap_queue_ap_read(ap, AP_REG_IDR, &idr);
+	if (retval == ERROR_OK)
+		retval = dap_run(ap->dap);
+
+	return retval == ERROR_OK && idr == cortex_m->debug_ap_idr;
+}
+
+/* Reattach to the core examined before: if CPUID and the sizes of the
+ * FPB and DWT still match, only the debug state that examine sets up
+ * is restored, the register caches and comparator lists are kept. */
+static int cortex_m_reattach(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct armv7m_common *armv7m = &cortex_m->armv7m;
+	struct adiv5_ap *ap = armv7m->debug_ap;
+	uint32_t cpuid, fpcr, dwtcr;
+	int retval;
+	int i;
+
+	if (cortex_m->cpuid == 0)
+		return ERROR_FAIL;
+
+	retval = mem_ap_read_u32(ap, CPUID, &cpuid);
+	if (retval == ERROR_OK)
+		retval = mem_ap_read_u32(ap, FP_CTRL, &fpcr);
+	if (retval == ERROR_OK)
+		retval = mem_ap_read_u32(ap, DWT_CTRL, &dwtcr);
+	if (retval == ERROR_OK)
+		retval = dap_run(ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (cpuid != cortex_m->cpuid || (fpcr & FP_CTRL_ID_MASK) != cortex_m->fpcr_id
+			|| (dwtcr & DWT_CTRL_ID_MASK) != cortex_m->dwtcr_id) {
+		LOG_DEBUG("cpuid 0x%8.8" PRIx32 ", fpcr 0x%8.8" PRIx32 ", dwtcr 0x%8.8" PRIx32
+				" differ, examining the core again", cpuid, fpcr, dwtcr);
+		return ERROR_FAIL;
+	}
+
+	retval = target_write_u32(target, DCB_DEMCR, TRCENA | armv7m->demcr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (armv7m->trace_config.config_type != DISABLED) {
+		armv7m_trace_tpiu_config(target);
+		armv7m_trace_itm_config(target);
+	}
+
+	/* clear the comparators, as examine does */
+	cortex_m->fpb_enabled = fpcr & 1;
+	cortex_m->fp_code_available = cortex_m->fp_num_code;
+	for (i = 0; i < cortex_m->fp_num_code + cortex_m->fp_num_lit; i++) {
+		cortex_m->fp_comparator_list[i].used = 0;
+		mem_ap_write_u32(ap, cortex_m->fp_comparator_list[i].fpcr_address, 0);
+	}
+
+	cortex_m->dwt_comp_available = cortex_m->dwt_num_comp;
+	for (i = 0; i < cortex_m->dwt_num_comp; i++) {
+		cortex_m->dwt_comparator_list[i].used = 0;
+		mem_ap_write_u32(ap, cortex_m->dwt_comparator_list[i].dwt_comparator_address + 8, 0);
+	}
+	if (cortex_m->dwt_cache)
+		register_cache_invalidate(cortex_m->dwt_cache);
+
+	return dap_run(ap->dap);
+}
+
 int cortex_m_examine(struct target *target)
 {
 	int retval;
@@ -1893,11 +2281,23 @@ int cortex_m_examine(struct target *target)
 			return retval;
 		}
 
-		/* Search for the MEM-AP */
-		retval = dap_find_ap(swjdp, AP_TYPE_AHB_AP, &armv7m->debug_ap);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Could not find MEM-AP to control the core");
-			return retval;
+		if (!cortex_m_debug_ap_matches(target)) {
+			/* Search for the MEM-AP */
+			retval = dap_find_ap(swjdp, AP_TYPE_AHB_AP, &armv7m->debug_ap);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("Could not find MEM-AP to control the core");
+				return retval;
+			}
+
+			retval = dap_queue_ap_read(armv7m->debug_ap, AP_REG_IDR,
+					&cortex_m->debug_ap_idr);
+			if (retval == ERROR_OK)
+				retval = dap_run(swjdp);
+			if (retval != ERROR_OK)
+				return retval;
+
+			/* a different AP, so it is a different core too */
+			cortex_m->cpuid = 0;
 		}
 
 		/* Leave (only) generic DAP stuff for debugport_init(); */
@@ -1908,6 +2308,13 @@ int cortex_m_examine(struct target *target)
 			return retval;
 	}
 
+	if (!target_was_examined(target) && !armv7m->stlink &&
+			cortex_m_reattach(target) == ERROR_OK) {
+		LOG_INFO("%s: reattached to the same core", target_name(target));
+		target_set_examined(target);
+		return ERROR_OK;
+	}
+
 	if (!target_was_examined(target)) {
 		target_set_examined(target);
 
@@ -1929,6 +2336,7 @@ int cortex_m_examine(struct target *target)
 				LOG_WARNING("Silicon bug: single stepping will enter pending exception handler!");
 		}
 		LOG_DEBUG("cpuid: 0x%8.8" PRIx32 "", cpuid);
+		cortex_m->cpuid = cpuid;
 
 		/* test for floating point feature on Cortex-M4 */
 		if (i == 4) {
@@ -1946,16 +2354,8 @@ int cortex_m_examine(struct target *target)
 
 		if (armv7m->fp_feature != FPv4_SP &&
 		    armv7m->arm.core_cache->num_regs > ARMV7M_NUM_CORE_REGS_NOFP) {
-			/* free unavailable FPU registers */
-			size_t idx;
-
-			for (idx = ARMV7M_NUM_CORE_REGS_NOFP;
-			     idx < armv7m->arm.core_cache->num_regs;
-			     idx++) {
-				free(armv7m->arm.core_cache->reg_list[idx].value);
-				free(armv7m->arm.core_cache->reg_list[idx].feature);
-				free(armv7m->arm.core_cache->reg_list[idx].reg_data_type);
-			}
+			/* hide unavailable FPU registers, their storage is part
+			 * of the cache's blocks and freed with it */
 			armv7m->arm.core_cache->num_regs = ARMV7M_NUM_CORE_REGS_NOFP;
 		}
 
@@ -1986,6 +2386,7 @@ int cortex_m_examine(struct target *target)
 		/* Detect flash patch revision, see RM DDI 0403E.b page C1-817.
 		   Revision is zero base, fp_rev == 1 means Rev.2 ! */
 		cortex_m->fp_rev = (fpcr >> 28) & 0xf;
+		cortex_m->fpcr_id = fpcr & FP_CTRL_ID_MASK;
 		free(cortex_m->fp_comparator_list);
 		cortex_m->fp_comparator_list = calloc(
 				cortex_m->fp_num_code + cortex_m->fp_num_lit,
@@ -2047,6 +2448,61 @@ static int cortex_m_dcc_read(struct target *target, uint8_t *value, uint8_t *ctr
 	return ERROR_OK;
 }
 
+/* Samples DWT_PCSR, which the debugger can read while the core keeps
+ * running; bursts of non-incrementing reads keep the adapter busy. */
+static int cortex_m_profiling(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	int64_t timeout;
+	uint32_t sample_count = 0;
+	uint32_t pcsr;
+	int retval;
+
+	/* PCSR is RAZ on cores without it, e.g. ARMv6-M */
+	retval = target_read_u32(target, DWT_PCSR, &pcsr);
+	if (retval != ERROR_OK)
+		return retval;
+	if (pcsr == 0)
+		return target_profiling_default(target, samples, max_num_samples,
+				num_samples, seconds);
+
+	/* called again for every chunk of samples, with the core running */
+	if (target->state == TARGET_HALTED) {
+		retval = target_resume(target, 1, 0, 0, 0);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	LOG_DEBUG("Sampling DWT_PCSR as fast as we can...");
+
+	timeout = timeval_ms() + seconds * 1000;
+
+	while (sample_count < max_num_samples) {
+		uint32_t burst = MIN(max_num_samples - sample_count, 1024);
+		uint8_t *buf = (uint8_t *)&samples[sample_count];
+
+		retval = mem_ap_read_buf_noincr(armv7m->debug_ap, buf, 4, burst, DWT_PCSR);
+		if (retval != ERROR_OK)
+			break;
+
+		/* all ones means the core was halted or could not be sampled */
+		for (uint32_t i = 0; i < burst; i++) {
+			uint32_t pc = target_buffer_get_u32(target, buf + 4 * i);
+			if (pc != 0xffffffff)
+				samples[sample_count++] = pc;
+		}
+
+		if (timeval_ms() >= timeout)
+			break;
+
+		keep_alive();
+	}
+
+	*num_samples = sample_count;
+	return retval;
+}
+
 static int cortex_m_target_request_data(struct target *target,
 	uint32_t size, uint8_t *buffer)
 {
@@ -2073,7 +2529,8 @@ static int cortex_m_handle_target_request(void *priv)
 	if (!target->dbg_msg_enabled)
 		return ERROR_OK;
 
-	if (target->state == TARGET_RUNNING) {
+	/* drain everything the target has queued up, within a budget */
+	for (int n = 0; n < TARGET_REQ_BURST_WORDS && target->state == TARGET_RUNNING; n++) {
 		uint8_t data;
 		uint8_t ctrl;
 		int retval;
@@ -2083,19 +2540,20 @@ static int cortex_m_handle_target_request(void *priv)
 			return retval;
 
 		/* check if we have data */
-		if (ctrl & (1 << 0)) {
-			uint32_t request;
+		if (!(ctrl & (1 << 0)))
+			break;
 
-			/* we assume target is quick enough */
-			request = data;
-			for (int i = 1; i <= 3; i++) {
-				retval = cortex_m_dcc_read(target, &data, &ctrl);
-				if (retval != ERROR_OK)
-					return retval;
-				request |= ((uint32_t)data << (i * 8));
-			}
-			target_request(target, request);
+		uint32_t request;
+
+		/* we assume target is quick enough */
+		request = data;
+		for (int i = 1; i <= 3; i++) {
+			retval = cortex_m_dcc_read(target, &data, &ctrl);
+			if (retval != ERROR_OK)
+				return retval;
+			request |= ((uint32_t)data << (i * 8));
 		}
+		target_request(target, request);
 	}
 
 	return ERROR_OK;
@@ -2131,6 +2589,7 @@ static int cortex_m_init_arch_info(struct target *target,
 
 	armv7m->load_core_reg_u32 = cortex_m_load_core_reg_u32;
 	armv7m->store_core_reg_u32 = cortex_m_store_core_reg_u32;
+	armv7m->load_core_regs_u32 = cortex_m_load_core_regs_u32;
 
 	target_register_timer_callback(cortex_m_handle_target_request, 1, 1, target);
 
@@ -2329,6 +2788,161 @@ COMMAND_HANDLER(handle_cortex_m_reset_config_command)
 	return ERROR_OK;
 }
 
+/* The DWT profiling counters, 8 bits wide, see "cortex_m benchmark" */
+static const struct {
+	const char *name;
+	uint32_t address;
+} dwt_event_counters[] = {
+	{ "cpi", DWT_CPICNT, },
+	{ "exc", DWT_EXCCNT, },
+	{ "sleep", DWT_SLEEPCNT, },
+	{ "lsu", DWT_LSUCNT, },
+	{ "fold", DWT_FOLDCNT, },
+};
+
+#define CORTEX_M_BENCHMARK_TIMEOUT	1000	/* ms per call */
+
+/* Calls entry with r0.. set to args and the return address at the
+ * breakpoint at exit_point.  The counters run from the resume to the
+ * halt, they are zeroed before and read back after. */
+static int cortex_m_benchmark_call(struct target *target,
+		uint32_t entry, uint32_t exit_point, unsigned argc, const uint32_t *args,
+		uint32_t *cycles, uint32_t *events)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	static const char * const arg_regs[] = { "r0", "r1", "r2", "r3" };
+	struct armv7m_algorithm armv7m_info;
+	struct reg_param reg_params[5];
+	unsigned i;
+	int retval;
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "lr", 32, PARAM_OUT);
+	buf_set_u32(reg_params[0].value, 0, 32, exit_point | 1);
+	for (i = 0; i < argc; i++) {
+		init_reg_param(&reg_params[1 + i], (char *)arg_regs[i], 32, PARAM_OUT);
+		buf_set_u32(reg_params[1 + i].value, 0, 32, args[i]);
+	}
+
+	retval = mem_ap_write_u32(armv7m->debug_ap, DWT_CYCCNT, 0);
+	for (i = 0; i < ARRAY_SIZE(dwt_event_counters) && retval == ERROR_OK; i++)
+		retval = mem_ap_write_u32(armv7m->debug_ap, dwt_event_counters[i].address, 0);
+	if (retval == ERROR_OK)
+		retval = dap_run(armv7m->debug_ap->dap);
+
+	if (retval == ERROR_OK)
+		retval = target_run_algorithm(target, 0, NULL, 1 + argc, reg_params,
+				entry, exit_point, CORTEX_M_BENCHMARK_TIMEOUT, &armv7m_info);
+
+	if (retval == ERROR_OK)
+		retval = mem_ap_read_u32(armv7m->debug_ap, DWT_CYCCNT, cycles);
+	for (i = 0; i < ARRAY_SIZE(dwt_event_counters) && retval == ERROR_OK; i++)
+		retval = mem_ap_read_u32(armv7m->debug_ap, dwt_event_counters[i].address, &events[i]);
+	if (retval == ERROR_OK)
+		retval = dap_run(armv7m->debug_ap->dap);
+
+	for (i = 0; i < 1 + argc; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return retval;
+}
+
+COMMAND_HANDLER(handle_cortex_m_benchmark_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct armv7m_common *armv7m = &cortex_m->armv7m;
+	struct working_area *exit_area;
+	uint32_t entry, iterations = 100, args[4];
+	uint32_t dwt_ctrl, cycles, base_cycles, events[ARRAY_SIZE(dwt_event_counters)];
+	uint32_t min = UINT32_MAX, max = 0;
+	uint64_t total = 0, event_total[ARRAY_SIZE(dwt_event_counters)] = { 0 };
+	unsigned argc = 0, i;
+	int retval;
+
+	retval = cortex_m_verify_pointer(CMD_CTX, cortex_m);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 6)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], entry);
+	if (CMD_ARGC > 1)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], iterations);
+	for (argc = 0; argc + 2 < CMD_ARGC; argc++)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[argc + 2], args[argc]);
+	if (iterations == 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (target->state != TARGET_HALTED) {
+		command_print(CMD_CTX, "target must be stopped for \"%s\" command", CMD_NAME);
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	retval = mem_ap_read_atomic_u32(armv7m->debug_ap, DWT_CTRL, &dwt_ctrl);
+	if (retval != ERROR_OK)
+		return retval;
+	if (dwt_ctrl & DWT_CTRL_NOCYCCNT) {
+		LOG_ERROR("%s has no DWT cycle counter", target_name(target));
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	/* the function returns to a breakpoint */
+	retval = target_alloc_working_area(target, 2, &exit_area);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("no working area for the return breakpoint");
+		return retval;
+	}
+	retval = target_write_u16(target, exit_area->address, ARMV5_T_BKPT(0) & 0xffff);
+	if (retval != ERROR_OK)
+		goto out;
+
+	/* DEMCR.TRCENA is kept set by endreset_event() */
+	retval = mem_ap_write_atomic_u32(armv7m->debug_ap, DWT_CTRL,
+			dwt_ctrl | DWT_CTRL_CYCCNTENA | DWT_CTRL_CPIEVTENA | DWT_CTRL_EXCEVTENA |
+			DWT_CTRL_SLEEPEVTENA | DWT_CTRL_LSUEVTENA | DWT_CTRL_FOLDEVTENA);
+	if (retval != ERROR_OK)
+		goto out;
+
+	/* what it costs to resume straight into the breakpoint */
+	retval = cortex_m_benchmark_call(target, exit_area->address, exit_area->address,
+			0, NULL, &base_cycles, events);
+	if (retval != ERROR_OK)
+		goto restore;
+
+	for (uint32_t n = 0; n < iterations; n++) {
+		retval = cortex_m_benchmark_call(target, entry & ~1, exit_area->address,
+				argc, args, &cycles, events);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("call %" PRIu32 " of 0x%8.8" PRIx32 " failed", n, entry);
+			goto restore;
+		}
+
+		cycles = cycles > base_cycles ? cycles - base_cycles : 0;
+		min = MIN(min, cycles);
+		max = MAX(max, cycles);
+		total += cycles;
+		for (i = 0; i < ARRAY_SIZE(dwt_event_counters); i++)
+			event_total[i] += events[i];
+		keep_alive();
+	}
+
+	command_print(CMD_CTX, "cycles_min %" PRIu32 " cycles", min);
+	command_print(CMD_CTX, "cycles_avg %.1f cycles", (double)total / iterations);
+	command_print(CMD_CTX, "cycles_max %" PRIu32 " cycles", max);
+	for (i = 0; i < ARRAY_SIZE(dwt_event_counters); i++)
+		command_print(CMD_CTX, "%s_avg %.1f cycles", dwt_event_counters[i].name,
+				(double)event_total[i] / iterations);
+
+restore:
+	mem_ap_write_atomic_u32(armv7m->debug_ap, DWT_CTRL, dwt_ctrl);
+out:
+	target_free_working_area(target, exit_area);
+	return retval;
+}
+
 static const struct command_registration cortex_m_exec_command_handlers[] = {
 	{
 		.name = "maskisr",
@@ -2351,6 +2965,14 @@ static const struct command_registration cortex_m_exec_command_handlers[] = {
 		.help = "configure software reset handling",
 		.usage = "['srst'|'sysresetreq'|'vectreset']",
 	},
+	{
+		.name = "benchmark",
+		.handler = handle_cortex_m_benchmark_command,
+		.mode = COMMAND_EXEC,
+		.help = "call a function repeatedly and report the cycles it "
+			"takes, counted by the DWT",
+		.usage = "address [iterations [r0 [r1 [r2 [r3]]]]]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 static const struct command_registration cortex_m_command_handlers[] = {
@@ -2360,6 +2982,9 @@ static const struct command_registration cortex_m_command_handlers[] = {
 	{
 		.chain = armv7m_trace_command_handlers,
 	},
+	{
+		.chain = live_watch_command_handlers,
+	},
 	{
 		.name = "cortex_m",
 		.mode = COMMAND_EXEC,
@@ -2375,9 +3000,11 @@ struct target_type cortexm_target = {
 	.deprecated_name = "cortex_m3",
 
 	.poll = cortex_m_poll,
+	.poll_queue = cortex_m_poll_queue,
 	.arch_state = armv7m_arch_state,
 
 	.target_request_data = cortex_m_target_request_data,
+	.profiling = cortex_m_profiling,
 
 	.halt = cortex_m_halt,
 	.resume = cortex_m_resume,
@@ -2391,8 +3018,12 @@ struct target_type cortexm_target = {
 
 	.read_memory = cortex_m_read_memory,
 	.write_memory = cortex_m_write_memory,
+	.read_buffer = cortex_m_read_buffer,
+	.write_buffer = cortex_m_write_buffer,
 	.checksum_memory = armv7m_checksum_memory,
 	.blank_check_memory = armv7m_blank_check_memory,
+	.blank_check_memory_blocks = armv7m_blank_check_memory_blocks,
+	.fill_memory = armv7m_fill_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
 	.start_algorithm = armv7m_start_algorithm,
@@ -47,12 +47,30 @@
 #define DCRSR_WnR	(1 << 16)
 
 #define DWT_CTRL	0xE0001000
+#define DWT_CTRL_CYCCNTENA	(1 << 0)
+#define DWT_CTRL_SYNCTAP_24	(1 << 10)
+#define DWT_CTRL_SYNCTAP_MASK	(3 << 10)
+#define DWT_CTRL_CPIEVTENA	(1 << 17)
+#define DWT_CTRL_EXCEVTENA	(1 << 18)
+#define DWT_CTRL_SLEEPEVTENA	(1 << 19)
+#define DWT_CTRL_LSUEVTENA	(1 << 20)
+#define DWT_CTRL_FOLDEVTENA	(1 << 21)
+#define DWT_CTRL_NOPRFCNT	(1 << 24)
+#define DWT_CTRL_NOCYCCNT	(1 << 25)
+#define DWT_CTRL_ID_MASK	0xFF000000	/* NUMCOMP and the NO* feature bits */
 #define DWT_CYCCNT	0xE0001004
+#define DWT_CPICNT	0xE0001008
+#define DWT_EXCCNT	0xE000100C
+#define DWT_SLEEPCNT	0xE0001010
+#define DWT_LSUCNT	0xE0001014
+#define DWT_FOLDCNT	0xE0001018
 #define DWT_COMP0	0xE0001020
 #define DWT_MASK0	0xE0001024
 #define DWT_FUNCTION0	0xE0001028
+#define DWT_PCSR	0xE000101C
 
 #define FP_CTRL		0xE0002000
+#define FP_CTRL_ID_MASK	0xF0007FF0	/* REV, NUM_CODE and NUM_LIT */
 #define FP_REMAP	0xE0002004
 #define FP_COMP0	0xE0002008
 #define FP_COMP1	0xE000200C
@@ -183,6 +201,13 @@ struct cortex_m_common {
 	struct cortex_m_dwt_comparator *dwt_comparator_list;
 	struct reg_cache *dwt_cache;
 
+	/* Identity of the core as last examined, so it can be recognized
+	 * when it is reattached after a power cycle */
+	uint32_t cpuid;
+	uint32_t fpcr_id;
+	uint32_t dwtcr_id;
+	uint32_t debug_ap_idr;
+
 	enum cortex_m_soft_reset_config soft_reset_config;
 
 	enum cortex_m_isrmasking_mode isrmasking_mode;
@@ -539,7 +539,7 @@ static int dsp563xx_reg_write_high_io(struct target *target, uint32_t instr_mask
 	return ERROR_OK;
 }
 
-static int dsp563xx_reg_read(struct target *target, uint32_t eame, uint32_t *data)
+static int dsp563xx_reg_read(struct target *target, int flush, uint32_t eame, uint32_t *data)
 {
 	int err;
 	uint32_t instr;
@@ -549,11 +549,11 @@ static int dsp563xx_reg_read(struct target *target, uint32_t eame, uint32_t *dat
 	if (err != ERROR_OK)
 		return err;
 	/* nop */
-	err = dsp563xx_once_execute_sw_ir(target->tap, 1, 0x000000);
+	err = dsp563xx_once_execute_sw_ir(target->tap, 0, 0x000000);
 	if (err != ERROR_OK)
 		return err;
 	/* read debug register */
-	return dsp563xx_once_reg_read(target->tap, 1, DSP563XX_ONCE_OGDBR, data);
+	return dsp563xx_once_reg_read(target->tap, flush, DSP563XX_ONCE_OGDBR, data);
 }
 
 static int dsp563xx_reg_write(struct target *target, uint32_t instr_mask, uint32_t data)
@@ -645,7 +645,7 @@ static int dsp563xx_reg_ssh_read(struct target *target)
 	if (!sp)
 		sp = 0x00FFFFFF;
 	else {
-		err = dsp563xx_reg_read(target, arch_info->eame, &sp);
+		err = dsp563xx_reg_read(target, 1, arch_info->eame, &sp);
 		if (err != ERROR_OK)
 			return err;
 
@@ -726,7 +726,7 @@ static int dsp563xx_reg_ssl_read(struct target *target)
 	if (!sp)
 		sp = 0x00FFFFFF;
 	else {
-		err = dsp563xx_reg_read(target, arch_info->eame, &sp);
+		err = dsp563xx_reg_read(target, 1, arch_info->eame, &sp);
 		if (err != ERROR_OK)
 			return err;
 	}
@@ -737,6 +737,27 @@ static int dsp563xx_reg_ssl_read(struct target *target)
 	return ERROR_OK;
 }
 
+/* registers read by a plain move to the debug register, without side effects */
+static int dsp563xx_reg_is_plain(int num)
+{
+	switch (num) {
+		case DSP563XX_REG_IDX_SSH:
+		case DSP563XX_REG_IDX_SSL:
+		case DSP563XX_REG_IDX_PC:
+		case DSP563XX_REG_IDX_IPRC:
+		case DSP563XX_REG_IDX_IPRP:
+		case DSP563XX_REG_IDX_BCR:
+		case DSP563XX_REG_IDX_DCR:
+		case DSP563XX_REG_IDX_AAR0:
+		case DSP563XX_REG_IDX_AAR1:
+		case DSP563XX_REG_IDX_AAR2:
+		case DSP563XX_REG_IDX_AAR3:
+			return 0;
+		default:
+			return 1;
+	}
+}
+
 static int dsp563xx_read_register(struct target *target, int num, int force)
 {
 	int err = ERROR_OK;
@@ -776,7 +797,7 @@ static int dsp563xx_read_register(struct target *target, int num, int force)
 				}
 				break;
 			default:
-				err = dsp563xx_reg_read(target, arch_info->eame, &data);
+				err = dsp563xx_reg_read(target, 1, arch_info->eame, &data);
 				if (err == ERROR_OK) {
 					dsp563xx->core_regs[num] = data;
 					dsp563xx->read_core_reg(target, num);
@@ -843,7 +864,36 @@ static int dsp563xx_write_register(struct target *target, int num, int force)
 static int dsp563xx_save_context(struct target *target)
 {
 	int i, err = ERROR_OK;
+	uint32_t data[DSP563XX_NUMCOREREGS];
+	int queued[DSP563XX_NUMCOREREGS];
+	struct dsp563xx_common *dsp563xx = target_to_dsp563xx(target);
+	struct dsp563xx_core_reg *arch_info;
+
+	/* queue all plain register reads and flush them in one go */
+	for (i = 0; i < DSP563XX_NUMCOREREGS; i++) {
+		arch_info = dsp563xx->core_cache->reg_list[i].arch_info;
+		data[i] = 0;
+		queued[i] = !dsp563xx->core_cache->reg_list[i].valid &&
+			dsp563xx_reg_is_plain(arch_info->num);
+		if (!queued[i])
+			continue;
+		err = dsp563xx_reg_read(target, 0, arch_info->eame, &data[i]);
+		if (err != ERROR_OK)
+			return err;
+	}
+
+	err = jtag_execute_queue();
+	if (err != ERROR_OK)
+		return err;
+
+	for (i = 0; i < DSP563XX_NUMCOREREGS; i++) {
+		if (!queued[i])
+			continue;
+		dsp563xx->core_regs[i] = data[i];
+		dsp563xx->read_core_reg(target, i);
+	}
 
+	/* the remaining registers need dedicated sequences */
 	for (i = 0; i < DSP563XX_NUMCOREREGS; i++) {
 		err = dsp563xx_read_register(target, i, 0);
 		if (err != ERROR_OK)
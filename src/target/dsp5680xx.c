@@ -1128,43 +1128,56 @@ static int dsp5680xx_read_16_single(struct target *t, uint32_t a,
 	return retval;
 }
 
-static int dsp5680xx_read_32_single(struct target *t, uint32_t a,
-				    uint8_t *data_read, int r_pmem)
+/**
+ * Queues the read of @words consecutive 16 bit words.
+ * The source address is loaded into r0 once and post-incremented by the
+ * core, r2 keeps pointing at the TX/RX register, so each word only costs
+ * two core instructions and the OTX read.
+ * The data is only valid after the JTAG queue has been executed.
+ *
+ * @param target
+ * @param address Word address.
+ * @param words
+ * @param data_read Receives the words, little endian.
+ * @param r_pmem
+ *
+ * @return
+ */
+static int dsp5680xx_read_16_block(struct target *target, uint32_t address,
+				   uint32_t words, uint8_t *data_read, int r_pmem)
 {
-	struct target *target = t;
-
-	uint32_t address = a;
-
 	int retval;
 
-	address = (address & 0xFFFFF);
-	/* Get data to an intermediate register */
+	int counter = FLUSH_COUNT_READ_WRITE;
+
+	dsp5680xx_context.flush = 0;
 	retval = core_move_long_to_r0(target, address);
 	err_check_propagate(retval);
-	if (r_pmem) {
-		retval = core_move_at_pr0_inc_to_y0(target);
-		err_check_propagate(retval);
-		retval = core_move_at_pr0_inc_to_y1(target);
-		err_check_propagate(retval);
-	} else {
-		retval = core_move_at_r0_inc_to_y0(target);
-		err_check_propagate(retval);
-		retval = core_move_at_r0_to_y1(target);
-		err_check_propagate(retval);
-	}
-	/* Get lower part of data to TX/RX */
-	retval = eonce_load_TX_RX_to_r0(target);
-	err_check_propagate(retval);
-	retval = core_move_y0_at_r0_inc(target);    /* This also load TX/RX high to r0 */
-	err_check_propagate(retval);
-	/* Get upper part of data to TX/RX */
-	retval = core_move_y1_at_r0(target);
-	err_check_propagate(retval);
-	/* at this point the data i want is at the reg eonce can read */
-	retval = core_rx_lower_data(target, data_read);
-	err_check_propagate(retval);
-	retval = core_rx_upper_data(target, data_read + 2);
+	retval =
+		core_move_long_to_r2(target,
+				     ((MC568013_EONCE_TX_RX_ADDR) +
+				      (MC568013_EONCE_OBASE_ADDR << 16)));
 	err_check_propagate(retval);
+
+	for (uint32_t i = 0; i < words; i++) {
+		if (--counter == 0) {
+			dsp5680xx_context.flush = 1;
+			counter = FLUSH_COUNT_READ_WRITE;
+		}
+		if (r_pmem)
+			retval = core_move_at_pr0_inc_to_y0(target);
+		else
+			retval = core_move_at_r0_inc_to_y0(target);
+		if (retval == ERROR_OK)
+			retval = core_move_y0_at_r2(target);
+		if (retval == ERROR_OK)
+			retval = core_rx_lower_data(target, data_read + 2 * i);
+		if (retval != ERROR_OK) {
+			dsp5680xx_context.flush = 1;
+			return retval;
+		}
+		dsp5680xx_context.flush = 0;
+	}
 	return retval;
 }
 
@@ -1183,47 +1196,45 @@ static int dsp5680xx_read(struct target *t, uint32_t a, uint32_t size,
 
 	int pmem = 1;
 
+	uint8_t last[2];
+
 	retval = dsp5680xx_convert_address(&address, &pmem);
 	err_check_propagate(retval);
 
-	dsp5680xx_context.flush = 0;
-	int counter = FLUSH_COUNT_READ_WRITE;
-
-	for (unsigned i = 0; i < count; i++) {
-		if (--counter == 0) {
-			dsp5680xx_context.flush = 1;
-			counter = FLUSH_COUNT_READ_WRITE;
-		}
-		switch (size) {
-		case 1:
-			if (!(i % 2))
-				retval =
-					dsp5680xx_read_16_single(target,
-								 address + i / 2,
-								 buffer + i, pmem);
-			break;
-		case 2:
-			retval =
-				dsp5680xx_read_16_single(target, address + i,
-							 buffer + 2 * i, pmem);
-			break;
-		case 4:
+	switch (size) {
+	case 1:
+		retval =
+			dsp5680xx_read_16_block(target, address, count / 2, buffer,
+						pmem);
+		/* odd byte count, don't write past the end of the buffer */
+		if ((retval == ERROR_OK) && (count % 2))
 			retval =
-				dsp5680xx_read_32_single(target, address + 2 * i,
-							 buffer + 4 * i, pmem);
-			break;
-		default:
-			LOG_USER("%s: Invalid read size.", __func__);
-			break;
-		}
-		err_check_propagate(retval);
-		dsp5680xx_context.flush = 0;
+				dsp5680xx_read_16_single(target, address + count / 2,
+							 last, pmem);
+		break;
+	case 2:
+		retval =
+			dsp5680xx_read_16_block(target, address, count, buffer,
+						pmem);
+		break;
+	case 4:
+		retval =
+			dsp5680xx_read_16_block(target, address & 0xFFFFF,
+						2 * count, buffer, pmem);
+		break;
+	default:
+		LOG_USER("%s: Invalid read size.", __func__);
+		break;
 	}
 
 	dsp5680xx_context.flush = 1;
+	err_check_propagate(retval);
 	retval = dsp5680xx_execute_queue();
 	err_check_propagate(retval);
 
+	if ((size == 1) && (count % 2))
+		buffer[count - 1] = last[0];
+
 	return retval;
 }
 
@@ -1250,29 +1261,55 @@ static int dsp5680xx_write_16_single(struct target *t, uint32_t a,
 	return retval;
 }
 
-static int dsp5680xx_write_32_single(struct target *t, uint32_t a,
-				     uint32_t data, int w_pmem)
+/**
+ * Queues the write of @words consecutive 16 bit words.
+ * The destination address is loaded into r0 once and post-incremented by
+ * the core, so each word only costs two core instructions.
+ *
+ * @param target
+ * @param address Word address.
+ * @param words
+ * @param data Little endian words.
+ * @param w_pmem
+ *
+ * @return
+ */
+static int dsp5680xx_write_16_block(struct target *target, uint32_t address,
+				    uint32_t words, const uint8_t *data,
+				    int w_pmem)
 {
-	struct target *target = t;
+	int retval;
 
-	uint32_t address = a;
+	uint16_t data_16;
 
-	int retval = ERROR_OK;
+	int counter = FLUSH_COUNT_READ_WRITE;
 
+	dsp5680xx_context.flush = 0;
 	retval = core_move_long_to_r0(target, address);
 	err_check_propagate(retval);
-	retval = core_move_long_to_y(target, data);
-	err_check_propagate(retval);
-	if (w_pmem)
-		retval = core_move_y0_at_pr0_inc(target);
-	else
-		retval = core_move_y0_at_r0_inc(target);
-	err_check_propagate(retval);
-	if (w_pmem)
-		retval = core_move_y1_at_pr0_inc(target);
-	else
-		retval = core_move_y1_at_r0_inc(target);
-	err_check_propagate(retval);
+
+	for (uint32_t i = 0; i < words; i++) {
+		if (--counter == 0) {
+			dsp5680xx_context.flush = 1;
+			counter = FLUSH_COUNT_READ_WRITE;
+		}
+		data_16 = (data[2 * i] | (data[2 * i + 1] << 8));
+		retval = core_move_value_to_y0(target, data_16);
+		if (retval == ERROR_OK) {
+			if (w_pmem)
+				retval = core_move_y0_at_pr0_inc(target);
+			else
+				retval = core_move_y0_at_r0_inc(target);
+		}
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s: Could not write to p:0x%04" PRIX32, __func__,
+				  address + i);
+			dsp5680xx_context.flush = 1;
+			return retval;
+		}
+		dsp5680xx_context.flush = 0;
+	}
+	dsp5680xx_context.flush = 1;
 	return retval;
 }
 
@@ -1289,30 +1326,10 @@ static int dsp5680xx_write_8(struct target *t, uint32_t a, uint32_t c,
 
 	int retval = 0;
 
-	uint16_t data_16;
-
-	uint32_t iter;
+	uint32_t iter = count / 2;
 
-	int counter = FLUSH_COUNT_READ_WRITE;
-
-	for (iter = 0; iter < count / 2; iter++) {
-		if (--counter == 0) {
-			dsp5680xx_context.flush = 1;
-			counter = FLUSH_COUNT_READ_WRITE;
-		}
-		data_16 = (data[2 * iter] | (data[2 * iter + 1] << 8));
-		retval =
-			dsp5680xx_write_16_single(target, address + iter, data_16,
-						  pmem);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("%s: Could not write to p:0x%04" PRIX32, __func__,
-				  address);
-			dsp5680xx_context.flush = 1;
-			return retval;
-		}
-		dsp5680xx_context.flush = 0;
-	}
-	dsp5680xx_context.flush = 1;
+	retval = dsp5680xx_write_16_block(target, address, iter, data, pmem);
+	err_check_propagate(retval);
 
 	/* Only one byte left, let's not overwrite the other byte (mem is 16bit) */
 	/* Need to retrieve the part we do not want to overwrite. */
@@ -1339,75 +1356,14 @@ static int dsp5680xx_write_8(struct target *t, uint32_t a, uint32_t c,
 static int dsp5680xx_write_16(struct target *t, uint32_t a, uint32_t c,
 			      const uint8_t *d, int pmem)
 {
-	struct target *target = t;
-
-	uint32_t address = a;
-
-	uint32_t count = c;
-
-	const uint8_t *data = d;
-
-	int retval = ERROR_OK;
-
-	uint32_t iter;
-
-	int counter = FLUSH_COUNT_READ_WRITE;
-
-	for (iter = 0; iter < count; iter++) {
-		if (--counter == 0) {
-			dsp5680xx_context.flush = 1;
-			counter = FLUSH_COUNT_READ_WRITE;
-		}
-		retval =
-			dsp5680xx_write_16_single(target, address + iter,
-						  data[iter], pmem);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("%s: Could not write to p:0x%04" PRIX32, __func__,
-				  address);
-			dsp5680xx_context.flush = 1;
-			return retval;
-		}
-		dsp5680xx_context.flush = 0;
-	}
-	dsp5680xx_context.flush = 1;
-	return retval;
+	return dsp5680xx_write_16_block(t, a, c, d, pmem);
 }
 
 static int dsp5680xx_write_32(struct target *t, uint32_t a, uint32_t c,
 			      const uint8_t *d, int pmem)
 {
-	struct target *target = t;
-
-	uint32_t address = a;
-
-	uint32_t count = c;
-
-	const uint8_t *data = d;
-
-	int retval = ERROR_OK;
-
-	uint32_t iter;
-
-	int counter = FLUSH_COUNT_READ_WRITE;
-
-	for (iter = 0; iter < count; iter++) {
-		if (--counter == 0) {
-			dsp5680xx_context.flush = 1;
-			counter = FLUSH_COUNT_READ_WRITE;
-		}
-		retval =
-			dsp5680xx_write_32_single(target, address + (iter << 1),
-						  data[iter], pmem);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("%s: Could not write to p:0x%04" PRIX32, __func__,
-				  address);
-			dsp5680xx_context.flush = 1;
-			return retval;
-		}
-		dsp5680xx_context.flush = 0;
-	}
-	dsp5680xx_context.flush = 1;
-	return retval;
+	/* low word first, same as moving y0 then y1 */
+	return dsp5680xx_write_16_block(t, a, 2 * c, d, pmem);
 }
 
 /**
@@ -1465,6 +1421,10 @@ static int dsp5680xx_write(struct target *t, uint32_t a, uint32_t s, uint32_t c,
 			  "Invalid data size.");
 		break;
 	}
+	err_check_propagate(retval);
+	/* status of the whole transfer is checked once */
+	retval = dsp5680xx_execute_queue();
+	err_check_propagate(retval);
 	return retval;
 }
 
@@ -156,13 +156,6 @@ struct reg_cache *etb_build_reg_cache(struct etb *etb)
 	return reg_cache;
 }
 
-static void etb_getbuf(jtag_callback_data_t arg)
-{
-	uint8_t *in = (uint8_t *)arg;
-
-	*((uint32_t *)arg) = buf_get_u32(in, 0, 32);
-}
-
 static int etb_read_ram(struct etb *etb, uint32_t *data, int num_frames)
 {
 	struct scan_field fields[3];
@@ -201,11 +194,15 @@ static int etb_read_ram(struct etb *etb, uint32_t *data, int num_frames)
 
 		fields[0].in_value = (uint8_t *)(data + i);
 		jtag_add_dr_scan(etb->tap, 3, fields, TAP_IDLE);
-
-		jtag_add_callback(etb_getbuf, (jtag_callback_data_t)(data + i));
 	}
 
-	jtag_execute_queue();
+	int retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* convert all frames at once rather than queueing a callback per frame */
+	for (i = 0; i < num_frames; i++)
+		data[i] = le_to_h_u32((uint8_t *)(data + i));
 
 	return ERROR_OK;
 }
@@ -545,7 +542,11 @@ static int etb_read_trace(struct etm_context *etm_ctx)
 
 	/* read data into temporary array for unpacking */
 	trace_data = malloc(sizeof(uint32_t) * num_frames);
-	etb_read_ram(etb, trace_data, num_frames);
+	int retval = etb_read_ram(etb, trace_data, num_frames);
+	if (retval != ERROR_OK) {
+		free(trace_data);
+		return retval;
+	}
 
 	if (etm_ctx->trace_depth > 0)
 		free(etm_ctx->trace_data);
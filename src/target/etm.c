@@ -642,62 +642,116 @@ static struct etm_capture_driver *etm_capture_drivers[] = {
 	NULL
 };
 
+static void etm_free_image(struct etm_context *ctx)
+{
+	if (!ctx->image)
+		return;
+
+	if (ctx->image_data) {
+		for (int i = 0; i < ctx->image->num_sections; i++)
+			free(ctx->image_data[i]);
+		free(ctx->image_data);
+		ctx->image_data = NULL;
+	}
+
+	image_close(ctx->image);
+	free(ctx->image);
+	ctx->image = NULL;
+}
+
+/* Read all image sections into memory once, so the trace analysis doesn't
+ * go through image_read_section() (and possibly the file) per instruction.
+ */
+static int etm_load_image(struct etm_context *ctx)
+{
+	struct image *image = ctx->image;
+	size_t size_read;
+	int retval;
+
+	ctx->image_data = calloc(image->num_sections, sizeof(uint8_t *));
+	if (!ctx->image_data)
+		return ERROR_FAIL;
+	ctx->image_section = 0;
+
+	for (int i = 0; i < image->num_sections; i++) {
+		ctx->image_data[i] = malloc(image->sections[i].size);
+		if (!ctx->image_data[i]) {
+			LOG_ERROR("no memory for image section %i", i);
+			return ERROR_FAIL;
+		}
+
+		retval = image_read_section(image, i, 0, image->sections[i].size,
+				ctx->image_data[i], &size_read);
+		if (retval != ERROR_OK || size_read != image->sections[i].size) {
+			LOG_ERROR("error while reading image section %i", i);
+			return ERROR_FAIL;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+static inline bool etm_image_section_contains(struct etm_context *ctx, int section,
+		uint32_t address, uint32_t size)
+{
+	struct imagesection *s = &ctx->image->sections[section];
+
+	return s->base_address <= address &&
+		s->base_address + s->size >= address + size;
+}
+
 static int etm_read_instruction(struct etm_context *ctx, struct arm_instruction *instruction)
 {
 	int i;
-	int section = -1;
-	size_t size_read;
+	int section;
+	uint32_t size;
 	uint32_t opcode;
-	int retval;
+	uint8_t *buf;
 
 	if (!ctx->image)
 		return ERROR_TRACE_IMAGE_UNAVAILABLE;
 
-	/* search for the section the current instruction belongs to */
-	for (i = 0; i < ctx->image->num_sections; i++) {
-		if ((ctx->image->sections[i].base_address <= ctx->current_pc) &&
-			(ctx->image->sections[i].base_address + ctx->image->sections[i].size >
-			ctx->current_pc)) {
-			section = i;
-			break;
-		}
+	if (ctx->core_state == ARM_STATE_JAZELLE) {
+		LOG_ERROR("BUG: tracing of jazelle code not supported");
+		return ERROR_FAIL;
+	} else if (ctx->core_state == ARM_STATE_ARM)
+		size = 4;
+	else if (ctx->core_state == ARM_STATE_THUMB)
+		size = 2;
+	else {
+		LOG_ERROR("BUG: unknown core state encountered");
+		return ERROR_FAIL;
 	}
 
-	if (section == -1) {
-		/* current instruction couldn't be found in the image */
-		return ERROR_TRACE_INSTRUCTION_UNAVAILABLE;
-	}
+	/* search for the section the current instruction belongs to,
+	 * starting with the one the previous instruction came from */
+	section = ctx->image_section;
+	if (section >= ctx->image->num_sections ||
+			!etm_image_section_contains(ctx, section, ctx->current_pc, size)) {
+		section = -1;
+		for (i = 0; i < ctx->image->num_sections; i++) {
+			if (etm_image_section_contains(ctx, i, ctx->current_pc, size)) {
+				section = i;
+				break;
+			}
+		}
 
-	if (ctx->core_state == ARM_STATE_ARM) {
-		uint8_t buf[4];
-		retval = image_read_section(ctx->image, section,
-				ctx->current_pc -
-				ctx->image->sections[section].base_address,
-				4, buf, &size_read);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("error while reading instruction");
+		if (section == -1) {
+			/* current instruction couldn't be found in the image */
 			return ERROR_TRACE_INSTRUCTION_UNAVAILABLE;
 		}
+		ctx->image_section = section;
+	}
+
+	buf = ctx->image_data[section] + (ctx->current_pc -
+			ctx->image->sections[section].base_address);
+
+	if (size == 4) {
 		opcode = target_buffer_get_u32(ctx->target, buf);
 		arm_evaluate_opcode(opcode, ctx->current_pc, instruction);
-	} else if (ctx->core_state == ARM_STATE_THUMB) {
-		uint8_t buf[2];
-		retval = image_read_section(ctx->image, section,
-				ctx->current_pc -
-				ctx->image->sections[section].base_address,
-				2, buf, &size_read);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("error while reading instruction");
-			return ERROR_TRACE_INSTRUCTION_UNAVAILABLE;
-		}
+	} else {
 		opcode = target_buffer_get_u16(ctx->target, buf);
 		thumb_evaluate_opcode(opcode, ctx->current_pc, instruction);
-	} else if (ctx->core_state == ARM_STATE_JAZELLE) {
-		LOG_ERROR("BUG: tracing of jazelle code not supported");
-		return ERROR_FAIL;
-	} else {
-		LOG_ERROR("BUG: unknown core state encountered");
-		return ERROR_FAIL;
 	}
 
 	return ERROR_OK;
@@ -1671,8 +1725,7 @@ COMMAND_HANDLER(handle_etm_image_command)
 	}
 
 	if (etm_ctx->image) {
-		image_close(etm_ctx->image);
-		free(etm_ctx->image);
+		etm_free_image(etm_ctx);
 		command_print(CMD_CTX, "previously loaded image found and closed");
 	}
 
@@ -1694,6 +1747,11 @@ COMMAND_HANDLER(handle_etm_image_command)
 		return ERROR_FAIL;
 	}
 
+	if (etm_load_image(etm_ctx) != ERROR_OK) {
+		etm_free_image(etm_ctx);
+		return ERROR_FAIL;
+	}
+
 	return ERROR_OK;
 }
 
@@ -37,6 +37,7 @@
 #include "armv7m.h"
 #include "cortex_m.h"
 #include "arm_semihosting.h"
+#include "live_watch.h"
 #include "target_request.h"
 
 #define savedDCRDR  dbgbase  /* FIXME: using target->dbgbase to preserve DCRDR */
@@ -49,6 +50,24 @@ static inline struct hl_interface_s *target_to_adapter(struct target *target)
 	return target->tap->priv;
 }
 
+/* Extract PRIMASK, BASEPRI, FAULTMASK or CONTROL from Debug Core register 20 */
+static uint32_t adapter_special_reg(uint32_t num, uint32_t value)
+{
+	switch (num) {
+	case ARMV7M_PRIMASK:
+		return buf_get_u32((uint8_t *) &value, 0, 1);
+
+	case ARMV7M_BASEPRI:
+		return buf_get_u32((uint8_t *) &value, 8, 8);
+
+	case ARMV7M_FAULTMASK:
+		return buf_get_u32((uint8_t *) &value, 16, 1);
+
+	default:
+		return buf_get_u32((uint8_t *) &value, 24, 2);
+	}
+}
+
 static int adapter_load_core_reg_u32(struct target *target,
 		uint32_t num, uint32_t *value)
 {
@@ -108,23 +127,7 @@ static int adapter_load_core_reg_u32(struct target *target,
 		if (retval != ERROR_OK)
 			return retval;
 
-		switch (num) {
-		case ARMV7M_PRIMASK:
-			*value = buf_get_u32((uint8_t *) value, 0, 1);
-			break;
-
-		case ARMV7M_BASEPRI:
-			*value = buf_get_u32((uint8_t *) value, 8, 8);
-			break;
-
-		case ARMV7M_FAULTMASK:
-			*value = buf_get_u32((uint8_t *) value, 16, 1);
-			break;
-
-		case ARMV7M_CONTROL:
-			*value = buf_get_u32((uint8_t *) value, 24, 2);
-			break;
-		}
+		*value = adapter_special_reg(num, *value);
 
 		LOG_DEBUG("load from special reg %i value 0x%" PRIx32 "",
 			  (int)num, *value);
@@ -137,6 +140,99 @@ static int adapter_load_core_reg_u32(struct target *target,
 	return ERROR_OK;
 }
 
+/* Reads r0..r15, xPSR, MSP and PSP with a single read_regs() when the
+ * adapter has it, the four special registers with a single read_reg(),
+ * and queues the DCRSR/DCRDR accesses of the floating-point registers
+ * so they're run as one batch. */
+static int adapter_load_core_regs_u32(struct target *target,
+		const uint32_t *num, uint32_t *value, unsigned count)
+{
+	struct hl_interface_s *adapter = target_to_adapter(target);
+	uint32_t core[HLA_CORE_REGS];
+	uint32_t special;
+	bool have_core = false, have_special = false;
+	uint8_t (*fpu)[8] = NULL;
+	int retval;
+
+	for (unsigned i = 0; i < count; i++) {
+		switch (num[i]) {
+		case 0 ... 18:
+			if (adapter->layout->api->read_regs == NULL)
+				break;
+			if (!have_core) {
+				retval = adapter->layout->api->read_regs(adapter->handle, core);
+				if (retval != ERROR_OK) {
+					LOG_ERROR("JTAG failure %i", retval);
+					retval = ERROR_JTAG_DEVICE_ERROR;
+					goto out;
+				}
+				have_core = true;
+			}
+			value[i] = core[num[i]];
+			continue;
+
+		case ARMV7M_PRIMASK:
+		case ARMV7M_BASEPRI:
+		case ARMV7M_FAULTMASK:
+		case ARMV7M_CONTROL:
+			if (!have_special) {
+				retval = adapter->layout->api->read_reg(adapter->handle, 20, &special);
+				if (retval != ERROR_OK)
+					goto out;
+				have_special = true;
+			}
+			value[i] = adapter_special_reg(num[i], special);
+			continue;
+
+		case ARMV7M_FPSCR:
+		case ARMV7M_S0 ... ARMV7M_S31:
+			/* queued below */
+			if (fpu == NULL) {
+				fpu = calloc(count, sizeof(*fpu));
+				if (fpu == NULL)
+					return ERROR_FAIL;
+			}
+			continue;
+		}
+
+		retval = adapter_load_core_reg_u32(target, num[i], &value[i]);
+		if (retval != ERROR_OK)
+			goto out;
+	}
+
+	if (fpu == NULL)
+		return ERROR_OK;
+
+	/* each one is a DCRSR write selecting the register and a DCRDR read */
+	for (unsigned i = 0; i < count; i++) {
+		uint32_t regsel;
+
+		if (num[i] == ARMV7M_FPSCR)
+			regsel = 33;
+		else if (num[i] >= ARMV7M_S0 && num[i] <= ARMV7M_S31)
+			regsel = num[i] - ARMV7M_S0 + 64;
+		else
+			continue;
+
+		target_buffer_set_u32(target, fpu[i], regsel);
+		hl_queue_write_mem(adapter, ARMV7M_SCS_DCRSR, 4, 1, fpu[i]);
+		hl_queue_read_mem(adapter, ARMV7M_SCS_DCRDR, 4, 1, fpu[i] + 4);
+	}
+
+	retval = hl_run_mem_queue(adapter);
+	if (retval != ERROR_OK)
+		goto out;
+
+	for (unsigned i = 0; i < count; i++) {
+		if (num[i] == ARMV7M_FPSCR || (num[i] >= ARMV7M_S0 && num[i] <= ARMV7M_S31))
+			value[i] = target_buffer_get_u32(target, fpu[i] + 4);
+	}
+
+out:
+	free(fpu);
+	return retval;
+}
+
 static int adapter_store_core_reg_u32(struct target *target,
 		uint32_t num, uint32_t value)
 {
@@ -288,26 +384,28 @@ static int hl_handle_target_request(void *priv)
 	if (!target->dbg_msg_enabled)
 		return ERROR_OK;
 
-	if (target->state == TARGET_RUNNING) {
+	/* drain everything the target has queued up, within a budget */
+	for (int n = 0; n < TARGET_REQ_BURST_WORDS && target->state == TARGET_RUNNING; n++) {
 		uint8_t data;
 		uint8_t ctrl;
 
 		hl_dcc_read(hl_if, &data, &ctrl);
 
 		/* check if we have data */
-		if (ctrl & (1 << 0)) {
-			uint32_t request;
-
-			/* we assume target is quick enough */
-			request = data;
-			hl_dcc_read(hl_if, &data, &ctrl);
-			request |= (data << 8);
-			hl_dcc_read(hl_if, &data, &ctrl);
-			request |= (data << 16);
-			hl_dcc_read(hl_if, &data, &ctrl);
-			request |= (data << 24);
-			target_request(target, request);
-		}
+		if (!(ctrl & (1 << 0)))
+			break;
+
+		uint32_t request;
+
+		/* we assume target is quick enough */
+		request = data;
+		hl_dcc_read(hl_if, &data, &ctrl);
+		request |= (data << 8);
+		hl_dcc_read(hl_if, &data, &ctrl);
+		request |= (data << 16);
+		hl_dcc_read(hl_if, &data, &ctrl);
+		request |= (data << 24);
+		target_request(target, request);
 	}
 
 	return ERROR_OK;
@@ -325,6 +423,7 @@ static int adapter_init_arch_info(struct target *target,
 	armv7m_init_arch_info(target, armv7m);
 
 	armv7m->load_core_reg_u32 = adapter_load_core_reg_u32;
+	armv7m->load_core_regs_u32 = adapter_load_core_regs_u32;
 	armv7m->store_core_reg_u32 = adapter_store_core_reg_u32;
 
 	armv7m->examine_debug_reason = adapter_examine_debug_reason;
@@ -364,6 +463,15 @@ static int adapter_load_context(struct target *target)
 {
 	struct armv7m_common *armv7m = target_to_armv7m(target);
 	int num_regs = armv7m->arm.core_cache->num_regs;
+	struct reg **regs = malloc(num_regs * sizeof(struct reg *));
+
+	if (regs != NULL) {
+		for (int i = 0; i < num_regs; i++)
+			regs[i] = &armv7m->arm.core_cache->reg_list[i];
+		if (armv7m_read_core_regs(target, regs, num_regs) != ERROR_OK)
+			LOG_DEBUG("batched register read failed, retrying one by one");
+		free(regs);
+	}
 
 	for (int i = 0; i < num_regs; i++) {
 
@@ -773,6 +881,9 @@ static const struct command_registration adapter_command_handlers[] = {
 	{
 		.chain = armv7m_trace_command_handlers,
 	},
+	{
+		.chain = live_watch_command_handlers,
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -803,6 +914,8 @@ struct target_type hla_target = {
 	.write_memory = adapter_write_memory,
 	.checksum_memory = armv7m_checksum_memory,
 	.blank_check_memory = armv7m_blank_check_memory,
+	.blank_check_memory_blocks = armv7m_blank_check_memory_blocks,
+	.fill_memory = armv7m_fill_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
 	.start_algorithm = armv7m_start_algorithm,
@@ -32,6 +32,7 @@
 #include "image.h"
 #include "target.h"
 #include <helper/log.h>
+#include <helper/binarybuffer.h>
 
 /* convert ELF header field to host endianness */
 #define field16(elf, field) \
@@ -186,16 +187,13 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 				full_address = (full_address & 0xffff0000) | address;
 			}
 
-			while (count-- > 0) {
-				unsigned value;
-				sscanf(&lpszLine[bytes_read], "%2x", &value);
-				ihex->buffer[cooked_bytes] = (uint8_t)value;
-				cal_checksum += (uint8_t)ihex->buffer[cooked_bytes];
-				bytes_read += 2;
-				cooked_bytes += 1;
-				section[image->num_sections].size += 1;
-				full_address++;
-			}
+			if (unhexify_sum(&ihex->buffer[cooked_bytes], &lpszLine[bytes_read],
+					count, &cal_checksum) != count)
+				return ERROR_IMAGE_FORMAT_ERROR;
+			bytes_read += 2 * count;
+			cooked_bytes += count;
+			section[image->num_sections].size += count;
+			full_address += count;
 		} else if (record_type == 1) {	/* End of File Record */
 			/* finish the current section */
 			image->num_sections++;
@@ -240,15 +238,12 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 				full_address = (full_address & 0xffff) | (upper_address << 4);
 			}
 		} else if (record_type == 3) {	/* Start Segment Address Record */
-			uint32_t dummy;
-
 			/* "Start Segment Address Record" will not be supported
 			 * but we must consume it, and do not create an error.  */
-			while (count-- > 0) {
-				sscanf(&lpszLine[bytes_read], "%2" SCNx32, &dummy);
-				cal_checksum += (uint8_t)dummy;
-				bytes_read += 2;
-			}
+			if (unhexify_sum(NULL, &lpszLine[bytes_read], count,
+					&cal_checksum) != count)
+				return ERROR_IMAGE_FORMAT_ERROR;
+			bytes_read += 2 * count;
 		} else if (record_type == 4) {	/* Extended Linear Address Record */
 			uint16_t upper_address;
 
@@ -552,13 +547,10 @@ static int image_mot_buffer_complete_inner(struct image *image,
 
 		if (record_type == 0) {
 			/* S0 - starting record (optional) */
-			int iValue;
-
-			while (count-- > 0) {
-				sscanf(&lpszLine[bytes_read], "%2x", &iValue);
-				cal_checksum += (uint8_t)iValue;
-				bytes_read += 2;
-			}
+			if (unhexify_sum(NULL, &lpszLine[bytes_read], count,
+					&cal_checksum) != count)
+				return ERROR_IMAGE_FORMAT_ERROR;
+			bytes_read += 2 * count;
 		} else if (record_type >= 1 && record_type <= 3) {
 			switch (record_type) {
 				case 1:
@@ -609,25 +601,19 @@ static int image_mot_buffer_complete_inner(struct image *image,
 				full_address = address;
 			}
 
-			while (count-- > 0) {
-				unsigned value;
-				sscanf(&lpszLine[bytes_read], "%2x", &value);
-				mot->buffer[cooked_bytes] = (uint8_t)value;
-				cal_checksum += (uint8_t)mot->buffer[cooked_bytes];
-				bytes_read += 2;
-				cooked_bytes += 1;
-				section[image->num_sections].size += 1;
-				full_address++;
-			}
+			if (unhexify_sum(&mot->buffer[cooked_bytes], &lpszLine[bytes_read],
+					count, &cal_checksum) != count)
+				return ERROR_IMAGE_FORMAT_ERROR;
+			bytes_read += 2 * count;
+			cooked_bytes += count;
+			section[image->num_sections].size += count;
+			full_address += count;
 		} else if (record_type == 5) {
 			/* S5 is the data count record, we ignore it */
-			uint32_t dummy;
-
-			while (count-- > 0) {
-				sscanf(&lpszLine[bytes_read], "%2" SCNx32, &dummy);
-				cal_checksum += (uint8_t)dummy;
-				bytes_read += 2;
-			}
+			if (unhexify_sum(NULL, &lpszLine[bytes_read], count,
+					&cal_checksum) != count)
+				return ERROR_IMAGE_FORMAT_ERROR;
+			bytes_read += 2 * count;
 		} else if (record_type >= 7 && record_type <= 9) {
 			/* S7, S8, S9 - ending records for 32, 24 and 16bit */
 			image->num_sections++;
@@ -901,6 +887,62 @@ int image_read_section(struct image *image,
 	return ERROR_OK;
 }
 
+/**
+ * Point @a data at @a size bytes of @a section without copying them.
+ * This works for images held in host memory (ihex, s19, builder) and
+ * for binary and ELF files the host could map; for anything else
+ * ERROR_IMAGE_TEMPORARILY_UNAVAILABLE is returned and the caller is
+ * expected to use image_read_section() instead.
+ */
+int image_section_data(struct image *image, int section, uint32_t offset,
+		uint32_t size, const uint8_t **data)
+{
+	if (offset + size > image->sections[section].size)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	switch (image->type) {
+	case IMAGE_IHEX:
+	case IMAGE_SRECORD:
+	case IMAGE_BUILDER:
+		*data = (const uint8_t *)image->sections[section].private + offset;
+		return ERROR_OK;
+	case IMAGE_BINARY: {
+		struct image_binary *image_binary = image->type_private;
+
+		if (fileio_data(image_binary->fileio, offset, size, data) == ERROR_OK)
+			return ERROR_OK;
+		break;
+	}
+	case IMAGE_ELF: {
+		struct image_elf *elf = image->type_private;
+		Elf32_Phdr *segment = image->sections[section].private;
+
+		if (offset + size <= field32(elf, segment->p_filesz) &&
+				fileio_data(elf->fileio, field32(elf, segment->p_offset) + offset,
+					size, data) == ERROR_OK)
+			return ERROR_OK;
+		break;
+	}
+	default:
+		break;
+	}
+
+	return ERROR_IMAGE_TEMPORARILY_UNAVAILABLE;
+}
+
+/* Sections of a builder image grow by doubling, so appending many small
+ * chunks (e.g. one per GDB vFlashWrite packet) does not move the whole
+ * section every time. The capacity is implied by the section size. */
+static uint32_t image_builder_capacity(uint32_t size)
+{
+	uint32_t capacity = 4096;
+
+	while (capacity < size && capacity < 0x80000000)
+		capacity *= 2;
+
+	return capacity < size ? size : capacity;
+}
+
 int image_add_section(struct image *image, uint32_t base, uint32_t size, int flags, uint8_t const *data)
 {
 	struct imagesection *section;
@@ -917,7 +959,13 @@ int image_add_section(struct image *image, uint32_t base, uint32_t size, int fla
 		 * adding data to previous sections or merging is not supported */
 		if (((section->base_address + section->size) == base) &&
 			(section->flags == flags)) {
-			section->private = realloc(section->private, section->size + size);
+			uint32_t new_size = section->size + size;
+			if (new_size > image_builder_capacity(section->size)) {
+				void *p = realloc(section->private, image_builder_capacity(new_size));
+				if (p == NULL)
+					return ERROR_FAIL;
+				section->private = p;
+			}
 			memcpy((uint8_t *)section->private + section->size, data, size);
 			section->size += size;
 			return ERROR_OK;
@@ -932,7 +980,9 @@ int image_add_section(struct image *image, uint32_t base, uint32_t size, int fla
 	section->base_address = base;
 	section->size = size;
 	section->flags = flags;
-	section->private = malloc(sizeof(uint8_t) * size);
+	section->private = malloc(image_builder_capacity(size));
+	if (section->private == NULL)
+		return ERROR_FAIL;
 	memcpy((uint8_t *)section->private, data, size);
 
 	return ERROR_OK;
@@ -1003,36 +1053,69 @@ void image_close(struct image *image)
 	}
 }
 
-int image_calculate_checksum(uint8_t *buffer, uint32_t nbytes, uint32_t *checksum)
+/* crc32_table[0] is the classic byte-wise table; crc32_table[k][i] is
+ * the CRC of byte i followed by k zero bytes, which lets the main loop
+ * fold CRC32_SLICES bytes per iteration ("slice-by-N") */
+#define CRC32_SLICES	16
+static uint32_t crc32_table[CRC32_SLICES][256];
+
+static void crc32_init_tables(void)
 {
-	uint32_t crc = 0xffffffff;
-	LOG_DEBUG("Calculating checksum");
+	static bool first_init;
+	int i, j;
+	unsigned int c;
 
-	static uint32_t crc32_table[256];
+	if (first_init)
+		return;
 
-	static bool first_init;
-	if (!first_init) {
-		/* Initialize the CRC table and the decoding table.  */
-		int i, j;
-		unsigned int c;
+	for (i = 0; i < 256; i++) {
+		/* as per gdb */
+		for (c = i << 24, j = 8; j > 0; --j)
+			c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
+		crc32_table[0][i] = c;
+	}
+	for (j = 1; j < CRC32_SLICES; j++)
 		for (i = 0; i < 256; i++) {
-			/* as per gdb */
-			for (c = i << 24, j = 8; j > 0; --j)
-				c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
-			crc32_table[i] = c;
+			c = crc32_table[j - 1][i];
+			crc32_table[j][i] = (c << 8) ^ crc32_table[0][c >> 24];
 		}
 
-		first_init = true;
-	}
+	first_init = true;
+}
+
+/* fold one big-endian word that sits 'pos' words before the end of a
+ * CRC32_SLICES byte block into the running CRC */
+static inline uint32_t crc32_word(uint32_t w, int pos)
+{
+	int t = 4 * pos + 3;
+
+	return crc32_table[t][w >> 24] ^
+		crc32_table[t - 1][(w >> 16) & 255] ^
+		crc32_table[t - 2][(w >> 8) & 255] ^
+		crc32_table[t - 3][w & 255];
+}
+
+int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *checksum)
+{
+	uint32_t crc = 0xffffffff;
+	LOG_DEBUG("Calculating checksum");
+
+	crc32_init_tables();
 
 	while (nbytes > 0) {
 		int run = nbytes;
 		if (run > 32768)
 			run = 32768;
 		nbytes -= run;
+		for (; run >= CRC32_SLICES; run -= CRC32_SLICES, buffer += CRC32_SLICES) {
+			crc = crc32_word(crc ^ be_to_h_u32(buffer), 3) ^
+				crc32_word(be_to_h_u32(buffer + 4), 2) ^
+				crc32_word(be_to_h_u32(buffer + 8), 1) ^
+				crc32_word(be_to_h_u32(buffer + 12), 0);
+		}
 		while (run--) {
 			/* as per gdb */
-			crc = (crc << 8) ^ crc32_table[((crc >> 24) ^ *buffer++) & 255];
+			crc = (crc << 8) ^ crc32_table[0][((crc >> 24) ^ *buffer++) & 255];
 		}
 		keep_alive();
 	}
@@ -0,0 +1,324 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/perf.h>
+#include <server/server.h>
+#include <target/target.h>
+#include <target/armv7m.h>
+#include <target/itm_server.h>
+
+/* Clients that cannot keep up lose data rather than stall the server */
+#define ITM_MAX_SUBSCRIBERS	8
+#define ITM_STREAM_BUF_SIZE	4096
+
+struct itm_subscriber {
+	struct connection *connection;
+	uint64_t sent;
+	uint64_t dropped;
+	struct itm_subscriber *next;
+};
+
+struct itm_stream {
+	struct itm_demux *demux;
+	unsigned int stim_port;
+	struct itm_subscriber *subscribers;
+	unsigned int num_subscribers;
+	/* payload bytes decoded for this port */
+	uint64_t bytes;
+	/* bytes lost by subscribers that have since gone away */
+	uint64_t dropped;
+	size_t len;
+	uint8_t buf[ITM_STREAM_BUF_SIZE];
+	struct itm_stream *next;
+};
+
+enum itm_decode_state {
+	ITM_DECODE_HEADER,
+	ITM_DECODE_PAYLOAD,
+	ITM_DECODE_CONTINUATION,
+};
+
+/* One packet decoder per target, shared by all of its streams */
+struct itm_demux {
+	struct target *target;
+	enum itm_decode_state state;
+	unsigned int remaining;
+	struct itm_stream *current;
+	uint64_t sw_packets;
+	uint64_t hw_packets;
+	uint32_t overflows;
+	uint32_t syncs;
+	/* zero bytes in a row, a sync packet ends with 0x80 after five */
+	unsigned int zeros;
+	struct itm_stream *streams;
+	struct itm_demux *next;
+};
+
+static struct itm_demux *itm_demuxes;
+
+static void itm_stream_flush(struct itm_stream *stream)
+{
+	for (struct itm_subscriber *s = stream->subscribers; s; s = s->next) {
+		int written = connection_write(s->connection, stream->buf, stream->len);
+		if (written < 0)
+			written = 0;
+		s->sent += written;
+		s->dropped += stream->len - written;
+	}
+	stream->len = 0;
+}
+
+static struct itm_stream *itm_demux_find(struct itm_demux *demux,
+		unsigned int stim_port)
+{
+	for (struct itm_stream *stream = demux->streams; stream; stream = stream->next)
+		if (stream->stim_port == stim_port)
+			return stream;
+	return NULL;
+}
+
+/*
+ * ITM packets (ARMv7-M ARM, appendix D4): a header byte whose low two
+ * bits give the payload size of a source packet, with bit 2 telling
+ * hardware (DWT) from software (stimulus port) sources and the port
+ * number in the top five bits.  Protocol packets (sync, overflow,
+ * timestamps, extensions) have the low bits clear and continue while
+ * bit 7 of the current byte is set.
+ */
+static void itm_demux_byte(struct itm_demux *demux, uint8_t b)
+{
+	struct itm_stream *stream;
+
+	switch (demux->state) {
+		case ITM_DECODE_HEADER:
+			if (b == 0x00 || b == 0x80) {
+				/* synchronisation */
+				if (b == 0x80 && demux->zeros >= 5) {
+					demux->syncs++;
+					perf_add(PERF_ITM_SYNCS, 1);
+				}
+				demux->zeros = b ? 0 : demux->zeros + 1;
+				break;
+			}
+			demux->zeros = 0;
+			if (b == 0x70) {
+				demux->overflows++;
+				perf_add(PERF_ITM_OVERFLOWS, 1);
+			} else if (b & 0x03) {
+				demux->remaining = (b & 0x03) == 3 ? 4 : (b & 0x03);
+				demux->state = ITM_DECODE_PAYLOAD;
+				if (b & 0x04) {
+					demux->hw_packets++;
+					demux->current = NULL;
+				} else {
+					demux->sw_packets++;
+					demux->current = itm_demux_find(demux, b >> 3);
+				}
+			} else if (b & 0x80)
+				demux->state = ITM_DECODE_CONTINUATION;
+			break;
+		case ITM_DECODE_PAYLOAD:
+			stream = demux->current;
+			if (stream) {
+				stream->bytes++;
+				stream->buf[stream->len++] = b;
+				if (stream->len == sizeof(stream->buf))
+					itm_stream_flush(stream);
+			}
+			if (--demux->remaining == 0)
+				demux->state = ITM_DECODE_HEADER;
+			break;
+		case ITM_DECODE_CONTINUATION:
+			if (!(b & 0x80))
+				demux->state = ITM_DECODE_HEADER;
+			break;
+	}
+}
+
+static int itm_demux_trace(struct target *target, size_t len, uint8_t *data,
+		void *priv)
+{
+	struct itm_demux *demux = priv;
+
+	if (target != demux->target)
+		return ERROR_OK;
+
+	for (size_t i = 0; i < len; i++)
+		itm_demux_byte(demux, data[i]);
+
+	for (struct itm_stream *stream = demux->streams; stream; stream = stream->next)
+		if (stream->len)
+			itm_stream_flush(stream);
+
+	return ERROR_OK;
+}
+
+static int itm_new_connection(struct connection *connection)
+{
+	struct itm_stream *stream = connection->service->priv;
+	struct itm_subscriber *s = calloc(1, sizeof(*s));
+
+	if (s == NULL)
+		return ERROR_CONNECTION_REJECTED;
+
+	s->connection = connection;
+	s->next = stream->subscribers;
+	stream->subscribers = s;
+	stream->num_subscribers++;
+	connection->priv = s;
+
+	LOG_INFO("ITM port %u of %s: new subscriber", stream->stim_port,
+			target_name(stream->demux->target));
+	return ERROR_OK;
+}
+
+static int itm_input(struct connection *connection)
+{
+	uint8_t buf[64];
+
+	/* subscribers only listen; anything they send is discarded */
+	int bytes_read = connection_read(connection, buf, sizeof(buf));
+	if (bytes_read <= 0)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
+	return ERROR_OK;
+}
+
+static int itm_connection_closed(struct connection *connection)
+{
+	struct itm_stream *stream = connection->service->priv;
+	struct itm_subscriber *s = connection->priv;
+
+	for (struct itm_subscriber **p = &stream->subscribers; *p; p = &(*p)->next) {
+		if (*p == s) {
+			*p = s->next;
+			break;
+		}
+	}
+	stream->num_subscribers--;
+	stream->dropped += s->dropped;
+	free(s);
+	connection->priv = NULL;
+
+	return ERROR_OK;
+}
+
+static struct itm_demux *itm_demux_get(struct target *target)
+{
+	struct itm_demux *demux;
+
+	for (demux = itm_demuxes; demux; demux = demux->next)
+		if (demux->target == target)
+			return demux;
+
+	demux = calloc(1, sizeof(*demux));
+	if (demux == NULL)
+		return NULL;
+	demux->target = target;
+
+	if (target_register_trace_callback(itm_demux_trace, demux) != ERROR_OK) {
+		free(demux);
+		return NULL;
+	}
+
+	demux->next = itm_demuxes;
+	itm_demuxes = demux;
+	return demux;
+}
+
+int itm_demux_enable(struct target *target)
+{
+	return itm_demux_get(target) ? ERROR_OK : ERROR_FAIL;
+}
+
+uint32_t itm_demux_syncs(struct target *target)
+{
+	for (struct itm_demux *demux = itm_demuxes; demux; demux = demux->next)
+		if (demux->target == target)
+			return demux->syncs;
+	return 0;
+}
+
+int itm_stream_add(struct target *target, unsigned int stim_port,
+		const char *tcp_port)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct itm_demux *demux;
+	struct itm_stream *stream;
+	int retval;
+
+	if (stim_port > 31) {
+		LOG_ERROR("ITM packets can only address stimulus ports 0..31");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	if (armv7m->trace_config.formatter)
+		LOG_WARNING("TPIU formatter is enabled, ITM packets can not be demultiplexed");
+
+	demux = itm_demux_get(target);
+	if (demux == NULL)
+		return ERROR_FAIL;
+
+	if (itm_demux_find(demux, stim_port)) {
+		LOG_ERROR("ITM port %u of %s is already served", stim_port,
+				target_name(target));
+		return ERROR_FAIL;
+	}
+
+	stream = calloc(1, sizeof(*stream));
+	if (stream == NULL)
+		return ERROR_FAIL;
+	stream->demux = demux;
+	stream->stim_port = stim_port;
+
+	retval = add_service("itm", tcp_port, ITM_MAX_SUBSCRIBERS,
+			itm_new_connection, itm_input, itm_connection_closed, stream);
+	if (retval != ERROR_OK) {
+		free(stream);
+		return retval;
+	}
+
+	stream->next = demux->streams;
+	demux->streams = stream;
+	return ERROR_OK;
+}
+
+void itm_stream_report(struct command_context *cmd_ctx, struct target *target)
+{
+	struct itm_demux *demux;
+
+	for (demux = itm_demuxes; demux; demux = demux->next)
+		if (demux->target == target)
+			break;
+	if (demux == NULL)
+		return;
+
+	command_print(cmd_ctx, "%" PRIu64 " stimulus and %" PRIu64 " hardware packets,"
+			" %" PRIu32 " overflows, %" PRIu32 " syncs", demux->sw_packets,
+			demux->hw_packets, demux->overflows, demux->syncs);
+
+	for (struct itm_stream *stream = demux->streams; stream; stream = stream->next) {
+		uint64_t dropped = stream->dropped;
+		for (struct itm_subscriber *s = stream->subscribers; s; s = s->next)
+			dropped += s->dropped;
+		command_print(cmd_ctx, "port %u: %" PRIu64 " bytes, %u subscribers,"
+				" %" PRIu64 " bytes dropped", stream->stim_port,
+				stream->bytes, stream->num_subscribers, dropped);
+	}
+}
@@ -0,0 +1,48 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_ITM_SERVER_H
+#define OPENOCD_TARGET_ITM_SERVER_H
+
+#include <helper/command.h>
+
+struct target;
+
+/**
+ * @file
+ * Demultiplexes the ITM packet stream captured by the adapter and serves
+ * the payload of individual stimulus ports to TCP subscribers.
+ */
+
+/**
+ * Starts serving ITM stimulus port @a stim_port of @a target on TCP
+ * port @a tcp_port.  Several clients may connect to the same port.
+ */
+int itm_stream_add(struct target *target, unsigned int stim_port,
+		const char *tcp_port);
+
+/**
+ * Decodes the ITM packets of @a target even if no stimulus port is
+ * served, for the overflow and synchronisation statistics.
+ */
+int itm_demux_enable(struct target *target);
+
+/** @returns the number of ITM synchronisation packets decoded so far. */
+uint32_t itm_demux_syncs(struct target *target);
+
+/** Prints per stream delivery and backpressure statistics. */
+void itm_stream_report(struct command_context *cmd_ctx, struct target *target);
+
+#endif /* OPENOCD_TARGET_ITM_SERVER_H */
@@ -56,6 +56,7 @@ static int do_halt(struct target *t);
 static int do_resume(struct target *t);
 static int read_all_core_hw_regs(struct target *t);
 static int write_all_core_hw_regs(struct target *t);
+static int queue_read_hw_reg(struct target *t, int reg, uint8_t *in_buf);
 static int read_hw_reg(struct target *t,
 			int reg, uint32_t *regval, uint8_t cache);
 static int write_hw_reg(struct target *t,
@@ -431,14 +432,32 @@ struct reg_cache *lakemont_build_reg_cache(struct target *t)
 	return cache;
 }
 
-static uint32_t get_tapstatus(struct target *t)
+static int read_tapstatus(struct target *t, uint32_t *tapstatus)
 {
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	int flush = x86_32->flush;
+
+	/* the DR scan flushes whatever the caller queued, the IR scan need not */
+	x86_32->flush = 0;
 	scan.out[0] = TAPSTATUS;
-	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
-		return 0;
-	if (drscan(t, NULL, scan.out, TS_SIZE) != ERROR_OK)
+	int err = irscan(t, scan.out, NULL, LMT_IRLEN);
+	if (err == ERROR_OK) {
+		x86_32->flush = 1;
+		err = drscan(t, NULL, scan.out, TS_SIZE);
+	}
+	x86_32->flush = flush;
+	if (err != ERROR_OK)
+		return err;
+	*tapstatus = buf_get_u32(scan.out, 0, 32);
+	return ERROR_OK;
+}
+
+static uint32_t get_tapstatus(struct target *t)
+{
+	uint32_t tapstatus;
+	if (read_tapstatus(t, &tapstatus) != ERROR_OK)
 		return 0;
-	return buf_get_u32(scan.out, 0, 32);
+	return tapstatus;
 }
 
 static int enter_probemode(struct target *t)
@@ -602,29 +621,62 @@ static int do_resume(struct target *t)
 
 static int read_all_core_hw_regs(struct target *t)
 {
-	int err;
-	uint32_t regval;
+	int err = ERROR_OK;
 	unsigned i;
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	uint8_t (*reg_in)[PDR_SIZE / 8];
+
+	reg_in = calloc(x86_32->cache->num_regs, sizeof(*reg_in));
+	if (reg_in == NULL) {
+		LOG_ERROR("%s out of memory", __func__);
+		return ERROR_FAIL;
+	}
+
+	/* queue the whole register set, then flush once */
+	x86_32->flush = 0;
 	for (i = 0; i < (x86_32->cache->num_regs); i++) {
 		if (NOT_AVAIL_REG == regs[i].pm_idx)
 			continue;
-		err = read_hw_reg(t, regs[i].id, &regval, 1);
+		err = queue_read_hw_reg(t, regs[i].id, reg_in[i]);
 		if (err != ERROR_OK) {
 			LOG_ERROR("%s error saving reg %s",
 					__func__, x86_32->cache->reg_list[i].name);
-			return err;
+			break;
 		}
 	}
+	x86_32->flush = 1;
+	if (err == ERROR_OK) {
+		err = jtag_execute_queue();
+		if (err != ERROR_OK)
+			LOG_ERROR("%s failed to execute queue", __func__);
+	}
+
+	for (i = 0; err == ERROR_OK && i < (x86_32->cache->num_regs); i++) {
+		if (NOT_AVAIL_REG == regs[i].pm_idx)
+			continue;
+		uint32_t regval = buf_get_u32(reg_in[i], 0, 32);
+		buf_set_u32(x86_32->cache->reg_list[regs[i].id].value, 0, 32, regval);
+		x86_32->cache->reg_list[regs[i].id].valid = 1;
+		x86_32->cache->reg_list[regs[i].id].dirty = 0;
+		LOG_DEBUG("reg=%s, val=0x%08" PRIx32,
+				x86_32->cache->reg_list[regs[i].id].name, regval);
+	}
+	free(reg_in);
+	if (err != ERROR_OK)
+		return err;
+
 	LOG_DEBUG("read_all_core_hw_regs read %u registers ok", i);
 	return ERROR_OK;
 }
 
 static int write_all_core_hw_regs(struct target *t)
 {
-	int err;
+	int err = ERROR_OK;
 	unsigned i;
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
+
+	/* write_hw_reg() leaves the flush to us while batching */
+	x86_32->flush = 0;
 	for (i = 0; i < (x86_32->cache->num_regs); i++) {
 		if (NOT_AVAIL_REG == regs[i].pm_idx)
 			continue;
@@ -632,35 +684,67 @@ static int write_all_core_hw_regs(struct target *t)
 		if (err != ERROR_OK) {
 			LOG_ERROR("%s error restoring reg %s",
 					__func__, x86_32->cache->reg_list[i].name);
-			return err;
+			break;
 		}
 	}
+	x86_32->flush = 1;
+	if (err != ERROR_OK)
+		return err;
+
+	err = jtag_execute_queue();
+	if (err != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
+		return err;
+	}
 	LOG_DEBUG("write_all_core_hw_regs wrote %u registers ok", i);
 	return ERROR_OK;
 }
 
-/* read reg from lakemont core shadow ram, update reg cache if needed */
-static int read_hw_reg(struct target *t, int reg, uint32_t *regval, uint8_t cache)
+/* queue the scans moving reg from lakemont core shadow ram into PDR and
+ * capturing it into in_buf, valid once the queue has been executed */
+static int queue_read_hw_reg(struct target *t, int reg, uint8_t *in_buf)
 {
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
-	struct lakemont_core_reg *arch_info;
-	arch_info = x86_32->cache->reg_list[reg].arch_info;
-	x86_32->flush = 0; /* dont flush scans till we have a batch */
+	int flush = x86_32->flush;
+	int err = ERROR_FAIL;
+
+	x86_32->flush = 0;
 	if (submit_reg_pir(t, reg) != ERROR_OK)
-		return ERROR_FAIL;
+		goto out;
 	if (submit_instruction_pir(t, SRAMACCESS) != ERROR_OK)
-		return ERROR_FAIL;
+		goto out;
 	if (submit_instruction_pir(t, SRAM2PDR) != ERROR_OK)
-		return ERROR_FAIL;
-	x86_32->flush = 1;
+		goto out;
 	scan.out[0] = RDWRPDR;
 	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
+		goto out;
+	if (drscan(t, NULL, in_buf, PDR_SIZE) != ERROR_OK)
+		goto out;
+	jtag_add_sleep(DELAY_SUBMITPIR);
+	err = ERROR_OK;
+out:
+	x86_32->flush = flush;
+	return err;
+}
+
+/* read reg from lakemont core shadow ram, update reg cache if needed */
+static int read_hw_reg(struct target *t, int reg, uint32_t *regval, uint8_t cache)
+{
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	struct lakemont_core_reg *arch_info;
+	arch_info = x86_32->cache->reg_list[reg].arch_info;
+	uint8_t reg_in[PDR_SIZE / 8];
+
+	/* flushes anything the caller batched in front of it as well */
+	if (queue_read_hw_reg(t, reg, reg_in) != ERROR_OK)
 		return ERROR_FAIL;
-	if (drscan(t, NULL, scan.out, PDR_SIZE) != ERROR_OK)
+	x86_32->flush = 1;
+	if (jtag_execute_queue() != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
 		return ERROR_FAIL;
+	}
 
-	jtag_add_sleep(DELAY_SUBMITPIR);
-	*regval = buf_get_u32(scan.out, 0, 32);
+	*regval = buf_get_u32(reg_in, 0, 32);
 	if (cache) {
 		buf_set_u32(x86_32->cache->reg_list[reg].value, 0, 32, *regval);
 		x86_32->cache->reg_list[reg].valid = 1;
@@ -689,17 +773,19 @@ static int write_hw_reg(struct target *t, int reg, uint32_t regval, uint8_t cach
 			arch_info->op,
 			regval);
 
+	/* a caller batching several accesses has cleared flush, keep it so */
+	int flush = x86_32->flush;
 	x86_32->flush = 0; /* dont flush scans till we have a batch */
 	if (submit_reg_pir(t, reg) != ERROR_OK)
-		return ERROR_FAIL;
+		goto fail;
 	if (submit_instruction_pir(t, SRAMACCESS) != ERROR_OK)
-		return ERROR_FAIL;
+		goto fail;
 	scan.out[0] = RDWRPDR;
 	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
-		return ERROR_FAIL;
+		goto fail;
 	if (drscan(t, reg_buf, scan.out, PDR_SIZE) != ERROR_OK)
-		return ERROR_FAIL;
-	x86_32->flush = 1;
+		goto fail;
+	x86_32->flush = flush;
 	if (submit_instruction_pir(t, PDR2SRAM) != ERROR_OK)
 		return ERROR_FAIL;
 
@@ -709,6 +795,10 @@ static int write_hw_reg(struct target *t, int reg, uint32_t regval, uint8_t cach
 		x86_32->cache->reg_list[reg].valid = 0;
 	}
 	return ERROR_OK;
+
+fail:
+	x86_32->flush = flush;
+	return ERROR_FAIL;
 }
 
 static bool is_paging_enabled(struct target *t)
@@ -761,7 +851,13 @@ static bool sw_bpts_supported(struct target *t)
 
 static int transaction_status(struct target *t)
 {
-	uint32_t tapstatus = get_tapstatus(t);
+	uint32_t tapstatus;
+	/* also reports failures of scans the caller left queued */
+	int err = read_tapstatus(t, &tapstatus);
+	if (err != ERROR_OK) {
+		LOG_ERROR("%s failed to read tapstatus", __func__);
+		return err;
+	}
 	if ((TS_EN_PM_BIT | TS_PRDY_BIT) & tapstatus) {
 		LOG_ERROR("%s transaction error tapstatus = 0x%08" PRIx32
 				, __func__, tapstatus);
@@ -817,10 +913,14 @@ static int submit_pir(struct target *t, uint64_t op)
 	int flush = x86_32->flush;
 	x86_32->flush = 0;
 	scan.out[0] = WRPIR;
-	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
+	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK) {
+		x86_32->flush = flush;
 		return ERROR_FAIL;
-	if (drscan(t, op_buf, scan.out, PIR_SIZE) != ERROR_OK)
+	}
+	if (drscan(t, op_buf, scan.out, PIR_SIZE) != ERROR_OK) {
+		x86_32->flush = flush;
 		return ERROR_FAIL;
+	}
 	scan.out[0] = SUBMITPIR;
 	x86_32->flush = flush;
 	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
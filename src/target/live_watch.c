@@ -0,0 +1,686 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <elf.h>
+#include <helper/fileio.h>
+#include <helper/time_support.h>
+#include <server/server.h>
+#include <target/target.h>
+#include <target/armv7m.h>
+#include <target/arm_adi_v5.h>
+#include <target/live_watch.h>
+
+#define LIVE_WATCH_MAX_VARS		64
+/* largest single variable, e.g. a small array or struct */
+#define LIVE_WATCH_MAX_SIZE		256
+#define LIVE_WATCH_MAX_RATE		100000
+/* samples taken in one timer callback to catch up after a delay, older
+ * ones are skipped */
+#define LIVE_WATCH_MAX_BURST		8
+#define LIVE_WATCH_MAX_SUBSCRIBERS	4
+/* timestamp and sequence number in front of each record */
+#define LIVE_WATCH_HEADER_SIZE		12
+
+struct live_watch_var {
+	uint32_t address;
+	uint32_t size;
+	char *name;
+	/* index of the first word covering the variable */
+	unsigned int word;
+};
+
+struct live_watch_subscriber {
+	struct connection *connection;
+	struct live_watch_subscriber *next;
+};
+
+struct live_watch {
+	struct target *target;
+	struct live_watch_var vars[LIVE_WATCH_MAX_VARS];
+	unsigned int num_vars;
+	/* sorted addresses of the aligned words covering all variables,
+	 * their values and their contents in target byte order */
+	uint32_t *word_address;
+	uint32_t *word_value;
+	uint8_t *word_data;
+	unsigned int num_words;
+	uint8_t *record;
+	unsigned int record_size;
+	unsigned int rate;
+	bool running;
+	bool served;
+	int64_t start_us;
+	uint64_t sequence;
+	uint64_t skipped;
+	uint64_t dropped;
+	uint32_t read_errors;
+	FILE *file;
+	struct live_watch_subscriber *subscribers;
+	struct live_watch *next;
+};
+
+static struct live_watch *live_watches;
+
+static int64_t live_watch_now_us(void)
+{
+	return monotonic_ns() / 1000;
+}
+
+static struct live_watch *live_watch_get(struct target *target)
+{
+	struct live_watch *lw;
+
+	for (lw = live_watches; lw; lw = lw->next)
+		if (lw->target == target)
+			return lw;
+
+	lw = calloc(1, sizeof(*lw));
+	if (lw == NULL)
+		return NULL;
+	lw->target = target;
+
+	lw->next = live_watches;
+	live_watches = lw;
+	return lw;
+}
+
+static int live_watch_compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Collects the words covering all variables, so that each sample reads
+ * every word once, in address order. */
+static int live_watch_layout(struct live_watch *lw)
+{
+	unsigned int max_words = 0, n = 0;
+
+	free(lw->word_address);
+	free(lw->word_value);
+	free(lw->word_data);
+	free(lw->record);
+
+	lw->record_size = LIVE_WATCH_HEADER_SIZE;
+	for (unsigned int i = 0; i < lw->num_vars; i++) {
+		struct live_watch_var *var = &lw->vars[i];
+		max_words += ((var->address & 3) + var->size + 3) / 4;
+		lw->record_size += var->size;
+	}
+
+	lw->word_address = malloc(max_words * sizeof(uint32_t));
+	lw->word_value = malloc(max_words * sizeof(uint32_t));
+	lw->word_data = malloc(max_words * 4);
+	lw->record = malloc(lw->record_size);
+	if (lw->word_address == NULL || lw->word_value == NULL || lw->word_data == NULL ||
+			lw->record == NULL) {
+		lw->num_words = 0;
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = 0; i < lw->num_vars; i++) {
+		struct live_watch_var *var = &lw->vars[i];
+		for (uint32_t a = var->address & ~3; a < var->address + var->size; a += 4)
+			lw->word_address[n++] = a;
+	}
+	qsort(lw->word_address, n, sizeof(uint32_t), live_watch_compare_u32);
+
+	lw->num_words = 0;
+	for (unsigned int i = 0; i < n; i++)
+		if (lw->num_words == 0 || lw->word_address[lw->num_words - 1] != lw->word_address[i])
+			lw->word_address[lw->num_words++] = lw->word_address[i];
+
+	for (unsigned int i = 0; i < lw->num_vars; i++) {
+		struct live_watch_var *var = &lw->vars[i];
+		uint32_t key = var->address & ~3;
+		uint32_t *word = bsearch(&key, lw->word_address, lw->num_words,
+				sizeof(uint32_t), live_watch_compare_u32);
+		var->word = word - lw->word_address;
+	}
+
+	return ERROR_OK;
+}
+
+static int live_watch_read(struct live_watch *lw)
+{
+	struct target *target = lw->target;
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	int retval;
+
+	/* high level adapters have no transaction queue, read each run of
+	 * consecutive words at once instead */
+	if (armv7m->stlink) {
+		unsigned int i, j;
+		for (i = 0; i < lw->num_words; i = j) {
+			for (j = i + 1; j < lw->num_words; j++)
+				if (lw->word_address[j] != lw->word_address[j - 1] + 4)
+					break;
+			retval = target_read_memory(target, lw->word_address[i], 4, j - i,
+					lw->word_data + 4 * i);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		return ERROR_OK;
+	}
+
+	for (unsigned int i = 0; i < lw->num_words; i++) {
+		retval = mem_ap_read_u32(armv7m->debug_ap, lw->word_address[i], &lw->word_value[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	retval = dap_run(armv7m->debug_ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned int i = 0; i < lw->num_words; i++)
+		target_buffer_set_u32(target, lw->word_data + 4 * i, lw->word_value[i]);
+	return ERROR_OK;
+}
+
+static void live_watch_emit(struct live_watch *lw, int64_t timestamp)
+{
+	uint8_t *p = lw->record + LIVE_WATCH_HEADER_SIZE;
+
+	h_u64_to_le(lw->record, timestamp);
+	h_u32_to_le(lw->record + 8, lw->sequence);
+	for (unsigned int i = 0; i < lw->num_vars; i++) {
+		struct live_watch_var *var = &lw->vars[i];
+		memcpy(p, lw->word_data + 4 * var->word + (var->address & 3), var->size);
+		p += var->size;
+	}
+
+	if (lw->file && fwrite(lw->record, lw->record_size, 1, lw->file) != 1)
+		lw->dropped++;
+
+	for (struct live_watch_subscriber *s = lw->subscribers; s; s = s->next)
+		if (connection_write(s->connection, lw->record, lw->record_size) != (int)lw->record_size)
+			lw->dropped++;
+}
+
+static int live_watch_poll(void *priv)
+{
+	struct live_watch *lw = priv;
+	int64_t now;
+	uint64_t due;
+
+	if (!target_was_examined(lw->target))
+		return ERROR_OK;
+
+	/* sample n is due n / rate seconds after the start */
+	now = live_watch_now_us();
+	due = (uint64_t)(now - lw->start_us) * lw->rate / 1000000 + 1;
+	if (due - lw->sequence > LIVE_WATCH_MAX_BURST) {
+		lw->skipped += due - LIVE_WATCH_MAX_BURST - lw->sequence;
+		lw->sequence = due - LIVE_WATCH_MAX_BURST;
+	}
+
+	while (lw->sequence < due) {
+		if (live_watch_read(lw) != ERROR_OK) {
+			lw->read_errors++;
+			lw->skipped += due - lw->sequence;
+			lw->sequence = due;
+			break;
+		}
+		live_watch_emit(lw, live_watch_now_us() - lw->start_us);
+		lw->sequence++;
+	}
+
+	return ERROR_OK;
+}
+
+static int live_watch_stop(struct live_watch *lw)
+{
+	if (!lw->running)
+		return ERROR_OK;
+
+	lw->running = false;
+	if (lw->file)
+		fflush(lw->file);
+	return target_unregister_timer_callback(live_watch_poll, lw);
+}
+
+static int live_watch_start(struct live_watch *lw, unsigned int rate)
+{
+	int retval;
+
+	if (lw->num_vars == 0) {
+		LOG_ERROR("%s: no variables to sample", target_name(lw->target));
+		return ERROR_FAIL;
+	}
+
+	live_watch_stop(lw);
+
+	retval = live_watch_layout(lw);
+	if (retval != ERROR_OK)
+		return retval;
+
+	lw->rate = rate;
+	lw->sequence = 0;
+	lw->skipped = 0;
+	lw->dropped = 0;
+	lw->read_errors = 0;
+	lw->start_us = live_watch_now_us();
+
+	retval = target_register_timer_callback(live_watch_poll,
+			rate >= 1000 ? 1 : 1000 / rate, 1, lw);
+	if (retval != ERROR_OK)
+		return retval;
+	lw->running = true;
+
+	LOG_INFO("%s: sampling %u variables in %u words at %u Hz, %u byte records",
+			target_name(lw->target), lw->num_vars, lw->num_words, rate, lw->record_size);
+	return ERROR_OK;
+}
+
+/* convert ELF field to host endianness */
+#define elf_field16(le, field) \
+	((le) ? le_to_h_u16((uint8_t *)&(field)) : be_to_h_u16((uint8_t *)&(field)))
+#define elf_field32(le, field) \
+	((le) ? le_to_h_u32((uint8_t *)&(field)) : be_to_h_u32((uint8_t *)&(field)))
+
+/* Looks up the value and size of symbol @a name in the symbol table of the
+ * 32-bit ELF file @a data. */
+static int live_watch_elf_lookup(const uint8_t *data, size_t size, const char *name,
+		uint32_t *address, uint32_t *sym_size)
+{
+	Elf32_Ehdr *ehdr = (Elf32_Ehdr *)data;
+	bool le;
+
+	if (size < sizeof(Elf32_Ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+			ehdr->e_ident[EI_CLASS] != ELFCLASS32) {
+		LOG_ERROR("not a 32-bit ELF file");
+		return ERROR_FAIL;
+	}
+	le = ehdr->e_ident[EI_DATA] == ELFDATA2LSB;
+
+	uint32_t shoff = elf_field32(le, ehdr->e_shoff);
+	uint16_t shnum = elf_field16(le, ehdr->e_shnum);
+	if (shoff > size || shnum > (size - shoff) / sizeof(Elf32_Shdr)) {
+		LOG_ERROR("ELF section headers out of the file");
+		return ERROR_FAIL;
+	}
+	Elf32_Shdr *shdr = (Elf32_Shdr *)(data + shoff);
+
+	for (unsigned int i = 0; i < shnum; i++) {
+		if (elf_field32(le, shdr[i].sh_type) != SHT_SYMTAB)
+			continue;
+
+		uint32_t link = elf_field32(le, shdr[i].sh_link);
+		uint32_t offset = elf_field32(le, shdr[i].sh_offset);
+		uint32_t len = elf_field32(le, shdr[i].sh_size);
+		if (link >= shnum || offset > size || len > size - offset)
+			continue;
+		uint32_t str_offset = elf_field32(le, shdr[link].sh_offset);
+		uint32_t str_len = elf_field32(le, shdr[link].sh_size);
+		if (str_offset > size || str_len > size - str_offset)
+			continue;
+		const char *strtab = (const char *)data + str_offset;
+
+		Elf32_Sym *sym = (Elf32_Sym *)(data + offset);
+		for (uint32_t j = 0; j < len / sizeof(Elf32_Sym); j++) {
+			uint32_t name_offset = elf_field32(le, sym[j].st_name);
+			if (name_offset >= str_len ||
+					strncmp(strtab + name_offset, name, str_len - name_offset) != 0)
+				continue;
+			*address = elf_field32(le, sym[j].st_value);
+			*sym_size = elf_field32(le, sym[j].st_size);
+			return ERROR_OK;
+		}
+	}
+
+	LOG_ERROR("symbol '%s' not found", name);
+	return ERROR_FAIL;
+}
+
+static int live_watch_elf_symbol(const char *file, const char *name,
+		uint32_t *address, uint32_t *sym_size)
+{
+	struct fileio *fileio;
+	uint8_t *data;
+	size_t size, read_bytes;
+	int retval;
+
+	retval = fileio_open(&fileio, file, FILEIO_READ, FILEIO_BINARY);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = fileio_size(fileio, &size);
+	if (retval != ERROR_OK) {
+		fileio_close(fileio);
+		return retval;
+	}
+
+	data = malloc(size);
+	if (data == NULL) {
+		fileio_close(fileio);
+		return ERROR_FAIL;
+	}
+
+	retval = fileio_read(fileio, size, data, &read_bytes);
+	fileio_close(fileio);
+	if (retval == ERROR_OK && read_bytes != size)
+		retval = ERROR_FILEIO_OPERATION_FAILED;
+	if (retval == ERROR_OK)
+		retval = live_watch_elf_lookup(data, size, name, address, sym_size);
+
+	free(data);
+	return retval;
+}
+
+static int live_watch_add(struct live_watch *lw, uint32_t address, uint32_t size,
+		const char *name)
+{
+	struct live_watch_var *var;
+
+	if (lw->running) {
+		LOG_ERROR("%s: stop live_watch before changing the variables",
+				target_name(lw->target));
+		return ERROR_FAIL;
+	}
+	if (lw->num_vars == LIVE_WATCH_MAX_VARS) {
+		LOG_ERROR("at most %d variables can be sampled", LIVE_WATCH_MAX_VARS);
+		return ERROR_FAIL;
+	}
+	if (size == 0 || size > LIVE_WATCH_MAX_SIZE || address + size < address) {
+		LOG_ERROR("variable size must be between 1 and %d bytes", LIVE_WATCH_MAX_SIZE);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	var = &lw->vars[lw->num_vars++];
+	var->address = address;
+	var->size = size;
+	var->name = strdup(name ? name : "");
+	return ERROR_OK;
+}
+
+static int live_watch_new_connection(struct connection *connection)
+{
+	struct live_watch *lw = connection->service->priv;
+	struct live_watch_subscriber *s = calloc(1, sizeof(*s));
+
+	if (s == NULL)
+		return ERROR_CONNECTION_REJECTED;
+
+	s->connection = connection;
+	s->next = lw->subscribers;
+	lw->subscribers = s;
+	connection->priv = s;
+
+	LOG_INFO("%s: new live_watch subscriber", target_name(lw->target));
+	return ERROR_OK;
+}
+
+static int live_watch_input(struct connection *connection)
+{
+	uint8_t buf[64];
+
+	/* the stream is output only, anything clients send is discarded */
+	int bytes_read = connection_read(connection, buf, sizeof(buf));
+	if (bytes_read <= 0)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
+	return ERROR_OK;
+}
+
+static int live_watch_connection_closed(struct connection *connection)
+{
+	struct live_watch *lw = connection->service->priv;
+	struct live_watch_subscriber *s = connection->priv;
+
+	for (struct live_watch_subscriber **p = &lw->subscribers; *p; p = &(*p)->next) {
+		if (*p == s) {
+			*p = s->next;
+			break;
+		}
+	}
+	free(s);
+	connection->priv = NULL;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_live_watch_add_command)
+{
+	struct live_watch *lw = live_watch_get(get_current_target(CMD_CTX));
+	uint32_t address, size;
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (lw == NULL)
+		return ERROR_FAIL;
+
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size);
+
+	return live_watch_add(lw, address, size, CMD_ARGC == 3 ? CMD_ARGV[2] : NULL);
+}
+
+COMMAND_HANDLER(handle_live_watch_symbol_command)
+{
+	struct live_watch *lw = live_watch_get(get_current_target(CMD_CTX));
+	uint32_t address, size;
+	int retval;
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (lw == NULL)
+		return ERROR_FAIL;
+
+	retval = live_watch_elf_symbol(CMD_ARGV[0], CMD_ARGV[1], &address, &size);
+	if (retval != ERROR_OK)
+		return retval;
+	if (CMD_ARGC == 3)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], size);
+
+	command_print(CMD_CTX, "%s: 0x%8.8" PRIx32 ", %" PRIu32 " bytes", CMD_ARGV[1],
+			address, size);
+	return live_watch_add(lw, address, size, CMD_ARGV[1]);
+}
+
+COMMAND_HANDLER(handle_live_watch_clear_command)
+{
+	struct live_watch *lw = live_watch_get(get_current_target(CMD_CTX));
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (lw == NULL)
+		return ERROR_FAIL;
+
+	live_watch_stop(lw);
+	for (unsigned int i = 0; i < lw->num_vars; i++)
+		free(lw->vars[i].name);
+	lw->num_vars = 0;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_live_watch_start_command)
+{
+	struct live_watch *lw = live_watch_get(get_current_target(CMD_CTX));
+	unsigned int rate = 1000;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (lw == NULL)
+		return ERROR_FAIL;
+
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], rate);
+	if (rate == 0 || rate > LIVE_WATCH_MAX_RATE) {
+		LOG_ERROR("rate must be between 1 and %d Hz", LIVE_WATCH_MAX_RATE);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	return live_watch_start(lw, rate);
+}
+
+COMMAND_HANDLER(handle_live_watch_stop_command)
+{
+	struct live_watch *lw = live_watch_get(get_current_target(CMD_CTX));
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (lw == NULL)
+		return ERROR_FAIL;
+
+	return live_watch_stop(lw);
+}
+
+COMMAND_HANDLER(handle_live_watch_server_command)
+{
+	struct live_watch *lw = live_watch_get(get_current_target(CMD_CTX));
+	int retval;
+
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (lw == NULL)
+		return ERROR_FAIL;
+
+	if (lw->served) {
+		LOG_ERROR("%s: live_watch samples are already served", target_name(lw->target));
+		return ERROR_FAIL;
+	}
+
+	retval = add_service("live_watch", CMD_ARGV[0], LIVE_WATCH_MAX_SUBSCRIBERS,
+			live_watch_new_connection, live_watch_input, live_watch_connection_closed, lw);
+	if (retval != ERROR_OK)
+		return retval;
+
+	lw->served = true;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_live_watch_file_command)
+{
+	struct live_watch *lw = live_watch_get(get_current_target(CMD_CTX));
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (lw == NULL)
+		return ERROR_FAIL;
+
+	if (lw->file) {
+		fclose(lw->file);
+		lw->file = NULL;
+	}
+	if (CMD_ARGC == 0)
+		return ERROR_OK;
+
+	lw->file = fopen(CMD_ARGV[0], "wb");
+	if (lw->file == NULL) {
+		LOG_ERROR("can't open %s: %s", CMD_ARGV[0], strerror(errno));
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_live_watch_status_command)
+{
+	struct live_watch *lw = live_watch_get(get_current_target(CMD_CTX));
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (lw == NULL)
+		return ERROR_FAIL;
+
+	for (unsigned int i = 0; i < lw->num_vars; i++)
+		command_print(CMD_CTX, "0x%8.8" PRIx32 " %3" PRIu32 " bytes %s",
+				lw->vars[i].address, lw->vars[i].size, lw->vars[i].name);
+
+	if (!lw->running) {
+		command_print(CMD_CTX, "stopped");
+		return ERROR_OK;
+	}
+	command_print(CMD_CTX, "sampling at %u Hz, %" PRIu64 " samples, %" PRIu64 " skipped,"
+			" %" PRIu64 " records dropped, %" PRIu32 " read errors", lw->rate,
+			lw->sequence - lw->skipped, lw->skipped, lw->dropped, lw->read_errors);
+	return ERROR_OK;
+}
+
+static const struct command_registration live_watch_exec_command_handlers[] = {
+	{
+		.name = "add",
+		.handler = handle_live_watch_add_command,
+		.mode = COMMAND_EXEC,
+		.help = "add a variable to sample",
+		.usage = "address size [name]",
+	},
+	{
+		.name = "symbol",
+		.handler = handle_live_watch_symbol_command,
+		.mode = COMMAND_EXEC,
+		.help = "add a variable to sample, by its symbol in an ELF file",
+		.usage = "elf_file symbol [size]",
+	},
+	{
+		.name = "clear",
+		.handler = handle_live_watch_clear_command,
+		.mode = COMMAND_EXEC,
+		.help = "stop sampling and remove all variables",
+		.usage = "",
+	},
+	{
+		.name = "start",
+		.handler = handle_live_watch_start_command,
+		.mode = COMMAND_EXEC,
+		.help = "start sampling the variables while the target runs",
+		.usage = "[rate_hz]",
+	},
+	{
+		.name = "stop",
+		.handler = handle_live_watch_stop_command,
+		.mode = COMMAND_EXEC,
+		.help = "stop sampling",
+		.usage = "",
+	},
+	{
+		.name = "server",
+		.handler = handle_live_watch_server_command,
+		.mode = COMMAND_EXEC,
+		.help = "serve the samples on a TCP port",
+		.usage = "tcp_port",
+	},
+	{
+		.name = "file",
+		.handler = handle_live_watch_file_command,
+		.mode = COMMAND_EXEC,
+		.help = "write the samples to a file, or stop writing them",
+		.usage = "[filename]",
+	},
+	{
+		.name = "status",
+		.handler = handle_live_watch_status_command,
+		.mode = COMMAND_EXEC,
+		.help = "show the variables and sampling statistics",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+const struct command_registration live_watch_command_handlers[] = {
+	{
+		.name = "live_watch",
+		.mode = COMMAND_ANY,
+		.help = "sample variables of the running target",
+		.usage = "",
+		.chain = live_watch_exec_command_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
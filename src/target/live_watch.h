@@ -0,0 +1,39 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_LIVE_WATCH_H
+#define OPENOCD_TARGET_LIVE_WATCH_H
+
+#include <helper/command.h>
+
+/**
+ * @file
+ * Samples a list of variables of a running Cortex-M at a fixed rate. The
+ * words covering all variables are read with one queued batch of MEM-AP
+ * accesses per sample, which doesn't halt the core.
+ *
+ * Each sample is streamed to TCP clients and to a file as one record of
+ * little-endian fields:
+ * @code
+ *	uint64_t timestamp;	// microseconds since live_watch start
+ *	uint32_t sequence;	// sample number, gaps mark skipped samples
+ *	uint8_t data[];		// the variables in the order they were added,
+ *				// each as its bytes in target memory
+ * @endcode
+ */
+
+extern const struct command_registration live_watch_command_handlers[];
+
+#endif /* OPENOCD_TARGET_LIVE_WATCH_H */
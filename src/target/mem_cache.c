@@ -0,0 +1,268 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include <helper/perf.h>
+#include "target.h"
+#include "target_type.h"
+#include "mem_cache.h"
+
+static struct mem_cache *mem_cache_get(struct target *target)
+{
+	if (target->mem_cache == NULL)
+		target->mem_cache = calloc(1, sizeof(struct mem_cache));
+
+	return target->mem_cache;
+}
+
+bool mem_cache_active(struct target *target)
+{
+	return target->mem_cache && target->mem_cache->enabled &&
+		target->state == TARGET_HALTED;
+}
+
+static bool mem_cache_is_uncached(struct mem_cache *cache,
+		uint32_t address, uint32_t len)
+{
+	uint64_t end = (uint64_t)address + len;
+
+	for (struct mem_cache_region *r = cache->uncached; r; r = r->next) {
+		if (address < (uint64_t)r->address + r->size && r->address < end)
+			return true;
+	}
+
+	return false;
+}
+
+int mem_cache_read(struct target *target,
+		uint32_t address, uint32_t size, uint32_t count, uint8_t *buffer)
+{
+	struct mem_cache *cache = target->mem_cache;
+	uint32_t len = size * count;
+
+	if (mem_cache_is_uncached(cache, address, len) ||
+			(uint64_t)address + len > 0x100000000ULL)
+		return target->type->read_memory(target, address, size, count, buffer);
+
+	for (uint32_t done = 0; done < len; ) {
+		uint32_t addr = address + done;
+		uint32_t page_address = addr & ~(MEM_CACHE_PAGE_SIZE - 1);
+		uint32_t offset = addr - page_address;
+		uint32_t n = MIN(len - done, MEM_CACHE_PAGE_SIZE - offset);
+		struct mem_cache_page *page =
+			&cache->pages[(page_address / MEM_CACHE_PAGE_SIZE) % MEM_CACHE_PAGES];
+
+		if (page->valid && page->address == page_address) {
+			cache->hits++;
+			perf_add(PERF_MEM_CACHE_HITS, 1);
+		} else {
+			cache->misses++;
+			perf_add(PERF_MEM_CACHE_MISSES, 1);
+			page->valid = false;
+			int retval = target->type->read_memory(target, page_address, 4,
+					MEM_CACHE_PAGE_SIZE / 4, page->data);
+			if (retval != ERROR_OK) {
+				/* e.g. only part of the page is backed by memory,
+				 * let the access itself report what is wrong */
+				return target->type->read_memory(target, address, size, count, buffer);
+			}
+			page->address = page_address;
+			page->valid = true;
+		}
+
+		memcpy(buffer + done, page->data + offset, n);
+		done += n;
+	}
+
+	return ERROR_OK;
+}
+
+void mem_cache_invalidate(struct target *target)
+{
+	struct mem_cache *cache = target->mem_cache;
+
+	if (cache == NULL)
+		return;
+
+	for (unsigned i = 0; i < MEM_CACHE_PAGES; i++)
+		cache->pages[i].valid = false;
+}
+
+void mem_cache_free(struct target *target)
+{
+	struct mem_cache *cache = target->mem_cache;
+
+	if (cache == NULL)
+		return;
+
+	while (cache->uncached) {
+		struct mem_cache_region *next = cache->uncached->next;
+		free(cache->uncached);
+		cache->uncached = next;
+	}
+
+	free(cache);
+	target->mem_cache = NULL;
+}
+
+COMMAND_HANDLER(handle_memcache_enable_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct mem_cache *cache = mem_cache_get(target);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (cache == NULL)
+		return ERROR_FAIL;
+
+	mem_cache_invalidate(target);
+	cache->enabled = true;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_memcache_disable_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (target->mem_cache) {
+		mem_cache_invalidate(target);
+		target->mem_cache->enabled = false;
+	}
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_memcache_flush_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	mem_cache_invalidate(target);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_memcache_uncached_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct mem_cache *cache = mem_cache_get(target);
+	struct mem_cache_region *region;
+	uint32_t address, size;
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (cache == NULL)
+		return ERROR_FAIL;
+
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size);
+
+	region = malloc(sizeof(*region));
+	if (region == NULL)
+		return ERROR_FAIL;
+	region->address = address;
+	region->size = size;
+	region->next = cache->uncached;
+	cache->uncached = region;
+
+	mem_cache_invalidate(target);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_memcache_status_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct mem_cache *cache = target->mem_cache;
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (cache == NULL || !cache->enabled) {
+		command_print(CMD_CTX, "memory cache of %s is disabled", target_name(target));
+		return ERROR_OK;
+	}
+
+	command_print(CMD_CTX, "memory cache of %s: %d pages of %d bytes, "
+			"%" PRIu64 " hits, %" PRIu64 " misses",
+			target_name(target), MEM_CACHE_PAGES, MEM_CACHE_PAGE_SIZE,
+			cache->hits, cache->misses);
+	for (struct mem_cache_region *r = cache->uncached; r; r = r->next)
+		command_print(CMD_CTX, "uncached: 0x%8.8" PRIx32 " size 0x%8.8" PRIx32,
+				r->address, r->size);
+
+	return ERROR_OK;
+}
+
+static const struct command_registration mem_cache_subcommand_handlers[] = {
+	{
+		.name = "enable",
+		.handler = handle_memcache_enable_command,
+		.mode = COMMAND_ANY,
+		.help = "cache memory reads of the current target while it is halted",
+		.usage = "",
+	},
+	{
+		.name = "disable",
+		.handler = handle_memcache_disable_command,
+		.mode = COMMAND_ANY,
+		.help = "read memory of the current target directly again",
+		.usage = "",
+	},
+	{
+		.name = "flush",
+		.handler = handle_memcache_flush_command,
+		.mode = COMMAND_EXEC,
+		.help = "drop all cached memory contents of the current target",
+		.usage = "",
+	},
+	{
+		.name = "uncached",
+		.handler = handle_memcache_uncached_command,
+		.mode = COMMAND_ANY,
+		.help = "never cache reads from this region, e.g. peripherals",
+		.usage = "address size",
+	},
+	{
+		.name = "status",
+		.handler = handle_memcache_status_command,
+		.mode = COMMAND_ANY,
+		.help = "display memory cache statistics and uncached regions",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration mem_cache_command_handlers[] = {
+	{
+		.name = "memcache",
+		.mode = COMMAND_ANY,
+		.help = "host side target memory read cache",
+		.usage = "",
+		.chain = mem_cache_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int mem_cache_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, mem_cache_command_handlers);
+}
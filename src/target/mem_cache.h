@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_MEM_CACHE_H
+#define OPENOCD_TARGET_MEM_CACHE_H
+
+struct target;
+struct command_context;
+
+/**
+ * @file
+ * Optional host side cache of target memory.
+ *
+ * While a target is halted its memory does not change unless OpenOCD
+ * changes it, yet GDB, RTOS support and scripts read the same locations
+ * over and over. When enabled with "memcache enable", target_read_memory()
+ * serves such reads from page sized copies held on the host. The cache is
+ * dropped whenever the target may have changed memory on its own (resume,
+ * step, algorithm execution, reset) and on every write, since a write can
+ * change other locations as well (flash controller, DMA).
+ * Regions with side effects on read, e.g. peripherals, can be excluded.
+ */
+
+#define MEM_CACHE_PAGE_SIZE		256
+#define MEM_CACHE_PAGES			64
+
+struct mem_cache_region {
+	uint32_t address;
+	uint32_t size;
+	struct mem_cache_region *next;
+};
+
+struct mem_cache_page {
+	bool valid;
+	uint32_t address;
+	uint8_t data[MEM_CACHE_PAGE_SIZE];
+};
+
+struct mem_cache {
+	bool enabled;
+	/* direct mapped by page number */
+	struct mem_cache_page pages[MEM_CACHE_PAGES];
+	/* never cached, e.g. peripheral registers */
+	struct mem_cache_region *uncached;
+	uint64_t hits;
+	uint64_t misses;
+};
+
+/** Returns true if reads of this target may currently be served by the cache. */
+bool mem_cache_active(struct target *target);
+int mem_cache_read(struct target *target,
+		uint32_t address, uint32_t size, uint32_t count, uint8_t *buffer);
+/** Drops the whole cache, the target may have changed its memory. */
+void mem_cache_invalidate(struct target *target);
+void mem_cache_free(struct target *target);
+
+int mem_cache_register_commands(struct command_context *cmd_ctx);
+
+#endif /* OPENOCD_TARGET_MEM_CACHE_H */
@@ -349,6 +349,135 @@ begin_ejtag_dma_write_b:
 	return ERROR_OK;
 }
 
+/*
+ * Queued word transfers: the scans of up to EJTAG_DMA_BLOCK_WORDS words
+ * go out in one flush.  Instead of polling DSTRT from the host, the
+ * adapter waits EJTAG_DMA_WAIT_CLOCKS in Run-Test/Idle and the control
+ * register is captured once; it and DERR are checked after the flush.
+ * The first word found not done or failed is redone with the strict
+ * functions above, and queueing goes on after it.
+ */
+#define EJTAG_DMA_BLOCK_WORDS	128
+#define EJTAG_DMA_WAIT_CLOCKS	8
+
+struct ejtag_dma_scan {
+	uint8_t ctrl[4];	/* DSTRT after the wait */
+	uint8_t data[4];
+	uint8_t derr[4];
+};
+
+static void ejtag_dma_queue_ctrl(struct mips_ejtag *ejtag_info, uint32_t ctrl, uint8_t *in)
+{
+	struct scan_field field;
+	uint8_t t[4];
+
+	field.num_bits = 32;
+	field.out_value = t;
+	buf_set_u32(t, 0, 32, ctrl);
+	field.in_value = in;
+
+	mips_ejtag_set_instr(ejtag_info, EJTAG_INST_CONTROL);
+	jtag_add_dr_scan(ejtag_info->tap, 1, &field, TAP_IDLE);
+}
+
+/* *done is the number of words before the first one that didn't complete */
+static int ejtag_dma_queued(struct mips_ejtag *ejtag_info, uint32_t addr,
+		int count, uint32_t *buf, bool write, int *done)
+{
+	struct ejtag_dma_scan *scans;
+	struct scan_field field;
+	int i, retval;
+
+	scans = calloc(count, sizeof(*scans));
+	if (scans == NULL)
+		return ERROR_FAIL;
+
+	for (i = 0; i < count; i++) {
+		/* Setup Address */
+		mips_ejtag_set_instr(ejtag_info, EJTAG_INST_ADDRESS);
+		mips_ejtag_drscan_32_out(ejtag_info, addr + i * 4);
+
+		if (write) {
+			/* Setup Data */
+			mips_ejtag_set_instr(ejtag_info, EJTAG_INST_DATA);
+			mips_ejtag_drscan_32_out(ejtag_info, buf[i]);
+		}
+
+		/* Initiate DMA & set DSTRT */
+		ejtag_dma_queue_ctrl(ejtag_info, EJTAG_CTRL_DMAACC | EJTAG_CTRL_DMA_WORD |
+				EJTAG_CTRL_DSTRT | (write ? 0 : EJTAG_CTRL_DRWN) |
+				ejtag_info->ejtag_ctrl, NULL);
+
+		/* Wait, then capture DSTRT once */
+		jtag_add_runtest(EJTAG_DMA_WAIT_CLOCKS, TAP_IDLE);
+		ejtag_dma_queue_ctrl(ejtag_info, EJTAG_CTRL_DMAACC | ejtag_info->ejtag_ctrl,
+				scans[i].ctrl);
+
+		if (!write) {
+			/* Read Data */
+			field.num_bits = 32;
+			field.out_value = NULL;
+			field.in_value = scans[i].data;
+			mips_ejtag_set_instr(ejtag_info, EJTAG_INST_DATA);
+			jtag_add_dr_scan(ejtag_info->tap, 1, &field, TAP_IDLE);
+		}
+
+		/* Clear DMA & capture DERR */
+		ejtag_dma_queue_ctrl(ejtag_info, ejtag_info->ejtag_ctrl, scans[i].derr);
+	}
+
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK) {
+		LOG_ERROR("DMA block transfer failed");
+		free(scans);
+		return retval;
+	}
+
+	for (i = 0; i < count; i++) {
+		if ((buf_get_u32(scans[i].ctrl, 0, 32) & EJTAG_CTRL_DSTRT) ||
+				(buf_get_u32(scans[i].derr, 0, 32) & EJTAG_CTRL_DERR))
+			break;
+		if (!write)
+			buf[i] = buf_get_u32(scans[i].data, 0, 32);
+	}
+	*done = i;
+
+	free(scans);
+	keep_alive();
+	return ERROR_OK;
+}
+
+static int ejtag_dma_block(struct mips_ejtag *ejtag_info, uint32_t addr,
+		int count, uint32_t *buf, bool write)
+{
+	int retval, done;
+
+	while (count > 0) {
+		int n = MIN(count, EJTAG_DMA_BLOCK_WORDS);
+
+		retval = ejtag_dma_queued(ejtag_info, addr, n, buf, write, &done);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (done < n) {
+			LOG_DEBUG("DMA Addr = %08" PRIx32 " not done in time, polling", addr + done * 4);
+			if (write)
+				retval = ejtag_dma_write(ejtag_info, addr + done * 4, buf[done]);
+			else
+				retval = ejtag_dma_read(ejtag_info, addr + done * 4, &buf[done]);
+			if (retval != ERROR_OK)
+				return retval;
+			done++;
+		}
+
+		addr += done * 4;
+		buf += done;
+		count -= done;
+	}
+
+	return ERROR_OK;
+}
+
 int mips32_dmaacc_read_mem(struct mips_ejtag *ejtag_info, uint32_t addr, int size, int count, void *buf)
 {
 	switch (size) {
@@ -365,16 +494,7 @@ int mips32_dmaacc_read_mem(struct mips_ejtag *ejtag_info, uint32_t addr, int siz
 
 static int mips32_dmaacc_read_mem32(struct mips_ejtag *ejtag_info, uint32_t addr, int count, uint32_t *buf)
 {
-	int i;
-	int	retval;
-
-	for (i = 0; i < count; i++) {
-		retval = ejtag_dma_read(ejtag_info, addr + i * sizeof(*buf), &buf[i]);
-		if (retval != ERROR_OK)
-			return retval;
-	}
-
-	return ERROR_OK;
+	return ejtag_dma_block(ejtag_info, addr, count, buf, false);
 }
 
 static int mips32_dmaacc_read_mem16(struct mips_ejtag *ejtag_info, uint32_t addr, int count, uint16_t *buf)
@@ -421,16 +541,8 @@ int mips32_dmaacc_write_mem(struct mips_ejtag *ejtag_info, uint32_t addr, int si
 
 static int mips32_dmaacc_write_mem32(struct mips_ejtag *ejtag_info, uint32_t addr, int count, const uint32_t *buf)
 {
-	int i;
-	int retval;
-
-	for (i = 0; i < count; i++) {
-		retval = ejtag_dma_write(ejtag_info, addr + i * sizeof(*buf), buf[i]);
-		if (retval != ERROR_OK)
-			return retval;
-	}
-
-	return ERROR_OK;
+	/* only read from when writing */
+	return ejtag_dma_block(ejtag_info, addr, count, (uint32_t *)buf, true);
 }
 
 static int mips32_dmaacc_write_mem16(struct mips_ejtag *ejtag_info, uint32_t addr, int count, const uint16_t *buf)
@@ -648,11 +648,15 @@ exit:
  * That is, it arranges a D-cache write-back (if CCA = 3) and an I-cache invalidate.
  *
  * The line size is obtained with the rdhwr SYNCI_Step in release 2 or from cp0 config 1 register in release 1.
+ *
+ * All pending ranges are handled by the same code lists, so the line size is
+ * looked up only once however many regions were written.
  */
 static int mips32_pracc_synchronize_cache(struct mips_ejtag *ejtag_info,
-					 uint32_t start_addr, uint32_t end_addr, int cached, int rel)
+					 const struct mips32_cache_range *ranges, unsigned int num_ranges, int rel)
 {
-	struct pracc_queue_info ctx = {.max_code = 256 * 2 + 5};
+	/* two lui per range in the worst case, one when entering it and one on a 64k boundary */
+	struct pracc_queue_info ctx = {.max_code = 256 * 2 + 2 * MIPS32_CACHE_SYNC_MAX + 5};
 	pracc_queue_init(&ctx);
 	if (ctx.retval != ERROR_OK)
 		goto exit;
@@ -699,45 +703,53 @@ static int mips32_pracc_synchronize_cache(struct mips_ejtag *ejtag_info,
 		goto exit;
 	}
 
-	/* make sure start_addr and end_addr have the same offset inside de cache line */
-	start_addr |= clsiz - 1;
-	end_addr |= clsiz - 1;
-
 	ctx.code_count = 0;
 	int count = 0;
-	uint32_t last_upper_base_addr = UPPER16((start_addr + 0x8000));
+	uint32_t last_upper_base_addr = UPPER16((ranges[0].start + 0x8000));
 
 	pracc_add(&ctx, 0, MIPS32_LUI(15, last_upper_base_addr));		/* load upper memory base address to $15 */
 
-	while (start_addr <= end_addr) {						/* main loop */
-		uint32_t upper_base_addr = UPPER16((start_addr + 0x8000));
-		if (last_upper_base_addr != upper_base_addr) {				/* if needed, change upper address in $15 */
-			pracc_add(&ctx, 0, MIPS32_LUI(15, upper_base_addr));
-			last_upper_base_addr = upper_base_addr;
-		}
-		if (rel)
-			pracc_add(&ctx, 0, MIPS32_SYNCI(LOWER16(start_addr), 15));		/* synci instruction, offset($15) */
-
-		else {
-			if (cached == 3)
-				pracc_add(&ctx, 0, MIPS32_CACHE(MIPS32_CACHE_D_HIT_WRITEBACK,
-							LOWER16(start_addr), 15));		/* cache Hit_Writeback_D, offset($15) */
+	for (unsigned int r = 0; r < num_ranges; r++) {
+		/* make sure start_addr and end_addr have the same offset inside de cache line */
+		uint32_t start_addr = ranges[r].start | (clsiz - 1);
+		uint32_t end_addr = ranges[r].end | (clsiz - 1);
+		int cached = ranges[r].cached;
+
+		while (start_addr <= end_addr) {					/* main loop */
+			if (count == 256) {						/* code list full, execute it */
+				pracc_add(&ctx, 0, MIPS32_B(NEG16(ctx.code_count + 1)));	/* jump to start */
+				pracc_add(&ctx, 0, MIPS32_NOP);					/* nop in delay slot */
+
+				ctx.retval = mips32_pracc_queue_exec(ejtag_info, &ctx, NULL);
+				if (ctx.retval != ERROR_OK)
+					goto exit;
+
+				ctx.code_count = 0;
+				count = 0;
+				last_upper_base_addr = UPPER16((start_addr + 0x8000));
+				pracc_add(&ctx, 0, MIPS32_LUI(15, last_upper_base_addr));
+			}
 
-			pracc_add(&ctx, 0, MIPS32_CACHE(MIPS32_CACHE_I_HIT_INVALIDATE,
-							LOWER16(start_addr), 15));		/* cache Hit_Invalidate_I, offset($15) */
-		}
-		start_addr += clsiz;
-		count++;
-		if (count == 256 && start_addr <= end_addr) {				/* more ?, then execute code list */
-			pracc_add(&ctx, 0, MIPS32_B(NEG16(ctx.code_count + 1)));		/* jump to start */
-			pracc_add(&ctx, 0, MIPS32_NOP);						/* nop in delay slot */
+			uint32_t upper_base_addr = UPPER16((start_addr + 0x8000));
+			if (last_upper_base_addr != upper_base_addr) {			/* if needed, change upper address in $15 */
+				pracc_add(&ctx, 0, MIPS32_LUI(15, upper_base_addr));
+				last_upper_base_addr = upper_base_addr;
+			}
+			if (rel)
+				pracc_add(&ctx, 0, MIPS32_SYNCI(LOWER16(start_addr), 15));	/* synci instruction, offset($15) */
 
-			ctx.retval = mips32_pracc_queue_exec(ejtag_info, &ctx, NULL);
-			if (ctx.retval != ERROR_OK)
-				goto exit;
+			else {
+				if (cached == 3)
+					pracc_add(&ctx, 0, MIPS32_CACHE(MIPS32_CACHE_D_HIT_WRITEBACK,
+								LOWER16(start_addr), 15));	/* cache Hit_Writeback_D, offset($15) */
 
-			ctx.code_count = 0;
-			count = 0;
+				pracc_add(&ctx, 0, MIPS32_CACHE(MIPS32_CACHE_I_HIT_INVALIDATE,
+								LOWER16(start_addr), 15));	/* cache Hit_Invalidate_I, offset($15) */
+			}
+			count++;
+			if (start_addr + clsiz < start_addr)			/* wrapped past the top of memory */
+				break;
+			start_addr += clsiz;
 		}
 	}
 	pracc_add(&ctx, 0, MIPS32_SYNC);
@@ -818,25 +830,96 @@ exit:
 	return ctx.retval;
 }
 
-int mips32_pracc_write_mem(struct mips_ejtag *ejtag_info, uint32_t addr, int size, int count, const void *buf)
+/**
+ * Write back / invalidate every range recorded since the last call.
+ * Must run before the core executes anything from memory written while halted.
+ */
+int mips32_pracc_sync_cache(struct mips_ejtag *ejtag_info)
 {
-	int retval = mips32_pracc_write_mem_generic(ejtag_info, addr, size, count, buf);
-	if (retval != ERROR_OK)
-		return retval;
+	if (ejtag_info->cache_sync_count == 0)
+		return ERROR_OK;
 
-	/**
-	 * If we are in the cacheable region and cache is activated,
-	 * we must clean D$ (if Cache Coherency Attribute is set to 3) + invalidate I$ after we did the write,
-	 * so that changes do not continue to live only in D$ (if CCA = 3), but to be
-	 * replicated in I$ also (maybe we wrote the istructions)
-	 */
+	LOG_DEBUG("synchronizing cache for %u range(s)", ejtag_info->cache_sync_count);
+
+	int retval = mips32_pracc_synchronize_cache(ejtag_info, ejtag_info->cache_sync,
+			ejtag_info->cache_sync_count, ejtag_info->cache_sync_rel);
+	ejtag_info->cache_sync_count = 0;
+	return retval;
+}
+
+void mips32_pracc_discard_cache_sync(struct mips_ejtag *ejtag_info)
+{
+	ejtag_info->cache_sync_count = 0;
+}
+
+static int mips32_pracc_add_cache_sync(struct mips_ejtag *ejtag_info,
+		uint32_t start_addr, uint32_t end_addr, int cached)
+{
+	struct mips32_cache_range *range = NULL;
+	unsigned int i;
+
+	/* grow an existing range touching this one if the attributes match */
+	for (i = 0; i < ejtag_info->cache_sync_count; i++) {
+		struct mips32_cache_range *r = &ejtag_info->cache_sync[i];
+		if (r->cached == cached && start_addr <= r->end && r->start <= end_addr) {
+			r->start = MIN(r->start, start_addr);
+			r->end = MAX(r->end, end_addr);
+			range = r;
+			break;
+		}
+	}
+
+	if (range) {
+		/* the grown range may now cover some of the later ones */
+		for (i = range - ejtag_info->cache_sync + 1; i < ejtag_info->cache_sync_count; ) {
+			struct mips32_cache_range *r = &ejtag_info->cache_sync[i];
+			if (r->cached == range->cached && r->start <= range->end && range->start <= r->end) {
+				range->start = MIN(range->start, r->start);
+				range->end = MAX(range->end, r->end);
+				*r = ejtag_info->cache_sync[--ejtag_info->cache_sync_count];
+			} else
+				i++;
+		}
+		return ERROR_OK;
+	}
+
+	if (ejtag_info->cache_sync_count == MIPS32_CACHE_SYNC_MAX) {
+		int retval = mips32_pracc_sync_cache(ejtag_info);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	range = &ejtag_info->cache_sync[ejtag_info->cache_sync_count++];
+	range->start = start_addr;
+	range->end = end_addr;
+	range->cached = cached;
+	return ERROR_OK;
+}
+
+/**
+ * If we are in the cacheable region and cache is activated,
+ * we must clean D$ (if Cache Coherency Attribute is set to 3) + invalidate I$ after we did the write,
+ * so that changes do not continue to live only in D$ (if CCA = 3), but to be
+ * replicated in I$ also (maybe we wrote the istructions)
+ *
+ * The range is only recorded here; the maintenance itself is done by
+ * mips32_pracc_sync_cache() once, before the core is resumed or stepped.
+ */
+int mips32_pracc_cache_sync_range(struct mips_ejtag *ejtag_info, uint32_t addr, uint32_t len)
+{
+	int retval = ERROR_OK;
 	uint32_t conf = 0;
 	int cached = 0;
 
 	if ((KSEGX(addr) == KSEG1) || ((addr >= 0xff200000) && (addr <= 0xff3fffff)))
 		return retval; /*Nothing to do*/
 
-	mips32_cp0_read(ejtag_info, &conf, 16, 0);
+	/* config0 can not change while we only access memory, reuse the value
+	 * read for the ranges already pending */
+	if (ejtag_info->cache_sync_count)
+		conf = ejtag_info->cache_sync_conf;
+	else
+		mips32_cp0_read(ejtag_info, &conf, 16, 0);
 
 	switch (KSEGX(addr)) {
 		case KUSEG:
@@ -860,19 +943,28 @@ int mips32_pracc_write_mem(struct mips_ejtag *ejtag_info, uint32_t addr, int siz
 	 * If cacheable we have to synchronize the cache
 	 */
 	if (cached == 3 || cached == 0) {		/* Write back cache or write through cache */
-		uint32_t start_addr = addr;
-		uint32_t end_addr = addr + count * size;
 		uint32_t rel = (conf & MIPS32_CONFIG0_AR_MASK) >> MIPS32_CONFIG0_AR_SHIFT;
 		if (rel > 1) {
 			LOG_DEBUG("Unknown release in cache code");
 			return ERROR_FAIL;
 		}
-		retval = mips32_pracc_synchronize_cache(ejtag_info, start_addr, end_addr, cached, rel);
+		retval = mips32_pracc_add_cache_sync(ejtag_info, addr, addr + len, cached);
+		ejtag_info->cache_sync_rel = rel;
+		ejtag_info->cache_sync_conf = conf;
 	}
 
 	return retval;
 }
 
+int mips32_pracc_write_mem(struct mips_ejtag *ejtag_info, uint32_t addr, int size, int count, const void *buf)
+{
+	int retval = mips32_pracc_write_mem_generic(ejtag_info, addr, size, count, buf);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return mips32_pracc_cache_sync_range(ejtag_info, addr, count * size);
+}
+
 int mips32_pracc_write_regs(struct mips_ejtag *ejtag_info, uint32_t *regs)
 {
 	static const uint32_t cp0_write_code[] = {
@@ -1033,6 +1125,10 @@ int mips32_pracc_fastdata_xfer(struct mips_ejtag *ejtag_info, struct working_are
 		mips32_pracc_write_mem(ejtag_info, source->address, 4, ARRAY_SIZE(handler_code), handler_code);
 		/* save previous operation to speed to any consecutive read/writes */
 		ejtag_info->fast_access_save = write_t;
+		/* the handler is executed right away, it can't wait for the resume */
+		retval = mips32_pracc_sync_cache(ejtag_info);
+		if (retval != ERROR_OK)
+			return retval;
 	}
 
 	LOG_DEBUG("%s using 0x%.8" PRIx32 " for write handler", __func__, source->address);
@@ -1072,7 +1168,7 @@ int mips32_pracc_fastdata_xfer(struct mips_ejtag *ejtag_info, struct working_are
 	/* Send the load start address */
 	val = addr;
 	mips_ejtag_set_instr(ejtag_info, EJTAG_INST_FASTDATA);
-	mips_ejtag_fastdata_scan(ejtag_info, 1, &val);
+	mips_ejtag_fastdata_scan(ejtag_info, 1, &val, NULL);
 
 	retval = wait_for_pracc_rw(ejtag_info, &ejtag_ctrl);
 	if (retval != ERROR_OK)
@@ -1081,25 +1177,68 @@ int mips32_pracc_fastdata_xfer(struct mips_ejtag *ejtag_info, struct working_are
 	/* Send the load end address */
 	val = addr + (count - 1) * 4;
 	mips_ejtag_set_instr(ejtag_info, EJTAG_INST_FASTDATA);
-	mips_ejtag_fastdata_scan(ejtag_info, 1, &val);
+	mips_ejtag_fastdata_scan(ejtag_info, 1, &val, NULL);
 
 	unsigned num_clocks = 0;	/* like in legacy code */
 	if (ejtag_info->mode != 0)
 		num_clocks = ((uint64_t)(ejtag_info->scan_delay) * jtag_get_speed_khz() + 500000) / 1000000;
 
+	/* SPrAcc comes back in the same scan as the data, so the pending
+	 * access check doesn't cost an extra ECR scan per word */
+	uint8_t *spracc = calloc(count, 1);
+	if (spracc == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
 	for (i = 0; i < count; i++) {
 		jtag_add_clocks(num_clocks);
-		retval = mips_ejtag_fastdata_scan(ejtag_info, write_t, buf++);
-		if (retval != ERROR_OK)
+		retval = mips_ejtag_fastdata_scan(ejtag_info, write_t, buf + i, spracc + i);
+		if (retval != ERROR_OK) {
+			free(spracc);
 			return retval;
+		}
 	}
 
 	retval = jtag_execute_queue();
 	if (retval != ERROR_OK) {
 		LOG_ERROR("fastdata load failed");
+		free(spracc);
 		return retval;
 	}
 
+	/* Scans that found no access pending were not consumed by the core.
+	 * Read data is still in order, so keep the good words and fetch the
+	 * rest one by one; writes can't be repaired and are reported. */
+	int done = 0;
+	for (i = 0; i < count; i++) {
+		if (spracc[i] & 1) {
+			if (!write_t)
+				buf[done] = buf[i];
+			done++;
+		}
+	}
+	free(spracc);
+
+	int missed = count - done;
+	if (missed)
+		LOG_DEBUG("%d of %d fastdata accesses were not pending", missed, count);
+
+	for (i = done; i < count; i++) {
+		retval = wait_for_pracc_rw(ejtag_info, &ejtag_ctrl);
+		if (retval != ERROR_OK)
+			return retval;
+
+		mips_ejtag_set_instr(ejtag_info, EJTAG_INST_FASTDATA);
+		retval = mips_ejtag_fastdata_scan(ejtag_info, write_t, buf + i, NULL);
+		if (retval != ERROR_OK)
+			return retval;
+
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
 	retval = wait_for_pracc_rw(ejtag_info, &ejtag_ctrl);
 	if (retval != ERROR_OK)
 		return retval;
@@ -1113,5 +1252,10 @@ int mips32_pracc_fastdata_xfer(struct mips_ejtag *ejtag_info, struct working_are
 	if (address != MIPS32_PRACC_TEXT)
 		LOG_ERROR("mini program did not return to start");
 
+	if (write_t && missed) {
+		LOG_ERROR("fastdata write lost %d words", missed);
+		return ERROR_FAIL;
+	}
+
 	return retval;
 }
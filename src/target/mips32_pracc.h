@@ -59,6 +59,9 @@ int mips32_pracc_read_mem(struct mips_ejtag *ejtag_info,
 		uint32_t addr, int size, int count, void *buf);
 int mips32_pracc_write_mem(struct mips_ejtag *ejtag_info,
 		uint32_t addr, int size, int count, const void *buf);
+int mips32_pracc_cache_sync_range(struct mips_ejtag *ejtag_info, uint32_t addr, uint32_t len);
+int mips32_pracc_sync_cache(struct mips_ejtag *ejtag_info);
+void mips32_pracc_discard_cache_sync(struct mips_ejtag *ejtag_info);
 int mips32_pracc_fastdata_xfer(struct mips_ejtag *ejtag_info, struct working_area *source,
 		int write_t, uint32_t addr, int count, uint32_t *buf);
 
@@ -442,7 +442,10 @@ int mips_ejtag_init(struct mips_ejtag *ejtag_info)
 	return ERROR_OK;
 }
 
-int mips_ejtag_fastdata_scan(struct mips_ejtag *ejtag_info, int write_t, uint32_t *data)
+/* If spracc is not NULL, it receives the SPrAcc bit shifted out with the
+ * data, which tells whether a processor access was actually pending. */
+int mips_ejtag_fastdata_scan(struct mips_ejtag *ejtag_info, int write_t, uint32_t *data,
+		uint8_t *spracc_in)
 {
 	struct jtag_tap *tap;
 
@@ -456,7 +459,7 @@ int mips_ejtag_fastdata_scan(struct mips_ejtag *ejtag_info, int write_t, uint32_
 	/* fastdata 1-bit register */
 	fields[0].num_bits = 1;
 	fields[0].out_value = &spracc;
-	fields[0].in_value = NULL;
+	fields[0].in_value = spracc_in;
 
 	/* processor access data register 32 bit */
 	fields[1].num_bits = 32;
@@ -176,6 +176,16 @@
 #define EJTAG_VERSION_41		4
 #define EJTAG_VERSION_51		5
 
+#define MIPS32_CACHE_SYNC_MAX		16
+
+/* memory range written while halted whose cache lines still need to be
+ * written back / invalidated before the core executes from it */
+struct mips32_cache_range {
+	uint32_t start;
+	uint32_t end;
+	int cached;
+};
+
 struct mips_ejtag {
 	struct jtag_tap *tap;
 	uint32_t impcode;
@@ -208,6 +218,12 @@ struct mips_ejtag {
 
 	uint32_t ejtag_iba_step_size;
 	uint32_t ejtag_dba_step_size;	/* size of step till next *DBAn register. */
+
+	/* pending cache synchronization, flushed before the core runs */
+	struct mips32_cache_range cache_sync[MIPS32_CACHE_SYNC_MAX];
+	unsigned int cache_sync_count;
+	uint32_t cache_sync_rel;
+	uint32_t cache_sync_conf;
 };
 
 void mips_ejtag_set_instr(struct mips_ejtag *ejtag_info,
@@ -221,7 +237,8 @@ void mips_ejtag_drscan_32_out(struct mips_ejtag *ejtag_info, uint32_t data);
 int mips_ejtag_drscan_32(struct mips_ejtag *ejtag_info, uint32_t *data);
 void mips_ejtag_drscan_8_out(struct mips_ejtag *ejtag_info, uint8_t data);
 int mips_ejtag_drscan_8(struct mips_ejtag *ejtag_info, uint32_t *data);
-int mips_ejtag_fastdata_scan(struct mips_ejtag *ejtag_info, int write_t, uint32_t *data);
+int mips_ejtag_fastdata_scan(struct mips_ejtag *ejtag_info, int write_t, uint32_t *data,
+		uint8_t *spracc);
 
 int mips_ejtag_init(struct mips_ejtag *ejtag_info);
 int mips_ejtag_config_step(struct mips_ejtag *ejtag_info, int enable_step);
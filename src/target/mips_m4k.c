@@ -310,6 +310,9 @@ static int mips_m4k_assert_reset(struct target *target)
 	LOG_DEBUG("target->state: %s",
 		target_state_name(target));
 
+	/* whatever was left in the caches is lost with the reset */
+	mips32_pracc_discard_cache_sync(ejtag_info);
+
 	enum reset_types jtag_reset_config = jtag_get_reset_config();
 
 	/* some cores support connecting while srst is asserted
@@ -462,6 +465,10 @@ static int mips_m4k_internal_restore(struct target *target, int current,
 	else
 		resume_pc = buf_get_u32(mips32->core_cache->reg_list[MIPS32_PC].value, 0, 32);
 
+	int retval = mips32_pracc_sync_cache(ejtag_info);
+	if (retval != ERROR_OK)
+		return retval;
+
 	mips32_restore_context(target);
 
 	/* the front-end may request us not to handle breakpoints */
@@ -554,6 +561,10 @@ static int mips_m4k_step(struct target *target, int current,
 			mips_m4k_unset_breakpoint(target, breakpoint);
 	}
 
+	int retval = mips32_pracc_sync_cache(ejtag_info);
+	if (retval != ERROR_OK)
+		return retval;
+
 	/* restore context */
 	mips32_restore_context(target);
 
@@ -949,6 +960,9 @@ static void mips_m4k_enable_watchpoints(struct target *target)
 	}
 }
 
+static int mips_m4k_bulk_read_memory(struct target *target, uint32_t address,
+		uint32_t count, uint8_t *buffer);
+
 static int mips_m4k_read_memory(struct target *target, uint32_t address,
 		uint32_t size, uint32_t count, uint8_t *buffer)
 {
@@ -970,6 +984,14 @@ static int mips_m4k_read_memory(struct target *target, uint32_t address,
 	if (((size == 4) && (address & 0x3u)) || ((size == 2) && (address & 0x1u)))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
+	if (size == 4 && count > 32) {
+		int retval = mips_m4k_bulk_read_memory(target, address, count, buffer);
+		if (retval == ERROR_OK)
+			return ERROR_OK;
+		if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			LOG_WARNING("Falling back to non-bulk read");
+	}
+
 	/* since we don't know if buffer is aligned, we allocate new mem that is always aligned */
 	void *t = NULL;
 
@@ -1139,38 +1161,51 @@ static int mips_m4k_examine(struct target *target)
 	return ERROR_OK;
 }
 
-static int mips_m4k_bulk_write_memory(struct target *target, uint32_t address,
-		uint32_t count, const uint8_t *buffer)
+static int mips_m4k_alloc_fast_data_area(struct target *target)
 {
 	struct mips32_common *mips32 = target_to_mips32(target);
 	struct mips_ejtag *ejtag_info = &mips32->ejtag_info;
-	struct working_area *fast_data_area;
 	int retval;
-	int write_t = 1;
-
-	LOG_DEBUG("address: 0x%8.8" PRIx32 ", count: 0x%8.8" PRIx32 "", address, count);
-
-	/* check alignment */
-	if (address & 0x3u)
-		return ERROR_TARGET_UNALIGNED_ACCESS;
 
 	if (mips32->fast_data_area == NULL) {
 		/* Get memory for block write handler
 		 * we preserve this area between calls and gain a speed increase
 		 * of about 3kb/sec when writing flash
 		 * this will be released/nulled by the system when the target is resumed or reset */
-		retval = target_alloc_working_area(target,
+		retval = target_alloc_working_area_try(target,
 				MIPS32_FASTDATA_HANDLER_SIZE,
 				&mips32->fast_data_area);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("No working area available");
+		if (retval != ERROR_OK)
 			return retval;
-		}
 
 		/* reset fastadata state so the algo get reloaded */
 		ejtag_info->fast_access_save = -1;
 	}
 
+	return ERROR_OK;
+}
+
+static int mips_m4k_bulk_write_memory(struct target *target, uint32_t address,
+		uint32_t count, const uint8_t *buffer)
+{
+	struct mips32_common *mips32 = target_to_mips32(target);
+	struct mips_ejtag *ejtag_info = &mips32->ejtag_info;
+	struct working_area *fast_data_area;
+	int retval;
+	int write_t = 1;
+
+	LOG_DEBUG("address: 0x%8.8" PRIx32 ", count: 0x%8.8" PRIx32 "", address, count);
+
+	/* check alignment */
+	if (address & 0x3u)
+		return ERROR_TARGET_UNALIGNED_ACCESS;
+
+	retval = mips_m4k_alloc_fast_data_area(target);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("No working area available");
+		return retval;
+	}
+
 	fast_data_area = mips32->fast_data_area;
 
 	if (address <= fast_data_area->address + fast_data_area->size &&
@@ -1201,6 +1236,50 @@ static int mips_m4k_bulk_write_memory(struct target *target, uint32_t address,
 
 	if (retval != ERROR_OK)
 		LOG_ERROR("Fastdata access Failed");
+	else
+		retval = mips32_pracc_cache_sync_range(ejtag_info, address, count * 4);
+
+	return retval;
+}
+
+static int mips_m4k_bulk_read_memory(struct target *target, uint32_t address,
+		uint32_t count, uint8_t *buffer)
+{
+	struct mips32_common *mips32 = target_to_mips32(target);
+	struct mips_ejtag *ejtag_info = &mips32->ejtag_info;
+	struct working_area *fast_data_area;
+	int retval;
+	int write_t = 0;
+
+	LOG_DEBUG("address: 0x%8.8" PRIx32 ", count: 0x%8.8" PRIx32 "", address, count);
+
+	retval = mips_m4k_alloc_fast_data_area(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	fast_data_area = mips32->fast_data_area;
+
+	/* the handler would read back its own code */
+	if (address <= fast_data_area->address + fast_data_area->size &&
+			fast_data_area->address <= address + count * 4)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* mips32_pracc_fastdata_xfer returns uint32_t in host endianness, */
+	/* but byte array should represent target endianness               */
+	uint32_t *t = malloc(count * sizeof(uint32_t));
+	if (t == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	retval = mips32_pracc_fastdata_xfer(ejtag_info, fast_data_area, write_t, address,
+			count, t);
+	if (retval == ERROR_OK)
+		target_buffer_set_u32_array(target, buffer, count, t);
+	else
+		LOG_ERROR("Fastdata access Failed");
+
+	free(t);
 
 	return retval;
 }
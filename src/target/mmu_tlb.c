@@ -0,0 +1,102 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include <helper/perf.h>
+#include "target.h"
+#include "mmu_tlb.h"
+
+static struct mmu_tlb_entry *mmu_tlb_find(struct mmu_tlb *tlb, uint32_t ttb,
+		uint32_t asid, uint32_t va)
+{
+	for (unsigned i = 0; i < MMU_TLB_ENTRIES; i++) {
+		struct mmu_tlb_entry *e = &tlb->entries[i];
+
+		if (e->valid && e->ttb == ttb && e->asid == asid &&
+				(va & ~e->mask) == e->va)
+			return e;
+	}
+	return NULL;
+}
+
+bool mmu_tlb_lookup(struct target *target, uint32_t ttb, uint32_t asid,
+		uint32_t va, uint32_t *pa, uint32_t *attr)
+{
+	struct mmu_tlb_entry *e = NULL;
+
+	if (target->mmu_tlb)
+		e = mmu_tlb_find(target->mmu_tlb, ttb, asid, va);
+
+	if (e == NULL) {
+		perf_add(PERF_MMU_TLB_MISSES, 1);
+		return false;
+	}
+
+	perf_add(PERF_MMU_TLB_HITS, 1);
+	*pa = e->pa | (va & e->mask);
+	if (attr)
+		*attr = e->attr;
+	return true;
+}
+
+void mmu_tlb_add(struct target *target, uint32_t ttb, uint32_t asid,
+		uint32_t va, uint32_t size, uint32_t pa, uint32_t attr)
+{
+	struct mmu_tlb *tlb = target->mmu_tlb;
+	struct mmu_tlb_entry *e;
+
+	if (tlb == NULL) {
+		tlb = calloc(1, sizeof(*tlb));
+		if (tlb == NULL)
+			return;
+		target->mmu_tlb = tlb;
+	}
+
+	/* large pages have one descriptor per small page they cover */
+	if (mmu_tlb_find(tlb, ttb, asid, va))
+		return;
+
+	e = &tlb->entries[tlb->next];
+	tlb->next = (tlb->next + 1) % MMU_TLB_ENTRIES;
+
+	e->valid = true;
+	e->ttb = ttb;
+	e->asid = asid;
+	e->mask = size - 1;
+	e->va = va & ~e->mask;
+	e->pa = pa & ~e->mask;
+	e->attr = attr;
+}
+
+void mmu_tlb_invalidate(struct target *target)
+{
+	struct mmu_tlb *tlb = target->mmu_tlb;
+
+	if (tlb == NULL)
+		return;
+
+	for (unsigned i = 0; i < MMU_TLB_ENTRIES; i++)
+		tlb->entries[i].valid = false;
+}
+
+void mmu_tlb_free(struct target *target)
+{
+	free(target->mmu_tlb);
+	target->mmu_tlb = NULL;
+}
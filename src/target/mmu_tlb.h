@@ -0,0 +1,67 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_MMU_TLB_H
+#define OPENOCD_TARGET_MMU_TLB_H
+
+struct target;
+
+/**
+ * @file
+ * Host side cache of MMU translations.
+ *
+ * Translating a virtual address by walking the page tables costs one or
+ * two physical memory reads, and GDB or OS awareness translate the same
+ * pages over and over while the target is halted. Translations found by
+ * the table walks are kept per target, keyed by the translation table
+ * base, the address space ID and the virtual page. They are dropped
+ * together with the memory cache (see mem_cache.h), i.e. whenever the
+ * target ran or memory, which might hold a page table, was written.
+ */
+
+#define MMU_TLB_ENTRIES		64
+/* second level descriptors fetched per table walk, a power of 2 */
+#define MMU_TLB_PREFETCH	16
+
+struct mmu_tlb_entry {
+	bool valid;
+	uint32_t ttb;
+	uint32_t asid;
+	uint32_t va;		/* first address of the mapping */
+	uint32_t mask;		/* size of the mapping - 1 */
+	uint32_t pa;
+	uint32_t attr;		/* architecture specific, e.g. cacheable/bufferable */
+};
+
+struct mmu_tlb {
+	struct mmu_tlb_entry entries[MMU_TLB_ENTRIES];
+	/* entry replaced next, round robin */
+	unsigned next;
+};
+
+/**
+ * Looks up @a va in the translations cached for @a ttb and @a asid.
+ * @returns true and sets @a pa, and @a attr unless it's NULL, on a hit.
+ */
+bool mmu_tlb_lookup(struct target *target, uint32_t ttb, uint32_t asid,
+		uint32_t va, uint32_t *pa, uint32_t *attr);
+/** Caches the mapping of @a size bytes, a power of 2, at @a va to @a pa. */
+void mmu_tlb_add(struct target *target, uint32_t ttb, uint32_t asid,
+		uint32_t va, uint32_t size, uint32_t pa, uint32_t attr);
+/** Drops all cached translations, the page tables may have changed. */
+void mmu_tlb_invalidate(struct target *target);
+void mmu_tlb_free(struct target *target);
+
+#endif /* OPENOCD_TARGET_MMU_TLB_H */
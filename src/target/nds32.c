@@ -22,9 +22,11 @@
 
 #include <helper/log.h>
 #include <helper/binarybuffer.h>
+#include <helper/time_support.h>
 #include "nds32.h"
 #include "nds32_aice.h"
 #include "nds32_tlb.h"
+#include "mmu_tlb.h"
 #include "nds32_disassembler.h"
 
 const int NDS32_BREAK_16 = 0x00EA;      /* 0xEA00 */
@@ -398,12 +400,16 @@ static struct reg_cache *nds32_build_reg_cache(struct target *target,
 	struct reg_cache *cache = calloc(sizeof(struct reg_cache), 1);
 	struct reg *reg_list = calloc(TOTAL_REG_NUM, sizeof(struct reg));
 	struct nds32_reg *reg_arch_info = calloc(TOTAL_REG_NUM, sizeof(struct nds32_reg));
+	struct reg_data_type *reg_data_types = calloc(TOTAL_REG_NUM, sizeof(struct reg_data_type));
+	struct reg_feature *features = calloc(TOTAL_REG_NUM, sizeof(struct reg_feature));
 	int i;
 
-	if (!cache || !reg_list || !reg_arch_info) {
+	if (!cache || !reg_list || !reg_arch_info || !reg_data_types || !features) {
 		free(cache);
 		free(reg_list);
 		free(reg_arch_info);
+		free(reg_data_types);
+		free(features);
 		return NULL;
 	}
 
@@ -423,7 +429,7 @@ static struct reg_cache *nds32_build_reg_cache(struct target *target,
 		reg_list[i].size = nds32_reg_size(i);
 		reg_list[i].arch_info = &reg_arch_info[i];
 
-		reg_list[i].reg_data_type = calloc(sizeof(struct reg_data_type), 1);
+		reg_list[i].reg_data_type = &reg_data_types[i];
 
 		if (FD0 <= reg_arch_info[i].num && reg_arch_info[i].num <= FD31) {
 			reg_list[i].value = reg_arch_info[i].value;
@@ -464,7 +470,7 @@ static struct reg_cache *nds32_build_reg_cache(struct target *target,
 		else
 			reg_list[i].caller_save = false;
 
-		reg_list[i].feature = malloc(sizeof(struct reg_feature));
+		reg_list[i].feature = &features[i];
 
 		if (R0 <= reg_arch_info[i].num && reg_arch_info[i].num <= IFC_LP)
 			reg_list[i].feature->name = "org.gnu.gdb.nds32.core";
@@ -724,22 +730,41 @@ static int nds32_select_memory_mode(struct target *target, uint32_t address,
 	return ERROR_OK;
 }
 
-int nds32_read_buffer(struct target *target, uint32_t address,
-		uint32_t size, uint8_t *buffer)
+/**
+ * With 'mem_access auto', decide whether a halted core's buffer access can
+ * go over the bus instead of through the CPU. Bus accesses bypass address
+ * translation and the D-cache, so both have to be off; local memories
+ * must also be reachable through DALM if they are enabled.
+ */
+static bool nds32_bus_access_preferred(struct target *target)
 {
 	struct nds32 *nds32 = target_to_nds32(target);
 	struct nds32_memory *memory = &(nds32->memory);
+	struct nds32_edm *edm = &(nds32->edm);
+	int mmu_enabled;
 
-	if ((NDS_MEMORY_ACC_CPU == memory->access_channel) &&
-			(target->state != TARGET_HALTED)) {
-		LOG_WARNING("target was not halted");
-		return ERROR_TARGET_NOT_HALTED;
-	}
+	if (!memory->access_auto || (NDS_MEMORY_ACC_CPU != memory->access_channel))
+		return false;
 
-	LOG_DEBUG("READ BUFFER: ADDR %08" PRIx32 "  SIZE %08" PRIx32,
-			address,
-			size);
+	if (target->state != TARGET_HALTED)
+		return false;
+
+	if ((nds32_mmu(target, &mmu_enabled) != ERROR_OK) || mmu_enabled)
+		return false;
+
+	if ((memory->dcache.line_size != 0) && memory->dcache.enable)
+		return false;
+
+	if ((memory->ilm_enable || memory->dlm_enable) &&
+			!(edm->access_control && edm->direct_access_local_memory))
+		return false;
+
+	return true;
+}
 
+static int nds32_read_buffer_split(struct target *target, uint32_t address,
+		uint32_t size, uint8_t *buffer)
+{
 	int retval = ERROR_OK;
 	struct aice_port_s *aice = target_to_aice(target);
 	uint32_t end_address;
@@ -815,6 +840,46 @@ int nds32_read_buffer(struct target *target, uint32_t address,
 	return ERROR_OK;
 }
 
+int nds32_read_buffer(struct target *target, uint32_t address,
+		uint32_t size, uint8_t *buffer)
+{
+	struct nds32 *nds32 = target_to_nds32(target);
+	struct nds32_memory *memory = &(nds32->memory);
+	struct aice_port_s *aice = target_to_aice(target);
+
+	if ((NDS_MEMORY_ACC_CPU == memory->access_channel) &&
+			(target->state != TARGET_HALTED)) {
+		LOG_WARNING("target was not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	LOG_DEBUG("READ BUFFER: ADDR %08" PRIx32 "  SIZE %08" PRIx32,
+			address,
+			size);
+
+	bool use_bus = nds32_bus_access_preferred(target);
+	int64_t start = timeval_ms();
+
+	if (use_bus) {
+		memory->access_channel = NDS_MEMORY_ACC_BUS;
+		aice_memory_access(aice, NDS_MEMORY_ACC_BUS);
+	}
+
+	int retval = nds32_read_buffer_split(target, address, size, buffer);
+
+	if (use_bus) {
+		memory->access_channel = NDS_MEMORY_ACC_CPU;
+		aice_memory_access(aice, NDS_MEMORY_ACC_CPU);
+	}
+
+	if (retval == ERROR_OK) {
+		memory->perf.read_bytes += size;
+		memory->perf.read_ms += timeval_ms() - start;
+	}
+
+	return retval;
+}
+
 int nds32_read_memory(struct target *target, uint32_t address,
 		uint32_t size, uint32_t count, uint8_t *buffer)
 {
@@ -847,22 +912,9 @@ int nds32_read_phys_memory(struct target *target, uint32_t address,
 	return result;
 }
 
-int nds32_write_buffer(struct target *target, uint32_t address,
+static int nds32_write_buffer_split(struct target *target, uint32_t address,
 		uint32_t size, const uint8_t *buffer)
 {
-	struct nds32 *nds32 = target_to_nds32(target);
-	struct nds32_memory *memory = &(nds32->memory);
-
-	if ((NDS_MEMORY_ACC_CPU == memory->access_channel) &&
-			(target->state != TARGET_HALTED)) {
-		LOG_WARNING("target was not halted");
-		return ERROR_TARGET_NOT_HALTED;
-	}
-
-	LOG_DEBUG("WRITE BUFFER: ADDR %08" PRIx32 "  SIZE %08" PRIx32,
-			address,
-			size);
-
 	struct aice_port_s *aice = target_to_aice(target);
 	int retval = ERROR_OK;
 	uint32_t end_address;
@@ -924,6 +976,46 @@ int nds32_write_buffer(struct target *target, uint32_t address,
 	return retval;
 }
 
+int nds32_write_buffer(struct target *target, uint32_t address,
+		uint32_t size, const uint8_t *buffer)
+{
+	struct nds32 *nds32 = target_to_nds32(target);
+	struct nds32_memory *memory = &(nds32->memory);
+	struct aice_port_s *aice = target_to_aice(target);
+
+	if ((NDS_MEMORY_ACC_CPU == memory->access_channel) &&
+			(target->state != TARGET_HALTED)) {
+		LOG_WARNING("target was not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	LOG_DEBUG("WRITE BUFFER: ADDR %08" PRIx32 "  SIZE %08" PRIx32,
+			address,
+			size);
+
+	bool use_bus = nds32_bus_access_preferred(target);
+	int64_t start = timeval_ms();
+
+	if (use_bus) {
+		memory->access_channel = NDS_MEMORY_ACC_BUS;
+		aice_memory_access(aice, NDS_MEMORY_ACC_BUS);
+	}
+
+	int retval = nds32_write_buffer_split(target, address, size, buffer);
+
+	if (use_bus) {
+		memory->access_channel = NDS_MEMORY_ACC_CPU;
+		aice_memory_access(aice, NDS_MEMORY_ACC_CPU);
+	}
+
+	if (retval == ERROR_OK) {
+		memory->perf.write_bytes += size;
+		memory->perf.write_ms += timeval_ms() - start;
+	}
+
+	return retval;
+}
+
 int nds32_write_memory(struct target *target, uint32_t address,
 		uint32_t size, uint32_t count, const uint8_t *buffer)
 {
@@ -1677,15 +1769,27 @@ int nds32_init_arch_info(struct target *target, struct nds32 *nds32)
 int nds32_virtual_to_physical(struct target *target, uint32_t address, uint32_t *physical)
 {
 	struct nds32 *nds32 = target_to_nds32(target);
+	uint32_t value_mr1;
 
 	if (nds32->memory.address_translation == false) {
 		*physical = address;
 		return ERROR_OK;
 	}
 
-	if (ERROR_OK == nds32_probe_tlb(nds32, address, physical))
+	/* translations are cached until the target runs, keyed by the page
+	 * table base; the context ID can't change while the core is halted */
+	nds32_get_mapped_reg(nds32, MR1, &value_mr1);
+	if (mmu_tlb_lookup(target, value_mr1, 0, address, physical, NULL))
 		return ERROR_OK;
 
+	if (ERROR_OK == nds32_probe_tlb(nds32, address, physical)) {
+		/* the size of the TLB entry is unknown, the smallest page is safe */
+		mmu_tlb_add(target, value_mr1, 0, address,
+				page_table_info[nds32->mmu_config.default_min_page_size].va_offset_mask + 1,
+				*physical, 0);
+		return ERROR_OK;
+	}
+
 	if (ERROR_OK == nds32_walk_page_table(nds32, address, physical))
 		return ERROR_OK;
 
@@ -121,6 +121,14 @@ struct nds32_cache {
 	bool lock_support;
 };
 
+/** Buffer access statistics, reported by 'nds32 perf' */
+struct nds32_perf {
+	uint64_t read_bytes;
+	uint64_t write_bytes;
+	int64_t read_ms;
+	int64_t write_ms;
+};
+
 struct nds32_memory {
 
 	/** ICache */
@@ -168,6 +176,12 @@ struct nds32_memory {
 	/** Memory access method */
 	enum nds_memory_access access_channel;
 
+	/** Use the bus for buffer accesses while MMU and D-cache are off */
+	bool access_auto;
+
+	/** Buffer access statistics */
+	struct nds32_perf perf;
+
 	/** Memory access mode */
 	enum nds_memory_select mode;
 
@@ -76,26 +76,68 @@ COMMAND_HANDLER(handle_nds32_memory_access_command)
 	}
 
 	if (CMD_ARGC > 0) {
+		memory->access_auto = false;
 		if (strcmp(CMD_ARGV[0], "bus") == 0)
 			memory->access_channel = NDS_MEMORY_ACC_BUS;
 		else if (strcmp(CMD_ARGV[0], "cpu") == 0)
 			memory->access_channel = NDS_MEMORY_ACC_CPU;
-		else /* default access channel is NDS_MEMORY_ACC_CPU */
+		else if (strcmp(CMD_ARGV[0], "auto") == 0) {
+			/* cpu channel, buffers go over the bus when MMU/D-cache are off */
+			memory->access_channel = NDS_MEMORY_ACC_CPU;
+			memory->access_auto = true;
+		} else /* default access channel is NDS_MEMORY_ACC_CPU */
 			memory->access_channel = NDS_MEMORY_ACC_CPU;
 
-		LOG_DEBUG("memory access channel is changed to %s",
+		LOG_DEBUG("memory access channel is changed to %s%s",
+				memory->access_auto ? "auto " : "",
 				NDS_MEMORY_ACCESS_NAME[memory->access_channel]);
 
 		aice_memory_access(aice, memory->access_channel);
 	} else {
-		command_print(CMD_CTX, "%s: memory access channel: %s",
+		command_print(CMD_CTX, "%s: memory access channel: %s%s",
 				target_name(target),
+				memory->access_auto ? "auto " : "",
 				NDS_MEMORY_ACCESS_NAME[memory->access_channel]);
 	}
 
 	return ERROR_OK;
 }
 
+static void nds32_perf_print(struct command_context *cmd_ctx, const char *dir,
+		uint64_t bytes, int64_t ms)
+{
+	if (ms > 0)
+		command_print(cmd_ctx, "%s: %" PRIu64 " bytes in %" PRId64 " ms (%.3f KiB/s)",
+				dir, bytes, ms, bytes / 1024.0 * 1000.0 / ms);
+	else
+		command_print(cmd_ctx, "%s: %" PRIu64 " bytes", dir, bytes);
+}
+
+COMMAND_HANDLER(handle_nds32_perf_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct nds32 *nds32 = target_to_nds32(target);
+	struct nds32_perf *perf = &(nds32->memory.perf);
+
+	if (!is_nds32(nds32)) {
+		command_print(CMD_CTX, "current target isn't an Andes core");
+		return ERROR_FAIL;
+	}
+
+	if (CMD_ARGC > 0) {
+		if (strcmp(CMD_ARGV[0], "reset") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		memset(perf, 0, sizeof(*perf));
+		return ERROR_OK;
+	}
+
+	command_print(CMD_CTX, "%s: buffer access throughput", target_name(target));
+	nds32_perf_print(CMD_CTX, "read", perf->read_bytes, perf->read_ms);
+	nds32_perf_print(CMD_CTX, "write", perf->write_bytes, perf->write_ms);
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_nds32_memory_mode_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -957,9 +999,16 @@ static const struct command_registration nds32_exec_command_handlers[] = {
 		.name = "mem_access",
 		.handler = handle_nds32_memory_access_command,
 		.mode = COMMAND_EXEC,
-		.usage = "['bus'|'cpu']",
+		.usage = "['bus'|'cpu'|'auto']",
 		.help = "display/change memory access channel",
 	},
+	{
+		.name = "perf",
+		.handler = handle_nds32_perf_command,
+		.mode = COMMAND_EXEC,
+		.usage = "['reset']",
+		.help = "display/reset memory buffer access throughput",
+	},
 	{
 		.name = "mem_mode",
 		.handler = handle_nds32_memory_mode_command,
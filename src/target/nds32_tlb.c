@@ -21,6 +21,7 @@
 
 #include "nds32_aice.h"
 #include "nds32_tlb.h"
+#include "mmu_tlb.h"
 
 int nds32_probe_tlb(struct nds32 *nds32, const uint32_t virtual_address,
 		uint32_t *physical_address)
@@ -46,6 +47,8 @@ int nds32_walk_page_table(struct nds32 *nds32, const uint32_t virtual_address,
 	uint32_t load_address;
 	uint32_t L1_page_table_entry;
 	uint32_t L2_page_table_entry;
+	uint8_t L2_page_table_entries[4 * MMU_TLB_PREFETCH];
+	uint32_t L2_offset, L2_first;
 	uint32_t page_size_index = nds32->mmu_config.default_min_page_size;
 	struct page_table_walker_info_s *page_table_info_p =
 		&(page_table_info[page_size_index]);
@@ -62,12 +65,29 @@ int nds32_walk_page_table(struct nds32 *nds32, const uint32_t virtual_address,
 	if (L1_page_table_entry & 0x1) /* L1_PTE not present */
 		return ERROR_FAIL;
 
-	load_address = (L1_page_table_entry & page_table_info_p->L2_base_mask) |
-		((virtual_address & page_table_info_p->L2_offset_mask) >>
-		 page_table_info_p->L2_offset_shift);
+	/* fetch the entries of the neighbouring pages as well and cache
+	 * their translations, the next accesses are likely to need them */
+	L2_offset = (virtual_address & page_table_info_p->L2_offset_mask) >>
+		page_table_info_p->L2_offset_shift;
+	L2_first = L2_offset & ~(4 * MMU_TLB_PREFETCH - 1);
+	load_address = (L1_page_table_entry & page_table_info_p->L2_base_mask) | L2_first;
 	/* load_address is physical address */
-	nds32_read_buffer(target, load_address, 4, (uint8_t *)&L2_page_table_entry);
+	nds32_read_buffer(target, load_address, sizeof(L2_page_table_entries),
+			L2_page_table_entries);
 
+	for (unsigned i = 0; i < MMU_TLB_PREFETCH; i++) {
+		uint32_t entry = target_buffer_get_u32(target, L2_page_table_entries + 4 * i);
+		uint32_t page_va = (virtual_address & page_table_info_p->L1_offset_mask) |
+			((L2_first + 4 * i) << page_table_info_p->L2_offset_shift);
+
+		if (entry & 0x1)
+			mmu_tlb_add(target, value_mr1, 0, page_va,
+					page_table_info_p->va_offset_mask + 1,
+					entry & page_table_info_p->ppn_mask, 0);
+	}
+
+	L2_page_table_entry = target_buffer_get_u32(target,
+			L2_page_table_entries + L2_offset - L2_first);
 	if ((L2_page_table_entry & 0x1) != 0x1) /* L2_PTE not valid */
 		return ERROR_FAIL;
 
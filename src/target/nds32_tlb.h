@@ -39,6 +39,8 @@ struct page_table_walker_info_s {
 	uint32_t ppn_mask;
 };
 
+extern struct page_table_walker_info_s page_table_info[PAGE_SIZE_NUM];
+
 extern int nds32_probe_tlb(struct nds32 *nds32, const uint32_t virtual_address,
 		uint32_t *physical_address);
 extern int nds32_walk_page_table(struct nds32 *nds32, const uint32_t virtual_address,
@@ -1212,13 +1212,12 @@ static int or1k_checksum_memory(struct target *target, uint32_t address,
 static int or1k_profiling(struct target *target, uint32_t *samples,
 		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
 {
-	struct timeval timeout, now;
+	int64_t timeout;
 	struct or1k_common *or1k = target_to_or1k(target);
 	struct or1k_du *du_core = or1k_to_du(or1k);
 	int retval = ERROR_OK;
 
-	gettimeofday(&timeout, NULL);
-	timeval_add_time(&timeout, seconds, 0);
+	timeout = timeval_ms() + seconds * 1000;
 
 	LOG_INFO("Starting or1k profiling. Sampling npc as fast as we can...");
 
@@ -1244,9 +1243,7 @@ static int or1k_profiling(struct target *target, uint32_t *samples,
 
 		samples[sample_count++] = reg_value;
 
-		gettimeofday(&now, NULL);
-		if ((sample_count >= max_num_samples) ||
-			((now.tv_sec >= timeout.tv_sec) && (now.tv_usec >= timeout.tv_usec))) {
+		if ((sample_count >= max_num_samples) || timeval_ms() >= timeout) {
 			LOG_INFO("Profiling completed. %" PRIu32 " samples.", sample_count);
 			break;
 		}
@@ -136,6 +136,8 @@
 #define MAX_BUS_ERRORS			2
 
 #define MAX_BURST_SIZE			(4 * 1024)
+/* bursts queued back to back before their status and CRC are checked */
+#define MAX_PIPELINED_BURSTS		8
 
 #define STATUS_BYTES			1
 #define CRC_LEN				4
@@ -420,7 +422,7 @@ static int adbg_ctrl_read(struct or1k_jtag *jtag_info, uint32_t regidx,
  * 32-bit address
  * 16-bit length (of the burst, in words)
  */
-static int adbg_burst_command(struct or1k_jtag *jtag_info, uint32_t opcode,
+static void adbg_queue_burst_command(struct or1k_jtag *jtag_info, uint32_t opcode,
 			      uint32_t address, uint16_t length_words)
 {
 	uint32_t data[2];
@@ -437,6 +439,12 @@ static int adbg_burst_command(struct or1k_jtag *jtag_info, uint32_t opcode,
 	field.in_value = NULL;
 
 	jtag_add_dr_scan(jtag_info->tap, 1, &field, TAP_IDLE);
+}
+
+static int adbg_burst_command(struct or1k_jtag *jtag_info, uint32_t opcode,
+			      uint32_t address, uint16_t length_words)
+{
+	adbg_queue_burst_command(jtag_info, opcode, address, length_words);
 
 	return jtag_execute_queue();
 }
@@ -596,6 +604,119 @@ out:
 	return retval;
 }
 
+/* Queue several WB burst reads back to back and execute them at once.
+ * Each burst is then checked on its own; a burst with a missing status
+ * bit or a bad CRC is read again alone through adbg_wb_burst_read().
+ * A WB bus error can't be tied to one burst, so it redoes all of them.
+ */
+static int adbg_wb_burst_read_pipelined(struct or1k_jtag *jtag_info, int size,
+			      int count, uint32_t start_address, uint8_t *data)
+{
+	uint8_t opcode;
+	int retval;
+
+	if (size == 1)
+		opcode = DBG_WB_CMD_BREAD8;
+	else if (size == 2)
+		opcode = DBG_WB_CMD_BREAD16;
+	else
+		opcode = DBG_WB_CMD_BREAD32;
+
+	int num_bursts = DIV_ROUND_UP(count, MAX_BURST_SIZE);
+	int scan_bytes = MAX_BURST_SIZE * size + CRC_LEN + STATUS_BYTES;
+	uint8_t *in_buffer = malloc(num_bursts * scan_bytes);
+	if (in_buffer == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	LOG_DEBUG("Queuing %d burst reads, word size %d, word count %d, start address 0x%08" PRIx32,
+		  num_bursts, size, count, start_address);
+
+	for (int i = 0; i < num_bursts; i++) {
+		int words = MIN(count - i * MAX_BURST_SIZE, MAX_BURST_SIZE);
+		struct scan_field field;
+
+		adbg_queue_burst_command(jtag_info, opcode,
+				start_address + i * MAX_BURST_SIZE * size, words);
+
+		field.num_bits = (words * size + CRC_LEN + STATUS_BYTES) * 8;
+		field.out_value = NULL;
+		field.in_value = in_buffer + i * scan_bytes;
+		jtag_add_dr_scan(jtag_info->tap, 1, &field, TAP_IDLE);
+	}
+
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		goto out;
+
+	for (int i = 0; i < num_bursts; i++) {
+		int words = MIN(count - i * MAX_BURST_SIZE, MAX_BURST_SIZE);
+		int total_size_bytes = words * size;
+		uint32_t address = start_address + i * MAX_BURST_SIZE * size;
+		uint8_t *burst_in = in_buffer + i * scan_bytes;
+		uint8_t *burst_data = data + i * MAX_BURST_SIZE * size;
+
+		int shift = find_status_bit(burst_in, STATUS_BYTES);
+		if (shift >= 0) {
+			buffer_shr(burst_in, total_size_bytes + CRC_LEN + STATUS_BYTES, shift);
+
+			uint32_t crc_read;
+			memcpy(&crc_read, &burst_in[total_size_bytes], 4);
+
+			uint32_t crc_calc = 0xffffffff;
+			for (int j = 0; j < total_size_bytes; j++)
+				crc_calc = adbg_compute_crc(crc_calc, burst_in[j], 8);
+
+			if (crc_calc == crc_read) {
+				memcpy(burst_data, burst_in, total_size_bytes);
+				continue;
+			}
+
+			LOG_WARNING("CRC ERROR at 0x%08" PRIx32 "! Computed 0x%08" PRIx32
+				    ", read CRC 0x%08" PRIx32 ", retrying this burst",
+				    address, crc_calc, crc_read);
+		} else
+			LOG_WARNING("Burst read at 0x%08" PRIx32 " timed out, retrying this burst",
+				    address);
+
+		retval = adbg_wb_burst_read(jtag_info, size, words, address, burst_data);
+		if (retval != ERROR_OK)
+			goto out;
+	}
+
+	if (!(or1k_du_adv.options & ADBG_USE_HISPEED)) {
+		uint32_t err_data[2] = {0, 0};
+
+		retval = adbg_ctrl_read(jtag_info, DBG_WB_REG_ERROR, err_data, 1);
+		if (retval != ERROR_OK)
+			goto out;
+
+		if (err_data[0] & 0x1) {
+			LOG_WARNING("WB bus error during pipelined burst read, retrying bursts one by one");
+
+			err_data[0] = 1;
+			retval = adbg_ctrl_write(jtag_info, DBG_WB_REG_ERROR, err_data, 1);
+			if (retval != ERROR_OK)
+				goto out;
+
+			for (int i = 0; i < num_bursts; i++) {
+				retval = adbg_wb_burst_read(jtag_info, size,
+						MIN(count - i * MAX_BURST_SIZE, MAX_BURST_SIZE),
+						start_address + i * MAX_BURST_SIZE * size,
+						data + i * MAX_BURST_SIZE * size);
+				if (retval != ERROR_OK)
+					goto out;
+			}
+		}
+	}
+
+out:
+	free(in_buffer);
+
+	return retval;
+}
+
 /* Set up and execute a burst write to a contiguous set of addresses */
 static int adbg_wb_burst_write(struct or1k_jtag *jtag_info, const uint8_t *data, int size,
 			int count, unsigned long start_address)
@@ -888,17 +1009,17 @@ static int or1k_adv_jtag_read_memory(struct or1k_jtag *jtag_info,
 
 	while (block_count_left) {
 
-		int blocks_this_round = (block_count_left > MAX_BURST_SIZE) ?
-			MAX_BURST_SIZE : block_count_left;
+		int blocks_this_round = (block_count_left > MAX_PIPELINED_BURSTS * MAX_BURST_SIZE) ?
+			MAX_PIPELINED_BURSTS * MAX_BURST_SIZE : block_count_left;
 
-		retval = adbg_wb_burst_read(jtag_info, size, blocks_this_round,
+		retval = adbg_wb_burst_read_pipelined(jtag_info, size, blocks_this_round,
 					    block_count_address, block_count_buffer);
 		if (retval != ERROR_OK)
 			return retval;
 
 		block_count_left -= blocks_this_round;
-		block_count_address += size * MAX_BURST_SIZE;
-		block_count_buffer += size * MAX_BURST_SIZE;
+		block_count_address += size * blocks_this_round;
+		block_count_buffer += size * blocks_this_round;
 	}
 
 	/* The adv_debug_if always return words and half words in
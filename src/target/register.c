@@ -36,7 +36,164 @@
  * may be separate registers associated with debug or trace modules.
  */
 
-struct reg *register_get_by_name(struct reg_cache *first,
+/*
+ * Name lookups go through a hash index per (first cache, search_all)
+ * pair. Caches are linked into a target by the architecture code
+ * without telling this module, so each index records the chain it was
+ * built from and is rebuilt when the chain no longer matches. Names are
+ * still compared on a hit, and a miss falls back to the linear scan, so
+ * a register renamed after indexing is found all the same.
+ */
+struct reg_index_cache {
+	const struct reg_cache *cache;
+	const struct reg *reg_list;
+	unsigned num_regs;
+};
+
+struct reg_index_entry {
+	uint32_t hash;
+	struct reg *reg;
+};
+
+struct reg_index {
+	const struct reg_cache *first;
+	bool search_all;
+	unsigned num_caches;
+	struct reg_index_cache *caches;
+	/* power of two, at least twice the number of registers */
+	unsigned num_entries;
+	struct reg_index_entry *entries;
+	struct reg_index *next;
+};
+
+static struct reg_index *reg_indexes;
+
+static uint32_t register_name_hash(const char *name)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+
+	while (*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void register_index_free(struct reg_index *index)
+{
+	free(index->caches);
+	free(index->entries);
+	free(index);
+}
+
+static bool register_index_matches(const struct reg_index *index)
+{
+	const struct reg_cache *cache = index->first;
+	unsigned n;
+
+	for (n = 0; cache; n++) {
+		if (n == index->num_caches)
+			return false;
+		if (index->caches[n].cache != cache ||
+				index->caches[n].reg_list != cache->reg_list ||
+				index->caches[n].num_regs != cache->num_regs)
+			return false;
+		if (!index->search_all) {
+			n++;
+			break;
+		}
+		cache = cache->next;
+	}
+
+	return n == index->num_caches;
+}
+
+static int register_index_build(struct reg_index *index)
+{
+	const struct reg_cache *cache;
+	unsigned num_caches = 0;
+	unsigned num_regs = 0;
+
+	for (cache = index->first; cache; cache = cache->next) {
+		num_caches++;
+		num_regs += cache->num_regs;
+		if (!index->search_all)
+			break;
+	}
+
+	unsigned num_entries = 16;
+	while (num_entries < 2 * num_regs)
+		num_entries <<= 1;
+
+	struct reg_index_cache *caches = calloc(num_caches, sizeof(*caches));
+	struct reg_index_entry *entries = calloc(num_entries, sizeof(*entries));
+	if (caches == NULL || entries == NULL) {
+		free(caches);
+		free(entries);
+		return ERROR_FAIL;
+	}
+
+	free(index->caches);
+	free(index->entries);
+	index->caches = caches;
+	index->entries = entries;
+	index->num_caches = num_caches;
+	index->num_entries = num_entries;
+
+	cache = index->first;
+	for (unsigned n = 0; n < num_caches; n++, cache = cache->next) {
+		caches[n].cache = cache;
+		caches[n].reg_list = cache->reg_list;
+		caches[n].num_regs = cache->num_regs;
+
+		for (unsigned i = 0; i < cache->num_regs; i++) {
+			struct reg *reg = &cache->reg_list[i];
+			if (reg->name == NULL)
+				continue;
+
+			uint32_t hash = register_name_hash(reg->name);
+			unsigned slot = hash & (num_entries - 1);
+			/* the first register with a given name wins, like the scan */
+			while (entries[slot].reg && (entries[slot].hash != hash ||
+					strcmp(entries[slot].reg->name, reg->name) != 0))
+				slot = (slot + 1) & (num_entries - 1);
+			if (entries[slot].reg == NULL) {
+				entries[slot].hash = hash;
+				entries[slot].reg = reg;
+			}
+		}
+	}
+
+	return ERROR_OK;
+}
+
+static struct reg_index *register_index_get(struct reg_cache *first, bool search_all)
+{
+	struct reg_index *index;
+
+	for (index = reg_indexes; index; index = index->next)
+		if (index->first == first && index->search_all == search_all)
+			break;
+
+	if (index == NULL) {
+		index = calloc(1, sizeof(*index));
+		if (index == NULL)
+			return NULL;
+		index->first = first;
+		index->search_all = search_all;
+		index->next = reg_indexes;
+		reg_indexes = index;
+	} else if (register_index_matches(index))
+		return index;
+
+	if (register_index_build(index) != ERROR_OK)
+		return NULL;
+
+	return index;
+}
+
+static struct reg *register_scan_by_name(struct reg_cache *first,
 		const char *name, bool search_all)
 {
 	unsigned i;
@@ -57,6 +214,27 @@ struct reg *register_get_by_name(struct reg_cache *first,
 	return NULL;
 }
 
+struct reg *register_get_by_name(struct reg_cache *first,
+		const char *name, bool search_all)
+{
+	if (first == NULL)
+		return NULL;
+
+	struct reg_index *index = register_index_get(first, search_all);
+	if (index) {
+		uint32_t hash = register_name_hash(name);
+		unsigned slot = hash & (index->num_entries - 1);
+
+		for (; index->entries[slot].reg; slot = (slot + 1) & (index->num_entries - 1)) {
+			struct reg *reg = index->entries[slot].reg;
+			if (index->entries[slot].hash == hash && strcmp(reg->name, name) == 0)
+				return reg;
+		}
+	}
+
+	return register_scan_by_name(first, name, search_all);
+}
+
 struct reg_cache **register_get_last_cache_p(struct reg_cache **first)
 {
 	struct reg_cache **cache_p = first;
@@ -76,6 +254,20 @@ void register_unlink_cache(struct reg_cache **cache_p, const struct reg_cache *c
 		cache_p = &((*cache_p)->next);
 	if (*cache_p)
 		*cache_p = cache->next;
+
+	/* the chain changed under every index that covers the cache */
+	for (struct reg_index **p = &reg_indexes; *p; ) {
+		struct reg_index *index = *p;
+		bool covers = index->first == cache;
+
+		for (unsigned n = 0; n < index->num_caches && !covers; n++)
+			covers = index->caches[n].cache == cache;
+		if (covers) {
+			*p = index->next;
+			register_index_free(index);
+		} else
+			p = &index->next;
+	}
 }
 
 /** Marks the contents of the register cache as invalid (and clean). */
@@ -89,6 +281,70 @@ void register_cache_invalidate(struct reg_cache *cache)
 	}
 }
 
+/**
+ * Points the value of every register in @a cache into one zeroed block,
+ * sized from reg->size and rounded up to whole words, instead of a
+ * separate allocation per register.  The registers are laid out in
+ * order, so a whole cache can be copied out of the block.
+ * @returns The block, which the owner of the cache frees; or NULL.
+ */
+void *register_cache_alloc_values(struct reg_cache *cache)
+{
+	size_t total = 0;
+	unsigned i;
+
+	for (i = 0; i < cache->num_regs; i++)
+		total += DIV_ROUND_UP(cache->reg_list[i].size, 32) * 4;
+
+	uint8_t *values = calloc(1, total ? total : 4);
+	if (values == NULL)
+		return NULL;
+
+	uint8_t *value = values;
+	for (i = 0; i < cache->num_regs; i++) {
+		cache->reg_list[i].value = value;
+		value += DIV_ROUND_UP(cache->reg_list[i].size, 32) * 4;
+	}
+
+	return values;
+}
+
+/**
+ * Makes sure every register in @a regs holds a valid value.  Runs of
+ * invalid registers sharing a type with a get_many() method are fetched
+ * in one call; everything else goes through the per-register get().
+ */
+int register_get_many(struct reg **regs, unsigned count)
+{
+	unsigned i = 0;
+
+	while (i < count) {
+		struct reg *reg = regs[i];
+		int retval;
+
+		if (reg->valid) {
+			i++;
+			continue;
+		}
+
+		if (reg->type->get_many) {
+			unsigned n = 1;
+			while (i + n < count && (regs[i + n]->valid
+					|| regs[i + n]->type == reg->type))
+				n++;
+			retval = reg->type->get_many(regs + i, n);
+			i += n;
+		} else {
+			retval = reg->type->get(reg);
+			i++;
+		}
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
 static int register_get_dummy_core_reg(struct reg *reg)
 {
 	return ERROR_OK;
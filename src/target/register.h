@@ -139,13 +139,26 @@ struct reg_cache {
 struct reg_arch_type {
 	int (*get)(struct reg *reg);
 	int (*set)(struct reg *reg, uint8_t *buf);
+	/**
+	 * Optional: fetch @a count registers sharing this type in one
+	 * batch, letting the architecture queue the accesses and flush
+	 * the adapter once.  Registers already valid may be skipped.
+	 */
+	int (*get_many)(struct reg **regs, unsigned count);
 };
 
+/**
+ * Finds the register called @a name in @a first, or in the whole chain
+ * starting at @a first if @a search_all is set. Lookups are hashed; the
+ * index is rebuilt when caches are linked into or out of the chain.
+ */
 struct reg *register_get_by_name(struct reg_cache *first,
 		const char *name, bool search_all);
 struct reg_cache **register_get_last_cache_p(struct reg_cache **first);
 void register_unlink_cache(struct reg_cache **cache_p, const struct reg_cache *cache);
 void register_cache_invalidate(struct reg_cache *cache);
+void *register_cache_alloc_values(struct reg_cache *cache);
+int register_get_many(struct reg **regs, unsigned count);
 
 void register_init_dummy(struct reg *reg);
 
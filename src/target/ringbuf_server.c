@@ -0,0 +1,342 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <server/server.h>
+#include <target/target.h>
+#include <target/ringbuf_server.h>
+
+#define RINGBUF_ID_SIZE		16
+#define RINGBUF_CB_SIZE		(RINGBUF_ID_SIZE + 16)
+#define RINGBUF_WR_OFFSET	(RINGBUF_ID_SIZE + 8)
+/* largest single read from the data buffer */
+#define RINGBUF_CHUNK		1024
+#define RINGBUF_MAX_SUBSCRIBERS	8
+
+struct ringbuf_subscriber {
+	struct connection *connection;
+	struct ringbuf_subscriber *next;
+};
+
+struct ringbuf {
+	struct target *target;
+	uint32_t cb_address;
+	uint32_t buf_address;
+	uint32_t size;
+	bool running;
+	bool log;
+	bool served;
+	uint64_t bytes;
+	uint64_t dropped;
+	uint32_t read_errors;
+	struct ringbuf_subscriber *subscribers;
+	uint8_t data[RINGBUF_CHUNK];
+	struct ringbuf *next;
+};
+
+static struct ringbuf *ringbufs;
+
+static struct ringbuf *ringbuf_find(struct target *target)
+{
+	for (struct ringbuf *rb = ringbufs; rb; rb = rb->next)
+		if (rb->target == target)
+			return rb;
+	return NULL;
+}
+
+static struct ringbuf *ringbuf_get(struct target *target)
+{
+	struct ringbuf *rb = ringbuf_find(target);
+
+	if (rb)
+		return rb;
+
+	rb = calloc(1, sizeof(*rb));
+	if (rb == NULL)
+		return NULL;
+	rb->target = target;
+	rb->log = true;
+
+	rb->next = ringbufs;
+	ringbufs = rb;
+	return rb;
+}
+
+static void ringbuf_forward(struct ringbuf *rb, uint32_t len)
+{
+	rb->bytes += len;
+
+	if (rb->log)
+		LOG_USER_N("%.*s", (int)len, (const char *)rb->data);
+
+	for (struct ringbuf_subscriber *s = rb->subscribers; s; s = s->next) {
+		int written = connection_write(s->connection, rb->data, len);
+		if (written < 0)
+			written = 0;
+		rb->dropped += len - written;
+	}
+}
+
+static int ringbuf_poll(void *priv)
+{
+	struct ringbuf *rb = priv;
+	struct target *target = rb->target;
+	uint8_t offsets[8];
+	uint32_t wr, rd, old_rd;
+	int retval;
+
+	if (!target_was_examined(target))
+		return ERROR_OK;
+
+	/* wr and rd are adjacent, fetch both in one access */
+	retval = target_read_buffer(target, rb->cb_address + RINGBUF_WR_OFFSET,
+			sizeof(offsets), offsets);
+	if (retval != ERROR_OK) {
+		rb->read_errors++;
+		return ERROR_OK;
+	}
+	wr = target_buffer_get_u32(target, offsets);
+	rd = target_buffer_get_u32(target, offsets + 4);
+
+	if (wr >= rb->size || rd >= rb->size) {
+		LOG_ERROR("%s: ring buffer offsets %" PRIu32 "/%" PRIu32
+				" out of range, stopping", target_name(target), wr, rd);
+		ringbuf_stop(target);
+		return ERROR_OK;
+	}
+
+	old_rd = rd;
+	while (rd != wr) {
+		/* the part up to wr, or up to the end of the buffer if it wrapped */
+		uint32_t len = MIN((wr > rd ? wr : rb->size) - rd, RINGBUF_CHUNK);
+
+		retval = target_read_buffer(target, rb->buf_address + rd, len, rb->data);
+		if (retval != ERROR_OK) {
+			rb->read_errors++;
+			break;
+		}
+		ringbuf_forward(rb, len);
+
+		rd += len;
+		if (rd == rb->size)
+			rd = 0;
+	}
+
+	if (rd != old_rd) {
+		retval = target_write_u32(target, rb->cb_address + RINGBUF_WR_OFFSET + 4, rd);
+		if (retval != ERROR_OK)
+			rb->read_errors++;
+	}
+
+	return ERROR_OK;
+}
+
+int ringbuf_setup(struct target *target, uint32_t address, uint32_t size,
+		const char *id)
+{
+	char pattern[RINGBUF_ID_SIZE];
+	uint8_t block[RINGBUF_CHUNK];
+	uint8_t cb[RINGBUF_CB_SIZE];
+	struct ringbuf *rb;
+	uint32_t offset;
+	int retval;
+
+	if (strlen(id) >= RINGBUF_ID_SIZE) {
+		LOG_ERROR("ring buffer id must be shorter than %d characters", RINGBUF_ID_SIZE);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+	memset(pattern, 0, sizeof(pattern));
+	strcpy(pattern, id);
+
+	rb = ringbuf_get(target);
+	if (rb == NULL)
+		return ERROR_FAIL;
+	if (rb->running) {
+		LOG_ERROR("%s: stop the ring buffer before setting it up again", target_name(target));
+		return ERROR_FAIL;
+	}
+	rb->size = 0;
+
+	/* consecutive blocks overlap by the size of the id, so one that
+	 * straddles a block boundary is still found */
+	address &= ~3;
+	for (offset = 0; offset + RINGBUF_CB_SIZE <= size;
+			offset += RINGBUF_CHUNK - RINGBUF_ID_SIZE) {
+		uint32_t len = MIN(size - offset, RINGBUF_CHUNK);
+
+		retval = target_read_buffer(target, address + offset, len, block);
+		if (retval != ERROR_OK)
+			return retval;
+
+		for (uint32_t i = 0; i + RINGBUF_ID_SIZE <= len; i += 4) {
+			if (memcmp(block + i, pattern, RINGBUF_ID_SIZE) == 0) {
+				rb->cb_address = address + offset + i;
+				goto found;
+			}
+		}
+	}
+
+	LOG_ERROR("%s: no ring buffer \"%s\" in 0x%8.8" PRIx32 "..0x%8.8" PRIx32,
+			target_name(target), id, address, address + size);
+	return ERROR_FAIL;
+
+found:
+	retval = target_read_buffer(target, rb->cb_address, sizeof(cb), cb);
+	if (retval != ERROR_OK)
+		return retval;
+
+	rb->buf_address = target_buffer_get_u32(target, cb + RINGBUF_ID_SIZE);
+	rb->size = target_buffer_get_u32(target, cb + RINGBUF_ID_SIZE + 4);
+	if (rb->size == 0) {
+		LOG_ERROR("%s: ring buffer at 0x%8.8" PRIx32 " is not initialized",
+				target_name(target), rb->cb_address);
+		return ERROR_FAIL;
+	}
+
+	LOG_INFO("%s: ring buffer control block at 0x%8.8" PRIx32 ", %" PRIu32
+			" bytes at 0x%8.8" PRIx32, target_name(target), rb->cb_address,
+			rb->size, rb->buf_address);
+	return ERROR_OK;
+}
+
+int ringbuf_start(struct target *target, unsigned int period_ms)
+{
+	struct ringbuf *rb = ringbuf_find(target);
+	int retval;
+
+	if (rb == NULL || rb->size == 0) {
+		LOG_ERROR("%s: no ring buffer set up", target_name(target));
+		return ERROR_FAIL;
+	}
+
+	if (rb->running)
+		ringbuf_stop(target);
+
+	retval = target_register_timer_callback(ringbuf_poll, period_ms, 1, rb);
+	if (retval != ERROR_OK)
+		return retval;
+	rb->running = true;
+
+	return ERROR_OK;
+}
+
+int ringbuf_stop(struct target *target)
+{
+	struct ringbuf *rb = ringbuf_find(target);
+
+	if (rb == NULL || !rb->running)
+		return ERROR_OK;
+
+	rb->running = false;
+	return target_unregister_timer_callback(ringbuf_poll, rb);
+}
+
+int ringbuf_set_log(struct target *target, bool enable)
+{
+	struct ringbuf *rb = ringbuf_get(target);
+
+	if (rb == NULL)
+		return ERROR_FAIL;
+
+	rb->log = enable;
+	return ERROR_OK;
+}
+
+static int ringbuf_new_connection(struct connection *connection)
+{
+	struct ringbuf *rb = connection->service->priv;
+	struct ringbuf_subscriber *s = calloc(1, sizeof(*s));
+
+	if (s == NULL)
+		return ERROR_CONNECTION_REJECTED;
+
+	s->connection = connection;
+	s->next = rb->subscribers;
+	rb->subscribers = s;
+	connection->priv = s;
+
+	LOG_INFO("%s: new ring buffer subscriber", target_name(rb->target));
+	return ERROR_OK;
+}
+
+static int ringbuf_input(struct connection *connection)
+{
+	uint8_t buf[64];
+
+	/* the channel is output only, anything clients send is discarded */
+	int bytes_read = connection_read(connection, buf, sizeof(buf));
+	if (bytes_read <= 0)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
+	return ERROR_OK;
+}
+
+static int ringbuf_connection_closed(struct connection *connection)
+{
+	struct ringbuf *rb = connection->service->priv;
+	struct ringbuf_subscriber *s = connection->priv;
+
+	for (struct ringbuf_subscriber **p = &rb->subscribers; *p; p = &(*p)->next) {
+		if (*p == s) {
+			*p = s->next;
+			break;
+		}
+	}
+	free(s);
+	connection->priv = NULL;
+
+	return ERROR_OK;
+}
+
+int ringbuf_server_add(struct target *target, const char *tcp_port)
+{
+	struct ringbuf *rb = ringbuf_get(target);
+	int retval;
+
+	if (rb == NULL)
+		return ERROR_FAIL;
+
+	if (rb->served) {
+		LOG_ERROR("%s: ring buffer is already served", target_name(target));
+		return ERROR_FAIL;
+	}
+
+	retval = add_service("ringbuf", tcp_port, RINGBUF_MAX_SUBSCRIBERS,
+			ringbuf_new_connection, ringbuf_input, ringbuf_connection_closed, rb);
+	if (retval != ERROR_OK)
+		return retval;
+
+	rb->served = true;
+	return ERROR_OK;
+}
+
+void ringbuf_report(struct command_context *cmd_ctx, struct target *target)
+{
+	struct ringbuf *rb = ringbuf_find(target);
+
+	if (rb == NULL || rb->size == 0) {
+		command_print(cmd_ctx, "no ring buffer set up");
+		return;
+	}
+
+	command_print(cmd_ctx, "ring buffer at 0x%8.8" PRIx32 ", %" PRIu32 " bytes, %s,"
+			" log %s", rb->cb_address, rb->size,
+			rb->running ? "running" : "stopped", rb->log ? "on" : "off");
+	command_print(cmd_ctx, "%" PRIu64 " bytes received, %" PRIu64 " dropped,"
+			" %" PRIu32 " read errors", rb->bytes, rb->dropped, rb->read_errors);
+}
@@ -0,0 +1,59 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_RINGBUF_SERVER_H
+#define OPENOCD_TARGET_RINGBUF_SERVER_H
+
+#include <helper/command.h>
+
+struct target;
+
+/**
+ * @file
+ * Console output through a circular buffer in target RAM. The target
+ * software appends to the buffer, OpenOCD drains it from a timer
+ * callback with memory reads that don't halt the core, and forwards the
+ * data to the log and to TCP clients.
+ *
+ * The control block holds 32-bit words in target byte order:
+ * @code
+ *	char id[16];		// identifier, NUL padded
+ *	uint32_t buffer;	// address of the data buffer
+ *	uint32_t size;		// size of the data buffer in bytes
+ *	uint32_t wr;		// write offset, advanced by the target
+ *	uint32_t rd;		// read offset, advanced by OpenOCD
+ * @endcode
+ * The buffer is empty when wr == rd. The target must store the data
+ * before it advances wr.
+ */
+
+#define RINGBUF_DEFAULT_ID	"OPENOCD RINGBUF"
+
+/**
+ * Searches @a size bytes at @a address for the control block with
+ * identifier @a id, on 4-byte boundaries, and binds it to @a target.
+ */
+int ringbuf_setup(struct target *target, uint32_t address, uint32_t size,
+		const char *id);
+/** Starts or stops draining the buffer every @a period_ms milliseconds. */
+int ringbuf_start(struct target *target, unsigned int period_ms);
+int ringbuf_stop(struct target *target);
+/** Also serves the buffer contents of @a target on TCP port @a tcp_port. */
+int ringbuf_server_add(struct target *target, const char *tcp_port);
+/** Enables or disables forwarding the buffer contents to the log. */
+int ringbuf_set_log(struct target *target, bool enable);
+void ringbuf_report(struct command_context *cmd_ctx, struct target *target);
+
+#endif /* OPENOCD_TARGET_RINGBUF_SERVER_H */
@@ -0,0 +1,577 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <time.h>
+
+#include <helper/log.h>
+#include <helper/binarybuffer.h>
+#include <helper/time_support.h>
+#include "target.h"
+#include "register.h"
+#include "image.h"
+#include "snapshot.h"
+
+/* What the previous record of a file holds, per target and file */
+struct snapshot_state {
+	struct target *target;
+	char *filename;
+	uint32_t address;
+	uint32_t size;
+	uint32_t block_size;
+	uint32_t sequence;
+	uint32_t num_blocks;
+	uint32_t num_groups;
+	/* CRCs of the contents as last saved, NULL until a full record */
+	uint32_t *block_crc;
+	uint32_t *group_crc;
+	struct snapshot_state *next;
+};
+
+static struct snapshot_state *snapshots;
+
+static struct snapshot_state *snapshot_get(struct target *target, const char *filename)
+{
+	struct snapshot_state *state;
+
+	for (state = snapshots; state; state = state->next)
+		if (state->target == target && strcmp(state->filename, filename) == 0)
+			return state;
+
+	state = calloc(1, sizeof(*state));
+	if (state == NULL)
+		return NULL;
+	state->filename = strdup(filename);
+	if (state->filename == NULL) {
+		free(state);
+		return NULL;
+	}
+	state->target = target;
+	state->next = snapshots;
+	snapshots = state;
+	return state;
+}
+
+/* Forget the saved CRCs, the next record is a full one */
+static void snapshot_reset(struct snapshot_state *state)
+{
+	free(state->block_crc);
+	free(state->group_crc);
+	state->block_crc = NULL;
+	state->group_crc = NULL;
+}
+
+static int snapshot_write(FILE *f, const void *data, size_t len)
+{
+	if (fwrite(data, 1, len, f) != len) {
+		LOG_ERROR("failed to write snapshot: %s", strerror(errno));
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+	return ERROR_OK;
+}
+
+static int snapshot_write_u32(FILE *f, uint32_t value)
+{
+	uint8_t buf[4];
+
+	h_u32_to_le(buf, value);
+	return snapshot_write(f, buf, sizeof(buf));
+}
+
+static int snapshot_read(FILE *f, void *data, size_t len)
+{
+	if (fread(data, 1, len, f) != len)
+		return ERROR_FILEIO_OPERATION_FAILED;
+	return ERROR_OK;
+}
+
+static int snapshot_read_u32(FILE *f, uint32_t *value)
+{
+	uint8_t buf[4];
+
+	int retval = snapshot_read(f, buf, sizeof(buf));
+	if (retval == ERROR_OK)
+		*value = le_to_h_u32(buf);
+	return retval;
+}
+
+static int snapshot_write_header(FILE *f, struct snapshot_state *state,
+		uint32_t kind, uint32_t num_blocks, uint32_t num_regs)
+{
+	uint32_t header[SNAPSHOT_HEADER_WORDS] = {
+		SNAPSHOT_MAGIC, SNAPSHOT_VERSION, kind, state->sequence,
+		(uint32_t)time(NULL), state->address, state->size,
+		state->block_size, num_blocks, num_regs,
+	};
+	int retval = ERROR_OK;
+
+	for (unsigned i = 0; i < SNAPSHOT_HEADER_WORDS && retval == ERROR_OK; i++)
+		retval = snapshot_write_u32(f, header[i]);
+	return retval;
+}
+
+static int snapshot_write_regs(FILE *f, struct reg **reg_list, int num_regs)
+{
+	int retval = ERROR_OK;
+
+	for (int i = 0; i < num_regs && retval == ERROR_OK; i++) {
+		struct reg *reg = reg_list[i];
+		size_t len = strlen(reg->name);
+		uint8_t name_len = MIN(len, 255);
+
+		retval = snapshot_write(f, &name_len, 1);
+		if (retval == ERROR_OK)
+			retval = snapshot_write(f, reg->name, name_len);
+		if (retval == ERROR_OK)
+			retval = snapshot_write_u32(f, reg->size);
+		if (retval == ERROR_OK)
+			retval = snapshot_write(f, reg->value, DIV_ROUND_UP(reg->size, 8));
+	}
+
+	return retval;
+}
+
+/* First record of a file: the whole region, with the CRCs of all groups
+ * and blocks computed on the host as it is read */
+static int snapshot_save_full(struct target *target, struct snapshot_state *state,
+		FILE *f, uint32_t *saved)
+{
+	uint32_t group_size = state->block_size * SNAPSHOT_GROUP_BLOCKS;
+	uint32_t offset;
+	int retval;
+
+	state->num_blocks = DIV_ROUND_UP(state->size, state->block_size);
+	state->num_groups = DIV_ROUND_UP(state->num_blocks, SNAPSHOT_GROUP_BLOCKS);
+	state->block_crc = calloc(state->num_blocks, sizeof(uint32_t));
+	state->group_crc = calloc(state->num_groups, sizeof(uint32_t));
+	uint8_t *buffer = malloc(MIN(group_size, state->size));
+	if (state->block_crc == NULL || state->group_crc == NULL || buffer == NULL) {
+		free(buffer);
+		snapshot_reset(state);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	for (offset = 0; offset < state->size; offset += group_size) {
+		uint32_t group = offset / group_size;
+		uint32_t len = MIN(group_size, state->size - offset);
+
+		retval = target_read_buffer(target, state->address + offset, len, buffer);
+		if (retval == ERROR_OK)
+			retval = image_calculate_checksum(buffer, len, &state->group_crc[group]);
+		for (uint32_t pos = 0; pos < len && retval == ERROR_OK; pos += state->block_size)
+			retval = image_calculate_checksum(buffer + pos,
+					MIN(state->block_size, len - pos),
+					&state->block_crc[(offset + pos) / state->block_size]);
+		if (retval == ERROR_OK)
+			retval = snapshot_write(f, buffer, len);
+		if (retval != ERROR_OK)
+			break;
+
+		keep_alive();
+	}
+
+	free(buffer);
+	if (retval != ERROR_OK) {
+		snapshot_reset(state);
+		return retval;
+	}
+
+	*saved = state->num_blocks;
+	return ERROR_OK;
+}
+
+/* Find the blocks which changed since the last record by their CRCs,
+ * first of each group and then of the blocks of changed groups */
+static int snapshot_find_changes(struct target *target, struct snapshot_state *state,
+		uint32_t *changed, uint32_t *num_changed)
+{
+	uint32_t group_size = state->block_size * SNAPSHOT_GROUP_BLOCKS;
+	uint32_t crc;
+	int retval;
+
+	*num_changed = 0;
+	for (uint32_t group = 0; group < state->num_groups; group++) {
+		uint32_t offset = group * group_size;
+
+		retval = target_checksum_memory(target, state->address + offset,
+				MIN(group_size, state->size - offset), &crc);
+		if (retval != ERROR_OK)
+			return retval;
+		if (crc == state->group_crc[group])
+			continue;
+		state->group_crc[group] = crc;
+
+		uint32_t first = group * SNAPSHOT_GROUP_BLOCKS;
+		uint32_t last = MIN(first + SNAPSHOT_GROUP_BLOCKS, state->num_blocks);
+		for (uint32_t block = first; block < last; block++) {
+			uint32_t block_offset = block * state->block_size;
+
+			retval = target_checksum_memory(target, state->address + block_offset,
+					MIN(state->block_size, state->size - block_offset), &crc);
+			if (retval != ERROR_OK)
+				return retval;
+			if (crc != state->block_crc[block]) {
+				state->block_crc[block] = crc;
+				changed[(*num_changed)++] = block;
+			}
+		}
+
+		keep_alive();
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_snapshot_save_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	uint32_t address, size;
+	uint32_t block_size = SNAPSHOT_BLOCK_SIZE;
+	struct duration bench;
+	int retval;
+
+	if (CMD_ARGC < 3 || CMD_ARGC > 4)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], size);
+	if (CMD_ARGC == 4)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3], block_size);
+	if (size == 0 || block_size == 0 || (block_size & 3)) {
+		command_print(CMD_CTX, "size must not be zero, block size a multiple of 4");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	if (target->state != TARGET_HALTED) {
+		LOG_ERROR("Target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	struct snapshot_state *state = snapshot_get(target, CMD_ARGV[0]);
+	if (state == NULL)
+		return ERROR_FAIL;
+
+	if (state->address != address || state->size != size ||
+			state->block_size != block_size) {
+		snapshot_reset(state);
+		state->address = address;
+		state->size = size;
+		state->block_size = block_size;
+	}
+
+	duration_start(&bench);
+
+	struct reg **reg_list;
+	int num_regs;
+	retval = target_get_gdb_reg_list(target, &reg_list, &num_regs, REG_CLASS_GENERAL);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = register_get_many(reg_list, num_regs);
+	if (retval != ERROR_OK) {
+		free(reg_list);
+		return retval;
+	}
+
+	FILE *f = fopen(CMD_ARGV[0], "ab");
+	if (f == NULL) {
+		LOG_ERROR("cannot open %s: %s", CMD_ARGV[0], strerror(errno));
+		free(reg_list);
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+
+	bool full = state->block_crc == NULL;
+	uint32_t saved = 0;
+
+	if (full) {
+		retval = snapshot_write_header(f, state, SNAPSHOT_FULL,
+				DIV_ROUND_UP(size, block_size), num_regs);
+		if (retval == ERROR_OK)
+			retval = snapshot_write_regs(f, reg_list, num_regs);
+		if (retval == ERROR_OK)
+			retval = snapshot_save_full(target, state, f, &saved);
+	} else {
+		uint32_t *changed = malloc(state->num_blocks * sizeof(uint32_t));
+		uint8_t *buffer = malloc(block_size);
+
+		if (changed == NULL || buffer == NULL)
+			retval = ERROR_FAIL;
+		else
+			retval = snapshot_find_changes(target, state, changed, &saved);
+		if (retval == ERROR_OK)
+			retval = snapshot_write_header(f, state, SNAPSHOT_DELTA, saved, num_regs);
+		if (retval == ERROR_OK)
+			retval = snapshot_write_regs(f, reg_list, num_regs);
+
+		for (uint32_t i = 0; i < saved && retval == ERROR_OK; i++) {
+			uint32_t offset = changed[i] * block_size;
+			uint32_t len = MIN(block_size, size - offset);
+
+			retval = target_read_buffer(target, address + offset, len, buffer);
+			if (retval == ERROR_OK)
+				retval = snapshot_write_u32(f, changed[i]);
+			if (retval == ERROR_OK)
+				retval = snapshot_write(f, buffer, len);
+		}
+
+		free(buffer);
+		free(changed);
+
+		/* the record is incomplete, start over with a full one */
+		if (retval != ERROR_OK)
+			snapshot_reset(state);
+	}
+
+	free(reg_list);
+	if (fclose(f) != 0 && retval == ERROR_OK)
+		retval = ERROR_FILEIO_OPERATION_FAILED;
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (duration_measure(&bench) == ERROR_OK)
+		command_print(CMD_CTX, "snapshot %" PRIu32 " of %s: %s, %" PRIu32 " of %"
+				PRIu32 " blocks saved in %fs", state->sequence, target_name(target),
+				full ? "full" : "delta", saved, state->num_blocks,
+				duration_elapsed(&bench));
+
+	state->sequence++;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_snapshot_reset_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	for (struct snapshot_state *state = snapshots; state; state = state->next)
+		if (state->target == target &&
+				(CMD_ARGC == 0 || strcmp(state->filename, CMD_ARGV[0]) == 0))
+			snapshot_reset(state);
+
+	return ERROR_OK;
+}
+
+/* Read the records of a snapshot file, listing them, up to record
+ * @a wanted which is then rebuilt into @a image; -1 lists them all */
+static int snapshot_replay(struct command_context *cmd_ctx, const char *filename,
+		int wanted, uint8_t **image, uint32_t *image_size)
+{
+	FILE *f = fopen(filename, "rb");
+	uint8_t *data = NULL;
+	uint32_t data_address = 0, data_size = 0;
+	int retval = ERROR_OK;
+	int record;
+
+	if (f == NULL) {
+		LOG_ERROR("cannot open %s: %s", filename, strerror(errno));
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+
+	for (record = 0; wanted < 0 || record <= wanted; record++) {
+		uint32_t header[SNAPSHOT_HEADER_WORDS];
+		unsigned i;
+
+		for (i = 0; i < SNAPSHOT_HEADER_WORDS; i++)
+			if (snapshot_read_u32(f, &header[i]) != ERROR_OK)
+				break;
+		if (i == 0 && feof(f))
+			break;
+		if (i < SNAPSHOT_HEADER_WORDS || header[0] != SNAPSHOT_MAGIC ||
+				header[1] != SNAPSHOT_VERSION) {
+			LOG_ERROR("%s: record %d is damaged", filename, record);
+			retval = ERROR_FAIL;
+			break;
+		}
+
+		uint32_t kind = header[2], address = header[5], size = header[6];
+		uint32_t block_size = header[7], num_blocks = header[8];
+		uint32_t num_regs = header[9];
+		time_t stamp = header[4];
+		char when[32];
+
+		strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&stamp));
+		if (wanted < 0 || record == wanted)
+			command_print(cmd_ctx, "%d: %s %s, 0x%8.8" PRIx32 " size 0x%" PRIx32
+					", %" PRIu32 " blocks of %" PRIu32 " bytes", record, when,
+					kind == SNAPSHOT_FULL ? "full" : "delta", address, size,
+					num_blocks, block_size);
+
+		for (uint32_t r = 0; r < num_regs && retval == ERROR_OK; r++) {
+			uint8_t name_len;
+			char name[256];
+			uint32_t bits;
+
+			retval = snapshot_read(f, &name_len, 1);
+			if (retval == ERROR_OK)
+				retval = snapshot_read(f, name, name_len);
+			if (retval == ERROR_OK)
+				retval = snapshot_read_u32(f, &bits);
+			if (retval != ERROR_OK || bits > 4096) {
+				retval = ERROR_FAIL;
+				break;
+			}
+			name[name_len] = 0;
+
+			uint8_t value[512];
+			retval = snapshot_read(f, value, DIV_ROUND_UP(bits, 8));
+			if (retval == ERROR_OK && record == wanted) {
+				char *str = buf_to_str(value, bits, 16);
+				command_print(cmd_ctx, "%s 0x%s", name, str ? str : "?");
+				free(str);
+			}
+		}
+
+		if (retval == ERROR_OK && kind == SNAPSHOT_FULL) {
+			uint8_t *full = realloc(data, size);
+			if (full == NULL)
+				retval = ERROR_FAIL;
+			else {
+				data = full;
+				data_address = address;
+				data_size = size;
+				retval = snapshot_read(f, data, size);
+			}
+		} else if (retval == ERROR_OK) {
+			if (data == NULL || address != data_address || size != data_size) {
+				LOG_ERROR("%s: record %d has no full record before it", filename, record);
+				retval = ERROR_FAIL;
+			}
+			for (uint32_t b = 0; b < num_blocks && retval == ERROR_OK; b++) {
+				uint32_t block;
+
+				retval = snapshot_read_u32(f, &block);
+				if (retval == ERROR_OK && (uint64_t)block * block_size >= size)
+					retval = ERROR_FAIL;
+				if (retval == ERROR_OK)
+					retval = snapshot_read(f, data + block * block_size,
+							MIN(block_size, size - block * block_size));
+			}
+		}
+
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s: record %d is damaged", filename, record);
+			break;
+		}
+	}
+
+	fclose(f);
+
+	if (retval == ERROR_OK && wanted >= 0 && record <= wanted) {
+		LOG_ERROR("%s has only %d records", filename, record);
+		retval = ERROR_FAIL;
+	}
+
+	if (retval == ERROR_OK && image) {
+		*image = data;
+		*image_size = data_size;
+	} else
+		free(data);
+
+	return retval;
+}
+
+COMMAND_HANDLER(handle_snapshot_list_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return snapshot_replay(CMD_CTX, CMD_ARGV[0], -1, NULL, NULL);
+}
+
+COMMAND_HANDLER(handle_snapshot_extract_command)
+{
+	unsigned record;
+	uint8_t *image;
+	uint32_t size;
+
+	if (CMD_ARGC != 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], record);
+
+	int retval = snapshot_replay(CMD_CTX, CMD_ARGV[0], record, &image, &size);
+	if (retval != ERROR_OK)
+		return retval;
+
+	FILE *f = fopen(CMD_ARGV[2], "wb");
+	if (f == NULL) {
+		LOG_ERROR("cannot open %s: %s", CMD_ARGV[2], strerror(errno));
+		free(image);
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+	retval = snapshot_write(f, image, size);
+	if (fclose(f) != 0 && retval == ERROR_OK)
+		retval = ERROR_FILEIO_OPERATION_FAILED;
+	free(image);
+
+	if (retval == ERROR_OK)
+		command_print(CMD_CTX, "wrote %" PRIu32 " bytes to %s", size, CMD_ARGV[2]);
+	return retval;
+}
+
+static const struct command_registration snapshot_subcommand_handlers[] = {
+	{
+		.name = "save",
+		.handler = handle_snapshot_save_command,
+		.mode = COMMAND_EXEC,
+		.help = "append the registers and the memory region to a snapshot "
+			"file, after the first record only the blocks that changed",
+		.usage = "filename address size [block_size]",
+	},
+	{
+		.name = "reset",
+		.handler = handle_snapshot_reset_command,
+		.mode = COMMAND_EXEC,
+		.help = "make the next snapshot of the current target a full one",
+		.usage = "[filename]",
+	},
+	{
+		.name = "list",
+		.handler = handle_snapshot_list_command,
+		.mode = COMMAND_ANY,
+		.help = "list the records of a snapshot file",
+		.usage = "filename",
+	},
+	{
+		.name = "extract",
+		.handler = handle_snapshot_extract_command,
+		.mode = COMMAND_ANY,
+		.help = "show the registers of a record and write the memory "
+			"as it was then to a binary file",
+		.usage = "filename record output",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration snapshot_command_handlers[] = {
+	{
+		.name = "snapshot",
+		.mode = COMMAND_ANY,
+		.help = "incremental snapshots of target memory and registers",
+		.usage = "",
+		.chain = snapshot_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int snapshot_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, snapshot_command_handlers);
+}
@@ -0,0 +1,54 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_SNAPSHOT_H
+#define OPENOCD_TARGET_SNAPSHOT_H
+
+struct command_context;
+
+/**
+ * @file
+ * Incremental snapshots of target memory and registers.
+ *
+ * "snapshot save" appends a record to a snapshot file.  The first record
+ * of a file holds the whole memory region; every later one only the
+ * blocks which changed since the previous record.  Changes are found by
+ * the CRCs of groups of blocks, and then of the blocks of the groups that
+ * differ, all computed on the target with target_checksum_memory(), so
+ * the time and space a snapshot takes grow with the amount of change.
+ *
+ * A record is a header of SNAPSHOT_HEADER_WORDS little endian words:
+ * magic, version, kind (full or delta), sequence number, time (seconds
+ * since the epoch), address, size, block size, number of blocks and
+ * number of registers.  Each register follows as a name length byte, the
+ * name, its size in bits as a word and its value in bytes.  A full record
+ * then holds the region, a delta one holds the number and then the data
+ * of every block it stores.
+ */
+
+#define SNAPSHOT_MAGIC			0x504e534f	/* "OSNP" */
+#define SNAPSHOT_VERSION		1
+#define SNAPSHOT_HEADER_WORDS	10
+
+#define SNAPSHOT_FULL			0
+#define SNAPSHOT_DELTA			1
+
+#define SNAPSHOT_BLOCK_SIZE		4096
+/* blocks per group, checked with a single CRC */
+#define SNAPSHOT_GROUP_BLOCKS	64
+
+int snapshot_register_commands(struct command_context *cmd_ctx);
+
+#endif /* OPENOCD_TARGET_SNAPSHOT_H */
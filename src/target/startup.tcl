@@ -61,8 +61,12 @@ proc ocd_process_reset_inner { MODE } {
 	# TAP reset events get reported; they might enable some taps.
 	init_reset $MODE
 
-	# Examine all targets on enabled taps.
+	# Examine all targets on enabled taps, except those
+	# with deferred examination which were not used yet.
 	foreach t $targets {
+		if {[$t cget -defer-examine] && ![$t was_examined]} {
+			continue
+		}
 		if {![using_jtag] || [jtag tapisenabled [$t cget -chain-position]]} {
 			$t invoke-event examine-start
 			set err [catch "$t arp_examine"]
@@ -42,12 +42,16 @@
 #endif
 
 #include <helper/time_support.h>
+#include <helper/perf.h>
 #include <jtag/jtag.h>
 #include <flash/nor/core.h>
 
 #include "target.h"
 #include "target_type.h"
 #include "target_request.h"
+#include "mem_cache.h"
+#include "snapshot.h"
+#include "mmu_tlb.h"
 #include "breakpoints.h"
 #include "register.h"
 #include "trace.h"
@@ -58,10 +62,6 @@
 /* default halt wait timeout (ms) */
 #define DEFAULT_HALT_TIMEOUT 5000
 
-static int target_read_buffer_default(struct target *target, uint32_t address,
-		uint32_t count, uint8_t *buffer);
-static int target_write_buffer_default(struct target *target, uint32_t address,
-		uint32_t count, const uint8_t *buffer);
 static int target_array2mem(Jim_Interp *interp, struct target *target,
 		int argc, Jim_Obj * const *argv);
 static int target_mem2array(Jim_Interp *interp, struct target *target,
@@ -71,9 +71,6 @@ static int target_get_gdb_fileio_info_default(struct target *target,
 		struct gdb_fileio_info *fileio_info);
 static int target_gdb_fileio_end_default(struct target *target, int retcode,
 		int fileio_errno, bool ctrl_c);
-static int target_profiling_default(struct target *target, uint32_t *samples,
-		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds);
-
 /* targets */
 extern struct target_type arm7tdmi_target;
 extern struct target_type arm720t_target;
@@ -141,10 +138,29 @@ static struct target_type *target_types[] = {
 struct target *all_targets;
 static struct target_event_callback *target_event_callbacks;
 static struct target_timer_callback *target_timer_callbacks;
+
+/* The registered timer callbacks, in a binary min-heap ordered by their
+ * due time, so a pass only has to look at the ones that are due.  Removed
+ * callbacks leave the heap at once, the list keeps them until the next
+ * pass frees them.  timer_due has room for the whole heap, it holds the
+ * callbacks taken off the heap during one pass. */
+#define TIMER_NOT_QUEUED	(~0u)
+static struct target_timer_callback **timer_heap;
+static struct target_timer_callback **timer_due;
+static unsigned int timer_heap_count;
+static unsigned int timer_heap_size;
+static unsigned int timer_callbacks_removed;
 LIST_HEAD(target_reset_callback_list);
 LIST_HEAD(target_trace_callback_list);
 static const int polling_interval = 100;
 
+/* drops what the host caches about target memory, which may have changed */
+static void target_invalidate_caches(struct target *target)
+{
+	mem_cache_invalidate(target);
+	mmu_tlb_invalidate(target);
+}
+
 static const Jim_Nvp nvp_assert[] = {
 	{ .name = "assert", NVP_ASSERT },
 	{ .name = "deassert", NVP_DEASSERT },
@@ -409,52 +425,133 @@ static void target_buffer_set_u8(struct target *target, uint8_t *buffer, uint8_t
 	*buffer = value;
 }
 
-/* write a uint64_t array to a buffer in target memory endianness */
+/* Array conversions pick the byte order once per call. When the target
+ * and the host agree, they are plain copies; otherwise the loops use the
+ * fixed order helpers, which compilers turn into byte swapping loads and
+ * stores and can vectorize. */
+static inline bool target_endianness_is_host(struct target *target)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	return target->endianness == TARGET_LITTLE_ENDIAN;
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return target->endianness != TARGET_LITTLE_ENDIAN;
+#else
+	return false;
+#endif
+}
+
+/* read a uint64_t array from a buffer in target memory endianness */
 void target_buffer_get_u64_array(struct target *target, const uint8_t *buffer, uint32_t count, uint64_t *dstbuf)
 {
 	uint32_t i;
-	for (i = 0; i < count; i++)
-		dstbuf[i] = target_buffer_get_u64(target, &buffer[i * 8]);
+
+	if (target_endianness_is_host(target)) {
+		memcpy(dstbuf, buffer, count * 8);
+		return;
+	}
+
+	if (target->endianness == TARGET_LITTLE_ENDIAN) {
+		for (i = 0; i < count; i++)
+			dstbuf[i] = le_to_h_u64(&buffer[i * 8]);
+	} else {
+		for (i = 0; i < count; i++)
+			dstbuf[i] = be_to_h_u64(&buffer[i * 8]);
+	}
 }
 
-/* write a uint32_t array to a buffer in target memory endianness */
+/* read a uint32_t array from a buffer in target memory endianness */
 void target_buffer_get_u32_array(struct target *target, const uint8_t *buffer, uint32_t count, uint32_t *dstbuf)
 {
 	uint32_t i;
-	for (i = 0; i < count; i++)
-		dstbuf[i] = target_buffer_get_u32(target, &buffer[i * 4]);
+
+	if (target_endianness_is_host(target)) {
+		memcpy(dstbuf, buffer, count * 4);
+		return;
+	}
+
+	if (target->endianness == TARGET_LITTLE_ENDIAN) {
+		for (i = 0; i < count; i++)
+			dstbuf[i] = le_to_h_u32(&buffer[i * 4]);
+	} else {
+		for (i = 0; i < count; i++)
+			dstbuf[i] = be_to_h_u32(&buffer[i * 4]);
+	}
 }
 
-/* write a uint16_t array to a buffer in target memory endianness */
+/* read a uint16_t array from a buffer in target memory endianness */
 void target_buffer_get_u16_array(struct target *target, const uint8_t *buffer, uint32_t count, uint16_t *dstbuf)
 {
 	uint32_t i;
-	for (i = 0; i < count; i++)
-		dstbuf[i] = target_buffer_get_u16(target, &buffer[i * 2]);
+
+	if (target_endianness_is_host(target)) {
+		memcpy(dstbuf, buffer, count * 2);
+		return;
+	}
+
+	if (target->endianness == TARGET_LITTLE_ENDIAN) {
+		for (i = 0; i < count; i++)
+			dstbuf[i] = le_to_h_u16(&buffer[i * 2]);
+	} else {
+		for (i = 0; i < count; i++)
+			dstbuf[i] = be_to_h_u16(&buffer[i * 2]);
+	}
 }
 
 /* write a uint64_t array to a buffer in target memory endianness */
 void target_buffer_set_u64_array(struct target *target, uint8_t *buffer, uint32_t count, const uint64_t *srcbuf)
 {
 	uint32_t i;
-	for (i = 0; i < count; i++)
-		target_buffer_set_u64(target, &buffer[i * 8], srcbuf[i]);
+
+	if (target_endianness_is_host(target)) {
+		memcpy(buffer, srcbuf, count * 8);
+		return;
+	}
+
+	if (target->endianness == TARGET_LITTLE_ENDIAN) {
+		for (i = 0; i < count; i++)
+			h_u64_to_le(&buffer[i * 8], srcbuf[i]);
+	} else {
+		for (i = 0; i < count; i++)
+			h_u64_to_be(&buffer[i * 8], srcbuf[i]);
+	}
 }
 
 /* write a uint32_t array to a buffer in target memory endianness */
 void target_buffer_set_u32_array(struct target *target, uint8_t *buffer, uint32_t count, const uint32_t *srcbuf)
 {
 	uint32_t i;
-	for (i = 0; i < count; i++)
-		target_buffer_set_u32(target, &buffer[i * 4], srcbuf[i]);
+
+	if (target_endianness_is_host(target)) {
+		memcpy(buffer, srcbuf, count * 4);
+		return;
+	}
+
+	if (target->endianness == TARGET_LITTLE_ENDIAN) {
+		for (i = 0; i < count; i++)
+			h_u32_to_le(&buffer[i * 4], srcbuf[i]);
+	} else {
+		for (i = 0; i < count; i++)
+			h_u32_to_be(&buffer[i * 4], srcbuf[i]);
+	}
 }
 
 /* write a uint16_t array to a buffer in target memory endianness */
 void target_buffer_set_u16_array(struct target *target, uint8_t *buffer, uint32_t count, const uint16_t *srcbuf)
 {
 	uint32_t i;
-	for (i = 0; i < count; i++)
-		target_buffer_set_u16(target, &buffer[i * 2], srcbuf[i]);
+
+	if (target_endianness_is_host(target)) {
+		memcpy(buffer, srcbuf, count * 2);
+		return;
+	}
+
+	if (target->endianness == TARGET_LITTLE_ENDIAN) {
+		for (i = 0; i < count; i++)
+			h_u16_to_le(&buffer[i * 2], srcbuf[i]);
+	} else {
+		for (i = 0; i < count; i++)
+			h_u16_to_be(&buffer[i * 2], srcbuf[i]);
+	}
 }
 
 /* return a pointer to a configured target; id is name or number */
@@ -511,6 +608,10 @@ struct target *get_current_target(struct command_context *cmd_ctx)
 		exit(-1);
 	}
 
+	/* commands are the first use of a target with deferred examination */
+	if (cmd_ctx->mode == COMMAND_EXEC)
+		target_examine_deferred(target);
+
 	return target;
 }
 
@@ -605,6 +706,8 @@ int target_resume(struct target *target, int current, uint32_t address, int hand
 
 	target_call_event_callbacks(target, TARGET_EVENT_RESUME_START);
 
+	target_invalidate_caches(target);
+
 	/* note that resume *must* be asynchronous. The CPU can halt before
 	 * we poll. The CPU can even halt at the current PC as a result of
 	 * a software breakpoint being inserted by (a bug?) the application.
@@ -630,8 +733,10 @@ static int target_process_reset(struct command_context *cmd_ctx, enum target_res
 	}
 
 	struct target *target;
-	for (target = all_targets; target; target = target->next)
+	for (target = all_targets; target; target = target->next) {
+		target_invalidate_caches(target);
 		target_call_reset_callbacks(target, reset_mode);
+	}
 
 	/* disable polling during reset to make reset event scripts
 	 * more predictable, i.e. dr/irscan & pathmove in events will
@@ -701,6 +806,22 @@ int target_examine_one(struct target *target)
 	return ERROR_OK;
 }
 
+int target_examine_deferred(struct target *target)
+{
+	if (!target->defer_examine || target_was_examined(target)
+			|| !target->tap->enabled)
+		return ERROR_OK;
+
+	LOG_INFO("%s: examining on first use", target_name(target));
+
+	int64_t start = timeval_ms();
+	int retval = target_examine_one(target);
+	LOG_DEBUG("%s: examined in %" PRId64 " ms", target_name(target),
+			timeval_ms() - start);
+
+	return retval;
+}
+
 static int jtag_enable_callback(enum jtag_event event, void *priv)
 {
 	struct target *target = priv;
@@ -731,7 +852,16 @@ int target_examine(void)
 			continue;
 		}
 
+		/* examined by target_examine_deferred() when first used */
+		if (target->defer_examine) {
+			LOG_DEBUG("%s: examination deferred", target_name(target));
+			continue;
+		}
+
+		int64_t start = timeval_ms();
 		retval = target_examine_one(target);
+		LOG_DEBUG("%s: examined in %" PRId64 " ms", target_name(target),
+				timeval_ms() - start);
 		if (retval != ERROR_OK)
 			return retval;
 	}
@@ -786,6 +916,7 @@ int target_run_algorithm(struct target *target,
 		goto done;
 	}
 
+	target_invalidate_caches(target);
 	target->running_alg = true;
 	retval = target->type->run_algorithm(target,
 			num_mem_params, mem_params,
@@ -826,6 +957,7 @@ int target_start_algorithm(struct target *target,
 		goto done;
 	}
 
+	target_invalidate_caches(target);
 	target->running_alg = true;
 	retval = target->type->start_algorithm(target,
 			num_mem_params, mem_params,
@@ -888,7 +1020,9 @@ int target_run_flash_async_algorithm(struct target *target,
 		uint32_t entry_point, uint32_t exit_point, void *arch_info)
 {
 	int retval;
-	int timeout = 0;
+	int64_t wait_start = 0;
+	uint32_t wait_rp = 0;
+	int poll_delay = 0;
 
 	const uint8_t *buffer_orig = buffer;
 
@@ -905,6 +1039,12 @@ int target_run_flash_async_algorithm(struct target *target,
 	/* validate block_size is 2^n */
 	assert(!block_size || !(block_size & (block_size - 1)));
 
+	/* Each refill costs a read of rp, the data write and a write of wp,
+	 * so only refill once a quarter of the fifo has drained (or the
+	 * remaining data fits); tiny writes would otherwise be dominated by
+	 * adapter round trips while the target is still busy programming. */
+	uint32_t min_run = ((fifo_end_addr - fifo_start_addr) / 4) & ~(block_size - 1);
+
 	retval = target_write_u32(target, wp_addr, wp);
 	if (retval != ERROR_OK)
 		return retval;
@@ -957,24 +1097,35 @@ int target_run_flash_async_algorithm(struct target *target,
 		else
 			thisrun_bytes = fifo_end_addr - wp - block_size;
 
-		if (thisrun_bytes == 0) {
-			/* Throttle polling a bit if transfer is (much) faster than flash
-			 * programming. The exact delay shouldn't matter as long as it's
-			 * less than buffer size / flash speed. This is very unlikely to
-			 * run when using high latency connections such as USB. */
-			alive_sleep(10);
-
-			/* to stop an infinite loop on some targets check and increment a timeout
-			 * this issue was observed on a stellaris using the new ICDI interface */
-			if (timeout++ >= 500) {
+		/* a run cut short by the wrap around is written right away */
+		bool wrap_limited = rp <= wp && rp > fifo_start_addr;
+
+		if (thisrun_bytes == 0 || (thisrun_bytes < min_run && !wrap_limited &&
+				thisrun_bytes < count * block_size)) {
+			/* Throttle polling if transfer is (much) faster than flash
+			 * programming: poll again at once, then back off up to 10ms.
+			 * The exact delay shouldn't matter as long as it's less than
+			 * buffer size / flash speed. */
+			if (poll_delay == 0 || rp != wait_rp) {
+				wait_start = timeval_ms();
+				wait_rp = rp;
+			}
+			if (poll_delay)
+				alive_sleep(poll_delay);
+			poll_delay = poll_delay ? MIN(poll_delay * 2, 10) : 1;
+
+			/* to stop an infinite loop on some targets time out when rp
+			 * stops moving; this issue was observed on a stellaris using
+			 * the new ICDI interface */
+			if (timeval_ms() - wait_start > 5000) {
 				LOG_ERROR("timeout waiting for algorithm, a target reset is recommended");
 				return ERROR_FLASH_OPERATION_FAILED;
 			}
 			continue;
 		}
 
-		/* reset our timeout */
-		timeout = 0;
+		/* reset our backoff and timeout */
+		poll_delay = 0;
 
 		/* Limit to the amount of data we actually want to write */
 		if (thisrun_bytes > count * block_size)
@@ -1028,6 +1179,8 @@ int target_read_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support read_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	if (mem_cache_active(target))
+		return mem_cache_read(target, address, size, count, buffer);
 	return target->type->read_memory(target, address, size, count, buffer);
 }
 
@@ -1056,6 +1209,9 @@ int target_write_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	/* a write may change other memory as well, e.g. flash controller or
+	 * DMA registers, so drop everything */
+	target_invalidate_caches(target);
 	return target->type->write_memory(target, address, size, count, buffer);
 }
 
@@ -1070,6 +1226,7 @@ int target_write_phys_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_phys_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	target_invalidate_caches(target);
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
@@ -1150,6 +1307,7 @@ int target_get_gdb_reg_list(struct target *target,
 int target_step(struct target *target,
 		int current, uint32_t address, int handle_breakpoints)
 {
+	target_invalidate_caches(target);
 	return target->type->step(target, current, address, handle_breakpoints);
 }
 
@@ -1375,37 +1533,111 @@ int target_register_trace_callback(int (*callback)(struct target *target,
 	return ERROR_OK;
 }
 
+static void timer_heap_set(unsigned int i, struct target_timer_callback *cb)
+{
+	timer_heap[i] = cb;
+	cb->heap_index = i;
+}
+
+static void timer_heap_sift_up(unsigned int i)
+{
+	struct target_timer_callback *cb = timer_heap[i];
+
+	while (i > 0) {
+		unsigned int parent = (i - 1) / 2;
+		if (timer_heap[parent]->when <= cb->when)
+			break;
+		timer_heap_set(i, timer_heap[parent]);
+		i = parent;
+	}
+	timer_heap_set(i, cb);
+}
+
+static void timer_heap_sift_down(unsigned int i)
+{
+	struct target_timer_callback *cb = timer_heap[i];
+
+	for (;;) {
+		unsigned int child = 2 * i + 1;
+		if (child >= timer_heap_count)
+			break;
+		if (child + 1 < timer_heap_count &&
+				timer_heap[child + 1]->when < timer_heap[child]->when)
+			child++;
+		if (cb->when <= timer_heap[child]->when)
+			break;
+		timer_heap_set(i, timer_heap[child]);
+		i = child;
+	}
+	timer_heap_set(i, cb);
+}
+
+/* the heap has room for every callback that isn't removed, see
+ * target_register_timer_callback() */
+static void timer_heap_insert(struct target_timer_callback *cb)
+{
+	timer_heap_set(timer_heap_count++, cb);
+	timer_heap_sift_up(cb->heap_index);
+}
+
+static void timer_heap_remove(struct target_timer_callback *cb)
+{
+	unsigned int i = cb->heap_index;
+
+	if (i == TIMER_NOT_QUEUED)
+		return;
+	cb->heap_index = TIMER_NOT_QUEUED;
+
+	struct target_timer_callback *last = timer_heap[--timer_heap_count];
+	if (last == cb)
+		return;
+	timer_heap_set(i, last);
+	timer_heap_sift_up(i);
+	timer_heap_sift_down(last->heap_index);
+}
+
 int target_register_timer_callback(int (*callback)(void *priv), int time_ms, int periodic, void *priv)
 {
 	struct target_timer_callback **callbacks_p = &target_timer_callbacks;
-	struct timeval now;
+	unsigned int live = 1;
 
 	if (callback == NULL)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
 	if (*callbacks_p) {
-		while ((*callbacks_p)->next)
+		while ((*callbacks_p)->next) {
+			live += !(*callbacks_p)->removed;
 			callbacks_p = &((*callbacks_p)->next);
+		}
+		live += !(*callbacks_p)->removed;
 		callbacks_p = &((*callbacks_p)->next);
 	}
 
-	(*callbacks_p) = malloc(sizeof(struct target_timer_callback));
+	if (live > timer_heap_size) {
+		unsigned int size = timer_heap_size ? 2 * timer_heap_size : 16;
+		struct target_timer_callback **heap = realloc(timer_heap, size * sizeof(*heap));
+		if (heap == NULL)
+			return ERROR_FAIL;
+		timer_heap = heap;
+		struct target_timer_callback **due = realloc(timer_due, size * sizeof(*due));
+		if (due == NULL)
+			return ERROR_FAIL;
+		timer_due = due;
+		timer_heap_size = size;
+	}
+
+	(*callbacks_p) = calloc(1, sizeof(struct target_timer_callback));
+	if (*callbacks_p == NULL)
+		return ERROR_FAIL;
 	(*callbacks_p)->callback = callback;
 	(*callbacks_p)->periodic = periodic;
 	(*callbacks_p)->time_ms = time_ms;
 	(*callbacks_p)->removed = false;
 
-	gettimeofday(&now, NULL);
-	(*callbacks_p)->when.tv_usec = now.tv_usec + (time_ms % 1000) * 1000;
-	time_ms -= (time_ms % 1000);
-	(*callbacks_p)->when.tv_sec = now.tv_sec + (time_ms / 1000);
-	if ((*callbacks_p)->when.tv_usec > 1000000) {
-		(*callbacks_p)->when.tv_usec = (*callbacks_p)->when.tv_usec - 1000000;
-		(*callbacks_p)->when.tv_sec += 1;
-	}
-
+	(*callbacks_p)->when = timeval_ms() + time_ms;
 	(*callbacks_p)->priv = priv;
 	(*callbacks_p)->next = NULL;
+	timer_heap_insert(*callbacks_p);
 
 	return ERROR_OK;
 }
@@ -1478,8 +1710,10 @@ int target_unregister_timer_callback(int (*callback)(void *priv), void *priv)
 
 	for (struct target_timer_callback *c = target_timer_callbacks;
 	     c; c = c->next) {
-		if ((c->callback == callback) && (c->priv == priv)) {
+		if (!c->removed && (c->callback == callback) && (c->priv == priv)) {
 			c->removed = true;
+			timer_heap_remove(c);
+			timer_callbacks_removed++;
 			return ERROR_OK;
 		}
 	}
@@ -1500,6 +1734,11 @@ int target_call_event_callbacks(struct target *target, enum target_event event)
 	LOG_DEBUG("target event %i (%s)", event,
 			Jim_Nvp_value2name_simple(nvp_target_event, event)->name);
 
+	/* catch resumes and resets not issued through target_resume() */
+	if (event == TARGET_EVENT_RESUMED || event == TARGET_EVENT_HALTED ||
+			event == TARGET_EVENT_RESET_ASSERT)
+		target_invalidate_caches(target);
+
 	target_handle_event(target, event);
 
 	while (callback) {
@@ -1535,23 +1774,37 @@ int target_call_trace_callbacks(struct target *target, size_t len, uint8_t *data
 }
 
 static int target_timer_callback_periodic_restart(
-		struct target_timer_callback *cb, struct timeval *now)
+		struct target_timer_callback *cb, int64_t now)
 {
-	int time_ms = cb->time_ms;
-	cb->when.tv_usec = now->tv_usec + (time_ms % 1000) * 1000;
-	time_ms -= (time_ms % 1000);
-	cb->when.tv_sec = now->tv_sec + time_ms / 1000;
-	if (cb->when.tv_usec > 1000000) {
-		cb->when.tv_usec = cb->when.tv_usec - 1000000;
-		cb->when.tv_sec += 1;
+	cb->when = now + cb->time_ms;
+
+	/* back on the heap, or moved within it for an early call */
+	if (cb->heap_index == TIMER_NOT_QUEUED)
+		timer_heap_insert(cb);
+	else {
+		timer_heap_sift_up(cb->heap_index);
+		timer_heap_sift_down(cb->heap_index);
 	}
 	return ERROR_OK;
 }
 
 static int target_call_timer_callback(struct target_timer_callback *cb,
-		struct timeval *now)
+		int64_t now)
 {
+	int64_t start_us = perf_time_us();
 	cb->callback(cb->priv);
+	int64_t run_us = perf_time_us() - start_us;
+
+	/* the callback may have removed itself, it isn't freed yet */
+	cb->calls++;
+	cb->run_us += run_us;
+	if (run_us > cb->max_us)
+		cb->max_us = run_us;
+	perf_add(PERF_TIMER_CALLBACKS, 1);
+	perf_add(PERF_TIMER_CALLBACK_US, run_us);
+
+	if (cb->removed)
+		return ERROR_OK;
 
 	if (cb->periodic)
 		return target_timer_callback_periodic_restart(cb, now);
@@ -1571,30 +1824,41 @@ static int target_call_timer_callbacks_check_time(int checktime)
 
 	keep_alive();
 
-	struct timeval now;
-	gettimeofday(&now, NULL);
+	int64_t now = timeval_ms();
+
+	if (checktime) {
+		/* Take all due callbacks off the heap before calling any, so
+		 * one that is due again at once still runs once per pass. */
+		unsigned int due = 0;
+		while (timer_heap_count && timer_heap[0]->when <= now) {
+			timer_due[due++] = timer_heap[0];
+			timer_heap_remove(timer_heap[0]);
+		}
+
+		/* timer_due may move when a callback registers another one */
+		for (unsigned int i = 0; i < due; i++) {
+			if (!timer_due[i]->removed)
+				target_call_timer_callback(timer_due[i], now);
+		}
+	} else {
+		for (struct target_timer_callback *c = target_timer_callbacks; c; c = c->next) {
+			if (!c->removed && c->periodic)
+				target_call_timer_callback(c, now);
+		}
+	}
 
-	/* Store an address of the place containing a pointer to the
-	 * next item; initially, that's a standalone "root of the
-	 * list" variable. */
+	/* Free the removed callbacks.  Store an address of the place
+	 * containing a pointer to the next item; initially, that's a
+	 * standalone "root of the list" variable. */
 	struct target_timer_callback **callback = &target_timer_callbacks;
-	while (*callback) {
+	while (timer_callbacks_removed && *callback) {
 		if ((*callback)->removed) {
 			struct target_timer_callback *p = *callback;
 			*callback = (*callback)->next;
 			free(p);
+			timer_callbacks_removed--;
 			continue;
 		}
-
-		bool call_it = (*callback)->callback &&
-			((!checktime && (*callback)->periodic) ||
-			 now.tv_sec > (*callback)->when.tv_sec ||
-			 (now.tv_sec == (*callback)->when.tv_sec &&
-			  now.tv_usec >= (*callback)->when.tv_usec));
-
-		if (call_it)
-			target_call_timer_callback(*callback, &now);
-
 		callback = &(*callback)->next;
 	}
 
@@ -1613,14 +1877,25 @@ int target_call_timer_callbacks_now(void)
 	return target_call_timer_callbacks_check_time(0);
 }
 
+int target_timer_next_due_ms(void)
+{
+	if (timer_heap_count == 0)
+		return -1;
+
+	int64_t due_ms = timer_heap[0]->when - timeval_ms();
+	if (due_ms < 0)
+		due_ms = 0;
+	return due_ms;
+}
+
 /* Prints the working area layout for debug purposes */
 static void print_wa_layout(struct target *target)
 {
 	struct working_area *c = target->working_areas;
 
 	while (c) {
-		LOG_DEBUG("%c%c 0x%08"PRIx32"-0x%08"PRIx32" (%"PRIu32" bytes)",
-			c->backup ? 'b' : ' ', c->free ? ' ' : '*',
+		LOG_DEBUG("%c%c%c 0x%08"PRIx32"-0x%08"PRIx32" (%"PRIu32" bytes)",
+			c->backup ? 'b' : ' ', c->code_hash ? 'c' : ' ', c->free ? ' ' : '*',
 			c->address, c->address + c->size - 1, c->size);
 		c = c->next;
 	}
@@ -1643,6 +1918,7 @@ static void target_split_working_area(struct working_area *area, uint32_t size)
 		new_wa->size = area->size - size;
 		new_wa->address = area->address + size;
 		new_wa->backup = NULL;
+		new_wa->code_hash = 0;
 		new_wa->user = NULL;
 		new_wa->free = true;
 
@@ -1658,7 +1934,7 @@ static void target_split_working_area(struct working_area *area, uint32_t size)
 	}
 }
 
-/* Merge all adjacent free areas into one */
+/* Merge all adjacent free areas into one, except those holding resident code */
 static void target_merge_working_areas(struct target *target)
 {
 	struct working_area *c = target->working_areas;
@@ -1667,7 +1943,7 @@ static void target_merge_working_areas(struct target *target)
 		assert(c->next->address == c->address + c->size); /* This is an invariant */
 
 		/* Find two adjacent free areas */
-		if (c->free && c->next->free) {
+		if (c->free && c->next->free && !c->code_hash && !c->next->code_hash) {
 			/* Merge the last into the first */
 			c->size += c->next->size;
 
@@ -1690,6 +1966,36 @@ static void target_merge_working_areas(struct target *target)
 	}
 }
 
+static int target_restore_working_area(struct target *target, struct working_area *area);
+
+/* Drop the resident code of all free areas, so they can be merged and reused */
+static void target_evict_working_area_code(struct target *target)
+{
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->free && c->code_hash) {
+			/* restoring was deferred when the area was freed */
+			target_restore_working_area(target, c);
+			c->code_hash = 0;
+		}
+	}
+
+	target_merge_working_areas(target);
+}
+
+/* Find the smallest free area without resident code of at least size bytes */
+static struct working_area *target_find_working_area(struct target *target, uint32_t size)
+{
+	struct working_area *best = NULL;
+
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->free && !c->code_hash && c->size >= size
+				&& (best == NULL || c->size < best->size))
+			best = c;
+	}
+
+	return best;
+}
+
 int target_alloc_working_area_try(struct target *target, uint32_t size, struct working_area **area)
 {
 	/* Reevaluate working area address based on MMU state*/
@@ -1732,6 +2038,7 @@ int target_alloc_working_area_try(struct target *target, uint32_t size, struct w
 			new_wa->size = target->working_area_size & ~3UL; /* 4-byte align */
 			new_wa->address = target->working_area;
 			new_wa->backup = NULL;
+			new_wa->code_hash = 0;
 			new_wa->user = NULL;
 			new_wa->free = true;
 		}
@@ -1743,13 +2050,12 @@ int target_alloc_working_area_try(struct target *target, uint32_t size, struct w
 	if (size % 4)
 		size = (size + 3) & (~3UL);
 
-	struct working_area *c = target->working_areas;
-
-	/* Find the first large enough working area */
-	while (c) {
-		if (c->free && c->size >= size)
-			break;
-		c = c->next;
+	/* Best fit keeps the large free areas for the data buffers, which
+	 * are sized to whatever is left */
+	struct working_area *c = target_find_working_area(target, size);
+	if (c == NULL) {
+		target_evict_working_area_code(target);
+		c = target_find_working_area(target, size);
 	}
 
 	if (c == NULL)
@@ -1795,6 +2101,52 @@ int target_alloc_working_area(struct target *target, uint32_t size, struct worki
 
 }
 
+static uint64_t working_area_code_hash(const uint8_t *code, uint32_t size)
+{
+	/* FNV-1a */
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (uint32_t i = 0; i < size; i++) {
+		hash ^= code[i];
+		hash *= 1099511628211ULL;
+	}
+
+	/* 0 means no code */
+	return hash ? hash : 1;
+}
+
+int target_alloc_working_area_code(struct target *target,
+		const uint8_t *code, uint32_t size, struct working_area **area)
+{
+	uint64_t hash = working_area_code_hash(code, size);
+	uint32_t aligned_size = (size + 3) & ~3UL;
+	int retval;
+
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->free && c->code_hash == hash && c->size == aligned_size) {
+			LOG_DEBUG("reusing resident code in working area at address 0x%08"PRIx32,
+					c->address);
+			c->free = false;
+			c->user = area;
+			*area = c;
+			return ERROR_OK;
+		}
+	}
+
+	retval = target_alloc_working_area(target, size, area);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = target_write_buffer(target, (*area)->address, size, code);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, *area);
+		return retval;
+	}
+
+	(*area)->code_hash = hash;
+	return ERROR_OK;
+}
+
 static int target_restore_working_area(struct target *target, struct working_area *area)
 {
 	int retval = ERROR_OK;
@@ -1817,7 +2169,8 @@ static int target_free_working_area_restore(struct target *target, struct workin
 	if (area->free)
 		return retval;
 
-	if (restore) {
+	/* resident code stays, restoring is deferred until it's evicted */
+	if (restore && !area->code_hash) {
 		retval = target_restore_working_area(target, area);
 		/* REVISIT: Perhaps the area should be freed even if restoring fails. */
 		if (retval != ERROR_OK)
@@ -1865,11 +2218,20 @@ void target_quit(void)
 		pt = t;
 	}
 	target_timer_callbacks = NULL;
+	free(timer_heap);
+	timer_heap = NULL;
+	free(timer_due);
+	timer_due = NULL;
+	timer_heap_count = 0;
+	timer_heap_size = 0;
+	timer_callbacks_removed = 0;
 
 	for (struct target *target = all_targets;
 	     target; target = target->next) {
 		if (target->type->deinit_target)
 			target->type->deinit_target(target);
+		mem_cache_free(target);
+		mmu_tlb_free(target);
 	}
 }
 
@@ -1882,14 +2244,18 @@ static void target_free_all_working_areas_restore(struct target *target, int res
 
 	LOG_DEBUG("freeing all working areas");
 
-	/* Loop through all areas, restoring the allocated ones and marking them as free */
+	/* Loop through all areas, restoring the allocated ones and those holding
+	 * resident code, marking them as free */
 	while (c) {
-		if (!c->free) {
+		if (!c->free || c->code_hash) {
 			if (restore)
 				target_restore_working_area(target, c);
-			c->free = true;
-			*c->user = NULL; /* Same as above */
-			c->user = NULL;
+			if (!c->free) {
+				c->free = true;
+				*c->user = NULL; /* Same as above */
+				c->user = NULL;
+			}
+			c->code_hash = 0;
 		}
 		c = c->next;
 	}
@@ -1905,18 +2271,24 @@ void target_free_all_working_areas(struct target *target)
 	target_free_all_working_areas_restore(target, 1);
 }
 
-/* Find the largest number of bytes that can be allocated */
+/* Find the largest number of bytes that can be allocated, resident code
+ * in adjacent free areas would be evicted to make room */
 uint32_t target_get_working_area_avail(struct target *target)
 {
 	struct working_area *c = target->working_areas;
 	uint32_t max_size = 0;
+	uint32_t run = 0;
 
 	if (c == NULL)
 		return target->working_area_size;
 
 	while (c) {
-		if (c->free && max_size < c->size)
-			max_size = c->size;
+		if (c->free) {
+			run += c->size;
+			if (max_size < run)
+				max_size = run;
+		} else
+			run = 0;
 
 		c = c->next;
 	}
@@ -1958,16 +2330,12 @@ static int target_gdb_fileio_end_default(struct target *target,
 	return ERROR_OK;
 }
 
-static int target_profiling_default(struct target *target, uint32_t *samples,
+int target_profiling_default(struct target *target, uint32_t *samples,
 		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
 {
-	struct timeval timeout, now;
+	int64_t timeout = timeval_ms() + seconds * 1000;
 
-	gettimeofday(&timeout, NULL);
-	timeval_add_time(&timeout, seconds, 0);
-
-	LOG_INFO("Starting profiling. Halting and resuming the"
-			" target as often as we can...");
+	LOG_DEBUG("Halting and resuming the target as often as we can...");
 
 	uint32_t sample_count = 0;
 	/* hopefully it is safe to cache! We want to stop/restart as quickly as possible. */
@@ -1995,12 +2363,8 @@ static int target_profiling_default(struct target *target, uint32_t *samples,
 		if (retval != ERROR_OK)
 			break;
 
-		gettimeofday(&now, NULL);
-		if ((sample_count >= max_num_samples) ||
-			((now.tv_sec >= timeout.tv_sec) && (now.tv_usec >= timeout.tv_usec))) {
-			LOG_INFO("Profiling completed. %" PRIu32 " samples.", sample_count);
+		if ((sample_count >= max_num_samples) || timeval_ms() >= timeout)
 			break;
-		}
 	}
 
 	*num_samples = sample_count;
@@ -2032,10 +2396,11 @@ int target_write_buffer(struct target *target, uint32_t address, uint32_t size,
 		return ERROR_FAIL;
 	}
 
+	target_invalidate_caches(target);
 	return target->type->write_buffer(target, address, size, buffer);
 }
 
-static int target_write_buffer_default(struct target *target, uint32_t address, uint32_t count, const uint8_t *buffer)
+int target_write_buffer_default(struct target *target, uint32_t address, uint32_t count, const uint8_t *buffer)
 {
 	uint32_t size;
 
@@ -2096,7 +2461,7 @@ int target_read_buffer(struct target *target, uint32_t address, uint32_t size, u
 	return target->type->read_buffer(target, address, size, buffer);
 }
 
-static int target_read_buffer_default(struct target *target, uint32_t address, uint32_t count, uint8_t *buffer)
+int target_read_buffer_default(struct target *target, uint32_t address, uint32_t count, uint8_t *buffer)
 {
 	uint32_t size;
 
@@ -2185,6 +2550,36 @@ int target_blank_check_memory(struct target *target, uint32_t address, uint32_t
 	return retval;
 }
 
+int target_fill_memory(struct target *target,
+		uint32_t address, uint32_t count, uint32_t pattern)
+{
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	if (target->type->fill_memory == NULL)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	return target->type->fill_memory(target, address, count, pattern);
+}
+
+int target_blank_check_memory_blocks(struct target *target,
+		struct target_memory_check_block *blocks, int num_blocks,
+		uint8_t erased_value)
+{
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	if (target->type->blank_check_memory_blocks == NULL)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	return target->type->blank_check_memory_blocks(target, blocks,
+			num_blocks, erased_value);
+}
+
 int target_read_u64(struct target *target, uint64_t address, uint64_t *value)
 {
 	uint8_t value_buf[8];
@@ -2485,6 +2880,12 @@ static int sense_handler(void)
 }
 
 /* process target state changes */
+static void target_poll_unqueue_all(void)
+{
+	for (struct target *target = all_targets; target; target = target->next)
+		target->poll_queued = false;
+}
+
 static int handle_target(void *priv)
 {
 	Jim_Interp *interp = (Jim_Interp *)priv;
@@ -2495,6 +2896,9 @@ static int handle_target(void *priv)
 		return ERROR_OK;
 	}
 
+	/* back off before polling if the link showed errors */
+	adapter_speed_monitor();
+
 	/* we do not want to recurse here... */
 	static int recursive;
 	if (!recursive) {
@@ -2539,6 +2943,20 @@ static int handle_target(void *priv)
 		recursive = 0;
 	}
 
+	/* Targets that can queue their status reads do so first, so the
+	 * adapter sees one flush for all of them rather than one each.
+	 */
+	for (struct target *target = all_targets;
+			is_jtag_poll_safe() && target;
+			target = target->next) {
+		if (!target->type->poll_queue || !target_was_examined(target)
+				|| !target->tap->enabled
+				|| target->backoff.times > target->backoff.count
+				|| powerDropout || srstAsserted)
+			continue;
+		target->poll_queued = target->type->poll_queue(target) == ERROR_OK;
+	}
+
 	/* Poll targets for state changes unless that's globally disabled.
 	 * Skip targets that are currently disabled.
 	 */
@@ -2562,8 +2980,17 @@ static int handle_target(void *priv)
 		/* only poll target if we've got power and srst isn't asserted */
 		if (!powerDropout && !srstAsserted) {
 			/* polling may fail silently until the target has been examined */
+			int64_t poll_start = timeval_ms();
+			target->poll_count++;
+			if (target->poll_queued)
+				target->poll_batched++;
 			retval = target_poll(target);
+			target->poll_time_ms += timeval_ms() - poll_start;
 			if (retval != ERROR_OK) {
+				/* the batch may not have completed, so nobody
+				 * else may trust its queued results */
+				target_poll_unqueue_all();
+
 				/* 100ms polling interval. Increase interval between polling up to 5000ms */
 				if (target->backoff.times * polling_interval < 5000) {
 					target->backoff.times *= 2;
@@ -2585,6 +3012,7 @@ static int handle_target(void *priv)
 					target->examined = true;
 					LOG_USER("Examination failed, GDB will be halted. Polling again in %dms",
 						 target->backoff.times * polling_interval);
+					target_poll_unqueue_all();
 					return retval;
 				}
 			}
@@ -2594,6 +3022,8 @@ static int handle_target(void *priv)
 		}
 	}
 
+	target_poll_unqueue_all();
+
 	return retval;
 }
 
@@ -2730,6 +3160,11 @@ COMMAND_HANDLER(handle_poll_command)
 				target->tap->enabled ? "enabled" : "disabled");
 		if (!target->tap->enabled)
 			return ERROR_OK;
+		if (target->poll_count)
+			command_print(CMD_CTX, "background polls: %" PRIu32
+					" (%" PRIu32 " batched), %" PRId64 " ms total",
+					target->poll_count, target->poll_batched,
+					target->poll_time_ms);
 		retval = target_poll(target);
 		if (retval != ERROR_OK)
 			return retval;
@@ -3006,6 +3441,30 @@ COMMAND_HANDLER(handle_md_command)
 typedef int (*target_write_fn)(struct target *target,
 		uint32_t address, uint32_t size, uint32_t count, const uint8_t *buffer);
 
+/* smallest fill that is worth downloading and running the fill algorithm */
+#define TARGET_FILL_ALGO_MIN	1024
+
+static int target_fill_host(struct target *target, uint32_t address,
+		target_write_fn fn, unsigned data_size, unsigned c,
+		const uint8_t *target_buf, unsigned chunk_size)
+{
+	int retval = ERROR_OK;
+
+	for (unsigned x = 0; x < c; x += chunk_size) {
+		unsigned current;
+		current = c - x;
+		if (current > chunk_size)
+			current = chunk_size;
+		retval = fn(target, address + x * data_size, data_size, current, target_buf);
+		if (retval != ERROR_OK)
+			break;
+		/* avoid GDB timeouts */
+		keep_alive();
+	}
+
+	return retval;
+}
+
 static int target_fill_mem(struct target *target,
 		uint32_t address,
 		target_write_fn fn,
@@ -3042,17 +3501,33 @@ static int target_fill_mem(struct target *target,
 
 	int retval = ERROR_OK;
 
-	for (unsigned x = 0; x < c; x += chunk_size) {
-		unsigned current;
-		current = c - x;
-		if (current > chunk_size)
-			current = chunk_size;
-		retval = fn(target, address + x * data_size, data_size, current, target_buf);
-		if (retval != ERROR_OK)
-			break;
-		/* avoid GDB timeouts */
-		keep_alive();
+	/* Large fills of virtual memory on a halted target run on the target,
+	 * only the unaligned head and tail are written from here. The pattern
+	 * repeats every data_size bytes, so the first word of target_buf is
+	 * the pattern for any word aligned address. */
+	uint32_t end = address + c * data_size;
+	uint32_t start_aligned = (address + 3) & ~3;
+	uint32_t end_aligned = end & ~3;
+	if (fn == target_write_memory && target->type->fill_memory != NULL &&
+			target->state == TARGET_HALTED && end_aligned > start_aligned &&
+			end_aligned - start_aligned >= TARGET_FILL_ALGO_MIN) {
+		uint32_t pattern = target_buffer_get_u32(target, target_buf);
+
+		retval = target_fill_memory(target, start_aligned,
+				end_aligned - start_aligned, pattern);
+		if (retval == ERROR_OK) {
+			retval = target_fill_host(target, address, fn, data_size,
+					(start_aligned - address) / data_size, target_buf, chunk_size);
+			if (retval == ERROR_OK)
+				retval = target_fill_host(target, end_aligned, fn, data_size,
+						(end - end_aligned) / data_size, target_buf, chunk_size);
+			free(target_buf);
+			return retval;
+		}
+		LOG_DEBUG("fill algorithm unavailable (%d), writing from the host", retval);
 	}
+
+	retval = target_fill_host(target, address, fn, data_size, c, target_buf, chunk_size);
 	free(target_buf);
 
 	return retval;
@@ -3135,65 +3610,181 @@ static COMMAND_HELPER(parse_load_image_command_CMD_ARGV, struct image *image,
 	return ERROR_OK;
 }
 
-COMMAND_HANDLER(handle_load_image_command)
+/* Get a whole image section, in place when the image allows it. When a
+ * copy has to be made it is returned in *buffer for the caller to free;
+ * otherwise *buffer is NULL. */
+static int image_get_section(struct command_context *cmd_ctx,
+		struct image *image, int section, const uint8_t **data,
+		uint8_t **buffer, size_t *size)
 {
-	uint8_t *buffer;
-	size_t buf_cnt;
-	uint32_t image_size;
-	uint32_t min_address = 0;
-	uint32_t max_address = 0xffffffff;
-	int i;
-	struct image image;
-
-	int retval = CALL_COMMAND_HANDLER(parse_load_image_command_CMD_ARGV,
-			&image, &min_address, &max_address);
-	if (ERROR_OK != retval)
-		return retval;
-
-	struct target *target = get_current_target(CMD_CTX);
+	int retval;
 
-	struct duration bench;
-	duration_start(&bench);
+	*buffer = NULL;
+	*size = image->sections[section].size;
 
-	if (image_open(&image, CMD_ARGV[0], (CMD_ARGC >= 3) ? CMD_ARGV[2] : NULL) != ERROR_OK)
+	if (image_section_data(image, section, 0, *size, data) == ERROR_OK)
 		return ERROR_OK;
 
-	image_size = 0x0;
+	*buffer = malloc(image->sections[section].size);
+	if (*buffer == NULL) {
+		command_print(cmd_ctx,
+					  "error allocating buffer for section (%d bytes)",
+					  (int)(image->sections[section].size));
+		return ERROR_FAIL;
+	}
+
+	retval = image_read_section(image, section, 0x0,
+			image->sections[section].size, *buffer, size);
+	if (retval != ERROR_OK) {
+		free(*buffer);
+		*buffer = NULL;
+		return retval;
+	}
+
+	*data = *buffer;
+	return ERROR_OK;
+}
+
+/* load_image writes sections separated by at most this many bytes as one
+ * run, filling the gaps with zeros... */
+#define LOAD_IMAGE_MAX_GAP	16
+/* ...as long as the run doesn't grow beyond this */
+#define LOAD_IMAGE_MAX_RUN	(256 * 1024)
+
+static int compare_load_section(const void *a, const void *b)
+{
+	const struct imagesection *s1 = *(const struct imagesection **)a;
+	const struct imagesection *s2 = *(const struct imagesection **)b;
+
+	if (s1->base_address != s2->base_address)
+		return s1->base_address > s2->base_address ? 1 : -1;
+	/* keep the image order of sections at the same address */
+	return s1 > s2 ? 1 : (s1 < s2 ? -1 : 0);
+}
+
+/* Read sections [first, last) of the address sorted list into one zero
+ * padded buffer, which the caller frees. */
+static int image_get_run(struct command_context *cmd_ctx, struct image *image,
+		struct imagesection **sections, int first, int last, uint8_t **buffer)
+{
+	uint32_t run_address = sections[first]->base_address;
+	uint32_t run_size = sections[last - 1]->base_address +
+		sections[last - 1]->size - run_address;
+	int retval;
+
+	*buffer = calloc(1, run_size);
+	if (*buffer == NULL) {
+		command_print(cmd_ctx, "error allocating buffer for sections (%d bytes)",
+				(int)run_size);
+		return ERROR_FAIL;
+	}
+
+	for (int j = first; j < last; j++) {
+		size_t size_read;
+
+		retval = image_read_section(image, sections[j] - image->sections, 0x0,
+				sections[j]->size,
+				*buffer + (sections[j]->base_address - run_address), &size_read);
+		if (retval != ERROR_OK) {
+			free(*buffer);
+			*buffer = NULL;
+			return retval;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_load_image_command)
+{
+	uint8_t *buffer;
+	const uint8_t *image_data;
+	size_t buf_cnt;
+	uint32_t image_size;
+	uint32_t min_address = 0;
+	uint32_t max_address = 0xffffffff;
+	int i;
+	struct image image;
+
+	int retval = CALL_COMMAND_HANDLER(parse_load_image_command_CMD_ARGV,
+			&image, &min_address, &max_address);
+	if (ERROR_OK != retval)
+		return retval;
+
+	struct target *target = get_current_target(CMD_CTX);
+
+	struct duration bench;
+	duration_start(&bench);
+
+	if (image_open(&image, CMD_ARGV[0], (CMD_ARGC >= 3) ? CMD_ARGV[2] : NULL) != ERROR_OK)
+		return ERROR_OK;
+
+	/* Sort the sections by address, so that adjacent ones (.text,
+	 * .rodata, .data init values...) can be written as a single run
+	 * instead of many short, unaligned transfers. */
+	struct imagesection **sections = malloc(image.num_sections * sizeof(*sections));
+	if (sections == NULL) {
+		image_close(&image);
+		return ERROR_FAIL;
+	}
+	for (i = 0; i < image.num_sections; i++)
+		sections[i] = &image.sections[i];
+	qsort(sections, image.num_sections, sizeof(*sections), compare_load_section);
+
+	image_size = 0x0;
 	retval = ERROR_OK;
-	for (i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (buffer == NULL) {
-			command_print(CMD_CTX,
-						  "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
-			break;
+	i = 0;
+	while (i < image.num_sections) {
+		int first = i;
+		uint32_t run_address = sections[i]->base_address;
+		uint32_t run_end = run_address + sections[i]->size;
+
+		for (i++; i < image.num_sections; i++) {
+			uint32_t base = sections[i]->base_address;
+
+			/* overlapping sections are written one after the other */
+			if (base < run_end || base - run_end > LOAD_IMAGE_MAX_GAP ||
+					base + sections[i]->size - run_address > LOAD_IMAGE_MAX_RUN)
+				break;
+			run_end = base + sections[i]->size;
 		}
 
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
-			break;
+		/* DANGER!!! beware of unsigned comparision here!!! */
+
+		if (!((run_end >= min_address) && (run_address < max_address)))
+			continue;
+
+		if (i - first == 1) {
+			retval = image_get_section(CMD_CTX, &image,
+					sections[first] - image.sections, &image_data,
+					&buffer, &buf_cnt);
+		} else {
+			retval = image_get_run(CMD_CTX, &image, sections, first, i, &buffer);
+			image_data = buffer;
+			buf_cnt = run_end - run_address;
+			LOG_DEBUG("writing %d sections at 0x%8.8" PRIx32 "..0x%8.8" PRIx32
+					" as one run", i - first, run_address, run_end);
 		}
+		if (retval != ERROR_OK)
+			break;
 
 		uint32_t offset = 0;
 		uint32_t length = buf_cnt;
 
-		/* DANGER!!! beware of unsigned comparision here!!! */
-
-		if ((image.sections[i].base_address + buf_cnt >= min_address) &&
-				(image.sections[i].base_address < max_address)) {
+		if ((run_address + buf_cnt >= min_address) &&
+				(run_address < max_address)) {
 
-			if (image.sections[i].base_address < min_address) {
+			if (run_address < min_address) {
 				/* clip addresses below */
-				offset += min_address-image.sections[i].base_address;
+				offset += min_address - run_address;
 				length -= offset;
 			}
 
-			if (image.sections[i].base_address + buf_cnt > max_address)
-				length -= (image.sections[i].base_address + buf_cnt)-max_address;
+			if (run_address + buf_cnt > max_address)
+				length -= (run_address + buf_cnt) - max_address;
 
 			retval = target_write_buffer(target,
-					image.sections[i].base_address + offset, length, buffer + offset);
+					run_address + offset, length, image_data + offset);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
@@ -3201,12 +3792,14 @@ COMMAND_HANDLER(handle_load_image_command)
 			image_size += length;
 			command_print(CMD_CTX, "%u bytes written at address 0x%8.8" PRIx32 "",
 					(unsigned int)length,
-					image.sections[i].base_address + offset);
+					run_address + offset);
 		}
 
 		free(buffer);
 	}
 
+	free(sections);
+
 	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK)) {
 		command_print(CMD_CTX, "downloaded %" PRIu32 " bytes "
 				"in %fs (%0.3f KiB/s)", image_size,
@@ -3219,6 +3812,9 @@ COMMAND_HANDLER(handle_load_image_command)
 
 }
 
+/* bytes dump_image reads per target_read_buffer() call */
+#define DUMP_IMAGE_CHUNK	(64 * 1024)
+
 COMMAND_HANDLER(handle_dump_image_command)
 {
 	struct fileio *fileio;
@@ -3234,7 +3830,10 @@ COMMAND_HANDLER(handle_dump_image_command)
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], address);
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], size);
 
-	uint32_t buf_size = (size > 4096) ? 4096 : size;
+	/* large chunks amortize the queue flush of each read; the file
+	 * writes land in the OS page cache, whose write back overlaps the
+	 * next read on its own */
+	uint32_t buf_size = (size > DUMP_IMAGE_CHUNK) ? DUMP_IMAGE_CHUNK : size;
 	buffer = malloc(buf_size);
 	if (!buffer)
 		return ERROR_FAIL;
@@ -3257,6 +3856,11 @@ COMMAND_HANDLER(handle_dump_image_command)
 		retval = fileio_write(fileio, this_run_size, buffer, &size_written);
 		if (retval != ERROR_OK)
 			break;
+		if (size_written != this_run_size) {
+			LOG_ERROR("short write to %s", CMD_ARGV[0]);
+			retval = ERROR_FILEIO_OPERATION_FAILED;
+			break;
+		}
 
 		size -= this_run_size;
 		address += this_run_size;
@@ -3267,11 +3871,10 @@ COMMAND_HANDLER(handle_dump_image_command)
 	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK)) {
 		size_t filesize;
 		retval = fileio_size(fileio, &filesize);
-		if (retval != ERROR_OK)
-			return retval;
-		command_print(CMD_CTX,
-				"dumped %zu bytes in %fs (%0.3f KiB/s)", filesize,
-				duration_elapsed(&bench), duration_kbps(&bench, filesize));
+		if (retval == ERROR_OK)
+			command_print(CMD_CTX,
+					"dumped %zu bytes in %fs (%0.3f KiB/s)", filesize,
+					duration_elapsed(&bench), duration_kbps(&bench, filesize));
 	}
 
 	retvaltemp = fileio_close(fileio);
@@ -3284,6 +3887,7 @@ COMMAND_HANDLER(handle_dump_image_command)
 static COMMAND_HELPER(handle_verify_image_command_internal, int verify)
 {
 	uint8_t *buffer;
+	const uint8_t *image_data;
 	size_t buf_cnt;
 	uint32_t image_size;
 	int i;
@@ -3326,22 +3930,14 @@ static COMMAND_HELPER(handle_verify_image_command_internal, int verify)
 	int diffs = 0;
 	retval = ERROR_OK;
 	for (i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (buffer == NULL) {
-			command_print(CMD_CTX,
-					"error allocating buffer for section (%d bytes)",
-					(int)(image.sections[i].size));
-			break;
-		}
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
+		retval = image_get_section(CMD_CTX, &image, i, &image_data,
+				&buffer, &buf_cnt);
+		if (retval != ERROR_OK)
 			break;
-		}
 
 		if (verify) {
 			/* calculate checksum of image */
-			retval = image_calculate_checksum(buffer, buf_cnt, &checksum);
+			retval = image_calculate_checksum(image_data, buf_cnt, &checksum);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
@@ -3373,13 +3969,13 @@ static COMMAND_HELPER(handle_verify_image_command_internal, int verify)
 				if (retval == ERROR_OK) {
 					uint32_t t;
 					for (t = 0; t < buf_cnt; t++) {
-						if (data[t] != buffer[t]) {
+						if (data[t] != image_data[t]) {
 							command_print(CMD_CTX,
 										  "diff %d address 0x%08x. Was 0x%02x instead of 0x%02x",
 										  diffs,
 										  (unsigned)(t + image.sections[i].base_address),
 										  data[t],
-										  buffer[t]);
+										  image_data[t]);
 							if (diffs++ >= 127) {
 								command_print(CMD_CTX, "More than 128 errors, the rest are not printed.");
 								free(data);
@@ -3691,9 +4287,107 @@ static void writeString(FILE *f, char *s)
 
 typedef unsigned char UNIT[2];  /* unit of profiling */
 
+/* Samples are taken in chunks of at most one second, and added to a
+ * histogram, so profiling can run for any time in constant memory. */
+#define PROFILE_CHUNK_SAMPLES	10000
+/* With no address range given the histogram has a bucket per UNIT and
+ * grows to cover the samples, up to this many buckets (16 MiB) */
+#define PROFILE_MAX_BUCKETS		(4 * 1024 * 1024)
+/* FIXME: What is the reasonable number of buckets?
+ * The profiling result will be more accurate if there are enough buckets. */
+#define PROFILE_GMON_BUCKETS	(128 * 1024)
+
+struct profile_hist {
+	/* covers [min, max), fixed if given by the user */
+	bool with_range;
+	uint32_t min;
+	uint32_t max;
+	uint32_t num_buckets;
+	uint32_t *buckets;
+	uint64_t num_samples;
+	uint64_t dropped;
+};
+
+static void profile_hist_init(struct profile_hist *hist, bool with_range,
+		uint32_t start_address, uint32_t end_address)
+{
+	memset(hist, 0, sizeof(*hist));
+	hist->with_range = with_range;
+	if (with_range) {
+		hist->min = start_address;
+		hist->max = end_address;
+	}
+}
+
+/* Extend the histogram to cover @a address, one bucket per UNIT */
+static int profile_hist_grow(struct profile_hist *hist, uint32_t address)
+{
+	uint32_t unit = address & ~(uint32_t)(sizeof(UNIT) - 1);
+	uint32_t min = hist->num_buckets ? MIN(hist->min, unit) : unit;
+	uint32_t max = hist->num_buckets ? MAX(hist->max, unit + sizeof(UNIT)) : unit + sizeof(UNIT);
+	uint32_t num_buckets = (max - min) / sizeof(UNIT);
+
+	if (num_buckets > PROFILE_MAX_BUCKETS)
+		return ERROR_FAIL;
+
+	uint32_t *buckets = realloc(hist->buckets, num_buckets * sizeof(uint32_t));
+	if (buckets == NULL)
+		return ERROR_FAIL;
+
+	uint32_t shift = hist->num_buckets ? (hist->min - min) / sizeof(UNIT) : 0;
+	memmove(buckets + shift, buckets, hist->num_buckets * sizeof(uint32_t));
+	memset(buckets, 0, shift * sizeof(uint32_t));
+	memset(buckets + shift + hist->num_buckets, 0,
+			(num_buckets - shift - hist->num_buckets) * sizeof(uint32_t));
+
+	hist->min = min;
+	hist->max = max;
+	hist->num_buckets = num_buckets;
+	hist->buckets = buckets;
+	return ERROR_OK;
+}
+
+static void profile_hist_add(struct profile_hist *hist, const uint32_t *samples,
+		uint32_t num_samples)
+{
+	if (hist->with_range && hist->buckets == NULL) {
+		uint32_t num_buckets = (hist->max - hist->min) / sizeof(UNIT);
+		if (num_buckets > PROFILE_GMON_BUCKETS)
+			num_buckets = PROFILE_GMON_BUCKETS;
+		hist->buckets = calloc(num_buckets, sizeof(uint32_t));
+		if (hist->buckets == NULL) {
+			hist->dropped += num_samples;
+			return;
+		}
+		hist->num_buckets = num_buckets;
+	}
+
+	for (uint32_t i = 0; i < num_samples; i++) {
+		uint32_t address = samples[i];
+
+		if (hist->num_buckets == 0 || address < hist->min || hist->max <= address) {
+			if (hist->with_range || profile_hist_grow(hist, address) != ERROR_OK) {
+				hist->dropped++;
+				continue;
+			}
+		}
+
+		uint64_t a = address - hist->min;
+		uint64_t index = (a * hist->num_buckets) / (hist->max - hist->min);
+		hist->buckets[index]++;
+		hist->num_samples++;
+	}
+}
+
+static void profile_hist_free(struct profile_hist *hist)
+{
+	free(hist->buckets);
+	hist->buckets = NULL;
+	hist->num_buckets = 0;
+}
+
 /* Dump a gmon.out histogram file. */
-static void write_gmon(uint32_t *samples, uint32_t sampleNum, const char *filename, bool with_range,
-			uint32_t start_address, uint32_t end_address, struct target *target)
+static void write_gmon(struct profile_hist *hist, const char *filename, struct target *target)
 {
 	uint32_t i;
 	FILE *f = fopen(filename, "w");
@@ -3708,58 +4402,26 @@ static void write_gmon(uint32_t *samples, uint32_t sampleNum, const char *filena
 	uint8_t zero = 0;  /* GMON_TAG_TIME_HIST */
 	writeData(f, &zero, 1);
 
-	/* figure out bucket size */
-	uint32_t min;
-	uint32_t max;
-	if (with_range) {
-		min = start_address;
-		max = end_address;
-	} else {
-		min = samples[0];
-		max = samples[0];
-		for (i = 0; i < sampleNum; i++) {
-			if (min > samples[i])
-				min = samples[i];
-			if (max < samples[i])
-				max = samples[i];
-		}
-
-		/* max should be (largest sample + 1)
-		 * Refer to binutils/gprof/hist.c (find_histogram_for_pc) */
-		max++;
-	}
-
-	int addressSpace = max - min;
-	assert(addressSpace >= 2);
-
-	/* FIXME: What is the reasonable number of buckets?
-	 * The profiling result will be more accurate if there are enough buckets. */
-	static const uint32_t maxBuckets = 128 * 1024; /* maximum buckets. */
-	uint32_t numBuckets = addressSpace / sizeof(UNIT);
-	if (numBuckets > maxBuckets)
-		numBuckets = maxBuckets;
-	int *buckets = malloc(sizeof(int) * numBuckets);
+	/* fold the histogram into the buckets of the file, it has at most
+	 * PROFILE_GMON_BUCKETS */
+	uint32_t numBuckets = hist->num_buckets;
+	if (numBuckets > PROFILE_GMON_BUCKETS)
+		numBuckets = PROFILE_GMON_BUCKETS;
+	uint64_t *buckets = calloc(MAX(numBuckets, 1), sizeof(uint64_t));
 	if (buckets == NULL) {
 		fclose(f);
 		return;
 	}
-	memset(buckets, 0, sizeof(int) * numBuckets);
-	for (i = 0; i < sampleNum; i++) {
-		uint32_t address = samples[i];
-
-		if ((address < min) || (max <= address))
-			continue;
-
-		long long a = address - min;
-		long long b = numBuckets;
-		long long c = addressSpace;
-		int index_t = (a * b) / c; /* danger!!!! int32 overflows */
-		buckets[index_t]++;
+	uint64_t peak = 0;
+	for (i = 0; i < hist->num_buckets; i++) {
+		uint32_t index = ((uint64_t)i * numBuckets) / hist->num_buckets;
+		buckets[index] += hist->buckets[i];
+		peak = MAX(peak, buckets[index]);
 	}
 
 	/* append binary memory gmon.out &profile_hist_hdr ((char*)&profile_hist_hdr + sizeof(struct gmon_hist_hdr)) */
-	writeLong(f, min, target);			/* low_pc */
-	writeLong(f, max, target);			/* high_pc */
+	writeLong(f, hist->min, target);		/* low_pc */
+	writeLong(f, hist->max, target);		/* high_pc */
 	writeLong(f, numBuckets, target);	/* # of buckets */
 	writeLong(f, 100, target);			/* KLUDGE! We lie, ca. 100Hz best case. */
 	writeString(f, "seconds");
@@ -3769,94 +4431,168 @@ static void write_gmon(uint32_t *samples, uint32_t sampleNum, const char *filena
 
 	/*append binary memory gmon.out profile_hist_data (profile_hist_data + profile_hist_hdr.hist_size) */
 
-	char *data = malloc(2 * numBuckets);
+	char *data = malloc(2 * MAX(numBuckets, 1));
 	if (data != NULL) {
 		for (i = 0; i < numBuckets; i++) {
-			int val;
-			val = buckets[i];
-			if (val > 65535)
-				val = 65535;
+			/* counts are 16 bits, scale long runs down rather than
+			 * clipping the hot spots */
+			uint64_t val = buckets[i];
+			if (peak > 65535)
+				val = (val * 65535) / peak;
 			data[i * 2] = val&0xff;
 			data[i * 2 + 1] = (val >> 8) & 0xff;
 		}
-		free(buckets);
 		writeData(f, data, numBuckets * 2);
 		free(data);
-	} else
-		free(buckets);
+	}
+	free(buckets);
 
 	fclose(f);
 }
 
+/* Dump the histogram as text, one "address,samples" line per bucket
+ * that was hit. */
+static void write_profile_csv(struct profile_hist *hist, const char *filename)
+{
+	FILE *f = fopen(filename, "w");
+	if (f == NULL)
+		return;
+
+	fprintf(f, "address,samples\n");
+	for (uint32_t i = 0; i < hist->num_buckets; i++) {
+		if (hist->buckets[i] == 0)
+			continue;
+		uint32_t address = hist->min +
+			((uint64_t)i * (hist->max - hist->min)) / hist->num_buckets;
+		fprintf(f, "0x%08" PRIx32 ",%" PRIu32 "\n", address, hist->buckets[i]);
+	}
+
+	fclose(f);
+}
+
+static void write_profile(struct profile_hist *hist, const char *filename,
+		struct target *target)
+{
+	size_t len = strlen(filename);
+
+	if (len > 4 && strcasecmp(filename + len - 4, ".csv") == 0)
+		write_profile_csv(hist, filename);
+	else
+		write_gmon(hist, filename, target);
+}
+
 /* profiling samples the CPU PC as quickly as OpenOCD is able,
  * which will be used as a random sampling of PC */
 COMMAND_HANDLER(handle_profile_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
+	uint32_t snapshot = 0;
+
+	if (CMD_ARGC >= 4 && strcmp(CMD_ARGV[CMD_ARGC - 2], "snapshot") == 0) {
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[CMD_ARGC - 1], snapshot);
+		CMD_ARGC -= 2;
+	}
 
 	if ((CMD_ARGC != 2) && (CMD_ARGC != 4))
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
-	const uint32_t MAX_PROFILE_SAMPLE_NUM = 10000;
 	uint32_t offset;
 	uint32_t num_of_samples;
 	int retval = ERROR_OK;
 
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], offset);
 
-	uint32_t *samples = malloc(sizeof(uint32_t) * MAX_PROFILE_SAMPLE_NUM);
+	uint32_t start_address = 0;
+	uint32_t end_address = 0;
+	bool with_range = false;
+	if (CMD_ARGC == 4) {
+		with_range = true;
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], start_address);
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3], end_address);
+		if (end_address <= start_address || end_address - start_address < sizeof(UNIT)) {
+			command_print(CMD_CTX, "empty address range");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+	}
+
+	uint32_t *samples = malloc(sizeof(uint32_t) * PROFILE_CHUNK_SAMPLES);
 	if (samples == NULL) {
 		LOG_ERROR("No memory to store samples.");
 		return ERROR_FAIL;
 	}
 
-	/**
-	 * Some cores let us sample the PC without the
-	 * annoying halt/resume step; for example, ARMv7 PCSR.
-	 * Provide a way to use that more efficient mechanism.
-	 */
-	retval = target_profiling(target, samples, MAX_PROFILE_SAMPLE_NUM,
-				&num_of_samples, offset);
+	struct profile_hist hist;
+	profile_hist_init(&hist, with_range, start_address, end_address);
+
+	LOG_INFO("Starting profiling for %" PRIu32 " seconds", offset);
+
+	int64_t now = timeval_ms();
+	int64_t timeout = now + (int64_t)offset * 1000;
+	int64_t next_snapshot = now + (int64_t)snapshot * 1000;
+	do {
+		/**
+		 * Some cores let us sample the PC without the
+		 * annoying halt/resume step; for example, ARMv7 PCSR.
+		 * Provide a way to use that more efficient mechanism.
+		 */
+		retval = target_profiling(target, samples, PROFILE_CHUNK_SAMPLES,
+					&num_of_samples, 1);
+		if (retval != ERROR_OK)
+			break;
+
+		assert(num_of_samples <= PROFILE_CHUNK_SAMPLES);
+		profile_hist_add(&hist, samples, num_of_samples);
+
+		now = timeval_ms();
+		if (snapshot && now >= next_snapshot && now < timeout) {
+			write_profile(&hist, CMD_ARGV[1], target);
+			next_snapshot = now + (int64_t)snapshot * 1000;
+		}
+
+		keep_alive();
+	} while (now < timeout);
+
+	free(samples);
+
+	LOG_INFO("Profiling completed. %" PRIu64 " samples.", hist.num_samples);
+	if (hist.dropped)
+		LOG_WARNING("%" PRIu64 " samples outside of the profiled address range",
+				hist.dropped);
+
 	if (retval != ERROR_OK) {
-		free(samples);
+		profile_hist_free(&hist);
 		return retval;
 	}
 
-	assert(num_of_samples <= MAX_PROFILE_SAMPLE_NUM);
-
 	retval = target_poll(target);
 	if (retval != ERROR_OK) {
-		free(samples);
+		profile_hist_free(&hist);
 		return retval;
 	}
 	if (target->state == TARGET_RUNNING) {
 		retval = target_halt(target);
 		if (retval != ERROR_OK) {
-			free(samples);
+			profile_hist_free(&hist);
 			return retval;
 		}
 	}
 
 	retval = target_poll(target);
 	if (retval != ERROR_OK) {
-		free(samples);
+		profile_hist_free(&hist);
 		return retval;
 	}
 
-	uint32_t start_address = 0;
-	uint32_t end_address = 0;
-	bool with_range = false;
-	if (CMD_ARGC == 4) {
-		with_range = true;
-		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], start_address);
-		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3], end_address);
+	if (hist.num_samples == 0) {
+		command_print(CMD_CTX, "No samples taken");
+		profile_hist_free(&hist);
+		return retval;
 	}
 
-	write_gmon(samples, num_of_samples, CMD_ARGV[1],
-		   with_range, start_address, end_address, target);
+	write_profile(&hist, CMD_ARGV[1], target);
 	command_print(CMD_CTX, "Wrote %s", CMD_ARGV[1]);
 
-	free(samples);
+	profile_hist_free(&hist);
 	return retval;
 }
 
@@ -4238,6 +4974,137 @@ static int target_array2mem(Jim_Interp *interp, struct target *target,
 	return e;
 }
 
+/* Parses the optional access width of read_memory_bin and write_memory_bin,
+ * 0 means any access size (target_read_buffer()/target_write_buffer()) */
+static int memory_bin_width(Jim_Interp *interp, Jim_Obj *obj, uint32_t address,
+		uint32_t length, uint32_t *width)
+{
+	long l;
+
+	*width = 0;
+	if (obj == NULL)
+		return JIM_OK;
+
+	if (Jim_GetLong(interp, obj, &l) != JIM_OK)
+		return JIM_ERR;
+	if (l != 8 && l != 16 && l != 32) {
+		Jim_SetResultString(interp, "Invalid width param, must be 8/16/32", -1);
+		return JIM_ERR;
+	}
+
+	*width = l / 8;
+	if ((address | length) & (*width - 1)) {
+		Jim_SetResultFormatted(interp, "address and length must be aligned "
+				"for %d byte accesses", (int)*width);
+		return JIM_ERR;
+	}
+
+	return JIM_OK;
+}
+
+/* Reads target memory into one binary string, no per element Jim objects */
+static int target_read_memory_bin(Jim_Interp *interp, struct target *target,
+		int argc, Jim_Obj *const *argv)
+{
+	jim_wide address, length;
+	uint32_t width;
+	int retval;
+
+	if (argc != 2 && argc != 3) {
+		Jim_WrongNumArgs(interp, 0, argv, "address length [width]");
+		return JIM_ERR;
+	}
+
+	if (Jim_GetWide(interp, argv[0], &address) != JIM_OK ||
+			Jim_GetWide(interp, argv[1], &length) != JIM_OK)
+		return JIM_ERR;
+	if (address < 0 || length < 0 || address + length > 0x100000000LL) {
+		Jim_SetResultString(interp, "read_memory_bin: address range outside 32 bits", -1);
+		return JIM_ERR;
+	}
+	if (memory_bin_width(interp, argc == 3 ? argv[2] : NULL, address, length, &width) != JIM_OK)
+		return JIM_ERR;
+
+	uint8_t *buffer = malloc(length ? length : 1);
+	if (buffer == NULL) {
+		Jim_SetResultString(interp, "read_memory_bin: out of memory", -1);
+		return JIM_ERR;
+	}
+
+	if (width)
+		retval = target_read_memory(target, address, width, length / width, buffer);
+	else
+		retval = target_read_buffer(target, address, length, buffer);
+	if (retval != ERROR_OK) {
+		free(buffer);
+		LOG_ERROR("read_memory_bin: read @ 0x%08" PRIx32 ", %" PRIu32 " bytes, failed",
+				(uint32_t)address, (uint32_t)length);
+		Jim_SetResultString(interp, "read_memory_bin: cannot read memory", -1);
+		return JIM_ERR;
+	}
+
+	Jim_SetResult(interp, Jim_NewStringObj(interp, (const char *)buffer, length));
+	free(buffer);
+
+	return JIM_OK;
+}
+
+/* Writes the bytes of a (binary) string to target memory */
+static int target_write_memory_bin(Jim_Interp *interp, struct target *target,
+		int argc, Jim_Obj *const *argv)
+{
+	jim_wide address;
+	uint32_t width;
+	const char *data;
+	int length, retval;
+
+	if (argc != 2 && argc != 3) {
+		Jim_WrongNumArgs(interp, 0, argv, "address data [width]");
+		return JIM_ERR;
+	}
+
+	if (Jim_GetWide(interp, argv[0], &address) != JIM_OK)
+		return JIM_ERR;
+	data = Jim_GetString(argv[1], &length);
+	if (address < 0 || address + length > 0x100000000LL) {
+		Jim_SetResultString(interp, "write_memory_bin: address range outside 32 bits", -1);
+		return JIM_ERR;
+	}
+	if (memory_bin_width(interp, argc == 3 ? argv[2] : NULL, address, length, &width) != JIM_OK)
+		return JIM_ERR;
+
+	if (width)
+		retval = target_write_memory(target, address, width, length / width,
+				(const uint8_t *)data);
+	else
+		retval = target_write_buffer(target, address, length, (const uint8_t *)data);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("write_memory_bin: write @ 0x%08" PRIx32 ", %d bytes, failed",
+				(uint32_t)address, length);
+		Jim_SetResultString(interp, "write_memory_bin: cannot write memory", -1);
+		return JIM_ERR;
+	}
+
+	Jim_SetEmptyResult(interp);
+	return JIM_OK;
+}
+
+static int jim_read_memory_bin(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
+{
+	struct command_context *context = current_command_context(interp);
+	struct target *target = get_current_target(context);
+
+	return target_read_memory_bin(interp, target, argc - 1, argv + 1);
+}
+
+static int jim_write_memory_bin(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
+{
+	struct command_context *context = current_command_context(interp);
+	struct target *target = get_current_target(context);
+
+	return target_write_memory_bin(interp, target, argc - 1, argv + 1);
+}
+
 /* FIX? should we propagate errors here rather than printing them
  * and continuing?
  */
@@ -4245,6 +5112,11 @@ void target_handle_event(struct target *target, enum target_event e)
 {
 	struct target_event_action *teap;
 
+	/* most events have no action, don't walk the list for them; the
+	 * body keeps its compiled script, Jim_EvalObj() reuses it */
+	if (!(target->event_action_mask & TARGET_EVENT_BIT(e)))
+		return;
+
 	for (teap = target->event_action; teap != NULL; teap = teap->next) {
 		if (teap->event == e) {
 			LOG_DEBUG("target: (%d) %s (%s) event: %d (%s) action: %s",
@@ -4267,13 +5139,7 @@ void target_handle_event(struct target *target, enum target_event e)
  */
 bool target_has_event_action(struct target *target, enum target_event event)
 {
-	struct target_event_action *teap;
-
-	for (teap = target->event_action; teap != NULL; teap = teap->next) {
-		if (teap->event == event)
-			return true;
-	}
-	return false;
+	return (target->event_action_mask & TARGET_EVENT_BIT(event)) != 0;
 }
 
 enum target_cfg_param {
@@ -4288,6 +5154,7 @@ enum target_cfg_param {
 	TCFG_CHAIN_POSITION,
 	TCFG_DBGBASE,
 	TCFG_RTOS,
+	TCFG_DEFER_EXAMINE,
 };
 
 static Jim_Nvp nvp_config_opts[] = {
@@ -4302,6 +5169,7 @@ static Jim_Nvp nvp_config_opts[] = {
 	{ .name = "-chain-position",   .value = TCFG_CHAIN_POSITION },
 	{ .name = "-dbgbase",          .value = TCFG_DBGBASE },
 	{ .name = "-rtos",             .value = TCFG_RTOS },
+	{ .name = "-defer-examine",    .value = TCFG_DEFER_EXAMINE },
 	{ .name = NULL, .value = -1 }
 };
 
@@ -4420,6 +5288,7 @@ no_params:
 						/* add to head of event list */
 						teap->next = target->event_action;
 						target->event_action = teap;
+						target->event_action_mask |= TARGET_EVENT_BIT(teap->event);
 					}
 					Jim_SetEmptyResult(goi->interp);
 				} else {
@@ -4576,6 +5445,16 @@ no_params:
 			}
 			/* loop for more */
 			break;
+
+		case TCFG_DEFER_EXAMINE:
+			/* a flag without a value */
+			if (goi->isconfigure)
+				target->defer_examine = true;
+			else if (goi->argc != 0)
+				goto no_params;
+			Jim_SetResult(goi->interp, Jim_NewIntObj(goi->interp, target->defer_examine));
+			/* loop for more */
+			break;
 		}
 	} /* while (goi->argc) */
 
@@ -4838,6 +5717,20 @@ static int jim_target_array2mem(Jim_Interp *interp,
 	return target_array2mem(interp, target, argc - 1, argv + 1);
 }
 
+static int jim_target_read_memory_bin(Jim_Interp *interp,
+		int argc, Jim_Obj *const *argv)
+{
+	struct target *target = Jim_CmdPrivData(interp);
+	return target_read_memory_bin(interp, target, argc - 1, argv + 1);
+}
+
+static int jim_target_write_memory_bin(Jim_Interp *interp,
+		int argc, Jim_Obj *const *argv)
+{
+	struct target *target = Jim_CmdPrivData(interp);
+	return target_write_memory_bin(interp, target, argc - 1, argv + 1);
+}
+
 static int jim_target_tap_disabled(Jim_Interp *interp)
 {
 	Jim_SetResultFormatted(interp, "[TAP is disabled]");
@@ -5017,6 +5910,17 @@ static int jim_target_event_list(Jim_Interp *interp, int argc, Jim_Obj *const *a
 	command_print(cmd_ctx, "***END***");
 	return JIM_OK;
 }
+static int jim_target_was_examined(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
+{
+	if (argc != 1) {
+		Jim_WrongNumArgs(interp, 1, argv, "[no parameters]");
+		return JIM_ERR;
+	}
+	struct target *target = Jim_CmdPrivData(interp);
+	Jim_SetResult(interp, Jim_NewIntObj(interp, target_was_examined(target)));
+	return JIM_OK;
+}
+
 static int jim_target_current_state(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 {
 	if (argc != 1) {
@@ -5120,6 +6024,20 @@ static const struct command_registration target_instance_command_handlers[] = {
 			"from target memory",
 		.usage = "arrayname bitwidth address count",
 	},
+	{
+		.name = "read_memory_bin",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_target_read_memory_bin,
+		.help = "Returns target memory as a binary string",
+		.usage = "address length [8|16|32]",
+	},
+	{
+		.name = "write_memory_bin",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_target_write_memory_bin,
+		.help = "Writes the bytes of a binary string to target memory",
+		.usage = "address data [8|16|32]",
+	},
 	{
 		.name = "eventlist",
 		.mode = COMMAND_EXEC,
@@ -5132,6 +6050,12 @@ static const struct command_registration target_instance_command_handlers[] = {
 		.jim_handler = jim_target_current_state,
 		.help = "displays the current state of this target",
 	},
+	{
+		.name = "was_examined",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_target_was_examined,
+		.help = "tells whether this target has been examined",
+	},
 	{
 		.name = "arp_examine",
 		.mode = COMMAND_EXEC,
@@ -5577,6 +6501,7 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 
 	image_size = 0x0;
 	retval = ERROR_OK;
+	free_fastload();
 	fastload_num = image.num_sections;
 	fastload = malloc(sizeof(struct FastLoad)*image.num_sections);
 	if (fastload == NULL) {
@@ -5655,10 +6580,59 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 	return retval;
 }
 
+/* smallest range fast_load checksums on its own before just writing it */
+#define FASTLOAD_BLOCK	4096
+
+/* does the target already hold data at address? */
+static bool fastload_range_clean(struct target *target, uint32_t address,
+		const uint8_t *data, uint32_t length)
+{
+	uint32_t crc, target_crc;
+
+	if (image_calculate_checksum(data, length, &crc) != ERROR_OK)
+		return false;
+	if (target_checksum_memory(target, address, length, &target_crc) != ERROR_OK)
+		return false;
+	return crc == target_crc;
+}
+
+/*
+ * Bring one range up to date, the caller knows it differs. Ranges are
+ * halved while only one half differs, which finds a few changed blocks
+ * with a couple of checksums per level; when both halves differ the
+ * changes are dense and the whole range is written.
+ */
+static int fastload_sync_range(struct target *target, uint32_t address,
+		const uint8_t *data, uint32_t length, uint32_t *written)
+{
+	while (length > FASTLOAD_BLOCK) {
+		uint32_t half = DIV_ROUND_UP(length / 2, FASTLOAD_BLOCK) * FASTLOAD_BLOCK;
+
+		if (fastload_range_clean(target, address, data, half)) {
+			address += half;
+			data += half;
+			length -= half;
+		} else if (fastload_range_clean(target, address + half, data + half, length - half)) {
+			length = half;
+		} else
+			break;
+	}
+
+	*written += length;
+	return target_write_buffer(target, address, length, data);
+}
+
 COMMAND_HANDLER(handle_fast_load_command)
 {
-	if (CMD_ARGC > 0)
+	bool full = false;
+
+	if (CMD_ARGC > 1)
 		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "full") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		full = true;
+	}
 	if (fastload == NULL) {
 		LOG_ERROR("No image in memory");
 		return ERROR_FAIL;
@@ -5666,20 +6640,40 @@ COMMAND_HANDLER(handle_fast_load_command)
 	int i;
 	int64_t ms = timeval_ms();
 	int size = 0;
+	uint32_t written = 0;
 	int retval = ERROR_OK;
+	struct target *target = get_current_target(CMD_CTX);
 	for (i = 0; i < fastload_num; i++) {
-		struct target *target = get_current_target(CMD_CTX);
+		if (fastload[i].length == 0)
+			continue;
+		/* sections the target already holds, as checked by its
+		 * resident checksum, are skipped */
+		if (!full && fastload_range_clean(target, fastload[i].address,
+					fastload[i].data, fastload[i].length)) {
+			command_print(CMD_CTX, "Unchanged 0x%08x, length 0x%08x",
+						  (unsigned int)(fastload[i].address),
+						  (unsigned int)(fastload[i].length));
+			size += fastload[i].length;
+			continue;
+		}
 		command_print(CMD_CTX, "Write to 0x%08x, length 0x%08x",
 					  (unsigned int)(fastload[i].address),
 					  (unsigned int)(fastload[i].length));
-		retval = target_write_buffer(target, fastload[i].address, fastload[i].length, fastload[i].data);
+		if (full) {
+			written += fastload[i].length;
+			retval = target_write_buffer(target, fastload[i].address,
+					fastload[i].length, fastload[i].data);
+		} else
+			retval = fastload_sync_range(target, fastload[i].address,
+					fastload[i].data, fastload[i].length, &written);
 		if (retval != ERROR_OK)
 			break;
 		size += fastload[i].length;
 	}
 	if (retval == ERROR_OK) {
 		int64_t after = timeval_ms();
-		command_print(CMD_CTX, "Loaded image %f kBytes/s", (float)(size/1024.0)/((float)(after-ms)/1000.0));
+		command_print(CMD_CTX, "Loaded image %f kBytes/s, %" PRIu32 " of %d bytes written",
+				(float)(size/1024.0)/((float)(after-ms)/1000.0), written, size);
 	}
 	return retval;
 }
@@ -5703,8 +6697,70 @@ static const struct command_registration target_command_handlers[] = {
 	COMMAND_REGISTRATION_DONE
 };
 
+COMMAND_HANDLER(handle_perf_timers_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	for (struct target_timer_callback *c = target_timer_callbacks; c; c = c->next) {
+		if (c->removed)
+			continue;
+
+		/* name what we know about: the target polling and callbacks
+		 * registered for a target */
+		const char *name = NULL;
+		if (c->callback == handle_target)
+			name = "target polling";
+		for (struct target *target = all_targets; !name && target; target = target->next) {
+			if (c->priv == target)
+				name = target_name(target);
+		}
+
+		command_print(CMD_CTX, "%p(%p)%s%s: every %d ms, %" PRIu32 " calls, "
+				"%" PRId64 " us total, %" PRId64 " us max",
+				c->callback, c->priv, name ? " " : "", name ? name : "",
+				c->time_ms, c->calls, c->run_us, c->max_us);
+
+		if (c->callback != handle_target)
+			continue;
+		for (struct target *target = all_targets; target; target = target->next) {
+			if (target->poll_count)
+				command_print(CMD_CTX, "  %s: %" PRIu32 " polls, %" PRId64 " ms total",
+						target_name(target), target->poll_count,
+						target->poll_time_ms);
+		}
+	}
+
+	return ERROR_OK;
+}
+
+static const struct command_registration target_perf_command_handlers[] = {
+	{
+		.name = "timers",
+		.handler = handle_perf_timers_command,
+		.mode = COMMAND_ANY,
+		.help = "Show how often each timer callback ran and the time "
+			"spent in it.",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
 int target_register_commands(struct command_context *cmd_ctx)
 {
+	int retval = mem_cache_register_commands(cmd_ctx);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = snapshot_register_commands(cmd_ctx);
+	if (retval != ERROR_OK)
+		return retval;
+
+	struct command *perf_cmd = command_find_in_context(cmd_ctx, "perf");
+	retval = register_commands(cmd_ctx, perf_cmd, target_perf_command_handlers);
+	if (retval != ERROR_OK)
+		return retval;
+
 	return register_commands(cmd_ctx, NULL, target_command_handlers);
 }
 
@@ -5949,15 +7005,16 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.name = "fast_load",
 		.handler = handle_fast_load_command,
 		.mode = COMMAND_EXEC,
-		.help = "loads active fast load image to current target "
-			"- mainly for profiling purposes",
-		.usage = "",
+		.help = "loads active fast load image to current target, "
+			"skipping blocks the target already holds unless 'full' "
+			"is given - mainly for profiling purposes",
+		.usage = "['full']",
 	},
 	{
 		.name = "profile",
 		.handler = handle_profile_command,
 		.mode = COMMAND_EXEC,
-		.usage = "seconds filename [start end]",
+		.usage = "seconds filename [start end] ['snapshot' seconds]",
 		.help = "profiling samples the CPU PC",
 	},
 	/** @todo don't register virt2phys() unless target supports it */
@@ -6139,6 +7196,22 @@ static const struct command_registration target_exec_command_handlers[] = {
 			"and write the 8/16/32 bit values",
 		.usage = "arrayname bitwidth address count",
 	},
+	{
+		.name = "read_memory_bin",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_read_memory_bin,
+		.help = "read target memory and return it as one binary string, "
+			"much faster than mem2array for large transfers",
+		.usage = "address length [8|16|32]",
+	},
+	{
+		.name = "write_memory_bin",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_write_memory_bin,
+		.help = "write the bytes of a binary string to target memory, "
+			"much faster than array2mem for large transfers",
+		.usage = "address data [8|16|32]",
+	},
 	{
 		.name = "reset_nag",
 		.handler = handle_target_reset_nag,
@@ -92,11 +92,21 @@ enum target_endianness {
 	TARGET_BIG_ENDIAN = 1, TARGET_LITTLE_ENDIAN = 2
 };
 
+/** One range checked by target_blank_check_memory_blocks(). */
+struct target_memory_check_block {
+	uint32_t address;
+	uint32_t size;
+	/** 1 if the range is erased, 0 if not; set by the check */
+	uint32_t result;
+};
+
 struct working_area {
 	uint32_t address;
 	uint32_t size;
 	bool free;
 	uint8_t *backup;
+	/** hash of the code loaded by target_alloc_working_area_code(), 0 if none */
+	uint64_t code_hash;
 	struct working_area **user;
 	struct working_area *next;
 };
@@ -138,6 +148,12 @@ struct target {
 	 */
 	bool examined;
 
+	/**
+	 * Set by "-defer-examine": the target is not examined by "init" or
+	 * reset, but the first time it is used, see target_examine_deferred().
+	 */
+	bool defer_examine;
+
 	/**
 	 * true if the  target is currently running a downloaded
 	 * "algorithm" instead of arbitrary user code. OpenOCD code
@@ -148,6 +164,7 @@ struct target {
 	bool running_alg;
 
 	struct target_event_action *event_action;
+	uint64_t event_action_mask;			/* bit per event with an action in the list */
 
 	int reset_halt;						/* attempt resetting the CPU into the halted mode? */
 	uint32_t working_area;				/* working area (initialised RAM). Evaluated
@@ -165,6 +182,7 @@ struct target {
 	enum target_state state;			/* the current backend-state (running, halted, ...) */
 	struct reg_cache *reg_cache;		/* the first register cache of the target (core regs) */
 	struct breakpoint *breakpoints;		/* list of breakpoints */
+	struct breakpoint **breakpoint_hash;	/* breakpoints by address, see breakpoints.c */
 	struct watchpoint *watchpoints;		/* list of watchpoints */
 	struct trace *trace_info;			/* generic trace information */
 	struct debug_msg_receiver *dbgmsg;	/* list of debug message receivers */
@@ -185,6 +203,10 @@ struct target {
 	bool rtos_auto_detect;				/* A flag that indicates that the RTOS has been specified as "auto"
 										 * and must be detected when symbols are offered */
 	struct backoff_timer backoff;
+	bool poll_queued;					/* status reads queued by poll_queue() */
+	uint32_t poll_count;				/* background polls issued */
+	uint32_t poll_batched;				/* ... of which were batched */
+	int64_t poll_time_ms;				/* time spent in background polls */
 	int smp;							/* add some target attributes for smp support */
 	struct target_list *head;
 	/* the gdb service is there in case of smp, we have only one gdb server
@@ -195,6 +217,11 @@ struct target {
 
 	/* file-I/O information for host to do syscall */
 	struct gdb_fileio_info *fileio_info;
+
+	/* optional host side cache of memory reads, see mem_cache.h */
+	struct mem_cache *mem_cache;
+	/* host side cache of MMU translations, see mmu_tlb.h */
+	struct mmu_tlb *mmu_tlb;
 };
 
 struct target_list {
@@ -268,6 +295,9 @@ enum target_event {
 	TARGET_EVENT_TRACE_CONFIG,
 };
 
+/* target_event values must fit target->event_action_mask */
+#define TARGET_EVENT_BIT(e)	(1ULL << (e))
+
 struct target_event_action {
 	enum target_event event;
 	struct Jim_Interp *interp;
@@ -301,7 +331,11 @@ struct target_timer_callback {
 	int time_ms;
 	int periodic;
 	bool removed;
-	struct timeval when;
+	int64_t when;		/* timeval_ms() when the callback is due */
+	unsigned int heap_index;	/* position in the due time heap */
+	uint32_t calls;		/* times the callback ran ... */
+	int64_t run_us;		/* ... the time spent in it ... */
+	int64_t max_us;		/* ... and its longest run, for "perf timers" */
 	void *priv;
 	struct target_timer_callback *next;
 };
@@ -349,6 +383,14 @@ int target_unregister_trace_callback(
  * yet it is possible to detect error conditions.
  */
 int target_poll(struct target *target);
+
+/**
+ * Samples the PC by halting and resuming the target as fast as possible;
+ * targets with a non-intrusive sampling mechanism fall back to this
+ * when it is not available.
+ */
+int target_profiling_default(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds);
 int target_resume(struct target *target, int current, uint32_t address,
 		int handle_breakpoints, int debug_execution);
 int target_halt(struct target *target);
@@ -369,6 +411,12 @@ int target_call_timer_callbacks(void);
  * a synchronous command completes.
  */
 int target_call_timer_callbacks_now(void);
+/**
+ * Returns the number of milliseconds until the earliest registered timer
+ * callback is due, 0 if one is already overdue, or -1 if there are none.
+ * Used by server_loop() to sleep until the next real deadline.
+ */
+int target_timer_next_due_ms(void);
 
 struct target *get_target_by_num(int num);
 struct target *get_current_target(struct command_context *cmd_ctx);
@@ -390,6 +438,12 @@ const char *target_type_name(struct target *target);
  */
 int target_examine_one(struct target *target);
 
+/**
+ * Examines a target configured with "-defer-examine" which has not been
+ * examined yet; does nothing for any other target.
+ */
+int target_examine_deferred(struct target *target);
+
 /** @returns @c true if target_set_examined() has been called. */
 static inline bool target_was_examined(struct target *target)
 {
@@ -576,10 +630,41 @@ int target_write_buffer(struct target *target,
 		uint32_t address, uint32_t size, const uint8_t *buffer);
 int target_read_buffer(struct target *target,
 		uint32_t address, uint32_t size, uint8_t *buffer);
+
+/**
+ * The default buffer accessors used when a target type does not provide
+ * its own: they split the buffer into naturally aligned target memory
+ * accesses of up to 32 bits. Target types may fall back to them.
+ */
+int target_write_buffer_default(struct target *target,
+		uint32_t address, uint32_t count, const uint8_t *buffer);
+int target_read_buffer_default(struct target *target,
+		uint32_t address, uint32_t count, uint8_t *buffer);
 int target_checksum_memory(struct target *target,
 		uint32_t address, uint32_t size, uint32_t *crc);
 int target_blank_check_memory(struct target *target,
 		uint32_t address, uint32_t size, uint32_t *blank);
+/**
+ * Fill @a count bytes at @a address with the 32-bit @a pattern, using code
+ * running on the target. @a address must be word aligned and @a count a
+ * multiple of 4.
+ *
+ * @returns ERROR_TARGET_RESOURCE_NOT_AVAILABLE if the target has no such
+ * routine or not enough working area, callers then write from the host.
+ */
+int target_fill_memory(struct target *target,
+		uint32_t address, uint32_t count, uint32_t pattern);
+/**
+ * Check several memory ranges for the erased value in one go.
+ *
+ * @returns the number of leading entries of @a blocks that were checked
+ * (at least one), or an error code. Callers loop until all entries are
+ * done; ERROR_TARGET_RESOURCE_NOT_AVAILABLE means the target has no
+ * such routine or not enough working area for it.
+ */
+int target_blank_check_memory_blocks(struct target *target,
+		struct target_memory_check_block *blocks, int num_blocks,
+		uint8_t erased_value);
 int target_wait_state(struct target *target, enum target_state state, int ms);
 
 /**
@@ -628,6 +713,19 @@ int target_alloc_working_area(struct target *target,
  */
 int target_alloc_working_area_try(struct target *target,
 		uint32_t size, struct working_area **area);
+/* Allocate a working area and load code into it, like
+ * target_alloc_working_area() followed by target_write_buffer().
+ *
+ * When freed, the area keeps the code: a later call with the same code
+ * gets the same area back without uploading it again. The code stays
+ * resident until the space is needed for another allocation or
+ * target_free_all_working_areas() is called on resume or reset; with
+ * backup_working_area, the original memory contents are restored then.
+ *
+ * The caller must not modify the area: it is matched by a hash of code.
+ */
+int target_alloc_working_area_code(struct target *target,
+		const uint8_t *code, uint32_t size, struct working_area **area);
 int target_free_working_area(struct target *target, struct working_area *area);
 void target_free_all_working_areas(struct target *target);
 uint32_t target_get_working_area_avail(struct target *target);
@@ -33,6 +33,8 @@
 #include "target_request.h"
 #include "target_type.h"
 #include "trace.h"
+#include "ringbuf_server.h"
+#include <server/server.h>
 
 static bool got_message;
 
@@ -113,6 +115,78 @@ static int target_hexmsg(struct target *target, int size, uint32_t length)
 	return ERROR_OK;
 }
 
+#define BINMSG_MAX_SUBSCRIBERS	8
+
+/* TCP service for TARGET_REQ_BINMSG payloads of one target */
+struct binmsg_channel {
+	struct target *target;
+	struct service *service;
+	uint64_t bytes;
+	uint64_t dropped;
+	struct binmsg_channel *next;
+};
+
+static struct binmsg_channel *binmsg_channels;
+
+static struct binmsg_channel *binmsg_find(struct target *target)
+{
+	for (struct binmsg_channel *ch = binmsg_channels; ch; ch = ch->next)
+		if (ch->target == target)
+			return ch;
+	return NULL;
+}
+
+static int target_binmsg(struct target *target, uint32_t length)
+{
+	struct binmsg_channel *ch = binmsg_find(target);
+	uint8_t *data = malloc(DIV_ROUND_UP(length, 4) * 4);
+	int retval;
+
+	if (!data)
+		return ERROR_FAIL;
+
+	/* always drain the payload, even if nobody listens */
+	retval = target->type->target_request_data(target, DIV_ROUND_UP(length, 4), data);
+	if (retval == ERROR_OK && ch && ch->service) {
+		ch->bytes += length;
+		for (struct connection *c = ch->service->connections; c; c = c->next) {
+			int written = connection_write(c, data, length);
+			if (written < 0)
+				written = 0;
+			ch->dropped += length - written;
+		}
+	}
+
+	free(data);
+	return retval;
+}
+
+static int binmsg_new_connection(struct connection *connection)
+{
+	struct binmsg_channel *ch = connection->service->priv;
+
+	ch->service = connection->service;
+	LOG_INFO("%s: new binary message subscriber", target_name(ch->target));
+	return ERROR_OK;
+}
+
+static int binmsg_input(struct connection *connection)
+{
+	uint8_t buf[64];
+
+	/* the channel is output only, anything clients send is discarded */
+	int bytes_read = connection_read(connection, buf, sizeof(buf));
+	if (bytes_read <= 0)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
+	return ERROR_OK;
+}
+
+static int binmsg_connection_closed(struct connection *connection)
+{
+	return ERROR_OK;
+}
+
 /* handle requests from the target received by a target specific
  * side-band channel (e.g. ARM7/9 DCC)
  */
@@ -143,6 +217,8 @@ int target_request(struct target *target, uint32_t request)
 		case TARGET_REQ_DEBUGCHAR:
 			target_charmsg(target, (request & 0x00ff0000) >> 16);
 			break;
+		case TARGET_REQ_BINMSG:
+			return target_binmsg(target, (request & 0xffff0000) >> 16);
 /*		case TARGET_REQ_SEMIHOSTING:
  *			break;
  */
@@ -288,6 +364,162 @@ COMMAND_HANDLER(handle_target_request_debugmsgs_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_target_request_binary_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct binmsg_channel *ch = binmsg_find(target);
+	int retval;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 0) {
+		if (ch)
+			command_print(CMD_CTX, "%" PRIu64 " bytes received, %" PRIu64 " dropped",
+					ch->bytes, ch->dropped);
+		else
+			command_print(CMD_CTX, "binary messages are not served");
+		return ERROR_OK;
+	}
+
+	if (target->type->target_request_data == NULL) {
+		LOG_ERROR("Target %s does not support target requests", target_name(target));
+		return ERROR_FAIL;
+	}
+
+	if (ch) {
+		LOG_ERROR("%s: binary messages are already served", target_name(target));
+		return ERROR_FAIL;
+	}
+
+	ch = calloc(1, sizeof(*ch));
+	if (!ch)
+		return ERROR_FAIL;
+	ch->target = target;
+
+	retval = add_service("binmsg", CMD_ARGV[0], BINMSG_MAX_SUBSCRIBERS,
+			binmsg_new_connection, binmsg_input, binmsg_connection_closed, ch);
+	if (retval != ERROR_OK) {
+		free(ch);
+		return retval;
+	}
+
+	ch->next = binmsg_channels;
+	binmsg_channels = ch;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_target_request_ringbuf_setup_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	uint32_t address, size;
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size);
+
+	return ringbuf_setup(target, address, size,
+			CMD_ARGC == 3 ? CMD_ARGV[2] : RINGBUF_DEFAULT_ID);
+}
+
+COMMAND_HANDLER(handle_target_request_ringbuf_start_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	unsigned int period_ms = 10;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], period_ms);
+
+	return ringbuf_start(target, period_ms);
+}
+
+COMMAND_HANDLER(handle_target_request_ringbuf_stop_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return ringbuf_stop(get_current_target(CMD_CTX));
+}
+
+COMMAND_HANDLER(handle_target_request_ringbuf_server_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return ringbuf_server_add(get_current_target(CMD_CTX), CMD_ARGV[0]);
+}
+
+COMMAND_HANDLER(handle_target_request_ringbuf_log_command)
+{
+	bool enable;
+
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ON_OFF(CMD_ARGV[0], enable);
+	return ringbuf_set_log(get_current_target(CMD_CTX), enable);
+}
+
+COMMAND_HANDLER(handle_target_request_ringbuf_status_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	ringbuf_report(CMD_CTX, get_current_target(CMD_CTX));
+	return ERROR_OK;
+}
+
+static const struct command_registration target_req_ringbuf_command_handlers[] = {
+	{
+		.name = "setup",
+		.handler = handle_target_request_ringbuf_setup_command,
+		.mode = COMMAND_EXEC,
+		.help = "search target memory for a ring buffer control block",
+		.usage = "address size [id]",
+	},
+	{
+		.name = "start",
+		.handler = handle_target_request_ringbuf_start_command,
+		.mode = COMMAND_EXEC,
+		.help = "start draining the ring buffer while the target runs",
+		.usage = "[period_ms]",
+	},
+	{
+		.name = "stop",
+		.handler = handle_target_request_ringbuf_stop_command,
+		.mode = COMMAND_EXEC,
+		.help = "stop draining the ring buffer",
+		.usage = "",
+	},
+	{
+		.name = "server",
+		.handler = handle_target_request_ringbuf_server_command,
+		.mode = COMMAND_EXEC,
+		.help = "serve the ring buffer contents on a TCP port",
+		.usage = "tcp_port",
+	},
+	{
+		.name = "log",
+		.handler = handle_target_request_ringbuf_log_command,
+		.mode = COMMAND_EXEC,
+		.help = "forward the ring buffer contents to the log",
+		.usage = "('on'|'off')",
+	},
+	{
+		.name = "status",
+		.handler = handle_target_request_ringbuf_status_command,
+		.mode = COMMAND_EXEC,
+		.help = "show the ring buffer location and statistics",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
 static const struct command_registration target_req_exec_command_handlers[] = {
 	{
 		.name = "debugmsgs",
@@ -296,6 +528,21 @@ static const struct command_registration target_req_exec_command_handlers[] = {
 		.help = "display and/or modify reception of debug messages from target",
 		.usage = "['enable'|'charmsg'|'disable']",
 	},
+	{
+		.name = "binary",
+		.handler = handle_target_request_binary_command,
+		.mode = COMMAND_EXEC,
+		.help = "serve binary debug messages from target on a TCP port, "
+			"or show their statistics",
+		.usage = "[tcp_port]",
+	},
+	{
+		.name = "ringbuf",
+		.mode = COMMAND_ANY,
+		.help = "console output through a ring buffer in target RAM",
+		.usage = "",
+		.chain = target_req_ringbuf_command_handlers,
+	},
 	COMMAND_REGISTRATION_DONE
 };
 static const struct command_registration target_req_command_handlers[] = {
@@ -33,8 +33,13 @@ typedef enum target_req_cmd {
 	TARGET_REQ_DEBUGMSG,
 	TARGET_REQ_DEBUGCHAR,
 /*	TARGET_REQ_SEMIHOSTING, */
+	TARGET_REQ_BINMSG = 4,
 } target_req_cmd_t;
 
+/* most DCC words a target specific poll drains before returning to the
+ * server loop, so a chatty target can't starve gdb and telnet */
+#define TARGET_REQ_BURST_WORDS	256
+
 struct debug_msg_receiver {
 	struct command_context *cmd_ctx;
 	struct debug_msg_receiver *next;
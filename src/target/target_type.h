@@ -44,6 +44,10 @@ struct target_type {
 
 	/* poll current target status */
 	int (*poll)(struct target *target);
+	/* Optional: queue the status reads poll() needs without flushing
+	 * them, so background polling can fetch all targets in one batch.
+	 * poll() is then invoked with target->poll_queued set. */
+	int (*poll_queue)(struct target *target);
 	/* Invoked only from target_arch_state().
 	 * Issue USER() w/architecture specific status.  */
 	int (*arch_state)(struct target *target);
@@ -132,6 +136,13 @@ struct target_type {
 			uint32_t count, uint32_t *checksum);
 	int (*blank_check_memory)(struct target *target, uint32_t address,
 			uint32_t count, uint32_t *blank);
+	/** Optional; see target_fill_memory(). */
+	int (*fill_memory)(struct target *target, uint32_t address,
+			uint32_t count, uint32_t pattern);
+	/** Optional; see target_blank_check_memory_blocks(). */
+	int (*blank_check_memory_blocks)(struct target *target,
+			struct target_memory_check_block *blocks, int num_blocks,
+			uint8_t erased_value);
 
 	/*
 	 * target break-/watchpoint control
@@ -334,8 +334,11 @@ static int read_mem(struct target *t, uint32_t size,
 
 	/* if CS.D bit=1 then its a 32 bit code segment, else 16 */
 	bool use32 = (buf_get_u32(x86_32->cache->reg_list[CSAR].value, 0, 32)) & CSAR_D;
+	/* queue the address and the instruction, the EDX read flushes them */
+	x86_32->flush = 0;
 	int retval = x86_32->write_hw_reg(t, EAX, addr, 0);
 	if (retval != ERROR_OK) {
+		x86_32->flush = 1;
 		LOG_ERROR("%s error write EAX", __func__);
 		return retval;
 	}
@@ -363,6 +366,7 @@ static int read_mem(struct target *t, uint32_t size,
 			LOG_ERROR("%s invalid read mem size", __func__);
 			break;
 	}
+	x86_32->flush = 1;
 
 	/* read_hw_reg() will write to 4 bytes (uint32_t)
 	 * Watch out, the buffer passed into read_mem() might be 1 or 2 bytes.
@@ -399,8 +403,11 @@ static int write_mem(struct target *t, uint32_t size,
 	}
 	/* if CS.D bit=1 then its a 32 bit code segment, else 16 */
 	bool use32 = (buf_get_u32(x86_32->cache->reg_list[CSAR].value, 0, 32)) & CSAR_D;
+	/* queue address, data and instruction, the status check flushes them */
+	x86_32->flush = 0;
 	retval = x86_32->write_hw_reg(t, EAX, addr, 0);
 	if (retval != ERROR_OK) {
+		x86_32->flush = 1;
 		LOG_ERROR("%s error write EAX", __func__);
 		return retval;
 	}
@@ -410,6 +417,7 @@ static int write_mem(struct target *t, uint32_t size,
 	 */
 	retval = x86_32->write_hw_reg(t, EDX, buf4bytes, 0);
 	if (retval != ERROR_OK) {
+		x86_32->flush = 1;
 		LOG_ERROR("%s error write EDX", __func__);
 		return retval;
 	}
@@ -433,9 +441,15 @@ static int write_mem(struct target *t, uint32_t size,
 				retval = x86_32->submit_instruction(t, MEMWRW16);
 			break;
 		default:
+			x86_32->flush = 1;
 			LOG_ERROR("%s invalid write mem size", __func__);
 			return ERROR_FAIL;
 	}
+	x86_32->flush = 1;
+	if (retval != ERROR_OK) {
+		LOG_ERROR("%s error submitting instruction", __func__);
+		return retval;
+	}
 	retval = x86_32->transaction_status(t);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("%s error on mem write", __func__);
@@ -236,6 +236,9 @@ static void xscale_getbuf(jtag_callback_data_t arg)
 	*((uint32_t *)arg) = buf_get_u32(in, 0, 32);
 }
 
+/* words scanned out of TX per JTAG queue flush */
+#define XSCALE_RECEIVE_BATCH	1024
+
 static int xscale_receive(struct target *target, uint32_t *buffer, int num_words)
 {
 	if (num_words == 0)
@@ -249,6 +252,7 @@ static int xscale_receive(struct target *target, uint32_t *buffer, int num_words
 	uint8_t field0_check_value = 0x2;
 	uint8_t field0_check_mask = 0x6;
 	uint32_t *field1 = malloc(num_words * 4);
+	int batch;
 	uint8_t field2_check_value = 0x0;
 	uint8_t field2_check_mask = 0x1;
 	int words_done = 0;
@@ -284,9 +288,11 @@ static int xscale_receive(struct target *target, uint32_t *buffer, int num_words
 	/* repeat until all words have been collected */
 	int attempts = 0;
 	while (words_done < num_words) {
-		/* schedule reads */
+		/* schedule reads, a bounded batch at a time so that words which
+		 * weren't ready don't cause the whole remainder to be rescanned */
+		batch = MIN(num_words - words_done, XSCALE_RECEIVE_BATCH);
 		words_scheduled = 0;
-		for (i = words_done; i < num_words; i++) {
+		for (i = words_done; i < words_done + batch; i++) {
 			fields[0].in_value = &field0[i];
 
 			jtag_add_pathmove(3, path);
@@ -306,16 +312,12 @@ static int xscale_receive(struct target *target, uint32_t *buffer, int num_words
 			break;
 		}
 
-		/* examine results */
-		for (i = words_done; i < num_words; i++) {
-			if (!(field0[i] & 1)) {
-				/* move backwards if necessary */
-				int j;
-				for (j = i; j < num_words - 1; j++) {
-					field0[j] = field0[j + 1];
-					field1[j] = field1[j + 1];
-				}
-				words_scheduled--;
+		/* examine results, packing the valid words towards the start */
+		words_scheduled = 0;
+		for (i = words_done; i < words_done + batch; i++) {
+			if (field0[i] & 1) {
+				field1[words_done + words_scheduled] = field1[i];
+				words_scheduled++;
 			}
 		}
 		if (words_scheduled == 0) {
@@ -334,6 +336,7 @@ static int xscale_receive(struct target *target, uint32_t *buffer, int num_words
 		*(buffer++) = buf_get_u32((uint8_t *)&field1[i], 0, 32);
 
 	free(field1);
+	free(field0);
 
 	return retval;
 }
@@ -344,7 +347,7 @@ static int xscale_read_tx(struct target *target, int consume)
 	tap_state_t path[3];
 	tap_state_t noconsume_path[6];
 	int retval;
-	struct timeval timeout, now;
+	int64_t timeout;
 	struct scan_field fields[3];
 	uint8_t field0_in = 0x0;
 	uint8_t field0_check_value = 0x2;
@@ -379,8 +382,7 @@ static int xscale_read_tx(struct target *target, int consume)
 	uint8_t tmp;
 	fields[2].in_value = &tmp;
 
-	gettimeofday(&timeout, NULL);
-	timeval_add_time(&timeout, 1, 0);
+	timeout = timeval_ms() + 1000;
 
 	for (;; ) {
 		/* if we want to consume the register content (i.e. clear TX_READY),
@@ -403,9 +405,7 @@ static int xscale_read_tx(struct target *target, int consume)
 			return ERROR_TARGET_TIMEOUT;
 		}
 
-		gettimeofday(&now, NULL);
-		if ((now.tv_sec > timeout.tv_sec) ||
-			((now.tv_sec == timeout.tv_sec) && (now.tv_usec > timeout.tv_usec))) {
+		if (timeval_ms() > timeout) {
 			LOG_ERROR("time out reading TX register");
 			return ERROR_TARGET_TIMEOUT;
 		}
@@ -429,7 +429,7 @@ static int xscale_write_rx(struct target *target)
 {
 	struct xscale_common *xscale = target_to_xscale(target);
 	int retval;
-	struct timeval timeout, now;
+	int64_t timeout;
 	struct scan_field fields[3];
 	uint8_t field0_out = 0x0;
 	uint8_t field0_in = 0x0;
@@ -457,8 +457,7 @@ static int xscale_write_rx(struct target *target)
 	uint8_t tmp;
 	fields[2].in_value = &tmp;
 
-	gettimeofday(&timeout, NULL);
-	timeval_add_time(&timeout, 1, 0);
+	timeout = timeval_ms() + 1000;
 
 	/* poll until rx_read is low */
 	LOG_DEBUG("polling RX");
@@ -474,9 +473,7 @@ static int xscale_write_rx(struct target *target)
 			return retval;
 		}
 
-		gettimeofday(&now, NULL);
-		if ((now.tv_sec > timeout.tv_sec) ||
-			((now.tv_sec == timeout.tv_sec) && (now.tv_usec > timeout.tv_usec))) {
+		if (timeval_ms() > timeout) {
 			LOG_ERROR("time out writing RX register");
 			return ERROR_TARGET_TIMEOUT;
 		}
@@ -1548,10 +1545,18 @@ static int xscale_deassert_reset(struct target *target)
 		 * it's using halt mode (not monitor mode), it runs in
 		 * "Special Debug State" for access to registers, memory,
 		 * coprocessors, trace data, etc.
+		 *
+		 * A processor reset leaves the mini-icache alone, so if the
+		 * user allows it and there was no TAP reset since the last
+		 * load, the handler is still in place.
 		 */
 		address = xscale->handler_address;
-		for (unsigned binary_size = sizeof xscale_debug_handler;
-			binary_size > 0;
+		unsigned binary_size = sizeof xscale_debug_handler;
+		if (xscale->handler_cache && xscale->handler_installed) {
+			LOG_DEBUG("debug handler still loaded, skipping upload");
+			binary_size = 0;
+		}
+		for (; binary_size > 0;
 			binary_size -= buf_cnt, buffer += buf_cnt) {
 			uint32_t cache_line[8];
 			unsigned i;
@@ -1578,6 +1583,7 @@ static int xscale_deassert_reset(struct target *target)
 
 			address += buf_cnt;
 		}
+		xscale->handler_installed = 1;
 
 		retval = xscale_load_ic(target, 0x0,
 				xscale->low_vectors);
@@ -2888,7 +2894,6 @@ static void xscale_build_reg_cache(struct target *target)
 
 	for (i = 0; i < num_regs; i++) {
 		(*cache_p)->reg_list[i].name = xscale_reg_list[i];
-		(*cache_p)->reg_list[i].value = calloc(4, 1);
 		(*cache_p)->reg_list[i].dirty = 0;
 		(*cache_p)->reg_list[i].valid = 0;
 		(*cache_p)->reg_list[i].size = 32;
@@ -2897,6 +2902,7 @@ static void xscale_build_reg_cache(struct target *target)
 		arch_info[i] = xscale_reg_arch_info[i];
 		arch_info[i].target = target;
 	}
+	register_cache_alloc_values(*cache_p);
 
 	xscale->reg_cache = (*cache_p);
 }
@@ -2908,6 +2914,17 @@ static int xscale_init_target(struct command_context *cmd_ctx,
 	return ERROR_OK;
 }
 
+static int xscale_jtag_callback(enum jtag_event event, void *priv)
+{
+	struct xscale_common *xscale = priv;
+
+	/* a TAP reset invalidates the mini-icache */
+	if (event == JTAG_TRST_ASSERTED)
+		xscale->handler_installed = 0;
+
+	return ERROR_OK;
+}
+
 static int xscale_init_arch_info(struct target *target,
 	struct xscale_common *xscale, struct jtag_tap *tap)
 {
@@ -2928,6 +2945,9 @@ static int xscale_init_arch_info(struct target *target,
 
 	/* the debug handler isn't installed (and thus not running) at this time */
 	xscale->handler_address = 0xfe000800;
+	xscale->handler_installed = 0;
+	xscale->handler_cache = 0;
+	jtag_register_event_callback(xscale_jtag_callback, xscale);
 
 	/* clear the vectors we keep locally for reference */
 	memset(xscale->low_vectors, 0, sizeof(xscale->low_vectors));
@@ -3038,9 +3058,11 @@ COMMAND_HANDLER(xscale_handle_debug_handler_command)
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], handler_address);
 
 	if (((handler_address >= 0x800) && (handler_address <= 0x1fef800)) ||
-		((handler_address >= 0xfe000800) && (handler_address <= 0xfffff800)))
+		((handler_address >= 0xfe000800) && (handler_address <= 0xfffff800))) {
+		if (handler_address != xscale->handler_address)
+			xscale->handler_installed = 0;
 		xscale->handler_address = handler_address;
-	else {
+	} else {
 		LOG_ERROR(
 			"xscale debug_handler <address> must be between 0x800 and 0x1fef800 or between 0xfe000800 and 0xfffff800");
 		return ERROR_FAIL;
@@ -3049,6 +3071,35 @@ COMMAND_HANDLER(xscale_handle_debug_handler_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(xscale_handle_handler_cache_command)
+{
+	struct target *target = NULL;
+	struct xscale_common *xscale;
+	int retval;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	target = get_target(CMD_ARGV[0]);
+	if (target == NULL) {
+		LOG_ERROR("target '%s' not defined", CMD_ARGV[0]);
+		return ERROR_FAIL;
+	}
+
+	xscale = target_to_xscale(target);
+	retval = xscale_verify_pointer(CMD_CTX, xscale);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (CMD_ARGC == 2)
+		COMMAND_PARSE_ENABLE(CMD_ARGV[1], xscale->handler_cache);
+
+	command_print(CMD_CTX, "debug handler caching across resets is %s",
+		xscale->handler_cache ? "enabled" : "disabled");
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(xscale_handle_cache_clean_address_command)
 {
 	struct target *target = NULL;
@@ -3662,6 +3713,14 @@ static const struct command_registration xscale_any_command_handlers[] = {
 		.help = "Change address used for debug handler.",
 		.usage = "<target> <address>",
 	},
+	{
+		.name = "handler_cache",
+		.handler = xscale_handle_handler_cache_command,
+		.mode = COMMAND_ANY,
+		.help = "Keep the debug handler loaded across resets which "
+			"don't reset the TAP.",
+		.usage = "<target> ['enable'|'disable']",
+	},
 	{
 		.name = "cache_clean_address",
 		.handler = xscale_handle_cache_clean_address_command,
@@ -3711,6 +3770,7 @@ struct target_type xscale_target = {
 
 	.checksum_memory = arm_checksum_memory,
 	.blank_check_memory = arm_blank_check_memory,
+	.fill_memory = arm_fill_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
 
@@ -92,6 +92,8 @@ struct xscale_common {
 
 	/* current state of the debug handler */
 	uint32_t handler_address;
+	int handler_installed;	/* handler is in the mini-icache */
+	int handler_cache;	/* don't reload it on every reset */
 
 	/* target-endian buffers with exception vectors */
 	uint32_t low_vectors[8];
@@ -40,6 +40,7 @@
 
 #include "xsvf.h"
 #include <jtag/jtag.h>
+#include <jtag/commands.h>
 #include <svf/svf.h>
 
 /* XSVF commands, from appendix B of xapp503.pdf  */
@@ -119,8 +120,17 @@ TDO  (1);
 
 #define XSTATE_MAX_PATH 12
 
+/* bytes of queued XSDR/XSDRTDO vectors after which the queue is flushed
+ * even though no command waits for their result */
+#define XSVF_BATCH_SIZE		(256 * 1024)
+
 static int xsvf_fd;
 
+/* XSDR/XSDRTDO outside of XREPEAT loops are queued back to back and only
+ * checked when the queue gets flushed */
+static int xsvf_batched_bytes;
+static long xsvf_mismatch_offset;
+
 /* map xsvf tap state to an openocd "tap_state_t" */
 static tap_state_t xsvf_to_tap(int xsvf_state)
 {
@@ -196,6 +206,78 @@ static int xsvf_read_buffer(int num_bits, int fd, uint8_t *buf)
 	return ERROR_OK;
 }
 
+static int xsvf_check_batched_scan(jtag_callback_data_t data0,
+		jtag_callback_data_t data1, jtag_callback_data_t data2,
+		jtag_callback_data_t data3)
+{
+	uint8_t *captured = (uint8_t *)data0;
+	uint8_t *expected = (uint8_t *)data1;
+	int num_bits = (int)data2;
+
+	/* the mask follows the expected value */
+	if (!buf_cmp_mask(captured, expected,
+			expected + DIV_ROUND_UP(num_bits, 8), num_bits))
+		return ERROR_OK;
+
+	xsvf_mismatch_offset = (long)data3;
+	LOG_USER("XSDR mismatch, xsdrsize=%d offset=%ld", num_bits,
+			xsvf_mismatch_offset);
+
+	return ERROR_JTAG_QUEUE_FAILED;
+}
+
+/* runs the queued XSDR/XSDRTDO, before anything that depends on their result */
+static int xsvf_flush_batched(void)
+{
+	if (!xsvf_batched_bytes)
+		return ERROR_OK;
+
+	xsvf_batched_bytes = 0;
+	return jtag_execute_queue();
+}
+
+/* queues an XSDR/XSDRTDO whose check is deferred to the next flush; the
+ * expected value and mask are copied since the caller reuses them */
+static int xsvf_add_batched_scan(struct jtag_tap *tap, int num_bits,
+		uint8_t *out, uint8_t *expected, uint8_t *mask, long offset)
+{
+	int num_bytes = DIV_ROUND_UP(num_bits, 8);
+	struct scan_field field;
+	uint8_t *check = NULL;
+
+	field.num_bits = num_bits;
+	field.out_value = out;
+	field.in_value = NULL;
+
+	if (expected != NULL) {
+		field.in_value = cmd_queue_alloc(num_bytes);
+		check = cmd_queue_alloc(2 * num_bytes);
+		memcpy(check, expected, num_bytes);
+		memcpy(check + num_bytes, mask, num_bytes);
+	}
+
+	if (tap == NULL)
+		jtag_add_plain_dr_scan(field.num_bits,
+				field.out_value,
+				field.in_value,
+				TAP_DRPAUSE);
+	else
+		jtag_add_dr_scan(tap, 1, &field, TAP_DRPAUSE);
+
+	if (check != NULL)
+		jtag_add_callback4(xsvf_check_batched_scan,
+				(jtag_callback_data_t)field.in_value,
+				(jtag_callback_data_t)check,
+				(jtag_callback_data_t)num_bits,
+				(jtag_callback_data_t)offset);
+
+	xsvf_batched_bytes += num_bytes;
+	if (xsvf_batched_bytes >= XSVF_BATCH_SIZE)
+		return xsvf_flush_batched();
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_xsvf_command)
 {
 	uint8_t *dr_out_buf = NULL;				/* from host to device (TDI) */
@@ -274,6 +356,9 @@ COMMAND_HANDLER(handle_xsvf_command)
 	LOG_WARNING("XSVF support in OpenOCD is limited. Consider using SVF instead");
 	LOG_USER("xsvf processing file: \"%s\"", filename);
 
+	xsvf_batched_bytes = 0;
+	xsvf_mismatch_offset = -1;
+
 	while (read(xsvf_fd, &opcode, 1) > 0) {
 		/* record the position of this opcode within the file */
 		file_offset = lseek(xsvf_fd, 0, SEEK_CUR) - 1;
@@ -451,6 +536,22 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				LOG_DEBUG("%s %d", op_name, xsdrsize);
 
+				if (xrepeat == 0) {
+					/* nothing is retried, so nothing depends on the
+					 * result: queue it behind the previous scans */
+					if (xsvf_add_batched_scan(tap, xsdrsize, dr_out_buf,
+							dr_in_buf, dr_in_mask, file_offset) != ERROR_OK) {
+						tdo_mismatch = 1;
+						break;
+					}
+					matched = 1;
+					limit = 0;
+				} else if (xsvf_flush_batched() != ERROR_OK) {
+					/* one of the batched scans failed, not this one */
+					tdo_mismatch = 1;
+					break;
+				}
+
 				for (attempt = 0; attempt < limit; ++attempt) {
 					struct scan_field field;
 
@@ -914,6 +1015,11 @@ COMMAND_HANDLER(handle_xsvf_command)
 				if (limit < 1)
 					limit = 1;
 
+				if (xsvf_flush_batched() != ERROR_OK) {
+					tdo_mismatch = 1;
+					break;
+				}
+
 				for (attempt = 0; attempt < limit; ++attempt) {
 					struct scan_field field;
 
@@ -1004,7 +1110,15 @@ COMMAND_HANDLER(handle_xsvf_command)
 		}
 	}
 
+	/* files are not required to end with XCOMPLETE */
+	if (!do_abort && !unsupported && !tdo_mismatch
+			&& xsvf_flush_batched() != ERROR_OK)
+		tdo_mismatch = 1;
+
 	if (tdo_mismatch) {
+		/* a batched scan knows where it came from */
+		if (xsvf_mismatch_offset >= 0)
+			file_offset = xsvf_mismatch_offset;
 		command_print(CMD_CTX,
 			"TDO mismatch, somewhere near offset %lu in xsvf file, aborting",
 			file_offset);
@@ -0,0 +1,249 @@
+# Throughput and latency benchmarks for adapters and targets
+#
+# Every benchmark records its results, benchmark_json returns them all as
+# one JSON object so runs against different adapters, adapter firmware or
+# OpenOCD builds can be compared by a script, e.g.
+#
+# openocd -f interface/... -f target/... -f tools/benchmark.tcl \
+#	-c "init; reset halt; benchmark_memory 0x20000000 0x1000; \
+#	    echo [benchmark_json]; shutdown"
+#
+# Times come from the "ms" command, so iterations should be chosen to
+# make each measurement last at least some hundred milliseconds.
+
+set benchmark_results {}
+
+proc benchmark_record { name value unit } {
+	global benchmark_results
+	lappend benchmark_results [list $name $value $unit]
+	echo [format "%-32s %12.3f %s" $name $value $unit]
+}
+
+# run script in the caller's context, return the elapsed milliseconds (at least 1)
+proc benchmark_time { script } {
+	set start [ms]
+	uplevel 1 $script
+	set elapsed [expr {[ms] - $start}]
+	if {$elapsed < 1} {
+		return 1
+	}
+	return $elapsed
+}
+
+proc benchmark_rate { bytes elapsed } {
+	expr {double($bytes) / ($elapsed * 1000.0)}
+}
+
+# Shift bits through the BYPASS register of tap, iterations times
+proc benchmark_jtag { tap {bits 4096} {iterations 100} } {
+	irscan $tap 0xffffffff
+	set fields {}
+	for {set i 0} {$i < $bits / 32} {incr i} {
+		lappend fields 32 0
+	}
+
+	set elapsed [benchmark_time {
+		for {set i 0} {$i < $iterations} {incr i} {
+			eval drscan $tap $fields
+		}
+	}]
+	set total [expr {($bits / 32) * 32 * $iterations}]
+	benchmark_record jtag.shift_mbit_s [expr {$total / ($elapsed * 1000.0)}] Mbit/s
+	benchmark_record jtag.scan_latency_us [expr {1000.0 * $elapsed / $iterations}] us
+
+	set elapsed [benchmark_time {
+		for {set i 0} {$i < $iterations} {incr i} {
+			runtest $bits
+		}
+	}]
+	benchmark_record jtag.tck_mhz [expr {$bits * $iterations / ($elapsed * 1000.0)}] MHz
+}
+
+# Single word reads and writes, each one a separate DAP round trip
+proc benchmark_dap_latency { address {iterations 1000} } {
+	set elapsed [benchmark_time {
+		for {set i 0} {$i < $iterations} {incr i} {
+			mem2array benchmark_word 32 $address 1
+		}
+	}]
+	benchmark_record dap.read_latency_us [expr {1000.0 * $elapsed / $iterations}] us
+
+	set elapsed [benchmark_time {
+		for {set i 0} {$i < $iterations} {incr i} {
+			array2mem benchmark_word 32 $address 1
+		}
+	}]
+	benchmark_record dap.write_latency_us [expr {1000.0 * $elapsed / $iterations}] us
+}
+
+# Read and write size bytes of RAM with each access width
+proc benchmark_memory { address size {iterations 10} } {
+	foreach width {8 16 32} {
+		set count [expr {$size / ($width / 8)}]
+		for {set i 0} {$i < $count} {incr i} {
+			set benchmark_data($i) [expr {$i & ((1 << $width) - 1)}]
+		}
+
+		set elapsed [benchmark_time {
+			for {set i 0} {$i < $iterations} {incr i} {
+				array2mem benchmark_data $width $address $count
+			}
+		}]
+		benchmark_record memory.write${width}_mb_s \
+			[benchmark_rate [expr {$size * $iterations}] $elapsed] MB/s
+
+		set elapsed [benchmark_time {
+			for {set i 0} {$i < $iterations} {incr i} {
+				mem2array benchmark_data $width $address $count
+			}
+		}]
+		benchmark_record memory.read${width}_mb_s \
+			[benchmark_rate [expr {$size * $iterations}] $elapsed] MB/s
+		unset benchmark_data
+	}
+}
+
+# Erase, program and verify the first size bytes of flash bank, using
+# size bytes of RAM at ram_address to build the image in file.
+# This destroys the contents of both.
+proc benchmark_flash { bank ram_address size file } {
+	set info [lindex [flash list] $bank]
+	set base [dict get $info base]
+
+	set count [expr {$size / 4}]
+	for {set i 0} {$i < $count} {incr i} {
+		set benchmark_data($i) [expr {($i * 0x9e3779b1) & 0xffffffff}]
+	}
+	array2mem benchmark_data 32 $ram_address $count
+	dump_image $file $ram_address $size
+
+	set elapsed [benchmark_time {
+		flash erase_address pad $base $size
+	}]
+	benchmark_record flash.erase_kb_s [expr {1000.0 * $size / 1024 / $elapsed}] KB/s
+
+	set elapsed [benchmark_time {
+		flash write_bank $bank $file 0
+	}]
+	benchmark_record flash.program_kb_s [expr {1000.0 * $size / 1024 / $elapsed}] KB/s
+
+	set elapsed [benchmark_time {
+		flash verify_bank $bank $file 0
+	}]
+	benchmark_record flash.verify_kb_s [expr {1000.0 * $size / 1024 / $elapsed}] KB/s
+
+	set elapsed [benchmark_time {
+		flash read_bank $bank $file 0 $size
+	}]
+	benchmark_record flash.read_kb_s [expr {1000.0 * $size / 1024 / $elapsed}] KB/s
+}
+
+# Host side helpers only, see the host_benchmark command
+proc benchmark_host { {size 65536} } {
+	foreach line [split [capture "host_benchmark $size"] "\n"] {
+		if {[llength $line] == 3} {
+			benchmark_record [lindex $line 0] [lindex $line 1] [lindex $line 2]
+		}
+	}
+}
+
+# Cycles of a function on a halted Cortex-M target, see "cortex_m benchmark";
+# the results are recorded as function.<name>.*
+proc benchmark_function { name address {iterations 100} args } {
+	foreach line [split [capture "cortex_m benchmark $address $iterations $args"] "\n"] {
+		if {[llength $line] == 3} {
+			benchmark_record function.$name.[lindex $line 0] [lindex $line 1] [lindex $line 2]
+		}
+	}
+}
+
+proc benchmark_read_word { address } {
+	mem2array benchmark_word 32 $address 1
+	return $benchmark_word(0)
+}
+
+# Throughput of a flash loader, run against target RAM instead of flash so
+# the result is the speed of the loader itself, not of the flash.
+# The loader is a raw binary built from contrib/loaders/flash, e.g.
+#	arm-none-eabi-gcc -c stm32f2x.S && arm-none-eabi-objcopy -O binary stm32f2x.o stm32f2x.bin
+# loaded at code_address; regs are register/value pairs for its parameters,
+# with RAM addresses standing in for the destination and for the flash
+# registers it polls, and bytes is what one run moves. For loaders fed
+# through a FIFO, fifo is its {start end}: before each run the FIFO header
+# is set up with bytes of data queued, which must leave room for the header
+# and one word. The results are recorded as loader.<name>.cycles_per_byte,
+# from the DWT cycle counter where the core has one, and loader.<name>.kb_s,
+# which includes the debugger's cost of starting and halting each run.
+proc benchmark_loader { name code_address file bytes regs {fifo {}} {iterations 10} } {
+	if {[llength $fifo] == 2} {
+		set start [lindex $fifo 0]
+		if {$bytes > [lindex $fifo 1] - $start - 12} {
+			return -code error "the FIFO holds less than $bytes bytes"
+		}
+	}
+
+	load_image $file $code_address bin
+
+	# DEMCR.TRCENA, then DWT_CTRL.CYCCNTENA unless DWT_CTRL.NOCYCCNT
+	mww 0xe000edfc [expr {[benchmark_read_word 0xe000edfc] | (1 << 24)}]
+	set dwt_ctrl [benchmark_read_word 0xe0001000]
+	set have_cycles [expr {($dwt_ctrl & (1 << 25)) == 0}]
+	if {$have_cycles} {
+		mww 0xe0001000 [expr {$dwt_ctrl | 1}]
+	}
+
+	set cycles 0
+	set elapsed [benchmark_time {
+		for {set i 0} {$i < $iterations} {incr i} {
+			if {[llength $fifo] == 2} {
+				mww $start [expr {$start + 8 + $bytes}]
+				mww [expr {$start + 4}] [expr {$start + 8}]
+			}
+			foreach {r value} $regs {
+				reg $r $value
+			}
+			if {$have_cycles} {
+				set before [benchmark_read_word 0xe0001004]
+			}
+			resume $code_address
+			wait_halt 5000
+			if {$have_cycles} {
+				incr cycles [expr {([benchmark_read_word 0xe0001004] - $before) & 0xffffffff}]
+			}
+		}
+	}]
+
+	if {$have_cycles} {
+		benchmark_record loader.$name.cycles_per_byte \
+			[expr {double($cycles) / ($bytes * $iterations)}] cycles/B
+	}
+	benchmark_record loader.$name.kb_s [expr {1000.0 * $bytes * $iterations / 1024 / $elapsed}] KB/s
+}
+
+proc benchmark_json_string { s } {
+	return "\"[string map {\\ \\\\ \" \\\" \n \\n} $s]\""
+}
+
+# All results recorded so far, as one JSON object
+proc benchmark_json { } {
+	global benchmark_results
+
+	set json "\{\"openocd\": [benchmark_json_string [version]]"
+	append json ", \"adapter\": [benchmark_json_string [adapter_name]]"
+	append json ", \"transport\": [benchmark_json_string [transport select]]"
+	append json ", \"results\": \{"
+	set sep ""
+	foreach r $benchmark_results {
+		append json $sep [benchmark_json_string [lindex $r 0]] ": \{"
+		append json "\"value\": [format %.3f [lindex $r 1]], "
+		append json "\"unit\": [benchmark_json_string [lindex $r 2]]\}"
+		set sep ", "
+	}
+	append json "\}\}"
+	return $json
+}
+
+proc benchmark_reset { } {
+	global benchmark_results
+	set benchmark_results {}
+}